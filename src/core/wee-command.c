@@ -1768,6 +1768,44 @@ COMMAND_CALLBACK(debug)
 
     if (string_strcasecmp (argv[1], "hooks") == 0)
     {
+        if (argc > 2)
+        {
+            if (string_strcasecmp (argv[2], "profile") == 0)
+            {
+                COMMAND_MIN_ARGS(4, "hooks profile");
+                if (string_strcasecmp (argv[3], "on") == 0)
+                {
+                    hook_profile_set (1);
+                    gui_chat_printf (NULL,
+                                     _("Profiling of hooks enabled"));
+                }
+                else if (string_strcasecmp (argv[3], "off") == 0)
+                {
+                    hook_profile_set (0);
+                    gui_chat_printf (NULL,
+                                     _("Profiling of hooks disabled"));
+                }
+                else if (string_strcasecmp (argv[3], "reset") == 0)
+                {
+                    hook_profile_reset ();
+                    gui_chat_printf (NULL,
+                                     _("Execution statistics of hooks "
+                                       "reset"));
+                }
+                else
+                    COMMAND_ERROR;
+                return WEECHAT_RC_OK;
+            }
+            if (string_strcasecmp (argv[2], "calls") == 0)
+                debug_hooks_stats (HOOK_STATS_SORT_CALLS);
+            else if (string_strcasecmp (argv[2], "total") == 0)
+                debug_hooks_stats (HOOK_STATS_SORT_TOTAL);
+            else if (string_strcasecmp (argv[2], "max") == 0)
+                debug_hooks_stats (HOOK_STATS_SORT_MAX);
+            else
+                COMMAND_ERROR;
+            return WEECHAT_RC_OK;
+        }
         debug_hooks ();
         return WEECHAT_RC_OK;
     }
@@ -4315,11 +4353,10 @@ command_plugin_list (const char *name, int full)
                         hook_found = 1;
                         gui_chat_printf (NULL,
                                          _("      socket: %d, address: %s, "
-                                           "port: %d, child pid: %d"),
+                                           "port: %d"),
                                          HOOK_CONNECT(ptr_hook, sock),
                                          HOOK_CONNECT(ptr_hook, address),
-                                         HOOK_CONNECT(ptr_hook, port),
-                                         HOOK_CONNECT(ptr_hook, child_pid));
+                                         HOOK_CONNECT(ptr_hook, port));
                     }
                 }
 
@@ -7186,6 +7223,8 @@ command_init ()
            " || buffer|color|infolists|memory|tags|term|windows"
            " || mouse|cursor [verbose]"
            " || hdata [free]"
+           " || hooks [calls|total|max]"
+           " || hooks profile on|off|reset"
            " || time <command>"),
         N_("     list: list plugins with debug levels\n"
            "      set: set debug level for plugin\n"
@@ -7199,7 +7238,11 @@ command_init ()
            "     dirs: display directories\n"
            "    hdata: display infos about hdata (with free: remove all hdata "
            "in memory)\n"
-           "    hooks: display infos about hooks\n"
+           "    hooks: display infos about hooks (with calls/total/max: "
+           "display execution statistics of hooks by plugin/script, sorted "
+           "by number of calls, total time or max time of callbacks)\n"
+           "  profile: enable/disable/reset execution statistics of hooks "
+           "(disabled by default)\n"
            "infolists: display infos about infolists\n"
            "     libs: display infos about external libraries used\n"
            "   memory: display infos about memory usage\n"
@@ -7217,7 +7260,8 @@ command_init ()
         " || cursor verbose"
         " || dirs"
         " || hdata free"
-        " || hooks"
+        " || hooks calls|total|max"
+        " || hooks profile on|off|reset"
         " || infolists"
         " || libs"
         " || memory"
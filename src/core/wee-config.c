@@ -61,6 +61,7 @@
 #include "../gui/gui-main.h"
 #include "../gui/gui-mouse.h"
 #include "../gui/gui-nicklist.h"
+#include "../gui/gui-search-index.h"
 #include "../gui/gui-window.h"
 #include "../plugins/plugin.h"
 
@@ -78,6 +79,7 @@ struct t_config_option *config_startup_command_after_plugins;
 struct t_config_option *config_startup_command_before_plugins;
 struct t_config_option *config_startup_display_logo;
 struct t_config_option *config_startup_display_version;
+struct t_config_option *config_startup_fd_backend;
 struct t_config_option *config_startup_sys_rlimit;
 
 /* config, look & feel section */
@@ -95,6 +97,7 @@ struct t_config_option *config_look_buffer_notify_default;
 struct t_config_option *config_look_buffer_position;
 struct t_config_option *config_look_buffer_search_case_sensitive;
 struct t_config_option *config_look_buffer_search_force_default;
+struct t_config_option *config_look_buffer_search_index;
 struct t_config_option *config_look_buffer_search_regex;
 struct t_config_option *config_look_buffer_search_where;
 struct t_config_option *config_look_buffer_time_format;
@@ -306,6 +309,7 @@ int config_emphasized_attributes = 0;
 regex_t *config_highlight_regex = NULL;
 char ***config_highlight_tags = NULL;
 int config_num_highlight_tags = 0;
+struct t_gui_line_tags_match *config_highlight_tags_match = NULL;
 char **config_plugin_extensions = NULL;
 int config_num_plugin_extensions = 0;
 char config_tab_spaces[TAB_MAX_WIDTH + 1];
@@ -336,6 +340,20 @@ config_change_sys_rlimit (const void *pointer, void *data,
         util_setrlimit ();
 }
 
+/*
+ * Sets backend used to watch file descriptors of fd hooks, according to
+ * option "weechat.startup.fd_backend".
+ */
+
+void
+config_set_fd_backend ()
+{
+    hook_fd_set_backend (
+        (CONFIG_INTEGER(config_startup_fd_backend) ==
+         CONFIG_STARTUP_FD_BACKEND_EPOLL) ?
+        HOOK_FD_BACKEND_EPOLL : HOOK_FD_BACKEND_POLL);
+}
+
 /*
  * Callback for changes on options "weechat.look.save_{config|layout}_on_exit".
  */
@@ -631,6 +649,23 @@ config_change_buffer_notify_default (const void *pointer, void *data,
     gui_buffer_notify_set_all ();
 }
 
+/*
+ * Callback for changes on option "weechat.look.buffer_search_index".
+ */
+
+void
+config_change_buffer_search_index (const void *pointer, void *data,
+                                   struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    if (!CONFIG_BOOLEAN(config_look_buffer_search_index))
+        gui_search_index_free_all ();
+}
+
 /*
  * Callback for changes on option "weechat.look.buffer_time_format".
  */
@@ -900,6 +935,11 @@ config_change_highlight_tags (const void *pointer, void *data,
         config_highlight_tags = NULL;
     }
     config_num_highlight_tags = 0;
+    if (config_highlight_tags_match)
+    {
+        gui_line_tags_match_free (config_highlight_tags_match);
+        config_highlight_tags_match = NULL;
+    }
 
     if (CONFIG_STRING(config_look_highlight_tags)
         && CONFIG_STRING(config_look_highlight_tags)[0])
@@ -919,6 +959,8 @@ config_change_highlight_tags (const void *pointer, void *data,
                 }
             }
             string_free_split (tags_array);
+            config_highlight_tags_match = gui_line_tags_match_new (
+                config_num_highlight_tags, config_highlight_tags);
         }
     }
 }
@@ -1302,6 +1344,10 @@ config_weechat_init_after_read ()
 
     util_setrlimit ();
 
+    /* backend for fd hooks is set only on startup (not on /reload) */
+    if (!gui_init_ok)
+        config_set_fd_backend ();
+
     gui_buffer_notify_set_all ();
 
     proxy_use_temp_proxies ();
@@ -2421,6 +2467,19 @@ config_weechat_init_options ()
         N_("display WeeChat version at startup"),
         NULL, 0, 0, "on", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_startup_fd_backend = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "fd_backend", "integer",
+        N_("method used to watch file descriptors (sockets, pipes, ...): "
+           "poll = use poll() (the list of file descriptors is built on each "
+           "loop), epoll = use epoll (file descriptors are registered once, "
+           "faster with many connections, Linux only); if epoll is not "
+           "available, poll() is used; WeeChat must be restarted to use the "
+           "new value"),
+        "poll|epoll", 0, 0, "poll", NULL, 0,
+        NULL, NULL, NULL,
+        NULL, NULL, NULL,
+        NULL, NULL, NULL);
     config_startup_sys_rlimit = config_file_new_option (
         weechat_config_file, ptr_section,
         "sys_rlimit", "string",
@@ -2565,6 +2624,18 @@ config_weechat_init_options ()
            "values from last search in buffer)"),
         NULL, 0, 0, "off", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_look_buffer_search_index = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "buffer_search_index", "boolean",
+        N_("use an index of lines for text search in buffer (built on first "
+           "search in buffer and updated when lines are added or removed): "
+           "the search is faster on buffers with many lines, but uses more "
+           "memory; the index is not used with merged buffers and with "
+           "regular expressions containing \"|\" or \"(\""),
+        NULL, 0, 0, "on", NULL, 0,
+        NULL, NULL, NULL,
+        &config_change_buffer_search_index, NULL, NULL,
+        NULL, NULL, NULL);
     config_look_buffer_search_regex = config_file_new_option (
         weechat_config_file, ptr_section,
         "buffer_search_regex", "boolean",
@@ -4534,6 +4605,11 @@ config_weechat_free ()
         config_highlight_tags = NULL;
     }
     config_num_highlight_tags = 0;
+    if (config_highlight_tags_match)
+    {
+        gui_line_tags_match_free (config_highlight_tags_match);
+        config_highlight_tags_match = NULL;
+    }
 
     if (config_plugin_extensions)
     {
@@ -27,11 +27,18 @@
 #include "wee-config-file.h"
 
 struct t_gui_buffer;
+struct t_gui_line_tags_match;
 
 #define WEECHAT_CONFIG_NAME "weechat"
 
 #define TAB_MAX_WIDTH 64
 
+enum t_config_startup_fd_backend
+{
+    CONFIG_STARTUP_FD_BACKEND_POLL = 0,
+    CONFIG_STARTUP_FD_BACKEND_EPOLL,
+};
+
 enum t_config_look_align_end_of_lines
 {
     CONFIG_LOOK_ALIGN_END_OF_LINES_TIME = 0,
@@ -131,6 +138,7 @@ extern struct t_config_option *config_startup_command_after_plugins;
 extern struct t_config_option *config_startup_command_before_plugins;
 extern struct t_config_option *config_startup_display_logo;
 extern struct t_config_option *config_startup_display_version;
+extern struct t_config_option *config_startup_fd_backend;
 extern struct t_config_option *config_startup_sys_rlimit;
 
 extern struct t_config_option *config_look_align_end_of_lines;
@@ -146,6 +154,7 @@ extern struct t_config_option *config_look_buffer_notify_default;
 extern struct t_config_option *config_look_buffer_position;
 extern struct t_config_option *config_look_buffer_search_case_sensitive;
 extern struct t_config_option *config_look_buffer_search_force_default;
+extern struct t_config_option *config_look_buffer_search_index;
 extern struct t_config_option *config_look_buffer_search_regex;
 extern struct t_config_option *config_look_buffer_search_where;
 extern struct t_config_option *config_look_buffer_time_format;
@@ -342,6 +351,7 @@ extern int config_emphasized_attributes;
 extern regex_t *config_highlight_regex;
 extern char ***config_highlight_tags;
 extern int config_num_highlight_tags;
+extern struct t_gui_line_tags_match *config_highlight_tags_match;
 extern char **config_plugin_extensions;
 extern int config_num_plugin_extensions;
 extern char config_tab_spaces[];
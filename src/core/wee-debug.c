@@ -39,8 +39,10 @@
 #endif
 
 #include "weechat.h"
+#include "wee-arraylist.h"
 #include "wee-backtrace.h"
 #include "wee-config-file.h"
+#include "wee-debug.h"
 #include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-hook.h"
@@ -409,6 +411,181 @@ debug_hooks ()
     gui_chat_printf (NULL, "%17s:%5d", "total", hooks_count_total);
 }
 
+/*
+ * Compares execution statistics of two owners (plugin/script), in reverse
+ * order (highest value first).
+ */
+
+int
+debug_hooks_stats_owner_cmp_cb (void *data, struct t_arraylist *arraylist,
+                                void *pointer1, void *pointer2)
+{
+    /* make C compiler happy */
+    (void) arraylist;
+
+    return hook_stats_cmp (
+        ((struct t_debug_hook_owner *)pointer2)->stats,
+        ((struct t_debug_hook_owner *)pointer1)->stats,
+        *((int *)data));
+}
+
+/*
+ * Frees an owner in arraylist.
+ */
+
+void
+debug_hooks_stats_owner_free_cb (void *data, struct t_arraylist *arraylist,
+                                 void *pointer)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    free (pointer);
+}
+
+/*
+ * Adds an owner in arraylist (callback called for each owner in hashtable).
+ */
+
+void
+debug_hooks_stats_owner_map_cb (void *data, struct t_hashtable *hashtable,
+                                const void *key, const void *value)
+{
+    struct t_debug_hook_owner *new_owner;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    new_owner = malloc (sizeof (*new_owner));
+    if (!new_owner)
+        return;
+    new_owner->owner = (const char *)key;
+    new_owner->stats = (struct t_hook_stats *)value;
+    arraylist_add ((struct t_arraylist *)data, new_owner);
+}
+
+/*
+ * Compares execution statistics of two hooks, in reverse order (highest
+ * value first).
+ */
+
+int
+debug_hooks_stats_hook_cmp_cb (void *data, struct t_arraylist *arraylist,
+                               void *pointer1, void *pointer2)
+{
+    /* make C compiler happy */
+    (void) arraylist;
+
+    return hook_stats_cmp (&(((struct t_hook *)pointer2)->stats),
+                           &(((struct t_hook *)pointer1)->stats),
+                           *((int *)data));
+}
+
+/*
+ * Displays execution statistics of hooks (collected when profiling is
+ * enabled), by plugin/script then for each hook, sorted by number of calls,
+ * total time or max time (see HOOK_STATS_SORT_XXX in wee-hook.h).
+ */
+
+void
+debug_hooks_stats (int sort)
+{
+    struct t_hashtable *owners;
+    struct t_arraylist *list_owners, *list_hooks;
+    struct t_debug_hook_owner *ptr_owner;
+    struct t_hook *ptr_hook;
+    char owner[512];
+    int i, type, size;
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     "execution statistics of hooks (profiling: %s), "
+                     "sorted by %s:",
+                     (hook_profile) ? "on" : "off",
+                     (sort == HOOK_STATS_SORT_CALLS) ? "number of calls" :
+                     ((sort == HOOK_STATS_SORT_MAX) ? "max time" :
+                      "total time"));
+
+    owners = hook_profile_get_owners ();
+    list_owners = arraylist_new (32, 1, 1,
+                                 &debug_hooks_stats_owner_cmp_cb, &sort,
+                                 &debug_hooks_stats_owner_free_cb, NULL);
+    list_hooks = arraylist_new (32, 1, 1,
+                                &debug_hooks_stats_hook_cmp_cb, &sort,
+                                NULL, NULL);
+    if (!owners || !list_owners || !list_hooks)
+        goto end;
+
+    hashtable_map (owners, &debug_hooks_stats_owner_map_cb, list_owners);
+
+    if (arraylist_size (list_owners) == 0)
+    {
+        gui_chat_printf (NULL,
+                         "  no statistics (enable profiling with: "
+                         "/debug hooks profile on)");
+        goto end;
+    }
+
+    /* statistics by plugin/script */
+    gui_chat_printf (NULL, "  by plugin/script:");
+    gui_chat_printf (NULL, "  %12s %14s %12s  %s",
+                     "calls", "total (ms)", "max (ms)", "plugin/script");
+    size = arraylist_size (list_owners);
+    for (i = 0; i < size; i++)
+    {
+        ptr_owner = (struct t_debug_hook_owner *)arraylist_get (list_owners,
+                                                                 i);
+        gui_chat_printf (NULL, "  %12llu %10lld.%03lld %8lld.%03lld  %s",
+                         ptr_owner->stats->calls,
+                         ptr_owner->stats->time_total / 1000,
+                         ptr_owner->stats->time_total % 1000,
+                         ptr_owner->stats->time_max / 1000,
+                         ptr_owner->stats->time_max % 1000,
+                         ptr_owner->owner);
+    }
+
+    /* statistics by hook (only hooks still in memory) */
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted && (ptr_hook->stats.calls > 0))
+                arraylist_add (list_hooks, ptr_hook);
+        }
+    }
+    size = arraylist_size (list_hooks);
+    if (size > DEBUG_HOOKS_STATS_MAX_HOOKS)
+        size = DEBUG_HOOKS_STATS_MAX_HOOKS;
+    gui_chat_printf (NULL, "  by hook (top %d):", size);
+    gui_chat_printf (NULL, "  %12s %14s %12s  %s",
+                     "calls", "total (ms)", "max (ms)", "plugin/script: hook");
+    for (i = 0; i < size; i++)
+    {
+        ptr_hook = (struct t_hook *)arraylist_get (list_hooks, i);
+        hook_get_owner (ptr_hook, owner, sizeof (owner));
+        gui_chat_printf (NULL,
+                         "  %12llu %10lld.%03lld %8lld.%03lld  %s: %s \"%s\"",
+                         ptr_hook->stats.calls,
+                         ptr_hook->stats.time_total / 1000,
+                         ptr_hook->stats.time_total % 1000,
+                         ptr_hook->stats.time_max / 1000,
+                         ptr_hook->stats.time_max % 1000,
+                         owner,
+                         hook_type_string[ptr_hook->type],
+                         hook_get_description (ptr_hook));
+    }
+
+end:
+    if (list_hooks)
+        arraylist_free (list_hooks);
+    if (list_owners)
+        arraylist_free (list_owners);
+    if (owners)
+        hashtable_free (owners);
+}
+
 /*
  * Displays a list of infolists in memory.
  */
@@ -20,13 +20,26 @@
 #ifndef WEECHAT_DEBUG_H
 #define WEECHAT_DEBUG_H 1
 
+/* max number of hooks displayed in execution statistics of hooks */
+#define DEBUG_HOOKS_STATS_MAX_HOOKS 20
+
 struct t_gui_window_tree;
+struct t_hook_stats;
+
+/* owner of hooks (plugin/script), used to sort execution statistics */
+
+struct t_debug_hook_owner
+{
+    const char *owner;                 /* "core", plugin or "plugin/script" */
+    struct t_hook_stats *stats;        /* statistics for this owner         */
+};
 
 extern void debug_sigsegv ();
 extern void debug_windows_tree ();
 extern void debug_memory ();
 extern void debug_hdata ();
 extern void debug_hooks ();
+extern void debug_hooks_stats (int sort);
 extern void debug_infolists ();
 extern void debug_directories ();
 extern void debug_display_time_elapsed (struct timeval *time1,
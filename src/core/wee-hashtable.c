@@ -24,6 +24,7 @@
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <time.h>
 
@@ -41,6 +42,15 @@ char *hashtable_type_string[HASHTABLE_NUM_TYPES] =
   WEECHAT_HASHTABLE_POINTER, WEECHAT_HASHTABLE_BUFFER,
   WEECHAT_HASHTABLE_TIME };
 
+/* primes used by hash of strings (same as xxHash64) */
+#define HASHTABLE_PRIME64_1 0x9E3779B185EBCA87ULL
+#define HASHTABLE_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define HASHTABLE_PRIME64_3 0x165667B19E3779F9ULL
+#define HASHTABLE_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define HASHTABLE_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define HASHTABLE_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
 
 /*
  * Searches for a hashtable type.
@@ -87,6 +97,134 @@ hashtable_hash_key_djb2 (const char *string)
     return hash;
 }
 
+/*
+ * Converts to lower case the chars of a word (8 bytes) which are in the
+ * range (see function hashtable_hash_key_string_range), all bytes are
+ * converted at once.
+ *
+ * Only ASCII chars are converted (bytes >= 128 are never modified).
+ */
+
+uint64_t
+hashtable_hash_lower_word (uint64_t word, int range)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t high_bits = 0x8080808080808080ULL;
+    uint64_t low_bits, above_min, above_max;
+
+    /*
+     * for each byte (with high bit cleared): high bit is set in above_min
+     * if byte >= 'A' and in above_max if byte > 'A' + range - 1
+     */
+    low_bits = word & ~high_bits;
+    above_min = low_bits + (ones * (0x80 - 'A'));
+    above_max = low_bits + (ones * (0x80 - ('A' + range)));
+
+    /* add 0x20 ('a' - 'A') to bytes in range */
+    return word | (((above_min & ~above_max & ~word) & high_bits) >> 2);
+}
+
+/*
+ * Hashes a string using an algorithm based on xxHash64: the string is read
+ * word by word (8 bytes), which is much faster than djb2 for long strings,
+ * and the distribution is better for strings with a common prefix (like
+ * nicks and channels).
+ *
+ * If range is > 0, the string is case insensitive: the range is the number
+ * of chars which can be converted from upper to lower case (same as
+ * function string_strcasecmp_range), so the hash can be used with this
+ * function to compare keys:
+ *   - range = 26: A-Z         ==> a-z
+ *   - range = 29: A-Z [ \ ]   ==> a-z { | }
+ *   - range = 30: A-Z [ \ ] ^ ==> a-z { | } ~
+ *
+ * Note: the hash depends on the endianness of CPU, so it must not be saved
+ * in a file or sent to another computer.
+ *
+ * Returns the hash of the string.
+ */
+
+unsigned long long
+hashtable_hash_key_string_range (const char *string, int range)
+{
+    const char *ptr_string;
+    uint64_t hash, word;
+    uint32_t word32;
+    size_t length;
+    unsigned char c;
+
+    /* chars after "_" can not be converted (bit 0x20 must be zero) */
+    if (range > 0x60 - 'A')
+        range = 0x60 - 'A';
+
+    length = strlen (string);
+    ptr_string = string;
+
+    hash = HASHTABLE_PRIME64_5 + (uint64_t)length;
+
+    while (length >= 8)
+    {
+        memcpy (&word, ptr_string, 8);
+        if (range > 0)
+            word = hashtable_hash_lower_word (word, range);
+        word *= HASHTABLE_PRIME64_2;
+        word = HASHTABLE_ROTL64(word, 31);
+        word *= HASHTABLE_PRIME64_1;
+        hash ^= word;
+        hash = (HASHTABLE_ROTL64(hash, 27) * HASHTABLE_PRIME64_1)
+            + HASHTABLE_PRIME64_4;
+        ptr_string += 8;
+        length -= 8;
+    }
+
+    if (length >= 4)
+    {
+        memcpy (&word32, ptr_string, 4);
+        word = word32;
+        if (range > 0)
+            word = hashtable_hash_lower_word (word, range);
+        hash ^= word * HASHTABLE_PRIME64_1;
+        hash = (HASHTABLE_ROTL64(hash, 23) * HASHTABLE_PRIME64_2)
+            + HASHTABLE_PRIME64_3;
+        ptr_string += 4;
+        length -= 4;
+    }
+
+    while (length > 0)
+    {
+        c = (unsigned char)ptr_string[0];
+        if ((range > 0) && (c >= 'A') && (c < 'A' + range))
+            c += ('a' - 'A');
+        hash ^= c * HASHTABLE_PRIME64_5;
+        hash = HASHTABLE_ROTL64(hash, 11) * HASHTABLE_PRIME64_1;
+        ptr_string++;
+        length--;
+    }
+
+    /* final mix of bits */
+    hash ^= hash >> 33;
+    hash *= HASHTABLE_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= HASHTABLE_PRIME64_3;
+    hash ^= hash >> 32;
+
+    return (unsigned long long)hash;
+}
+
+/*
+ * Hashes a string (case sensitive).
+ *
+ * This is the default hash for keys of type "string".
+ *
+ * Returns the hash of the string.
+ */
+
+unsigned long long
+hashtable_hash_key_string (const char *string)
+{
+    return hashtable_hash_key_string_range (string, 0);
+}
+
 /*
  * Hashes a key (default callback).
  *
@@ -106,7 +244,7 @@ hashtable_hash_key_default_cb (struct t_hashtable *hashtable, const void *key)
             hash = (unsigned long long)(*((int *)key));
             break;
         case HASHTABLE_STRING:
-            hash = hashtable_hash_key_djb2 ((const char *)key);
+            hash = hashtable_hash_key_string ((const char *)key);
             break;
         case HASHTABLE_POINTER:
             hash = (unsigned long long)((unsigned long)((void *)key));
@@ -178,10 +316,12 @@ hashtable_keycmp_default_cb (struct t_hashtable *hashtable,
 /*
  * Creates a new hashtable.
  *
- * The size is NOT a limit for number of items in hashtable. It is the size of
- * internal array to store hashed keys: a high value uses more memory, but has
- * better performance because this reduces the collisions of hashed keys and
- * then reduces length of linked lists.
+ * The size is NOT a limit for number of items in hashtable. It is the initial
+ * size of internal array to store hashed keys: a high value uses more memory,
+ * but has better performance because this reduces the collisions of hashed
+ * keys and then reduces length of linked lists.
+ * The internal array is automatically doubled when the number of items
+ * becomes greater than size * HASHTABLE_LOAD_FACTOR_MAX.
  *
  * Returns pointer to new hashtable, NULL if error.
  */
@@ -227,6 +367,7 @@ hashtable_new (int size,
             new_hashtable->htable[i] = NULL;
         }
         new_hashtable->items_count = 0;
+        new_hashtable->map_running = 0;
 
         new_hashtable->callback_hash_key = (callback_hash_key) ?
             callback_hash_key : &hashtable_hash_key_default_cb;
@@ -361,6 +502,128 @@ hashtable_free_value (struct t_hashtable *hashtable,
     }
 }
 
+/*
+ * Searches for a key in a linked list of hashtable (the list is sorted by
+ * hash, then by key): the callback keycmp is called only for items with the
+ * same hash.
+ *
+ * If pos_item is non NULL, then it is set with the item after which the key
+ * must be inserted (NULL if the key must be inserted at beginning of list).
+ *
+ * Returns pointer to item found, NULL if key is not in the list.
+ */
+
+struct t_hashtable_item *
+hashtable_search_item (struct t_hashtable *hashtable,
+                       struct t_hashtable_item *list,
+                       const void *key, unsigned long long hash,
+                       struct t_hashtable_item **pos_item)
+{
+    struct t_hashtable_item *ptr_item, *ptr_pos_item;
+    int rc;
+
+    ptr_pos_item = NULL;
+    for (ptr_item = list; ptr_item; ptr_item = ptr_item->next_item)
+    {
+        if (ptr_item->hash > hash)
+            break;
+        if (ptr_item->hash == hash)
+        {
+            rc = (hashtable->callback_keycmp) (hashtable, key, ptr_item->key);
+            if (rc == 0)
+            {
+                if (pos_item)
+                    *pos_item = ptr_pos_item;
+                return ptr_item;
+            }
+            if (rc < 0)
+                break;
+        }
+        ptr_pos_item = ptr_item;
+    }
+
+    if (pos_item)
+        *pos_item = ptr_pos_item;
+
+    return NULL;
+}
+
+/*
+ * Inserts an item in a linked list of hashtable, after the item "pos_item"
+ * (if pos_item is NULL, the item is inserted at beginning of list).
+ */
+
+void
+hashtable_insert_item (struct t_hashtable_item **list,
+                       struct t_hashtable_item *pos_item,
+                       struct t_hashtable_item *item)
+{
+    if (pos_item)
+    {
+        /* insert item after position found */
+        item->prev_item = pos_item;
+        item->next_item = pos_item->next_item;
+        if (pos_item->next_item)
+            (pos_item->next_item)->prev_item = item;
+        pos_item->next_item = item;
+    }
+    else
+    {
+        /* insert item at beginning of list */
+        item->prev_item = NULL;
+        item->next_item = *list;
+        if (*list)
+            (*list)->prev_item = item;
+        *list = item;
+    }
+}
+
+/*
+ * Resizes the internal array of a hashtable: all items are moved to the
+ * linked list matching their hash in the new array (hash of keys is not
+ * computed again, it is stored in items).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (the hashtable is unchanged)
+ */
+
+int
+hashtable_resize (struct t_hashtable *hashtable, int new_size)
+{
+    struct t_hashtable_item **new_htable, *ptr_item, *next_item, *pos_item;
+    unsigned long long index;
+    int i;
+
+    if (!hashtable || (new_size <= 0) || (new_size == hashtable->size))
+        return 0;
+
+    new_htable = calloc (new_size, sizeof (*new_htable));
+    if (!new_htable)
+        return 0;
+
+    for (i = 0; i < hashtable->size; i++)
+    {
+        ptr_item = hashtable->htable[i];
+        while (ptr_item)
+        {
+            next_item = ptr_item->next_item;
+            index = ptr_item->hash % new_size;
+            (void) hashtable_search_item (hashtable, new_htable[index],
+                                          ptr_item->key, ptr_item->hash,
+                                          &pos_item);
+            hashtable_insert_item (&new_htable[index], pos_item, ptr_item);
+            ptr_item = next_item;
+        }
+    }
+
+    free (hashtable->htable);
+    hashtable->htable = new_htable;
+    hashtable->size = new_size;
+
+    return 1;
+}
+
 /*
  * Sets value for a key in hashtable.
  *
@@ -374,7 +637,7 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
                          const void *key, int key_size,
                          const void *value, int value_size)
 {
-    unsigned long long hash;
+    unsigned long long hash, index;
     struct t_hashtable_item *ptr_item, *pos_item, *new_item;
 
     if (!hashtable || !key
@@ -385,18 +648,13 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
     }
 
     /* search position for item in hashtable */
-    hash = hashtable->callback_hash_key (hashtable, key) % hashtable->size;
-    pos_item = NULL;
-    for (ptr_item = hashtable->htable[hash];
-         ptr_item
-             && ((int)(hashtable->callback_keycmp) (hashtable, key, ptr_item->key) > 0);
-         ptr_item = ptr_item->next_item)
-    {
-        pos_item = ptr_item;
-    }
+    hash = hashtable->callback_hash_key (hashtable, key);
+    index = hash % hashtable->size;
+    ptr_item = hashtable_search_item (hashtable, hashtable->htable[index],
+                                      key, hash, &pos_item);
 
     /* replace value if item is already in hashtable */
-    if (ptr_item && (hashtable->callback_keycmp (hashtable, key, ptr_item->key) == 0))
+    if (ptr_item)
     {
         hashtable_free_value (hashtable, ptr_item);
         hashtable_alloc_type (hashtable->type_values,
@@ -417,29 +675,21 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
     hashtable_alloc_type (hashtable->type_values,
                           value, value_size,
                           &new_item->value, &new_item->value_size);
+    new_item->hash = hash;
 
     /* add item */
-    if (pos_item)
-    {
-        /* insert item after position found */
-        new_item->prev_item = pos_item;
-        new_item->next_item = pos_item->next_item;
-        if (pos_item->next_item)
-            (pos_item->next_item)->prev_item = new_item;
-        pos_item->next_item = new_item;
-    }
-    else
-    {
-        /* insert item at beginning of list */
-        new_item->prev_item = NULL;
-        new_item->next_item = hashtable->htable[hash];
-        if (hashtable->htable[hash])
-            (hashtable->htable[hash])->prev_item = new_item;
-        hashtable->htable[hash] = new_item;
-    }
+    hashtable_insert_item (&hashtable->htable[index], pos_item, new_item);
 
     hashtable->items_count++;
 
+    /* grow htable if linked lists are too long (not during a map) */
+    if ((hashtable->items_count > hashtable->size * HASHTABLE_LOAD_FACTOR_MAX)
+        && (hashtable->size <= HASHTABLE_SIZE_MAX / 2)
+        && (hashtable->map_running == 0))
+    {
+        (void) hashtable_resize (hashtable, hashtable->size * 2);
+    }
+
     return new_item;
 }
 
@@ -462,36 +712,26 @@ hashtable_set (struct t_hashtable *hashtable,
 /*
  * Searches for an item in hashtable.
  *
- * If hash is non NULL, then it is set with hash value of key (even if key is
- * not found).
+ * If hash is non NULL, then it is set with hash value of key modulo size of
+ * hashtable, ie the index in htable (even if key is not found).
  */
 
 struct t_hashtable_item *
 hashtable_get_item (struct t_hashtable *hashtable, const void *key,
                     unsigned long long *hash)
 {
-    unsigned long long key_hash;
-    struct t_hashtable_item *ptr_item;
+    unsigned long long key_hash, index;
 
     if (!hashtable || !key)
         return NULL;
 
-    key_hash = hashtable->callback_hash_key (hashtable, key) % hashtable->size;
+    key_hash = hashtable->callback_hash_key (hashtable, key);
+    index = key_hash % hashtable->size;
     if (hash)
-        *hash = key_hash;
-    for (ptr_item = hashtable->htable[key_hash];
-         ptr_item && hashtable->callback_keycmp (hashtable, key, ptr_item->key) > 0;
-         ptr_item = ptr_item->next_item)
-    {
-    }
+        *hash = index;
 
-    if (ptr_item
-        && (hashtable->callback_keycmp (hashtable, key, ptr_item->key) == 0))
-    {
-        return ptr_item;
-    }
-
-    return NULL;
+    return hashtable_search_item (hashtable, hashtable->htable[index],
+                                  key, key_hash, NULL);
 }
 
 /*
@@ -579,6 +819,8 @@ hashtable_map (struct t_hashtable *hashtable,
     if (!hashtable)
         return;
 
+    hashtable->map_running++;
+
     for (i = 0; i < hashtable->size; i++)
     {
         ptr_item = hashtable->htable[i];
@@ -594,6 +836,8 @@ hashtable_map (struct t_hashtable *hashtable,
             ptr_item = ptr_next_item;
         }
     }
+
+    hashtable->map_running--;
 }
 
 /*
@@ -613,6 +857,8 @@ hashtable_map_string (struct t_hashtable *hashtable,
     if (!hashtable)
         return;
 
+    hashtable->map_running++;
+
     for (i = 0; i < hashtable->size; i++)
     {
         ptr_item = hashtable->htable[i];
@@ -641,6 +887,8 @@ hashtable_map_string (struct t_hashtable *hashtable,
             ptr_item = ptr_next_item;
         }
     }
+
+    hashtable->map_running--;
 }
 
 /*
@@ -1201,6 +1449,7 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
     log_printf ("  size . . . . . . . . . : %d",    hashtable->size);
     log_printf ("  htable . . . . . . . . : 0x%lx", hashtable->htable);
     log_printf ("  items_count. . . . . . : %d",    hashtable->items_count);
+    log_printf ("  map_running. . . . . . : %d",    hashtable->map_running);
     log_printf ("  type_keys. . . . . . . : %d (%s)",
                 hashtable->type_keys,
                 hashtable_type_string[hashtable->type_keys]);
@@ -1262,6 +1511,7 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
                     break;
             }
             log_printf ("      value_size . . . . : %d",    ptr_item->value_size);
+            log_printf ("      hash . . . . . . . : %llu",  ptr_item->hash);
             log_printf ("      prev_item. . . . . : 0x%lx", ptr_item->prev_item);
             log_printf ("      next_item. . . . . : 0x%lx", ptr_item->next_item);
         }
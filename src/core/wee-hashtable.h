@@ -42,7 +42,12 @@ typedef void (t_hashtable_map_string)(void *data,
  * Hashtable is a structure with an array "htable", each entry is a pointer
  * to a linked list, and it is read with hashed key (as unsigned long long).
  * Keys with same hashed key are grouped in a linked list pointed by htable.
- * The htable is not sorted, the linked list is sorted.
+ * The htable is not sorted, the linked list is sorted by hash, then by key
+ * (the hash is stored in each item, so that keys are compared only if they
+ * have the same hash).
+ *
+ * When the number of items is greater than size * HASHTABLE_LOAD_FACTOR_MAX,
+ * the htable is doubled and all items are moved to their new linked list.
  *
  * Example of a hashtable with size 8 and 6 items added inside, items are:
  * "weechat", "fast", "light", "extensible", "chat", "client"
@@ -69,6 +74,9 @@ typedef void (t_hashtable_map_string)(void *data,
  * +-----+
  */
 
+#define HASHTABLE_LOAD_FACTOR_MAX 1   /* max average length of lists     */
+#define HASHTABLE_SIZE_MAX (1 << 24)  /* max size of htable (no growth)  */
+
 enum t_hashtable_type
 {
     HASHTABLE_INTEGER = 0,
@@ -86,16 +94,20 @@ struct t_hashtable_item
     int key_size;                       /* size of key (in bytes)           */
     void *value;                        /* pointer to value                 */
     int value_size;                     /* size of value (in bytes)         */
+    unsigned long long hash;            /* hash of key (not modulo size)    */
     struct t_hashtable_item *prev_item; /* link to previous item            */
     struct t_hashtable_item *next_item; /* link to next item                */
 };
 
 struct t_hashtable
 {
-    int size;                          /* hashtable size                    */
+    int size;                          /* hashtable size (grows when there  */
+                                       /* are too many items)               */
     struct t_hashtable_item **htable;  /* table to map hashes with linked   */
                                        /* lists                             */
     int items_count;                   /* number of items in hashtable      */
+    int map_running;                   /* > 0 if hashtable_map is running   */
+                                       /* (htable is not resized)           */
 
     /* type for keys and values */
     enum t_hashtable_type type_keys;   /* type for keys: int/str/pointer    */
@@ -113,6 +125,9 @@ struct t_hashtable
 };
 
 extern unsigned long long hashtable_hash_key_djb2 (const char *string);
+extern unsigned long long hashtable_hash_key_string_range (const char *string,
+                                                           int range);
+extern unsigned long long hashtable_hash_key_string (const char *string);
 extern struct t_hashtable *hashtable_new (int size,
                                           const char *type_keys,
                                           const char *type_values,
@@ -33,13 +33,18 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+#include <spawn.h>
 #include <poll.h>
 #include <signal.h>
 #include <fcntl.h>
 #include <errno.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 #include "weechat.h"
 #include "wee-hook.h"
+#include "wee-arraylist.h"
 #include "wee-config.h"
 #include "wee-hashtable.h"
 #include "wee-hdata.h"
@@ -71,18 +76,39 @@ struct t_hook *weechat_hooks[HOOK_NUM_TYPES];     /* list of hooks          */
 struct t_hook *last_weechat_hook[HOOK_NUM_TYPES]; /* last hook              */
 int hooks_count[HOOK_NUM_TYPES];                  /* number of hooks        */
 int hooks_count_total = 0;                        /* total number of hooks  */
+unsigned long long hook_last_order = 0;           /* order of last hook     */
+struct t_hook_index hook_index[HOOK_NUM_TYPES];   /* index of hooks by name */
+struct t_hook_print_index hook_print_index;       /* index of print hooks   */
 int hook_exec_recursion = 0;           /* 1 when a hook is executed         */
 time_t hook_last_system_time = 0;      /* used to detect system clock skew  */
 int real_delete_pending = 0;           /* 1 if some hooks must be deleted   */
 
+struct t_hook **hook_timer_heap = NULL; /* timers sorted by next execution */
+int hook_timer_heap_size = 0;           /* number of timers in heap         */
+int hook_timer_heap_size_alloc = 0;     /* allocated size for heap          */
+
 struct pollfd *hook_fd_pollfd = NULL;  /* file descriptors for poll()       */
 int hook_fd_pollfd_count = 0;          /* number of file descriptors        */
+struct t_hook **hook_fd_table = NULL;  /* fd hooks (indexed by fd)          */
+int hook_fd_table_size = 0;            /* size of table of fd hooks         */
+int hook_fd_backend = HOOK_FD_BACKEND_POLL; /* poll() or epoll              */
+int hook_fd_epoll = -1;                /* epoll instance (if epoll is used) */
+int hook_fd_always_ready_count = 0;     /* fd hooks not watched by epoll     */
+int hook_profile = 0;                  /* 1 if callbacks are profiled       */
+struct t_hashtable *hook_profile_removed = NULL; /* stats of removed hooks, */
+                                                 /* by owner (plugin/script)*/
 int hook_process_pending = 0;          /* 1 if there are some process to    */
-                                       /* run (via fork)                    */
-int hook_socketpair_ok = 0;            /* 1 if socketpair() is OK           */
+                                       /* run                               */
+
+extern char **environ;
 
 
 void hook_process_run (struct t_hook *hook_process);
+void hook_process_add_to_buffer (struct t_hook *hook_process, int index_buffer,
+                                 const char *buffer, int size);
+void hook_print_index_add (struct t_hook *hook);
+void hook_print_index_remove (struct t_hook *hook);
+void hook_print_index_free ();
 
 
 /*
@@ -92,7 +118,7 @@ void hook_process_run (struct t_hook *hook_process);
 void
 hook_init ()
 {
-    int type, sock[2], rc;
+    int type;
 
     /* initialize list of hooks */
     for (type = 0; type < HOOK_NUM_TYPES; type++)
@@ -100,45 +126,15 @@ hook_init ()
         weechat_hooks[type] = NULL;
         last_weechat_hook[type] = NULL;
         hooks_count[type] = 0;
+        hook_index[type].names = NULL;
+        hook_index[type].masks = NULL;
     }
+    hook_print_index.buffers = NULL;
+    hook_print_index.tags = NULL;
+    hook_print_index.others = NULL;
     hooks_count_total = 0;
+    hook_last_order = 0;
     hook_last_system_time = time (NULL);
-
-    /*
-     * Set a flag to 0 if socketpair() function is not available.
-     *
-     * For the connect hook, when this is defined an array of sockets will
-     * be passed from the parent process to the child process instead of using
-     * SCM_RIGHTS to pass a socket back from the child process to parent
-     * process.
-     *
-     * This allows connections to work on Windows but it limits the number of
-     * IPs that can be attempted each time.
-     */
-    hook_socketpair_ok = 1;
-
-#if defined(__CYGWIN__) || defined(__APPLE__) || defined(__MACH__)
-    hook_socketpair_ok = 0;
-    (void) sock;
-    (void) rc;
-#else
-    /*
-     * Test if socketpair() function is working fine: this is NOT the case
-     * on Windows with Ubuntu bash
-     * (errno == 94: ESOCKTNOSUPPORT: socket type not supported)
-     */
-    rc = socketpair (AF_LOCAL, SOCK_DGRAM, 0, sock);
-    if (rc < 0)
-    {
-        /* Windows/Ubuntu */
-        hook_socketpair_ok = 0;
-    }
-    else
-    {
-        close (sock[0]);
-        close (sock[1]);
-    }
-#endif
 }
 
 /*
@@ -200,6 +196,437 @@ hook_fd_realloc_pollfd ()
     hook_fd_pollfd_count = count;
 }
 
+/*
+ * Compares two hooks in an index: hooks are sorted like in the list of hooks,
+ * by priority (higher priority first), then by creation order.
+ *
+ * Returns:
+ *   < 0: hook1 is before hook2
+ *     0: hook1 == hook2
+ *   > 0: hook1 is after hook2
+ */
+
+int
+hook_index_cmp_cb (void *data, struct t_arraylist *arraylist,
+                   void *pointer1, void *pointer2)
+{
+    struct t_hook *hook1, *hook2;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    hook1 = (struct t_hook *)pointer1;
+    hook2 = (struct t_hook *)pointer2;
+
+    if (hook1->priority != hook2->priority)
+        return (hook1->priority > hook2->priority) ? -1 : 1;
+    if (hook1->order != hook2->order)
+        return (hook1->order < hook2->order) ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Hashes a name in an index (case is ignored, like in string_match).
+ *
+ * Returns the hash of the name.
+ */
+
+unsigned long long
+hook_index_hash_key_cb (struct t_hashtable *hashtable, const void *key)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return hashtable_hash_key_string_range ((const char *)key, 26);
+}
+
+/*
+ * Compares two names in an index (case is ignored, like in string_match).
+ *
+ * Only ASCII letters are case insensitive (like in function
+ * string_strcasecmp), so the names can be compared byte by byte.
+ */
+
+int
+hook_index_keycmp_cb (struct t_hashtable *hashtable,
+                      const void *key1, const void *key2)
+{
+    const unsigned char *ptr_key1, *ptr_key2;
+    int c1, c2;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    ptr_key1 = (const unsigned char *)key1;
+    ptr_key2 = (const unsigned char *)key2;
+
+    while (1)
+    {
+        c1 = ((ptr_key1[0] >= 'A') && (ptr_key1[0] <= 'Z')) ?
+            ptr_key1[0] + ('a' - 'A') : ptr_key1[0];
+        c2 = ((ptr_key2[0] >= 'A') && (ptr_key2[0] <= 'Z')) ?
+            ptr_key2[0] + ('a' - 'A') : ptr_key2[0];
+        if ((c1 != c2) || !c1)
+            return c1 - c2;
+        ptr_key1++;
+        ptr_key2++;
+    }
+}
+
+/*
+ * Frees a list of hooks in the hashtable of an index.
+ */
+
+void
+hook_index_free_value_cb (struct t_hashtable *hashtable,
+                          const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    arraylist_free ((struct t_arraylist *)value);
+}
+
+/*
+ * Adds a hook in the list of hooks stored with a key in a hashtable of an
+ * index (the list is created if needed).
+ */
+
+void
+hook_index_hashtable_add (struct t_hashtable *hashtable, const void *key,
+                          struct t_hook *hook)
+{
+    struct t_arraylist *list;
+
+    list = hashtable_get (hashtable, key);
+    if (!list)
+    {
+        list = arraylist_new (4, 1, 0,
+                              &hook_index_cmp_cb, NULL,
+                              NULL, NULL);
+        if (!list)
+            return;
+        if (!hashtable_set (hashtable, key, list))
+        {
+            arraylist_free (list);
+            return;
+        }
+    }
+    arraylist_add (list, hook);
+}
+
+/*
+ * Removes a hook from the list of hooks stored with a key in a hashtable of
+ * an index (the list is removed if it becomes empty).
+ */
+
+void
+hook_index_hashtable_remove (struct t_hashtable *hashtable, const void *key,
+                             struct t_hook *hook)
+{
+    struct t_arraylist *list;
+    int index;
+
+    list = (hashtable) ? hashtable_get (hashtable, key) : NULL;
+    if (!list)
+        return;
+
+    if (arraylist_search (list, hook, &index, NULL))
+        arraylist_remove (list, index);
+
+    if (arraylist_size (list) == 0)
+        hashtable_remove (hashtable, key);
+}
+
+/*
+ * Adds a hook in an array of hooks: if the array is full, it is enlarged
+ * (the array "hooks_static" is never freed, a new array is allocated
+ * instead).
+ *
+ * Returns the array of hooks (which can be different from "hooks").
+ */
+
+struct t_hook **
+hook_index_array_add (struct t_hook **hooks, struct t_hook **hooks_static,
+                      int *size, int *num_hooks, struct t_hook *hook)
+{
+    struct t_hook **new_hooks;
+
+    if (*num_hooks >= *size)
+    {
+        if (hooks == hooks_static)
+        {
+            new_hooks = malloc (*size * 2 * sizeof (*new_hooks));
+            if (new_hooks)
+                memcpy (new_hooks, hooks, *size * sizeof (*hooks));
+        }
+        else
+        {
+            new_hooks = realloc (hooks, *size * 2 * sizeof (*new_hooks));
+        }
+        if (!new_hooks)
+            return hooks;
+        hooks = new_hooks;
+        *size *= 2;
+    }
+    hooks[(*num_hooks)++] = hook;
+
+    return hooks;
+}
+
+/*
+ * Gets the name used to index a hook.
+ *
+ * Returns NULL if the hook type is not indexed.
+ */
+
+const char *
+hook_index_get_name (struct t_hook *hook)
+{
+    if (!hook->hook_data)
+        return NULL;
+
+    switch (hook->type)
+    {
+        case HOOK_TYPE_SIGNAL:
+            return HOOK_SIGNAL(hook, signal);
+        case HOOK_TYPE_HSIGNAL:
+            return HOOK_HSIGNAL(hook, signal);
+        case HOOK_TYPE_MODIFIER:
+            return HOOK_MODIFIER(hook, modifier);
+        default:
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Checks if a name is a mask: a name with a wildcard ("*") or an empty name
+ * (which is never matched).
+ *
+ * Modifier names are never masks (they are compared without wildcards).
+ *
+ * Returns:
+ *   1: name is a mask
+ *   0: name is an exact name
+ */
+
+int
+hook_index_is_mask (int type, const char *name)
+{
+    if (type == HOOK_TYPE_MODIFIER)
+        return 0;
+
+    return (!name[0] || strchr (name, '*')) ? 1 : 0;
+}
+
+/*
+ * Adds a hook in the index of its type (if the type is indexed).
+ */
+
+void
+hook_index_add (struct t_hook *hook)
+{
+    struct t_hook_index *ptr_index;
+    const char *name;
+
+    if (hook->type == HOOK_TYPE_PRINT)
+    {
+        hook_print_index_add (hook);
+        return;
+    }
+
+    name = hook_index_get_name (hook);
+    if (!name)
+        return;
+
+    ptr_index = &hook_index[hook->type];
+
+    if (hook_index_is_mask (hook->type, name))
+    {
+        if (!ptr_index->masks)
+        {
+            ptr_index->masks = arraylist_new (16, 1, 0,
+                                              &hook_index_cmp_cb, NULL,
+                                              NULL, NULL);
+            if (!ptr_index->masks)
+                return;
+        }
+        arraylist_add (ptr_index->masks, hook);
+    }
+    else
+    {
+        if (!ptr_index->names)
+        {
+            ptr_index->names = hashtable_new (128,
+                                              WEECHAT_HASHTABLE_STRING,
+                                              WEECHAT_HASHTABLE_POINTER,
+                                              &hook_index_hash_key_cb,
+                                              &hook_index_keycmp_cb);
+            if (!ptr_index->names)
+                return;
+            ptr_index->names->callback_free_value = &hook_index_free_value_cb;
+        }
+        hook_index_hashtable_add (ptr_index->names, name, hook);
+    }
+}
+
+/*
+ * Removes a hook from the index of its type (if the type is indexed).
+ *
+ * This function must be called before the hook specific data is freed.
+ */
+
+void
+hook_index_remove (struct t_hook *hook)
+{
+    struct t_hook_index *ptr_index;
+    const char *name;
+    int index;
+
+    if (hook->type == HOOK_TYPE_PRINT)
+    {
+        hook_print_index_remove (hook);
+        return;
+    }
+
+    name = hook_index_get_name (hook);
+    if (!name)
+        return;
+
+    ptr_index = &hook_index[hook->type];
+
+    if (hook_index_is_mask (hook->type, name))
+    {
+        if (arraylist_search (ptr_index->masks, hook, &index, NULL))
+            arraylist_remove (ptr_index->masks, index);
+    }
+    else
+    {
+        hook_index_hashtable_remove (ptr_index->names, name, hook);
+    }
+}
+
+/*
+ * Frees all indexes.
+ */
+
+void
+hook_index_free_all ()
+{
+    int type;
+
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        if (hook_index[type].names)
+        {
+            hashtable_free (hook_index[type].names);
+            hook_index[type].names = NULL;
+        }
+        if (hook_index[type].masks)
+        {
+            arraylist_free (hook_index[type].masks);
+            hook_index[type].masks = NULL;
+        }
+    }
+
+    hook_print_index_free ();
+}
+
+/*
+ * Gets next hook with a mask matching name in index, starting at *index_mask
+ * (which is updated).
+ *
+ * Returns pointer to hook found, NULL if no more hook matches.
+ */
+
+struct t_hook *
+hook_index_next_mask (struct t_hook_index *ptr_index, const char *name,
+                      int *index_mask)
+{
+    struct t_hook *ptr_hook;
+    int size;
+
+    size = arraylist_size (ptr_index->masks);
+    while (*index_mask < size)
+    {
+        ptr_hook = (struct t_hook *)arraylist_get (ptr_index->masks,
+                                                   *index_mask);
+        (*index_mask)++;
+        if (string_match (name, hook_index_get_name (ptr_hook), 0))
+            return ptr_hook;
+    }
+
+    return NULL;
+}
+
+/*
+ * Gets all hooks of a type matching a name, sorted like in the list of hooks:
+ * hooks with this exact name are merged with hooks having a matching mask.
+ *
+ * The array "hooks_static" (with "size_static" elements) is used if it is big
+ * enough to store all the hooks, otherwise a new array is allocated and must
+ * be freed by the caller if it is different from "hooks_static".
+ *
+ * Hooks returned can be marked as deleted during the execution of callbacks,
+ * but they are not freed before the end of the hook exec.
+ *
+ * Returns the array of hooks, the number of hooks is put in *num_hooks.
+ */
+
+struct t_hook **
+hook_index_get (int type, const char *name,
+                struct t_hook **hooks_static, int size_static,
+                int *num_hooks)
+{
+    struct t_hook_index *ptr_index;
+    struct t_arraylist *list;
+    struct t_hook **hooks, *ptr_hook, *ptr_hook_mask;
+    int size, size_list, index_list, index_mask;
+
+    hooks = hooks_static;
+    size = size_static;
+    *num_hooks = 0;
+
+    if (!name)
+        return hooks;
+
+    ptr_index = &hook_index[type];
+
+    list = (ptr_index->names) ? hashtable_get (ptr_index->names, name) : NULL;
+    size_list = arraylist_size (list);
+    index_list = 0;
+    index_mask = 0;
+    ptr_hook_mask = hook_index_next_mask (ptr_index, name, &index_mask);
+
+    while ((index_list < size_list) || ptr_hook_mask)
+    {
+        ptr_hook = (index_list < size_list) ?
+            (struct t_hook *)arraylist_get (list, index_list) : NULL;
+        if (ptr_hook
+            && (!ptr_hook_mask
+                || (hook_index_cmp_cb (NULL, NULL,
+                                       ptr_hook, ptr_hook_mask) < 0)))
+        {
+            index_list++;
+        }
+        else
+        {
+            ptr_hook = ptr_hook_mask;
+            ptr_hook_mask = hook_index_next_mask (ptr_index, name,
+                                                  &index_mask);
+        }
+
+        hooks = hook_index_array_add (hooks, hooks_static, &size, num_hooks,
+                                      ptr_hook);
+    }
+
+    return hooks;
+}
+
 /*
  * Searches for position of hook in list (to keep hooks sorted).
  *
@@ -288,6 +715,8 @@ hook_add_to_list (struct t_hook *new_hook)
     hooks_count[new_hook->type]++;
     hooks_count_total++;
 
+    hook_index_add (new_hook);
+
     if (new_hook->type == HOOK_TYPE_FD)
         hook_fd_realloc_pollfd ();
 }
@@ -414,8 +843,12 @@ hook_init_data (struct t_hook *hook, struct t_weechat_plugin *plugin,
     hook->deleted = 0;
     hook->running = 0;
     hook->priority = priority;
+    hook->order = ++hook_last_order;
     hook->callback_pointer = callback_pointer;
     hook->callback_data = callback_data;
+    hook->stats.calls = 0;
+    hook->stats.time_total = 0;
+    hook->stats.time_max = 0;
     hook->hook_data = NULL;
 
     if (weechat_debug_core >= 2)
@@ -486,15 +919,341 @@ hook_exec_end ()
 }
 
 /*
- * Searches for a command hook in list.
+ * Starts execution of a hook callback: the hook is protected against real
+ * deletion until the end of callback, and the start time is saved if
+ * profiling is enabled.
+ */
+
+void
+hook_callback_start (struct t_hook *hook, struct t_hook_exec_cb *hook_exec_cb)
+{
+    hook_exec_start ();
+
+    hook_exec_cb->profile = (hook_profile && hook) ? 1 : 0;
+    if (hook_exec_cb->profile)
+        gettimeofday (&hook_exec_cb->start_time, NULL);
+}
+
+/*
+ * Ends execution of a hook callback: updates execution statistics of hook
+ * if profiling is enabled.
  *
- * Returns pointer to hook found, NULL if not found.
+ * Note: if the hook has been removed by its own callback, its statistics
+ * have already been saved and this last call is not counted.
  */
 
-struct t_hook *
-hook_search_command (struct t_weechat_plugin *plugin, const char *command)
+void
+hook_callback_end (struct t_hook *hook, struct t_hook_exec_cb *hook_exec_cb)
 {
-    struct t_hook *ptr_hook;
+    struct timeval end_time;
+    long long time_diff;
+
+    if (hook_exec_cb->profile && !hook->deleted)
+    {
+        gettimeofday (&end_time, NULL);
+        time_diff = util_timeval_diff (&hook_exec_cb->start_time, &end_time);
+        if (time_diff < 0)
+            time_diff = 0;
+        hook->stats.calls++;
+        hook->stats.time_total += time_diff;
+        if (time_diff > hook->stats.time_max)
+            hook->stats.time_max = time_diff;
+    }
+
+    hook_exec_end ();
+}
+
+/*
+ * Builds owner of a hook: "core", plugin name or "plugin/script" for a hook
+ * created by a script.
+ */
+
+void
+hook_get_owner (struct t_hook *hook, char *owner, int size)
+{
+    if (hook->subplugin && hook->subplugin[0])
+    {
+        snprintf (owner, size, "%s/%s",
+                  plugin_get_name (hook->plugin), hook->subplugin);
+    }
+    else
+    {
+        snprintf (owner, size, "%s", plugin_get_name (hook->plugin));
+    }
+}
+
+/*
+ * Returns a short description of a hook (command, signal, interval, ...).
+ *
+ * Note: result is a static string, it must be copied if needed after another
+ * call to this function.
+ */
+
+const char *
+hook_get_description (struct t_hook *hook)
+{
+    static char description[1024];
+    const char *ptr_string;
+
+    description[0] = '\0';
+
+    if (!hook || !hook->hook_data)
+        return description;
+
+    ptr_string = NULL;
+
+    switch (hook->type)
+    {
+        case HOOK_TYPE_COMMAND:
+            ptr_string = HOOK_COMMAND(hook, command);
+            break;
+        case HOOK_TYPE_COMMAND_RUN:
+            ptr_string = HOOK_COMMAND_RUN(hook, command);
+            break;
+        case HOOK_TYPE_TIMER:
+            snprintf (description, sizeof (description),
+                      "%ld ms", HOOK_TIMER(hook, interval));
+            break;
+        case HOOK_TYPE_FD:
+            snprintf (description, sizeof (description),
+                      "fd %d", HOOK_FD(hook, fd));
+            break;
+        case HOOK_TYPE_PROCESS:
+            ptr_string = HOOK_PROCESS(hook, command);
+            break;
+        case HOOK_TYPE_CONNECT:
+            snprintf (description, sizeof (description),
+                      "%s/%d",
+                      HOOK_CONNECT(hook, address),
+                      HOOK_CONNECT(hook, port));
+            break;
+        case HOOK_TYPE_PRINT:
+            ptr_string = HOOK_PRINT(hook, message);
+            break;
+        case HOOK_TYPE_SIGNAL:
+            ptr_string = HOOK_SIGNAL(hook, signal);
+            break;
+        case HOOK_TYPE_HSIGNAL:
+            ptr_string = HOOK_HSIGNAL(hook, signal);
+            break;
+        case HOOK_TYPE_CONFIG:
+            ptr_string = HOOK_CONFIG(hook, option);
+            break;
+        case HOOK_TYPE_COMPLETION:
+            ptr_string = HOOK_COMPLETION(hook, completion_item);
+            break;
+        case HOOK_TYPE_MODIFIER:
+            ptr_string = HOOK_MODIFIER(hook, modifier);
+            break;
+        case HOOK_TYPE_INFO:
+            ptr_string = HOOK_INFO(hook, info_name);
+            break;
+        case HOOK_TYPE_INFO_HASHTABLE:
+            ptr_string = HOOK_INFO_HASHTABLE(hook, info_name);
+            break;
+        case HOOK_TYPE_INFOLIST:
+            ptr_string = HOOK_INFOLIST(hook, infolist_name);
+            break;
+        case HOOK_TYPE_HDATA:
+            ptr_string = HOOK_HDATA(hook, hdata_name);
+            break;
+        case HOOK_TYPE_FOCUS:
+            ptr_string = HOOK_FOCUS(hook, area);
+            break;
+        case HOOK_NUM_TYPES:
+            /*
+             * this constant is used to count types only,
+             * it is never used as type
+             */
+            break;
+    }
+
+    if (ptr_string)
+        snprintf (description, sizeof (description), "%s", ptr_string);
+
+    return description;
+}
+
+/*
+ * Adds execution statistics to other statistics.
+ */
+
+void
+hook_stats_add (struct t_hook_stats *stats, struct t_hook_stats *stats_add)
+{
+    stats->calls += stats_add->calls;
+    stats->time_total += stats_add->time_total;
+    if (stats_add->time_max > stats->time_max)
+        stats->time_max = stats_add->time_max;
+}
+
+/*
+ * Compares execution statistics using a sort key (HOOK_STATS_SORT_XXX).
+ *
+ * Returns:
+ *   < 0: stats1 < stats2
+ *     0: stats1 == stats2
+ *   > 0: stats1 > stats2
+ */
+
+int
+hook_stats_cmp (struct t_hook_stats *stats1, struct t_hook_stats *stats2,
+                int sort)
+{
+    switch (sort)
+    {
+        case HOOK_STATS_SORT_CALLS:
+            if (stats1->calls != stats2->calls)
+                return (stats1->calls < stats2->calls) ? -1 : 1;
+            break;
+        case HOOK_STATS_SORT_MAX:
+            if (stats1->time_max != stats2->time_max)
+                return (stats1->time_max < stats2->time_max) ? -1 : 1;
+            break;
+    }
+
+    if (stats1->time_total != stats2->time_total)
+        return (stats1->time_total < stats2->time_total) ? -1 : 1;
+
+    return 0;
+}
+
+/*
+ * Adds statistics of a hook to a hashtable with statistics by owner
+ * (key: owner, value: struct t_hook_stats).
+ */
+
+void
+hook_profile_add_to_owners (struct t_hashtable *hashtable,
+                            struct t_hook *hook)
+{
+    struct t_hook_stats *ptr_stats;
+    char owner[512];
+
+    if (!hashtable || (hook->stats.calls == 0))
+        return;
+
+    hook_get_owner (hook, owner, sizeof (owner));
+
+    ptr_stats = hashtable_get (hashtable, owner);
+    if (ptr_stats)
+        hook_stats_add (ptr_stats, &hook->stats);
+    else
+    {
+        hashtable_set_with_size (hashtable, owner, 0,
+                                 &hook->stats, sizeof (hook->stats));
+    }
+}
+
+/*
+ * Enables or disables profiling of hook callbacks.
+ */
+
+void
+hook_profile_set (int enable)
+{
+    hook_profile = (enable) ? 1 : 0;
+
+    if (hook_profile && !hook_profile_removed)
+    {
+        hook_profile_removed = hashtable_new (32,
+                                              WEECHAT_HASHTABLE_STRING,
+                                              WEECHAT_HASHTABLE_BUFFER,
+                                              NULL, NULL);
+    }
+}
+
+/*
+ * Resets execution statistics of all hooks.
+ */
+
+void
+hook_profile_reset ()
+{
+    int type;
+    struct t_hook *ptr_hook;
+
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            ptr_hook->stats.calls = 0;
+            ptr_hook->stats.time_total = 0;
+            ptr_hook->stats.time_max = 0;
+        }
+    }
+
+    if (hook_profile_removed)
+        hashtable_remove_all (hook_profile_removed);
+}
+
+/*
+ * Copies statistics of an owner in another hashtable (callback called for
+ * each owner in hashtable).
+ */
+
+void
+hook_profile_copy_map_cb (void *data, struct t_hashtable *hashtable,
+                          const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    hashtable_set_with_size ((struct t_hashtable *)data, key, 0,
+                             value, sizeof (struct t_hook_stats));
+}
+
+/*
+ * Returns execution statistics by owner (see function hook_get_owner), for
+ * hooks still in memory and hooks already removed.
+ *
+ * Note: result must be freed after use with function hashtable_free().
+ */
+
+struct t_hashtable *
+hook_profile_get_owners ()
+{
+    struct t_hashtable *owners;
+    struct t_hook *ptr_hook;
+    int type;
+
+    owners = hashtable_new (32,
+                            WEECHAT_HASHTABLE_STRING,
+                            WEECHAT_HASHTABLE_BUFFER,
+                            NULL, NULL);
+    if (!owners)
+        return NULL;
+
+    if (hook_profile_removed)
+    {
+        hashtable_map (hook_profile_removed,
+                       &hook_profile_copy_map_cb, owners);
+    }
+
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted)
+                hook_profile_add_to_owners (owners, ptr_hook);
+        }
+    }
+
+    return owners;
+}
+
+/*
+ * Searches for a command hook in list.
+ *
+ * Returns pointer to hook found, NULL if not found.
+ */
+
+struct t_hook *
+hook_search_command (struct t_weechat_plugin *plugin, const char *command)
+{
+    struct t_hook *ptr_hook;
 
     for (ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND]; ptr_hook;
          ptr_hook = ptr_hook->next_hook)
@@ -778,6 +1537,7 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
     const char *ptr_command_name;
     int argc, rc, length_command_name, allow_incomplete_commands;
     int count_other_plugin, count_incomplete_commands;
+    struct t_hook_exec_cb hook_exec_cb;
 
     if (!buffer || !string || !string[0])
         return HOOK_COMMAND_EXEC_NOT_FOUND;
@@ -903,6 +1663,7 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
         {
             /* execute the command! */
             ptr_hook->running++;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             rc = (int) (HOOK_COMMAND(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
@@ -910,6 +1671,7 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
                  argc,
                  argv,
                  argv_eol);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running--;
             if (rc == WEECHAT_RC_ERROR)
                 rc = HOOK_COMMAND_EXEC_ERROR;
@@ -982,6 +1744,7 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
     int rc, hook_matching, length;
     char *command2;
     const char *ptr_command;
+    struct t_hook_exec_cb hook_exec_cb;
 
     ptr_command = command;
     command2 = NULL;
@@ -1021,11 +1784,13 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
             if (hook_matching)
             {
                 ptr_hook->running = 1;
+                hook_callback_start (ptr_hook, &hook_exec_cb);
                 rc = (HOOK_COMMAND_RUN(ptr_hook, callback)) (
                     ptr_hook->callback_pointer,
                     ptr_hook->callback_data,
                     buffer,
                     ptr_command);
+                hook_callback_end (ptr_hook, &hook_exec_cb);
                 ptr_hook->running = 0;
                 if (rc == WEECHAT_RC_OK_EAT)
                 {
@@ -1046,78 +1811,269 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
 }
 
 /*
- * Initializes a timer hook.
+ * Compares two timers in the heap of timers: by date of next execution, then
+ * by priority (highest first) and creation order.
+ *
+ * Returns:
+ *   < 0: timer1 must be executed before timer2
+ *     0: timer1 == timer2
+ *   > 0: timer1 must be executed after timer2
  */
 
-void
-hook_timer_init (struct t_hook *hook)
+int
+hook_timer_heap_cmp (struct t_hook *hook1, struct t_hook *hook2)
 {
-    time_t time_now;
-    struct tm *local_time, *gm_time;
-    int local_hour, gm_hour, diff_hour;
+    int rc;
 
-    gettimeofday (&HOOK_TIMER(hook, last_exec), NULL);
-    time_now = time (NULL);
-    local_time = localtime(&time_now);
-    local_hour = local_time->tm_hour;
-    gm_time = gmtime(&time_now);
-    gm_hour = gm_time->tm_hour;
-    if ((local_time->tm_year > gm_time->tm_year)
-        || (local_time->tm_mon > gm_time->tm_mon)
-        || (local_time->tm_mday > gm_time->tm_mday))
-    {
-        diff_hour = (24 - gm_hour) + local_hour;
-    }
-    else if ((gm_time->tm_year > local_time->tm_year)
-             || (gm_time->tm_mon > local_time->tm_mon)
-             || (gm_time->tm_mday > local_time->tm_mday))
-    {
-        diff_hour = (-1) * ((24 - local_hour) + gm_hour);
-    }
-    else
-        diff_hour = local_hour - gm_hour;
+    rc = util_timeval_cmp (&HOOK_TIMER(hook1, next_exec),
+                           &HOOK_TIMER(hook2, next_exec));
+    if (rc != 0)
+        return rc;
+    if (hook1->priority != hook2->priority)
+        return (hook1->priority > hook2->priority) ? -1 : 1;
+    if (hook1->order != hook2->order)
+        return (hook1->order < hook2->order) ? -1 : 1;
+    return 0;
+}
 
-    if ((HOOK_TIMER(hook, interval) >= 1000)
-        && (HOOK_TIMER(hook, align_second) > 0))
-    {
-        /*
-         * here we should use 0, but with this value timer is sometimes called
-         * before second has changed, so for displaying time, it may display
-         * 2 times the same second, that's why we use 10000 micro seconds
-         */
-        HOOK_TIMER(hook, last_exec).tv_usec = 10000;
-        HOOK_TIMER(hook, last_exec).tv_sec =
-            HOOK_TIMER(hook, last_exec).tv_sec -
-            ((HOOK_TIMER(hook, last_exec).tv_sec + (diff_hour * 3600)) %
-             HOOK_TIMER(hook, align_second));
-    }
+/*
+ * Swaps two timers in the heap of timers.
+ */
 
-    /* init next call with date of last call */
-    HOOK_TIMER(hook, next_exec).tv_sec = HOOK_TIMER(hook, last_exec).tv_sec;
-    HOOK_TIMER(hook, next_exec).tv_usec = HOOK_TIMER(hook, last_exec).tv_usec;
+void
+hook_timer_heap_swap (int index1, int index2)
+{
+    struct t_hook *ptr_hook;
 
-    /* add interval to next call date */
-    util_timeval_add (&HOOK_TIMER(hook, next_exec),
-                      ((long long)HOOK_TIMER(hook, interval)) * 1000);
+    ptr_hook = hook_timer_heap[index1];
+    hook_timer_heap[index1] = hook_timer_heap[index2];
+    hook_timer_heap[index2] = ptr_hook;
+    HOOK_TIMER(hook_timer_heap[index1], heap_index) = index1;
+    HOOK_TIMER(hook_timer_heap[index2], heap_index) = index2;
 }
 
 /*
- * Hooks a timer.
- *
- * Returns pointer to new hook, NULL if error.
+ * Moves a timer up in the heap of timers (toward the root), until the heap
+ * is valid.
  */
 
-struct t_hook *
-hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
-            int max_calls, t_hook_callback_timer *callback,
-            const void *callback_pointer,
-            void *callback_data)
+void
+hook_timer_heap_up (int index)
 {
-    struct t_hook *new_hook;
-    struct t_hook_timer *new_hook_timer;
+    int parent;
 
-    if ((interval <= 0) || !callback)
-        return NULL;
+    while (index > 0)
+    {
+        parent = (index - 1) / 2;
+        if (hook_timer_heap_cmp (hook_timer_heap[index],
+                                 hook_timer_heap[parent]) >= 0)
+            break;
+        hook_timer_heap_swap (index, parent);
+        index = parent;
+    }
+}
+
+/*
+ * Moves a timer down in the heap of timers (toward the leaves), until the
+ * heap is valid.
+ */
+
+void
+hook_timer_heap_down (int index)
+{
+    int child, smallest;
+
+    while (1)
+    {
+        smallest = index;
+        child = (2 * index) + 1;
+        if ((child < hook_timer_heap_size)
+            && (hook_timer_heap_cmp (hook_timer_heap[child],
+                                     hook_timer_heap[smallest]) < 0))
+        {
+            smallest = child;
+        }
+        child++;
+        if ((child < hook_timer_heap_size)
+            && (hook_timer_heap_cmp (hook_timer_heap[child],
+                                     hook_timer_heap[smallest]) < 0))
+        {
+            smallest = child;
+        }
+        if (smallest == index)
+            break;
+        hook_timer_heap_swap (index, smallest);
+        index = smallest;
+    }
+}
+
+/*
+ * Adds a timer in the heap of timers.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hook_timer_heap_add (struct t_hook *hook)
+{
+    struct t_hook **new_heap;
+    int new_size_alloc;
+
+    if (hook_timer_heap_size >= hook_timer_heap_size_alloc)
+    {
+        new_size_alloc = (hook_timer_heap_size_alloc < 16) ?
+            16 : hook_timer_heap_size_alloc * 2;
+        new_heap = realloc (hook_timer_heap,
+                            new_size_alloc * sizeof (*new_heap));
+        if (!new_heap)
+            return 0;
+        hook_timer_heap = new_heap;
+        hook_timer_heap_size_alloc = new_size_alloc;
+    }
+
+    hook_timer_heap[hook_timer_heap_size] = hook;
+    HOOK_TIMER(hook, heap_index) = hook_timer_heap_size;
+    hook_timer_heap_size++;
+    hook_timer_heap_up (hook_timer_heap_size - 1);
+
+    return 1;
+}
+
+/*
+ * Removes a timer from the heap of timers (does nothing if the timer is not
+ * in the heap).
+ */
+
+void
+hook_timer_heap_remove (struct t_hook *hook)
+{
+    int index;
+
+    index = HOOK_TIMER(hook, heap_index);
+    if ((index < 0) || (index >= hook_timer_heap_size)
+        || (hook_timer_heap[index] != hook))
+    {
+        return;
+    }
+
+    HOOK_TIMER(hook, heap_index) = -1;
+    hook_timer_heap_size--;
+    if (index < hook_timer_heap_size)
+    {
+        hook_timer_heap[index] = hook_timer_heap[hook_timer_heap_size];
+        HOOK_TIMER(hook_timer_heap[index], heap_index) = index;
+        hook_timer_heap_up (index);
+        hook_timer_heap_down (HOOK_TIMER(hook_timer_heap[index], heap_index));
+    }
+}
+
+/*
+ * Rebuilds the heap of timers (called when the date of next execution has
+ * changed for many timers).
+ */
+
+void
+hook_timer_heap_rebuild ()
+{
+    int i;
+
+    for (i = (hook_timer_heap_size / 2) - 1; i >= 0; i--)
+    {
+        hook_timer_heap_down (i);
+    }
+}
+
+/*
+ * Frees the heap of timers.
+ */
+
+void
+hook_timer_heap_free ()
+{
+    if (hook_timer_heap)
+    {
+        free (hook_timer_heap);
+        hook_timer_heap = NULL;
+    }
+    hook_timer_heap_size = 0;
+    hook_timer_heap_size_alloc = 0;
+}
+
+/*
+ * Initializes a timer hook.
+ */
+
+void
+hook_timer_init (struct t_hook *hook)
+{
+    time_t time_now;
+    struct tm *local_time, *gm_time;
+    int local_hour, gm_hour, diff_hour;
+
+    gettimeofday (&HOOK_TIMER(hook, last_exec), NULL);
+    time_now = time (NULL);
+    local_time = localtime(&time_now);
+    local_hour = local_time->tm_hour;
+    gm_time = gmtime(&time_now);
+    gm_hour = gm_time->tm_hour;
+    if ((local_time->tm_year > gm_time->tm_year)
+        || (local_time->tm_mon > gm_time->tm_mon)
+        || (local_time->tm_mday > gm_time->tm_mday))
+    {
+        diff_hour = (24 - gm_hour) + local_hour;
+    }
+    else if ((gm_time->tm_year > local_time->tm_year)
+             || (gm_time->tm_mon > local_time->tm_mon)
+             || (gm_time->tm_mday > local_time->tm_mday))
+    {
+        diff_hour = (-1) * ((24 - local_hour) + gm_hour);
+    }
+    else
+        diff_hour = local_hour - gm_hour;
+
+    if ((HOOK_TIMER(hook, interval) >= 1000)
+        && (HOOK_TIMER(hook, align_second) > 0))
+    {
+        /*
+         * here we should use 0, but with this value timer is sometimes called
+         * before second has changed, so for displaying time, it may display
+         * 2 times the same second, that's why we use 10000 micro seconds
+         */
+        HOOK_TIMER(hook, last_exec).tv_usec = 10000;
+        HOOK_TIMER(hook, last_exec).tv_sec =
+            HOOK_TIMER(hook, last_exec).tv_sec -
+            ((HOOK_TIMER(hook, last_exec).tv_sec + (diff_hour * 3600)) %
+             HOOK_TIMER(hook, align_second));
+    }
+
+    /* init next call with date of last call */
+    HOOK_TIMER(hook, next_exec).tv_sec = HOOK_TIMER(hook, last_exec).tv_sec;
+    HOOK_TIMER(hook, next_exec).tv_usec = HOOK_TIMER(hook, last_exec).tv_usec;
+
+    /* add interval to next call date */
+    util_timeval_add (&HOOK_TIMER(hook, next_exec),
+                      ((long long)HOOK_TIMER(hook, interval)) * 1000);
+}
+
+/*
+ * Hooks a timer.
+ *
+ * Returns pointer to new hook, NULL if error.
+ */
+
+struct t_hook *
+hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
+            int max_calls, t_hook_callback_timer *callback,
+            const void *callback_pointer,
+            void *callback_data)
+{
+    struct t_hook *new_hook;
+    struct t_hook_timer *new_hook_timer;
+
+    if ((interval <= 0) || !callback)
+        return NULL;
 
     new_hook = malloc (sizeof (*new_hook));
     if (!new_hook)
@@ -1137,9 +2093,17 @@ hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
     new_hook_timer->interval = interval;
     new_hook_timer->align_second = align_second;
     new_hook_timer->remaining_calls = max_calls;
+    new_hook_timer->heap_index = -1;
 
     hook_timer_init (new_hook);
 
+    if (!hook_timer_heap_add (new_hook))
+    {
+        free (new_hook_timer);
+        free (new_hook);
+        return NULL;
+    }
+
     hook_add_to_list (new_hook);
 
     return new_hook;
@@ -1182,6 +2146,7 @@ hook_timer_check_system_clock ()
             if (!ptr_hook->deleted)
                 hook_timer_init (ptr_hook);
         }
+        hook_timer_heap_rebuild ();
     }
 
     hook_last_system_time = now;
@@ -1194,39 +2159,24 @@ hook_timer_check_system_clock ()
 int
 hook_timer_get_time_to_next ()
 {
-    struct t_hook *ptr_hook;
-    int found, timeout;
+    int timeout;
     struct timeval tv_now, tv_timeout;
     long diff_usec;
 
     hook_timer_check_system_clock ();
 
-    found = 0;
-    tv_timeout.tv_sec = 0;
-    tv_timeout.tv_usec = 0;
-
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_TIMER]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
-    {
-        if (!ptr_hook->deleted
-            && (!found
-                || (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                      &tv_timeout) < 0)))
-        {
-            found = 1;
-            tv_timeout.tv_sec = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
-            tv_timeout.tv_usec = HOOK_TIMER(ptr_hook, next_exec).tv_usec;
-        }
-    }
-
     /* no timeout found, return 2 seconds by default */
-    if (!found)
+    if (hook_timer_heap_size == 0)
     {
         tv_timeout.tv_sec = 2;
         tv_timeout.tv_usec = 0;
         goto end;
     }
 
+    /* first timer in heap is the next one to execute */
+    tv_timeout.tv_sec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_sec;
+    tv_timeout.tv_usec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_usec;
+
     gettimeofday (&tv_now, NULL);
 
     /* next timeout is past date! */
@@ -1267,36 +2217,78 @@ end:
 
 /*
  * Executes timer hooks.
+ *
+ * Timers to execute are first removed from the heap of timers, then each
+ * timer is executed (at most once) and added again in the heap (with its new
+ * date of next execution) if it has not been deleted by a callback.
  */
 
 void
 hook_timer_exec ()
 {
     struct timeval tv_time;
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook *hooks_static[HOOK_TIMER_STATIC_SIZE], **hooks, **new_hooks;
+    struct t_hook *ptr_hook;
+    int i, num_hooks, size;
+    struct t_hook_exec_cb hook_exec_cb;
 
     hook_timer_check_system_clock ();
 
     gettimeofday (&tv_time, NULL);
 
+    /* remove from heap all timers to execute now */
+    hooks = hooks_static;
+    size = HOOK_TIMER_STATIC_SIZE;
+    num_hooks = 0;
+    while ((hook_timer_heap_size > 0)
+           && (util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[0], next_exec),
+                                 &tv_time) <= 0))
+    {
+        if (num_hooks >= size)
+        {
+            if (hooks == hooks_static)
+            {
+                new_hooks = malloc (size * 2 * sizeof (*new_hooks));
+                if (new_hooks)
+                    memcpy (new_hooks, hooks, size * sizeof (*hooks));
+            }
+            else
+            {
+                new_hooks = realloc (hooks, size * 2 * sizeof (*new_hooks));
+            }
+            if (!new_hooks)
+                break;
+            hooks = new_hooks;
+            size *= 2;
+        }
+        ptr_hook = hook_timer_heap[0];
+        hook_timer_heap_remove (ptr_hook);
+        hooks[num_hooks++] = ptr_hook;
+    }
+
+    if (num_hooks == 0)
+        return;
+
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_TIMER];
-    while (ptr_hook)
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                  &tv_time) <= 0))
+        /* timer deleted by a previous callback */
+        if (ptr_hook->deleted)
+            continue;
+
+        if (!ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             (void) (HOOK_TIMER(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  (HOOK_TIMER(ptr_hook, remaining_calls) > 0) ?
                   HOOK_TIMER(ptr_hook, remaining_calls) - 1 : -1);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
             if (!ptr_hook->deleted)
             {
@@ -1316,12 +2308,57 @@ hook_timer_exec ()
             }
         }
 
-        ptr_hook = next_hook;
+        /* add timer again in heap, with its new date of next execution */
+        if (!ptr_hook->deleted)
+            hook_timer_heap_add (ptr_hook);
     }
 
+    if (hooks != hooks_static)
+        free (hooks);
+
     hook_exec_end ();
 }
 
+/*
+ * Sets the hook for a file descriptor in the table of fd hooks (indexed by
+ * file descriptor); hook can be NULL to remove the file descriptor.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hook_fd_table_set (int fd, struct t_hook *hook)
+{
+    struct t_hook **new_table;
+    int i, new_size;
+
+    if (fd >= hook_fd_table_size)
+    {
+        if (!hook)
+            return 1;
+        new_size = (hook_fd_table_size < 64) ? 64 : hook_fd_table_size;
+        while (new_size <= fd)
+        {
+            new_size *= 2;
+        }
+        new_table = realloc (hook_fd_table, new_size * sizeof (*new_table));
+        if (!new_table)
+            return 0;
+        for (i = hook_fd_table_size; i < new_size; i++)
+        {
+            new_table[i] = NULL;
+        }
+        hook_fd_table = new_table;
+        hook_fd_table_size = new_size;
+    }
+
+    hook_fd_table[fd] = hook;
+
+    return 1;
+}
+
 /*
  * Searches for a fd hook in list.
  *
@@ -1331,17 +2368,185 @@ hook_timer_exec ()
 struct t_hook *
 hook_search_fd (int fd)
 {
-    struct t_hook *ptr_hook;
+    if ((fd < 0) || (fd >= hook_fd_table_size))
+        return NULL;
 
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    /* deleted hooks are removed from the table by unhook */
+    return hook_fd_table[fd];
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Converts flags of a fd hook to epoll events.
+ */
+
+uint32_t
+hook_fd_epoll_flags_to_events (int flags)
+{
+    uint32_t events;
+
+    events = 0;
+    if (flags & HOOK_FD_FLAG_READ)
+        events |= EPOLLIN;
+    if (flags & HOOK_FD_FLAG_WRITE)
+        events |= EPOLLOUT;
+    if (flags & HOOK_FD_FLAG_EXCEPTION)
+        events |= EPOLLPRI;
+
+    return events;
+}
+
+/*
+ * Converts epoll events received to flags of a fd hook.
+ *
+ * An error or hang up on the file descriptor (EPOLLERR/EPOLLHUP, always
+ * reported by epoll) sets all flags, so that the callback is called and can
+ * remove the hook.
+ */
+
+int
+hook_fd_epoll_events_to_flags (uint32_t events)
+{
+    int flags;
+
+    if (events & (EPOLLERR | EPOLLHUP))
     {
-        if (!ptr_hook->deleted && (HOOK_FD(ptr_hook, fd) == fd))
-            return ptr_hook;
+        return HOOK_FD_FLAG_READ | HOOK_FD_FLAG_WRITE
+            | HOOK_FD_FLAG_EXCEPTION;
     }
 
-    /* fd hook not found */
-    return NULL;
+    flags = 0;
+    if (events & EPOLLIN)
+        flags |= HOOK_FD_FLAG_READ;
+    if (events & EPOLLOUT)
+        flags |= HOOK_FD_FLAG_WRITE;
+    if (events & EPOLLPRI)
+        flags |= HOOK_FD_FLAG_EXCEPTION;
+
+    return flags;
+}
+
+/*
+ * Adds a fd hook in the epoll instance (operation EPOLL_CTL_ADD) or updates
+ * the events watched (operation EPOLL_CTL_MOD).
+ *
+ * If the fd can not be watched with epoll (like a regular file), the hook is
+ * marked as always ready.
+ */
+
+void
+hook_fd_epoll_ctl (struct t_hook *hook, int operation)
+{
+    struct epoll_event event;
+
+    /* fd not in epoll instance: flags are used directly in hook_fd_exec */
+    if (HOOK_FD(hook, always_ready))
+        return;
+
+    memset (&event, 0, sizeof (event));
+    event.events = hook_fd_epoll_flags_to_events (HOOK_FD(hook, flags));
+    event.data.fd = HOOK_FD(hook, fd);
+
+    if (epoll_ctl (hook_fd_epoll, operation, HOOK_FD(hook, fd), &event) < 0)
+    {
+        if (errno == EPERM)
+        {
+            /*
+             * fd does not support epoll (like a regular file): it is always
+             * ready for read/write (like with poll())
+             */
+            HOOK_FD(hook, always_ready) = 1;
+            hook_fd_always_ready_count++;
+            return;
+        }
+        HOOK_FD(hook, error) = errno;
+        if (errno == EBADF)
+        {
+            gui_chat_printf (NULL,
+                             _("%sError: bad file descriptor (%d) "
+                               "used in hook_fd"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             HOOK_FD(hook, fd));
+        }
+        else
+        {
+            gui_chat_printf (NULL,
+                             _("%sError: unable to watch file descriptor "
+                               "(%d) with epoll: %s"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             HOOK_FD(hook, fd),
+                             strerror (errno));
+        }
+    }
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*
+ * Sets the backend used to watch file descriptors of fd hooks:
+ *   HOOK_FD_BACKEND_POLL: poll() (array of file descriptors is rebuilt on
+ *                         each call to hook_fd_exec)
+ *   HOOK_FD_BACKEND_EPOLL: epoll (file descriptors are registered once,
+ *                          available on Linux only).
+ *
+ * If epoll can not be used, poll() is used.
+ */
+
+void
+hook_fd_set_backend (int backend)
+{
+    struct t_hook *ptr_hook;
+#ifdef HAVE_SYS_EPOLL_H
+    int epoll_fd;
+#endif /* HAVE_SYS_EPOLL_H */
+
+    if (backend == hook_fd_backend)
+        return;
+
+    if (backend == HOOK_FD_BACKEND_EPOLL)
+    {
+#ifdef HAVE_SYS_EPOLL_H
+        epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+        {
+            gui_chat_printf (NULL,
+                             _("%sError: unable to use epoll (%s), "
+                               "poll() will be used"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             strerror (errno));
+            return;
+        }
+        hook_fd_epoll = epoll_fd;
+        hook_fd_backend = HOOK_FD_BACKEND_EPOLL;
+
+        /* register file descriptors already hooked */
+        for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted)
+                hook_fd_epoll_ctl (ptr_hook, EPOLL_CTL_ADD);
+        }
+#else
+        gui_chat_printf (NULL,
+                         _("%sError: epoll is not available, poll() will be "
+                           "used"),
+                         gui_chat_prefix[GUI_CHAT_PREFIX_ERROR]);
+#endif /* HAVE_SYS_EPOLL_H */
+    }
+    else
+    {
+        if (hook_fd_epoll >= 0)
+        {
+            close (hook_fd_epoll);
+            hook_fd_epoll = -1;
+        }
+        for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            HOOK_FD(ptr_hook, always_ready) = 0;
+        }
+        hook_fd_always_ready_count = 0;
+        hook_fd_backend = HOOK_FD_BACKEND_POLL;
+    }
 }
 
 /*
@@ -1373,6 +2578,13 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
         return NULL;
     }
 
+    if (!hook_fd_table_set (fd, new_hook))
+    {
+        free (new_hook_fd);
+        free (new_hook);
+        return NULL;
+    }
+
     hook_init_data (new_hook, plugin, HOOK_TYPE_FD, HOOK_PRIORITY_DEFAULT,
                     callback_pointer, callback_data);
 
@@ -1381,6 +2593,7 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
     new_hook_fd->fd = fd;
     new_hook_fd->flags = 0;
     new_hook_fd->error = 0;
+    new_hook_fd->always_ready = 0;
     if (flag_read)
         new_hook_fd->flags |= HOOK_FD_FLAG_READ;
     if (flag_write)
@@ -1390,20 +2603,77 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
 
     hook_add_to_list (new_hook);
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (hook_fd_backend == HOOK_FD_BACKEND_EPOLL)
+        hook_fd_epoll_ctl (new_hook, EPOLL_CTL_ADD);
+#endif /* HAVE_SYS_EPOLL_H */
+
     return new_hook;
 }
 
 /*
- * Executes fd hooks:
- * - poll() on fie descriptors
+ * Sets flags of a fd hook (HOOK_FD_FLAG_READ, HOOK_FD_FLAG_WRITE,
+ * HOOK_FD_FLAG_EXCEPTION).
+ *
+ * This function must be used instead of changing flags directly in the hook,
+ * so that events watched in epoll instance are updated.
+ */
+
+void
+hook_fd_set_flags (struct t_hook *hook, int flags)
+{
+    if (!hook || hook->deleted || (hook->type != HOOK_TYPE_FD)
+        || (HOOK_FD(hook, flags) == flags))
+    {
+        return;
+    }
+
+    HOOK_FD(hook, flags) = flags;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (hook_fd_backend == HOOK_FD_BACKEND_EPOLL)
+        hook_fd_epoll_ctl (hook, EPOLL_CTL_MOD);
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+/*
+ * Removes a fd hook from the table of fd hooks (and from epoll instance).
+ */
+
+void
+hook_fd_remove (struct t_hook *hook)
+{
+    if (hook_search_fd (HOOK_FD(hook, fd)) == hook)
+        hook_fd_table_set (HOOK_FD(hook, fd), NULL);
+
+    if (HOOK_FD(hook, always_ready))
+    {
+        HOOK_FD(hook, always_ready) = 0;
+        hook_fd_always_ready_count--;
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    /*
+     * remove file descriptor from epoll instance; this fails if the file
+     * descriptor has already been closed (then it was automatically removed)
+     */
+    if (hook_fd_epoll >= 0)
+        (void) epoll_ctl (hook_fd_epoll, EPOLL_CTL_DEL, HOOK_FD(hook, fd), NULL);
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+/*
+ * Executes fd hooks using poll():
+ * - poll() on file descriptors
  * - call of hook fd callbacks if needed.
  */
 
 void
-hook_fd_exec ()
+hook_fd_exec_poll (int timeout)
 {
-    int i, num_fd, timeout, ready, found;
-    struct t_hook *ptr_hook, *next_hook;
+    int i, num_fd, ready;
+    struct t_hook *ptr_hook;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* build an array of "struct pollfd" for poll() */
     num_fd = 0;
@@ -1428,7 +2698,7 @@ hook_fd_exec ()
             }
             else
             {
-                if (num_fd > hook_fd_pollfd_count)
+                if (num_fd >= hook_fd_pollfd_count)
                     break;
 
                 hook_fd_pollfd[num_fd].fd = HOOK_FD(ptr_hook, fd);
@@ -1438,6 +2708,8 @@ hook_fd_exec ()
                     hook_fd_pollfd[num_fd].events |= POLLIN;
                 if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_WRITE)
                     hook_fd_pollfd[num_fd].events |= POLLOUT;
+                if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_EXCEPTION)
+                    hook_fd_pollfd[num_fd].events |= POLLPRI;
 
                 num_fd++;
             }
@@ -1445,9 +2717,6 @@ hook_fd_exec ()
     }
 
     /* perform the poll() */
-    timeout = hook_timer_get_time_to_next ();
-    if (hook_process_pending)
-        timeout = 0;
     ready = poll (hook_fd_pollfd, num_fd, timeout);
     if (ready <= 0)
         return;
@@ -1455,40 +2724,131 @@ hook_fd_exec ()
     /* execute callbacks for file descriptors with activity */
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_FD];
-    while (ptr_hook)
+    for (i = 0; (i < num_fd) && (ready > 0); i++)
     {
-        next_hook = ptr_hook->next_hook;
+        if (!hook_fd_pollfd[i].revents)
+            continue;
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running)
+        ready--;
+
+        ptr_hook = hook_search_fd (hook_fd_pollfd[i].fd);
+        if (ptr_hook && !ptr_hook->running)
         {
-            found = 0;
-            for (i = 0; i < num_fd; i++)
-            {
-                if (hook_fd_pollfd[i].fd == HOOK_FD(ptr_hook, fd)
-                    && hook_fd_pollfd[i].revents)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found)
+            ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
+            (void) (HOOK_FD(ptr_hook, callback)) (
+                ptr_hook->callback_pointer,
+                ptr_hook->callback_data,
+                HOOK_FD(ptr_hook, fd));
+            hook_callback_end (ptr_hook, &hook_exec_cb);
+            ptr_hook->running = 0;
+        }
+    }
+
+    hook_exec_end ();
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Executes fd hooks using epoll:
+ * - wait for events on file descriptors registered in epoll instance
+ * - call of hook fd callbacks if needed.
+ */
+
+void
+hook_fd_exec_epoll (int timeout)
+{
+    struct epoll_event events[HOOK_FD_EPOLL_MAX_EVENTS];
+    struct t_hook *ptr_hook;
+    int i, ready;
+    struct t_hook_exec_cb hook_exec_cb;
+
+    /* fd hooks not watched by epoll are always ready: do not wait */
+    if (hook_fd_always_ready_count > 0)
+        timeout = 0;
+
+    ready = epoll_wait (hook_fd_epoll, events, HOOK_FD_EPOLL_MAX_EVENTS,
+                        timeout);
+    if ((ready <= 0) && (hook_fd_always_ready_count == 0))
+        return;
+
+    /* execute callbacks for file descriptors with activity */
+    hook_exec_start ();
+
+    for (i = 0; i < ready; i++)
+    {
+        /*
+         * the hook is searched by file descriptor: a hook can be removed by
+         * a previous callback (then it is not in table any more)
+         */
+        ptr_hook = hook_search_fd (events[i].data.fd);
+        if (ptr_hook && !ptr_hook->running
+            && (HOOK_FD(ptr_hook, flags)
+                & hook_fd_epoll_events_to_flags (events[i].events)))
+        {
+            ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
+            (void) (HOOK_FD(ptr_hook, callback)) (
+                ptr_hook->callback_pointer,
+                ptr_hook->callback_data,
+                HOOK_FD(ptr_hook, fd));
+            hook_callback_end (ptr_hook, &hook_exec_cb);
+            ptr_hook->running = 0;
+        }
+    }
+
+    /* execute callbacks for file descriptors not watched by epoll */
+    if (hook_fd_always_ready_count > 0)
+    {
+        for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted && !ptr_hook->running
+                && HOOK_FD(ptr_hook, always_ready)
+                && (HOOK_FD(ptr_hook, flags)
+                    & (HOOK_FD_FLAG_READ | HOOK_FD_FLAG_WRITE)))
             {
                 ptr_hook->running = 1;
+                hook_callback_start (ptr_hook, &hook_exec_cb);
                 (void) (HOOK_FD(ptr_hook, callback)) (
                     ptr_hook->callback_pointer,
                     ptr_hook->callback_data,
                     HOOK_FD(ptr_hook, fd));
+                hook_callback_end (ptr_hook, &hook_exec_cb);
                 ptr_hook->running = 0;
             }
         }
-
-        ptr_hook = next_hook;
     }
 
     hook_exec_end ();
 }
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*
+ * Executes fd hooks:
+ * - wait for activity on file descriptors (with poll() or epoll)
+ * - call of hook fd callbacks if needed.
+ */
+
+void
+hook_fd_exec ()
+{
+    int timeout;
+
+    timeout = hook_timer_get_time_to_next ();
+    if (hook_process_pending)
+        timeout = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (hook_fd_backend == HOOK_FD_BACKEND_EPOLL)
+    {
+        hook_fd_exec_epoll (timeout);
+        return;
+    }
+#endif /* HAVE_SYS_EPOLL_H */
+
+    hook_fd_exec_poll (timeout);
+}
 
 /*
  * Hooks a process (using fork) with options in hashtable.
@@ -1552,6 +2912,7 @@ hook_process_hashtable (struct t_weechat_plugin *plugin,
     new_hook_process->child_write[HOOK_PROCESS_STDOUT] = -1;
     new_hook_process->child_write[HOOK_PROCESS_STDERR] = -1;
     new_hook_process->child_pid = 0;
+    new_hook_process->url_transfer = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDIN] = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDOUT] = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDERR] = NULL;
@@ -1628,16 +2989,14 @@ hook_process (struct t_weechat_plugin *plugin,
 }
 
 /*
- * Child process for hook process: executes command and returns string result
- * into pipe for WeeChat process.
+ * Child process for hook process with a function ("func:"): runs the hook
+ * callback and returns string result into pipe for WeeChat process.
  */
 
 void
 hook_process_child (struct t_hook *hook_process)
 {
-    char **exec_args, *arg0, str_arg[64];
-    const char *ptr_url, *ptr_arg;
-    int rc, i, num_args;
+    int rc;
     FILE *f;
 
     /* read stdin from parent, if a pipe was defined */
@@ -1690,110 +3049,223 @@ hook_process_child (struct t_hook *hook_process)
         (void) f;
     }
 
-    rc = EXIT_FAILURE;
+    /* run a function (via the hook callback) */
+    rc = (int) (HOOK_PROCESS(hook_process, callback))
+        (hook_process->callback_pointer,
+         hook_process->callback_data,
+         HOOK_PROCESS(hook_process, command),
+         WEECHAT_HOOK_PROCESS_CHILD,
+         NULL, NULL);
+
+    fflush (stdout);
+    fflush (stderr);
+
+    _exit (rc);
+}
+
+/*
+ * Builds arguments to execute the command of a hook process.
+ *
+ * Note: result must be freed after use with function string_free_split().
+ */
+
+char **
+hook_process_get_exec_args (struct t_hook *hook_process)
+{
+    char **exec_args, *arg0, str_arg[64];
+    const char *ptr_arg;
+    int i, num_args;
+
+    num_args = 0;
+    if (HOOK_PROCESS(hook_process, options))
+    {
+        /*
+         * count number of arguments given in the hashtable options,
+         * keys are: "arg1", "arg2", ...
+         */
+        while (1)
+        {
+            snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
+            ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                     str_arg);
+            if (!ptr_arg)
+                break;
+            num_args++;
+        }
+    }
+    if (num_args > 0)
+    {
+        /*
+         * if at least one argument was found in hashtable option, the
+         * "command" contains only path to binary (without arguments), and
+         * the arguments are in hashtable
+         */
+        exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
+        if (exec_args)
+        {
+            exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
+            for (i = 1; i <= num_args; i++)
+            {
+                snprintf (str_arg, sizeof (str_arg), "arg%d", i);
+                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                         str_arg);
+                exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
+            }
+            exec_args[num_args + 1] = NULL;
+        }
+    }
+    else
+    {
+        /*
+         * if no arguments were found in hashtable, make an automatic split
+         * of command, like the shell does
+         */
+        exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
+                                        NULL);
+    }
+
+    if (exec_args && exec_args[0])
+    {
+        arg0 = string_expand_home (exec_args[0]);
+        if (arg0)
+        {
+            free (exec_args[0]);
+            exec_args[0] = arg0;
+        }
+    }
+
+    return exec_args;
+}
+
+/*
+ * Spawns the command of a hook process (with posix_spawn, which is much
+ * faster than a fork of WeeChat process, even with a large memory usage).
+ *
+ * Returns:
+ *   0: OK (child_pid is set in hook)
+ *   > 0: error (errno value)
+ */
+
+int
+hook_process_spawn (struct t_hook *hook_process)
+{
+    char **exec_args;
+    posix_spawn_file_actions_t file_actions;
+    posix_spawnattr_t attr;
+    pid_t pid;
+    int rc, i, fd_read, fd_write;
+
+    exec_args = hook_process_get_exec_args (hook_process);
+    if (!exec_args || !exec_args[0])
+    {
+        if (exec_args)
+            string_free_split (exec_args);
+        return ENOENT;
+    }
 
-    if (strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) == 0)
+    if (weechat_debug_core >= 1)
     {
-        /* get URL output (on stdout or file, depending on options) */
-        ptr_url = HOOK_PROCESS(hook_process, command) + 4;
-        while (ptr_url[0] == ' ')
+        log_printf ("hook_process, command='%s'",
+                    HOOK_PROCESS(hook_process, command));
+        for (i = 0; exec_args[i]; i++)
         {
-            ptr_url++;
+            log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
         }
-        rc = weeurl_download (ptr_url, HOOK_PROCESS(hook_process, options));
     }
-    else if (strncmp (HOOK_PROCESS(hook_process, command), "func:", 5) == 0)
+
+    posix_spawn_file_actions_init (&file_actions);
+    posix_spawnattr_init (&attr);
+
+    /* read stdin from parent, if a pipe was defined */
+    fd_read = HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]);
+    fd_write = HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDIN]);
+    if (fd_read >= 0)
     {
-        /* run a function (via the hook callback) */
-        rc = (int) (HOOK_PROCESS(hook_process, callback))
-            (hook_process->callback_pointer,
-             hook_process->callback_data,
-             HOOK_PROCESS(hook_process, command),
-             WEECHAT_HOOK_PROCESS_CHILD,
-             NULL, NULL);
+        posix_spawn_file_actions_adddup2 (&file_actions, fd_read,
+                                          STDIN_FILENO);
+        posix_spawn_file_actions_addclose (&file_actions, fd_write);
     }
     else
     {
-        /* launch command */
-        num_args = 0;
-        if (HOOK_PROCESS(hook_process, options))
-        {
-            /*
-             * count number of arguments given in the hashtable options,
-             * keys are: "arg1", "arg2", ...
-             */
-            while (1)
-            {
-                snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
-                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                         str_arg);
-                if (!ptr_arg)
-                    break;
-                num_args++;
-            }
-        }
-        if (num_args > 0)
+        /* no stdin pipe from parent, use "/dev/null" for stdin stream */
+        posix_spawn_file_actions_addopen (&file_actions, STDIN_FILENO,
+                                          "/dev/null", O_RDONLY, 0);
+    }
+
+    /* redirect stdout/stderr to pipe (so that parent process can read them) */
+    for (i = HOOK_PROCESS_STDOUT; i <= HOOK_PROCESS_STDERR; i++)
+    {
+        fd_read = HOOK_PROCESS(hook_process, child_read[i]);
+        fd_write = HOOK_PROCESS(hook_process, child_write[i]);
+        if (fd_read >= 0)
         {
-            /*
-             * if at least one argument was found in hashtable option, the
-             * "command" contains only path to binary (without arguments), and
-             * the arguments are in hashtable
-             */
-            exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
-            if (exec_args)
-            {
-                exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
-                for (i = 1; i <= num_args; i++)
-                {
-                    snprintf (str_arg, sizeof (str_arg), "arg%d", i);
-                    ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                             str_arg);
-                    exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
-                }
-                exec_args[num_args + 1] = NULL;
-            }
+            posix_spawn_file_actions_addclose (&file_actions, fd_read);
+            posix_spawn_file_actions_adddup2 (
+                &file_actions, fd_write,
+                (i == HOOK_PROCESS_STDOUT) ? STDOUT_FILENO : STDERR_FILENO);
         }
         else
         {
-            /*
-             * if no arguments were found in hashtable, make an automatic split
-             * of command, like the shell does
-             */
-            exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
-                                            NULL);
+            /* detached mode: write stdout/stderr in /dev/null */
+            posix_spawn_file_actions_addopen (
+                &file_actions,
+                (i == HOOK_PROCESS_STDOUT) ? STDOUT_FILENO : STDERR_FILENO,
+                "/dev/null", O_WRONLY, 0);
         }
+    }
 
-        if (exec_args)
-        {
-            arg0 = string_expand_home (exec_args[0]);
-            if (arg0)
-            {
-                free (exec_args[0]);
-                exec_args[0] = arg0;
-            }
-            if (weechat_debug_core >= 1)
-            {
-                log_printf ("hook_process, command='%s'",
-                            HOOK_PROCESS(hook_process, command));
-                for (i = 0; exec_args[i]; i++)
-                {
-                    log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
-                }
-            }
-            execvp (exec_args[0], exec_args);
-        }
+    /* same as setuid (getuid ()) done in a forked child */
+    posix_spawnattr_setflags (&attr, POSIX_SPAWN_RESETIDS);
 
-        /* should not be executed if execvp was OK */
-        if (exec_args)
-            string_free_split (exec_args);
-        fprintf (stderr, "Error with command '%s'\n",
-                 HOOK_PROCESS(hook_process, command));
+    rc = posix_spawnp (&pid, exec_args[0], &file_actions, &attr,
+                       exec_args, environ);
+    if (rc == 0)
+        HOOK_PROCESS(hook_process, child_pid) = pid;
+
+    posix_spawnattr_destroy (&attr);
+    posix_spawn_file_actions_destroy (&file_actions);
+    string_free_split (exec_args);
+
+    return rc;
+}
+
+/*
+ * Starts an URL transfer for a hook process (command "url:..."): the transfer
+ * is done by a thread of WeeChat process (no fork), output is written in the
+ * stdout/stderr pipes, read by fd hooks, like for a child process.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hook_process_run_url (struct t_hook *hook_process)
+{
+    struct t_url_transfer *transfer;
+    const char *ptr_url;
+    int fd_stdout, fd_stderr;
+
+    ptr_url = HOOK_PROCESS(hook_process, command) + 4;
+    while (ptr_url[0] == ' ')
+    {
+        ptr_url++;
     }
 
-    fflush (stdout);
-    fflush (stderr);
+    /* write side of pipes is now owned by the transfer */
+    fd_stdout = HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]);
+    fd_stderr = HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]);
+    HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]) = -1;
+    HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]) = -1;
 
-    _exit (rc);
+    transfer = weeurl_transfer_new (ptr_url, HOOK_PROCESS(hook_process, options),
+                                    fd_stdout, fd_stderr);
+    if (!transfer)
+        return 0;
+
+    HOOK_PROCESS(hook_process, url_transfer) = transfer;
+
+    return weeurl_transfer_start (transfer);
 }
 
 /*
@@ -1804,6 +3276,7 @@ void
 hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
 {
     int size;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* add '\0' at end of stdout and stderr */
     size = HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]);
@@ -1814,6 +3287,7 @@ hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
         HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR])[size] = '\0';
 
     /* send buffers to callback */
+    hook_callback_start (hook_process, &hook_exec_cb);
     (void) (HOOK_PROCESS(hook_process, callback))
         (hook_process->callback_pointer,
          hook_process->callback_data,
@@ -1823,6 +3297,7 @@ hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
          HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDOUT]) : NULL,
          (HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]) > 0) ?
          HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR]) : NULL);
+    hook_callback_end (hook_process, &hook_exec_cb);
 
     /* reset size for stdout and stderr */
     HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]) = 0;
@@ -1994,7 +3469,7 @@ hook_process_child_read_until_eof (struct t_hook *hook_process)
 }
 
 /*
- * Checks if child process is still alive.
+ * Checks if child process (or URL transfer) is still alive.
  */
 
 int
@@ -2022,10 +3497,24 @@ hook_process_timer_cb (const void *pointer, void *data, int remaining_calls)
                              HOOK_PROCESS(hook_process, command),
                              ((float)HOOK_PROCESS(hook_process, timeout)) / 1000);
         }
-        kill (HOOK_PROCESS(hook_process, child_pid), SIGKILL);
-        usleep (1000);
+        if (HOOK_PROCESS(hook_process, child_pid) > 0)
+        {
+            kill (HOOK_PROCESS(hook_process, child_pid), SIGKILL);
+            usleep (1000);
+        }
         unhook (hook_process);
     }
+    else if (HOOK_PROCESS(hook_process, url_transfer))
+    {
+        if (weeurl_transfer_is_done (HOOK_PROCESS(hook_process, url_transfer),
+                                     &rc))
+        {
+            /* URL transfer done (streams are closed by the thread) */
+            hook_process_child_read_until_eof (hook_process);
+            hook_process_send_buffers (hook_process, rc);
+            unhook (hook_process);
+        }
+    }
     else
     {
         if (waitpid (HOOK_PROCESS(hook_process, child_pid),
@@ -2054,8 +3543,9 @@ hook_process_timer_cb (const void *pointer, void *data, int remaining_calls)
 }
 
 /*
- * Executes process command in child, and read data in current process,
- * with fd hook.
+ * Executes process command (in a spawned process, a forked child for a
+ * function, or a thread for an URL transfer), and read data in current
+ * process, with fd hook.
  */
 
 void
@@ -2065,6 +3555,7 @@ hook_process_run (struct t_hook *hook_process)
     char str_error[1024];
     long interval;
     pid_t pid;
+    struct t_hook_exec_cb hook_exec_cb;
 
     for (i = 0; i < 3; i++)
     {
@@ -2072,8 +3563,12 @@ hook_process_run (struct t_hook *hook_process)
         pipes[i][1] = -1;
     }
 
-    /* create pipe for stdin (only if stdin was given in options) */
+    /*
+     * create pipe for stdin (only if stdin was given in options, and not
+     * for an URL transfer)
+     */
     if (HOOK_PROCESS(hook_process, options)
+        && (strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) != 0)
         && hashtable_has_key (HOOK_PROCESS(hook_process, options), "stdin"))
     {
         if (pipe (pipes[HOOK_PROCESS_STDIN]) < 0)
@@ -2096,34 +3591,60 @@ hook_process_run (struct t_hook *hook_process)
         HOOK_PROCESS(hook_process, child_write[i]) = pipes[i][1];
     }
 
-    /* fork */
-    switch (pid = fork ())
+    if (strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) == 0)
     {
-        /* fork failed */
-        case -1:
+        /* URL transfer: run in a thread (write side of pipes is given) */
+        if (!hook_process_run_url (hook_process))
+        {
             snprintf (str_error, sizeof (str_error),
-                      "fork error: %s",
-                      strerror (errno));
-            (void) (HOOK_PROCESS(hook_process, callback))
-                (hook_process->callback_pointer,
-                 hook_process->callback_data,
-                 HOOK_PROCESS(hook_process, command),
-                 WEECHAT_HOOK_PROCESS_ERROR,
-                 NULL, str_error);
+                      "unable to start URL transfer");
+            goto error_started;
+        }
+    }
+    else if (strncmp (HOOK_PROCESS(hook_process, command), "func:", 5) == 0)
+    {
+        /* function: fork, the callback is called in child process */
+        switch (pid = fork ())
+        {
+            /* fork failed */
+            case -1:
+                snprintf (str_error, sizeof (str_error),
+                          "fork error: %s",
+                          strerror (errno));
+                goto error_started;
+            /* child process */
+            case 0:
+                rc = setuid (getuid ());
+                (void) rc;
+                hook_process_child (hook_process);
+                /* never executed */
+                _exit (EXIT_SUCCESS);
+                break;
+        }
+        HOOK_PROCESS(hook_process, child_pid) = pid;
+    }
+    else
+    {
+        /* command: spawn a new process */
+        rc = hook_process_spawn (hook_process);
+        if (rc != 0)
+        {
+            if (!HOOK_PROCESS(hook_process, detached))
+            {
+                snprintf (str_error, sizeof (str_error),
+                          "Error with command '%s'\n",
+                          HOOK_PROCESS(hook_process, command));
+                hook_process_add_to_buffer (hook_process,
+                                            HOOK_PROCESS_STDERR,
+                                            str_error, strlen (str_error));
+            }
+            hook_process_send_buffers (hook_process, EXIT_FAILURE);
             unhook (hook_process);
             return;
-        /* child process */
-        case 0:
-            rc = setuid (getuid ());
-            (void) rc;
-            hook_process_child (hook_process);
-            /* never executed */
-            _exit (EXIT_SUCCESS);
-            break;
+        }
     }
 
     /* parent process */
-    HOOK_PROCESS(hook_process, child_pid) = pid;
     if (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]) >= 0)
     {
         close (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]));
@@ -2185,6 +3706,19 @@ hook_process_run (struct t_hook *hook_process)
                                                          NULL);
     return;
 
+error_started:
+    /* pipes are now in hook, they are closed by unhook */
+    hook_callback_start (hook_process, &hook_exec_cb);
+    (void) (HOOK_PROCESS(hook_process, callback))
+        (hook_process->callback_pointer,
+         hook_process->callback_data,
+         HOOK_PROCESS(hook_process, command),
+         WEECHAT_HOOK_PROCESS_ERROR,
+         NULL, str_error);
+    hook_callback_end (hook_process, &hook_exec_cb);
+    unhook (hook_process);
+    return;
+
 error:
     for (i = 0; i < 3; i++)
     {
@@ -2193,12 +3727,14 @@ error:
         if (pipes[i][1] >= 0)
             close (pipes[i][1]);
     }
+    hook_callback_start (hook_process, &hook_exec_cb);
     (void) (HOOK_PROCESS(hook_process, callback))
         (hook_process->callback_pointer,
          hook_process->callback_data,
          HOOK_PROCESS(hook_process, command),
          WEECHAT_HOOK_PROCESS_ERROR,
          NULL, NULL);
+    hook_callback_end (hook_process, &hook_exec_cb);
     unhook (hook_process);
 }
 
@@ -2220,7 +3756,8 @@ hook_process_exec ()
 
         if (!ptr_hook->deleted
             && !ptr_hook->running
-            && (HOOK_PROCESS(ptr_hook, child_pid) == 0))
+            && (HOOK_PROCESS(ptr_hook, child_pid) == 0)
+            && !HOOK_PROCESS(ptr_hook, url_transfer))
         {
             ptr_hook->running = 1;
             hook_process_run (ptr_hook);
@@ -2252,7 +3789,6 @@ hook_connect (struct t_weechat_plugin *plugin, const char *proxy,
 {
     struct t_hook *new_hook;
     struct t_hook_connect *new_hook_connect;
-    int i;
 
 #ifndef HAVE_GNUTLS
     /* make C compiler happy */
@@ -2295,29 +3831,17 @@ hook_connect (struct t_weechat_plugin *plugin, const char *proxy,
 #endif /* HAVE_GNUTLS */
     new_hook_connect->local_hostname = (local_hostname) ?
         strdup (local_hostname) : NULL;
-    new_hook_connect->child_read = -1;
-    new_hook_connect->child_write = -1;
-    new_hook_connect->child_recv = -1;
-    new_hook_connect->child_send = -1;
-    new_hook_connect->child_pid = 0;
-    new_hook_connect->hook_child_timer = NULL;
+    new_hook_connect->request = NULL;
+    new_hook_connect->hook_timer = NULL;
     new_hook_connect->hook_fd = NULL;
     new_hook_connect->handshake_hook_fd = NULL;
     new_hook_connect->handshake_hook_timer = NULL;
     new_hook_connect->handshake_fd_flags = 0;
     new_hook_connect->handshake_ip_address = NULL;
-    if (!hook_socketpair_ok)
-    {
-        for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-        {
-            new_hook_connect->sock_v4[i] = -1;
-            new_hook_connect->sock_v6[i] = -1;
-        }
-    }
 
     hook_add_to_list (new_hook);
 
-    network_connect_with_fork (new_hook);
+    network_connect_start (new_hook);
 
     return new_hook;
 }
@@ -2385,155 +3909,452 @@ hook_connect_gnutls_set_certificates (gnutls_session_t tls_session,
             && HOOK_CONNECT(ptr_hook, gnutls_sess)
             && (*(HOOK_CONNECT(ptr_hook, gnutls_sess)) == tls_session))
         {
-            rc = (int) (HOOK_CONNECT(ptr_hook, gnutls_cb))
-                (ptr_hook->callback_pointer,
-                 ptr_hook->callback_data,
-                 tls_session, req_ca, nreq,
-                 pk_algos, pk_algos_len, answer,
-                 WEECHAT_HOOK_CONNECT_GNUTLS_CB_SET_CERT);
-            break;
+            rc = (int) (HOOK_CONNECT(ptr_hook, gnutls_cb))
+                (ptr_hook->callback_pointer,
+                 ptr_hook->callback_data,
+                 tls_session, req_ca, nreq,
+                 pk_algos, pk_algos_len, answer,
+                 WEECHAT_HOOK_CONNECT_GNUTLS_CB_SET_CERT);
+            break;
+        }
+        ptr_hook = ptr_hook->next_hook;
+    }
+
+    return rc;
+}
+#endif /* HAVE_GNUTLS */
+
+/*
+ * Hooks a message printed by WeeChat.
+ *
+ * Returns pointer to new hook, NULL if error.
+ */
+
+struct t_hook *
+hook_print (struct t_weechat_plugin *plugin, struct t_gui_buffer *buffer,
+            const char *tags, const char *message, int strip_colors,
+            t_hook_callback_print *callback,
+            const void *callback_pointer,
+            void *callback_data)
+{
+    struct t_hook *new_hook;
+    struct t_hook_print *new_hook_print;
+    char **tags_array;
+    int i;
+
+    if (!callback)
+        return NULL;
+
+    new_hook = malloc (sizeof (*new_hook));
+    if (!new_hook)
+        return NULL;
+    new_hook_print = malloc (sizeof (*new_hook_print));
+    if (!new_hook_print)
+    {
+        free (new_hook);
+        return NULL;
+    }
+
+    hook_init_data (new_hook, plugin, HOOK_TYPE_PRINT, HOOK_PRIORITY_DEFAULT,
+                    callback_pointer, callback_data);
+
+    new_hook->hook_data = new_hook_print;
+    new_hook_print->callback = callback;
+    new_hook_print->buffer = buffer;
+    new_hook_print->tags_count = 0;
+    new_hook_print->tags_array = NULL;
+    new_hook_print->tags_match = NULL;
+    if (tags)
+    {
+        tags_array = string_split (tags, ",", 0, 0,
+                                   &new_hook_print->tags_count);
+        if (tags_array)
+        {
+            new_hook_print->tags_array = malloc (new_hook_print->tags_count *
+                                                 sizeof (*new_hook_print->tags_array));
+            if (new_hook_print->tags_array)
+            {
+                for (i = 0; i < new_hook_print->tags_count; i++)
+                {
+                    new_hook_print->tags_array[i] = string_split (tags_array[i],
+                                                                  "+", 0, 0,
+                                                                  NULL);
+                }
+            }
+            string_free_split (tags_array);
+            new_hook_print->tags_match = gui_line_tags_match_new (
+                new_hook_print->tags_count, new_hook_print->tags_array);
+        }
+    }
+    new_hook_print->message = (message) ? strdup (message) : NULL;
+    new_hook_print->strip_colors = strip_colors;
+
+    hook_add_to_list (new_hook);
+
+    return new_hook;
+}
+
+/*
+ * Gets the tag used to index a set of tags of a print hook (tags that must
+ * all be in the line): the first tag which is not negated and without
+ * wildcard.
+ *
+ * Returns NULL if there is no such tag in the set.
+ */
+
+const char *
+hook_print_index_get_tag (char **tags)
+{
+    int i;
+
+    if (!tags)
+        return NULL;
+
+    for (i = 0; tags[i]; i++)
+    {
+        if (tags[i][0] && (tags[i][0] != '!') && !strchr (tags[i], '*'))
+            return tags[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Checks if a print hook is indexed by tags: hook for all buffers, with a
+ * tag to index in each set of tags.
+ *
+ * Returns:
+ *   1: hook is indexed by tags
+ *   0: hook is not indexed by tags
+ */
+
+int
+hook_print_index_by_tags (struct t_hook *hook)
+{
+    int i;
+
+    if (HOOK_PRINT(hook, buffer)
+        || !HOOK_PRINT(hook, tags_array)
+        || (HOOK_PRINT(hook, tags_count) <= 0))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < HOOK_PRINT(hook, tags_count); i++)
+    {
+        if (!hook_print_index_get_tag (HOOK_PRINT(hook, tags_array)[i]))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Adds a print hook in the index of print hooks.
+ */
+
+void
+hook_print_index_add (struct t_hook *hook)
+{
+    int i;
+
+    if (!hook->hook_data)
+        return;
+
+    if (HOOK_PRINT(hook, buffer))
+    {
+        if (!hook_print_index.buffers)
+        {
+            hook_print_index.buffers = hashtable_new (32,
+                                                      WEECHAT_HASHTABLE_POINTER,
+                                                      WEECHAT_HASHTABLE_POINTER,
+                                                      NULL, NULL);
+            if (!hook_print_index.buffers)
+                return;
+            hook_print_index.buffers->callback_free_value = &hook_index_free_value_cb;
+        }
+        hook_index_hashtable_add (hook_print_index.buffers,
+                                  HOOK_PRINT(hook, buffer), hook);
+    }
+    else if (hook_print_index_by_tags (hook))
+    {
+        if (!hook_print_index.tags)
+        {
+            hook_print_index.tags = hashtable_new (32,
+                                                   WEECHAT_HASHTABLE_STRING,
+                                                   WEECHAT_HASHTABLE_POINTER,
+                                                   &hook_index_hash_key_cb,
+                                                   &hook_index_keycmp_cb);
+            if (!hook_print_index.tags)
+                return;
+            hook_print_index.tags->callback_free_value = &hook_index_free_value_cb;
+        }
+        for (i = 0; i < HOOK_PRINT(hook, tags_count); i++)
+        {
+            hook_index_hashtable_add (
+                hook_print_index.tags,
+                hook_print_index_get_tag (HOOK_PRINT(hook, tags_array)[i]),
+                hook);
+        }
+    }
+    else
+    {
+        if (!hook_print_index.others)
+        {
+            hook_print_index.others = arraylist_new (16, 1, 0,
+                                                     &hook_index_cmp_cb, NULL,
+                                                     NULL, NULL);
+            if (!hook_print_index.others)
+                return;
+        }
+        arraylist_add (hook_print_index.others, hook);
+    }
+}
+
+/*
+ * Removes a print hook from the index of print hooks.
+ *
+ * This function must be called before the hook specific data is freed.
+ */
+
+void
+hook_print_index_remove (struct t_hook *hook)
+{
+    int i, index;
+
+    if (!hook->hook_data)
+        return;
+
+    if (HOOK_PRINT(hook, buffer))
+    {
+        hook_index_hashtable_remove (hook_print_index.buffers,
+                                     HOOK_PRINT(hook, buffer), hook);
+    }
+    else if (hook_print_index_by_tags (hook))
+    {
+        for (i = 0; i < HOOK_PRINT(hook, tags_count); i++)
+        {
+            hook_index_hashtable_remove (
+                hook_print_index.tags,
+                hook_print_index_get_tag (HOOK_PRINT(hook, tags_array)[i]),
+                hook);
         }
-        ptr_hook = ptr_hook->next_hook;
     }
+    else
+    {
+        if (arraylist_search (hook_print_index.others, hook, &index, NULL))
+            arraylist_remove (hook_print_index.others, index);
+    }
+}
 
-    return rc;
+/*
+ * Frees the index of print hooks.
+ */
+
+void
+hook_print_index_free ()
+{
+    if (hook_print_index.buffers)
+    {
+        hashtable_free (hook_print_index.buffers);
+        hook_print_index.buffers = NULL;
+    }
+    if (hook_print_index.tags)
+    {
+        hashtable_free (hook_print_index.tags);
+        hook_print_index.tags = NULL;
+    }
+    if (hook_print_index.others)
+    {
+        arraylist_free (hook_print_index.others);
+        hook_print_index.others = NULL;
+    }
 }
-#endif /* HAVE_GNUTLS */
 
 /*
- * Hooks a message printed by WeeChat.
- *
- * Returns pointer to new hook, NULL if error.
+ * Compares two hooks in an array of hooks (for qsort).
  */
 
-struct t_hook *
-hook_print (struct t_weechat_plugin *plugin, struct t_gui_buffer *buffer,
-            const char *tags, const char *message, int strip_colors,
-            t_hook_callback_print *callback,
-            const void *callback_pointer,
-            void *callback_data)
+int
+hook_print_index_sort_cb (const void *hook1, const void *hook2)
 {
-    struct t_hook *new_hook;
-    struct t_hook_print *new_hook_print;
-    char **tags_array;
-    int i;
+    return hook_index_cmp_cb (NULL, NULL,
+                              *((struct t_hook **)hook1),
+                              *((struct t_hook **)hook2));
+}
 
-    if (!callback)
-        return NULL;
+/*
+ * Gets print hooks that may match a line displayed in a buffer, sorted like
+ * in the list of hooks: hooks for this buffer, hooks indexed by one of the
+ * line tags and other hooks (buffer, tags and message must still be checked
+ * for each hook).
+ *
+ * The array "hooks_static" is used like in function hook_index_get.
+ *
+ * Returns the array of hooks, the number of hooks is put in *num_hooks.
+ */
 
-    new_hook = malloc (sizeof (*new_hook));
-    if (!new_hook)
-        return NULL;
-    new_hook_print = malloc (sizeof (*new_hook_print));
-    if (!new_hook_print)
+struct t_hook **
+hook_print_index_get (struct t_gui_buffer *buffer,
+                      struct t_gui_line_data *line_data,
+                      struct t_hook **hooks_static, int size_static,
+                      int *num_hooks)
+{
+    struct t_arraylist *lists[2], *list;
+    struct t_hook **hooks;
+    int i, j, size, size_list, num_lists;
+
+    hooks = hooks_static;
+    size = size_static;
+    *num_hooks = 0;
+    num_lists = 0;
+
+    lists[0] = (hook_print_index.buffers) ?
+        hashtable_get (hook_print_index.buffers, buffer) : NULL;
+    lists[1] = hook_print_index.others;
+    for (i = 0; i < 2; i++)
     {
-        free (new_hook);
-        return NULL;
+        size_list = arraylist_size (lists[i]);
+        if (size_list > 0)
+        {
+            for (j = 0; j < size_list; j++)
+            {
+                hooks = hook_index_array_add (hooks, hooks_static, &size,
+                                              num_hooks,
+                                              arraylist_get (lists[i], j));
+            }
+            num_lists++;
+        }
     }
 
-    hook_init_data (new_hook, plugin, HOOK_TYPE_PRINT, HOOK_PRIORITY_DEFAULT,
-                    callback_pointer, callback_data);
-
-    new_hook->hook_data = new_hook_print;
-    new_hook_print->callback = callback;
-    new_hook_print->buffer = buffer;
-    new_hook_print->tags_count = 0;
-    new_hook_print->tags_array = NULL;
-    if (tags)
+    if (hook_print_index.tags
+        && (hook_print_index.tags->items_count > 0))
     {
-        tags_array = string_split (tags, ",", 0, 0,
-                                   &new_hook_print->tags_count);
-        if (tags_array)
+        for (i = 0; i < line_data->tags_count; i++)
         {
-            new_hook_print->tags_array = malloc (new_hook_print->tags_count *
-                                                 sizeof (*new_hook_print->tags_array));
-            if (new_hook_print->tags_array)
+            list = hashtable_get (hook_print_index.tags,
+                                  line_data->tags_array[i]);
+            size_list = arraylist_size (list);
+            if (size_list > 0)
             {
-                for (i = 0; i < new_hook_print->tags_count; i++)
+                for (j = 0; j < size_list; j++)
                 {
-                    new_hook_print->tags_array[i] = string_split (tags_array[i],
-                                                                  "+", 0, 0,
-                                                                  NULL);
+                    hooks = hook_index_array_add (hooks, hooks_static, &size,
+                                                  num_hooks,
+                                                  arraylist_get (list, j));
                 }
+                num_lists++;
             }
-            string_free_split (tags_array);
         }
     }
-    new_hook_print->message = (message) ? strdup (message) : NULL;
-    new_hook_print->strip_colors = strip_colors;
 
-    hook_add_to_list (new_hook);
+    /* merge lists: sort hooks and remove duplicates */
+    if ((num_lists > 1) && (*num_hooks > 1))
+    {
+        qsort (hooks, *num_hooks, sizeof (*hooks), &hook_print_index_sort_cb);
+        j = 0;
+        for (i = 1; i < *num_hooks; i++)
+        {
+            if (hooks[i] != hooks[j])
+                hooks[++j] = hooks[i];
+        }
+        *num_hooks = j + 1;
+    }
 
-    return new_hook;
+    return hooks;
 }
 
 /*
- * Executes a print hook.
+ * Executes print hooks for a line displayed in a buffer.
+ *
+ * Only hooks that may match the line are checked (see function
+ * hook_print_index_get), and colors are removed from prefix and message only
+ * if a hook needs it.
  */
 
 void
 hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook *hooks_static[HOOK_INDEX_STATIC_SIZE], **hooks, *ptr_hook;
     char *prefix_no_color, *message_no_color;
+    int i, num_hooks, colors_decoded;
+    struct t_hook_exec_cb hook_exec_cb;
 
-    if (!line->data->message || !line->data->message[0])
+    if (!weechat_hooks[HOOK_TYPE_PRINT])
         return;
 
-    prefix_no_color = (line->data->prefix) ?
-        gui_color_decode (line->data->prefix, NULL) : NULL;
-
-    message_no_color = gui_color_decode (line->data->message, NULL);
-    if (!message_no_color)
-    {
-        if (prefix_no_color)
-            free (prefix_no_color);
+    if (!line->data->message || !line->data->message[0])
         return;
-    }
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_PRINT];
-    while (ptr_hook)
+    hooks = hook_print_index_get (buffer, line->data,
+                                  hooks_static, HOOK_INDEX_STATIC_SIZE,
+                                  &num_hooks);
+
+    prefix_no_color = NULL;
+    message_no_color = NULL;
+    colors_decoded = 0;
+
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (!HOOK_PRINT(ptr_hook, buffer)
-                || (buffer == HOOK_PRINT(ptr_hook, buffer)))
-            && (!HOOK_PRINT(ptr_hook, message)
-                || !HOOK_PRINT(ptr_hook, message)[0]
-                || string_strcasestr (prefix_no_color, HOOK_PRINT(ptr_hook, message))
-                || string_strcasestr (message_no_color, HOOK_PRINT(ptr_hook, message))))
+        if (ptr_hook->deleted || ptr_hook->running)
+            continue;
+
+        /* check if tags match */
+        if (HOOK_PRINT(ptr_hook, tags_array)
+            && !gui_line_match_tags (line->data,
+                                     HOOK_PRINT(ptr_hook, tags_match)))
         {
-            /* check if tags match */
-            if (!HOOK_PRINT(ptr_hook, tags_array)
-                || gui_line_match_tags (line->data,
-                                        HOOK_PRINT(ptr_hook, tags_count),
-                                        HOOK_PRINT(ptr_hook, tags_array)))
-            {
-                /* run callback */
-                ptr_hook->running = 1;
-                (void) (HOOK_PRINT(ptr_hook, callback))
-                    (ptr_hook->callback_pointer,
-                     ptr_hook->callback_data, buffer, line->data->date,
-                     line->data->tags_count,
-                     (const char **)line->data->tags_array,
-                     (int)line->data->displayed, (int)line->data->highlight,
-                     (HOOK_PRINT(ptr_hook, strip_colors)) ? prefix_no_color : line->data->prefix,
-                     (HOOK_PRINT(ptr_hook, strip_colors)) ? message_no_color : line->data->message);
-                ptr_hook->running = 0;
-            }
+            continue;
         }
 
-        ptr_hook = next_hook;
+        /* remove colors (only once) if the hook needs it */
+        if (!colors_decoded
+            && ((HOOK_PRINT(ptr_hook, message)
+                 && HOOK_PRINT(ptr_hook, message)[0])
+                || HOOK_PRINT(ptr_hook, strip_colors)))
+        {
+            prefix_no_color = (line->data->prefix) ?
+                gui_color_decode (line->data->prefix, NULL) : NULL;
+            message_no_color = gui_color_decode (line->data->message, NULL);
+            if (!message_no_color)
+                break;
+            colors_decoded = 1;
+        }
+
+        /* check if message matches */
+        if (HOOK_PRINT(ptr_hook, message)
+            && HOOK_PRINT(ptr_hook, message)[0]
+            && !string_strcasestr (prefix_no_color, HOOK_PRINT(ptr_hook, message))
+            && !string_strcasestr (message_no_color, HOOK_PRINT(ptr_hook, message)))
+        {
+            continue;
+        }
+
+        /* run callback */
+        ptr_hook->running = 1;
+        hook_callback_start (ptr_hook, &hook_exec_cb);
+        (void) (HOOK_PRINT(ptr_hook, callback))
+            (ptr_hook->callback_pointer,
+             ptr_hook->callback_data, buffer, line->data->date,
+             line->data->tags_count,
+             (const char **)line->data->tags_array,
+             (int)line->data->displayed, (int)line->data->highlight,
+             (HOOK_PRINT(ptr_hook, strip_colors)) ? prefix_no_color : line->data->prefix,
+             (HOOK_PRINT(ptr_hook, strip_colors)) ? message_no_color : line->data->message);
+        hook_callback_end (ptr_hook, &hook_exec_cb);
+        ptr_hook->running = 0;
     }
 
     if (prefix_no_color)
         free (prefix_no_color);
     if (message_no_color)
         free (message_no_color);
+    if (hooks != hooks_static)
+        free (hooks);
 
     hook_exec_end ();
 }
@@ -2588,38 +4409,42 @@ hook_signal (struct t_weechat_plugin *plugin, const char *signal,
 int
 hook_signal_send (const char *signal, const char *type_data, void *signal_data)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    int rc;
+    struct t_hook *hooks_static[HOOK_INDEX_STATIC_SIZE], **hooks, *ptr_hook;
+    int i, num_hooks, rc;
+    struct t_hook_exec_cb hook_exec_cb;
 
     rc = WEECHAT_RC_OK;
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_SIGNAL];
-    while (ptr_hook)
+    hooks = hook_index_get (HOOK_TYPE_SIGNAL, signal,
+                            hooks_static, HOOK_INDEX_STATIC_SIZE, &num_hooks);
+
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (string_match (signal, HOOK_SIGNAL(ptr_hook, signal), 0)))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             rc = (HOOK_SIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  signal,
                  type_data,
                  signal_data);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
                 break;
         }
-
-        ptr_hook = next_hook;
     }
 
+    if (hooks != hooks_static)
+        free (hooks);
+
     hook_exec_end ();
 
     return rc;
@@ -2675,37 +4500,41 @@ hook_hsignal (struct t_weechat_plugin *plugin, const char *signal,
 int
 hook_hsignal_send (const char *signal, struct t_hashtable *hashtable)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    int rc;
+    struct t_hook *hooks_static[HOOK_INDEX_STATIC_SIZE], **hooks, *ptr_hook;
+    int i, num_hooks, rc;
+    struct t_hook_exec_cb hook_exec_cb;
 
     rc = WEECHAT_RC_OK;
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_HSIGNAL];
-    while (ptr_hook)
+    hooks = hook_index_get (HOOK_TYPE_HSIGNAL, signal,
+                            hooks_static, HOOK_INDEX_STATIC_SIZE, &num_hooks);
+
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (string_match (signal, HOOK_HSIGNAL(ptr_hook, signal), 0)))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             rc = (HOOK_HSIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  signal,
                  hashtable);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
                 break;
         }
-
-        ptr_hook = next_hook;
     }
 
+    if (hooks != hooks_static)
+        free (hooks);
+
     hook_exec_end ();
 
     return rc;
@@ -2763,6 +4592,7 @@ void
 hook_config_exec (const char *option, const char *value)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct t_hook_exec_cb hook_exec_cb;
 
     hook_exec_start ();
 
@@ -2777,11 +4607,13 @@ hook_config_exec (const char *option, const char *value)
                 || (string_match (option, HOOK_CONFIG(ptr_hook, option), 0))))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             (void) (HOOK_CONFIG(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  option,
                  value);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
         }
 
@@ -2875,6 +4707,7 @@ hook_completion_exec (struct t_weechat_plugin *plugin,
     struct t_hook *ptr_hook, *next_hook;
     const char *pos;
     char *item;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) plugin;
@@ -2899,12 +4732,14 @@ hook_completion_exec (struct t_weechat_plugin *plugin,
                                    item) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             (void) (HOOK_COMPLETION(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  completion_item,
                  buffer,
                  completion);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
         }
 
@@ -2959,9 +4794,34 @@ hook_modifier (struct t_weechat_plugin *plugin, const char *modifier,
     return new_hook;
 }
 
+/*
+ * Checks if there is at least one hook for a modifier.
+ *
+ * This can be used before building the modifier data (which can be long) to
+ * skip the call to function hook_modifier_exec.
+ *
+ * Returns:
+ *   1: some hooks exist for the modifier
+ *   0: no hook for the modifier
+ */
+
+int
+hook_modifier_exists (const char *modifier)
+{
+    if (!modifier || !modifier[0] || !hook_index[HOOK_TYPE_MODIFIER].names)
+        return 0;
+
+    return (hashtable_get (hook_index[HOOK_TYPE_MODIFIER].names,
+                           modifier)) ? 1 : 0;
+}
+
 /*
  * Executes a modifier hook.
  *
+ * Hooks are called in chain: each hook receives the string returned by the
+ * previous hook (or the initial string); the string is copied only if no hook
+ * has changed it.
+ *
  * Note: result must be freed after use.
  */
 
@@ -2969,63 +4829,68 @@ char *
 hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                     const char *modifier_data, const char *string)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook *hooks_static[HOOK_INDEX_STATIC_SIZE], **hooks, *ptr_hook;
     char *new_msg, *message_modified;
+    const char *ptr_string;
+    int i, num_hooks;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) plugin;
 
-    if (!modifier || !modifier[0])
+    if (!modifier || !modifier[0] || !string)
         return NULL;
 
-    new_msg = NULL;
-    message_modified = strdup (string);
-    if (!message_modified)
-        return NULL;
+    hooks = hook_index_get (HOOK_TYPE_MODIFIER, modifier,
+                            hooks_static, HOOK_INDEX_STATIC_SIZE,
+                            &num_hooks);
+
+    /* no hook for this modifier => return the string unchanged */
+    if (num_hooks == 0)
+        return strdup (string);
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_MODIFIER];
-    while (ptr_hook)
+    ptr_string = string;
+    message_modified = NULL;
+
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (string_strcasecmp (HOOK_MODIFIER(ptr_hook, modifier),
-                                   modifier) == 0))
-        {
-            ptr_hook->running = 1;
-            new_msg = (HOOK_MODIFIER(ptr_hook, callback))
-                (ptr_hook->callback_pointer,
-                 ptr_hook->callback_data,
-                 modifier,
-                 modifier_data,
-                 message_modified);
-            ptr_hook->running = 0;
+        if (ptr_hook->deleted || ptr_hook->running)
+            continue;
 
-            /* empty string returned => message dropped */
-            if (new_msg && !new_msg[0])
-            {
-                free (message_modified);
-                hook_exec_end ();
-                return new_msg;
-            }
+        ptr_hook->running = 1;
+        hook_callback_start (ptr_hook, &hook_exec_cb);
+        new_msg = (HOOK_MODIFIER(ptr_hook, callback))
+            (ptr_hook->callback_pointer,
+             ptr_hook->callback_data,
+             modifier,
+             modifier_data,
+             ptr_string);
+        hook_callback_end (ptr_hook, &hook_exec_cb);
+        ptr_hook->running = 0;
+
+        if (!new_msg)
+            continue;
 
-            /* new message => keep it as base for next modifier */
-            if (new_msg)
-            {
-                free (message_modified);
-                message_modified = new_msg;
-            }
-        }
+        if (message_modified)
+            free (message_modified);
+        message_modified = new_msg;
+        ptr_string = message_modified;
 
-        ptr_hook = next_hook;
+        /* empty string returned => message dropped */
+        if (!new_msg[0])
+            break;
     }
 
+    if (hooks != hooks_static)
+        free (hooks);
+
     hook_exec_end ();
 
-    return message_modified;
+    return (message_modified) ? message_modified : strdup (string);
 }
 
 /*
@@ -3086,6 +4951,7 @@ hook_info_get (struct t_weechat_plugin *plugin, const char *info_name,
 {
     struct t_hook *ptr_hook, *next_hook;
     const char *value;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) plugin;
@@ -3106,11 +4972,13 @@ hook_info_get (struct t_weechat_plugin *plugin, const char *info_name,
                                    info_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             value = (HOOK_INFO(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  info_name,
                  arguments);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3187,6 +5055,7 @@ hook_info_get_hashtable (struct t_weechat_plugin *plugin, const char *info_name,
 {
     struct t_hook *ptr_hook, *next_hook;
     struct t_hashtable *value;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) plugin;
@@ -3207,11 +5076,13 @@ hook_info_get_hashtable (struct t_weechat_plugin *plugin, const char *info_name,
                                    info_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             value = (HOOK_INFO_HASHTABLE(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  info_name,
                  hashtable);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3288,6 +5159,7 @@ hook_infolist_get (struct t_weechat_plugin *plugin, const char *infolist_name,
 {
     struct t_hook *ptr_hook, *next_hook;
     struct t_infolist *value;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) plugin;
@@ -3308,12 +5180,14 @@ hook_infolist_get (struct t_weechat_plugin *plugin, const char *infolist_name,
                                    infolist_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             value = (HOOK_INFOLIST(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  infolist_name,
                  pointer,
                  arguments);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3384,6 +5258,7 @@ hook_hdata_get (struct t_weechat_plugin *plugin, const char *hdata_name)
 {
     struct t_hook *ptr_hook, *next_hook;
     struct t_hdata *value;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) plugin;
@@ -3410,10 +5285,12 @@ hook_hdata_get (struct t_weechat_plugin *plugin, const char *hdata_name)
             && (strcmp (HOOK_HDATA(ptr_hook, hdata_name), hdata_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             value = (HOOK_HDATA(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  HOOK_HDATA(ptr_hook, hdata_name));
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3538,6 +5415,7 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
     const char *focus1_chat, *focus1_bar_item_name, *keys;
     char **list_keys, *new_key;
     int num_keys, i, length, focus1_is_chat;
+    struct t_hook_exec_cb hook_exec_cb;
 
     if (!hashtable_focus1)
         return NULL;
@@ -3567,10 +5445,12 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
         {
             /* run callback for focus #1 */
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &hook_exec_cb);
             hashtable_ret = (HOOK_FOCUS(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  hashtable1);
+            hook_callback_end (ptr_hook, &hook_exec_cb);
             ptr_hook->running = 0;
             if (hashtable_ret)
             {
@@ -3591,10 +5471,12 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
             if (hashtable2)
             {
                 ptr_hook->running = 1;
+                hook_callback_start (ptr_hook, &hook_exec_cb);
                 hashtable_ret = (HOOK_FOCUS(ptr_hook, callback))
                     (ptr_hook->callback_pointer,
                      ptr_hook->callback_data,
                      hashtable2);
+                hook_callback_end (ptr_hook, &hook_exec_cb);
                 ptr_hook->running = 0;
                 if (hashtable_ret)
                 {
@@ -3754,6 +5636,13 @@ unhook (struct t_hook *hook)
                          plugin_get_name (hook->plugin));
     }
 
+    /* remove hook from index (it uses data specific to the hook) */
+    hook_index_remove (hook);
+
+    /* keep execution statistics of hook (profiling) */
+    if (hook_profile_removed)
+        hook_profile_add_to_owners (hook_profile_removed, hook);
+
     /* free data specific to the hook */
     if (hook->hook_data)
     {
@@ -3832,8 +5721,10 @@ unhook (struct t_hook *hook)
                 }
                 break;
             case HOOK_TYPE_TIMER:
+                hook_timer_heap_remove (hook);
                 break;
             case HOOK_TYPE_FD:
+                hook_fd_remove (hook);
                 break;
             case HOOK_TYPE_PROCESS:
                 if (HOOK_PROCESS(hook, command))
@@ -3872,6 +5763,11 @@ unhook (struct t_hook *hook)
                     waitpid (HOOK_PROCESS(hook, child_pid), NULL, 0);
                     HOOK_PROCESS(hook, child_pid) = 0;
                 }
+                if (HOOK_PROCESS(hook, url_transfer))
+                {
+                    weeurl_transfer_cancel (HOOK_PROCESS(hook, url_transfer));
+                    HOOK_PROCESS(hook, url_transfer) = NULL;
+                }
                 if (HOOK_PROCESS(hook, child_read[HOOK_PROCESS_STDIN]) != -1)
                 {
                     close (HOOK_PROCESS(hook, child_read[HOOK_PROCESS_STDIN]));
@@ -3941,10 +5837,10 @@ unhook (struct t_hook *hook)
                     free (HOOK_CONNECT(hook, local_hostname));
                     HOOK_CONNECT(hook, local_hostname) = NULL;
                 }
-                if (HOOK_CONNECT(hook, hook_child_timer))
+                if (HOOK_CONNECT(hook, hook_timer))
                 {
-                    unhook (HOOK_CONNECT(hook, hook_child_timer));
-                    HOOK_CONNECT(hook, hook_child_timer) = NULL;
+                    unhook (HOOK_CONNECT(hook, hook_timer));
+                    HOOK_CONNECT(hook, hook_timer) = NULL;
                 }
                 if (HOOK_CONNECT(hook, hook_fd))
                 {
@@ -3966,47 +5862,10 @@ unhook (struct t_hook *hook)
                     free (HOOK_CONNECT(hook, handshake_ip_address));
                     HOOK_CONNECT(hook, handshake_ip_address) = NULL;
                 }
-                if (HOOK_CONNECT(hook, child_pid) > 0)
-                {
-                    kill (HOOK_CONNECT(hook, child_pid), SIGKILL);
-                    waitpid (HOOK_CONNECT(hook, child_pid), NULL, 0);
-                    HOOK_CONNECT(hook, child_pid) = 0;
-                }
-                if (HOOK_CONNECT(hook, child_read) != -1)
-                {
-                    close (HOOK_CONNECT(hook, child_read));
-                    HOOK_CONNECT(hook, child_read) = -1;
-                }
-                if (HOOK_CONNECT(hook, child_write) != -1)
-                {
-                    close (HOOK_CONNECT(hook, child_write));
-                    HOOK_CONNECT(hook, child_write) = -1;
-                }
-                if (HOOK_CONNECT(hook, child_recv) != -1)
-                {
-                    close (HOOK_CONNECT(hook, child_recv));
-                    HOOK_CONNECT(hook, child_recv) = -1;
-                }
-                if (HOOK_CONNECT(hook, child_send) != -1)
-                {
-                    close (HOOK_CONNECT(hook, child_send));
-                    HOOK_CONNECT(hook, child_send) = -1;
-                }
-                if (!hook_socketpair_ok)
+                if (HOOK_CONNECT(hook, request))
                 {
-                    for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-                    {
-                        if (HOOK_CONNECT(hook, sock_v4[i]) != -1)
-                        {
-                            close (HOOK_CONNECT(hook, sock_v4[i]));
-                            HOOK_CONNECT(hook, sock_v4[i]) = -1;
-                        }
-                        if (HOOK_CONNECT(hook, sock_v6[i]) != -1)
-                        {
-                            close (HOOK_CONNECT(hook, sock_v6[i]));
-                            HOOK_CONNECT(hook, sock_v6[i]) = -1;
-                        }
-                    }
+                    network_connect_request_cancel (HOOK_CONNECT(hook, request));
+                    HOOK_CONNECT(hook, request) = NULL;
                 }
                 break;
             case HOOK_TYPE_PRINT:
@@ -4019,6 +5878,11 @@ unhook (struct t_hook *hook)
                     free (HOOK_PRINT(hook, tags_array));
                     HOOK_PRINT(hook, tags_array) = NULL;
                 }
+                if (HOOK_PRINT(hook, tags_match))
+                {
+                    gui_line_tags_match_free (HOOK_PRINT(hook, tags_match));
+                    HOOK_PRINT(hook, tags_match) = NULL;
+                }
                 if (HOOK_PRINT(hook, message))
                 {
                     free (HOOK_PRINT(hook, message));
@@ -4231,6 +6095,24 @@ unhook_all ()
             ptr_hook = next_hook;
         }
     }
+
+    hook_index_free_all ();
+    hook_timer_heap_free ();
+
+    hook_fd_set_backend (HOOK_FD_BACKEND_POLL);
+    if (hook_fd_table)
+    {
+        free (hook_fd_table);
+        hook_fd_table = NULL;
+        hook_fd_table_size = 0;
+    }
+
+    hook_profile = 0;
+    if (hook_profile_removed)
+    {
+        hashtable_free (hook_profile_removed);
+        hook_profile_removed = NULL;
+    }
 }
 
 /*
@@ -4273,6 +6155,15 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
         return 0;
     if (!infolist_new_var_pointer (ptr_item, "callback_data", (void *)hook->callback_data))
         return 0;
+    snprintf (value, sizeof (value), "%llu", hook->stats.calls);
+    if (!infolist_new_var_string (ptr_item, "stats_calls", value))
+        return 0;
+    snprintf (value, sizeof (value), "%lld", hook->stats.time_total);
+    if (!infolist_new_var_string (ptr_item, "stats_time_total", value))
+        return 0;
+    snprintf (value, sizeof (value), "%lld", hook->stats.time_max);
+    if (!infolist_new_var_string (ptr_item, "stats_time_max", value))
+        return 0;
     switch (hook->type)
     {
         case HOOK_TYPE_COMMAND:
@@ -4381,6 +6272,8 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
                     return 0;
                 if (!infolist_new_var_integer (ptr_item, "child_pid", HOOK_PROCESS(hook, child_pid)))
                     return 0;
+                if (!infolist_new_var_pointer (ptr_item, "url_transfer", HOOK_PROCESS(hook, url_transfer)))
+                    return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_fd_stdin", HOOK_PROCESS(hook, hook_fd[HOOK_PROCESS_STDIN])))
                     return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_fd_stdout", HOOK_PROCESS(hook, hook_fd[HOOK_PROCESS_STDOUT])))
@@ -4416,17 +6309,22 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
 #endif /* HAVE_GNUTLS */
                 if (!infolist_new_var_string (ptr_item, "local_hostname", HOOK_CONNECT(hook, local_hostname)))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_read", HOOK_CONNECT(hook, child_read)))
+                /* deprecated: no child process since version 1.8 */
+                if (!infolist_new_var_integer (ptr_item, "child_read", -1))
+                    return 0;
+                if (!infolist_new_var_integer (ptr_item, "child_write", -1))
+                    return 0;
+                if (!infolist_new_var_integer (ptr_item, "child_recv", -1))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_write", HOOK_CONNECT(hook, child_write)))
+                if (!infolist_new_var_integer (ptr_item, "child_send", -1))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_recv", HOOK_CONNECT(hook, child_recv)))
+                if (!infolist_new_var_integer (ptr_item, "child_pid", 0))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_send", HOOK_CONNECT(hook, child_send)))
+                if (!infolist_new_var_pointer (ptr_item, "hook_child_timer", NULL))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_pid", HOOK_CONNECT(hook, child_pid)))
+                if (!infolist_new_var_pointer (ptr_item, "request", HOOK_CONNECT(hook, request)))
                     return 0;
-                if (!infolist_new_var_pointer (ptr_item, "hook_child_timer", HOOK_CONNECT(hook, hook_child_timer)))
+                if (!infolist_new_var_pointer (ptr_item, "hook_timer", HOOK_CONNECT(hook, hook_timer)))
                     return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_fd", HOOK_CONNECT(hook, hook_fd)))
                     return 0;
@@ -4721,6 +6619,84 @@ hook_add_to_infolist (struct t_infolist *infolist, struct t_hook *pointer,
     return 1;
 }
 
+/*
+ * Adds execution statistics of an owner in an infolist (callback called for
+ * each owner in hashtable).
+ */
+
+void
+hook_stats_add_to_infolist_map_cb (void *data, struct t_hashtable *hashtable,
+                                   const void *key, const void *value)
+{
+    void **map_data;
+    struct t_infolist_item *ptr_item;
+    struct t_hook_stats *ptr_stats;
+    const char *mask;
+    char str_value[64];
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    map_data = (void **)data;
+    mask = (const char *)map_data[1];
+    ptr_stats = (struct t_hook_stats *)value;
+
+    if (mask && mask[0] && !string_match ((const char *)key, mask, 0))
+        return;
+
+    ptr_item = infolist_new_item ((struct t_infolist *)map_data[0]);
+    if (!ptr_item)
+        return;
+
+    if (!infolist_new_var_string (ptr_item, "owner", (const char *)key))
+        return;
+    snprintf (str_value, sizeof (str_value), "%llu", ptr_stats->calls);
+    if (!infolist_new_var_string (ptr_item, "calls", str_value))
+        return;
+    snprintf (str_value, sizeof (str_value), "%lld", ptr_stats->time_total);
+    if (!infolist_new_var_string (ptr_item, "time_total", str_value))
+        return;
+    snprintf (str_value, sizeof (str_value), "%lld", ptr_stats->time_max);
+    if (!infolist_new_var_string (ptr_item, "time_max", str_value))
+        return;
+}
+
+/*
+ * Adds execution statistics of hooks by owner (plugin/script) in an infolist.
+ *
+ * Owner is "core", a plugin name (for example "irc") or "plugin/script" for
+ * a script (for example "python/myscript").
+ *
+ * Argument "mask" is a mask on owner (wildcard "*" is allowed), for example:
+ * "python*"; if NULL or empty string, all owners are added.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hook_stats_add_to_infolist (struct t_infolist *infolist, const char *mask)
+{
+    struct t_hashtable *owners;
+    void *map_data[2];
+
+    if (!infolist)
+        return 0;
+
+    owners = hook_profile_get_owners ();
+    if (!owners)
+        return 0;
+
+    map_data[0] = infolist;
+    map_data[1] = (void *)mask;
+    hashtable_map (owners, &hook_stats_add_to_infolist_map_cb, map_data);
+
+    hashtable_free (owners);
+
+    return 1;
+}
+
 /*
  * Prints hooks in WeeChat log file (usually for crash dump).
  */
@@ -4749,8 +6725,12 @@ hook_print_log ()
             log_printf ("  deleted . . . . . . . . : %d",    ptr_hook->deleted);
             log_printf ("  running . . . . . . . . : %d",    ptr_hook->running);
             log_printf ("  priority. . . . . . . . : %d",    ptr_hook->priority);
+            log_printf ("  order . . . . . . . . . : %llu",  ptr_hook->order);
             log_printf ("  callback_pointer. . . . : 0x%lx", ptr_hook->callback_pointer);
             log_printf ("  callback_data . . . . . : 0x%lx", ptr_hook->callback_data);
+            log_printf ("  stats.calls . . . . . . : %llu",  ptr_hook->stats.calls);
+            log_printf ("  stats.time_total. . . . : %lld", ptr_hook->stats.time_total);
+            log_printf ("  stats.time_max. . . . . : %lld", ptr_hook->stats.time_max);
             if (ptr_hook->deleted)
                 continue;
             switch (ptr_hook->type)
@@ -4845,6 +6825,7 @@ hook_print_log ()
                     log_printf ("    child_read[stderr]. . : %d",    HOOK_PROCESS(ptr_hook, child_read[HOOK_PROCESS_STDERR]));
                     log_printf ("    child_write[stderr] . : %d",    HOOK_PROCESS(ptr_hook, child_write[HOOK_PROCESS_STDERR]));
                     log_printf ("    child_pid . . . . . . : %d",    HOOK_PROCESS(ptr_hook, child_pid));
+                    log_printf ("    url_transfer. . . . . : 0x%lx", HOOK_PROCESS(ptr_hook, url_transfer));
                     log_printf ("    hook_fd[stdin]. . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDIN]));
                     log_printf ("    hook_fd[stdout] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDOUT]));
                     log_printf ("    hook_fd[stderr] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDERR]));
@@ -4865,25 +6846,13 @@ hook_print_log ()
                     log_printf ("    gnutls_priorities . . : '%s'",  HOOK_CONNECT(ptr_hook, gnutls_priorities));
 #endif /* HAVE_GNUTLS */
                     log_printf ("    local_hostname. . . . : '%s'",  HOOK_CONNECT(ptr_hook, local_hostname));
-                    log_printf ("    child_read. . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_read));
-                    log_printf ("    child_write . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_write));
-                    log_printf ("    child_recv. . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_recv));
-                    log_printf ("    child_send. . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_send));
-                    log_printf ("    child_pid . . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_pid));
-                    log_printf ("    hook_child_timer. . . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_child_timer));
+                    log_printf ("    request . . . . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, request));
+                    log_printf ("    hook_timer. . . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_timer));
                     log_printf ("    hook_fd . . . . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_fd));
                     log_printf ("    handshake_hook_fd . . : 0x%lx", HOOK_CONNECT(ptr_hook, handshake_hook_fd));
                     log_printf ("    handshake_hook_timer. : 0x%lx", HOOK_CONNECT(ptr_hook, handshake_hook_timer));
                     log_printf ("    handshake_fd_flags. . : %d",    HOOK_CONNECT(ptr_hook, handshake_fd_flags));
                     log_printf ("    handshake_ip_address. : '%s'",  HOOK_CONNECT(ptr_hook, handshake_ip_address));
-                    if (!hook_socketpair_ok)
-                    {
-                        for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-                        {
-                            log_printf ("    sock_v4[%d]. . . . . . : '%d'", HOOK_CONNECT(ptr_hook, sock_v4[i]));
-                            log_printf ("    sock_v6[%d]. . . . . . : '%d'", HOOK_CONNECT(ptr_hook, sock_v6[i]));
-                        }
-                    }
                     break;
                 case HOOK_TYPE_PRINT:
                     log_printf ("  print data:");
@@ -4891,6 +6860,7 @@ hook_print_log ()
                     log_printf ("    buffer. . . . . . . . : 0x%lx", HOOK_PRINT(ptr_hook, buffer));
                     log_printf ("    tags_count. . . . . . : %d",    HOOK_PRINT(ptr_hook, tags_count));
                     log_printf ("    tags_array. . . . . . : 0x%lx", HOOK_PRINT(ptr_hook, tags_array));
+                    log_printf ("    tags_match. . . . . . : 0x%lx", HOOK_PRINT(ptr_hook, tags_match));
                     log_printf ("    message . . . . . . . : '%s'",  HOOK_PRINT(ptr_hook, message));
                     log_printf ("    strip_colors. . . . . : %d",    HOOK_PRINT(ptr_hook, strip_colors));
                     break;
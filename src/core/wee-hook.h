@@ -28,16 +28,16 @@
 #include <gnutls/gnutls.h>
 #endif
 
-/* used if socketpair() function is NOT available */
-#define HOOK_CONNECT_MAX_SOCKETS 4
-
 struct t_gui_bar;
 struct t_gui_buffer;
 struct t_gui_line;
+struct t_gui_line_tags_match;
 struct t_gui_completion;
 struct t_gui_window;
 struct t_weelist;
 struct t_hashtable;
+struct t_network_connect_request;
+struct t_url_transfer;
 struct t_infolist;
 
 /* hook types */
@@ -82,11 +82,29 @@ enum t_hook_type
 #define HOOK_COMMAND_EXEC_AMBIGUOUS_INCOMPLETE -3
 #define HOOK_COMMAND_EXEC_RUNNING              -4
 
+/* sort keys for execution statistics of hooks (profiling) */
+#define HOOK_STATS_SORT_CALLS   0
+#define HOOK_STATS_SORT_TOTAL   1
+#define HOOK_STATS_SORT_MAX     2
+
+/* number of hooks matched without allocating memory (signal/hsignal) */
+#define HOOK_INDEX_STATIC_SIZE  32
+
+/* number of timers executed at once without allocating memory */
+#define HOOK_TIMER_STATIC_SIZE  32
+
 /* flags for fd hooks */
 #define HOOK_FD_FLAG_READ       1
 #define HOOK_FD_FLAG_WRITE      2
 #define HOOK_FD_FLAG_EXCEPTION  4
 
+/* backends used to watch file descriptors of fd hooks */
+#define HOOK_FD_BACKEND_POLL    0
+#define HOOK_FD_BACKEND_EPOLL   1
+
+/* max events returned by one call to epoll_wait() */
+#define HOOK_FD_EPOLL_MAX_EVENTS 256
+
 /* constants for hook process */
 #define HOOK_PROCESS_STDIN       0
 #define HOOK_PROCESS_STDOUT      1
@@ -112,6 +130,23 @@ enum t_hook_type
 #define HOOK_HDATA(hook, var) (((struct t_hook_hdata *)hook->hook_data)->var)
 #define HOOK_FOCUS(hook, var) (((struct t_hook_focus *)hook->hook_data)->var)
 
+/* execution statistics of hooks (when profiling is enabled) */
+
+struct t_hook_stats
+{
+    unsigned long long calls;          /* number of callbacks executed      */
+    long long time_total;              /* total time in callbacks (in us)   */
+    long long time_max;                /* longest callback (in us)          */
+};
+
+/* data kept during execution of a hook callback */
+
+struct t_hook_exec_cb
+{
+    int profile;                       /* 1 if callback is profiled         */
+    struct timeval start_time;         /* start time of callback            */
+};
+
 struct t_hook
 {
     /* data common to all hooks */
@@ -125,8 +160,11 @@ struct t_hook
     int deleted;                       /* hook marked for deletion ?        */
     int running;                       /* 1 if hook is currently running    */
     int priority;                      /* priority (to sort hooks)          */
+    unsigned long long order;          /* creation order (to sort hooks     */
+                                       /* with same priority)               */
     const void *callback_pointer;      /* pointer sent to callback          */
     void *callback_data;               /* data sent to callback             */
+    struct t_hook_stats stats;         /* execution statistics (profiling)  */
 
     /* hook data (depends on hook type) */
     void *hook_data;                   /* hook specific data                */
@@ -134,6 +172,33 @@ struct t_hook
     struct t_hook *next_hook;          /* link to next hook                 */
 };
 
+/*
+ * index of hooks by name (used for signals, hsignals and modifiers): hooks
+ * with an exact name are grouped by name in a hashtable, hooks with a mask
+ * (containing "*") are in a separate list; all lists are sorted like the list
+ * of hooks (priority, then creation order)
+ */
+
+struct t_hook_index
+{
+    struct t_hashtable *names;         /* exact name -> arraylist of hooks  */
+    struct t_arraylist *masks;         /* hooks with a mask                 */
+};
+
+/*
+ * index of print hooks: hooks for one buffer are grouped by buffer, hooks for
+ * all buffers with tags are grouped by a tag required in the line (one per
+ * set of tags), other hooks are checked for all lines; all lists are sorted
+ * like the list of hooks
+ */
+
+struct t_hook_print_index
+{
+    struct t_hashtable *buffers;       /* buffer -> arraylist of hooks      */
+    struct t_hashtable *tags;          /* tag -> arraylist of hooks         */
+    struct t_arraylist *others;        /* hooks checked for all lines       */
+};
+
 /* hook command */
 
 typedef int (t_hook_callback_command)(const void *pointer, void *data,
@@ -190,6 +255,8 @@ struct t_hook_timer
     int remaining_calls;               /* calls remaining (0 = unlimited)   */
     struct timeval last_exec;          /* last time hook was executed       */
     struct timeval next_exec;          /* next scheduled execution          */
+    int heap_index;                    /* index in heap of timers (-1 if    */
+                                       /* not in heap)                      */
 };
 
 /* hook fd */
@@ -203,6 +270,9 @@ struct t_hook_fd
     int flags;                         /* fd flags (read,write,..)          */
     int error;                         /* contains errno if error occurred  */
                                        /* with fd                           */
+    int always_ready;                  /* 1 if fd can not be watched with   */
+                                       /* epoll (like a regular file): it   */
+                                       /* is always ready (like with poll())*/
 };
 
 /* hook process */
@@ -222,6 +292,7 @@ struct t_hook_process
     int child_read[3];                 /* read stdin/out/err data from child*/
     int child_write[3];                /* write stdin/out/err data for child*/
     pid_t child_pid;                   /* pid of child process              */
+    struct t_url_transfer *url_transfer; /* URL transfer (in a thread)      */
     struct t_hook *hook_fd[3];         /* hook fd for stdin/out/err         */
     struct t_hook *hook_timer;         /* timer to check if child has died  */
     char *buffer[3];                   /* buffers for child stdin/out/err   */
@@ -266,20 +337,13 @@ struct t_hook_connect
     char *gnutls_priorities;           /* GnuTLS priorities                 */
 #endif /* HAVE_GNUTLS */
     char *local_hostname;              /* force local hostname (optional)   */
-    int child_read;                    /* to read data in pipe from child   */
-    int child_write;                   /* to write data in pipe for child   */
-    int child_recv;                    /* to read data from child socket    */
-    int child_send;                    /* to write data to child socket     */
-    pid_t child_pid;                   /* pid of child process (connecting) */
-    struct t_hook *hook_child_timer;   /* timer for child process timeout   */
-    struct t_hook *hook_fd;            /* pointer to fd hook                */
+    struct t_network_connect_request *request; /* resolve/connect request   */
+    struct t_hook *hook_timer;         /* timer for connection timeout      */
+    struct t_hook *hook_fd;            /* fd hook (resolver pipe or socket) */
     struct t_hook *handshake_hook_fd;  /* fd hook for handshake             */
     struct t_hook *handshake_hook_timer; /* timer for handshake timeout     */
     int handshake_fd_flags;            /* socket flags saved for handshake  */
     char *handshake_ip_address;        /* ip address (used for handshake)   */
-    /* sockets used if socketpair() is NOT available */
-    int sock_v4[HOOK_CONNECT_MAX_SOCKETS];  /* IPv4 sockets for connecting  */
-    int sock_v6[HOOK_CONNECT_MAX_SOCKETS];  /* IPv6 sockets for connecting  */
 };
 
 /* hook print */
@@ -297,6 +361,7 @@ struct t_hook_print
     struct t_gui_buffer *buffer;       /* buffer selected (NULL = all)      */
     int tags_count;                    /* number of tags selected           */
     char ***tags_array;                /* tags selected (NULL = any)        */
+    struct t_gui_line_tags_match *tags_match; /* tags compiled (fast match) */
     char *message;                     /* part of message (NULL/empty = all)*/
     int strip_colors;                  /* strip colors in msg for callback? */
 };
@@ -445,12 +510,24 @@ extern struct t_hook *weechat_hooks[];
 extern struct t_hook *last_weechat_hook[];
 extern int hooks_count[];
 extern int hooks_count_total;
-extern int hook_socketpair_ok;
+extern int hook_fd_backend;
+extern int hook_profile;
 
 /* hook functions */
 
 extern void hook_init ();
 extern int hook_valid (struct t_hook *hook);
+extern void hook_callback_start (struct t_hook *hook,
+                                 struct t_hook_exec_cb *hook_exec_cb);
+extern void hook_callback_end (struct t_hook *hook,
+                               struct t_hook_exec_cb *hook_exec_cb);
+extern void hook_get_owner (struct t_hook *hook, char *owner, int size);
+extern const char *hook_get_description (struct t_hook *hook);
+extern void hook_profile_set (int enable);
+extern void hook_profile_reset ();
+extern struct t_hashtable *hook_profile_get_owners ();
+extern int hook_stats_cmp (struct t_hook_stats *stats1,
+                           struct t_hook_stats *stats2, int sort);
 extern struct t_hook *hook_command (struct t_weechat_plugin *plugin,
                                     const char *command,
                                     const char *description,
@@ -483,6 +560,8 @@ extern struct t_hook *hook_fd (struct t_weechat_plugin *plugin, int fd,
                                t_hook_callback_fd *callback,
                                const void *callback_pointer,
                                void *callback_data);
+extern void hook_fd_set_flags (struct t_hook *hook, int flags);
+extern void hook_fd_set_backend (int backend);
 extern void hook_fd_exec ();
 extern struct t_hook *hook_process (struct t_weechat_plugin *plugin,
                                     const char *command,
@@ -569,6 +648,7 @@ extern struct t_hook *hook_modifier (struct t_weechat_plugin *plugin,
                                      t_hook_callback_modifier *callback,
                                      const void *callback_pointer,
                                      void *callback_data);
+extern int hook_modifier_exists (const char *modifier);
 extern char *hook_modifier_exec (struct t_weechat_plugin *plugin,
                                  const char *modifier,
                                  const char *modifier_data,
@@ -630,6 +710,8 @@ extern void unhook_all ();
 extern int hook_add_to_infolist (struct t_infolist *infolist,
                                  struct t_hook *hook,
                                  const char *arguments);
+extern int hook_stats_add_to_infolist (struct t_infolist *infolist,
+                                       const char *mask);
 extern void hook_print_log ();
 
 #endif /* WEECHAT_HOOK_H */
@@ -26,10 +26,8 @@
 #include "config.h"
 #endif
 
-/* _XPG4_2 is needed on SunOS for macros like CMSG_SPACE */
 /* __EXTENSIONS__ is needed on SunOS for constants like NI_MAXHOST */
 #ifdef __sun
-#define _XPG4_2
 #define __EXTENSIONS__
 #endif
 
@@ -46,11 +44,11 @@
 #include <netdb.h>
 #include <resolv.h>
 #include <errno.h>
+#include <signal.h>
+#include <pthread.h>
 #include <gcrypt.h>
 #include <sys/time.h>
-#if defined(__OpenBSD__)
-#include <sys/uio.h>
-#endif
+#include <time.h>
 
 #ifdef HAVE_GNUTLS
 #include <gnutls/gnutls.h>
@@ -68,11 +66,24 @@
 
 int network_init_gnutls_ok = 0;
 
+/* threads used for connection requests (hook_connect) */
+pthread_mutex_t network_connect_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t network_connect_cond = PTHREAD_COND_INITIALIZER;
+struct t_network_connect_request *network_connect_queue = NULL;
+struct t_network_connect_request *last_network_connect_queue = NULL;
+int network_connect_threads = 0;       /* number of threads running         */
+int network_connect_threads_idle = 0;  /* threads waiting for a request     */
+int network_connect_quit = 0;          /* 1 if threads must exit            */
+
 #ifdef HAVE_GNUTLS
 gnutls_certificate_credentials_t gnutls_xcred; /* GnuTLS client credentials */
 #endif /* HAVE_GNUTLS */
 
 
+int network_connect_read_cb (const void *pointer, void *data, int fd);
+int network_connect_fd_cb (const void *pointer, void *data, int fd);
+
+
 /*
  * Initializes gcrypt.
  */
@@ -154,6 +165,12 @@ network_init_gnutls ()
 void
 network_end ()
 {
+    /* ask threads to exit (requests in progress are not waited) */
+    pthread_mutex_lock (&network_connect_mutex);
+    network_connect_quit = 1;
+    pthread_cond_broadcast (&network_connect_cond);
+    pthread_mutex_unlock (&network_connect_mutex);
+
     if (network_init_gnutls_ok)
     {
 #ifdef HAVE_GNUTLS
@@ -168,74 +185,156 @@ network_end ()
 }
 
 /*
- * Sends data on a socket with retry.
+ * Checks if a connection request has been cancelled (hook removed).
+ *
+ * This function is called by a connection thread.
+ *
+ * Returns:
+ *   1: request cancelled
+ *   0: request not cancelled (or no request)
+ */
+
+int
+network_connect_request_cancelled (struct t_network_connect_request *request)
+{
+    int cancelled;
+
+    if (!request)
+        return 0;
+
+    pthread_mutex_lock (&network_connect_mutex);
+    cancelled = request->cancelled;
+    pthread_mutex_unlock (&network_connect_mutex);
+
+    return cancelled;
+}
+
+/*
+ * Waits until a socket is ready for the events (POLLIN or POLLOUT).
+ *
+ * The wait is stopped if the connection request is cancelled (if request is
+ * not NULL) or if the time "deadline" is reached.
+ *
+ * Returns:
+ *   1: socket is ready
+ *   0: error, timeout or request cancelled
+ */
+
+int
+network_wait_socket (struct t_network_connect_request *request, int sock,
+                     short events, time_t deadline)
+{
+    struct pollfd poll_fd;
+    int ready;
+
+    while (1)
+    {
+        if (network_connect_request_cancelled (request)
+            || (time (NULL) >= deadline))
+        {
+            return 0;
+        }
+        poll_fd.fd = sock;
+        poll_fd.events = events;
+        poll_fd.revents = 0;
+        ready = poll (&poll_fd, 1, NETWORK_PROXY_POLL_INTERVAL);
+        if (ready > 0)
+            return 1;
+        if ((ready < 0) && (errno != EINTR))
+            return 0;
+    }
+}
+
+/*
+ * Sends data on a socket with retry (during NETWORK_PROXY_TIMEOUT seconds
+ * max).
+ *
+ * Argument "request" is the connection request if the function is called in
+ * a connection thread (it can be NULL): the function returns as soon as the
+ * request is cancelled.
  *
  * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * process or in a thread.
  *
- * Returns number of bytes sent, -1 if error.
+ * Returns number of bytes sent: it is lower than "length" if an error occurred
+ * or if the timeout or cancel of request was reached, so the caller must
+ * compare the result with "length".
  */
 
 int
-network_send_with_retry (int sock, const void *buffer, int length, int flags)
+network_send_with_retry (struct t_network_connect_request *request, int sock,
+                         const void *buffer, int length, int flags)
 {
     int total_sent, num_sent;
+    time_t deadline;
 
     total_sent = 0;
-
-    num_sent = send (sock, buffer, length, flags);
-    if (num_sent > 0)
-        total_sent += num_sent;
+    deadline = time (NULL) + NETWORK_PROXY_TIMEOUT;
 
     while (total_sent < length)
     {
-        if ((num_sent == -1) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
-            return total_sent;
-        usleep (100);
-        num_sent = send (sock, buffer + total_sent, length - total_sent, flags);
+        if (!network_wait_socket (request, sock, POLLOUT, deadline))
+            break;
+        num_sent = send (sock, buffer + total_sent, length - total_sent,
+                         flags);
         if (num_sent > 0)
+        {
             total_sent += num_sent;
+        }
+        else if ((num_sent == 0)
+                 || ((errno != EAGAIN) && (errno != EWOULDBLOCK)
+                     && (errno != EINTR)))
+        {
+            break;
+        }
     }
+
     return total_sent;
 }
 
 /*
- * Receives data on a socket with retry.
+ * Receives data on a socket with retry (during NETWORK_PROXY_TIMEOUT seconds
+ * max).
+ *
+ * Argument "request" is the connection request if the function is called in
+ * a connection thread (it can be NULL): the function returns as soon as the
+ * request is cancelled.
  *
  * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * process or in a thread.
  *
  * Returns number of bytes received, -1 if error.
  */
 
 int
-network_recv_with_retry (int sock, void *buffer, int length, int flags)
+network_recv_with_retry (struct t_network_connect_request *request, int sock,
+                         void *buffer, int length, int flags)
 {
-    int total_recv, num_recv;
-
-    total_recv = 0;
+    int num_recv;
+    time_t deadline;
 
-    num_recv = recv (sock, buffer, length, flags);
-    if (num_recv > 0)
-        total_recv += num_recv;
+    deadline = time (NULL) + NETWORK_PROXY_TIMEOUT;
 
-    while (num_recv == -1)
+    while (network_wait_socket (request, sock, POLLIN, deadline))
     {
-        if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
-            return total_recv;
-        usleep (100);
-        num_recv = recv (sock, buffer + total_recv, length - total_recv, flags);
-        if (num_recv > 0)
-            total_recv += num_recv;
+        num_recv = recv (sock, buffer, length, flags);
+        if (num_recv >= 0)
+            return num_recv;
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+            break;
     }
-    return total_recv;
+
+    return -1;
 }
 
 /*
  * Establishes a connection and authenticates with a HTTP proxy.
  *
+ * Username and password are already evaluated (authentication is used only
+ * if username is not NULL and not empty).
+ *
  * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * process or in a thread.
  *
  * Returns:
  *   1: OK
@@ -243,30 +342,18 @@ network_recv_with_retry (int sock, void *buffer, int length, int flags)
  */
 
 int
-network_pass_httpproxy (struct t_proxy *proxy, int sock, const char *address,
-                        int port)
+network_pass_httpproxy (struct t_network_connect_request *request,
+                        const char *username, const char *password, int sock,
+                        const char *address, int port)
 {
-    char buffer[256], authbuf[128], authbuf_base64[512], *username, *password;
+    char buffer[256], authbuf[128], authbuf_base64[512];
     int length;
 
-    if (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])
-        && CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])[0])
+    if (username && username[0])
     {
         /* authentication */
-        username = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]),
-                                    NULL, NULL, NULL);
-        if (!username)
-            return 0;
-        password = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_PASSWORD]),
-                                    NULL, NULL, NULL);
-        if (!password)
-        {
-            free (username);
-            return 0;
-        }
-        snprintf (authbuf, sizeof (authbuf), "%s:%s", username, password);
-        free (username);
-        free (password);
+        snprintf (authbuf, sizeof (authbuf), "%s:%s",
+                  username, (password) ? password : "");
         string_encode_base64 (authbuf, strlen (authbuf), authbuf_base64);
         length = snprintf (buffer, sizeof (buffer),
                            "CONNECT %s:%d HTTP/1.0\r\nProxy-Authorization: "
@@ -280,11 +367,11 @@ network_pass_httpproxy (struct t_proxy *proxy, int sock, const char *address,
                            "CONNECT %s:%d HTTP/1.0\r\n\r\n", address, port);
     }
 
-    if (network_send_with_retry (sock, buffer, length, 0) != length)
+    if (network_send_with_retry (request, sock, buffer, length, 0) != length)
         return 0;
 
     /* success result must be like: "HTTP/1.0 200 OK" */
-    if (network_recv_with_retry (sock, buffer, sizeof (buffer), 0) < 12)
+    if (network_recv_with_retry (request, sock, buffer, sizeof (buffer), 0) < 12)
         return 0;
 
     if (memcmp (buffer, "HTTP/", 5) || memcmp (buffer + 9, "200", 3))
@@ -347,7 +434,7 @@ network_resolve (const char *hostname, char *ip, int *version)
  * The socks4 protocol is explained here: http://en.wikipedia.org/wiki/SOCKS
  *
  * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * process or in a thread.
  *
  * Returns:
  *   1: OK
@@ -355,33 +442,27 @@ network_resolve (const char *hostname, char *ip, int *version)
  */
 
 int
-network_pass_socks4proxy (struct t_proxy *proxy, int sock, const char *address,
+network_pass_socks4proxy (struct t_network_connect_request *request,
+                          const char *username, int sock, const char *address,
                           int port)
 {
     struct t_network_socks4 socks4;
     unsigned char buffer[24];
-    char ip_addr[NI_MAXHOST], *username;
+    char ip_addr[NI_MAXHOST];
     int length;
 
-    username = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]),
-                                NULL, NULL, NULL);
-    if (!username)
-        return 0;
-
     socks4.version = 4;
     socks4.method = 1;
     socks4.port = htons (port);
     network_resolve (address, ip_addr, NULL);
     socks4.address = inet_addr (ip_addr);
-    strncpy (socks4.user, username, sizeof (socks4.user) - 1);
-
-    free (username);
+    strncpy (socks4.user, (username) ? username : "", sizeof (socks4.user) - 1);
 
     length = 8 + strlen (socks4.user) + 1;
-    if (network_send_with_retry (sock, (char *) &socks4, length, 0) != length)
+    if (network_send_with_retry (request, sock, (char *) &socks4, length, 0) != length)
         return 0;
 
-    if (network_recv_with_retry (sock, buffer, sizeof (buffer), 0) < 2)
+    if (network_recv_with_retry (request, sock, buffer, sizeof (buffer), 0) < 2)
         return 0;
 
     /* connection OK */
@@ -398,8 +479,11 @@ network_pass_socks4proxy (struct t_proxy *proxy, int sock, const char *address,
  * The socks5 protocol is explained in RFC 1928.
  * The socks5 authentication with username/pass is explained in RFC 1929.
  *
+ * Username and password are already evaluated (authentication is used only
+ * if username is not NULL and not empty).
+ *
  * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * process or in a thread.
  *
  * Returns:
  *   1: OK
@@ -407,33 +491,31 @@ network_pass_socks4proxy (struct t_proxy *proxy, int sock, const char *address,
  */
 
 int
-network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
-                          int port)
+network_pass_socks5proxy (struct t_network_connect_request *request,
+                          const char *username, const char *password,
+                          int sock, const char *address, int port)
 {
     struct t_network_socks5 socks5;
     unsigned char buffer[288];
     int username_len, password_len, addr_len, addr_buffer_len;
     unsigned char *addr_buffer;
-    char *username, *password;
 
     socks5.version = 5;
     socks5.nmethods = 1;
 
-    if (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])
-        && CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])[0])
+    if (username && username[0])
         socks5.method = 2; /* with authentication */
     else
         socks5.method = 0; /* without authentication */
 
-    if (network_send_with_retry (sock, (char *) &socks5, sizeof (socks5), 0) < (int)sizeof (socks5))
+    if (network_send_with_retry (request, sock, (char *) &socks5, sizeof (socks5), 0) < (int)sizeof (socks5))
         return 0;
 
     /* server socks5 must respond with 2 bytes */
-    if (network_recv_with_retry (sock, buffer, 2, 0) < 2)
+    if (network_recv_with_retry (request, sock, buffer, 2, 0) < 2)
         return 0;
 
-    if (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])
-        && CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])[0])
+    if (username && username[0])
     {
         /*
          * with authentication
@@ -446,17 +528,8 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
             return 0;
 
         /* authentication as in RFC 1929 */
-        username = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]),
-                                    NULL, NULL, NULL);
-        if (!username)
-            return 0;
-        password = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_PASSWORD]),
-                                    NULL, NULL, NULL);
         if (!password)
-        {
-            free (username);
-            return 0;
-        }
+            password = "";
         username_len = strlen (username);
         password_len = strlen (password);
 
@@ -467,14 +540,11 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
         buffer[2 + username_len] = (unsigned char) password_len;
         memcpy (buffer + 3 + username_len, password, password_len);
 
-        free (username);
-        free (password);
-
-        if (network_send_with_retry (sock, buffer, 3 + username_len + password_len, 0) < 3 + username_len + password_len)
+        if (network_send_with_retry (request, sock, buffer, 3 + username_len + password_len, 0) < 3 + username_len + password_len)
             return 0;
 
         /* server socks5 must respond with 2 bytes */
-        if (network_recv_with_retry (sock, buffer, 2, 0) < 2)
+        if (network_recv_with_retry (request, sock, buffer, 2, 0) < 2)
             return 0;
 
         /* buffer[1] = auth state, must be 0 for success */
@@ -507,7 +577,7 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
     memcpy (addr_buffer + 5, address, addr_len); /* server address */
     *((unsigned short *) (addr_buffer + 5 + addr_len)) = htons (port); /* server port */
 
-    if (network_send_with_retry (sock, addr_buffer, addr_buffer_len, 0) < addr_buffer_len)
+    if (network_send_with_retry (request, sock, addr_buffer, addr_buffer_len, 0) < addr_buffer_len)
     {
         free (addr_buffer);
         return 0;
@@ -515,7 +585,7 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
     free (addr_buffer);
 
     /* dialog with proxy server */
-    if (network_recv_with_retry (sock, buffer, 4, 0) < 4)
+    if (network_recv_with_retry (request, sock, buffer, 4, 0) < 4)
         return 0;
 
     if (!((buffer[0] == 5) && (buffer[1] == 0)))
@@ -530,7 +600,7 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
              * server socks return server bound address and port
              * address of 4 bytes and port of 2 bytes (= 6 bytes)
              */
-            if (network_recv_with_retry (sock, buffer, 6, 0) < 6)
+            if (network_recv_with_retry (request, sock, buffer, 6, 0) < 6)
                 return 0;
             break;
         case 3:
@@ -539,11 +609,11 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
              * server socks return server bound address and port
              */
             /* read address length */
-            if (network_recv_with_retry (sock, buffer, 1, 0) < 1)
+            if (network_recv_with_retry (request, sock, buffer, 1, 0) < 1)
                 return 0;
             addr_len = buffer[0];
             /* read address + port = addr_len + 2 */
-            if (network_recv_with_retry (sock, buffer, addr_len + 2, 0) < addr_len + 2)
+            if (network_recv_with_retry (request, sock, buffer, addr_len + 2, 0) < addr_len + 2)
                 return 0;
             break;
         case 4:
@@ -552,7 +622,7 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
              * server socks return server bound address and port
              * address of 16 bytes and port of 2 bytes (= 18 bytes)
              */
-            if (network_recv_with_retry (sock, buffer, 18, 0) < 18)
+            if (network_recv_with_retry (request, sock, buffer, 18, 0) < 18)
                 return 0;
             break;
         default:
@@ -563,6 +633,43 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
     return 1;
 }
 
+/*
+ * Establishes a connection and authenticates with a proxy, using a proxy
+ * type and evaluated username/password (this function does not read any
+ * option, so it can be called in a thread).
+ *
+ * Argument "request" is the connection request when called in a connection
+ * thread (NULL in a forked process): the dialog with proxy is stopped if the
+ * request is cancelled.
+ *
+ * WARNING: this function is blocking, it must be called only in a forked
+ * process or in a thread.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+network_pass_proxy_type (struct t_network_connect_request *request, int type,
+                         const char *username, const char *password,
+                         int sock, const char *address, int port)
+{
+    switch (type)
+    {
+        case PROXY_TYPE_HTTP:
+            return network_pass_httpproxy (request, username, password, sock,
+                                           address, port);
+        case PROXY_TYPE_SOCKS4:
+            return network_pass_socks4proxy (request, username, sock,
+                                             address, port);
+        case PROXY_TYPE_SOCKS5:
+            return network_pass_socks5proxy (request, username, password,
+                                             sock, address, port);
+    }
+    return 0;
+}
+
 /*
  * Establishes a connection and authenticates with a proxy.
  *
@@ -579,24 +686,28 @@ network_pass_proxy (const char *proxy, int sock, const char *address, int port)
 {
     int rc;
     struct t_proxy *ptr_proxy;
+    char *username, *password;
 
     rc = 0;
 
     ptr_proxy = proxy_search (proxy);
     if (ptr_proxy)
     {
-        switch (CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_TYPE]))
+        username = eval_expression (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME]),
+                                    NULL, NULL, NULL);
+        password = eval_expression (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_PASSWORD]),
+                                    NULL, NULL, NULL);
+        if (username && password)
         {
-            case PROXY_TYPE_HTTP:
-                rc = network_pass_httpproxy (ptr_proxy, sock, address, port);
-                break;
-            case PROXY_TYPE_SOCKS4:
-                rc = network_pass_socks4proxy (ptr_proxy, sock, address, port);
-                break;
-            case PROXY_TYPE_SOCKS5:
-                rc = network_pass_socks5proxy (ptr_proxy, sock, address, port);
-                break;
+            rc = network_pass_proxy_type (
+                NULL,
+                CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_TYPE]),
+                username, password, sock, address, port);
         }
+        if (username)
+            free (username);
+        if (password)
+            free (password);
     }
     return rc;
 }
@@ -743,26 +854,78 @@ error:
 }
 
 /*
- * Connects to peer in a child process.
+ * Sets status and error of a connection request.
  */
 
 void
-network_connect_child (struct t_hook *hook_connect)
+network_connect_request_set_status (struct t_network_connect_request *request,
+                                    int status, const char *error)
 {
-    struct t_proxy *ptr_proxy;
-    struct addrinfo hints, *res_local, *res_remote, *ptr_res, *ptr_loc;
+    request->status = status;
+    if (request->error)
+    {
+        free (request->error);
+        request->error = NULL;
+    }
+    if (error)
+        request->error = strdup (error);
+}
+
+/*
+ * Frees a connection request.
+ *
+ * This function can be called by main thread or by a connection thread.
+ */
+
+void
+network_connect_request_free (struct t_network_connect_request *request)
+{
+    if (!request)
+        return;
+
+    if (request->address)
+        free (request->address);
+    if (request->local_hostname)
+        free (request->local_hostname);
+    if (request->proxy_address)
+        free (request->proxy_address);
+    if (request->proxy_username)
+        free (request->proxy_username);
+    if (request->proxy_password)
+        free (request->proxy_password);
+    if (request->pipe_read >= 0)
+        close (request->pipe_read);
+    if (request->pipe_write >= 0)
+        close (request->pipe_write);
+    if (request->error)
+        free (request->error);
+    if (request->addresses)
+        free (request->addresses);
+    if (request->res_local)
+        freeaddrinfo (request->res_local);
+    if (request->res_remote)
+        freeaddrinfo (request->res_remote);
+    if (request->sock >= 0)
+        close (request->sock);
+    if (request->ip_address)
+        free (request->ip_address);
+
+    free (request);
+}
+
+/*
+ * Resolves addresses of peer (or proxy) and local hostname (optional), then
+ * builds the list of addresses to try.
+ *
+ * WARNING: this function is blocking, it is called in a connection thread.
+ */
+
+void
+network_connect_resolve (struct t_network_connect_request *request)
+{
+    struct addrinfo hints, *ptr_res;
     char port[NI_MAXSERV + 1];
-    char status_str[2], *ptr_address, *status_with_string;
-    char remote_address[NI_MAXHOST + 1];
-    char status_without_string[1 + 5 + 1];
-    const char *error;
-    int rc, length, num_written;
-    int sock, set, flags, j;
-    struct msghdr msg;
-    struct cmsghdr *cmsg;
-    char msg_buf[CMSG_SPACE(sizeof (sock))];
-    struct iovec iov[1];
-    char iov_data[1] = { 0 };
+    int rc;
     /*
      * indicates that something is wrong with whichever group of
      * servers is being tried first after connecting, so start at
@@ -770,39 +933,7 @@ network_connect_child (struct t_hook *hook_connect)
      */
     int retry, rand_num, i;
     int num_groups, tmp_num_groups, num_hosts, tmp_host;
-    struct addrinfo **res_reorder;
     int last_af;
-    struct timeval tv_time;
-
-    res_local = NULL;
-    res_remote = NULL;
-    res_reorder = NULL;
-    port[0] = '\0';
-
-    status_str[1] = '\0';
-    status_with_string = NULL;
-
-    ptr_address = NULL;
-
-    gettimeofday (&tv_time, NULL);
-    srand ((tv_time.tv_sec * tv_time.tv_usec) ^ getpid ());
-
-    ptr_proxy = NULL;
-    if (HOOK_CONNECT(hook_connect, proxy)
-        && HOOK_CONNECT(hook_connect, proxy)[0])
-    {
-        ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
-        if (!ptr_proxy)
-        {
-            /* proxy not found */
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%c00000", '0' + WEECHAT_HOOK_CONNECT_PROXY_ERROR);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-            (void) num_written;
-            goto end;
-        }
-    }
 
     /* get info about peer */
     memset (&hints, 0, sizeof (hints));
@@ -811,67 +942,32 @@ network_connect_child (struct t_hook *hook_connect)
     hints.ai_flags = AI_ADDRCONFIG;
 #endif /* AI_ADDRCONFIG */
     res_init ();
-    if (ptr_proxy)
+    if (request->proxy_type >= 0)
     {
-        hints.ai_family = (CONFIG_BOOLEAN(ptr_proxy->options[PROXY_OPTION_IPV6])) ?
-            AF_UNSPEC : AF_INET;
-        snprintf (port, sizeof (port), "%d", CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_PORT]));
-        rc = getaddrinfo (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_ADDRESS]),
-                          port, &hints, &res_remote);
+        hints.ai_family = (request->proxy_ipv6) ? AF_UNSPEC : AF_INET;
+        snprintf (port, sizeof (port), "%d", request->proxy_port);
+        rc = getaddrinfo (request->proxy_address, port, &hints,
+                          &request->res_remote);
     }
     else
     {
-        hints.ai_family = HOOK_CONNECT(hook_connect, ipv6) ? AF_UNSPEC : AF_INET;
-        snprintf (port, sizeof (port), "%d", HOOK_CONNECT(hook_connect, port));
-        rc = getaddrinfo (HOOK_CONNECT(hook_connect, address), port, &hints, &res_remote);
-    }
-
-    if (rc != 0)
-    {
-        /* address not found */
-        status_with_string = NULL;
-        error = gai_strerror (rc);
-        if (error)
-        {
-            length = 1 + 5 + strlen (error) + 1;
-            status_with_string = malloc (length);
-            if (status_with_string)
-            {
-                snprintf (status_with_string, length, "%c%05d%s",
-                          '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND,
-                          (int)strlen (error), error);
-            }
-        }
-        if (status_with_string)
-        {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_with_string, strlen (status_with_string));
-        }
-        else
-        {
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%c00000", '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-        }
-        (void) num_written;
-        goto end;
+        hints.ai_family = (request->ipv6) ? AF_UNSPEC : AF_INET;
+        snprintf (port, sizeof (port), "%d", request->port);
+        rc = getaddrinfo (request->address, port, &hints,
+                          &request->res_remote);
     }
-
-    if (!res_remote)
+    if ((rc != 0) || !request->res_remote)
     {
         /* address not found */
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-        goto end;
+        network_connect_request_set_status (
+            request,
+            WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND,
+            (rc != 0) ? gai_strerror (rc) : NULL);
+        return;
     }
 
     /* set local hostname/IP if asked by user */
-    if (HOOK_CONNECT(hook_connect, local_hostname)
-        && HOOK_CONNECT(hook_connect, local_hostname[0]))
+    if (request->local_hostname && request->local_hostname[0])
     {
         memset (&hints, 0, sizeof (hints));
         hints.ai_family = AF_UNSPEC;
@@ -879,49 +975,16 @@ network_connect_child (struct t_hook *hook_connect)
 #ifdef AI_ADDRCONFIG
         hints.ai_flags = AI_ADDRCONFIG;
 #endif /* AI_ADDRCONFIG */
-        rc = getaddrinfo (HOOK_CONNECT(hook_connect, local_hostname),
-                          NULL, &hints, &res_local);
-        if (rc != 0)
-        {
-            /* address not found */
-            status_with_string = NULL;
-            error = gai_strerror (rc);
-            if (error)
-            {
-                length = 1 + 5 + strlen (error) + 1;
-                status_with_string = malloc (length);
-                if (status_with_string)
-                {
-                    snprintf (status_with_string, length, "%c%05d%s",
-                              '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR,
-                              (int)strlen (error), error);
-                }
-            }
-            if (status_with_string)
-            {
-                num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                     status_with_string, strlen (status_with_string));
-            }
-            else
-            {
-                snprintf (status_without_string, sizeof (status_without_string),
-                          "%c00000", '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR);
-                num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                     status_without_string, strlen (status_without_string));
-            }
-            (void) num_written;
-            goto end;
-        }
-
-        if (!res_local)
+        rc = getaddrinfo (request->local_hostname, NULL, &hints,
+                          &request->res_local);
+        if ((rc != 0) || !request->res_local)
         {
             /* address not found */
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%c00000", '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-            (void) num_written;
-            goto end;
+            network_connect_request_set_status (
+                request,
+                WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR,
+                (rc != 0) ? gai_strerror (rc) : NULL);
+            return;
         }
     }
 
@@ -936,7 +999,7 @@ network_connect_child (struct t_hook *hook_connect)
     last_af = AF_UNSPEC;
     num_groups = 0;
     num_hosts = 0;
-    for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    for (ptr_res = request->res_remote; ptr_res; ptr_res = ptr_res->ai_next)
     {
         if (ptr_res->ai_family != last_af)
             if (last_af != AF_UNSPEC)
@@ -948,304 +1011,324 @@ network_connect_child (struct t_hook *hook_connect)
     if (last_af != AF_UNSPEC)
         num_groups++;
 
-    res_reorder = malloc (sizeof (*res_reorder) * num_hosts);
-    if (!res_reorder)
+    if (num_groups == 0)
     {
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_MEMORY_ERROR);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-        goto end;
+        /* no IP addresses found (all AF_UNSPEC) */
+        network_connect_request_set_status (
+            request, WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND, NULL);
+        return;
     }
 
-    /* reorder groups */
-    retry = HOOK_CONNECT(hook_connect, retry);
-    if (num_groups > 0)
+    request->addresses = malloc (sizeof (*request->addresses) * num_hosts);
+    if (!request->addresses)
     {
-        retry %= num_groups;
-        i = 0;
+        network_connect_request_set_status (
+            request, WEECHAT_HOOK_CONNECT_MEMORY_ERROR, NULL);
+        return;
+    }
+
+    /* reorder groups */
+    retry = request->retry % num_groups;
+    i = 0;
 
-        last_af = AF_UNSPEC;
-        tmp_num_groups = 0;
-        tmp_host = i; /* start of current group */
+    last_af = AF_UNSPEC;
+    tmp_num_groups = 0;
+    tmp_host = i; /* start of current group */
 
-        /* top of list */
-        for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    /* top of list */
+    for (ptr_res = request->res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
         {
-            if (ptr_res->ai_family != last_af)
-            {
-                if (last_af != AF_UNSPEC)
-                    tmp_num_groups++;
+            if (last_af != AF_UNSPEC)
+                tmp_num_groups++;
 
-                tmp_host = i;
-            }
+            tmp_host = i;
+        }
 
-            if (tmp_num_groups >= retry)
+        if (tmp_num_groups >= retry)
+        {
+            /* shuffle while adding */
+            rand_num = tmp_host + (rand_r (&request->seed) % ((i + 1) - tmp_host));
+            if (rand_num == i)
+                request->addresses[i++] = ptr_res;
+            else
             {
-                /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
-                if (rand_num == i)
-                    res_reorder[i++] = ptr_res;
-                else
-                {
-                    res_reorder[i++] = res_reorder[rand_num];
-                    res_reorder[rand_num] = ptr_res;
-                }
+                request->addresses[i++] = request->addresses[rand_num];
+                request->addresses[rand_num] = ptr_res;
             }
-
-            last_af = ptr_res->ai_family;
         }
 
-        last_af = AF_UNSPEC;
-        tmp_num_groups = 0;
-        tmp_host = i; /* start of current group */
+        last_af = ptr_res->ai_family;
+    }
+
+    last_af = AF_UNSPEC;
+    tmp_num_groups = 0;
+    tmp_host = i; /* start of current group */
 
-        /* remainder of list */
-        for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    /* remainder of list */
+    for (ptr_res = request->res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
         {
-            if (ptr_res->ai_family != last_af)
-            {
-                if (last_af != AF_UNSPEC)
-                    tmp_num_groups++;
+            if (last_af != AF_UNSPEC)
+                tmp_num_groups++;
 
-                tmp_host = i;
-            }
+            tmp_host = i;
+        }
 
-            if (tmp_num_groups < retry)
+        if (tmp_num_groups < retry)
+        {
+            /* shuffle while adding */
+            rand_num = tmp_host + (rand_r (&request->seed) % ((i + 1) - tmp_host));
+            if (rand_num == i)
+                request->addresses[i++] = ptr_res;
+            else
             {
-                /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
-                if (rand_num == i)
-                    res_reorder[i++] = ptr_res;
-                else
-                {
-                    res_reorder[i++] = res_reorder[rand_num];
-                    res_reorder[rand_num] = ptr_res;
-                }
+                request->addresses[i++] = request->addresses[rand_num];
+                request->addresses[rand_num] = ptr_res;
             }
-            else
-                break;
-
-            last_af = ptr_res->ai_family;
         }
-    }
-    else
-    {
-        /* no IP addresses found (all AF_UNSPEC) */
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-        goto end;
+        else
+            break;
+
+        last_af = ptr_res->ai_family;
     }
 
-    status_str[0] = '0' + WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND;
+    request->num_addresses = i;
 
-    /* try all IP addresses found, stop when connection is OK */
-    sock = -1;
-    for (i = 0; i < num_hosts; i++)
-    {
-        ptr_res = res_reorder[i];
+    network_connect_request_set_status (request, WEECHAT_HOOK_CONNECT_OK,
+                                        NULL);
+}
 
-        if (hook_socketpair_ok)
+/*
+ * Main function of a connection thread: runs the blocking steps of queued
+ * requests and notifies the main thread (with a pipe) when a step is done.
+ */
+
+void *
+network_connect_thread (void *arg)
+{
+    struct t_network_connect_request *request;
+    int num_written;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&network_connect_mutex);
+
+    while (1)
+    {
+        while (!network_connect_queue && !network_connect_quit)
         {
-            /* create a socket */
-            sock = socket (ptr_res->ai_family,
-                           ptr_res->ai_socktype,
-                           ptr_res->ai_protocol);
+            network_connect_threads_idle++;
+            pthread_cond_wait (&network_connect_cond, &network_connect_mutex);
+            network_connect_threads_idle--;
         }
-        else
+        if (network_connect_quit)
+            break;
+
+        /* take first request in queue */
+        request = network_connect_queue;
+        network_connect_queue = request->next_request;
+        if (!network_connect_queue)
+            last_network_connect_queue = NULL;
+        request->next_request = NULL;
+        request->state = NETWORK_CONNECT_STATE_RUNNING;
+
+        pthread_mutex_unlock (&network_connect_mutex);
+
+        if (request->step == NETWORK_CONNECT_STEP_PROXY)
         {
-            /* use pre-created socket pool */
-            sock = -1;
-            for (j = 0; j < HOOK_CONNECT_MAX_SOCKETS; j++)
+            if (network_pass_proxy_type (request,
+                                         request->proxy_type,
+                                         request->proxy_username,
+                                         request->proxy_password,
+                                         request->sock,
+                                         request->address,
+                                         request->port))
             {
-                if (ptr_res->ai_family == AF_INET)
-                {
-                    sock = HOOK_CONNECT(hook_connect, sock_v4[j]);
-                    if (sock != -1)
-                    {
-                        HOOK_CONNECT(hook_connect, sock_v4[j]) = -1;
-                        break;
-                    }
-                }
-                else if (ptr_res->ai_family == AF_INET6)
-                {
-                    sock = HOOK_CONNECT(hook_connect, sock_v6[j]);
-                    if (sock != -1)
-                    {
-                        HOOK_CONNECT(hook_connect, sock_v6[j]) = -1;
-                        break;
-                    }
-                }
+                network_connect_request_set_status (
+                    request, WEECHAT_HOOK_CONNECT_OK, NULL);
+            }
+            else
+            {
+                /* proxy fails to connect to peer */
+                network_connect_request_set_status (
+                    request, WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
             }
-            if (sock < 0)
-                continue;
         }
-        if (sock < 0)
+        else
         {
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_SOCKET_ERROR;
-            continue;
+            network_connect_resolve (request);
         }
 
-        /* set SO_REUSEADDR option for socket */
-        set = 1;
-        setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, (void *) &set, sizeof (set));
+        pthread_mutex_lock (&network_connect_mutex);
 
-        /* set SO_KEEPALIVE option for socket */
-        set = 1;
-        setsockopt (sock, SOL_SOCKET, SO_KEEPALIVE, (void *) &set, sizeof (set));
-
-        /* set flag O_NONBLOCK on socket */
-        flags = fcntl (sock, F_GETFL);
-        if (flags == -1)
-            flags = 0;
-        fcntl (sock, F_SETFL, flags | O_NONBLOCK);
-
-        if (res_local)
-        {
-            rc = -1;
-
-            /* bind local hostname/IP if asked by user */
-            for (ptr_loc = res_local; ptr_loc; ptr_loc = ptr_loc->ai_next)
-            {
-                if (ptr_loc->ai_family != ptr_res->ai_family)
-                    continue;
-
-                rc = bind (sock, ptr_loc->ai_addr, ptr_loc->ai_addrlen);
-                if (rc < 0)
-                    continue;
-            }
-
-            if (rc < 0)
-            {
-                status_str[0] = '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR;
-                close (sock);
-                sock = -1;
-                continue;
-            }
-        }
-
-        /* connect to peer */
-        if (network_connect (sock, ptr_res->ai_addr, ptr_res->ai_addrlen))
+        if (request->cancelled)
         {
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_OK;
-            rc = getnameinfo (ptr_res->ai_addr, ptr_res->ai_addrlen,
-                              remote_address, sizeof (remote_address),
-                              NULL, 0, NI_NUMERICHOST);
-            if (rc == 0)
-                ptr_address = remote_address;
-            break;
+            /* hook has been removed while the step was running */
+            network_connect_request_free (request);
         }
         else
         {
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
-            close (sock);
-            sock = -1;
+            request->state = NETWORK_CONNECT_STATE_DONE;
+            num_written = write (request->pipe_write, "1", 1);
+            (void) num_written;
         }
     }
 
-    HOOK_CONNECT(hook_connect, sock) = sock;
+    network_connect_threads--;
 
-    if (ptr_proxy && status_str[0] == '0' + WEECHAT_HOOK_CONNECT_OK)
-    {
-        if (!network_pass_proxy (HOOK_CONNECT(hook_connect, proxy),
-                                 HOOK_CONNECT(hook_connect, sock),
-                                 HOOK_CONNECT(hook_connect, address),
-                                 HOOK_CONNECT(hook_connect, port)))
-        {
-            /* proxy fails to connect to peer */
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_PROXY_ERROR;
-        }
-    }
+    pthread_mutex_unlock (&network_connect_mutex);
 
-    if (status_str[0] == '0' + WEECHAT_HOOK_CONNECT_OK)
-    {
-        status_with_string = NULL;
-        if (ptr_address)
-        {
-            length = strlen (status_str) + 5 + strlen (ptr_address) + 1;
-            status_with_string = malloc (length);
-            if (status_with_string)
-            {
-                snprintf (status_with_string, length, "%s%05d%s",
-                          status_str, (int)strlen (ptr_address), ptr_address);
-            }
-        }
+    return NULL;
+}
 
-        if (status_with_string)
-        {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_with_string, strlen (status_with_string));
-            (void) num_written;
-        }
-        else
-        {
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%s00000", status_str);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-            (void) num_written;
-        }
+/*
+ * Adds a connection request in queue (a thread is started if all threads are
+ * busy and if the max number of threads is not reached).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (no thread available)
+ */
+
+int
+network_connect_request_queue (struct t_network_connect_request *request)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    sigset_t signals, old_signals;
+    int rc;
+
+    rc = 1;
+
+    pthread_mutex_lock (&network_connect_mutex);
 
-        /* send the socket to the parent process */
-        if (hook_socketpair_ok)
+    request->state = NETWORK_CONNECT_STATE_QUEUED;
+    request->next_request = NULL;
+    if (last_network_connect_queue)
+        last_network_connect_queue->next_request = request;
+    else
+        network_connect_queue = request;
+    last_network_connect_queue = request;
+
+    if ((network_connect_threads_idle == 0)
+        && (network_connect_threads < NETWORK_CONNECT_THREADS))
+    {
+        /* signals must be received by main thread only */
+        sigfillset (&signals);
+        pthread_sigmask (SIG_BLOCK, &signals, &old_signals);
+        pthread_attr_init (&attr);
+        pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+        network_connect_quit = 0;
+        if (pthread_create (&thread, &attr, &network_connect_thread,
+                            NULL) == 0)
         {
-            memset (&msg, 0, sizeof (msg));
-            msg.msg_control = msg_buf;
-            msg.msg_controllen = sizeof (msg_buf);
-
-            /* send 1 byte of data (not required on Linux, required by BSD/OSX) */
-            memset (iov, 0, sizeof (iov));
-            iov[0].iov_base = iov_data;
-            iov[0].iov_len = 1;
-            msg.msg_iov = iov;
-            msg.msg_iovlen = 1;
-
-            cmsg = CMSG_FIRSTHDR(&msg);
-            cmsg->cmsg_level = SOL_SOCKET;
-            cmsg->cmsg_type = SCM_RIGHTS;
-            cmsg->cmsg_len = CMSG_LEN(sizeof (sock));
-            memcpy(CMSG_DATA(cmsg), &sock, sizeof (sock));
-            msg.msg_controllen = cmsg->cmsg_len;
-            num_written = sendmsg (HOOK_CONNECT(hook_connect, child_send), &msg, 0);
-            (void) num_written;
+            network_connect_threads++;
         }
-        else
+        else if (network_connect_threads == 0)
         {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write), &sock, sizeof (sock));
-            (void) num_written;
+            /* no thread at all to run the request: remove it from queue */
+            network_connect_queue = NULL;
+            last_network_connect_queue = NULL;
+            request->state = NETWORK_CONNECT_STATE_IDLE;
+            rc = 0;
         }
+        pthread_attr_destroy (&attr);
+        pthread_sigmask (SIG_SETMASK, &old_signals, NULL);
     }
     else
     {
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%s00000", status_str);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
+        pthread_cond_signal (&network_connect_cond);
     }
 
-end:
-    if (status_with_string)
-        free (status_with_string);
-    if (res_reorder)
-        free (res_reorder);
-    if (res_local)
-        freeaddrinfo (res_local);
-    if (res_remote)
-        freeaddrinfo (res_remote);
+    pthread_mutex_unlock (&network_connect_mutex);
+
+    return rc;
+}
+
+/*
+ * Cancels a connection request (called when the connect hook is removed).
+ *
+ * If a thread is running a step of the request, the request is freed by the
+ * thread, at the end of the step.
+ */
+
+void
+network_connect_request_cancel (struct t_network_connect_request *request)
+{
+    struct t_network_connect_request *ptr_request, *prev_request;
+    int free_request;
+
+    if (!request)
+        return;
+
+    free_request = 1;
+
+    pthread_mutex_lock (&network_connect_mutex);
+
+    switch (request->state)
+    {
+        case NETWORK_CONNECT_STATE_QUEUED:
+            /* remove request from queue */
+            prev_request = NULL;
+            for (ptr_request = network_connect_queue; ptr_request;
+                 ptr_request = ptr_request->next_request)
+            {
+                if (ptr_request == request)
+                {
+                    if (prev_request)
+                        prev_request->next_request = request->next_request;
+                    else
+                        network_connect_queue = request->next_request;
+                    if (last_network_connect_queue == request)
+                        last_network_connect_queue = prev_request;
+                    break;
+                }
+                prev_request = ptr_request;
+            }
+            break;
+        case NETWORK_CONNECT_STATE_RUNNING:
+            request->cancelled = 1;
+            free_request = 0;
+            break;
+    }
+
+    pthread_mutex_unlock (&network_connect_mutex);
+
+    if (free_request)
+        network_connect_request_free (request);
+}
+
+/*
+ * Calls the connect callback and removes the connect hook.
+ */
+
+void
+network_connect_finish (struct t_hook *hook_connect, int status,
+                        int gnutls_rc, int sock, const char *error,
+                        const char *ip_address)
+{
+    struct t_hook_exec_cb hook_exec_cb;
+
+    hook_callback_start (hook_connect, &hook_exec_cb);
+    (void) (HOOK_CONNECT(hook_connect, callback))
+        (hook_connect->callback_pointer,
+         hook_connect->callback_data,
+         status, gnutls_rc, sock, error, ip_address);
+    hook_callback_end (hook_connect, &hook_exec_cb);
+    unhook (hook_connect);
 }
 
 /*
- * Timer callback for timeout of child process.
+ * Timer callback for timeout of connection.
  */
 
 int
-network_connect_child_timer_cb (const void *pointer, void *data,
-                                int remaining_calls)
+network_connect_timer_cb (const void *pointer, void *data,
+                          int remaining_calls)
 {
     struct t_hook *hook_connect;
 
@@ -1255,14 +1338,10 @@ network_connect_child_timer_cb (const void *pointer, void *data,
 
     hook_connect = (struct t_hook *)pointer;
 
-    HOOK_CONNECT(hook_connect, hook_child_timer) = NULL;
+    HOOK_CONNECT(hook_connect, hook_timer) = NULL;
 
-    (void) (HOOK_CONNECT(hook_connect, callback))
-        (hook_connect->callback_pointer,
-         hook_connect->callback_data,
-         WEECHAT_HOOK_CONNECT_TIMEOUT,
-         0, -1, NULL, NULL);
-    unhook (hook_connect);
+    network_connect_finish (hook_connect, WEECHAT_HOOK_CONNECT_TIMEOUT,
+                            0, -1, NULL, NULL);
 
     return WEECHAT_RC_OK;
 }
@@ -1281,6 +1360,7 @@ network_connect_gnutls_handshake_fd_cb (const void *pointer, void *data,
 {
     struct t_hook *hook_connect;
     int rc, direction, flags;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) data;
@@ -1299,12 +1379,14 @@ network_connect_gnutls_handshake_fd_cb (const void *pointer, void *data,
             || (((flags & HOOK_FD_FLAG_WRITE) == HOOK_FD_FLAG_WRITE)
                 && (direction != 1)))
         {
-            HOOK_FD(HOOK_CONNECT(hook_connect, handshake_hook_fd), flags) =
-                (direction) ? HOOK_FD_FLAG_WRITE: HOOK_FD_FLAG_READ;
+            hook_fd_set_flags (
+                HOOK_CONNECT(hook_connect, handshake_hook_fd),
+                (direction) ? HOOK_FD_FLAG_WRITE: HOOK_FD_FLAG_READ);
         }
     }
     else if (rc != GNUTLS_E_SUCCESS)
     {
+        hook_callback_start (hook_connect, &hook_exec_cb);
         (void) (HOOK_CONNECT(hook_connect, callback))
             (hook_connect->callback_pointer,
              hook_connect->callback_data,
@@ -1312,6 +1394,7 @@ network_connect_gnutls_handshake_fd_cb (const void *pointer, void *data,
              HOOK_CONNECT(hook_connect, sock),
              gnutls_strerror (rc),
              HOOK_CONNECT(hook_connect, handshake_ip_address));
+        hook_callback_end (hook_connect, &hook_exec_cb);
         unhook (hook_connect);
     }
     else
@@ -1326,6 +1409,7 @@ network_connect_gnutls_handshake_fd_cb (const void *pointer, void *data,
          */
         if (hook_connect_gnutls_verify_certificates (*HOOK_CONNECT(hook_connect, gnutls_sess)) != 0)
         {
+            hook_callback_start (hook_connect, &hook_exec_cb);
             (void) (HOOK_CONNECT(hook_connect, callback))
                 (hook_connect->callback_pointer,
                  hook_connect->callback_data,
@@ -1333,17 +1417,20 @@ network_connect_gnutls_handshake_fd_cb (const void *pointer, void *data,
                  HOOK_CONNECT(hook_connect, sock),
                  "Error in the certificate.",
                  HOOK_CONNECT(hook_connect, handshake_ip_address));
+            hook_callback_end (hook_connect, &hook_exec_cb);
             unhook (hook_connect);
             return WEECHAT_RC_OK;
         }
 #endif /* LIBGNUTLS_VERSION_NUMBER < 0x02090a */
         unhook (HOOK_CONNECT(hook_connect, handshake_hook_fd));
+        hook_callback_start (hook_connect, &hook_exec_cb);
         (void) (HOOK_CONNECT(hook_connect, callback))
             (hook_connect->callback_pointer,
              hook_connect->callback_data,
              WEECHAT_HOOK_CONNECT_OK, 0,
              HOOK_CONNECT(hook_connect, sock),
              NULL, HOOK_CONNECT(hook_connect, handshake_ip_address));
+        hook_callback_end (hook_connect, &hook_exec_cb);
         unhook (hook_connect);
     }
 
@@ -1362,6 +1449,7 @@ network_connect_gnutls_handshake_timer_cb (const void *pointer,
                                            int remaining_calls)
 {
     struct t_hook *hook_connect;
+    struct t_hook_exec_cb hook_exec_cb;
 
     /* make C compiler happy */
     (void) data;
@@ -1371,6 +1459,7 @@ network_connect_gnutls_handshake_timer_cb (const void *pointer,
 
     HOOK_CONNECT(hook_connect, handshake_hook_timer) = NULL;
 
+    hook_callback_start (hook_connect, &hook_exec_cb);
     (void) (HOOK_CONNECT(hook_connect, callback))
         (hook_connect->callback_pointer,
          hook_connect->callback_data,
@@ -1379,6 +1468,7 @@ network_connect_gnutls_handshake_timer_cb (const void *pointer,
          HOOK_CONNECT(hook_connect, sock),
          gnutls_strerror (GNUTLS_E_EXPIRED),
          HOOK_CONNECT(hook_connect, handshake_ip_address));
+    hook_callback_end (hook_connect, &hook_exec_cb);
     unhook (hook_connect);
 
     return WEECHAT_RC_OK;
@@ -1386,264 +1476,433 @@ network_connect_gnutls_handshake_timer_cb (const void *pointer,
 #endif /* HAVE_GNUTLS */
 
 /*
- * Reads connection progress from child process.
+ * Ends connection to peer: starts GnuTLS handshake (if SSL is asked) or
+ * calls the connect callback with the connected socket.
  */
 
-int
-network_connect_child_read_cb (const void *pointer, void *data, int fd)
+void
+network_connect_done (struct t_hook *hook_connect)
 {
-    struct t_hook *hook_connect;
-    char buffer[1], buf_size[6], *cb_error, *cb_ip_address, *error;
-    int num_read;
-    long size_msg;
+    struct t_network_connect_request *request;
+    char *ip_address;
+    int sock;
 #ifdef HAVE_GNUTLS
     int rc, direction;
 #endif /* HAVE_GNUTLS */
-    int sock, i;
-    struct msghdr msg;
-    struct cmsghdr *cmsg;
-    char msg_buf[CMSG_SPACE(sizeof (sock))];
-    struct iovec iov[1];
-    char iov_data[1];
 
-    /* make C compiler happy */
-    (void) data;
-    (void) fd;
+    request = HOOK_CONNECT(hook_connect, request);
 
-    hook_connect = (struct t_hook *)pointer;
+    sock = request->sock;
+    request->sock = -1;
+    HOOK_CONNECT(hook_connect, sock) = sock;
+    ip_address = request->ip_address;
 
-    cb_error = NULL;
-    cb_ip_address = NULL;
-    sock = -1;
+#ifdef HAVE_GNUTLS
+    if (HOOK_CONNECT(hook_connect, gnutls_sess))
+    {
+        /*
+         * the socket needs to be non-blocking since the call to
+         * gnutls_handshake can block
+         */
+        HOOK_CONNECT(hook_connect, handshake_fd_flags) =
+            fcntl (HOOK_CONNECT(hook_connect, sock), F_GETFL);
+        if (HOOK_CONNECT(hook_connect, handshake_fd_flags) == -1)
+            HOOK_CONNECT(hook_connect, handshake_fd_flags) = 0;
+        fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
+               HOOK_CONNECT(hook_connect, handshake_fd_flags) | O_NONBLOCK);
+        gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
+                                  (gnutls_transport_ptr_t) ((ptrdiff_t) HOOK_CONNECT(hook_connect, sock)));
+        if (HOOK_CONNECT(hook_connect, gnutls_dhkey_size) > 0)
+        {
+            gnutls_dh_set_prime_bits (*HOOK_CONNECT(hook_connect, gnutls_sess),
+                                      (unsigned int) HOOK_CONNECT(hook_connect, gnutls_dhkey_size));
+        }
+        rc = gnutls_handshake (*HOOK_CONNECT(hook_connect, gnutls_sess));
+        if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
+        {
+            /*
+             * gnutls was unable to proceed with the handshake without
+             * blocking: non fatal error, we just have to wait for an
+             * event about handshake
+             */
+            direction = gnutls_record_get_direction (*HOOK_CONNECT(hook_connect, gnutls_sess));
+            HOOK_CONNECT(hook_connect, handshake_ip_address) =
+                (ip_address) ? strdup (ip_address) : NULL;
+            HOOK_CONNECT(hook_connect, handshake_hook_fd) =
+                hook_fd (hook_connect->plugin,
+                         HOOK_CONNECT(hook_connect, sock),
+                         (!direction ? 1 : 0), (direction  ? 1 : 0), 0,
+                         &network_connect_gnutls_handshake_fd_cb,
+                         hook_connect, NULL);
+            HOOK_CONNECT(hook_connect, handshake_hook_timer) =
+                hook_timer (hook_connect->plugin,
+                            CONFIG_INTEGER(config_network_gnutls_handshake_timeout) * 1000,
+                            0, 1,
+                            &network_connect_gnutls_handshake_timer_cb,
+                            hook_connect, NULL);
+            return;
+        }
+        else if (rc != GNUTLS_E_SUCCESS)
+        {
+            network_connect_finish (hook_connect,
+                                    WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
+                                    rc, sock, gnutls_strerror (rc),
+                                    ip_address);
+            return;
+        }
+        fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
+               HOOK_CONNECT(hook_connect, handshake_fd_flags));
+#if LIBGNUTLS_VERSION_NUMBER < 0x02090a /* 2.9.10 */
+        /*
+         * gnutls only has the gnutls_certificate_set_verify_function()
+         * function since version 2.9.10. We need to call our verify
+         * function manually after the handshake for old gnutls versions
+         */
+        if (hook_connect_gnutls_verify_certificates (*HOOK_CONNECT(hook_connect, gnutls_sess)) != 0)
+        {
+            network_connect_finish (hook_connect,
+                                    WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
+                                    rc, sock, "Error in the certificate.",
+                                    ip_address);
+            return;
+        }
+#endif /* LIBGNUTLS_VERSION_NUMBER < 0x02090a */
+    }
+#endif /* HAVE_GNUTLS */
 
-    num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                     buffer, sizeof (buffer));
-    if (num_read == sizeof (buffer))
+    network_connect_finish (hook_connect, WEECHAT_HOOK_CONNECT_OK,
+                            0, sock, NULL, ip_address);
+}
+
+/*
+ * Connected to an address of peer (or proxy): if a proxy is used, the dialog
+ * with proxy is done in a thread, otherwise the connection is done.
+ */
+
+void
+network_connect_established (struct t_hook *hook_connect)
+{
+    struct t_network_connect_request *request;
+    struct addrinfo *ptr_res;
+    char remote_address[NI_MAXHOST + 1];
+
+    request = HOOK_CONNECT(hook_connect, request);
+
+    ptr_res = request->addresses[request->index_address];
+    if (getnameinfo (ptr_res->ai_addr, ptr_res->ai_addrlen,
+                     remote_address, sizeof (remote_address),
+                     NULL, 0, NI_NUMERICHOST) == 0)
     {
-        if (buffer[0] - '0' == WEECHAT_HOOK_CONNECT_OK)
+        request->ip_address = strdup (remote_address);
+    }
+
+    if (request->proxy_type >= 0)
+    {
+        /* dialog with proxy is blocking: it is done in a thread */
+        request->step = NETWORK_CONNECT_STEP_PROXY;
+        if (!network_connect_request_queue (request))
         {
-            /* connection OK, read IP address */
-            buf_size[5] = '\0';
-            num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                             buf_size, 5);
-            if (num_read == 5)
-            {
-                error = NULL;
-                size_msg = strtol (buf_size, &error, 10);
-                if (error && !error[0] && (size_msg > 0))
-                {
-                    cb_ip_address = malloc (size_msg + 1);
-                    if (cb_ip_address)
-                    {
-                        num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                                         cb_ip_address, size_msg);
-                        if (num_read == size_msg)
-                            cb_ip_address[size_msg] = '\0';
-                        else
-                        {
-                            free (cb_ip_address);
-                            cb_ip_address = NULL;
-                        }
-                    }
-                }
-            }
+            network_connect_finish (hook_connect,
+                                    WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
+                                    0, -1, "pthread_create", NULL);
+            return;
+        }
+        HOOK_CONNECT(hook_connect, hook_fd) = hook_fd (hook_connect->plugin,
+                                                       request->pipe_read,
+                                                       1, 0, 0,
+                                                       &network_connect_read_cb,
+                                                       hook_connect, NULL);
+        return;
+    }
 
-            if (hook_socketpair_ok)
-            {
-                /* receive the socket from the child process */
-                memset (&msg, 0, sizeof (msg));
-                msg.msg_control = msg_buf;
-                msg.msg_controllen = sizeof (msg_buf);
-
-                /* recv 1 byte of data (not required on Linux, required by BSD/OSX) */
-                memset (iov, 0, sizeof (iov));
-                iov[0].iov_base = iov_data;
-                iov[0].iov_len = 1;
-                msg.msg_iov = iov;
-                msg.msg_iovlen = 1;
-
-                if (recvmsg (HOOK_CONNECT(hook_connect, child_recv), &msg, 0) >= 0)
-                {
-                    cmsg = CMSG_FIRSTHDR(&msg);
-                    if (cmsg != NULL
-                        && cmsg->cmsg_level == SOL_SOCKET
-                        && cmsg->cmsg_type == SCM_RIGHTS
-                        && cmsg->cmsg_len >= sizeof (sock))
-                    {
-                        memcpy(&sock, CMSG_DATA(cmsg), sizeof (sock));
-                    }
-                }
-            }
-            else
-            {
-                num_read = read (HOOK_CONNECT(hook_connect, child_read), &sock, sizeof (sock));
-                (void) num_read;
+    network_connect_done (hook_connect);
+}
 
-                /* prevent unhook process from closing the socket */
-                for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-                {
-                    if (HOOK_CONNECT(hook_connect, sock_v4[i]) == sock)
-                        HOOK_CONNECT(hook_connect, sock_v4[i]) = -1;
+/*
+ * Connects (with a non-blocking socket) to next address of peer (or proxy).
+ *
+ * When the connection is in progress, the socket is watched with a fd hook
+ * (see function network_connect_fd_cb).
+ */
 
-                    if (HOOK_CONNECT(hook_connect, sock_v6[i]) == sock)
-                        HOOK_CONNECT(hook_connect, sock_v6[i]) = -1;
-                }
-            }
+void
+network_connect_next_address (struct t_hook *hook_connect)
+{
+    struct t_network_connect_request *request;
+    struct addrinfo *ptr_res, *ptr_loc;
+    int sock, set, flags, rc;
 
-            HOOK_CONNECT(hook_connect, sock) = sock;
+    request = HOOK_CONNECT(hook_connect, request);
 
-#ifdef HAVE_GNUTLS
-            if (HOOK_CONNECT(hook_connect, gnutls_sess))
-            {
-                /*
-                 * the socket needs to be non-blocking since the call to
-                 * gnutls_handshake can block
-                 */
-                HOOK_CONNECT(hook_connect, handshake_fd_flags) =
-                    fcntl (HOOK_CONNECT(hook_connect, sock), F_GETFL);
-                if (HOOK_CONNECT(hook_connect, handshake_fd_flags) == -1)
-                    HOOK_CONNECT(hook_connect, handshake_fd_flags) = 0;
-                fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
-                       HOOK_CONNECT(hook_connect, handshake_fd_flags) | O_NONBLOCK);
-                gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
-                                          (gnutls_transport_ptr_t) ((ptrdiff_t) HOOK_CONNECT(hook_connect, sock)));
-                if (HOOK_CONNECT(hook_connect, gnutls_dhkey_size) > 0)
-                {
-                    gnutls_dh_set_prime_bits (*HOOK_CONNECT(hook_connect, gnutls_sess),
-                                              (unsigned int) HOOK_CONNECT(hook_connect, gnutls_dhkey_size));
-                }
-                rc = gnutls_handshake (*HOOK_CONNECT(hook_connect, gnutls_sess));
-                if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
-                {
-                    /*
-                     * gnutls was unable to proceed with the handshake without
-                     * blocking: non fatal error, we just have to wait for an
-                     * event about handshake
-                     */
-                    unhook (HOOK_CONNECT(hook_connect, hook_fd));
-                    HOOK_CONNECT(hook_connect, hook_fd) = NULL;
-                    direction = gnutls_record_get_direction (*HOOK_CONNECT(hook_connect, gnutls_sess));
-                    HOOK_CONNECT(hook_connect, handshake_ip_address) = cb_ip_address;
-                    HOOK_CONNECT(hook_connect, handshake_hook_fd) =
-                        hook_fd (hook_connect->plugin,
-                                 HOOK_CONNECT(hook_connect, sock),
-                                 (!direction ? 1 : 0), (direction  ? 1 : 0), 0,
-                                 &network_connect_gnutls_handshake_fd_cb,
-                                 hook_connect, NULL);
-                    HOOK_CONNECT(hook_connect, handshake_hook_timer) =
-                        hook_timer (hook_connect->plugin,
-                                    CONFIG_INTEGER(config_network_gnutls_handshake_timeout) * 1000,
-                                    0, 1,
-                                    &network_connect_gnutls_handshake_timer_cb,
-                                    hook_connect, NULL);
-                    return WEECHAT_RC_OK;
-                }
-                else if (rc != GNUTLS_E_SUCCESS)
-                {
-                    (void) (HOOK_CONNECT(hook_connect, callback))
-                        (hook_connect->callback_pointer,
-                         hook_connect->callback_data,
-                         WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
-                         rc, sock,
-                         gnutls_strerror (rc),
-                         cb_ip_address);
-                    unhook (hook_connect);
-                    if (cb_ip_address)
-                        free (cb_ip_address);
-                    return WEECHAT_RC_OK;
-                }
-                fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
-                       HOOK_CONNECT(hook_connect, handshake_fd_flags));
-#if LIBGNUTLS_VERSION_NUMBER < 0x02090a /* 2.9.10 */
-                /*
-                 * gnutls only has the gnutls_certificate_set_verify_function()
-                 * function since version 2.9.10. We need to call our verify
-                 * function manually after the handshake for old gnutls versions
-                 */
-                if (hook_connect_gnutls_verify_certificates (*HOOK_CONNECT(hook_connect, gnutls_sess)) != 0)
-                {
-                    (void) (HOOK_CONNECT(hook_connect, callback))
-                        (hook_connect->callback_pointer,
-                         hook_connect->callback_data,
-                         WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
-                         rc, sock,
-                         "Error in the certificate.",
-                         cb_ip_address);
-                    unhook (hook_connect);
-                    if (cb_ip_address)
-                        free (cb_ip_address);
-                    return WEECHAT_RC_OK;
-                }
-#endif /* LIBGNUTLS_VERSION_NUMBER < 0x02090a */
-            }
-#endif /* HAVE_GNUTLS */
+    /* try all IP addresses found, stop when connection is OK */
+    while (request->index_address < request->num_addresses)
+    {
+        ptr_res = request->addresses[request->index_address];
+
+        /* create a socket */
+        sock = socket (ptr_res->ai_family,
+                       ptr_res->ai_socktype,
+                       ptr_res->ai_protocol);
+        if (sock < 0)
+        {
+            request->status = WEECHAT_HOOK_CONNECT_SOCKET_ERROR;
+            request->index_address++;
+            continue;
         }
-        else
+
+        /* set SO_REUSEADDR option for socket */
+        set = 1;
+        setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, (void *) &set, sizeof (set));
+
+        /* set SO_KEEPALIVE option for socket */
+        set = 1;
+        setsockopt (sock, SOL_SOCKET, SO_KEEPALIVE, (void *) &set, sizeof (set));
+
+        /* set flag O_NONBLOCK on socket */
+        flags = fcntl (sock, F_GETFL);
+        if (flags == -1)
+            flags = 0;
+        fcntl (sock, F_SETFL, flags | O_NONBLOCK);
+
+        if (request->res_local)
         {
-            /* connection error, read error */
-            buf_size[5] = '\0';
-            num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                             buf_size, 5);
-            if (num_read == 5)
+            rc = -1;
+
+            /* bind local hostname/IP if asked by user */
+            for (ptr_loc = request->res_local; ptr_loc;
+                 ptr_loc = ptr_loc->ai_next)
             {
-                error = NULL;
-                size_msg = strtol (buf_size, &error, 10);
-                if (error && !error[0] && (size_msg > 0))
-                {
-                    cb_error = malloc (size_msg + 1);
-                    if (cb_error)
-                    {
-                        num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                                         cb_error, size_msg);
-                        if (num_read == size_msg)
-                            cb_error[size_msg] = '\0';
-                        else
-                        {
-                            free (cb_error);
-                            cb_error = NULL;
-                        }
-                    }
-                }
+                if (ptr_loc->ai_family != ptr_res->ai_family)
+                    continue;
+
+                rc = bind (sock, ptr_loc->ai_addr, ptr_loc->ai_addrlen);
+                if (rc == 0)
+                    break;
+            }
+
+            if (rc < 0)
+            {
+                request->status = WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR;
+                close (sock);
+                request->index_address++;
+                continue;
             }
         }
-        (void) (HOOK_CONNECT(hook_connect, callback))
-            (hook_connect->callback_pointer,
-             hook_connect->callback_data,
-             buffer[0] - '0', 0,
-             sock, cb_error, cb_ip_address);
-        unhook (hook_connect);
+
+        request->sock = sock;
+
+        /* connect to peer */
+        if (connect (sock, ptr_res->ai_addr, ptr_res->ai_addrlen) == 0)
+        {
+            network_connect_established (hook_connect);
+            return;
+        }
+        if (errno == EINPROGRESS)
+        {
+            /* wait for writability on socket */
+            HOOK_CONNECT(hook_connect, hook_fd) = hook_fd (hook_connect->plugin,
+                                                           sock,
+                                                           0, 1, 0,
+                                                           &network_connect_fd_cb,
+                                                           hook_connect, NULL);
+            return;
+        }
+
+        request->status = WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
+        close (sock);
+        request->sock = -1;
+        request->index_address++;
+    }
+
+    network_connect_finish (hook_connect, request->status, 0, -1, NULL, NULL);
+}
+
+/*
+ * Callback for socket connecting to peer (or proxy): checks the option
+ * SO_ERROR, which is 0 if connect is OK (see man connect).
+ */
+
+int
+network_connect_fd_cb (const void *pointer, void *data, int fd)
+{
+    struct t_hook *hook_connect;
+    struct t_network_connect_request *request;
+    int value;
+    socklen_t len;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) fd;
+
+    hook_connect = (struct t_hook *)pointer;
+    request = HOOK_CONNECT(hook_connect, request);
+
+    unhook (HOOK_CONNECT(hook_connect, hook_fd));
+    HOOK_CONNECT(hook_connect, hook_fd) = NULL;
+
+    len = sizeof (value);
+    if (getsockopt (request->sock, SOL_SOCKET, SO_ERROR, &value, &len) < 0)
+        value = errno;
+
+    if (value == 0)
+    {
+        network_connect_established (hook_connect);
     }
     else
     {
-        (void) (HOOK_CONNECT(hook_connect, callback))
-            (hook_connect->callback_pointer,
-             hook_connect->callback_data,
-             WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-             0, sock, "child_read_cb", NULL);
-        unhook (hook_connect);
+        /* connection failed, try next address */
+        request->status = WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
+        close (request->sock);
+        request->sock = -1;
+        request->index_address++;
+        network_connect_next_address (hook_connect);
     }
 
-    if (cb_error)
-        free (cb_error);
-    if (cb_ip_address)
-        free (cb_ip_address);
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Reads notification of a connection thread (a step of request is done).
+ */
+
+int
+network_connect_read_cb (const void *pointer, void *data, int fd)
+{
+    struct t_hook *hook_connect;
+    struct t_network_connect_request *request;
+    char buffer[1];
+    int num_read, state;
+
+    /* make C compiler happy */
+    (void) data;
+
+    hook_connect = (struct t_hook *)pointer;
+    request = HOOK_CONNECT(hook_connect, request);
+
+    num_read = read (fd, buffer, sizeof (buffer));
+    (void) num_read;
+
+    pthread_mutex_lock (&network_connect_mutex);
+    state = request->state;
+    if (state == NETWORK_CONNECT_STATE_DONE)
+        request->state = NETWORK_CONNECT_STATE_IDLE;
+    pthread_mutex_unlock (&network_connect_mutex);
+
+    if (state != NETWORK_CONNECT_STATE_DONE)
+        return WEECHAT_RC_OK;
+
+    unhook (HOOK_CONNECT(hook_connect, hook_fd));
+    HOOK_CONNECT(hook_connect, hook_fd) = NULL;
+
+    if (request->status != WEECHAT_HOOK_CONNECT_OK)
+    {
+        network_connect_finish (hook_connect, request->status, 0, -1,
+                                request->error, NULL);
+        return WEECHAT_RC_OK;
+    }
+
+    if (request->step == NETWORK_CONNECT_STEP_PROXY)
+    {
+        network_connect_done (hook_connect);
+    }
+    else
+    {
+        request->status = WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND;
+        request->index_address = 0;
+        network_connect_next_address (hook_connect);
+    }
 
     return WEECHAT_RC_OK;
 }
 
 /*
- * Connects with fork (called by hook_connect() only!).
+ * Creates a connection request for a connect hook.
+ *
+ * Returns pointer to new request, NULL if error.
+ */
+
+struct t_network_connect_request *
+network_connect_request_new (struct t_hook *hook_connect,
+                             struct t_proxy *proxy)
+{
+    struct t_network_connect_request *new_request;
+    struct timeval tv_time;
+    int pipe_fd[2];
+
+    if (pipe (pipe_fd) < 0)
+        return NULL;
+
+    new_request = malloc (sizeof (*new_request));
+    if (!new_request)
+    {
+        close (pipe_fd[0]);
+        close (pipe_fd[1]);
+        return NULL;
+    }
+
+    gettimeofday (&tv_time, NULL);
+
+    new_request->step = NETWORK_CONNECT_STEP_RESOLVE;
+    new_request->address = strdup (HOOK_CONNECT(hook_connect, address));
+    new_request->port = HOOK_CONNECT(hook_connect, port);
+    new_request->ipv6 = HOOK_CONNECT(hook_connect, ipv6);
+    new_request->retry = HOOK_CONNECT(hook_connect, retry);
+    new_request->seed = (tv_time.tv_sec * tv_time.tv_usec) ^ getpid ();
+    new_request->local_hostname = (HOOK_CONNECT(hook_connect, local_hostname)) ?
+        strdup (HOOK_CONNECT(hook_connect, local_hostname)) : NULL;
+    new_request->proxy_type = -1;
+    new_request->proxy_address = NULL;
+    new_request->proxy_port = 0;
+    new_request->proxy_ipv6 = 0;
+    new_request->proxy_username = NULL;
+    new_request->proxy_password = NULL;
+    if (proxy)
+    {
+        new_request->proxy_type = CONFIG_INTEGER(proxy->options[PROXY_OPTION_TYPE]);
+        new_request->proxy_address = strdup (CONFIG_STRING(proxy->options[PROXY_OPTION_ADDRESS]));
+        new_request->proxy_port = CONFIG_INTEGER(proxy->options[PROXY_OPTION_PORT]);
+        new_request->proxy_ipv6 = CONFIG_BOOLEAN(proxy->options[PROXY_OPTION_IPV6]);
+        new_request->proxy_username = eval_expression (
+            CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]),
+            NULL, NULL, NULL);
+        new_request->proxy_password = eval_expression (
+            CONFIG_STRING(proxy->options[PROXY_OPTION_PASSWORD]),
+            NULL, NULL, NULL);
+    }
+    new_request->pipe_read = pipe_fd[0];
+    new_request->pipe_write = pipe_fd[1];
+    new_request->state = NETWORK_CONNECT_STATE_IDLE;
+    new_request->cancelled = 0;
+    new_request->status = WEECHAT_HOOK_CONNECT_OK;
+    new_request->error = NULL;
+    new_request->res_remote = NULL;
+    new_request->res_local = NULL;
+    new_request->addresses = NULL;
+    new_request->num_addresses = 0;
+    new_request->index_address = 0;
+    new_request->sock = -1;
+    new_request->ip_address = NULL;
+    new_request->next_request = NULL;
+
+    return new_request;
+}
+
+/*
+ * Connects to peer (called by hook_connect() only!).
+ *
+ * Address resolution is done in a thread (the main thread is notified with a
+ * pipe), then the main thread connects to peer with a non-blocking socket.
  */
 
 void
-network_connect_with_fork (struct t_hook *hook_connect)
+network_connect_start (struct t_hook *hook_connect)
 {
-    int child_pipe[2], child_socket[2], rc, i;
-    char str_error[1024];
+    struct t_proxy *ptr_proxy;
+    struct t_network_connect_request *request;
 #ifdef HAVE_GNUTLS
+    int rc;
     const char *pos_error;
 #endif /* HAVE_GNUTLS */
-    pid_t pid;
 
 #ifdef HAVE_GNUTLS
     /* initialize GnuTLS if SSL asked */
@@ -1651,12 +1910,9 @@ network_connect_with_fork (struct t_hook *hook_connect)
     {
         if (gnutls_init (HOOK_CONNECT(hook_connect, gnutls_sess), GNUTLS_CLIENT) != GNUTLS_E_SUCCESS)
         {
-            (void) (HOOK_CONNECT(hook_connect, callback))
-                (hook_connect->callback_pointer,
-                 hook_connect->callback_data,
-                 WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
-                 0, -1, NULL, NULL);
-            unhook (hook_connect);
+            network_connect_finish (hook_connect,
+                                    WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
+                                    0, -1, NULL, NULL);
             return;
         }
         rc = gnutls_server_name_set (*HOOK_CONNECT(hook_connect, gnutls_sess),
@@ -1665,12 +1921,11 @@ network_connect_with_fork (struct t_hook *hook_connect)
                                      strlen (HOOK_CONNECT(hook_connect, address)));
         if (rc != GNUTLS_E_SUCCESS)
         {
-            (void) (HOOK_CONNECT(hook_connect, callback))
-                (hook_connect->callback_pointer,
-                 hook_connect->callback_data,
-                 WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
-                 0, -1, _("set server name indication (SNI) failed"), NULL);
-            unhook (hook_connect);
+            network_connect_finish (hook_connect,
+                                    WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
+                                    0, -1,
+                                    _("set server name indication (SNI) failed"),
+                                    NULL);
             return;
         }
         rc = gnutls_priority_set_direct (*HOOK_CONNECT(hook_connect, gnutls_sess),
@@ -1678,12 +1933,9 @@ network_connect_with_fork (struct t_hook *hook_connect)
                                          &pos_error);
         if (rc != GNUTLS_E_SUCCESS)
         {
-            (void) (HOOK_CONNECT(hook_connect, callback))
-                (hook_connect->callback_pointer,
-                 hook_connect->callback_data,
-                 WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
-                 0, -1, _("invalid priorities"), NULL);
-            unhook (hook_connect);
+            network_connect_finish (hook_connect,
+                                    WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
+                                    0, -1, _("invalid priorities"), NULL);
             return;
         }
         gnutls_credentials_set (*HOOK_CONNECT(hook_connect, gnutls_sess),
@@ -1694,87 +1946,49 @@ network_connect_with_fork (struct t_hook *hook_connect)
     }
 #endif /* HAVE_GNUTLS */
 
-    /* create pipe for child process */
-    if (pipe (child_pipe) < 0)
-    {
-        (void) (HOOK_CONNECT(hook_connect, callback))
-            (hook_connect->callback_pointer,
-             hook_connect->callback_data,
-             WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-             0, -1, "pipe", NULL);
-        unhook (hook_connect);
-        return;
-    }
-    HOOK_CONNECT(hook_connect, child_read) = child_pipe[0];
-    HOOK_CONNECT(hook_connect, child_write) = child_pipe[1];
-
-    if (hook_socketpair_ok)
+    ptr_proxy = NULL;
+    if (HOOK_CONNECT(hook_connect, proxy)
+        && HOOK_CONNECT(hook_connect, proxy)[0])
     {
-        /* create socket for child process */
-        if (socketpair (AF_LOCAL, SOCK_DGRAM, 0, child_socket) < 0)
+        ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+        if (!ptr_proxy)
         {
-            (void) (HOOK_CONNECT(hook_connect, callback))
-                (hook_connect->callback_pointer,
-                 hook_connect->callback_data,
-                 WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-                 0, -1, "socketpair", NULL);
-            unhook (hook_connect);
+            /* proxy not found */
+            network_connect_finish (hook_connect,
+                                    WEECHAT_HOOK_CONNECT_PROXY_ERROR,
+                                    0, -1, NULL, NULL);
             return;
         }
-        HOOK_CONNECT(hook_connect, child_recv) = child_socket[0];
-        HOOK_CONNECT(hook_connect, child_send) = child_socket[1];
-    }
-    else
-    {
-        for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-        {
-            HOOK_CONNECT(hook_connect, sock_v4[i]) = socket (AF_INET, SOCK_STREAM, 0);
-            HOOK_CONNECT(hook_connect, sock_v6[i]) = socket (AF_INET6, SOCK_STREAM, 0);
-        }
     }
 
-    switch (pid = fork ())
+    request = network_connect_request_new (hook_connect, ptr_proxy);
+    if (!request)
     {
-        /* fork failed */
-        case -1:
-            snprintf (str_error, sizeof (str_error),
-                      "fork error: %s",
-                      strerror (errno));
-            (void) (HOOK_CONNECT(hook_connect, callback))
-                (hook_connect->callback_pointer,
-                 hook_connect->callback_data,
-                 WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-                 0, -1, str_error, NULL);
-            unhook (hook_connect);
-            return;
-        /* child process */
-        case 0:
-            rc = setuid (getuid ());
-            (void) rc;
-            close (HOOK_CONNECT(hook_connect, child_read));
-            if (hook_socketpair_ok)
-                close (HOOK_CONNECT(hook_connect, child_recv));
-            network_connect_child (hook_connect);
-            _exit (EXIT_SUCCESS);
+        network_connect_finish (hook_connect,
+                                WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
+                                0, -1, "pipe", NULL);
+        return;
     }
-    /* parent process */
-    HOOK_CONNECT(hook_connect, child_pid) = pid;
-    close (HOOK_CONNECT(hook_connect, child_write));
-    HOOK_CONNECT(hook_connect, child_write) = -1;
-    if (hook_socketpair_ok)
+    HOOK_CONNECT(hook_connect, request) = request;
+
+    /* resolve address in a thread */
+    if (!network_connect_request_queue (request))
     {
-        close (HOOK_CONNECT(hook_connect, child_send));
-        HOOK_CONNECT(hook_connect, child_send) = -1;
+        network_connect_finish (hook_connect,
+                                WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
+                                0, -1, "pthread_create", NULL);
+        return;
     }
-    HOOK_CONNECT(hook_connect, hook_child_timer) = hook_timer (hook_connect->plugin,
-                                                               CONFIG_INTEGER(config_network_connection_timeout) * 1000,
-                                                               0, 1,
-                                                               &network_connect_child_timer_cb,
-                                                               hook_connect,
-                                                               NULL);
+
+    HOOK_CONNECT(hook_connect, hook_timer) = hook_timer (hook_connect->plugin,
+                                                         CONFIG_INTEGER(config_network_connection_timeout) * 1000,
+                                                         0, 1,
+                                                         &network_connect_timer_cb,
+                                                         hook_connect,
+                                                         NULL);
     HOOK_CONNECT(hook_connect, hook_fd) = hook_fd (hook_connect->plugin,
-                                                   HOOK_CONNECT(hook_connect, child_read),
+                                                   request->pipe_read,
                                                    1, 0, 0,
-                                                   &network_connect_child_read_cb,
+                                                   &network_connect_read_cb,
                                                    hook_connect, NULL);
 }
@@ -22,6 +22,25 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netdb.h>
+
+/* number of threads used to resolve addresses (and talk to proxies) */
+#define NETWORK_CONNECT_THREADS 4
+
+/* max time (in seconds) to send/receive data during dialog with a proxy */
+#define NETWORK_PROXY_TIMEOUT 60
+/* interval (in milliseconds) to check if a connection request is cancelled */
+#define NETWORK_PROXY_POLL_INTERVAL 100
+
+/* steps of connection done by a thread */
+#define NETWORK_CONNECT_STEP_RESOLVE 0
+#define NETWORK_CONNECT_STEP_PROXY   1
+
+/* states of a connection request */
+#define NETWORK_CONNECT_STATE_IDLE    0  /* owned by main thread            */
+#define NETWORK_CONNECT_STATE_QUEUED  1  /* waiting for a thread            */
+#define NETWORK_CONNECT_STATE_RUNNING 2  /* a thread is running the step    */
+#define NETWORK_CONNECT_STATE_DONE    3  /* step done, main thread notified */
 
 struct t_hook;
 
@@ -43,6 +62,47 @@ struct t_network_socks5
                           /*              auth(user/pass) (2), ...          */
 };
 
+/*
+ * connection request (for hook_connect): blocking steps (address resolution
+ * and dialog with proxy) are run in a thread, the main thread is notified
+ * with a pipe and connects to the peer with a non-blocking socket
+ */
+
+struct t_network_connect_request
+{
+    /* data set by main thread before the request is queued */
+    int step;                          /* NETWORK_CONNECT_STEP_XXX          */
+    char *address;                     /* peer address                      */
+    int port;                          /* peer port                         */
+    int ipv6;                          /* use IPv6                          */
+    int retry;                         /* retry count                       */
+    unsigned int seed;                 /* seed to shuffle addresses         */
+    char *local_hostname;              /* force local hostname (optional)   */
+    int proxy_type;                    /* proxy type (-1 if no proxy)       */
+    char *proxy_address;               /* proxy address                     */
+    int proxy_port;                    /* proxy port                        */
+    int proxy_ipv6;                    /* use IPv6 to connect to proxy      */
+    char *proxy_username;              /* proxy username (evaluated)        */
+    char *proxy_password;              /* proxy password (evaluated)        */
+    int pipe_read;                     /* pipe: main thread is notified     */
+    int pipe_write;                    /* when the step is done             */
+    /* data shared between threads (protected by a mutex) */
+    int state;                         /* NETWORK_CONNECT_STATE_XXX         */
+    int cancelled;                     /* 1 if hook was removed             */
+    /* result of step (read by main thread when state is "done") */
+    int status;                        /* WEECHAT_HOOK_CONNECT_XXX          */
+    char *error;                       /* error (optional)                  */
+    struct addrinfo *res_remote;       /* addresses of peer (or proxy)      */
+    struct addrinfo *res_local;        /* local addresses (to bind)         */
+    struct addrinfo **addresses;       /* peer addresses, in order to try   */
+    int num_addresses;                 /* number of addresses               */
+    /* connection to peer (main thread) */
+    int index_address;                 /* index of address being tried      */
+    int sock;                          /* socket (connecting)               */
+    char *ip_address;                  /* IP address of peer (or proxy)     */
+    struct t_network_connect_request *next_request; /* link to next request */
+};
+
 extern int network_init_gnutls_ok;
 
 extern void network_init_gcrypt ();
@@ -53,6 +113,7 @@ extern int network_pass_proxy (const char *proxy, int sock,
                                const char *address, int port);
 extern int network_connect_to (const char *proxy, struct sockaddr *address,
                                socklen_t address_length);
-extern void network_connect_with_fork (struct t_hook *hook_connect);
+extern void network_connect_start (struct t_hook *hook_connect);
+extern void network_connect_request_cancel (struct t_network_connect_request *request);
 
 #endif /* WEECHAT_NETWORK_H */
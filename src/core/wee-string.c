@@ -3124,7 +3124,7 @@ string_replace_with_callback (const char *string,
  * Hashes a shared string.
  * The string starts after the reference count, which is skipped.
  *
- * Returns the hash of the shared string (variant of djb2).
+ * Returns the hash of the shared string.
  */
 
 unsigned long long
@@ -3134,7 +3134,7 @@ string_shared_hash_key (struct t_hashtable *hashtable,
     /* make C compiler happy */
     (void) hashtable;
 
-    return hashtable_hash_key_djb2 (((const char *)key) + sizeof (string_shared_count_t));
+    return hashtable_hash_key_string (((const char *)key) + sizeof (string_shared_count_t));
 }
 
 /*
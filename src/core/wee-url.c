@@ -23,9 +23,12 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <signal.h>
+#include <pthread.h>
 #include <curl/curl.h>
 
 #include "weechat.h"
@@ -824,7 +827,13 @@ struct t_url_option url_options[] =
     { NULL, 0, 0, NULL },
 };
 
-char url_error[CURL_ERROR_SIZE + 1];
+/* threads used for URL transfers (hook_process with "url:") */
+pthread_mutex_t url_transfer_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t url_transfer_cond = PTHREAD_COND_INITIALIZER;
+struct t_url_transfer *url_transfer_queue = NULL;
+struct t_url_transfer *last_url_transfer_queue = NULL;
+int url_transfer_threads = 0;          /* number of threads running         */
+int url_transfer_threads_idle = 0;     /* threads waiting for a transfer    */
 
 
 /*
@@ -1078,49 +1087,94 @@ weeurl_set_proxy (CURL *curl, struct t_proxy *proxy)
 }
 
 /*
- * Downloads URL using options.
+ * Callback called by curl during transfer: aborts the transfer if it has been
+ * cancelled (transfer running in a thread).
+ *
+ * Returns:
+ *   0: continue transfer
+ *   1: abort transfer
+ */
+
+#if LIBCURL_VERSION_NUM >= 0x072000 /* 7.32.0 */
+int
+weeurl_transfer_progress_cb (void *clientp,
+                             curl_off_t dltotal, curl_off_t dlnow,
+                             curl_off_t ultotal, curl_off_t ulnow)
+#else
+int
+weeurl_transfer_progress_cb (void *clientp,
+                             double dltotal, double dlnow,
+                             double ultotal, double ulnow)
+#endif /* LIBCURL_VERSION_NUM >= 0x072000 */
+{
+    struct t_url_transfer *transfer;
+    int cancelled;
+
+    /* make C compiler happy */
+    (void) dltotal;
+    (void) dlnow;
+    (void) ultotal;
+    (void) ulnow;
+
+    transfer = (struct t_url_transfer *)clientp;
+
+    pthread_mutex_lock (&url_transfer_mutex);
+    cancelled = transfer->cancelled;
+    pthread_mutex_unlock (&url_transfer_mutex);
+
+    return cancelled;
+}
+
+/*
+ * Initializes an URL transfer: creates the curl handle and sets all options
+ * (proxy, input/output files and options in hashtable).
+ *
+ * If option "file_out" is not set, the output of transfer is written in
+ * stream "output" (or stdout if "output" is NULL).
  *
  * Returns:
  *   0: OK
  *   1: invalid URL
- *   2: error downloading URL
  *   3: not enough memory
  *   4: file error
  */
 
 int
-weeurl_download (const char *url, struct t_hashtable *options)
+weeurl_transfer_init (struct t_url_transfer *transfer, const char *url,
+                      struct t_hashtable *options, FILE *output)
 {
     CURL *curl;
-    struct t_url_file url_file[2];
     char *url_file_option[2] = { "file_in", "file_out" };
     char *url_file_mode[2] = { "rb", "wb" };
     CURLoption url_file_opt_func[2] = { CURLOPT_READFUNCTION, CURLOPT_WRITEFUNCTION };
     CURLoption url_file_opt_data[2] = { CURLOPT_READDATA, CURLOPT_WRITEDATA };
     void *url_file_opt_cb[2] = { &weeurl_read, &weeurl_write };
     struct t_proxy *ptr_proxy;
-    int rc, curl_rc, i;
-
-    rc = 0;
+    int i;
 
+    transfer->url = NULL;
+    transfer->curl = NULL;
     for (i = 0; i < 2; i++)
     {
-        url_file[i].filename = NULL;
-        url_file[i].stream = NULL;
+        transfer->url_file[i].filename = NULL;
+        transfer->url_file[i].stream = NULL;
     }
+    transfer->error_buffer = NULL;
+    transfer->rc = 0;
 
     if (!url || !url[0])
-    {
-        rc = 1;
-        goto end;
-    }
+        return 1;
+
+    transfer->url = strdup (url);
+    transfer->error_buffer = malloc (CURL_ERROR_SIZE + 1);
+    if (!transfer->url || !transfer->error_buffer)
+        return 3;
+    transfer->error_buffer[0] = '\0';
 
     curl = curl_easy_init();
     if (!curl)
-    {
-        rc = 3;
-        goto end;
-    }
+        return 3;
+    transfer->curl = curl;
 
     /* set default options */
     curl_easy_setopt (curl, CURLOPT_URL, url);
@@ -1135,22 +1189,29 @@ weeurl_download (const char *url, struct t_hashtable *options)
             weeurl_set_proxy (curl, ptr_proxy);
     }
 
+    /* set output (if not stdout) */
+    if (output)
+    {
+        curl_easy_setopt (curl, CURLOPT_WRITEFUNCTION, &weeurl_write);
+        curl_easy_setopt (curl, CURLOPT_WRITEDATA, output);
+    }
+
     /* set file in/out from options in hashtable */
     if (options)
     {
         for (i = 0; i < 2; i++)
         {
-            url_file[i].filename = hashtable_get (options, url_file_option[i]);
-            if (url_file[i].filename)
+            transfer->url_file[i].filename = hashtable_get (options,
+                                                            url_file_option[i]);
+            if (transfer->url_file[i].filename)
             {
-                url_file[i].stream = fopen (url_file[i].filename, url_file_mode[i]);
-                if (!url_file[i].stream)
-                {
-                    rc = 4;
-                    goto end;
-                }
+                transfer->url_file[i].stream = fopen (transfer->url_file[i].filename,
+                                                      url_file_mode[i]);
+                if (!transfer->url_file[i].stream)
+                    return 4;
                 curl_easy_setopt (curl, url_file_opt_func[i], url_file_opt_cb[i]);
-                curl_easy_setopt (curl, url_file_opt_data[i], url_file[i].stream);
+                curl_easy_setopt (curl, url_file_opt_data[i],
+                                  transfer->url_file[i].stream);
             }
         }
     }
@@ -1159,30 +1220,412 @@ weeurl_download (const char *url, struct t_hashtable *options)
     hashtable_map (options, &weeurl_option_map_cb, curl);
 
     /* set error buffer */
-    curl_easy_setopt (curl, CURLOPT_ERRORBUFFER, url_error);
+    curl_easy_setopt (curl, CURLOPT_ERRORBUFFER, transfer->error_buffer);
 
-    /* perform action! */
-    curl_rc = curl_easy_perform (curl);
+    return 0;
+}
+
+/*
+ * Performs an URL transfer (initialized with weeurl_transfer_init).
+ *
+ * Errors are written in stream "error" (or stderr if "error" is NULL).
+ *
+ * Returns:
+ *   0: OK
+ *   2: error downloading URL
+ */
+
+int
+weeurl_transfer_perform (struct t_url_transfer *transfer, FILE *error)
+{
+    int curl_rc;
+
+    curl_rc = curl_easy_perform (transfer->curl);
     if (curl_rc != CURLE_OK)
     {
-        fprintf (stderr,
+        fprintf ((error) ? error : stderr,
                  _("curl error %d (%s) (URL: \"%s\")\n"),
-                 curl_rc, url_error, url);
-        rc = 2;
+                 curl_rc, transfer->error_buffer, transfer->url);
+        return 2;
     }
 
-    /* cleanup */
-    curl_easy_cleanup (curl);
+    return 0;
+}
+
+/*
+ * Ends an URL transfer: frees curl handle and closes input/output files.
+ */
+
+void
+weeurl_transfer_end (struct t_url_transfer *transfer)
+{
+    int i;
 
-end:
+    if (transfer->curl)
+    {
+        curl_easy_cleanup (transfer->curl);
+        transfer->curl = NULL;
+    }
     for (i = 0; i < 2; i++)
     {
-        if (url_file[i].stream)
-            fclose (url_file[i].stream);
+        if (transfer->url_file[i].stream)
+        {
+            fclose (transfer->url_file[i].stream);
+            transfer->url_file[i].stream = NULL;
+        }
+    }
+    if (transfer->url)
+    {
+        free (transfer->url);
+        transfer->url = NULL;
+    }
+    if (transfer->error_buffer)
+    {
+        free (transfer->error_buffer);
+        transfer->error_buffer = NULL;
+    }
+}
+
+/*
+ * Downloads URL using options.
+ *
+ * Returns:
+ *   0: OK
+ *   1: invalid URL
+ *   2: error downloading URL
+ *   3: not enough memory
+ *   4: file error
+ */
+
+int
+weeurl_download (const char *url, struct t_hashtable *options)
+{
+    struct t_url_transfer transfer;
+    int rc;
+
+    rc = weeurl_transfer_init (&transfer, url, options, NULL);
+    if (rc == 0)
+        rc = weeurl_transfer_perform (&transfer, NULL);
+    weeurl_transfer_end (&transfer);
+
+    return rc;
+}
+
+/*
+ * Creates a new URL transfer, to run in a thread.
+ *
+ * The output of transfer is written in file descriptor "fd_output" and
+ * errors in "fd_error" (if a file descriptor is -1, the data is written in
+ * "/dev/null"). The transfer becomes owner of the file descriptors (they are
+ * closed when the transfer ends, even if this function fails).
+ *
+ * Returns pointer to new transfer, NULL if error.
+ */
+
+struct t_url_transfer *
+weeurl_transfer_new (const char *url, struct t_hashtable *options,
+                     int fd_output, int fd_error)
+{
+    struct t_url_transfer *new_transfer;
+
+    new_transfer = malloc (sizeof (*new_transfer));
+    if (!new_transfer)
+        goto error;
+
+    new_transfer->output = (fd_output >= 0) ?
+        fdopen (fd_output, "w") : fopen ("/dev/null", "w");
+    if (new_transfer->output)
+        fd_output = -1;
+    new_transfer->error = (fd_error >= 0) ?
+        fdopen (fd_error, "w") : fopen ("/dev/null", "w");
+    if (new_transfer->error)
+        fd_error = -1;
+    if (!new_transfer->output || !new_transfer->error)
+        goto error;
+
+    new_transfer->state = URL_TRANSFER_STATE_IDLE;
+    new_transfer->cancelled = 0;
+    new_transfer->next_transfer = NULL;
+
+    new_transfer->rc = weeurl_transfer_init (new_transfer, url, options,
+                                             new_transfer->output);
+    if (new_transfer->curl)
+    {
+        /* signals must not be used by curl in a thread */
+        curl_easy_setopt (new_transfer->curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt (new_transfer->curl, CURLOPT_NOPROGRESS, 0L);
+#if LIBCURL_VERSION_NUM >= 0x072000 /* 7.32.0 */
+        curl_easy_setopt (new_transfer->curl, CURLOPT_XFERINFOFUNCTION,
+                          &weeurl_transfer_progress_cb);
+        curl_easy_setopt (new_transfer->curl, CURLOPT_XFERINFODATA,
+                          new_transfer);
+#else
+        curl_easy_setopt (new_transfer->curl, CURLOPT_PROGRESSFUNCTION,
+                          &weeurl_transfer_progress_cb);
+        curl_easy_setopt (new_transfer->curl, CURLOPT_PROGRESSDATA,
+                          new_transfer);
+#endif /* LIBCURL_VERSION_NUM >= 0x072000 */
+    }
+
+    return new_transfer;
+
+error:
+    if (new_transfer)
+    {
+        if (new_transfer->output)
+            fclose (new_transfer->output);
+        if (new_transfer->error)
+            fclose (new_transfer->error);
+        free (new_transfer);
+    }
+    if (fd_output >= 0)
+        close (fd_output);
+    if (fd_error >= 0)
+        close (fd_error);
+    return NULL;
+}
+
+/*
+ * Closes output and error streams of an URL transfer (the reader of pipes
+ * receives end of file).
+ */
+
+void
+weeurl_transfer_close_streams (struct t_url_transfer *transfer)
+{
+    if (transfer->output)
+    {
+        fclose (transfer->output);
+        transfer->output = NULL;
+    }
+    if (transfer->error)
+    {
+        fclose (transfer->error);
+        transfer->error = NULL;
+    }
+}
+
+/*
+ * Frees an URL transfer.
+ */
+
+void
+weeurl_transfer_free (struct t_url_transfer *transfer)
+{
+    if (!transfer)
+        return;
+
+    weeurl_transfer_end (transfer);
+    weeurl_transfer_close_streams (transfer);
+
+    free (transfer);
+}
+
+/*
+ * Main function of an URL thread: performs queued transfers.
+ */
+
+void *
+weeurl_transfer_thread (void *arg)
+{
+    struct t_url_transfer *transfer;
+    int rc;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&url_transfer_mutex);
+
+    while (1)
+    {
+        while (!url_transfer_queue)
+        {
+            url_transfer_threads_idle++;
+            pthread_cond_wait (&url_transfer_cond, &url_transfer_mutex);
+            url_transfer_threads_idle--;
+        }
+
+        /* take first transfer in queue */
+        transfer = url_transfer_queue;
+        url_transfer_queue = transfer->next_transfer;
+        if (!url_transfer_queue)
+            last_url_transfer_queue = NULL;
+        transfer->next_transfer = NULL;
+        transfer->state = URL_TRANSFER_STATE_RUNNING;
+
+        pthread_mutex_unlock (&url_transfer_mutex);
+
+        rc = weeurl_transfer_perform (transfer, transfer->error);
+        weeurl_transfer_close_streams (transfer);
+
+        pthread_mutex_lock (&url_transfer_mutex);
+
+        if (transfer->cancelled)
+        {
+            weeurl_transfer_free (transfer);
+        }
+        else
+        {
+            transfer->rc = rc;
+            transfer->state = URL_TRANSFER_STATE_DONE;
+        }
+    }
+
+    /* never executed */
+    return NULL;
+}
+
+/*
+ * Starts an URL transfer: it is added in queue and performed by a thread
+ * (a thread is started if all threads are busy and if the max number of
+ * threads is not reached).
+ *
+ * If the transfer could not be initialized, it is immediately marked as done
+ * (with the error code).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (no thread available)
+ */
+
+int
+weeurl_transfer_start (struct t_url_transfer *transfer)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    sigset_t signals, old_signals;
+    int rc;
+
+    if (!transfer)
+        return 0;
+
+    if (transfer->rc != 0)
+    {
+        weeurl_transfer_close_streams (transfer);
+        transfer->state = URL_TRANSFER_STATE_DONE;
+        return 1;
+    }
+
+    rc = 1;
+
+    pthread_mutex_lock (&url_transfer_mutex);
+
+    transfer->state = URL_TRANSFER_STATE_QUEUED;
+    transfer->next_transfer = NULL;
+    if (last_url_transfer_queue)
+        last_url_transfer_queue->next_transfer = transfer;
+    else
+        url_transfer_queue = transfer;
+    last_url_transfer_queue = transfer;
+
+    if ((url_transfer_threads_idle == 0)
+        && (url_transfer_threads < URL_TRANSFER_THREADS))
+    {
+        /* signals must be received by main thread only */
+        sigfillset (&signals);
+        pthread_sigmask (SIG_BLOCK, &signals, &old_signals);
+        pthread_attr_init (&attr);
+        pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create (&thread, &attr, &weeurl_transfer_thread,
+                            NULL) == 0)
+        {
+            url_transfer_threads++;
+        }
+        else if (url_transfer_threads == 0)
+        {
+            /* no thread at all to run the transfer: remove it from queue */
+            url_transfer_queue = NULL;
+            last_url_transfer_queue = NULL;
+            transfer->state = URL_TRANSFER_STATE_IDLE;
+            rc = 0;
+        }
+        pthread_attr_destroy (&attr);
+        pthread_sigmask (SIG_SETMASK, &old_signals, NULL);
+    }
+    else
+    {
+        pthread_cond_signal (&url_transfer_cond);
     }
+
+    pthread_mutex_unlock (&url_transfer_mutex);
+
     return rc;
 }
 
+/*
+ * Checks if an URL transfer is done.
+ *
+ * Returns:
+ *   1: transfer done (return code is stored in *rc)
+ *   0: transfer not yet done
+ */
+
+int
+weeurl_transfer_is_done (struct t_url_transfer *transfer, int *rc)
+{
+    int done;
+
+    pthread_mutex_lock (&url_transfer_mutex);
+    done = (transfer->state == URL_TRANSFER_STATE_DONE);
+    if (done && rc)
+        *rc = transfer->rc;
+    pthread_mutex_unlock (&url_transfer_mutex);
+
+    return done;
+}
+
+/*
+ * Cancels an URL transfer.
+ *
+ * If a thread is running the transfer, it is aborted and freed by the thread.
+ */
+
+void
+weeurl_transfer_cancel (struct t_url_transfer *transfer)
+{
+    struct t_url_transfer *ptr_transfer, *prev_transfer;
+    int free_transfer;
+
+    if (!transfer)
+        return;
+
+    free_transfer = 1;
+
+    pthread_mutex_lock (&url_transfer_mutex);
+
+    switch (transfer->state)
+    {
+        case URL_TRANSFER_STATE_QUEUED:
+            /* remove transfer from queue */
+            prev_transfer = NULL;
+            for (ptr_transfer = url_transfer_queue; ptr_transfer;
+                 ptr_transfer = ptr_transfer->next_transfer)
+            {
+                if (ptr_transfer == transfer)
+                {
+                    if (prev_transfer)
+                        prev_transfer->next_transfer = transfer->next_transfer;
+                    else
+                        url_transfer_queue = transfer->next_transfer;
+                    if (last_url_transfer_queue == transfer)
+                        last_url_transfer_queue = prev_transfer;
+                    break;
+                }
+                prev_transfer = ptr_transfer;
+            }
+            break;
+        case URL_TRANSFER_STATE_RUNNING:
+            transfer->cancelled = 1;
+            free_transfer = 0;
+            break;
+    }
+
+    pthread_mutex_unlock (&url_transfer_mutex);
+
+    if (free_transfer)
+        weeurl_transfer_free (transfer);
+}
+
 /*
  * Adds an URL option in an infolist.
  *
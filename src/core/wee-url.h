@@ -20,6 +20,17 @@
 #ifndef WEECHAT_URL_H
 #define WEECHAT_URL_H 1
 
+#include <stdio.h>
+
+/* number of threads used for URL transfers */
+#define URL_TRANSFER_THREADS 4
+
+/* states of an URL transfer */
+#define URL_TRANSFER_STATE_IDLE    0   /* not started                       */
+#define URL_TRANSFER_STATE_QUEUED  1   /* waiting for a thread              */
+#define URL_TRANSFER_STATE_RUNNING 2   /* a thread is running the transfer  */
+#define URL_TRANSFER_STATE_DONE    3   /* transfer done                     */
+
 struct t_hashtable;
 struct t_infolist;
 
@@ -51,9 +62,30 @@ struct t_url_file
     FILE *stream;                      /* file stream                       */
 };
 
+struct t_url_transfer
+{
+    char *url;                         /* URL                               */
+    void *curl;                        /* curl easy handle                  */
+    struct t_url_file url_file[2];     /* input/output files (optional)     */
+    char *error_buffer;                /* curl error buffer                 */
+    FILE *output;                      /* output stream (thread only)       */
+    FILE *error;                       /* error stream (thread only)        */
+    int rc;                            /* return code (0 = OK)              */
+    int state;                         /* URL_TRANSFER_STATE_XXX            */
+    int cancelled;                     /* 1 if transfer must be aborted     */
+    struct t_url_transfer *next_transfer; /* link to next transfer in queue */
+};
+
 extern struct t_url_option url_options[];
 
 extern int weeurl_download (const char *url, struct t_hashtable *options);
+extern struct t_url_transfer *weeurl_transfer_new (const char *url,
+                                                   struct t_hashtable *options,
+                                                   int fd_output,
+                                                   int fd_error);
+extern int weeurl_transfer_start (struct t_url_transfer *transfer);
+extern int weeurl_transfer_is_done (struct t_url_transfer *transfer, int *rc);
+extern void weeurl_transfer_cancel (struct t_url_transfer *transfer);
 extern int weeurl_option_add_to_infolist (struct t_infolist *infolist,
                                           struct t_url_option *option);
 
@@ -1221,100 +1221,25 @@ gui_chat_display_time_to_prefix (struct t_gui_window *window,
 }
 
 /*
- * Displays a line in the chat window.
- *
- * If count == 0, display whole line.
- * If count > 0, display 'count' lines (beginning from the end).
- * If simulate == 1, nothing is displayed (for counting how many lines would
- * have been displayed).
- *
- * Returns number of lines displayed (or simulated).
+ * Displays time, prefix and message of a line (for a buffer with formatted
+ * content).
  */
 
-int
-gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
-                       int count, int simulate)
+void
+gui_chat_display_line_message (struct t_gui_window *window,
+                               struct t_gui_line *line,
+                               int num_lines, int count,
+                               int pre_lines_displayed, int *lines_displayed,
+                               int simulate)
 {
-    int num_lines, x, y, pre_lines_displayed, lines_displayed, line_align;
-    int read_marker_x, read_marker_y;
     int word_start_offset, word_end_offset;
-    int word_length_with_spaces, word_length;
+    int word_length_with_spaces, word_length, line_align;
     char *message_with_tags, *message_with_search;
     const char *ptr_data, *ptr_end_offset, *ptr_style, *next_char;
-    struct t_gui_line *ptr_prev_line, *ptr_next_line;
-    struct tm local_time, local_time2;
-    struct timeval tv_time;
-    time_t seconds, *ptr_time;
-
-    if (!line)
-        return 0;
-
-    if (simulate)
-    {
-        x = window->win_chat_cursor_x;
-        y = window->win_chat_cursor_y;
-        window->win_chat_cursor_x = 0;
-        window->win_chat_cursor_y = 0;
-        num_lines = 0;
-    }
-    else
-    {
-        if (window->win_chat_cursor_y > window->win_chat_height - 1)
-            return 0;
-        x = window->win_chat_cursor_x;
-        y = window->win_chat_cursor_y;
-        num_lines = gui_chat_display_line (window, line, 0, 1);
-        window->win_chat_cursor_x = x;
-        window->win_chat_cursor_y = y;
-        gui_window_current_emphasis = 0;
-    }
-
-    pre_lines_displayed = 0;
-    lines_displayed = 0;
-
-    /* display message before first line of buffer if date is not today */
-    if ((line->data->date != 0)
-        && CONFIG_BOOLEAN(config_look_day_change)
-        && window->buffer->day_change)
-    {
-        ptr_time = NULL;
-        ptr_prev_line = gui_line_get_prev_displayed (line);
-        if (ptr_prev_line)
-        {
-            while (ptr_prev_line && (ptr_prev_line->data->date == 0))
-            {
-                ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
-            }
-        }
-        if (!ptr_prev_line)
-        {
-            gettimeofday (&tv_time, NULL);
-            seconds = tv_time.tv_sec;
-            localtime_r (&seconds, &local_time);
-            localtime_r (&line->data->date, &local_time2);
-            if ((local_time.tm_mday != local_time2.tm_mday)
-                || (local_time.tm_mon != local_time2.tm_mon)
-                || (local_time.tm_year != local_time2.tm_year))
-            {
-                gui_chat_display_day_changed (window, NULL, &local_time2,
-                                              simulate);
-                gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
-                pre_lines_displayed++;
-            }
-        }
-    }
-
-    /* calculate marker position (maybe not used for this line!) */
-    if (window->buffer->time_for_each_line && line->data->str_time)
-        read_marker_x = x + gui_chat_strlen_screen (line->data->str_time);
-    else
-        read_marker_x = x;
-    read_marker_y = y;
 
     /* display time and prefix */
     gui_chat_display_time_to_prefix (window, line, num_lines, count,
-                                     pre_lines_displayed, &lines_displayed,
+                                     pre_lines_displayed, lines_displayed,
                                      simulate);
     if (!simulate && !gui_chat_display_tags)
     {
@@ -1390,13 +1315,13 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
             if (word_length >= 0)
             {
                 line_align = gui_line_get_align (window->buffer, line, 1,
-                                                 (lines_displayed == 0) ? 1 : 0);
+                                                 (*lines_displayed == 0) ? 1 : 0);
                 if ((window->win_chat_cursor_x + word_length_with_spaces > gui_chat_get_real_width (window))
                     && (word_length <= gui_chat_get_real_width (window) - line_align))
                 {
                     /* spaces + word too long for current line but OK for next line */
                     gui_chat_display_new_line (window, num_lines, count,
-                                               &lines_displayed, simulate);
+                                               lines_displayed, simulate);
                     /* apply styles before jumping to start of word */
                     if (!simulate && (word_start_offset > 0))
                     {
@@ -1422,7 +1347,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
                 gui_chat_display_word (window, line, ptr_data,
                                        ptr_end_offset + 1,
                                        0, num_lines, count,
-                                       pre_lines_displayed, &lines_displayed,
+                                       pre_lines_displayed, lines_displayed,
                                        simulate,
                                        CONFIG_BOOLEAN(config_look_color_inactive_message),
                                        0);
@@ -1455,7 +1380,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
             else
             {
                 gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
+                                           lines_displayed, simulate);
                 ptr_data = NULL;
             }
         }
@@ -1464,13 +1389,130 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     {
         /* no message */
         gui_chat_display_new_line (window, num_lines, count,
-                                   &lines_displayed, simulate);
+                                   lines_displayed, simulate);
     }
 
     if (message_with_tags)
         free (message_with_tags);
     if (message_with_search)
         free (message_with_search);
+}
+
+/*
+ * Displays a line in the chat window.
+ *
+ * If count == 0, display whole line.
+ * If count > 0, display 'count' lines (beginning from the end).
+ * If simulate == 1, nothing is displayed (for counting how many lines would
+ * have been displayed).
+ *
+ * Returns number of lines displayed (or simulated).
+ */
+
+int
+gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
+                       int count, int simulate)
+{
+    int num_lines, x, y, pre_lines_displayed, lines_displayed;
+    int read_marker_x, read_marker_y, layout_width, layout_lines;
+    struct t_gui_line *ptr_prev_line, *ptr_next_line;
+    struct tm local_time, local_time2;
+    struct timeval tv_time;
+    time_t seconds, *ptr_time;
+
+    if (!line)
+        return 0;
+
+    if (simulate)
+    {
+        x = window->win_chat_cursor_x;
+        y = window->win_chat_cursor_y;
+        window->win_chat_cursor_x = 0;
+        window->win_chat_cursor_y = 0;
+        num_lines = 0;
+    }
+    else
+    {
+        if (window->win_chat_cursor_y > window->win_chat_height - 1)
+            return 0;
+        x = window->win_chat_cursor_x;
+        y = window->win_chat_cursor_y;
+        num_lines = gui_chat_display_line (window, line, 0, 1);
+        window->win_chat_cursor_x = x;
+        window->win_chat_cursor_y = y;
+        gui_window_current_emphasis = 0;
+    }
+
+    pre_lines_displayed = 0;
+    lines_displayed = 0;
+
+    /* display message before first line of buffer if date is not today */
+    if ((line->data->date != 0)
+        && CONFIG_BOOLEAN(config_look_day_change)
+        && window->buffer->day_change)
+    {
+        ptr_time = NULL;
+        ptr_prev_line = gui_line_get_prev_displayed (line);
+        if (ptr_prev_line)
+        {
+            while (ptr_prev_line && (ptr_prev_line->data->date == 0))
+            {
+                ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
+            }
+        }
+        if (!ptr_prev_line)
+        {
+            gettimeofday (&tv_time, NULL);
+            seconds = tv_time.tv_sec;
+            localtime_r (&seconds, &local_time);
+            localtime_r (&line->data->date, &local_time2);
+            if ((local_time.tm_mday != local_time2.tm_mday)
+                || (local_time.tm_mon != local_time2.tm_mon)
+                || (local_time.tm_year != local_time2.tm_year))
+            {
+                gui_chat_display_day_changed (window, NULL, &local_time2,
+                                              simulate);
+                gui_chat_display_new_line (window, num_lines, count,
+                                           &lines_displayed, simulate);
+                pre_lines_displayed++;
+            }
+        }
+    }
+
+    /* calculate marker position (maybe not used for this line!) */
+    if (window->buffer->time_for_each_line && line->data->str_time)
+        read_marker_x = x + gui_chat_strlen_screen (line->data->str_time);
+    else
+        read_marker_x = x;
+    read_marker_y = y;
+
+    /*
+     * display time, prefix and message; when simulating, the number of lines
+     * is computed only once for a given width (layout of lines in window)
+     */
+    layout_width = 0;
+    layout_lines = -1;
+    if (simulate && (pre_lines_displayed == 0))
+    {
+        layout_width = gui_chat_get_real_width (window);
+        layout_lines = gui_window_lines_layout_get (window, line->data,
+                                                    layout_width);
+    }
+    if (layout_lines >= 0)
+    {
+        lines_displayed += layout_lines;
+    }
+    else
+    {
+        gui_chat_display_line_message (window, line, num_lines, count,
+                                       pre_lines_displayed, &lines_displayed,
+                                       simulate);
+        if (simulate && (pre_lines_displayed == 0))
+        {
+            gui_window_lines_layout_set (window, line->data, layout_width,
+                                         lines_displayed);
+        }
+    }
 
     /* display message if day has changed after this line */
     if ((line->data->date != 0)
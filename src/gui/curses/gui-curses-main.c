@@ -568,6 +568,9 @@ gui_main_end (int clean_exit)
 
         /* free some variables used for hotlist */
         gui_hotlist_end ();
+
+        /* free some variables used for lines */
+        gui_line_end ();
     }
 
     /* end of Curses output */
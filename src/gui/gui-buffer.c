@@ -58,6 +58,7 @@
 #include "gui-line.h"
 #include "gui-main.h"
 #include "gui-nicklist.h"
+#include "gui-search-index.h"
 #include "gui-window.h"
 
 
@@ -80,10 +81,11 @@ char *gui_buffer_properties_get_integer[] =
 { "number", "layout_number", "layout_number_merge_order", "type", "notify",
   "num_displayed", "active", "hidden", "zoomed", "print_hooks_enabled",
   "day_change", "clear", "filter", "closing", "lines_hidden",
-  "prefix_max_length", "time_for_each_line", "nicklist",
+  "lines_batch", "prefix_max_length", "time_for_each_line", "nicklist",
   "nicklist_case_sensitive", "nicklist_max_length", "nicklist_display_groups",
   "nicklist_count", "nicklist_groups_count", "nicklist_nicks_count",
-  "nicklist_visible_count", "input", "input_get_unknown_commands",
+  "nicklist_visible_count", "nicklist_batch", "input",
+  "input_get_unknown_commands",
   "input_size", "input_length", "input_pos", "input_1st_display",
   "num_history", "text_search", "text_search_exact", "text_search_regex",
   "text_search_where", "text_search_found",
@@ -102,8 +104,9 @@ char *gui_buffer_properties_get_pointer[] =
 char *gui_buffer_properties_set[] =
 { "hotlist", "unread", "display", "hidden", "print_hooks_enabled", "day_change",
   "clear", "filter", "number", "name", "short_name", "type", "notify", "title",
-  "time_for_each_line", "nicklist", "nicklist_case_sensitive",
-  "nicklist_display_groups", "highlight_words", "highlight_words_add",
+  "lines_batch", "time_for_each_line", "nicklist", "nicklist_case_sensitive",
+  "nicklist_display_groups", "nicklist_batch", "highlight_words",
+  "highlight_words_add",
   "highlight_words_del", "highlight_regex", "highlight_tags_restrict",
   "highlight_tags", "hotlist_max_level_nicks", "hotlist_max_level_nicks_add",
   "hotlist_max_level_nicks_del", "input", "input_pos",
@@ -639,6 +642,10 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->lines = new_buffer->own_lines;
     new_buffer->time_for_each_line = 1;
     new_buffer->chat_refresh_needed = 2;
+    new_buffer->lines_batch = 0;
+    new_buffer->lines_batch_hotlist = NULL;
+    new_buffer->lines_batch_refresh = 0;
+    new_buffer->lines_batch_hidden = 0;
 
     /* nicklist */
     new_buffer->nicklist = 0;
@@ -650,6 +657,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->nicklist_groups_count = 0;
     new_buffer->nicklist_nicks_count = 0;
     new_buffer->nicklist_visible_count = 0;
+    new_buffer->nicklist_batch = 0;
     new_buffer->nickcmp_callback = NULL;
     new_buffer->nickcmp_callback_pointer = NULL;
     new_buffer->nickcmp_callback_data = NULL;
@@ -696,6 +704,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->text_search_where = 0;
     new_buffer->text_search_found = 0;
     new_buffer->text_search_input = NULL;
+    new_buffer->search_index = NULL;
 
     /* highlight */
     new_buffer->highlight_words = NULL;
@@ -704,9 +713,11 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->highlight_tags_restrict = NULL;
     new_buffer->highlight_tags_restrict_count = 0;
     new_buffer->highlight_tags_restrict_array = NULL;
+    new_buffer->highlight_tags_restrict_match = NULL;
     new_buffer->highlight_tags = NULL;
     new_buffer->highlight_tags_count = 0;
     new_buffer->highlight_tags_array = NULL;
+    new_buffer->highlight_tags_match = NULL;
 
     /* hotlist */
     new_buffer->hotlist = NULL;
@@ -967,6 +978,7 @@ gui_buffer_set_plugin_for_upgrade (char *name, struct t_weechat_plugin *plugin)
             ptr_buffer->plugin = plugin;
 
             gui_buffer_build_full_name (ptr_buffer);
+            gui_filter_buffer_invalidate (ptr_buffer, 1);
         }
     }
 }
@@ -1039,6 +1051,8 @@ gui_buffer_get_integer (struct t_gui_buffer *buffer, const char *property)
         return buffer->closing;
     else if (string_strcasecmp (property, "lines_hidden") == 0)
         return buffer->lines->lines_hidden;
+    else if (string_strcasecmp (property, "lines_batch") == 0)
+        return buffer->lines_batch;
     else if (string_strcasecmp (property, "prefix_max_length") == 0)
         return buffer->lines->prefix_max_length;
     else if (string_strcasecmp (property, "time_for_each_line") == 0)
@@ -1059,6 +1073,8 @@ gui_buffer_get_integer (struct t_gui_buffer *buffer, const char *property)
         return buffer->nicklist_nicks_count;
     else if (string_strcasecmp (property, "nicklist_visible_count") == 0)
         return buffer->nicklist_visible_count;
+    else if (string_strcasecmp (property, "nicklist_batch") == 0)
+        return buffer->nicklist_batch;
     else if (string_strcasecmp (property, "input") == 0)
         return buffer->input;
     else if (string_strcasecmp (property, "input_get_unknown_commands") == 0)
@@ -1156,6 +1172,9 @@ gui_buffer_get_pointer (struct t_gui_buffer *buffer, const char *property)
 
 /*
  * Sets flag "chat_refresh_needed".
+ *
+ * If lines are added in batch in buffer, the refresh is delayed until the end
+ * of batch.
  */
 
 void
@@ -1164,6 +1183,13 @@ gui_buffer_ask_chat_refresh (struct t_gui_buffer *buffer, int refresh)
     if (!buffer)
         return;
 
+    if (buffer->lines_batch)
+    {
+        if (refresh > buffer->lines_batch_refresh)
+            buffer->lines_batch_refresh = refresh;
+        return;
+    }
+
     if (refresh > buffer->chat_refresh_needed)
         buffer->chat_refresh_needed = refresh;
 }
@@ -1182,6 +1208,7 @@ gui_buffer_set_name (struct t_gui_buffer *buffer, const char *name)
         free (buffer->name);
     buffer->name = strdup (name);
     gui_buffer_build_full_name (buffer);
+    gui_filter_buffer_invalidate (buffer, 1);
 
     gui_buffer_local_var_add (buffer, "name", name);
 
@@ -1315,6 +1342,60 @@ gui_buffer_set_nicklist_display_groups (struct t_gui_buffer *buffer,
     gui_window_ask_refresh (1);
 }
 
+/*
+ * Sets flag "nicklist_batch" for a buffer: when enabled, nicks added are not
+ * sorted and no signal is sent for each nick; when disabled, nicklist is
+ * sorted and a single signal is sent (see function gui_nicklist_batch_end).
+ */
+
+void
+gui_buffer_set_nicklist_batch (struct t_gui_buffer *buffer, int batch)
+{
+    if (!buffer)
+        return;
+
+    batch = (batch) ? 1 : 0;
+    if (batch == buffer->nicklist_batch)
+        return;
+
+    buffer->nicklist_batch = batch;
+    if (!batch)
+        gui_nicklist_batch_end (buffer);
+}
+
+/*
+ * Sets flag "lines_batch" for a buffer: when enabled, hotlist is not updated
+ * and chat is not refreshed for each line added; when disabled, hotlist is
+ * updated and chat refreshed once for all lines added during the batch (see
+ * function gui_line_batch_end).
+ */
+
+void
+gui_buffer_set_lines_batch (struct t_gui_buffer *buffer, int batch)
+{
+    if (!buffer)
+        return;
+
+    batch = (batch) ? 1 : 0;
+    if (batch == buffer->lines_batch)
+        return;
+
+    if (batch)
+    {
+        buffer->lines_batch_hotlist = calloc (
+            GUI_HOTLIST_NUM_PRIORITIES,
+            sizeof (*buffer->lines_batch_hotlist));
+        buffer->lines_batch_refresh = 0;
+        buffer->lines_batch_hidden = 0;
+        buffer->lines_batch = 1;
+    }
+    else
+    {
+        buffer->lines_batch = 0;
+        gui_line_batch_end (buffer);
+    }
+}
+
 /*
  * Sets highlight words for a buffer.
  */
@@ -1550,6 +1631,11 @@ gui_buffer_set_highlight_tags_restrict (struct t_gui_buffer *buffer,
         free (buffer->highlight_tags_restrict_array);
         buffer->highlight_tags_restrict_array = NULL;
     }
+    if (buffer->highlight_tags_restrict_match)
+    {
+        gui_line_tags_match_free (buffer->highlight_tags_restrict_match);
+        buffer->highlight_tags_restrict_match = NULL;
+    }
     buffer->highlight_tags_restrict_count = 0;
 
     if (!new_tags)
@@ -1576,6 +1662,9 @@ gui_buffer_set_highlight_tags_restrict (struct t_gui_buffer *buffer,
             }
         }
         string_free_split (tags_array);
+        buffer->highlight_tags_restrict_match = gui_line_tags_match_new (
+            buffer->highlight_tags_restrict_count,
+            buffer->highlight_tags_restrict_array);
     }
 }
 
@@ -1607,6 +1696,11 @@ gui_buffer_set_highlight_tags (struct t_gui_buffer *buffer,
         free (buffer->highlight_tags_array);
         buffer->highlight_tags_array = NULL;
     }
+    if (buffer->highlight_tags_match)
+    {
+        gui_line_tags_match_free (buffer->highlight_tags_match);
+        buffer->highlight_tags_match = NULL;
+    }
     buffer->highlight_tags_count = 0;
 
     if (!new_tags)
@@ -1633,6 +1727,9 @@ gui_buffer_set_highlight_tags (struct t_gui_buffer *buffer,
             }
         }
         string_free_split (tags_array);
+        buffer->highlight_tags_match = gui_line_tags_match_new (
+            buffer->highlight_tags_count,
+            buffer->highlight_tags_array);
     }
 }
 
@@ -1925,6 +2022,13 @@ gui_buffer_set (struct t_gui_buffer *buffer, const char *property,
     {
         gui_buffer_set_title (buffer, value);
     }
+    else if (string_strcasecmp (property, "lines_batch") == 0)
+    {
+        error = NULL;
+        number = strtol (value, &error, 10);
+        if (error && !error[0])
+            gui_buffer_set_lines_batch (buffer, number);
+    }
     else if (string_strcasecmp (property, "time_for_each_line") == 0)
     {
         error = NULL;
@@ -1953,6 +2057,13 @@ gui_buffer_set (struct t_gui_buffer *buffer, const char *property,
         if (error && !error[0])
             gui_buffer_set_nicklist_display_groups (buffer, number);
     }
+    else if (string_strcasecmp (property, "nicklist_batch") == 0)
+    {
+        error = NULL;
+        number = strtol (value, &error, 10);
+        if (error && !error[0])
+            gui_buffer_set_nicklist_batch (buffer, number);
+    }
     else if (string_strcasecmp (property, "highlight_words") == 0)
     {
         gui_buffer_set_highlight_words (buffer, value);
@@ -2706,10 +2817,8 @@ gui_buffer_close (struct t_gui_buffer *buffer)
 
     /* free all lines */
     gui_line_free_all (buffer);
-    if (buffer->own_lines)
-        free (buffer->own_lines);
-    if (buffer->mixed_lines)
-        free (buffer->mixed_lines);
+    gui_lines_free (buffer->own_lines);
+    gui_lines_free (buffer->mixed_lines);
 
     /* free some data */
     gui_buffer_undo_free_all (buffer);
@@ -2720,6 +2829,8 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     gui_nicklist_remove_group (buffer, buffer->nicklist_root);
     if (buffer->hotlist_max_level_nicks)
         hashtable_free (buffer->hotlist_max_level_nicks);
+    if (buffer->lines_batch_hotlist)
+        free (buffer->lines_batch_hotlist);
     gui_key_free_all (&buffer->keys, &buffer->last_key,
                       &buffer->keys_count);
     gui_buffer_local_var_remove_all (buffer);
@@ -2764,6 +2875,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         }
         free (buffer->highlight_tags_restrict_array);
     }
+    gui_line_tags_match_free (buffer->highlight_tags_restrict_match);
     if (buffer->highlight_tags)
         free (buffer->highlight_tags);
     if (buffer->highlight_tags_array)
@@ -2774,6 +2886,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         }
         free (buffer->highlight_tags_array);
     }
+    gui_line_tags_match_free (buffer->highlight_tags_match);
     if (buffer->input_callback_data)
         free (buffer->input_callback_data);
     if (buffer->close_callback_data)
@@ -4108,6 +4221,10 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, lines, POINTER, 0, NULL, "lines");
         HDATA_VAR(struct t_gui_buffer, time_for_each_line, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, chat_refresh_needed, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch_hotlist, POINTER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch_refresh, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch_hidden, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_case_sensitive, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_root, POINTER, 0, NULL, "nick_group");
@@ -4117,6 +4234,7 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, nicklist_groups_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_nicks_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_visible_count, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, nicklist_batch, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback_pointer, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback_data, POINTER, 0, NULL, NULL);
@@ -4297,6 +4415,8 @@ gui_buffer_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!infolist_new_var_integer (ptr_item, "lines_hidden", buffer->lines->lines_hidden))
         return 0;
+    if (!infolist_new_var_integer (ptr_item, "lines_batch", buffer->lines_batch))
+        return 0;
     if (!infolist_new_var_integer (ptr_item, "prefix_max_length", buffer->lines->prefix_max_length))
         return 0;
     if (!infolist_new_var_integer (ptr_item, "time_for_each_line", buffer->time_for_each_line))
@@ -4315,6 +4435,8 @@ gui_buffer_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!infolist_new_var_integer (ptr_item, "nicklist_visible_count", buffer->nicklist_visible_count))
         return 0;
+    if (!infolist_new_var_integer (ptr_item, "nicklist_batch", buffer->nicklist_batch))
+        return 0;
     if (!infolist_new_var_string (ptr_item, "title", buffer->title))
         return 0;
     if (!infolist_new_var_integer (ptr_item, "input", buffer->input))
@@ -4515,6 +4637,10 @@ gui_buffer_print_log ()
         log_printf ("  lines . . . . . . . . . : 0x%lx", ptr_buffer->lines);
         log_printf ("  time_for_each_line. . . : %d",    ptr_buffer->time_for_each_line);
         log_printf ("  chat_refresh_needed . . : %d",    ptr_buffer->chat_refresh_needed);
+        log_printf ("  lines_batch . . . . . . : %d",    ptr_buffer->lines_batch);
+        log_printf ("  lines_batch_hotlist . . : 0x%lx", ptr_buffer->lines_batch_hotlist);
+        log_printf ("  lines_batch_refresh . . : %d",    ptr_buffer->lines_batch_refresh);
+        log_printf ("  lines_batch_hidden. . . : %d",    ptr_buffer->lines_batch_hidden);
         log_printf ("  nicklist. . . . . . . . : %d",    ptr_buffer->nicklist);
         log_printf ("  nicklist_case_sensitive : %d",    ptr_buffer->nicklist_case_sensitive);
         log_printf ("  nicklist_root . . . . . : 0x%lx", ptr_buffer->nicklist_root);
@@ -4524,6 +4650,7 @@ gui_buffer_print_log ()
         log_printf ("  nicklist_groups_count . : %d",    ptr_buffer->nicklist_groups_count);
         log_printf ("  nicklist_nicks_count. . : %d",    ptr_buffer->nicklist_nicks_count);
         log_printf ("  nicklist_visible_count. : %d",    ptr_buffer->nicklist_visible_count);
+        log_printf ("  nicklist_batch. . . . . : %d",    ptr_buffer->nicklist_batch);
         log_printf ("  nickcmp_callback. . . . : 0x%lx", ptr_buffer->nickcmp_callback);
         log_printf ("  nickcmp_callback_pointer: 0x%lx", ptr_buffer->nickcmp_callback_pointer);
         log_printf ("  nickcmp_callback_data . : 0x%lx", ptr_buffer->nickcmp_callback_data);
@@ -4564,6 +4691,7 @@ gui_buffer_print_log ()
         log_printf ("  text_search_where . . . : %d",    ptr_buffer->text_search_where);
         log_printf ("  text_search_found . . . : %d",    ptr_buffer->text_search_found);
         log_printf ("  text_search_input . . . : '%s'",  ptr_buffer->text_search_input);
+        log_printf ("  search_index. . . . . . : 0x%lx", ptr_buffer->search_index);
         log_printf ("  highlight_words . . . . : '%s'",  ptr_buffer->highlight_words);
         log_printf ("  highlight_regex . . . . : '%s'",  ptr_buffer->highlight_regex);
         log_printf ("  highlight_regex_compiled: 0x%lx", ptr_buffer->highlight_regex_compiled);
@@ -4587,6 +4715,8 @@ gui_buffer_print_log ()
                                  "hotlist_max_level_nicks");
         }
 
+        gui_search_index_print_log (ptr_buffer);
+
         if (ptr_buffer->keys)
         {
             log_printf ("");
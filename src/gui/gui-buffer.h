@@ -26,6 +26,8 @@
 struct t_hashtable;
 struct t_gui_window;
 struct t_infolist;
+struct t_gui_line_tags_match;
+struct t_gui_search_index;
 
 enum t_gui_buffer_type
 {
@@ -124,6 +126,12 @@ struct t_gui_buffer
     int time_for_each_line;            /* time is displayed for each line?  */
     int chat_refresh_needed;           /* refresh for chat is needed ?      */
                                        /* (1=refresh, 2=erase+refresh)      */
+    int lines_batch;                   /* 1 if lines are added in batch     */
+                                       /* (hotlist/refresh at end of batch) */
+    int *lines_batch_hotlist;          /* hotlist count by priority, for    */
+                                       /* lines added in batch              */
+    int lines_batch_refresh;           /* refresh asked during batch        */
+    int lines_batch_hidden;            /* 1 if lines hidden during batch    */
 
     /* nicklist */
     int nicklist;                      /* = 1 if nicklist is enabled        */
@@ -135,6 +143,8 @@ struct t_gui_buffer
     int nicklist_groups_count;         /* number of groups                  */
     int nicklist_nicks_count;          /* number of nicks                   */
     int nicklist_visible_count;        /* number of nicks/groups to display */
+    int nicklist_batch;                /* 1 if nicks are added in batch     */
+                                       /* (nicklist sorted at end of batch) */
     int (*nickcmp_callback)(const void *pointer, /* called to compare nicks */
                             void *data,          /* (search in nicklist)    */
                             struct t_gui_buffer *buffer,
@@ -185,6 +195,8 @@ struct t_gui_buffer
     int text_search_where;             /* search where? prefix and/or msg   */
     int text_search_found;             /* 1 if text found, otherwise 0      */
     char *text_search_input;           /* input saved before text search    */
+    struct t_gui_search_index *search_index; /* index of lines for text */
+                                       /* search (built on first search)    */
 
     /* highlight settings for buffer */
     char *highlight_words;             /* list of words to highlight        */
@@ -193,9 +205,13 @@ struct t_gui_buffer
     char *highlight_tags_restrict;     /* restrict highlight to these tags  */
     int highlight_tags_restrict_count; /* number of restricted tags         */
     char ***highlight_tags_restrict_array; /* array with restricted tags    */
+    struct t_gui_line_tags_match *highlight_tags_restrict_match;
+                                       /* restricted tags (compiled)        */
     char *highlight_tags;              /* force highlight on these tags     */
     int highlight_tags_count;          /* number of highlight tags          */
     char ***highlight_tags_array;      /* array with highlight tags         */
+    struct t_gui_line_tags_match *highlight_tags_match;
+                                       /* highlight tags (compiled)         */
 
     /* hotlist */
     struct t_gui_hotlist *hotlist;     /* hotlist entry for buffer          */
@@ -541,8 +541,8 @@ gui_chat_change_time_format ()
         {
             if (ptr_line->data->date != 0)
             {
-                if (ptr_line->data->str_time)
-                    free (ptr_line->data->str_time);
+                gui_line_free_string (ptr_line->data,
+                                      ptr_line->data->str_time);
                 ptr_line->data->str_time = gui_chat_get_time_string (ptr_line->data->date);
             }
         }
@@ -701,7 +701,7 @@ gui_chat_printf_date_tags (struct t_gui_buffer *buffer, time_t date,
         /* call modifier for message printed ("weechat_print") */
         new_msg = NULL;
         msg_discarded = 0;
-        if (buffer)
+        if (buffer && hook_modifier_exists ("weechat_print"))
         {
             length = strlen (gui_buffer_get_plugin_name (buffer)) + 1 +
                 strlen (buffer->name) + 1 + ((tags) ? strlen (tags) : 0) + 1;
@@ -48,9 +48,82 @@ struct t_gui_filter *last_gui_filter = NULL;       /* last filter           */
 int gui_filters_enabled = 1;                       /* filters enabled?      */
 
 
+/*
+ * Sets or clears the bit of a filter in the bitset of filters matching a line.
+ */
+
+void
+gui_filter_line_set_match (struct t_gui_line_data *line_data, int filter_id,
+                           int match)
+{
+    unsigned char *new_filters_match;
+    int index, new_size;
+
+    index = filter_id / 8;
+
+    if (index >= line_data->filters_match_size)
+    {
+        if (!match)
+            return;
+        new_size = index + 1;
+        new_filters_match = realloc (line_data->filters_match, new_size);
+        if (!new_filters_match)
+            return;
+        memset (new_filters_match + line_data->filters_match_size, 0,
+                new_size - line_data->filters_match_size);
+        line_data->filters_match = new_filters_match;
+        line_data->filters_match_size = new_size;
+    }
+
+    if (match)
+        line_data->filters_match[index] |= 1 << (filter_id % 8);
+    else
+        line_data->filters_match[index] &= ~(1 << (filter_id % 8));
+}
+
+/*
+ * Checks if a filter matches a line (buffer of line is not checked).
+ *
+ * Returns:
+ *   1: filter matches line (line must be hidden if filter is enabled)
+ *   0: filter does not match line
+ */
+
+int
+gui_filter_match_line (struct t_gui_filter *filter,
+                       struct t_gui_line_data *line_data)
+{
+    int rc;
+
+    if ((strcmp (filter->tags, "*") != 0)
+        && !gui_line_match_tags (line_data, filter->tags_match))
+    {
+        return 0;
+    }
+
+    /* check line with regex */
+    rc = 1;
+    if (!filter->regex_prefix && !filter->regex_message)
+        rc = 0;
+    if (gui_line_match_regex (line_data,
+                              filter->regex_prefix,
+                              filter->regex_message))
+    {
+        rc = 0;
+    }
+    if (filter->regex && (filter->regex[0] == '!'))
+        rc ^= 1;
+
+    return (rc == 0) ? 1 : 0;
+}
+
 /*
  * Checks if a line must be displayed or not (filtered).
  *
+ * The line is checked with all filters (even disabled ones) and the result is
+ * stored in the line (bitset of filters matching the line), so that enabling
+ * or disabling a filter later does not require to check lines again.
+ *
  * Returns:
  *   1: line must be displayed (not filtered)
  *   0: line must be hidden (filtered)
@@ -60,58 +133,294 @@ int
 gui_filter_check_line (struct t_gui_line_data *line_data)
 {
     struct t_gui_filter *ptr_filter;
-    int rc;
+    int displayed, match;
+
+    if (line_data->filters_match)
+        memset (line_data->filters_match, 0, line_data->filters_match_size);
+
+    displayed = 1;
+    match = 0;
+
+    if (gui_filters && !gui_line_has_tag_no_filter (line_data))
+    {
+        for (ptr_filter = gui_filters; ptr_filter;
+             ptr_filter = ptr_filter->next_filter)
+        {
+            if (gui_buffer_match_list_split (line_data->buffer,
+                                             ptr_filter->num_buffers,
+                                             ptr_filter->buffers)
+                && gui_filter_match_line (ptr_filter, line_data))
+            {
+                gui_filter_line_set_match (line_data, ptr_filter->id, 1);
+                match = 1;
+                if (ptr_filter->enabled)
+                    displayed = 0;
+            }
+        }
+    }
+
+    /* free the bitset if no filter matches line */
+    if (!match && line_data->filters_match)
+    {
+        free (line_data->filters_match);
+        line_data->filters_match = NULL;
+        line_data->filters_match_size = 0;
+    }
 
     /* line is always displayed if filters are disabled (globally or in buffer) */
     if (!gui_filters_enabled || !line_data->buffer->filter)
         return 1;
 
-    if (gui_line_has_tag_no_filter (line_data))
+    return displayed;
+}
+
+/*
+ * Checks if a line must be displayed or not, using the bitset of filters
+ * matching the line (filters are not checked).
+ *
+ * Argument "filters_mask" is the bitset of filters enabled for the buffer of
+ * line (with "size" bytes).
+ *
+ * Returns:
+ *   1: line must be displayed (not filtered)
+ *   0: line must be hidden (filtered)
+ */
+
+int
+gui_filter_check_line_cached (struct t_gui_line_data *line_data,
+                              const unsigned char *filters_mask, int size)
+{
+    int i;
+
+    if (!line_data->filters_match)
         return 1;
 
+    if (size > line_data->filters_match_size)
+        size = line_data->filters_match_size;
+
+    for (i = 0; i < size; i++)
+    {
+        if (line_data->filters_match[i] & filters_mask[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Returns the size of bitsets of filters (in bytes), according to the
+ * highest filter id.
+ */
+
+int
+gui_filter_bitset_size ()
+{
+    struct t_gui_filter *ptr_filter;
+    int max_id;
+
+    max_id = -1;
     for (ptr_filter = gui_filters; ptr_filter;
          ptr_filter = ptr_filter->next_filter)
     {
-        if (ptr_filter->enabled)
-        {
-            /* check buffer */
-            if (gui_buffer_match_list_split (line_data->buffer,
+        if (ptr_filter->id > max_id)
+            max_id = ptr_filter->id;
+    }
+
+    return (max_id / 8) + 1;
+}
+
+/*
+ * Initializes a context to filter lines of a buffer: list of new filters
+ * (filters matching the buffer are checked on lines, other filters are
+ * cleared in lines because the id may have been used by a removed filter)
+ * and bitset of filters enabled in buffer.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+gui_filter_context_init (struct t_gui_filter_context *context,
+                         struct t_gui_buffer *buffer,
+                         int num_new_filters, int size)
+{
+    struct t_gui_filter *ptr_filter;
+    int i, match;
+
+    context->buffer = buffer;
+    context->filtering = (gui_filters_enabled && buffer->filter) ? 1 : 0;
+    context->new_filters = NULL;
+    context->num_check = 0;
+    context->num_clear = 0;
+    context->mask = NULL;
+    context->size = size;
+
+    if (num_new_filters > 0)
+    {
+        context->new_filters = malloc (num_new_filters *
+                                       sizeof (*context->new_filters));
+        if (!context->new_filters)
+            return 0;
+    }
+    context->mask = calloc (size, 1);
+    if (!context->mask)
+    {
+        if (context->new_filters)
+            free (context->new_filters);
+        context->new_filters = NULL;
+        return 0;
+    }
+
+    i = num_new_filters;
+    for (ptr_filter = gui_filters; ptr_filter;
+         ptr_filter = ptr_filter->next_filter)
+    {
+        match = gui_buffer_match_list_split (buffer,
                                              ptr_filter->num_buffers,
-                                             ptr_filter->buffers))
+                                             ptr_filter->buffers);
+        if (!ptr_filter->lines_checked)
+        {
+            /* new filters matching buffer first, others at the end */
+            if (match)
             {
-                if ((strcmp (ptr_filter->tags, "*") == 0)
-                    || (gui_line_match_tags (line_data,
-                                             ptr_filter->tags_count,
-                                             ptr_filter->tags_array)))
-                {
-                    /* check line with regex */
-                    rc = 1;
-                    if (!ptr_filter->regex_prefix && !ptr_filter->regex_message)
-                        rc = 0;
-                    if (gui_line_match_regex (line_data,
-                                              ptr_filter->regex_prefix,
-                                              ptr_filter->regex_message))
-                    {
-                        rc = 0;
-                    }
-                    if (ptr_filter->regex && (ptr_filter->regex[0] == '!'))
-                        rc ^= 1;
-                    if (rc == 0)
-                        return 0;
-                }
+                context->new_filters[context->num_check] = ptr_filter;
+                context->num_check++;
+            }
+            else
+            {
+                i--;
+                context->new_filters[i] = ptr_filter;
+                context->num_clear++;
             }
         }
+        if (match && ptr_filter->enabled)
+            context->mask[ptr_filter->id / 8] |= 1 << (ptr_filter->id % 8);
     }
 
-    /* no tag or regex matching, then line is displayed */
     return 1;
 }
 
+/*
+ * Filters a line using a context: line is checked with new filters, then the
+ * bitset of filters matching line is used to check if line is displayed.
+ *
+ * Returns:
+ *   1: line must be displayed (not filtered)
+ *   0: line must be hidden (filtered)
+ */
+
+int
+gui_filter_context_check_line (struct t_gui_filter_context *context,
+                               struct t_gui_line_data *line_data)
+{
+    int i;
+
+    if ((context->num_check > 0)
+        && !gui_line_has_tag_no_filter (line_data))
+    {
+        for (i = 0; i < context->num_check; i++)
+        {
+            gui_filter_line_set_match (
+                line_data,
+                context->new_filters[i]->id,
+                gui_filter_match_line (context->new_filters[i], line_data));
+        }
+    }
+
+    if (line_data->filters_match)
+    {
+        for (i = 0; i < context->num_clear; i++)
+        {
+            gui_filter_line_set_match (
+                line_data,
+                context->new_filters[context->num_check + i]->id,
+                0);
+        }
+    }
+
+    if (!context->filtering)
+        return 1;
+
+    return gui_filter_check_line_cached (line_data, context->mask,
+                                         context->size);
+}
+
+/*
+ * Checks if the bitset of filters enabled in a context is the same as the one
+ * used the last time lines of the buffer were filtered.
+ *
+ * Returns:
+ *   1: same filters (lines of buffer do not need to be filtered again)
+ *   0: filters have changed
+ */
+
+int
+gui_filter_context_is_applied (struct t_gui_filter_context *context)
+{
+    struct t_gui_lines *ptr_lines;
+    unsigned char mask, applied;
+    int i, size;
+
+    ptr_lines = context->buffer->own_lines;
+    if (!ptr_lines->filters_mask)
+        return 0;
+
+    size = (context->size > ptr_lines->filters_mask_size) ?
+        context->size : ptr_lines->filters_mask_size;
+    for (i = 0; i < size; i++)
+    {
+        mask = (context->filtering && (i < context->size)) ?
+            context->mask[i] : 0;
+        applied = (i < ptr_lines->filters_mask_size) ?
+            ptr_lines->filters_mask[i] : 0;
+        if (mask != applied)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Saves the bitset of filters enabled in a context in own lines of the buffer
+ * (lines have been filtered with these filters).
+ */
+
+void
+gui_filter_context_set_applied (struct t_gui_filter_context *context)
+{
+    struct t_gui_lines *ptr_lines;
+    unsigned char *new_mask;
+
+    ptr_lines = context->buffer->own_lines;
+
+    new_mask = realloc (ptr_lines->filters_mask, context->size);
+    if (!new_mask)
+    {
+        if (ptr_lines->filters_mask)
+            free (ptr_lines->filters_mask);
+        ptr_lines->filters_mask = NULL;
+        ptr_lines->filters_mask_size = 0;
+        return;
+    }
+    if (context->filtering)
+        memcpy (new_mask, context->mask, context->size);
+    else
+        memset (new_mask, 0, context->size);
+    ptr_lines->filters_mask = new_mask;
+    ptr_lines->filters_mask_size = context->size;
+}
+
 /*
  * Filters a buffer, using message filters.
  *
- * If line_data is NULL, filters all lines in buffer.
- * If line_data is not NULL, filters only this line_data.
+ * If line_data is NULL, filters all lines in buffer: lines are checked only
+ * with new filters (not yet checked on lines), for other filters the result
+ * stored in lines is used; if there is no new filter and if the filters
+ * enabled in buffer did not change since last filter of lines, nothing is
+ * done.
+ * If line_data is not NULL, filters only this line_data (checked with all
+ * filters).
  */
 
 void
@@ -120,33 +429,121 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
 {
     struct t_gui_line *ptr_line;
     struct t_gui_line_data *ptr_line_data;
+    struct t_gui_buffer *ptr_buffer;
+    struct t_gui_filter *ptr_filter;
+    struct t_gui_filter_context *contexts, *new_contexts, *ptr_context;
     struct t_gui_window *ptr_window;
-    int lines_changed, line_displayed, lines_hidden;
+    int lines_changed, line_displayed, lines_hidden, num_contexts;
+    int num_new_filters, size, applied, i;
 
     lines_changed = 0;
     lines_hidden = buffer->lines->lines_hidden;
 
-    ptr_line = buffer->lines->first_line;
-    while (ptr_line || line_data)
-    {
-        ptr_line_data = (line_data) ? line_data : ptr_line->data;
+    /*
+     * contexts used to filter lines: one by buffer (lines of many buffers
+     * are filtered if buffer is merged with other buffers)
+     */
+    contexts = NULL;
+    num_contexts = 0;
+    ptr_context = NULL;
+    applied = 0;
 
-        line_displayed = gui_filter_check_line (ptr_line_data);
+    if (!line_data)
+    {
+        num_new_filters = 0;
+        for (ptr_filter = gui_filters; ptr_filter;
+             ptr_filter = ptr_filter->next_filter)
+        {
+            if (!ptr_filter->lines_checked)
+                num_new_filters++;
+        }
+        size = gui_filter_bitset_size ();
 
-        if (ptr_line_data->displayed != line_displayed)
+        /* create contexts for the buffer and buffers merged with it */
+        applied = 1;
+        for (ptr_buffer = gui_buffers; ptr_buffer;
+             ptr_buffer = ptr_buffer->next_buffer)
         {
-            lines_changed = 1;
-            lines_hidden += (line_displayed) ? -1 : 1;
+            if ((ptr_buffer != buffer)
+                && (!ptr_buffer->mixed_lines
+                    || (ptr_buffer->mixed_lines != buffer->lines)))
+            {
+                continue;
+            }
+            new_contexts = realloc (contexts,
+                                    (num_contexts + 1) * sizeof (*contexts));
+            if (!new_contexts)
+                break;
+            contexts = new_contexts;
+            if (!gui_filter_context_init (&contexts[num_contexts], ptr_buffer,
+                                          num_new_filters, size))
+            {
+                break;
+            }
+            if (!gui_filter_context_is_applied (&contexts[num_contexts]))
+                applied = 0;
+            num_contexts++;
         }
 
-        ptr_line_data->displayed = line_displayed;
+        /*
+         * nothing to do if there is no new filter and if filters enabled did
+         * not change since last time lines were filtered
+         */
+        if ((num_contexts == 0) || (num_new_filters > 0))
+            applied = 0;
 
-        if (line_data)
-            break;
+        ptr_line = (applied) ? NULL : buffer->lines->first_line;
+        while (ptr_line)
+        {
+            ptr_line_data = ptr_line->data;
+            if (!ptr_context || (ptr_context->buffer != ptr_line_data->buffer))
+            {
+                ptr_context = NULL;
+                for (i = 0; i < num_contexts; i++)
+                {
+                    if (contexts[i].buffer == ptr_line_data->buffer)
+                    {
+                        ptr_context = &contexts[i];
+                        break;
+                    }
+                }
+            }
+            line_displayed = (ptr_context) ?
+                gui_filter_context_check_line (ptr_context, ptr_line_data) :
+                gui_filter_check_line (ptr_line_data);
+            if (ptr_line_data->displayed != line_displayed)
+            {
+                lines_changed = 1;
+                lines_hidden += (line_displayed) ? -1 : 1;
+            }
+            ptr_line_data->displayed = line_displayed;
+            ptr_line = ptr_line->next_line;
+        }
 
-        ptr_line = ptr_line->next_line;
+        for (i = 0; i < num_contexts; i++)
+        {
+            gui_filter_context_set_applied (&contexts[i]);
+            if (contexts[i].new_filters)
+                free (contexts[i].new_filters);
+            free (contexts[i].mask);
+        }
+        if (contexts)
+            free (contexts);
+    }
+    else
+    {
+        line_displayed = gui_filter_check_line (line_data);
+        if (line_data->displayed != line_displayed)
+        {
+            lines_changed = 1;
+            lines_hidden += (line_displayed) ? -1 : 1;
+        }
+        line_data->displayed = line_displayed;
     }
 
+    if (applied)
+        return;
+
     if (line_data)
         line_data->buffer->lines->prefix_max_length_refresh = 1;
     else
@@ -164,6 +561,9 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
         /* force a full refresh of buffer */
         gui_buffer_ask_chat_refresh (buffer, 2);
 
+        /* prefix of lines may change (option weechat.look.prefix_same_nick) */
+        gui_window_lines_layout_invalidate ();
+
         /*
          * check that a scroll in a window displaying this buffer is not on a
          * hidden line (if this happens, use the previous displayed line as
@@ -184,20 +584,67 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
     }
 }
 
+/*
+ * Invalidates filters applied on lines of a buffer: next time the buffer is
+ * filtered, all lines are filtered again (even if filters enabled did not
+ * change).
+ *
+ * If check_lines == 1, lines are also checked again with all filters (for
+ * example when the buffer is renamed: filters matching the buffer may have
+ * changed).
+ */
+
+void
+gui_filter_buffer_invalidate (struct t_gui_buffer *buffer, int check_lines)
+{
+    struct t_gui_line *ptr_line;
+
+    if (!buffer || !buffer->own_lines)
+        return;
+
+    if (check_lines)
+    {
+        for (ptr_line = buffer->own_lines->first_line; ptr_line;
+             ptr_line = ptr_line->next_line)
+        {
+            (void) gui_filter_check_line (ptr_line->data);
+        }
+    }
+
+    if (buffer->own_lines->filters_mask)
+    {
+        free (buffer->own_lines->filters_mask);
+        buffer->own_lines->filters_mask = NULL;
+    }
+    buffer->own_lines->filters_mask_size = 0;
+}
+
 /*
  * Filters all buffers, using message filters.
+ *
+ * Lines are checked only with new filters (and only in buffers matching the
+ * filter), then new filters are marked as checked; for other filters, the
+ * result stored in lines is used (so enabling, disabling or removing a filter
+ * does not check lines again).
  */
 
 void
 gui_filter_all_buffers ()
 {
     struct t_gui_buffer *ptr_buffer;
+    struct t_gui_filter *ptr_filter;
 
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
         gui_filter_buffer (ptr_buffer, NULL);
     }
+
+    for (ptr_filter = gui_filters; ptr_filter;
+         ptr_filter = ptr_filter->next_filter)
+    {
+        ptr_filter->lines_checked = 1;
+    }
 }
 
 /*
@@ -254,6 +701,29 @@ gui_filter_search_by_name (const char *name)
     return NULL;
 }
 
+/*
+ * Returns the lowest id not used by a filter.
+ */
+
+int
+gui_filter_new_id ()
+{
+    struct t_gui_filter *ptr_filter;
+    int id;
+
+    for (id = 0; ; id++)
+    {
+        for (ptr_filter = gui_filters; ptr_filter;
+             ptr_filter = ptr_filter->next_filter)
+        {
+            if (ptr_filter->id == id)
+                break;
+        }
+        if (!ptr_filter)
+            return id;
+    }
+}
+
 /*
  * Displays an error when a new filter is created.
  */
@@ -382,7 +852,9 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
     if (new_filter)
     {
         /* init filter */
+        new_filter->id = gui_filter_new_id ();
         new_filter->enabled = enabled;
+        new_filter->lines_checked = 0;
         new_filter->name = strdup (name);
         new_filter->buffer_name = strdup ((buffer_name) ? buffer_name : "*");
         new_filter->buffers = string_split (new_filter->buffer_name,
@@ -411,6 +883,8 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
                 string_free_split (tags_array);
             }
         }
+        new_filter->tags_match = gui_line_tags_match_new (
+            new_filter->tags_count, new_filter->tags_array);
         new_filter->regex = strdup (regex);
         new_filter->regex_prefix = regex1;
         new_filter->regex_message = regex2;
@@ -490,6 +964,7 @@ gui_filter_free (struct t_gui_filter *filter)
         }
         free (filter->tags_array);
     }
+    gui_line_tags_match_free (filter->tags_match);
     if (filter->regex)
         free (filter->regex);
     if (filter->regex_prefix)
@@ -640,7 +1115,9 @@ gui_filter_print_log ()
     {
         log_printf ("");
         log_printf ("[filter (addr:0x%lx)]", ptr_filter);
+        log_printf ("  id . . . . . . . . . . : %d",    ptr_filter->id);
         log_printf ("  enabled. . . . . . . . : %d",    ptr_filter->enabled);
+        log_printf ("  lines_checked. . . . . : %d",    ptr_filter->lines_checked);
         log_printf ("  name . . . . . . . . . : '%s'",  ptr_filter->name);
         log_printf ("  buffer_name. . . . . . : '%s'",  ptr_filter->buffer_name);
         log_printf ("  num_buffers. . . . . . : %d",    ptr_filter->num_buffers);
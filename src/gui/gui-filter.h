@@ -27,10 +27,15 @@
 /* filter structures */
 
 struct t_gui_line_data;
+struct t_gui_line_tags_match;
 
 struct t_gui_filter
 {
+    int id;                            /* filter id (bit in the bitset of   */
+                                       /* filters matching a line)          */
     int enabled;                       /* 1 if filter enabled, otherwise 0  */
+    int lines_checked;                 /* 1 if lines of buffers have been   */
+                                       /* checked with this filter          */
     char *name;                        /* filter name                       */
     char *buffer_name;                 /* name of buffer(s)                 */
     int num_buffers;                   /* number of buffers in list         */
@@ -38,6 +43,7 @@ struct t_gui_filter
     char *tags;                        /* tags                              */
     int tags_count;                    /* number of tags                    */
     char ***tags_array;                /* array of tags                     */
+    struct t_gui_line_tags_match *tags_match; /* tags compiled (fast match) */
     char *regex;                       /* regex                             */
     regex_t *regex_prefix;             /* regex for line prefix             */
     regex_t *regex_message;            /* regex for line message            */
@@ -45,6 +51,21 @@ struct t_gui_filter
     struct t_gui_filter *next_filter;  /* link to next filter               */
 };
 
+/* context used to filter lines of a buffer */
+
+struct t_gui_filter_context
+{
+    struct t_gui_buffer *buffer;       /* buffer of lines                   */
+    int filtering;                     /* 1 if filters enabled in buffer    */
+    struct t_gui_filter **new_filters; /* new filters (not yet checked):    */
+                                       /* matching buffer, then the others  */
+    int num_check;                     /* number of new filters to check    */
+    int num_clear;                     /* number of new filters to clear    */
+    unsigned char *mask;               /* bitset of filters enabled in      */
+                                       /* buffer                            */
+    int size;                          /* size of bitset (in bytes)         */
+};
+
 /* filter variables */
 
 extern struct t_gui_filter *gui_filters;
@@ -53,13 +74,31 @@ extern int gui_filters_enabled;
 
 /* filter functions */
 
+extern void gui_filter_line_set_match (struct t_gui_line_data *line_data,
+                                       int filter_id, int match);
+extern int gui_filter_match_line (struct t_gui_filter *filter,
+                                  struct t_gui_line_data *line_data);
 extern int gui_filter_check_line (struct t_gui_line_data *line_data);
+extern int gui_filter_check_line_cached (struct t_gui_line_data *line_data,
+                                         const unsigned char *filters_mask,
+                                         int size);
+extern int gui_filter_bitset_size ();
+extern int gui_filter_context_init (struct t_gui_filter_context *context,
+                                    struct t_gui_buffer *buffer,
+                                    int num_new_filters, int size);
+extern int gui_filter_context_check_line (struct t_gui_filter_context *context,
+                                          struct t_gui_line_data *line_data);
+extern int gui_filter_context_is_applied (struct t_gui_filter_context *context);
+extern void gui_filter_context_set_applied (struct t_gui_filter_context *context);
 extern void gui_filter_buffer (struct t_gui_buffer *buffer,
                                struct t_gui_line_data *line_data);
+extern void gui_filter_buffer_invalidate (struct t_gui_buffer *buffer,
+                                         int check_lines);
 extern void gui_filter_all_buffers ();
 extern void gui_filter_global_enable ();
 extern void gui_filter_global_disable ();
 extern struct t_gui_filter *gui_filter_search_by_name (const char *name);
+extern int gui_filter_new_id ();
 extern struct t_gui_filter *gui_filter_new (int enabled,
                                             const char *name,
                                             const char *buffer_name,
@@ -284,7 +284,11 @@ gui_hotlist_add_hotlist (struct t_gui_hotlist **hotlist,
 }
 
 /*
- * Adds a buffer to hotlist, with priority.
+ * Adds a buffer to hotlist, with priority and number of messages (count is
+ * added to the count of messages with this priority).
+ *
+ * Conditions to add buffer in hotlist are evaluated only once, whatever the
+ * number of messages.
  *
  * If creation_time is NULL, current time is used.
  *
@@ -293,15 +297,16 @@ gui_hotlist_add_hotlist (struct t_gui_hotlist **hotlist,
  */
 
 struct t_gui_hotlist *
-gui_hotlist_add (struct t_gui_buffer *buffer,
-                 enum t_gui_hotlist_priority priority,
-                 struct timeval *creation_time)
+gui_hotlist_add_count (struct t_gui_buffer *buffer,
+                       enum t_gui_hotlist_priority priority,
+                       struct timeval *creation_time,
+                       int messages_count)
 {
     struct t_gui_hotlist *new_hotlist, *ptr_hotlist;
     int i, count[GUI_HOTLIST_NUM_PRIORITIES], rc;
     char *value, str_value[32];
 
-    if (!buffer || !gui_add_hotlist)
+    if (!buffer || !gui_add_hotlist || (messages_count < 1))
         return NULL;
 
     /* do not add core buffer if upgrading */
@@ -381,7 +386,7 @@ gui_hotlist_add (struct t_gui_buffer *buffer,
         /* return if priority is greater or equal than the one to add */
         if (ptr_hotlist->priority >= priority)
         {
-            ptr_hotlist->count[priority]++;
+            ptr_hotlist->count[priority] += messages_count;
             gui_hotlist_changed_signal ();
             return ptr_hotlist;
         }
@@ -409,7 +414,7 @@ gui_hotlist_add (struct t_gui_buffer *buffer,
     new_hotlist->buffer = buffer;
     buffer->hotlist = new_hotlist;
     memcpy (new_hotlist->count, count, sizeof (new_hotlist->count));
-    new_hotlist->count[priority]++;
+    new_hotlist->count[priority] += messages_count;
     new_hotlist->next_hotlist = NULL;
     new_hotlist->prev_hotlist = NULL;
 
@@ -420,6 +425,23 @@ gui_hotlist_add (struct t_gui_buffer *buffer,
     return new_hotlist;
 }
 
+/*
+ * Adds a buffer to hotlist, with priority (for one message).
+ *
+ * If creation_time is NULL, current time is used.
+ *
+ * Returns pointer to hotlist created or changed, NULL if no hotlist was
+ * created/changed.
+ */
+
+struct t_gui_hotlist *
+gui_hotlist_add (struct t_gui_buffer *buffer,
+                 enum t_gui_hotlist_priority priority,
+                 struct timeval *creation_time)
+{
+    return gui_hotlist_add_count (buffer, priority, creation_time, 1);
+}
+
 /*
  * Duplicates a hotlist element.
  *
@@ -56,6 +56,10 @@ extern int gui_add_hotlist;
 
 /* hotlist functions */
 
+extern struct t_gui_hotlist *gui_hotlist_add_count (struct t_gui_buffer *buffer,
+                                                    enum t_gui_hotlist_priority priority,
+                                                    struct timeval *creation_time,
+                                                    int messages_count);
 extern struct t_gui_hotlist *gui_hotlist_add (struct t_gui_buffer *buffer,
                                               enum t_gui_hotlist_priority priority,
                                               struct timeval *creation_time);
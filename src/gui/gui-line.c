@@ -44,9 +44,24 @@
 #include "gui-filter.h"
 #include "gui-hotlist.h"
 #include "gui-nicklist.h"
+#include "gui-search-index.h"
 #include "gui-window.h"
 
 
+struct t_hashtable *gui_line_tags_index = NULL; /* tags by name (pointer to */
+                                                /* shared string)           */
+struct t_gui_line_tag **gui_line_tags = NULL;   /* tags by id               */
+int gui_line_tags_size = 0;            /* size of array gui_line_tags       */
+int gui_line_tags_ids_count = 0;       /* number of ids used in array       */
+int *gui_line_tags_ids_pending = NULL; /* ids released (not yet reusable)   */
+int gui_line_tags_ids_pending_count = 0;
+int gui_line_tags_ids_pending_size = 0;
+int *gui_line_tags_ids_free = NULL;    /* ids released, that can be reused  */
+int gui_line_tags_ids_free_count = 0;
+int gui_line_tags_ids_free_size = 0;
+int gui_line_tags_generation = 0;      /* incremented when ids are recycled */
+
+
 /*
  * Allocates structure "t_gui_lines" and initializes it.
  *
@@ -71,6 +86,11 @@ gui_lines_alloc ()
         new_lines->buffer_max_length_refresh = 0;
         new_lines->prefix_max_length = CONFIG_INTEGER(config_look_prefix_align_min);
         new_lines->prefix_max_length_refresh = 0;
+        new_lines->chunks = NULL;
+        new_lines->last_chunk = NULL;
+        new_lines->chunks_count = 0;
+        new_lines->filters_mask = NULL;
+        new_lines->filters_mask_size = 0;
     }
 
     return new_lines;
@@ -83,28 +103,504 @@ gui_lines_alloc ()
 void
 gui_lines_free (struct t_gui_lines *lines)
 {
+    struct t_gui_line_chunk *ptr_next_chunk;
+
     if (!lines)
         return;
 
+    /* free remaining chunks (normally all lines are already freed) */
+    while (lines->chunks)
+    {
+        ptr_next_chunk = lines->chunks->next_chunk;
+        free (lines->chunks);
+        lines->chunks = ptr_next_chunk;
+    }
+
+    if (lines->filters_mask)
+        free (lines->filters_mask);
+
     free (lines);
 }
 
 /*
- * Allocates array with tags in a line_data.
+ * Allocates a new chunk for lines, with "size" bytes of data.
+ *
+ * Returns pointer to new chunk, NULL if error.
+ */
+
+struct t_gui_line_chunk *
+gui_line_chunk_new (struct t_gui_lines *lines, int size)
+{
+    struct t_gui_line_chunk *new_chunk;
+
+    new_chunk = malloc (GUI_LINE_CHUNK_ALIGN(sizeof (*new_chunk)) + size);
+    if (!new_chunk)
+        return NULL;
+
+    new_chunk->lines = lines;
+    new_chunk->data = (char *)new_chunk +
+        GUI_LINE_CHUNK_ALIGN(sizeof (*new_chunk));
+    new_chunk->size = size;
+    new_chunk->used = 0;
+    new_chunk->lines_count = 0;
+
+    new_chunk->prev_chunk = lines->last_chunk;
+    new_chunk->next_chunk = NULL;
+    if (lines->last_chunk)
+        (lines->last_chunk)->next_chunk = new_chunk;
+    else
+        lines->chunks = new_chunk;
+    lines->last_chunk = new_chunk;
+    lines->chunks_count++;
+
+    return new_chunk;
+}
+
+/*
+ * Allocates "size" bytes for a line in last chunk of lines (a new chunk is
+ * created if there is not enough space in last chunk).
+ *
+ * Argument "chunk" is set with the chunk used.
+ *
+ * Returns pointer to memory allocated, NULL if error.
+ */
+
+void *
+gui_line_chunk_alloc (struct t_gui_lines *lines, int size,
+                      struct t_gui_line_chunk **chunk)
+{
+    struct t_gui_line_chunk *ptr_chunk;
+    int chunk_size;
+    void *pointer;
+
+    size = GUI_LINE_CHUNK_ALIGN(size);
+
+    ptr_chunk = lines->last_chunk;
+    if (!ptr_chunk || (ptr_chunk->used + size > ptr_chunk->size))
+    {
+        /* the size of chunks is doubled until the max size */
+        chunk_size = (ptr_chunk) ?
+            ptr_chunk->size * 2 : GUI_LINE_CHUNK_MIN_SIZE;
+        if (chunk_size > GUI_LINE_CHUNK_MAX_SIZE)
+            chunk_size = GUI_LINE_CHUNK_MAX_SIZE;
+        if (size > chunk_size)
+            chunk_size = size;
+        ptr_chunk = gui_line_chunk_new (lines, chunk_size);
+        if (!ptr_chunk)
+            return NULL;
+    }
+
+    pointer = ptr_chunk->data + ptr_chunk->used;
+    ptr_chunk->used += size;
+    ptr_chunk->lines_count++;
+
+    *chunk = ptr_chunk;
+
+    return pointer;
+}
+
+/*
+ * Releases a line in a chunk: the chunk is freed if there is no more line
+ * in it.
  */
 
 void
-gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
+gui_line_chunk_release (struct t_gui_line_chunk *chunk)
 {
-    if (tags)
+    struct t_gui_lines *lines;
+
+    chunk->lines_count--;
+    if (chunk->lines_count > 0)
+        return;
+
+    lines = chunk->lines;
+
+    /* remove chunk from list */
+    if (chunk->prev_chunk)
+        (chunk->prev_chunk)->next_chunk = chunk->next_chunk;
+    if (chunk->next_chunk)
+        (chunk->next_chunk)->prev_chunk = chunk->prev_chunk;
+    if (lines->chunks == chunk)
+        lines->chunks = chunk->next_chunk;
+    if (lines->last_chunk == chunk)
+        lines->last_chunk = chunk->prev_chunk;
+    lines->chunks_count--;
+
+    free (chunk);
+}
+
+/*
+ * Checks if a pointer is in data of a chunk.
+ *
+ * Returns:
+ *   1: pointer is in chunk
+ *   0: pointer is not in chunk (or chunk is NULL)
+ */
+
+int
+gui_line_chunk_contains (struct t_gui_line_chunk *chunk, const void *pointer)
+{
+    return (chunk
+            && ((const char *)pointer >= chunk->data)
+            && ((const char *)pointer < chunk->data + chunk->size)) ? 1 : 0;
+}
+
+/*
+ * Frees a string of a line data (time or message): the string is not freed
+ * if it is stored in the chunk of line.
+ */
+
+void
+gui_line_free_string (struct t_gui_line_data *line_data, char *string)
+{
+    if (string && !gui_line_chunk_contains (line_data->chunk, string))
+        free (string);
+}
+
+/*
+ * Returns a new id for a tag: a released id is reused if possible (only
+ * if at least GUI_LINE_TAGS_RECYCLE_MIN ids have been released, and then
+ * the generation of ids is incremented, so that caches of masks are reset),
+ * otherwise a new id is used.
+ *
+ * Returns id, -1 if error.
+ */
+
+int
+gui_line_tag_new_id ()
+{
+    struct t_gui_line_tag **new_tags;
+    int *ptr_ids, ptr_size, i, new_size;
+
+    if ((gui_line_tags_ids_free_count == 0)
+        && (gui_line_tags_ids_pending_count >= GUI_LINE_TAGS_RECYCLE_MIN))
     {
-        line_data->tags_array = string_split_shared (tags, ",", 0, 0,
-                                                     &line_data->tags_count);
+        /* pending ids become reusable */
+        ptr_ids = gui_line_tags_ids_free;
+        ptr_size = gui_line_tags_ids_free_size;
+        gui_line_tags_ids_free = gui_line_tags_ids_pending;
+        gui_line_tags_ids_free_size = gui_line_tags_ids_pending_size;
+        gui_line_tags_ids_free_count = gui_line_tags_ids_pending_count;
+        gui_line_tags_ids_pending = ptr_ids;
+        gui_line_tags_ids_pending_size = ptr_size;
+        gui_line_tags_ids_pending_count = 0;
+        gui_line_tags_generation++;
     }
-    else
+
+    if (gui_line_tags_ids_free_count > 0)
     {
-        line_data->tags_count = 0;
-        line_data->tags_array = NULL;
+        gui_line_tags_ids_free_count--;
+        return gui_line_tags_ids_free[gui_line_tags_ids_free_count];
+    }
+
+    if (gui_line_tags_ids_count >= gui_line_tags_size)
+    {
+        new_size = (gui_line_tags_size > 0) ? gui_line_tags_size * 2 : 256;
+        new_tags = realloc (gui_line_tags, new_size * sizeof (*new_tags));
+        if (!new_tags)
+            return -1;
+        for (i = gui_line_tags_size; i < new_size; i++)
+        {
+            new_tags[i] = NULL;
+        }
+        gui_line_tags = new_tags;
+        gui_line_tags_size = new_size;
+    }
+
+    gui_line_tags_ids_count++;
+
+    return gui_line_tags_ids_count - 1;
+}
+
+/*
+ * Gets id of a tag (tag is created if not found, otherwise its number of
+ * references is incremented).
+ *
+ * The tag must be a shared string (tags of lines are shared strings).
+ *
+ * Returns id of tag, -1 if error.
+ */
+
+int
+gui_line_tag_get_id (const char *tag)
+{
+    struct t_gui_line_tag *ptr_tag;
+    int id;
+
+    if (!tag)
+        return -1;
+
+    if (!gui_line_tags_index)
+    {
+        gui_line_tags_index = hashtable_new (256,
+                                             WEECHAT_HASHTABLE_POINTER,
+                                             WEECHAT_HASHTABLE_POINTER,
+                                             NULL, NULL);
+        if (!gui_line_tags_index)
+            return -1;
+    }
+
+    ptr_tag = hashtable_get (gui_line_tags_index, tag);
+    if (ptr_tag)
+    {
+        ptr_tag->refcount++;
+        return ptr_tag->id;
+    }
+
+    ptr_tag = malloc (sizeof (*ptr_tag));
+    if (!ptr_tag)
+        return -1;
+
+    id = gui_line_tag_new_id ();
+    if (id < 0)
+    {
+        free (ptr_tag);
+        return -1;
+    }
+
+    ptr_tag->name = string_shared_get (tag);
+    ptr_tag->id = id;
+    ptr_tag->refcount = 1;
+    gui_line_tags[id] = ptr_tag;
+    hashtable_set (gui_line_tags_index, ptr_tag->name, ptr_tag);
+
+    return id;
+}
+
+/*
+ * Releases a reference on a tag id: the tag is freed if it is not used any
+ * more, and its id will be reused later.
+ */
+
+void
+gui_line_tag_release_id (int id)
+{
+    struct t_gui_line_tag *ptr_tag;
+    int *new_ids, new_size;
+
+    if ((id < 0) || (id >= gui_line_tags_ids_count) || !gui_line_tags[id])
+        return;
+
+    ptr_tag = gui_line_tags[id];
+    ptr_tag->refcount--;
+    if (ptr_tag->refcount > 0)
+        return;
+
+    hashtable_remove (gui_line_tags_index, ptr_tag->name);
+    string_shared_free (ptr_tag->name);
+    free (ptr_tag);
+    gui_line_tags[id] = NULL;
+
+    if (gui_line_tags_ids_pending_count >= gui_line_tags_ids_pending_size)
+    {
+        new_size = (gui_line_tags_ids_pending_size > 0) ?
+            gui_line_tags_ids_pending_size * 2 : GUI_LINE_TAGS_RECYCLE_MIN;
+        new_ids = realloc (gui_line_tags_ids_pending,
+                           new_size * sizeof (*new_ids));
+        if (!new_ids)
+            return;
+        gui_line_tags_ids_pending = new_ids;
+        gui_line_tags_ids_pending_size = new_size;
+    }
+    gui_line_tags_ids_pending[gui_line_tags_ids_pending_count] = id;
+    gui_line_tags_ids_pending_count++;
+}
+
+/*
+ * Compiles tags (array of groups of tags, like in filters or hooks) for a
+ * fast match with tags of lines.
+ *
+ * Each tag is a mask; the result of match between a mask and a tag of line
+ * is cached in a bitset, by tag id.
+ *
+ * Note: result must be freed after use with function
+ * gui_line_tags_match_free.
+ */
+
+struct t_gui_line_tags_match *
+gui_line_tags_match_new (int tags_count, char ***tags_array)
+{
+    struct t_gui_line_tags_match *new_tags_match;
+    int i, j, masks_count, index;
+
+    if ((tags_count <= 0) || !tags_array)
+        return NULL;
+
+    masks_count = 0;
+    for (i = 0; i < tags_count; i++)
+    {
+        for (j = 0; tags_array[i] && tags_array[i][j]; j++)
+        {
+            masks_count++;
+        }
+    }
+
+    new_tags_match = malloc (sizeof (*new_tags_match));
+    if (!new_tags_match)
+        return NULL;
+
+    new_tags_match->groups_count = tags_count;
+    new_tags_match->groups = malloc ((tags_count + 1) *
+                                     sizeof (*new_tags_match->groups));
+    new_tags_match->masks_count = masks_count;
+    new_tags_match->masks = calloc ((masks_count > 0) ? masks_count : 1,
+                                    sizeof (*new_tags_match->masks));
+    if (!new_tags_match->groups || !new_tags_match->masks)
+    {
+        gui_line_tags_match_free (new_tags_match);
+        return NULL;
+    }
+
+    index = 0;
+    for (i = 0; i < tags_count; i++)
+    {
+        new_tags_match->groups[i] = index;
+        for (j = 0; tags_array[i] && tags_array[i][j]; j++)
+        {
+            /* check if tag is negated (prefixed with a '!') */
+            if ((tags_array[i][j][0] == '!') && tags_array[i][j][1])
+            {
+                new_tags_match->masks[index].negated = 1;
+                new_tags_match->masks[index].mask = strdup (tags_array[i][j] + 1);
+            }
+            else
+            {
+                new_tags_match->masks[index].negated = 0;
+                new_tags_match->masks[index].mask = strdup (tags_array[i][j]);
+            }
+            new_tags_match->masks[index].generation = gui_line_tags_generation;
+            index++;
+        }
+    }
+    new_tags_match->groups[tags_count] = index;
+
+    return new_tags_match;
+}
+
+/*
+ * Frees compiled tags.
+ */
+
+void
+gui_line_tags_match_free (struct t_gui_line_tags_match *tags_match)
+{
+    int i;
+
+    if (!tags_match)
+        return;
+
+    if (tags_match->masks)
+    {
+        for (i = 0; i < tags_match->masks_count; i++)
+        {
+            if (tags_match->masks[i].mask)
+                free (tags_match->masks[i].mask);
+            if (tags_match->masks[i].cache)
+                free (tags_match->masks[i].cache);
+        }
+        free (tags_match->masks);
+    }
+    if (tags_match->groups)
+        free (tags_match->groups);
+
+    free (tags_match);
+}
+
+/*
+ * Checks if a tag of line (with its id) matches a mask: the result is read
+ * from the cache of mask if the tag was already checked, otherwise the tag
+ * is compared with the mask and the result is stored in cache.
+ *
+ * Returns:
+ *   1: tag matches mask
+ *   0: tag does not match mask
+ */
+
+int
+gui_line_tag_mask_match (struct t_gui_line_tag_mask *tag_mask, int tag_id,
+                         const char *tag)
+{
+    unsigned char *new_cache;
+    int new_size, shift, bits, match;
+
+    if (!tag_mask->mask)
+        return 0;
+
+    if (tag_id < 0)
+        return string_match (tag, tag_mask->mask, 0);
+
+    /* ids have been recycled: reset cache */
+    if (tag_mask->generation != gui_line_tags_generation)
+    {
+        if (tag_mask->cache)
+            memset (tag_mask->cache, 0, tag_mask->cache_size / 4);
+        tag_mask->generation = gui_line_tags_generation;
+    }
+
+    if (tag_id >= tag_mask->cache_size)
+    {
+        new_size = (tag_mask->cache_size > 0) ? tag_mask->cache_size : 256;
+        while (new_size <= tag_id)
+        {
+            new_size *= 2;
+        }
+        new_cache = realloc (tag_mask->cache, new_size / 4);
+        if (!new_cache)
+            return string_match (tag, tag_mask->mask, 0);
+        memset (new_cache + (tag_mask->cache_size / 4), 0,
+                (new_size - tag_mask->cache_size) / 4);
+        tag_mask->cache = new_cache;
+        tag_mask->cache_size = new_size;
+    }
+
+    shift = (tag_id & 3) * 2;
+    bits = (tag_mask->cache[tag_id / 4] >> shift) & 3;
+    if (bits & 1)
+        return bits >> 1;
+
+    match = (string_match (tag, tag_mask->mask, 0)) ? 1 : 0;
+    tag_mask->cache[tag_id / 4] |= (1 | (match << 1)) << shift;
+
+    return match;
+}
+
+/*
+ * Gets ids of tags in a line_data.
+ */
+
+void
+gui_line_tags_get_ids (struct t_gui_line_data *line_data)
+{
+    int i;
+
+    for (i = 0; i < line_data->tags_count; i++)
+    {
+        line_data->tags_id[i] = gui_line_tag_get_id (line_data->tags_array[i]);
+    }
+}
+
+/*
+ * Allocates array with tags in a line_data.
+ */
+
+void
+gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
+{
+    line_data->tags_count = 0;
+    line_data->tags_array = NULL;
+    line_data->tags_id = NULL;
+
+    if (!tags)
+        return;
+
+    line_data->tags_array = string_split_shared (tags, ",", 0, 0,
+                                                 &line_data->tags_count);
+    if (line_data->tags_array && (line_data->tags_count > 0))
+    {
+        line_data->tags_id = malloc (line_data->tags_count *
+                                     sizeof (*line_data->tags_id));
+        if (line_data->tags_id)
+            gui_line_tags_get_ids (line_data);
     }
 }
 
@@ -115,12 +611,36 @@ gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
 void
 gui_line_tags_free (struct t_gui_line_data *line_data)
 {
+    int i;
+
     if (!line_data)
         return;
 
+    if (line_data->tags_id)
+    {
+        for (i = 0; i < line_data->tags_count; i++)
+        {
+            gui_line_tag_release_id (line_data->tags_id[i]);
+        }
+        if (!gui_line_chunk_contains (line_data->chunk, line_data->tags_id))
+            free (line_data->tags_id);
+        line_data->tags_id = NULL;
+    }
+
     if (line_data->tags_array)
     {
-        string_free_split_shared (line_data->tags_array);
+        if (gui_line_chunk_contains (line_data->chunk, line_data->tags_array))
+        {
+            /* array is in chunk: just free the shared strings */
+            for (i = 0; i < line_data->tags_count; i++)
+            {
+                string_shared_free (line_data->tags_array[i]);
+            }
+        }
+        else
+        {
+            string_free_split_shared (line_data->tags_array);
+        }
         line_data->tags_count = 0;
         line_data->tags_array = NULL;
     }
@@ -429,9 +949,37 @@ gui_line_get_next_displayed (struct t_gui_line *line)
     return line;
 }
 
+/*
+ * Searches for text in a string (prefix or message of a line, without
+ * colors).
+ *
+ * Returns:
+ *   1: text found in string
+ *   0: text not found in string
+ */
+
+int
+gui_line_search_text_string (struct t_gui_buffer *buffer, const char *string)
+{
+    if (buffer->text_search_regex)
+    {
+        return (buffer->text_search_regex_compiled
+                && (regexec (buffer->text_search_regex_compiled,
+                             string, 0, NULL, 0) == 0)) ? 1 : 0;
+    }
+
+    if (buffer->text_search_exact)
+        return (strstr (string, buffer->input_buffer)) ? 1 : 0;
+
+    return (string_strcasestr (string, buffer->input_buffer)) ? 1 : 0;
+}
+
 /*
  * Searches for text in a line.
  *
+ * If the line is in a search index, the prefix and message without colors
+ * stored in index are used.
+ *
  * Returns:
  *   1: text found in line
  *   0: text not found in line
@@ -440,6 +988,7 @@ gui_line_get_next_displayed (struct t_gui_line *line)
 int
 gui_line_search_text (struct t_gui_buffer *buffer, struct t_gui_line *line)
 {
+    struct t_gui_search_index_line *ptr_index_line;
     char *prefix, *message;
     int rc;
 
@@ -451,58 +1000,44 @@ gui_line_search_text (struct t_gui_buffer *buffer, struct t_gui_line *line)
 
     rc = 0;
 
+    ptr_index_line = gui_search_index_get_line (line->data);
+
     if ((buffer->text_search_where & GUI_TEXT_SEARCH_IN_PREFIX)
         && line->data->prefix)
     {
-        prefix = gui_color_decode (line->data->prefix, NULL);
-        if (prefix)
+        if (ptr_index_line)
         {
-            if (buffer->text_search_regex)
-            {
-                if (buffer->text_search_regex_compiled)
-                {
-                    if (regexec (buffer->text_search_regex_compiled,
-                                 prefix, 0, NULL, 0) == 0)
-                    {
-                        rc = 1;
-                    }
-                }
-            }
-            else if ((buffer->text_search_exact
-                      && (strstr (prefix, buffer->input_buffer)))
-                     || (!buffer->text_search_exact
-                         && (string_strcasestr (prefix, buffer->input_buffer))))
+            if (ptr_index_line->prefix)
+                rc = gui_line_search_text_string (buffer,
+                                                  ptr_index_line->prefix);
+        }
+        else
+        {
+            prefix = gui_color_decode (line->data->prefix, NULL);
+            if (prefix)
             {
-                rc = 1;
+                rc = gui_line_search_text_string (buffer, prefix);
+                free (prefix);
             }
-            free (prefix);
         }
     }
 
     if (!rc && (buffer->text_search_where & GUI_TEXT_SEARCH_IN_MESSAGE))
     {
-        message = gui_color_decode (line->data->message, NULL);
-        if (message)
+        if (ptr_index_line)
         {
-            if (buffer->text_search_regex)
-            {
-                if (buffer->text_search_regex_compiled)
-                {
-                    if (regexec (buffer->text_search_regex_compiled,
-                                 message, 0, NULL, 0) == 0)
-                    {
-                        rc = 1;
-                    }
-                }
-            }
-            else if ((buffer->text_search_exact
-                      && (strstr (message, buffer->input_buffer)))
-                     || (!buffer->text_search_exact
-                         && (string_strcasestr (message, buffer->input_buffer))))
+            if (ptr_index_line->message)
+                rc = gui_line_search_text_string (buffer,
+                                                  ptr_index_line->message);
+        }
+        else
+        {
+            message = gui_color_decode (line->data->message, NULL);
+            if (message)
             {
-                rc = 1;
+                rc = gui_line_search_text_string (buffer, message);
+                free (message);
             }
-            free (message);
         }
     }
 
@@ -601,39 +1136,37 @@ gui_line_has_tag_no_filter (struct t_gui_line_data *line_data)
 
 int
 gui_line_match_tags (struct t_gui_line_data *line_data,
-                     int tags_count, char ***tags_array)
+                     struct t_gui_line_tags_match *tags_match)
 {
-    int i, j, k, match, tag_found, tag_negated;
+    struct t_gui_line_tag_mask *ptr_mask;
+    int i, j, k, match, tag_found;
 
-    if (!line_data)
+    if (!line_data || !tags_match)
         return 0;
 
     if (line_data->tags_count == 0)
         return 0;
 
-    for (i = 0; i < tags_count; i++)
+    for (i = 0; i < tags_match->groups_count; i++)
     {
         match = 1;
-        for (j = 0; tags_array[i][j]; j++)
+        for (j = tags_match->groups[i]; j < tags_match->groups[i + 1]; j++)
         {
+            ptr_mask = &tags_match->masks[j];
             tag_found = 0;
-            tag_negated = 0;
-
-            /* check if tag is negated (prefixed with a '!') */
-            if ((tags_array[i][j][0] == '!') && tags_array[i][j][1])
-                tag_negated = 1;
-
             for (k = 0; k < line_data->tags_count; k++)
             {
-                if (string_match (line_data->tags_array[k],
-                                  (tag_negated) ? tags_array[i][j] + 1 : tags_array[i][j],
-                                  0))
+                if (gui_line_tag_mask_match (
+                        ptr_mask,
+                        (line_data->tags_id) ? line_data->tags_id[k] : -1,
+                        line_data->tags_array[k]))
                 {
                     tag_found = 1;
                     break;
                 }
             }
-            if ((!tag_found && !tag_negated) || (tag_found && tag_negated))
+            if ((!tag_found && !ptr_mask->negated)
+                || (tag_found && ptr_mask->negated))
             {
                 match = 0;
                 break;
@@ -741,10 +1274,8 @@ gui_line_has_highlight (struct t_gui_line *line)
      * check if highlight is forced by a tag
      * (with global option "weechat.look.highlight_tags")
      */
-    if (config_highlight_tags
-        && gui_line_match_tags (line->data,
-                                config_num_highlight_tags,
-                                config_highlight_tags))
+    if (config_highlight_tags_match
+        && gui_line_match_tags (line->data, config_highlight_tags_match))
     {
         return 1;
     }
@@ -755,8 +1286,7 @@ gui_line_has_highlight (struct t_gui_line *line)
      */
     if (line->data->buffer->highlight_tags
         && gui_line_match_tags (line->data,
-                                line->data->buffer->highlight_tags_count,
-                                line->data->buffer->highlight_tags_array))
+                                line->data->buffer->highlight_tags_match))
     {
         return 1;
     }
@@ -768,8 +1298,7 @@ gui_line_has_highlight (struct t_gui_line *line)
     if (line->data->buffer->highlight_tags_restrict_count > 0)
     {
         if (!gui_line_match_tags (line->data,
-                                  line->data->buffer->highlight_tags_restrict_count,
-                                  line->data->buffer->highlight_tags_restrict_array))
+                                  line->data->buffer->highlight_tags_restrict_match))
             return 0;
     }
 
@@ -972,6 +1501,7 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
 {
     struct t_gui_window *ptr_win;
     struct t_gui_window_scroll *ptr_scroll;
+    struct t_gui_line_chunk *ptr_chunk;
     int prefix_length, prefix_is_nick;
 
     for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
@@ -1002,6 +1532,13 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
         }
         /* remove line from coords */
         gui_window_coords_remove_line (ptr_win, line);
+        /*
+         * remove line from layout of lines, and next line (its prefix can
+         * depend on this line, with option weechat.look.prefix_same_nick)
+         */
+        gui_window_lines_layout_remove (ptr_win, line->data);
+        if (line->next_line)
+            gui_window_lines_layout_remove (ptr_win, line->next_line->data);
     }
 
     gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
@@ -1023,19 +1560,6 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
     if (!line->data->displayed && (lines->lines_hidden > 0))
         (lines->lines_hidden)--;
 
-    /* free data */
-    if (free_data)
-    {
-        if (line->data->str_time)
-            free (line->data->str_time);
-        gui_line_tags_free (line->data);
-        if (line->data->prefix)
-            string_shared_free (line->data->prefix);
-        if (line->data->message)
-            free (line->data->message);
-        free (line->data);
-    }
-
     /* remove line from list */
     if (line->prev_line)
         (line->prev_line)->next_line = line->next_line;
@@ -1048,6 +1572,28 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
 
     lines->lines_count--;
 
+    /* free data */
+    if (free_data)
+    {
+        gui_line_free_string (line->data, line->data->str_time);
+        gui_line_tags_free (line->data);
+        if (line->data->filters_match)
+            free (line->data->filters_match);
+        if (line->data->prefix)
+            string_shared_free (line->data->prefix);
+        gui_line_free_string (line->data, line->data->message);
+        ptr_chunk = line->data->chunk;
+        if (ptr_chunk)
+        {
+            /* line and line data are stored in chunk */
+            if (!gui_line_chunk_contains (ptr_chunk, line))
+                free (line);
+            gui_line_chunk_release (ptr_chunk);
+            return;
+        }
+        free (line->data);
+    }
+
     free (line);
 }
 
@@ -1146,6 +1692,9 @@ gui_line_free (struct t_gui_buffer *buffer, struct t_gui_line *line)
         }
     }
 
+    /* remove line from search index */
+    gui_search_index_remove_line (buffer, line);
+
     /* remove line from lines list */
     gui_line_remove_from_list (buffer, buffer->own_lines, line, 1);
 }
@@ -1157,6 +1706,8 @@ gui_line_free (struct t_gui_buffer *buffer, struct t_gui_line *line)
 void
 gui_line_free_all (struct t_gui_buffer *buffer)
 {
+    gui_search_index_free (buffer);
+
     while (buffer->own_lines->first_line)
     {
         gui_line_free (buffer, buffer->own_lines->first_line);
@@ -1189,6 +1740,73 @@ gui_line_get_notify_level (struct t_gui_line *line)
     return GUI_HOTLIST_LOW;
 }
 
+/*
+ * Adds buffer to hotlist for a new line.
+ *
+ * If lines are added in batch in buffer, the hotlist is not updated: the
+ * message is counted and hotlist is updated at the end of batch.
+ */
+
+void
+gui_line_hotlist_add (struct t_gui_buffer *buffer,
+                      enum t_gui_hotlist_priority priority)
+{
+    if (buffer->lines_batch && buffer->lines_batch_hotlist)
+    {
+        if (priority > GUI_HOTLIST_MAX)
+            priority = GUI_HOTLIST_MAX;
+        buffer->lines_batch_hotlist[priority]++;
+    }
+    else
+    {
+        (void) gui_hotlist_add (buffer, priority, NULL);
+    }
+}
+
+/*
+ * Ends a batch of lines added in a buffer: hotlist is updated once for each
+ * priority with the number of messages added during the batch, chat is
+ * refreshed and signal "buffer_lines_hidden" is sent if some lines added were
+ * filtered.
+ */
+
+void
+gui_line_batch_end (struct t_gui_buffer *buffer)
+{
+    int i, refresh, hidden;
+
+    if (!buffer)
+        return;
+
+    if (buffer->lines_batch_hotlist)
+    {
+        for (i = 0; i < GUI_HOTLIST_NUM_PRIORITIES; i++)
+        {
+            if (buffer->lines_batch_hotlist[i] > 0)
+            {
+                (void) gui_hotlist_add_count (buffer, i, NULL,
+                                              buffer->lines_batch_hotlist[i]);
+            }
+        }
+        free (buffer->lines_batch_hotlist);
+        buffer->lines_batch_hotlist = NULL;
+    }
+
+    refresh = buffer->lines_batch_refresh;
+    hidden = buffer->lines_batch_hidden;
+    buffer->lines_batch_refresh = 0;
+    buffer->lines_batch_hidden = 0;
+
+    if (refresh > 0)
+        gui_buffer_ask_chat_refresh (buffer, refresh);
+
+    if (hidden)
+    {
+        (void) hook_signal_send ("buffer_lines_hidden",
+                                 WEECHAT_HOOK_SIGNAL_POINTER, buffer);
+    }
+}
+
 /*
  * Adds a new line for a buffer.
  */
@@ -1200,10 +1818,13 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
 {
     struct t_gui_line *new_line;
     struct t_gui_line_data *new_line_data;
+    struct t_gui_line_chunk *ptr_chunk;
     struct t_gui_window *ptr_win;
-    char *message_for_signal;
+    char *message_for_signal, *str_time, **tags_array, *ptr_data;
     const char *nick;
-    int notify_level, *max_notify_level, lines_removed;
+    int notify_level, *max_notify_level, lines_removed, tags_count;
+    int size_line, size_line_data, size_tags, size_tags_id, length_time;
+    int length_message;
     time_t current_time;
 
     /*
@@ -1225,22 +1846,44 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
         lines_removed++;
     }
 
-    /* create new line */
-    new_line = malloc (sizeof (*new_line));
-    if (!new_line)
-    {
-        log_printf (_("Not enough memory for new line"));
-        return NULL;
-    }
+    /* build time and tags (tags are shared strings) */
+    str_time = gui_chat_get_time_string (date);
+    tags_count = 0;
+    tags_array = (tags) ?
+        string_split_shared (tags, ",", 0, 0, &tags_count) : NULL;
+    if (!message)
+        message = "";
 
-    /* create data for line */
-    new_line_data = malloc (sizeof (*new_line_data));
-    if (!new_line_data)
-    {
-        free (new_line);
+    /*
+     * create new line in a chunk, with: line, line data, array of tags,
+     * time and message
+     */
+    size_line = GUI_LINE_CHUNK_ALIGN(sizeof (*new_line));
+    size_line_data = GUI_LINE_CHUNK_ALIGN(sizeof (*new_line_data));
+    size_tags = (tags_array) ?
+        GUI_LINE_CHUNK_ALIGN((tags_count + 1) * sizeof (*tags_array)) : 0;
+    size_tags_id = (tags_array) ?
+        GUI_LINE_CHUNK_ALIGN(tags_count * sizeof (int)) : 0;
+    length_time = (str_time) ? strlen (str_time) + 1 : 0;
+    length_message = strlen (message) + 1;
+    ptr_data = gui_line_chunk_alloc (
+        buffer->own_lines,
+        size_line + size_line_data + size_tags + size_tags_id + length_time +
+        length_message,
+        &ptr_chunk);
+    if (!ptr_data)
+    {
+        if (str_time)
+            free (str_time);
+        if (tags_array)
+            string_free_split_shared (tags_array);
         log_printf (_("Not enough memory for new line"));
         return NULL;
     }
+    new_line = (struct t_gui_line *)ptr_data;
+    ptr_data += size_line;
+    new_line_data = (struct t_gui_line_data *)ptr_data;
+    ptr_data += size_line_data;
     new_line->data = new_line_data;
 
     /* fill data in new line */
@@ -1248,14 +1891,39 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
     new_line->data->y = -1;
     new_line->data->date = date;
     new_line->data->date_printed = date_printed;
-    new_line->data->str_time = gui_chat_get_time_string (date);
-    gui_line_tags_alloc (new_line->data, tags);
+    new_line->data->chunk = ptr_chunk;
+    new_line->data->tags_count = tags_count;
+    new_line->data->tags_array = NULL;
+    new_line->data->tags_id = NULL;
+    new_line->data->filters_match = NULL;
+    new_line->data->filters_match_size = 0;
+    if (tags_array)
+    {
+        /* move pointers to shared strings in chunk */
+        new_line->data->tags_array = (char **)ptr_data;
+        memcpy (new_line->data->tags_array, tags_array,
+                (tags_count + 1) * sizeof (*tags_array));
+        free (tags_array);
+        ptr_data += size_tags;
+        new_line->data->tags_id = (int *)ptr_data;
+        gui_line_tags_get_ids (new_line->data);
+        ptr_data += size_tags_id;
+    }
+    new_line->data->str_time = NULL;
+    if (str_time)
+    {
+        new_line->data->str_time = ptr_data;
+        memcpy (new_line->data->str_time, str_time, length_time);
+        free (str_time);
+        ptr_data += length_time;
+    }
     new_line->data->refresh_needed = 0;
     new_line->data->prefix = (prefix) ?
         (char *)string_shared_get (prefix) : ((date != 0) ? (char *)string_shared_get ("") : NULL);
     new_line->data->prefix_length = (prefix) ?
         gui_chat_strlen_screen (prefix) : 0;
-    new_line->data->message = (message) ? strdup (message) : strdup ("");
+    new_line->data->message = ptr_data;
+    memcpy (new_line->data->message, message, length_message);
 
     /* get notify level and max notify level for nick in buffer */
     notify_level = gui_line_get_notify_level (new_line);
@@ -1280,12 +1948,15 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
     /* add line to lines list */
     gui_line_add_to_list (buffer->own_lines, new_line);
 
+    /* add line to search index */
+    gui_search_index_add_line (buffer, new_line);
+
     /* update hotlist and/or send signals for line */
     if (new_line->data->displayed)
     {
         if (new_line->data->highlight)
         {
-            (void) gui_hotlist_add (buffer, GUI_HOTLIST_HIGHLIGHT, NULL);
+            gui_line_hotlist_add (buffer, GUI_HOTLIST_HIGHLIGHT);
             if (!weechat_upgrading)
             {
                 message_for_signal = gui_chat_build_string_prefix_message (new_line);
@@ -1312,9 +1983,13 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
                 }
             }
             if (notify_level >= GUI_HOTLIST_MIN)
-                (void) gui_hotlist_add (buffer, notify_level, NULL);
+                gui_line_hotlist_add (buffer, notify_level);
         }
     }
+    else if (buffer->lines_batch)
+    {
+        buffer->lines_batch_hidden = 1;
+    }
     else
     {
         (void) hook_signal_send ("buffer_lines_hidden",
@@ -1398,11 +2073,15 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
         new_line->data->str_time = NULL;
         new_line->data->tags_count = 0;
         new_line->data->tags_array = NULL;
+        new_line->data->tags_id = NULL;
+        new_line->data->filters_match = NULL;
+        new_line->data->filters_match_size = 0;
         new_line->data->refresh_needed = 1;
         new_line->data->prefix = NULL;
         new_line->data->prefix_length = 0;
         new_line->data->message = NULL;
         new_line->data->highlight = 0;
+        new_line->data->chunk = NULL;
 
         /* add line to lines list */
         if (ptr_line)
@@ -1468,8 +2147,7 @@ gui_line_clear (struct t_gui_line *line)
         string_shared_free (line->data->prefix);
     line->data->prefix = (char *)string_shared_get ("");
 
-    if (line->data->message)
-        free (line->data->message);
+    gui_line_free_string (line->data, line->data->message);
     line->data->message = strdup ("");
 }
 
@@ -1651,8 +2329,7 @@ gui_line_hdata_line_data_update_cb (void *data,
         if (value)
         {
             hdata_set (hdata, pointer, "date", value);
-            if (line_data->str_time)
-                free (line_data->str_time);
+            gui_line_free_string (line_data, line_data->str_time);
             line_data->str_time = gui_chat_get_time_string (line_data->date);
             rc++;
             update_coords = 1;
@@ -1684,6 +2361,8 @@ gui_line_hdata_line_data_update_cb (void *data,
         line_data->prefix_length = (line_data->prefix) ?
             gui_chat_strlen_screen (line_data->prefix) : 0;
         line_data->buffer->lines->prefix_max_length_refresh = 1;
+        /* search index is built again on next search */
+        gui_search_index_free (line_data->buffer);
         rc++;
         update_coords = 1;
     }
@@ -1691,7 +2370,11 @@ gui_line_hdata_line_data_update_cb (void *data,
     if (hashtable_has_key (hashtable, "message"))
     {
         value = hashtable_get (hashtable, "message");
-        hdata_set (hdata, pointer, "message", value);
+        /* message may be in chunk of line: it can not be set with hdata_set */
+        gui_line_free_string (line_data, line_data->message);
+        line_data->message = (value) ? strdup (value) : NULL;
+        /* search index is built again on next search */
+        gui_search_index_free (line_data->buffer);
         rc++;
         update_coords = 1;
     }
@@ -1705,6 +2388,8 @@ gui_line_hdata_line_data_update_cb (void *data,
                 gui_window_coords_remove_line_data (ptr_win, line_data);
             }
         }
+        /* this line and next ones may have a different layout */
+        gui_window_lines_layout_invalidate ();
         gui_filter_buffer (line_data->buffer, line_data);
         gui_buffer_ask_chat_refresh (line_data->buffer, 1);
     }
@@ -1843,5 +2528,56 @@ gui_lines_print_log (struct t_gui_lines *lines)
         log_printf ("    buffer_max_length_refresh: %d",    lines->buffer_max_length_refresh);
         log_printf ("    prefix_max_length. . . . : %d",    lines->prefix_max_length);
         log_printf ("    prefix_max_length_refresh: %d",    lines->prefix_max_length_refresh);
+        log_printf ("    chunks . . . . . . . . . : 0x%lx", lines->chunks);
+        log_printf ("    last_chunk . . . . . . . : 0x%lx", lines->last_chunk);
+        log_printf ("    chunks_count . . . . . . : %d",    lines->chunks_count);
+    }
+}
+
+/*
+ * Frees some variables allocated for lines (tags).
+ */
+
+void
+gui_line_end ()
+{
+    int i;
+
+    for (i = 0; i < gui_line_tags_ids_count; i++)
+    {
+        if (gui_line_tags[i])
+        {
+            string_shared_free (gui_line_tags[i]->name);
+            free (gui_line_tags[i]);
+        }
+    }
+    if (gui_line_tags)
+    {
+        free (gui_line_tags);
+        gui_line_tags = NULL;
+    }
+    gui_line_tags_size = 0;
+    gui_line_tags_ids_count = 0;
+
+    if (gui_line_tags_index)
+    {
+        hashtable_free (gui_line_tags_index);
+        gui_line_tags_index = NULL;
+    }
+
+    if (gui_line_tags_ids_pending)
+    {
+        free (gui_line_tags_ids_pending);
+        gui_line_tags_ids_pending = NULL;
+    }
+    gui_line_tags_ids_pending_count = 0;
+    gui_line_tags_ids_pending_size = 0;
+
+    if (gui_line_tags_ids_free)
+    {
+        free (gui_line_tags_ids_free);
+        gui_line_tags_ids_free = NULL;
     }
+    gui_line_tags_ids_free_count = 0;
+    gui_line_tags_ids_free_size = 0;
 }
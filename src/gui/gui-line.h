@@ -25,8 +25,64 @@
 
 struct t_infolist;
 
+/*
+ * lines of formatted buffers are stored in chunks: each chunk contains many
+ * lines (structures t_gui_line and t_gui_line_data, array of tags, time and
+ * message); size of chunks grows from min to max size, and a chunk is freed
+ * when all its lines have been freed
+ */
+#define GUI_LINE_CHUNK_MIN_SIZE  4096
+#define GUI_LINE_CHUNK_MAX_SIZE  65536
+#define GUI_LINE_CHUNK_ALIGN(__size) (((__size) + 7) & ~7)
+
+/*
+ * tags of lines have an integer id (index in gui_line_tags); ids of tags not
+ * used any more are reused only when there are at least
+ * GUI_LINE_TAGS_RECYCLE_MIN of them (then the cache of all masks of tags
+ * is reset)
+ */
+#define GUI_LINE_TAGS_RECYCLE_MIN 1024
+
 /* line structures */
 
+struct t_gui_line_tag
+{
+    const char *name;                  /* tag name (shared string)          */
+    int id;                            /* tag id (index in gui_line_tags)   */
+    int refcount;                      /* number of lines with this tag     */
+};
+
+struct t_gui_line_tag_mask
+{
+    char *mask;                        /* mask (without "!" if negated)     */
+    int negated;                       /* 1 if mask is negated ("!tag")     */
+    unsigned char *cache;              /* bitset with 2 bits by tag id:     */
+                                       /* "checked" and "match"             */
+    int cache_size;                    /* number of tag ids in cache        */
+    int generation;                    /* generation of tag ids in cache    */
+};
+
+struct t_gui_line_tags_match
+{
+    int groups_count;                  /* number of groups ("tag1+tag2")    */
+    int *groups;                       /* index of first mask of groups     */
+                                       /* (groups_count + 1 items)          */
+    int masks_count;                   /* number of masks                   */
+    struct t_gui_line_tag_mask *masks; /* masks of tags (for all groups)    */
+};
+
+struct t_gui_line_chunk
+{
+    struct t_gui_lines *lines;         /* lines using this chunk            */
+    char *data;                        /* data (lines stored in chunk)      */
+    int size;                          /* size of data                      */
+    int used;                          /* size used in data                 */
+    int lines_count;                   /* number of lines in chunk (not     */
+                                       /* freed)                            */
+    struct t_gui_line_chunk *prev_chunk; /* link to previous chunk          */
+    struct t_gui_line_chunk *next_chunk; /* link to next chunk              */
+};
+
 struct t_gui_line_data
 {
     struct t_gui_buffer *buffer;       /* pointer to buffer                 */
@@ -36,12 +92,19 @@ struct t_gui_line_data
     char *str_time;                    /* time string (for display)         */
     int tags_count;                    /* number of tags for line           */
     char **tags_array;                 /* tags for line                     */
+    int *tags_id;                      /* id of tags (see gui_line_tags)    */
+    unsigned char *filters_match;      /* filters matching line: bitset by  */
+                                       /* filter id (NULL if no filter      */
+                                       /* matches line)                     */
+    int filters_match_size;            /* size of bitset (in bytes)         */
     char displayed;                    /* 1 if line is displayed            */
     char highlight;                    /* 1 if line has highlight           */
     char refresh_needed;               /* 1 if refresh asked (free buffer)  */
     char *prefix;                      /* prefix for line (may be NULL)     */
     int prefix_length;                 /* prefix length (on screen)         */
     char *message;                     /* line content (after prefix)       */
+    struct t_gui_line_chunk *chunk;    /* chunk with line data (NULL if     */
+                                       /* line data is not in a chunk)      */
 };
 
 struct t_gui_line
@@ -64,12 +127,33 @@ struct t_gui_lines
     int buffer_max_length_refresh;     /* refresh asked for buffer max len. */
     int prefix_max_length;             /* max length for prefix align       */
     int prefix_max_length_refresh;     /* refresh asked for prefix max len. */
+    struct t_gui_line_chunk *chunks;   /* chunks with lines (own lines)     */
+    struct t_gui_line_chunk *last_chunk; /* last chunk (used for new lines) */
+    int chunks_count;                  /* number of chunks                  */
+    unsigned char *filters_mask;       /* bitset of filters enabled when    */
+                                       /* lines were filtered (own lines)   */
+    int filters_mask_size;             /* size of bitset (in bytes)         */
 };
 
+/* line variables */
+
+extern struct t_gui_line_tag **gui_line_tags;
+extern int gui_line_tags_ids_count;
+extern int gui_line_tags_generation;
+
 /* line functions */
 
 extern struct t_gui_lines *gui_lines_alloc ();
 extern void gui_lines_free (struct t_gui_lines *lines);
+extern int gui_line_chunk_contains (struct t_gui_line_chunk *chunk,
+                                    const void *pointer);
+extern void gui_line_free_string (struct t_gui_line_data *line_data,
+                                  char *string);
+extern int gui_line_tag_get_id (const char *tag);
+extern void gui_line_tag_release_id (int id);
+extern struct t_gui_line_tags_match *gui_line_tags_match_new (int tags_count,
+                                                              char ***tags_array);
+extern void gui_line_tags_match_free (struct t_gui_line_tags_match *tags_match);
 extern void gui_line_get_prefix_for_display (struct t_gui_line *line,
                                              char **prefix, int *length,
                                              char **color, int *prefix_is_nick);
@@ -81,6 +165,8 @@ extern struct t_gui_line *gui_line_get_first_displayed (struct t_gui_buffer *buf
 extern struct t_gui_line *gui_line_get_last_displayed (struct t_gui_buffer *buffer);
 extern struct t_gui_line *gui_line_get_prev_displayed (struct t_gui_line *line);
 extern struct t_gui_line *gui_line_get_next_displayed (struct t_gui_line *line);
+extern int gui_line_search_text_string (struct t_gui_buffer *buffer,
+                                        const char *string);
 extern int gui_line_search_text (struct t_gui_buffer *buffer,
                                  struct t_gui_line *line);
 extern int gui_line_match_regex (struct t_gui_line_data *line_data,
@@ -88,7 +174,7 @@ extern int gui_line_match_regex (struct t_gui_line_data *line_data,
                                  regex_t *regex_message);
 extern int gui_line_has_tag_no_filter (struct t_gui_line_data *line_data);
 extern int gui_line_match_tags (struct t_gui_line_data *line_data,
-                                int tags_count, char ***tags_array);
+                                struct t_gui_line_tags_match *tags_match);
 extern const char *gui_line_search_tag_starting_with (struct t_gui_line *line,
                                                       const char *tag);
 extern const char *gui_line_get_nick_tag (struct t_gui_line *line);
@@ -104,6 +190,7 @@ extern void gui_line_free (struct t_gui_buffer *buffer,
                            struct t_gui_line *line);
 extern void gui_line_free_all (struct t_gui_buffer *buffer);
 extern int gui_line_get_notify_level (struct t_gui_line *line);
+extern void gui_line_batch_end (struct t_gui_buffer *buffer);
 extern struct t_gui_line *gui_line_add (struct t_gui_buffer *buffer,
                                         time_t date,
                                         time_t date_printed,
@@ -127,5 +214,6 @@ extern int gui_line_add_to_infolist (struct t_infolist *infolist,
                                      struct t_gui_lines *lines,
                                      struct t_gui_line *line);
 extern void gui_lines_print_log (struct t_gui_lines *lines);
+extern void gui_line_end ();
 
 #endif /* WEECHAT_GUI_LINE_H */
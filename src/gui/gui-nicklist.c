@@ -435,7 +435,14 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
 {
     struct t_gui_nick *new_nick;
 
-    if (!buffer || !name || gui_nicklist_search_nick (buffer, NULL, name))
+    if (!buffer || !name)
+        return NULL;
+
+    /*
+     * in batch mode, the caller must ensure the nick is not already in
+     * nicklist (the linear search is skipped)
+     */
+    if (!buffer->nicklist_batch && gui_nicklist_search_nick (buffer, NULL, name))
         return NULL;
 
     new_nick = malloc (sizeof (*new_nick));
@@ -449,7 +456,21 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
     new_nick->prefix_color = (prefix_color) ? (char *)string_shared_get (prefix_color) : NULL;
     new_nick->visible = visible;
 
-    gui_nicklist_insert_nick_sorted (new_nick->group, new_nick);
+    if (buffer->nicklist_batch)
+    {
+        /* batch mode: add nick to the end (nicks sorted at end of batch) */
+        new_nick->prev_nick = new_nick->group->last_nick;
+        new_nick->next_nick = NULL;
+        if (new_nick->group->last_nick)
+            (new_nick->group->last_nick)->next_nick = new_nick;
+        else
+            new_nick->group->nicks = new_nick;
+        new_nick->group->last_nick = new_nick;
+    }
+    else
+    {
+        gui_nicklist_insert_nick_sorted (new_nick->group, new_nick);
+    }
 
     buffer->nicklist_count++;
     buffer->nicklist_nicks_count++;
@@ -457,6 +478,10 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
     if (visible)
         buffer->nicklist_visible_count++;
 
+    /* batch mode: refresh and signal are done at end of batch */
+    if (buffer->nicklist_batch)
+        return new_nick;
+
     if (CONFIG_BOOLEAN(config_look_color_nick_offline))
         gui_buffer_ask_chat_refresh (buffer, 1);
 
@@ -618,6 +643,128 @@ gui_nicklist_remove_all (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Sorts a list of nicks (merge sort).
+ *
+ * Returns pointer to first nick of sorted list (only links to next nicks are
+ * updated).
+ */
+
+struct t_gui_nick *
+gui_nicklist_sort_nicks (struct t_gui_nick *nicks, int count)
+{
+    struct t_gui_nick *list1, *list2, *ptr_nick, *sorted, *last;
+    int i, count1;
+
+    if (count < 2)
+    {
+        if (nicks)
+            nicks->next_nick = NULL;
+        return nicks;
+    }
+
+    /* split list in two halves */
+    count1 = count / 2;
+    ptr_nick = nicks;
+    for (i = 1; i < count1; i++)
+    {
+        ptr_nick = ptr_nick->next_nick;
+    }
+    list1 = nicks;
+    list2 = ptr_nick->next_nick;
+    ptr_nick->next_nick = NULL;
+
+    list1 = gui_nicklist_sort_nicks (list1, count1);
+    list2 = gui_nicklist_sort_nicks (list2, count - count1);
+
+    /* merge the two sorted lists (nicks of first list first if equal) */
+    sorted = NULL;
+    last = NULL;
+    while (list1 || list2)
+    {
+        if (!list2
+            || (list1
+                && (string_strcasecmp (list2->name, list1->name) >= 0)))
+        {
+            ptr_nick = list1;
+            list1 = list1->next_nick;
+        }
+        else
+        {
+            ptr_nick = list2;
+            list2 = list2->next_nick;
+        }
+        if (last)
+            last->next_nick = ptr_nick;
+        else
+            sorted = ptr_nick;
+        last = ptr_nick;
+    }
+
+    return sorted;
+}
+
+/*
+ * Sorts nicks of a group and its children.
+ */
+
+void
+gui_nicklist_sort_group (struct t_gui_nick_group *group)
+{
+    struct t_gui_nick_group *ptr_group;
+    struct t_gui_nick *ptr_nick, *prev_nick;
+    int count;
+
+    count = 0;
+    for (ptr_nick = group->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        count++;
+    }
+
+    if (count > 1)
+    {
+        group->nicks = gui_nicklist_sort_nicks (group->nicks, count);
+
+        /* rebuild links to previous nicks */
+        prev_nick = NULL;
+        for (ptr_nick = group->nicks; ptr_nick;
+             ptr_nick = ptr_nick->next_nick)
+        {
+            ptr_nick->prev_nick = prev_nick;
+            prev_nick = ptr_nick;
+        }
+        group->last_nick = prev_nick;
+    }
+
+    for (ptr_group = group->children; ptr_group;
+         ptr_group = ptr_group->next_group)
+    {
+        gui_nicklist_sort_group (ptr_group);
+    }
+}
+
+/*
+ * Ends a batch of nicks added in nicklist: nicklist is sorted in one pass,
+ * and a single signal "nicklist_batch_ended" is sent (instead of one signal
+ * "nicklist_nick_added" for each nick).
+ */
+
+void
+gui_nicklist_batch_end (struct t_gui_buffer *buffer)
+{
+    if (!buffer || !buffer->nicklist_root)
+        return;
+
+    gui_nicklist_sort_group (buffer->nicklist_root);
+
+    if (CONFIG_BOOLEAN(config_look_color_nick_offline))
+        gui_buffer_ask_chat_refresh (buffer, 1);
+
+    gui_nicklist_send_signal ("nicklist_batch_ended", buffer, NULL);
+    gui_nicklist_send_hsignal ("nicklist_batch_ended", buffer,
+                               buffer->nicklist_root, NULL);
+}
+
 /*
  * Gets next item (group or nick) of a group/nick.
  */
@@ -1023,7 +1170,7 @@ gui_nicklist_nick_set (struct t_gui_buffer *buffer,
         nick_changed = 1;
     }
 
-    if (nick_changed)
+    if (nick_changed && !buffer->nicklist_batch)
     {
         gui_nicklist_send_signal ("nicklist_nick_changed", buffer,
                                   nick->name);
@@ -79,6 +79,7 @@ extern void gui_nicklist_get_next_item (struct t_gui_buffer *buffer,
                                         struct t_gui_nick_group **group,
                                         struct t_gui_nick **nick);
 extern const char *gui_nicklist_get_group_start (const char *name);
+extern void gui_nicklist_batch_end (struct t_gui_buffer *buffer);
 extern void gui_nicklist_compute_visible_count (struct t_gui_buffer *buffer,
                                                 struct t_gui_nick_group *group);
 
@@ -0,0 +1,778 @@
+/*
+ * gui-search-index.c - index of lines for text search in buffers
+ *                      (used by all GUI)
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+
+#include "../core/weechat.h"
+#include "../core/wee-config.h"
+#include "../core/wee-hashtable.h"
+#include "../core/wee-log.h"
+#include "../plugins/plugin.h"
+#include "gui-search-index.h"
+#include "gui-buffer.h"
+#include "gui-color.h"
+#include "gui-line.h"
+
+
+/*
+ * Returns bucket of a trigram (3 bytes of string, lower case for ASCII
+ * letters).
+ */
+
+int
+gui_search_index_hash (const char *string)
+{
+    unsigned int key;
+    int i;
+    unsigned char c;
+
+    key = 0;
+    for (i = 0; i < 3; i++)
+    {
+        c = (unsigned char)string[i];
+        if ((c >= 'A') && (c <= 'Z'))
+            c += ('a' - 'A');
+        key = (key << 8) | c;
+    }
+
+    return (int)((key * 2654435761U) >> 20) & (GUI_SEARCH_INDEX_BUCKETS - 1);
+}
+
+/*
+ * Checks if search index can be used in a buffer: option
+ * weechat.look.buffer_search_index is enabled, buffer has formatted content
+ * and is not merged with other buffers (lines displayed are own lines).
+ *
+ * Returns:
+ *   1: search index can be used
+ *   0: search index can not be used
+ */
+
+int
+gui_search_index_enabled (struct t_gui_buffer *buffer)
+{
+    return (CONFIG_BOOLEAN(config_look_buffer_search_index)
+            && buffer
+            && (buffer->type == GUI_BUFFER_TYPE_FORMATTED)
+            && (buffer->lines == buffer->own_lines)) ? 1 : 0;
+}
+
+/*
+ * Adds an id of line in a bucket (if not already added).
+ */
+
+void
+gui_search_index_bucket_add (struct t_gui_search_index_bucket *bucket, int id)
+{
+    int *new_ids, new_size;
+
+    /* ids are added in order, so the id is the last one if already added */
+    if ((bucket->count > 0) && (bucket->ids[bucket->count - 1] == id))
+        return;
+
+    if (bucket->count >= bucket->size)
+    {
+        new_size = (bucket->size > 0) ? bucket->size * 2 : 16;
+        new_ids = realloc (bucket->ids, new_size * sizeof (*new_ids));
+        if (!new_ids)
+            return;
+        bucket->ids = new_ids;
+        bucket->size = new_size;
+    }
+
+    bucket->ids[bucket->count] = id;
+    bucket->count++;
+}
+
+/*
+ * Returns position of first id greater than or equal to "id" in a bucket
+ * (bucket->count if all ids are lower than "id").
+ */
+
+int
+gui_search_index_bucket_lower_bound (struct t_gui_search_index_bucket *bucket,
+                                     int id)
+{
+    int low, high, middle;
+
+    low = 0;
+    high = bucket->count;
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+        if (bucket->ids[middle] < id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/*
+ * Adds trigrams of a text in index, for line with this id.
+ */
+
+void
+gui_search_index_add_text (struct t_gui_search_index *search_index,
+                           const char *text, int id)
+{
+    const char *ptr_text;
+
+    if (!text)
+        return;
+
+    for (ptr_text = text; ptr_text[0] && ptr_text[1] && ptr_text[2];
+         ptr_text++)
+    {
+        gui_search_index_bucket_add (
+            &search_index->buckets[gui_search_index_hash (ptr_text)], id);
+    }
+}
+
+/*
+ * Adds a line in search index of buffer (if buffer has an index).
+ *
+ * The line must be the last line of buffer (ids of lines are sorted).
+ */
+
+void
+gui_search_index_add_line (struct t_gui_buffer *buffer,
+                           struct t_gui_line *line)
+{
+    struct t_gui_search_index *search_index;
+    struct t_gui_search_index_line *new_lines, *ptr_index_line;
+    int id, new_size;
+
+    if (!buffer || !buffer->search_index || !line)
+        return;
+
+    search_index = buffer->search_index;
+
+    id = search_index->first_id + search_index->lines_count;
+    if (id == INT_MAX)
+    {
+        /* no more ids available: index will be built again on next search */
+        gui_search_index_free (buffer);
+        return;
+    }
+
+    if (search_index->lines_count >= search_index->lines_size)
+    {
+        new_size = (search_index->lines_size > 0) ?
+            search_index->lines_size * 2 : 1024;
+        new_lines = realloc (search_index->lines,
+                             new_size * sizeof (*new_lines));
+        if (!new_lines)
+        {
+            gui_search_index_free (buffer);
+            return;
+        }
+        search_index->lines = new_lines;
+        search_index->lines_size = new_size;
+    }
+
+    ptr_index_line = &search_index->lines[search_index->lines_count];
+    ptr_index_line->line = line;
+    ptr_index_line->prefix = (line->data->prefix) ?
+        gui_color_decode (line->data->prefix, NULL) : NULL;
+    ptr_index_line->message = (line->data->message) ?
+        gui_color_decode (line->data->message, NULL) : NULL;
+    search_index->lines_count++;
+
+    gui_search_index_add_text (search_index, ptr_index_line->prefix, id);
+    gui_search_index_add_text (search_index, ptr_index_line->message, id);
+
+    hashtable_set (search_index->ids, line->data, &id);
+}
+
+/*
+ * Compacts search index: removes lines removed at beginning of array and
+ * their ids in all buckets.
+ */
+
+void
+gui_search_index_compact (struct t_gui_search_index *search_index)
+{
+    struct t_gui_search_index_bucket *ptr_bucket;
+    int i, pos;
+
+    if (search_index->lines_start == 0)
+        return;
+
+    memmove (search_index->lines,
+             search_index->lines + search_index->lines_start,
+             (search_index->lines_count - search_index->lines_start) *
+             sizeof (*search_index->lines));
+    search_index->lines_count -= search_index->lines_start;
+    search_index->first_id += search_index->lines_start;
+    search_index->lines_start = 0;
+
+    for (i = 0; i < GUI_SEARCH_INDEX_BUCKETS; i++)
+    {
+        ptr_bucket = &search_index->buckets[i];
+        pos = gui_search_index_bucket_lower_bound (ptr_bucket,
+                                                  search_index->first_id);
+        if (pos > 0)
+        {
+            memmove (ptr_bucket->ids, ptr_bucket->ids + pos,
+                     (ptr_bucket->count - pos) * sizeof (*ptr_bucket->ids));
+            ptr_bucket->count -= pos;
+        }
+    }
+}
+
+/*
+ * Removes a line from search index of buffer (if buffer has an index).
+ */
+
+void
+gui_search_index_remove_line (struct t_gui_buffer *buffer,
+                              struct t_gui_line *line)
+{
+    struct t_gui_search_index *search_index;
+    struct t_gui_search_index_line *ptr_index_line;
+    int *ptr_id;
+
+    if (!buffer || !buffer->search_index || !line)
+        return;
+
+    search_index = buffer->search_index;
+
+    ptr_id = hashtable_get (search_index->ids, line->data);
+    if (!ptr_id)
+        return;
+
+    ptr_index_line = &search_index->lines[*ptr_id - search_index->first_id];
+    if (ptr_index_line->prefix)
+        free (ptr_index_line->prefix);
+    if (ptr_index_line->message)
+        free (ptr_index_line->message);
+    ptr_index_line->line = NULL;
+    ptr_index_line->prefix = NULL;
+    ptr_index_line->message = NULL;
+
+    hashtable_remove (search_index->ids, line->data);
+
+    while ((search_index->lines_start < search_index->lines_count)
+           && !search_index->lines[search_index->lines_start].line)
+    {
+        search_index->lines_start++;
+    }
+
+    if ((search_index->lines_start >= GUI_SEARCH_INDEX_COMPACT_MIN)
+        && (search_index->lines_start >= search_index->lines_count / 2))
+    {
+        gui_search_index_compact (search_index);
+    }
+}
+
+/*
+ * Builds search index of a buffer (if not already built), with all lines of
+ * buffer.
+ *
+ * Returns pointer to search index, NULL if error.
+ */
+
+struct t_gui_search_index *
+gui_search_index_build (struct t_gui_buffer *buffer)
+{
+    struct t_gui_search_index *new_search_index;
+    struct t_gui_line *ptr_line;
+
+    if (!buffer)
+        return NULL;
+
+    if (buffer->search_index)
+        return buffer->search_index;
+
+    new_search_index = calloc (1, sizeof (*new_search_index));
+    if (!new_search_index)
+        return NULL;
+
+    new_search_index->ids = hashtable_new (32,
+                                           WEECHAT_HASHTABLE_POINTER,
+                                           WEECHAT_HASHTABLE_INTEGER,
+                                           NULL, NULL);
+    if (!new_search_index->ids)
+    {
+        free (new_search_index);
+        return NULL;
+    }
+
+    buffer->search_index = new_search_index;
+
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        gui_search_index_add_line (buffer, ptr_line);
+        if (!buffer->search_index)
+            return NULL;
+    }
+
+    return buffer->search_index;
+}
+
+/*
+ * Gets line in search index, using pointer to line data (the line data can be
+ * in own lines or mixed lines of a buffer).
+ *
+ * Returns pointer to line in search index (with text of line without colors),
+ * NULL if line is not in a search index.
+ */
+
+struct t_gui_search_index_line *
+gui_search_index_get_line (struct t_gui_line_data *line_data)
+{
+    struct t_gui_search_index *search_index;
+    int *ptr_id;
+
+    if (!line_data || !line_data->buffer
+        || !line_data->buffer->search_index)
+    {
+        return NULL;
+    }
+
+    search_index = line_data->buffer->search_index;
+
+    ptr_id = hashtable_get (search_index->ids, line_data);
+    if (!ptr_id)
+        return NULL;
+
+    return &search_index->lines[*ptr_id - search_index->first_id];
+}
+
+/*
+ * Adds a bucket in array of buckets (if not already in array).
+ */
+
+void
+gui_search_index_buckets_add (int *buckets, int *num_buckets, int bucket)
+{
+    int i;
+
+    for (i = 0; i < *num_buckets; i++)
+    {
+        if (buckets[i] == bucket)
+            return;
+    }
+    buckets[*num_buckets] = bucket;
+    (*num_buckets)++;
+}
+
+/*
+ * Adds buckets of trigrams of a literal string (part of text searched) in
+ * array of buckets.
+ */
+
+void
+gui_search_index_buckets_add_literal (int *buckets, int *num_buckets,
+                                      const char *literal, int length)
+{
+    int i;
+
+    for (i = 0; i + 2 < length; i++)
+    {
+        gui_search_index_buckets_add (buckets, num_buckets,
+                                      gui_search_index_hash (literal + i));
+    }
+}
+
+/*
+ * Gets buckets of trigrams that must be in a line matching the text searched
+ * in buffer (input of buffer).
+ *
+ * For a regex, only literal strings that must be in the line are used (if
+ * the regex contains an alternative or a group, no bucket is returned).
+ *
+ * Returns number of buckets (0 if search index can not be used to search
+ * this text), -1 if error. The array "buckets" must be freed after use.
+ */
+
+int
+gui_search_index_get_buckets (struct t_gui_buffer *buffer, int **buckets)
+{
+    const char *text, *ptr_text, *ptr_class;
+    char *literal;
+    int length, length_literal, num_buckets;
+
+    *buckets = NULL;
+
+    if (!buffer || !buffer->input_buffer || !buffer->input_buffer[0])
+        return 0;
+
+    text = buffer->input_buffer;
+    length = strlen (text);
+    if (length < 3)
+        return 0;
+
+    if (buffer->text_search_regex
+        && (strchr (text, '|') || strchr (text, '(')))
+    {
+        return 0;
+    }
+
+    *buckets = malloc (length * sizeof (**buckets));
+    if (!*buckets)
+        return -1;
+    num_buckets = 0;
+
+    if (!buffer->text_search_regex)
+    {
+        gui_search_index_buckets_add_literal (*buckets, &num_buckets,
+                                              text, length);
+        return num_buckets;
+    }
+
+    literal = malloc (length + 1);
+    if (!literal)
+    {
+        free (*buckets);
+        *buckets = NULL;
+        return -1;
+    }
+    length_literal = 0;
+
+    ptr_text = text;
+    while (ptr_text[0])
+    {
+        switch (ptr_text[0])
+        {
+            case '\\':
+                if (!ptr_text[1]
+                    || ((ptr_text[1] >= 'a') && (ptr_text[1] <= 'z'))
+                    || ((ptr_text[1] >= 'A') && (ptr_text[1] <= 'Z'))
+                    || ((ptr_text[1] >= '0') && (ptr_text[1] <= '9'))
+                    || ((unsigned char)ptr_text[1] >= 0x80))
+                {
+                    /* special sequence (like "\w") or end of regex */
+                    gui_search_index_buckets_add_literal (
+                        *buckets, &num_buckets, literal, length_literal);
+                    length_literal = 0;
+                    if (ptr_text[1])
+                        ptr_text++;
+                }
+                else
+                {
+                    /* escaped char */
+                    ptr_text++;
+                    literal[length_literal++] = ptr_text[0];
+                }
+                break;
+            case '*':
+            case '?':
+            case '{':
+                /* previous char is optional */
+                if (length_literal > 0)
+                    length_literal--;
+                gui_search_index_buckets_add_literal (
+                    *buckets, &num_buckets, literal, length_literal);
+                length_literal = 0;
+                if (ptr_text[0] == '{')
+                {
+                    while (ptr_text[1] && (ptr_text[0] != '}'))
+                    {
+                        ptr_text++;
+                    }
+                }
+                break;
+            case '[':
+                /*
+                 * bracket expression: skip it (including classes like
+                 * "[:digit:]", "[=a=]" and "[.x.]" inside brackets)
+                 */
+                gui_search_index_buckets_add_literal (
+                    *buckets, &num_buckets, literal, length_literal);
+                length_literal = 0;
+                ptr_text++;
+                if (ptr_text[0] == '^')
+                    ptr_text++;
+                if (ptr_text[0] == ']')
+                    ptr_text++;
+                while (ptr_text[0] && (ptr_text[0] != ']'))
+                {
+                    if ((ptr_text[0] == '[')
+                        && ((ptr_text[1] == ':') || (ptr_text[1] == '=')
+                            || (ptr_text[1] == '.')))
+                    {
+                        ptr_class = strchr (ptr_text + 2, ptr_text[1]);
+                        while (ptr_class && (ptr_class[1] != ']'))
+                        {
+                            ptr_class = strchr (ptr_class + 1, ptr_text[1]);
+                        }
+                        if (ptr_class)
+                            ptr_text = ptr_class + 1;
+                    }
+                    ptr_text++;
+                }
+                if (!ptr_text[0])
+                    ptr_text--;
+                break;
+            case '.':
+            case '+':
+            case '^':
+            case '$':
+                gui_search_index_buckets_add_literal (
+                    *buckets, &num_buckets, literal, length_literal);
+                length_literal = 0;
+                break;
+            default:
+                if ((unsigned char)ptr_text[0] >= 0x80)
+                {
+                    /* non-ASCII char: case may be ignored by regex */
+                    gui_search_index_buckets_add_literal (
+                        *buckets, &num_buckets, literal, length_literal);
+                    length_literal = 0;
+                }
+                else
+                {
+                    literal[length_literal++] = ptr_text[0];
+                }
+                break;
+        }
+        ptr_text++;
+    }
+    gui_search_index_buckets_add_literal (*buckets, &num_buckets,
+                                          literal, length_literal);
+
+    free (literal);
+
+    return num_buckets;
+}
+
+/*
+ * Searches text in buffer (input of buffer) with search index, starting at
+ * line "start_line" (excluded), or at the end/beginning of buffer if
+ * start_line is NULL.
+ *
+ * Candidate lines are the lines in the bucket with the lowest number of
+ * lines, and in all other buckets; then the text is searched in candidate
+ * lines (simple string or regex).
+ *
+ * Returns:
+ *   1: search done with index ("line" is set to line found or NULL)
+ *   0: search index can not be used for this search (the search must be
+ *      done on all lines)
+ */
+
+int
+gui_search_index_search (struct t_gui_buffer *buffer,
+                         struct t_gui_line *start_line,
+                         int backward,
+                         struct t_gui_line **line)
+{
+    struct t_gui_search_index *search_index;
+    struct t_gui_search_index_bucket *ptr_bucket, *ptr_bucket_min;
+    struct t_gui_search_index_line *ptr_index_line;
+    int *buckets, num_buckets, *ptr_id, start_id, pos, pos_id, id, i, rc;
+
+    *line = NULL;
+
+    if (!gui_search_index_enabled (buffer))
+        return 0;
+
+    num_buckets = gui_search_index_get_buckets (buffer, &buckets);
+    if (num_buckets <= 0)
+        return 0;
+
+    rc = 0;
+
+    search_index = gui_search_index_build (buffer);
+    if (!search_index)
+        goto end;
+
+    start_id = -1;
+    if (start_line)
+    {
+        ptr_id = hashtable_get (search_index->ids, start_line->data);
+        if (!ptr_id)
+            goto end;
+        start_id = *ptr_id;
+    }
+
+    rc = 1;
+
+    /* use the bucket with the lowest number of lines */
+    ptr_bucket_min = NULL;
+    for (i = 0; i < num_buckets; i++)
+    {
+        ptr_bucket = &search_index->buckets[buckets[i]];
+        if (!ptr_bucket_min || (ptr_bucket->count < ptr_bucket_min->count))
+            ptr_bucket_min = ptr_bucket;
+    }
+
+    if (backward)
+    {
+        pos = (start_line) ?
+            gui_search_index_bucket_lower_bound (ptr_bucket_min, start_id) - 1 :
+            ptr_bucket_min->count - 1;
+    }
+    else
+    {
+        pos = (start_line) ?
+            gui_search_index_bucket_lower_bound (ptr_bucket_min, start_id + 1) :
+            gui_search_index_bucket_lower_bound (
+                ptr_bucket_min,
+                search_index->first_id + search_index->lines_start);
+    }
+
+    while ((pos >= 0) && (pos < ptr_bucket_min->count))
+    {
+        id = ptr_bucket_min->ids[pos];
+        pos += (backward) ? -1 : 1;
+
+        if (id < search_index->first_id + search_index->lines_start)
+        {
+            /* line removed (and all lines before it) */
+            if (backward)
+                break;
+            continue;
+        }
+
+        ptr_index_line = &search_index->lines[id - search_index->first_id];
+        if (!ptr_index_line->line
+            || !gui_line_is_displayed (ptr_index_line->line))
+        {
+            continue;
+        }
+
+        /* check that line is in all other buckets */
+        for (i = 0; i < num_buckets; i++)
+        {
+            ptr_bucket = &search_index->buckets[buckets[i]];
+            if (ptr_bucket == ptr_bucket_min)
+                continue;
+            pos_id = gui_search_index_bucket_lower_bound (ptr_bucket, id);
+            if ((pos_id >= ptr_bucket->count)
+                || (ptr_bucket->ids[pos_id] != id))
+            {
+                break;
+            }
+        }
+        if (i < num_buckets)
+            continue;
+
+        /* search text in line */
+        if (gui_line_search_text (buffer, ptr_index_line->line))
+        {
+            *line = ptr_index_line->line;
+            break;
+        }
+    }
+
+end:
+    free (buckets);
+    return rc;
+}
+
+/*
+ * Frees search index of a buffer.
+ */
+
+void
+gui_search_index_free (struct t_gui_buffer *buffer)
+{
+    struct t_gui_search_index *search_index;
+    int i;
+
+    if (!buffer || !buffer->search_index)
+        return;
+
+    search_index = buffer->search_index;
+
+    for (i = search_index->lines_start; i < search_index->lines_count; i++)
+    {
+        if (search_index->lines[i].prefix)
+            free (search_index->lines[i].prefix);
+        if (search_index->lines[i].message)
+            free (search_index->lines[i].message);
+    }
+    if (search_index->lines)
+        free (search_index->lines);
+
+    for (i = 0; i < GUI_SEARCH_INDEX_BUCKETS; i++)
+    {
+        if (search_index->buckets[i].ids)
+            free (search_index->buckets[i].ids);
+    }
+
+    hashtable_free (search_index->ids);
+
+    free (search_index);
+
+    buffer->search_index = NULL;
+}
+
+/*
+ * Frees search index of all buffers.
+ */
+
+void
+gui_search_index_free_all ()
+{
+    struct t_gui_buffer *ptr_buffer;
+
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        gui_search_index_free (ptr_buffer);
+    }
+}
+
+/*
+ * Prints search index of a buffer in WeeChat log file (usually for crash
+ * dump).
+ */
+
+void
+gui_search_index_print_log (struct t_gui_buffer *buffer)
+{
+    struct t_gui_search_index *search_index;
+    int i, num_ids;
+
+    search_index = buffer->search_index;
+    if (!search_index)
+        return;
+
+    num_ids = 0;
+    for (i = 0; i < GUI_SEARCH_INDEX_BUCKETS; i++)
+    {
+        num_ids += search_index->buckets[i].count;
+    }
+
+    log_printf ("");
+    log_printf ("  => search_index (addr:0x%lx):", search_index);
+    log_printf ("       lines . . . . . . . : 0x%lx", search_index->lines);
+    log_printf ("       lines_size. . . . . : %d",    search_index->lines_size);
+    log_printf ("       lines_count . . . . : %d",    search_index->lines_count);
+    log_printf ("       lines_start . . . . : %d",    search_index->lines_start);
+    log_printf ("       first_id. . . . . . : %d",    search_index->first_id);
+    log_printf ("       ids . . . . . . . . : 0x%lx", search_index->ids);
+    log_printf ("       ids in buckets. . . : %d",    num_ids);
+}
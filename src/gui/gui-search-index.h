@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_GUI_SEARCH_INDEX_H
+#define WEECHAT_GUI_SEARCH_INDEX_H 1
+
+/*
+ * trigrams (3 bytes) of prefix and message of lines, without colors and
+ * lower case, are hashed in GUI_SEARCH_INDEX_BUCKETS buckets (must be a power
+ * of 2); each bucket contains the sorted ids of lines with at least one of
+ * its trigrams
+ */
+#define GUI_SEARCH_INDEX_BUCKETS 4096
+
+/* minimum number of ids removed at beginning before compacting the index */
+#define GUI_SEARCH_INDEX_COMPACT_MIN 1024
+
+struct t_gui_buffer;
+struct t_gui_line;
+struct t_gui_line_data;
+
+/* search index structures */
+
+struct t_gui_search_index_line
+{
+    struct t_gui_line *line;           /* line (NULL if line was removed)   */
+    char *prefix;                      /* prefix without colors (or NULL)   */
+    char *message;                     /* message without colors (or NULL)  */
+};
+
+struct t_gui_search_index_bucket
+{
+    int *ids;                          /* ids of lines (sorted)             */
+    int count;                         /* number of ids                     */
+    int size;                          /* size of array "ids"               */
+};
+
+struct t_gui_search_index
+{
+    struct t_gui_search_index_line *lines; /* lines (index: id - first_id)  */
+    int lines_size;                    /* size of array "lines"             */
+    int lines_count;                   /* number of lines in array          */
+    int lines_start;                   /* number of lines removed at        */
+                                       /* beginning of array                */
+    int first_id;                      /* id of first line in array         */
+    struct t_hashtable *ids;           /* id of lines (key: pointer to line */
+                                       /* data, value: id)                  */
+    struct t_gui_search_index_bucket buckets[GUI_SEARCH_INDEX_BUCKETS];
+};
+
+/* search index functions */
+
+extern int gui_search_index_enabled (struct t_gui_buffer *buffer);
+extern struct t_gui_search_index *gui_search_index_build (struct t_gui_buffer *buffer);
+extern void gui_search_index_add_line (struct t_gui_buffer *buffer,
+                                       struct t_gui_line *line);
+extern void gui_search_index_remove_line (struct t_gui_buffer *buffer,
+                                          struct t_gui_line *line);
+extern struct t_gui_search_index_line *gui_search_index_get_line (struct t_gui_line_data *line_data);
+extern int gui_search_index_get_buckets (struct t_gui_buffer *buffer,
+                                         int **buckets);
+extern int gui_search_index_search (struct t_gui_buffer *buffer,
+                                    struct t_gui_line *start_line,
+                                    int backward,
+                                    struct t_gui_line **line);
+extern void gui_search_index_free (struct t_gui_buffer *buffer);
+extern void gui_search_index_free_all ();
+extern void gui_search_index_print_log (struct t_gui_buffer *buffer);
+
+#endif /* WEECHAT_GUI_SEARCH_INDEX_H */
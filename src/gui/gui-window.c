@@ -35,6 +35,7 @@
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
+#include "../core/wee-hashtable.h"
 #include "../core/wee-hdata.h"
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
@@ -53,11 +54,15 @@
 #include "gui-hotlist.h"
 #include "gui-layout.h"
 #include "gui-line.h"
+#include "gui-search-index.h"
 
 
 int gui_init_ok = 0;                            /* = 1 if GUI is initialized*/
 int gui_window_refresh_needed = 0;              /* = 1 if refresh needed    */
                                                 /* = 2 for full refresh     */
+int gui_window_lines_layout_generation = 0;     /* generation of layout     */
+                                                /* of lines (see cache of   */
+                                                /* layout in windows)       */
 struct t_gui_window *gui_windows = NULL;        /* first window             */
 struct t_gui_window *last_gui_window = NULL;    /* last window              */
 struct t_gui_window *gui_current_window = NULL; /* current window           */
@@ -274,6 +279,10 @@ gui_window_ask_refresh (int refresh)
 {
     if (refresh > gui_window_refresh_needed)
         gui_window_refresh_needed = refresh;
+
+    /* options or size of windows may have changed: compute layout again */
+    if (refresh > 0)
+        gui_window_lines_layout_invalidate ();
 }
 
 /*
@@ -672,6 +681,9 @@ gui_window_new (struct t_gui_window *parent_window, struct t_gui_buffer *buffer,
     new_window->coords = NULL;
     new_window->coords_x_message = 0;
 
+    /* layout of lines */
+    new_window->lines_layout = NULL;
+
     /* tree */
     new_window->ptr_tree = ptr_leaf;
     ptr_leaf->window = new_window;
@@ -973,6 +985,155 @@ gui_window_coords_alloc (struct t_gui_window *window)
     window->coords_x_message = 0;
 }
 
+/*
+ * Checks that layout of lines in window has been computed with current
+ * settings (width, generation, lines displayed, max length of prefix and
+ * buffer name, time for each line); if not, the layout is cleared.
+ *
+ * Returns:
+ *   1: layout of lines can be used
+ *   0: layout of lines is not allocated
+ */
+
+int
+gui_window_lines_layout_check (struct t_gui_window *window, int width)
+{
+    struct t_gui_window_lines_layout *layout;
+    struct t_gui_lines *ptr_lines;
+    int buffer_max_length;
+
+    layout = window->lines_layout;
+    if (!layout)
+        return 0;
+
+    ptr_lines = window->buffer->lines;
+    buffer_max_length = (window->buffer->mixed_lines) ?
+        window->buffer->mixed_lines->buffer_max_length : 0;
+
+    if ((layout->generation != gui_window_lines_layout_generation)
+        || (layout->width != width)
+        || (layout->buffer_lines != ptr_lines)
+        || (layout->prefix_max_length != ptr_lines->prefix_max_length)
+        || (layout->buffer_max_length != buffer_max_length)
+        || (layout->time_for_each_line != window->buffer->time_for_each_line))
+    {
+        hashtable_remove_all (layout->lines);
+        layout->generation = gui_window_lines_layout_generation;
+        layout->width = width;
+        layout->buffer_lines = ptr_lines;
+        layout->prefix_max_length = ptr_lines->prefix_max_length;
+        layout->buffer_max_length = buffer_max_length;
+        layout->time_for_each_line = window->buffer->time_for_each_line;
+    }
+
+    return 1;
+}
+
+/*
+ * Gets number of lines on screen for a line (time, prefix and message only,
+ * without day change and read marker), if it has already been computed for
+ * this window with the same width.
+ *
+ * Returns number of lines on screen, -1 if not found.
+ */
+
+int
+gui_window_lines_layout_get (struct t_gui_window *window,
+                             struct t_gui_line_data *line_data,
+                             int width)
+{
+    int *ptr_num_lines;
+
+    if (!window || !window->buffer || !line_data
+        || !gui_window_lines_layout_check (window, width))
+    {
+        return -1;
+    }
+
+    ptr_num_lines = hashtable_get (window->lines_layout->lines, line_data);
+
+    return (ptr_num_lines) ? *ptr_num_lines : -1;
+}
+
+/*
+ * Sets number of lines on screen for a line (time, prefix and message only,
+ * without day change and read marker).
+ */
+
+void
+gui_window_lines_layout_set (struct t_gui_window *window,
+                             struct t_gui_line_data *line_data,
+                             int width, int num_lines)
+{
+    struct t_gui_window_lines_layout *new_layout;
+
+    if (!window || !window->buffer || !line_data)
+        return;
+
+    if (!window->lines_layout)
+    {
+        new_layout = malloc (sizeof (*new_layout));
+        if (!new_layout)
+            return;
+        new_layout->lines = hashtable_new (32,
+                                           WEECHAT_HASHTABLE_POINTER,
+                                           WEECHAT_HASHTABLE_INTEGER,
+                                           NULL, NULL);
+        if (!new_layout->lines)
+        {
+            free (new_layout);
+            return;
+        }
+        /* force init of layout on check */
+        new_layout->generation = gui_window_lines_layout_generation - 1;
+        window->lines_layout = new_layout;
+    }
+
+    gui_window_lines_layout_check (window, width);
+
+    hashtable_set (window->lines_layout->lines, line_data, &num_lines);
+}
+
+/*
+ * Removes a line from layout of lines in window.
+ */
+
+void
+gui_window_lines_layout_remove (struct t_gui_window *window,
+                                struct t_gui_line_data *line_data)
+{
+    if (!window || !window->lines_layout || !line_data)
+        return;
+
+    hashtable_remove (window->lines_layout->lines, line_data);
+}
+
+/*
+ * Invalidates layout of lines in all windows (it will be computed again
+ * when lines are displayed).
+ */
+
+void
+gui_window_lines_layout_invalidate ()
+{
+    gui_window_lines_layout_generation++;
+}
+
+/*
+ * Frees layout of lines in a window.
+ */
+
+void
+gui_window_lines_layout_free (struct t_gui_window *window)
+{
+    if (!window || !window->lines_layout)
+        return;
+
+    hashtable_free (window->lines_layout->lines);
+    free (window->lines_layout);
+    window->lines_layout = NULL;
+}
+
 /*
  * Deletes a window.
  */
@@ -1020,6 +1181,9 @@ gui_window_free (struct t_gui_window *window)
     if (window->coords)
         free (window->coords);
 
+    /* free layout of lines */
+    gui_window_lines_layout_free (window);
+
     /* remove window from windows list */
     if (window->prev_window)
         (window->prev_window)->next_window = window->next_window;
@@ -1557,6 +1721,9 @@ gui_window_scroll_unread (struct t_gui_window *window)
 /*
  * Searches for text in a buffer.
  *
+ * The search index of buffer is used if possible, otherwise all lines are
+ * checked, starting at the line displayed.
+ *
  * Returns:
  *   1: line has been found with text
  *   0: no line found with text
@@ -1575,21 +1742,27 @@ gui_window_search_text (struct t_gui_window *window)
         if (window->buffer->lines->first_line
             && window->buffer->input_buffer && window->buffer->input_buffer[0])
         {
-            ptr_line = (window->scroll->start_line) ?
-                gui_line_get_prev_displayed (window->scroll->start_line) :
-                gui_line_get_last_displayed (window->buffer);
-            while (ptr_line)
+            if (!gui_search_index_search (window->buffer,
+                                          window->scroll->start_line,
+                                          1, &ptr_line))
             {
-                if (gui_line_search_text (window->buffer, ptr_line))
+                ptr_line = (window->scroll->start_line) ?
+                    gui_line_get_prev_displayed (window->scroll->start_line) :
+                    gui_line_get_last_displayed (window->buffer);
+                while (ptr_line
+                       && !gui_line_search_text (window->buffer, ptr_line))
                 {
-                    window->scroll->start_line = ptr_line;
-                    window->scroll->start_line_pos = 0;
-                    window->scroll->first_line_displayed =
-                        (window->scroll->start_line == gui_line_get_first_displayed (window->buffer));
-                    gui_buffer_ask_chat_refresh (window->buffer, 2);
-                    return 1;
+                    ptr_line = gui_line_get_prev_displayed (ptr_line);
                 }
-                ptr_line = gui_line_get_prev_displayed (ptr_line);
+            }
+            if (ptr_line)
+            {
+                window->scroll->start_line = ptr_line;
+                window->scroll->start_line_pos = 0;
+                window->scroll->first_line_displayed =
+                    (window->scroll->start_line == gui_line_get_first_displayed (window->buffer));
+                gui_buffer_ask_chat_refresh (window->buffer, 2);
+                return 1;
             }
         }
     }
@@ -1598,21 +1771,27 @@ gui_window_search_text (struct t_gui_window *window)
         if (window->buffer->lines->first_line
             && window->buffer->input_buffer && window->buffer->input_buffer[0])
         {
-            ptr_line = (window->scroll->start_line) ?
-                gui_line_get_next_displayed (window->scroll->start_line) :
-                gui_line_get_first_displayed (window->buffer);
-            while (ptr_line)
+            if (!gui_search_index_search (window->buffer,
+                                          window->scroll->start_line,
+                                          0, &ptr_line))
             {
-                if (gui_line_search_text (window->buffer, ptr_line))
+                ptr_line = (window->scroll->start_line) ?
+                    gui_line_get_next_displayed (window->scroll->start_line) :
+                    gui_line_get_first_displayed (window->buffer);
+                while (ptr_line
+                       && !gui_line_search_text (window->buffer, ptr_line))
                 {
-                    window->scroll->start_line = ptr_line;
-                    window->scroll->start_line_pos = 0;
-                    window->scroll->first_line_displayed =
-                        (window->scroll->start_line == window->buffer->lines->first_line);
-                    gui_buffer_ask_chat_refresh (window->buffer, 2);
-                    return 1;
+                    ptr_line = gui_line_get_next_displayed (ptr_line);
                 }
-                ptr_line = gui_line_get_next_displayed (ptr_line);
+            }
+            if (ptr_line)
+            {
+                window->scroll->start_line = ptr_line;
+                window->scroll->start_line_pos = 0;
+                window->scroll->first_line_displayed =
+                    (window->scroll->start_line == window->buffer->lines->first_line);
+                gui_buffer_ask_chat_refresh (window->buffer, 2);
+                return 1;
             }
         }
     }
@@ -2029,6 +2208,7 @@ gui_window_print_log ()
         log_printf ("  coords_size . . . . : %d",    ptr_window->coords_size);
         log_printf ("  coords. . . . . . . : 0x%lx", ptr_window->coords);
         log_printf ("  coords_x_message. . : %d",    ptr_window->coords_x_message);
+        log_printf ("  lines_layout. . . . : 0x%lx", ptr_window->lines_layout);
         log_printf ("  ptr_tree. . . . . . : 0x%lx", ptr_window->ptr_tree);
         log_printf ("  prev_window . . . . : 0x%lx", ptr_window->prev_window);
         log_printf ("  next_window . . . . : 0x%lx", ptr_window->next_window);
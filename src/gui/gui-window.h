@@ -20,9 +20,11 @@
 #ifndef WEECHAT_GUI_WINDOW_H
 #define WEECHAT_GUI_WINDOW_H 1
 
+struct t_hashtable;
 struct t_infolist;
 struct t_gui_bar_window;
 struct t_gui_line_data;
+struct t_gui_lines;
 
 /* window structures */
 
@@ -35,6 +37,19 @@ struct t_gui_window_coords
     int prefix_x1, prefix_x2;          /* start/end of prefix on screen     */
 };
 
+struct t_gui_window_lines_layout
+{
+    struct t_hashtable *lines;         /* number of lines on screen for     */
+                                       /* each line (key: pointer to data)  */
+    int generation;                    /* generation of layout (cache is    */
+                                       /* cleared if global one changed)    */
+    int width;                         /* width of chat area used           */
+    struct t_gui_lines *buffer_lines;  /* lines displayed (own/mixed)       */
+    int prefix_max_length;             /* max length of prefix used         */
+    int buffer_max_length;             /* max length of buffer name used    */
+    int time_for_each_line;            /* time displayed for each line?     */
+};
+
 struct t_gui_window
 {
     int number;                        /* window number (first is 1)        */
@@ -78,6 +93,10 @@ struct t_gui_window
     struct t_gui_window_coords *coords;/* coords for window                 */
     int coords_x_message;              /* start X for messages              */
 
+    /* layout of lines (cache) */
+    struct t_gui_window_lines_layout *lines_layout; /* number of lines on   */
+                                       /* screen for lines already computed */
+
     /* tree */
     struct t_gui_window_tree *ptr_tree;/* pointer to leaf in windows tree   */
 
@@ -120,6 +139,7 @@ struct t_gui_window_tree
 
 extern int gui_init_ok;
 extern int gui_window_refresh_needed;
+extern int gui_window_lines_layout_generation;
 extern struct t_gui_window *gui_windows;
 extern struct t_gui_window *last_gui_window;
 extern struct t_gui_window *gui_current_window;
@@ -174,6 +194,18 @@ extern void gui_window_coords_remove_line (struct t_gui_window *window,
 extern void gui_window_coords_remove_line_data (struct t_gui_window *window,
                                                 struct t_gui_line_data *line_data);
 extern void gui_window_coords_alloc (struct t_gui_window *window);
+extern int gui_window_lines_layout_check (struct t_gui_window *window,
+                                          int width);
+extern int gui_window_lines_layout_get (struct t_gui_window *window,
+                                        struct t_gui_line_data *line_data,
+                                        int width);
+extern void gui_window_lines_layout_set (struct t_gui_window *window,
+                                         struct t_gui_line_data *line_data,
+                                         int width, int num_lines);
+extern void gui_window_lines_layout_remove (struct t_gui_window *window,
+                                            struct t_gui_line_data *line_data);
+extern void gui_window_lines_layout_invalidate ();
+extern void gui_window_lines_layout_free (struct t_gui_window *window);
 extern void gui_window_free (struct t_gui_window *window);
 extern void gui_window_switch_previous (struct t_gui_window *window);
 extern void gui_window_switch_next (struct t_gui_window *window);
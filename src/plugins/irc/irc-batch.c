@@ -0,0 +1,299 @@
+/*
+ * irc-batch.c - batch of messages (IRCv3 "batch" capability) for IRC plugin
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "../weechat-plugin.h"
+#include "irc.h"
+#include "irc-batch.h"
+#include "irc-server.h"
+
+
+/*
+ * Searches for an open batch by reference.
+ *
+ * Returns pointer to batch found, NULL if not found.
+ */
+
+struct t_irc_batch *
+irc_batch_search (struct t_irc_server *server, const char *reference)
+{
+    struct t_irc_batch *ptr_batch;
+
+    if (!server || !reference)
+        return NULL;
+
+    for (ptr_batch = server->batches; ptr_batch;
+         ptr_batch = ptr_batch->next_batch)
+    {
+        if (strcmp (ptr_batch->reference, reference) == 0)
+            return ptr_batch;
+    }
+
+    /* batch not found */
+    return NULL;
+}
+
+/*
+ * Starts a batch (message "BATCH +reference type [parameters]" received).
+ *
+ * If a batch with same reference is already open, it is ended first.
+ *
+ * Returns pointer to new batch, NULL if error.
+ */
+
+struct t_irc_batch *
+irc_batch_start (struct t_irc_server *server, const char *reference,
+                 const char *type, const char *parameters)
+{
+    struct t_irc_batch *new_batch, *ptr_batch;
+
+    if (!server || !reference || !reference[0] || !type)
+        return NULL;
+
+    ptr_batch = irc_batch_search (server, reference);
+    if (ptr_batch)
+        irc_batch_end (server, ptr_batch);
+
+    new_batch = malloc (sizeof (*new_batch));
+    if (!new_batch)
+        return NULL;
+
+    new_batch->reference = strdup (reference);
+    new_batch->type = strdup (type);
+    new_batch->parameters = (parameters && parameters[0]) ?
+        strdup (parameters) : NULL;
+    new_batch->start_time = time (NULL);
+    new_batch->messages_count = 0;
+    new_batch->buffers = weechat_list_new ();
+    new_batch->last_buffer = NULL;
+
+    new_batch->prev_batch = server->last_batch;
+    new_batch->next_batch = NULL;
+    if (server->last_batch)
+        (server->last_batch)->next_batch = new_batch;
+    else
+        server->batches = new_batch;
+    server->last_batch = new_batch;
+
+    return new_batch;
+}
+
+/*
+ * Adds a buffer in a batch: lines are added in batch in this buffer until the
+ * end of the batch (hotlist and refresh of buffer are done only once, at the
+ * end of batch).
+ */
+
+void
+irc_batch_add_buffer (struct t_irc_server *server, struct t_irc_batch *batch,
+                      struct t_gui_buffer *buffer)
+{
+    const char *full_name;
+
+    if (!server || !batch || !buffer || (buffer == batch->last_buffer))
+        return;
+
+    full_name = weechat_buffer_get_string (buffer, "full_name");
+    if (!full_name)
+        return;
+
+    if (!weechat_list_search (batch->buffers, full_name))
+        weechat_list_add (batch->buffers, full_name, WEECHAT_LIST_POS_END, NULL);
+
+    if (!weechat_buffer_get_integer (buffer, "lines_batch"))
+        weechat_buffer_set (buffer, "lines_batch", "1");
+
+    batch->last_buffer = buffer;
+}
+
+/*
+ * Checks if a buffer is used in another open batch of server.
+ *
+ * Returns:
+ *   1: buffer is used in another batch
+ *   0: buffer is not used in another batch
+ */
+
+int
+irc_batch_buffer_used (struct t_irc_server *server, struct t_irc_batch *batch,
+                       const char *full_name)
+{
+    struct t_irc_batch *ptr_batch;
+
+    for (ptr_batch = server->batches; ptr_batch;
+         ptr_batch = ptr_batch->next_batch)
+    {
+        if ((ptr_batch != batch)
+            && weechat_list_search (ptr_batch->buffers, full_name))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Ends a batch (message "BATCH -reference" received): the batch of lines is
+ * ended in all buffers used by this batch (if they are not used by another
+ * batch), then the batch is freed.
+ */
+
+void
+irc_batch_end (struct t_irc_server *server, struct t_irc_batch *batch)
+{
+    struct t_weelist_item *ptr_item;
+    struct t_gui_buffer *ptr_buffer;
+    const char *full_name;
+
+    if (!server || !batch)
+        return;
+
+    /* remove batch from list */
+    if (batch->prev_batch)
+        (batch->prev_batch)->next_batch = batch->next_batch;
+    if (batch->next_batch)
+        (batch->next_batch)->prev_batch = batch->prev_batch;
+    if (server->batches == batch)
+        server->batches = batch->next_batch;
+    if (server->last_batch == batch)
+        server->last_batch = batch->prev_batch;
+
+    /* end batch of lines in buffers */
+    for (ptr_item = weechat_list_get (batch->buffers, 0); ptr_item;
+         ptr_item = weechat_list_next (ptr_item))
+    {
+        full_name = weechat_list_string (ptr_item);
+        if (irc_batch_buffer_used (server, batch, full_name))
+            continue;
+        ptr_buffer = weechat_buffer_search ("==", full_name);
+        if (ptr_buffer)
+            weechat_buffer_set (ptr_buffer, "lines_batch", "0");
+    }
+
+    /* free data */
+    if (batch->reference)
+        free (batch->reference);
+    if (batch->type)
+        free (batch->type);
+    if (batch->parameters)
+        free (batch->parameters);
+    weechat_list_free (batch->buffers);
+
+    free (batch);
+}
+
+/*
+ * Ends all open batches of a server.
+ */
+
+void
+irc_batch_end_all (struct t_irc_server *server)
+{
+    while (server->batches)
+    {
+        irc_batch_end (server, server->batches);
+    }
+}
+
+/*
+ * Ends batches open for more than IRC_BATCH_TIMEOUT seconds (the end of batch
+ * was never received).
+ */
+
+void
+irc_batch_timeout (struct t_irc_server *server)
+{
+    struct t_irc_batch *ptr_batch, *ptr_next_batch;
+    time_t current_time;
+
+    current_time = time (NULL);
+
+    ptr_batch = server->batches;
+    while (ptr_batch)
+    {
+        ptr_next_batch = ptr_batch->next_batch;
+        if (ptr_batch->start_time + IRC_BATCH_TIMEOUT < current_time)
+            irc_batch_end (server, ptr_batch);
+        ptr_batch = ptr_next_batch;
+    }
+}
+
+/*
+ * Returns hdata for batch.
+ */
+
+struct t_hdata *
+irc_batch_hdata_batch_cb (const void *pointer, void *data,
+                          const char *hdata_name)
+{
+    struct t_hdata *hdata;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    hdata = weechat_hdata_new (hdata_name, "prev_batch", "next_batch",
+                               0, 0, NULL, NULL);
+    if (hdata)
+    {
+        WEECHAT_HDATA_VAR(struct t_irc_batch, reference, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, type, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, parameters, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, start_time, TIME, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, messages_count, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, buffers, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, last_buffer, POINTER, 0, NULL, "buffer");
+        WEECHAT_HDATA_VAR(struct t_irc_batch, prev_batch, POINTER, 0, NULL, hdata_name);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, next_batch, POINTER, 0, NULL, hdata_name);
+    }
+    return hdata;
+}
+
+/*
+ * Prints batch infos in WeeChat log file (usually for crash dump).
+ */
+
+void
+irc_batch_print_log (struct t_irc_server *server)
+{
+    struct t_irc_batch *ptr_batch;
+
+    for (ptr_batch = server->batches; ptr_batch;
+         ptr_batch = ptr_batch->next_batch)
+    {
+        weechat_log_printf ("");
+        weechat_log_printf ("  => batch (addr:0x%lx):", ptr_batch);
+        weechat_log_printf ("       reference . . . . . : '%s'",  ptr_batch->reference);
+        weechat_log_printf ("       type. . . . . . . . : '%s'",  ptr_batch->type);
+        weechat_log_printf ("       parameters. . . . . : '%s'",  ptr_batch->parameters);
+        weechat_log_printf ("       start_time. . . . . : %ld",   ptr_batch->start_time);
+        weechat_log_printf ("       messages_count. . . : %d",    ptr_batch->messages_count);
+        weechat_log_printf ("       buffers . . . . . . : 0x%lx", ptr_batch->buffers);
+        weechat_log_printf ("       last_buffer . . . . : 0x%lx", ptr_batch->last_buffer);
+        weechat_log_printf ("       prev_batch. . . . . : 0x%lx", ptr_batch->prev_batch);
+        weechat_log_printf ("       next_batch. . . . . : 0x%lx", ptr_batch->next_batch);
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_IRC_BATCH_H
+#define WEECHAT_IRC_BATCH_H 1
+
+#include <time.h>
+
+#define IRC_BATCH_TIMEOUT 60
+
+struct t_irc_server;
+
+/* batch of messages (IRCv3 "batch" capability) */
+
+struct t_irc_batch
+{
+    char *reference;                /* reference (without "+"/"-")           */
+    char *type;                     /* type (example: "chathistory")         */
+    char *parameters;               /* parameters (can be NULL)              */
+    time_t start_time;              /* time when batch was started           */
+    int messages_count;             /* number of messages in batch           */
+    struct t_weelist *buffers;      /* full name of buffers with lines       */
+                                    /* added in batch                        */
+    struct t_gui_buffer *last_buffer; /* last buffer added in batch         */
+    struct t_irc_batch *prev_batch; /* link to previous batch                */
+    struct t_irc_batch *next_batch; /* link to next batch                    */
+};
+
+extern struct t_irc_batch *irc_batch_search (struct t_irc_server *server,
+                                             const char *reference);
+extern struct t_irc_batch *irc_batch_start (struct t_irc_server *server,
+                                            const char *reference,
+                                            const char *type,
+                                            const char *parameters);
+extern void irc_batch_add_buffer (struct t_irc_server *server,
+                                  struct t_irc_batch *batch,
+                                  struct t_gui_buffer *buffer);
+extern void irc_batch_end (struct t_irc_server *server,
+                           struct t_irc_batch *batch);
+extern void irc_batch_end_all (struct t_irc_server *server);
+extern void irc_batch_timeout (struct t_irc_server *server);
+extern struct t_hdata *irc_batch_hdata_batch_cb (const void *pointer,
+                                                 void *data,
+                                                 const char *hdata_name);
+extern void irc_batch_print_log (struct t_irc_server *server);
+
+#endif /* WEECHAT_IRC_BATCH_H */
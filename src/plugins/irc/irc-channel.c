@@ -475,10 +475,14 @@ irc_channel_new (struct t_irc_server *server, int channel_type,
     new_channel->nicks_count = 0;
     new_channel->nicks = NULL;
     new_channel->last_nick = NULL;
+    new_channel->nicks_index = NULL;
     new_channel->nicks_speaking[0] = NULL;
     new_channel->nicks_speaking[1] = NULL;
+    new_channel->nicks_speaking_index[0] = NULL;
+    new_channel->nicks_speaking_index[1] = NULL;
     new_channel->nicks_speaking_time = NULL;
     new_channel->last_nick_speaking_time = NULL;
+    new_channel->nicks_speaking_time_index = NULL;
     new_channel->join_smart_filtered = NULL;
     new_channel->buffer = ptr_buffer;
     new_channel->buffer_as_string = NULL;
@@ -699,13 +703,15 @@ irc_channel_check_whox (struct t_irc_server *server,
             if (irc_server_get_isupport_value (server, "WHOX"))
             {
                 /* WHOX is supported */
-                irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+                irc_server_sendf (server,
+                                  IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND, NULL,
                                   "WHO %s %%cuhsnfdar", channel->name);
             }
             else
             {
                 /* WHOX is NOT supported */
-                irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+                irc_server_sendf (server,
+                                  IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND, NULL,
                                   "WHO %s", channel->name);
             }
         }
@@ -736,43 +742,174 @@ irc_channel_set_away (struct t_irc_server *server,
     }
 }
 
+/*
+ * Builds the indexes of nicks speaking on a channel (for smart completion and
+ * smart filter).
+ *
+ * If the indexes already exist, they are built again (this must be done if
+ * the casemapping of server has changed).
+ */
+
+void
+irc_channel_nick_speaking_index_build (struct t_irc_server *server,
+                                       struct t_irc_channel *channel)
+{
+    struct t_weelist_item *ptr_item;
+    struct t_irc_channel_speaking *ptr_nick;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        if (channel->nicks_speaking_index[i])
+        {
+            weechat_hashtable_free (channel->nicks_speaking_index[i]);
+            channel->nicks_speaking_index[i] = NULL;
+        }
+        if (channel->nicks_speaking[i])
+        {
+            channel->nicks_speaking_index[i] = irc_nick_index_new (server);
+            if (channel->nicks_speaking_index[i])
+            {
+                for (ptr_item = weechat_list_get (channel->nicks_speaking[i], 0);
+                     ptr_item; ptr_item = weechat_list_next (ptr_item))
+                {
+                    weechat_hashtable_set (channel->nicks_speaking_index[i],
+                                           weechat_list_string (ptr_item),
+                                           ptr_item);
+                }
+            }
+        }
+    }
+
+    if (channel->nicks_speaking_time_index)
+    {
+        weechat_hashtable_free (channel->nicks_speaking_time_index);
+        channel->nicks_speaking_time_index = NULL;
+    }
+    channel->nicks_speaking_time_index = irc_nick_index_new (server);
+    if (channel->nicks_speaking_time_index)
+    {
+        /* add oldest nicks first, so that the most recent one is indexed */
+        for (ptr_nick = channel->last_nick_speaking_time; ptr_nick;
+             ptr_nick = ptr_nick->prev_nick)
+        {
+            weechat_hashtable_set (channel->nicks_speaking_time_index,
+                                   ptr_nick->nick, ptr_nick);
+        }
+    }
+}
+
+/*
+ * Removes an item from a list of nicks speaking (and from its index).
+ */
+
+void
+irc_channel_nick_speaking_remove_item (struct t_irc_channel *channel,
+                                       int highlight,
+                                       struct t_weelist_item *item)
+{
+    const char *ptr_string;
+
+    ptr_string = weechat_list_string (item);
+    if (channel->nicks_speaking_index[highlight] && ptr_string
+        && (weechat_hashtable_get (channel->nicks_speaking_index[highlight],
+                                   ptr_string) == item))
+    {
+        weechat_hashtable_remove (channel->nicks_speaking_index[highlight],
+                                  ptr_string);
+    }
+    weechat_list_remove (channel->nicks_speaking[highlight], item);
+}
+
+/*
+ * Renames an item in a list of nicks speaking (and in its index).
+ */
+
+void
+irc_channel_nick_speaking_set_item (struct t_irc_channel *channel,
+                                    int highlight,
+                                    struct t_weelist_item *item,
+                                    const char *nick_name)
+{
+    struct t_weelist_item *ptr_item;
+    const char *ptr_string;
+
+    ptr_string = weechat_list_string (item);
+    if (ptr_string && (strcmp (ptr_string, nick_name) == 0))
+        return;
+
+    if (channel->nicks_speaking_index[highlight])
+    {
+        if (ptr_string
+            && (weechat_hashtable_get (channel->nicks_speaking_index[highlight],
+                                       ptr_string) == item))
+        {
+            weechat_hashtable_remove (channel->nicks_speaking_index[highlight],
+                                      ptr_string);
+        }
+
+        /* remove another item with new name (nick is only once in list) */
+        ptr_item = weechat_hashtable_get (channel->nicks_speaking_index[highlight],
+                                          nick_name);
+        if (ptr_item && (ptr_item != item))
+            irc_channel_nick_speaking_remove_item (channel, highlight, ptr_item);
+    }
+
+    weechat_list_set (item, nick_name);
+
+    if (channel->nicks_speaking_index[highlight])
+    {
+        weechat_hashtable_set (channel->nicks_speaking_index[highlight],
+                               weechat_list_string (item), item);
+    }
+}
+
 /*
  * Adds a nick speaking on a channel.
  */
 
 void
-irc_channel_nick_speaking_add_to_list (struct t_irc_channel *channel,
+irc_channel_nick_speaking_add_to_list (struct t_irc_server *server,
+                                       struct t_irc_channel *channel,
                                        const char *nick_name,
                                        int highlight)
 {
-    int size, to_remove, i;
     struct t_weelist_item *ptr_item;
 
-    /* create list if it does not exist */
+    /* create list and index if they do not exist */
     if (!channel->nicks_speaking[highlight])
         channel->nicks_speaking[highlight] = weechat_list_new ();
+    if (!channel->nicks_speaking[highlight])
+        return;
+    if (!channel->nicks_speaking_index[highlight])
+    {
+        channel->nicks_speaking_index[highlight] = irc_nick_index_new (server);
+        if (!channel->nicks_speaking_index[highlight])
+            return;
+    }
 
     /* remove item if it was already in list */
-    ptr_item = weechat_list_casesearch (channel->nicks_speaking[highlight],
-                                        nick_name);
+    ptr_item = weechat_hashtable_get (channel->nicks_speaking_index[highlight],
+                                      nick_name);
     if (ptr_item)
-        weechat_list_remove (channel->nicks_speaking[highlight], ptr_item);
+        irc_channel_nick_speaking_remove_item (channel, highlight, ptr_item);
 
     /* add nick in list */
-    weechat_list_add (channel->nicks_speaking[highlight], nick_name,
-                      WEECHAT_LIST_POS_END, NULL);
+    ptr_item = weechat_list_add (channel->nicks_speaking[highlight], nick_name,
+                                 WEECHAT_LIST_POS_END, NULL);
+    if (ptr_item)
+    {
+        weechat_hashtable_set (channel->nicks_speaking_index[highlight],
+                               weechat_list_string (ptr_item), ptr_item);
+    }
 
-    /* reduce list size if it's too big */
-    size = weechat_list_size (channel->nicks_speaking[highlight]);
-    if (size > IRC_CHANNEL_NICKS_SPEAKING_LIMIT)
+    /* reduce list size if it's too big (remove oldest nicks) */
+    while (weechat_list_size (channel->nicks_speaking[highlight]) >
+           IRC_CHANNEL_NICKS_SPEAKING_LIMIT)
     {
-        to_remove = size - IRC_CHANNEL_NICKS_SPEAKING_LIMIT;
-        for (i = 0; i < to_remove; i++)
-        {
-            weechat_list_remove (
-                channel->nicks_speaking[highlight],
-                weechat_list_get (channel->nicks_speaking[highlight], 0));
-        }
+        irc_channel_nick_speaking_remove_item (
+            channel, highlight,
+            weechat_list_get (channel->nicks_speaking[highlight], 0));
     }
 }
 
@@ -781,7 +918,8 @@ irc_channel_nick_speaking_add_to_list (struct t_irc_channel *channel,
  */
 
 void
-irc_channel_nick_speaking_add (struct t_irc_channel *channel,
+irc_channel_nick_speaking_add (struct t_irc_server *server,
+                               struct t_irc_channel *channel,
                                const char *nick_name, int highlight)
 {
     if (highlight < 0)
@@ -789,9 +927,9 @@ irc_channel_nick_speaking_add (struct t_irc_channel *channel,
     if (highlight > 1)
         highlight = 1;
     if (highlight)
-        irc_channel_nick_speaking_add_to_list (channel, nick_name, 1);
+        irc_channel_nick_speaking_add_to_list (server, channel, nick_name, 1);
 
-    irc_channel_nick_speaking_add_to_list (channel, nick_name, 0);
+    irc_channel_nick_speaking_add_to_list (server, channel, nick_name, 0);
 }
 
 /*
@@ -808,18 +946,20 @@ irc_channel_nick_speaking_rename (struct t_irc_channel *channel,
 
     for (i = 0; i < 2; i++)
     {
-        if (channel->nicks_speaking[i])
+        if (channel->nicks_speaking_index[i])
         {
-            ptr_item = weechat_list_search (channel->nicks_speaking[i],
-                                            old_nick);
+            ptr_item = weechat_hashtable_get (channel->nicks_speaking_index[i],
+                                              old_nick);
             if (ptr_item)
-                weechat_list_set (ptr_item, new_nick);
+                irc_channel_nick_speaking_set_item (channel, i, ptr_item,
+                                                    new_nick);
         }
     }
 }
 
 /*
- * Renames a nick speaking on a channel if it is already in list.
+ * Renames a nick speaking on a channel if it is already in list (the nick
+ * name is updated if the case has changed).
  */
 
 void
@@ -827,27 +967,10 @@ irc_channel_nick_speaking_rename_if_present (struct t_irc_server *server,
                                              struct t_irc_channel *channel,
                                              const char *nick_name)
 {
-    struct t_weelist_item *ptr_item;
-    int i, j, list_size;
+    /* make C compiler happy */
+    (void) server;
 
-    for (i = 0; i < 2; i++)
-    {
-        if (channel->nicks_speaking[i])
-        {
-            list_size = weechat_list_size (channel->nicks_speaking[i]);
-            for (j = 0; j < list_size; j++)
-            {
-                ptr_item = weechat_list_get (channel->nicks_speaking[i], j);
-                if (ptr_item
-                    && (irc_server_strcasecmp (server,
-                                               weechat_list_string (ptr_item),
-                                               nick_name) == 0))
-                {
-                    weechat_list_set (ptr_item, nick_name);
-                }
-            }
-        }
-    }
+    irc_channel_nick_speaking_rename (channel, nick_name, nick_name);
 }
 
 /*
@@ -865,22 +988,26 @@ irc_channel_nick_speaking_time_search (struct t_irc_server *server,
     struct t_irc_channel_speaking *ptr_nick;
     time_t time_limit;
 
-    time_limit = time (NULL) -
-        (weechat_config_integer (irc_config_look_smart_filter_delay) * 60);
+    /* make C compiler happy */
+    (void) server;
+
+    if (!channel->nicks_speaking_time_index)
+        return NULL;
 
-    for (ptr_nick = channel->nicks_speaking_time; ptr_nick;
-         ptr_nick = ptr_nick->next_nick)
+    ptr_nick = weechat_hashtable_get (channel->nicks_speaking_time_index,
+                                      nick_name);
+    if (!ptr_nick)
+        return NULL;
+
+    if (check_time)
     {
-        if (irc_server_strcasecmp (server, ptr_nick->nick, nick_name) == 0)
-        {
-            if (check_time && (ptr_nick->time_last_message < time_limit))
-                return NULL;
-            return ptr_nick;
-        }
+        time_limit = time (NULL) -
+            (weechat_config_integer (irc_config_look_smart_filter_delay) * 60);
+        if (ptr_nick->time_last_message < time_limit)
+            return NULL;
     }
 
-    /* nick speaking time not found */
-    return NULL;
+    return ptr_nick;
 }
 
 /*
@@ -894,6 +1021,15 @@ irc_channel_nick_speaking_time_free (struct t_irc_channel *channel,
     if (!channel || !nick_speaking)
         return;
 
+    /* remove nick from index */
+    if (channel->nicks_speaking_time_index && nick_speaking->nick
+        && (weechat_hashtable_get (channel->nicks_speaking_time_index,
+                                   nick_speaking->nick) == nick_speaking))
+    {
+        weechat_hashtable_remove (channel->nicks_speaking_time_index,
+                                  nick_speaking->nick);
+    }
+
     /* free data */
     if (nick_speaking->nick)
         free (nick_speaking->nick);
@@ -927,6 +1063,9 @@ irc_channel_nick_speaking_time_free_all (struct t_irc_channel *channel)
 
 /*
  * Removes old nicks speaking.
+ *
+ * The list is sorted by time (most recent first), so the old nicks are
+ * removed from the end of list.
  */
 
 void
@@ -959,6 +1098,13 @@ irc_channel_nick_speaking_time_add (struct t_irc_server *server,
 {
     struct t_irc_channel_speaking *ptr_nick, *new_nick;
 
+    if (!channel->nicks_speaking_time_index)
+    {
+        channel->nicks_speaking_time_index = irc_nick_index_new (server);
+        if (!channel->nicks_speaking_time_index)
+            return;
+    }
+
     ptr_nick = irc_channel_nick_speaking_time_search (server, channel,
                                                       nick_name, 0);
     if (ptr_nick)
@@ -968,6 +1114,11 @@ irc_channel_nick_speaking_time_add (struct t_irc_server *server,
     if (new_nick)
     {
         new_nick->nick = strdup (nick_name);
+        if (!new_nick->nick)
+        {
+            free (new_nick);
+            return;
+        }
         new_nick->time_last_message = time_last_message;
 
         /* insert nick at beginning of list */
@@ -978,6 +1129,9 @@ irc_channel_nick_speaking_time_add (struct t_irc_server *server,
         else
             channel->last_nick_speaking_time = new_nick;
         channel->nicks_speaking_time = new_nick;
+
+        weechat_hashtable_set (channel->nicks_speaking_time_index,
+                               new_nick->nick, new_nick);
     }
 }
 
@@ -991,7 +1145,7 @@ irc_channel_nick_speaking_time_rename (struct t_irc_server *server,
                                        const char *old_nick,
                                        const char *new_nick)
 {
-    struct t_irc_channel_speaking *ptr_nick;
+    struct t_irc_channel_speaking *ptr_nick, *ptr_nick_new;
 
     if (channel->nicks_speaking_time)
     {
@@ -999,8 +1153,22 @@ irc_channel_nick_speaking_time_rename (struct t_irc_server *server,
                                                           old_nick, 0);
         if (ptr_nick)
         {
+            weechat_hashtable_remove (channel->nicks_speaking_time_index,
+                                      ptr_nick->nick);
+
+            /* remove another nick with new name (nick is only once in list) */
+            ptr_nick_new = irc_channel_nick_speaking_time_search (
+                server, channel, new_nick, 0);
+            if (ptr_nick_new && (ptr_nick_new != ptr_nick))
+                irc_channel_nick_speaking_time_free (channel, ptr_nick_new);
+
             free (ptr_nick->nick);
             ptr_nick->nick = strdup (new_nick);
+            if (ptr_nick->nick)
+            {
+                weechat_hashtable_set (channel->nicks_speaking_time_index,
+                                       ptr_nick->nick, ptr_nick);
+            }
         }
     }
 }
@@ -1409,7 +1577,13 @@ irc_channel_free (struct t_irc_server *server, struct t_irc_channel *channel)
         weechat_list_free (channel->nicks_speaking[0]);
     if (channel->nicks_speaking[1])
         weechat_list_free (channel->nicks_speaking[1]);
+    if (channel->nicks_speaking_index[0])
+        weechat_hashtable_free (channel->nicks_speaking_index[0]);
+    if (channel->nicks_speaking_index[1])
+        weechat_hashtable_free (channel->nicks_speaking_index[1]);
     irc_channel_nick_speaking_time_free_all (channel);
+    if (channel->nicks_speaking_time_index)
+        weechat_hashtable_free (channel->nicks_speaking_time_index);
     if (channel->join_smart_filtered)
         weechat_hashtable_free (channel->join_smart_filtered);
     if (channel->buffer_as_string)
@@ -1472,6 +1646,8 @@ irc_channel_hdata_channel_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
         WEECHAT_HDATA_VAR(struct t_irc_channel, last_nick_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking_index, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking_time_index, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, join_smart_filtered, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, buffer, POINTER, 0, NULL, "buffer");
         WEECHAT_HDATA_VAR(struct t_irc_channel, buffer_as_string, STRING, 0, NULL, NULL);
@@ -1652,10 +1828,14 @@ irc_channel_print_log (struct t_irc_channel *channel)
     weechat_log_printf ("       nicks_count. . . . . . . : %d",    channel->nicks_count);
     weechat_log_printf ("       nicks. . . . . . . . . . : 0x%lx", channel->nicks);
     weechat_log_printf ("       last_nick. . . . . . . . : 0x%lx", channel->last_nick);
+    weechat_log_printf ("       nicks_index. . . . . . . : 0x%lx", channel->nicks_index);
     weechat_log_printf ("       nicks_speaking[0]. . . . : 0x%lx", channel->nicks_speaking[0]);
     weechat_log_printf ("       nicks_speaking[1]. . . . : 0x%lx", channel->nicks_speaking[1]);
     weechat_log_printf ("       nicks_speaking_time. . . : 0x%lx", channel->nicks_speaking_time);
     weechat_log_printf ("       last_nick_speaking_time. : 0x%lx", channel->last_nick_speaking_time);
+    weechat_log_printf ("       nicks_speaking_index[0]. : 0x%lx", channel->nicks_speaking_index[0]);
+    weechat_log_printf ("       nicks_speaking_index[1]. : 0x%lx", channel->nicks_speaking_index[1]);
+    weechat_log_printf ("       nicks_speaking_time_index: 0x%lx", channel->nicks_speaking_time_index);
     weechat_log_printf ("       join_smart_filtered. . . : 0x%lx (hashtable: '%s')",
                         channel->join_smart_filtered,
                         weechat_hashtable_get_string (channel->join_smart_filtered,
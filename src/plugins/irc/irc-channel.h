@@ -65,12 +65,17 @@ struct t_irc_channel
     int nicks_count;                   /* # nicks on channel (0 if pv)      */
     struct t_irc_nick *nicks;          /* nicks on the channel              */
     struct t_irc_nick *last_nick;      /* last nick on the channel          */
+    struct t_hashtable *nicks_index;   /* nicks by name (case insensitive)  */
     struct t_weelist *nicks_speaking[2]; /* for smart completion: first     */
                                        /* list is nick speaking, second is  */
                                        /* speaking to me (highlight)        */
+    struct t_hashtable *nicks_speaking_index[2]; /* items of lists above by */
+                                       /* nick (case insensitive)           */
     struct t_irc_channel_speaking *nicks_speaking_time; /* for smart filter */
                                        /* of join/part/quit messages        */
     struct t_irc_channel_speaking *last_nick_speaking_time;
+    struct t_hashtable *nicks_speaking_time_index; /* nicks speaking time   */
+                                       /* by nick (case insensitive)        */
     struct t_hashtable *join_smart_filtered; /* smart filtered joins        */
     struct t_gui_buffer *buffer;       /* buffer allocated for channel      */
     char *buffer_as_string;            /* used to return buffer info        */
@@ -119,7 +124,10 @@ extern void irc_channel_set_away (struct t_irc_server *server,
                                   struct t_irc_channel *channel,
                                   const char *nick_name,
                                   int is_away);
-extern void irc_channel_nick_speaking_add (struct t_irc_channel *channel,
+extern void irc_channel_nick_speaking_index_build (struct t_irc_server *server,
+                                                   struct t_irc_channel *channel);
+extern void irc_channel_nick_speaking_add (struct t_irc_server *server,
+                                           struct t_irc_channel *channel,
                                            const char *nick_name,
                                            int highlight);
 extern void irc_channel_nick_speaking_rename (struct t_irc_channel *channel,
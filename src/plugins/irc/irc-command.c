@@ -4918,6 +4918,16 @@ irc_command_display_server (struct t_irc_server *server, int with_detail)
                             IRC_COLOR_CHAT_VALUE,
                             weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW]),
                             NG_("second", "seconds", weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW])));
+        /* anti_flood_burst */
+        if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]))
+            weechat_printf (NULL, "  anti_flood_burst . . :   (%d %s)",
+                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST),
+                            NG_("message", "messages", IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST)));
+        else
+            weechat_printf (NULL, "  anti_flood_burst . . : %s%d %s",
+                            IRC_COLOR_CHAT_VALUE,
+                            weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]),
+                            NG_("message", "messages", weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST])));
         /* away_check */
         if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_printf (NULL, "  away_check . . . . . :   (%d %s)",
@@ -5363,7 +5373,7 @@ IRC_COMMAND_CALLBACK(server)
                 strcpy (message, argv_eol[2]);
                 strcat (message, "\r\n");
                 irc_server_msgq_add_buffer (ptr_server, message);
-                irc_server_msgq_flush ();
+                irc_server_msgq_flush (ptr_server);
                 free (message);
             }
         }
@@ -6249,7 +6259,7 @@ irc_command_init ()
            "Without argument, \"ls\" and \"list\" are sent.\n"
            "\n"
            "Capabilities supported by WeeChat are: "
-           "account-notify, away-notify, cap-notify, extended-join, "
+           "account-notify, away-notify, batch, cap-notify, extended-join, "
            "multi-prefix, server-time, userhost-in-names.\n"
            "\n"
            "The capabilities to automatically enable on servers can be set "
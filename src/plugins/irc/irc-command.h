@@ -51,7 +51,7 @@ struct t_irc_channel;
 
 /* list of supported capabilities (for completion in command /cap) */
 #define IRC_COMMAND_CAP_SUPPORTED_COMPLETION \
-    "account-notify|away-notify|cap-notify|extended-join|"              \
+    "account-notify|away-notify|batch|cap-notify|extended-join|"        \
     "multi-prefix|server-time|userhost-in-names|%*"
 
 /* list of supported CTCPs (for completion in command /ctcp) */
@@ -273,16 +273,15 @@ irc_completion_channel_nicks_add_speakers (struct t_gui_completion *completion,
                                            struct t_irc_channel *channel,
                                            int highlight)
 {
-    int list_size, i;
+    struct t_weelist_item *ptr_item;
     const char *nick;
 
     if (channel->nicks_speaking[highlight])
     {
-        list_size = weechat_list_size (channel->nicks_speaking[highlight]);
-        for (i = 0; i < list_size; i++)
+        for (ptr_item = weechat_list_get (channel->nicks_speaking[highlight], 0);
+             ptr_item; ptr_item = weechat_list_next (ptr_item))
         {
-            nick = weechat_list_string (
-                weechat_list_get (channel->nicks_speaking[highlight], i));
+            nick = weechat_list_string (ptr_item);
             if (nick && irc_nick_search (server, channel, nick))
             {
                 weechat_hook_completion_list_add (completion,
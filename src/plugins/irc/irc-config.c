@@ -2121,8 +2121,9 @@ irc_config_server_new_option (struct t_config_file *config_file,
                 config_file, section,
                 option_name, "integer",
                 N_("anti-flood for high priority queue: number of seconds "
-                   "between two user messages or commands sent to IRC server "
-                   "(0 = no anti-flood)"),
+                   "to get one more message allowed in the burst of messages "
+                   "sent to IRC server (user messages or commands), see "
+                   "option anti_flood_burst (0 = no anti-flood)"),
                 NULL, 0, 60,
                 default_value, value,
                 null_value_allowed,
@@ -2138,9 +2139,10 @@ irc_config_server_new_option (struct t_config_file *config_file,
             new_option = weechat_config_new_option (
                 config_file, section,
                 option_name, "integer",
-                N_("anti-flood for low priority queue: number of seconds "
-                   "between two messages sent to IRC server (messages like "
-                   "automatic CTCP replies) (0 = no anti-flood)"),
+                N_("anti-flood for low priority and background queues: "
+                   "number of seconds between two messages of the same queue "
+                   "sent to IRC server (messages like automatic CTCP replies, "
+                   "away check and notify) (0 = no anti-flood)"),
                 NULL, 0, 60,
                 default_value, value,
                 null_value_allowed,
@@ -2152,6 +2154,25 @@ irc_config_server_new_option (struct t_config_file *config_file,
                 callback_change_data,
                 NULL, NULL, NULL);
             break;
+        case IRC_SERVER_OPTION_ANTI_FLOOD_BURST:
+            new_option = weechat_config_new_option (
+                config_file, section,
+                option_name, "integer",
+                N_("anti-flood: number of messages that can be sent to IRC "
+                   "server in a burst, before messages are delayed (one more "
+                   "message is allowed every \"anti_flood_prio_high\" "
+                   "seconds)"),
+                NULL, 1, 100,
+                default_value, value,
+                null_value_allowed,
+                callback_check_value,
+                callback_check_value_pointer,
+                callback_check_value_data,
+                callback_change,
+                callback_change_pointer,
+                callback_change_data,
+                NULL, NULL, NULL);
+            break;
         case IRC_SERVER_OPTION_AWAY_CHECK:
             new_option = weechat_config_new_option (
                 config_file, section,
@@ -33,6 +33,13 @@
 struct t_irc_ignore *irc_ignore_list = NULL; /* list of ignore              */
 struct t_irc_ignore *last_irc_ignore = NULL; /* last ignore in list         */
 
+/* ignores compiled for a fast check of messages */
+struct t_irc_ignore_server *irc_ignore_servers = NULL; /* ignores by server */
+struct t_irc_ignore **irc_ignore_unindexed = NULL; /* ignores not compiled  */
+int irc_ignore_unindexed_count = 0;    /* number of ignores not compiled    */
+int irc_ignore_compile_status = 0;     /* 0: ignores must be compiled,      */
+                                       /* 1: compiled, -1: compile error    */
+
 
 /*
  * Checks if an ignore pointer is valid.
@@ -158,14 +165,675 @@ irc_ignore_new (const char *mask, const char *server, const char *channel)
             irc_ignore_list = new_ignore;
         last_irc_ignore = new_ignore;
         new_ignore->next_ignore = NULL;
+
+        irc_ignore_compile_status = 0;
     }
 
     return new_ignore;
 }
 
+/*
+ * Creates a new matcher (compiled ignores for a server and channel).
+ *
+ * Returns pointer to new matcher, NULL if error.
+ */
+
+struct t_irc_ignore_matcher *
+irc_ignore_matcher_new ()
+{
+    struct t_irc_ignore_matcher *new_matcher;
+    int i;
+
+    new_matcher = malloc (sizeof (*new_matcher));
+    if (!new_matcher)
+        return NULL;
+
+    new_matcher->literals = NULL;
+    for (i = 0; i < IRC_IGNORE_NUM_REGEX; i++)
+    {
+        new_matcher->regex_str[i] = NULL;
+        new_matcher->regex[i] = NULL;
+    }
+
+    return new_matcher;
+}
+
+/*
+ * Adds an ignore in a matcher: a literal mask is added in the hashtable of
+ * literals, a regex is added to the merged regex (in slot "regex_slot"),
+ * which is compiled later by function irc_ignore_matcher_compile.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_ignore_matcher_add (struct t_irc_ignore_matcher *matcher,
+                        struct t_irc_ignore *ignore,
+                        const char *literal,
+                        const char *regex, int regex_slot)
+{
+    if (literal)
+    {
+        if (!matcher->literals)
+        {
+            matcher->literals = weechat_hashtable_new (
+                32,
+                WEECHAT_HASHTABLE_STRING,
+                WEECHAT_HASHTABLE_POINTER,
+                NULL, NULL);
+            if (!matcher->literals)
+                return 0;
+        }
+        return (weechat_hashtable_set (matcher->literals,
+                                       literal, ignore)) ? 1 : 0;
+    }
+
+    if (!matcher->regex_str[regex_slot])
+    {
+        matcher->regex_str[regex_slot] = weechat_string_dyn_alloc (256);
+        if (!matcher->regex_str[regex_slot])
+            return 0;
+    }
+    else
+    {
+        weechat_string_dyn_concat (matcher->regex_str[regex_slot], "|");
+    }
+    weechat_string_dyn_concat (matcher->regex_str[regex_slot], "(");
+    weechat_string_dyn_concat (matcher->regex_str[regex_slot], regex);
+    return weechat_string_dyn_concat (matcher->regex_str[regex_slot], ")");
+}
+
+/*
+ * Compiles merged regex of a matcher.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_ignore_matcher_compile (struct t_irc_ignore_matcher *matcher)
+{
+    int i, rc;
+
+    rc = 1;
+
+    for (i = 0; i < IRC_IGNORE_NUM_REGEX; i++)
+    {
+        if (!matcher->regex_str[i])
+            continue;
+        matcher->regex[i] = malloc (sizeof (*matcher->regex[i]));
+        if (matcher->regex[i])
+        {
+            if (regcomp (matcher->regex[i], *(matcher->regex_str[i]),
+                         REG_EXTENDED | REG_NOSUB
+                         | ((i & IRC_IGNORE_REGEX_CASE_SENSITIVE) ?
+                            0 : REG_ICASE)) != 0)
+            {
+                free (matcher->regex[i]);
+                matcher->regex[i] = NULL;
+                rc = 0;
+            }
+        }
+        else
+        {
+            rc = 0;
+        }
+        weechat_string_dyn_free (matcher->regex_str[i], 1);
+        matcher->regex_str[i] = NULL;
+    }
+
+    return rc;
+}
+
+/*
+ * Checks if nick or host matches an ignore compiled in a matcher.
+ *
+ * Arguments "nick_lower", "host_lower" and "user_host_lower" are the nick,
+ * host and host without nick ("user@host"), with ASCII chars in lower case
+ * (for search in literal masks).
+ *
+ * Returns:
+ *   1: nick or host matches an ignore
+ *   0: no ignore matches
+ */
+
+int
+irc_ignore_matcher_match (struct t_irc_ignore_matcher *matcher,
+                          const char *nick, const char *host,
+                          const char *user_host,
+                          const char *nick_lower, const char *host_lower,
+                          const char *user_host_lower)
+{
+    struct t_irc_ignore *ptr_ignore;
+    int i;
+
+    if (!matcher)
+        return 0;
+
+    if (matcher->literals)
+    {
+        if (nick_lower
+            && weechat_hashtable_has_key (matcher->literals, nick_lower))
+            return 1;
+        if (host_lower
+            && weechat_hashtable_has_key (matcher->literals, host_lower))
+            return 1;
+        if (user_host_lower)
+        {
+            ptr_ignore = weechat_hashtable_get (matcher->literals,
+                                                user_host_lower);
+            if (ptr_ignore && !strchr (ptr_ignore->mask, '!'))
+                return 1;
+        }
+    }
+
+    for (i = 0; i < IRC_IGNORE_NUM_REGEX; i++)
+    {
+        if (!matcher->regex[i])
+            continue;
+        if (nick && (regexec (matcher->regex[i], nick, 0, NULL, 0) == 0))
+            return 1;
+        if (host && (regexec (matcher->regex[i], host, 0, NULL, 0) == 0))
+            return 1;
+        if (user_host && !(i & IRC_IGNORE_REGEX_WITH_NICK)
+            && (regexec (matcher->regex[i], user_host, 0, NULL, 0) == 0))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Frees a matcher.
+ */
+
+void
+irc_ignore_matcher_free (struct t_irc_ignore_matcher *matcher)
+{
+    int i;
+
+    if (!matcher)
+        return;
+
+    if (matcher->literals)
+        weechat_hashtable_free (matcher->literals);
+    for (i = 0; i < IRC_IGNORE_NUM_REGEX; i++)
+    {
+        if (matcher->regex_str[i])
+            weechat_string_dyn_free (matcher->regex_str[i], 1);
+        if (matcher->regex[i])
+        {
+            regfree (matcher->regex[i]);
+            free (matcher->regex[i]);
+        }
+    }
+
+    free (matcher);
+}
+
+/*
+ * Callback called for each matcher in hashtable of channels (compiles the
+ * matcher).
+ */
+
+void
+irc_ignore_compile_channel_map_cb (void *data,
+                                   struct t_hashtable *hashtable,
+                                   const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    if (!irc_ignore_matcher_compile ((struct t_irc_ignore_matcher *)value))
+        *((int *)data) = 0;
+}
+
+/*
+ * Callback called to free a matcher in hashtable of channels.
+ */
+
+void
+irc_ignore_compile_channel_free_cb (struct t_hashtable *hashtable,
+                                    const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    irc_ignore_matcher_free ((struct t_irc_ignore_matcher *)value);
+}
+
+/*
+ * Checks if a string contains only ASCII chars.
+ *
+ * Returns:
+ *   1: string has only ASCII chars
+ *   0: string has at least one non-ASCII char
+ */
+
+int
+irc_ignore_string_is_ascii (const char *string)
+{
+    while (string[0])
+    {
+        if ((unsigned char)string[0] >= 0x80)
+            return 0;
+        string++;
+    }
+    return 1;
+}
+
+/*
+ * Returns a copy of string with ASCII chars in lower case: the buffer is
+ * used if string is short enough, otherwise a new string is allocated.
+ *
+ * Note: result must be freed after use if it's not the buffer.
+ */
+
+char *
+irc_ignore_string_lower (const char *string, char *buffer, int size)
+{
+    char *result;
+    int length;
+
+    if (!string)
+        return NULL;
+
+    length = strlen (string);
+    if (length < size)
+    {
+        memcpy (buffer, string, length + 1);
+        result = buffer;
+    }
+    else
+    {
+        result = strdup (string);
+        if (!result)
+            return NULL;
+    }
+    weechat_string_tolower (result);
+
+    return result;
+}
+
+/*
+ * Gets the literal string of an ignore, if the regex of mask is a literal
+ * string (like "^nick!user@host$", with escaped special chars).
+ *
+ * Returns literal string in lower case, NULL if the regex is not a literal
+ * string.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_ignore_mask_literal (const char *regex)
+{
+    const char *ptr_regex;
+    char *literal, *ptr_literal;
+    int length;
+
+    length = strlen (regex);
+    if ((length < 2) || (regex[0] != '^') || (regex[length - 1] != '$')
+        || !irc_ignore_string_is_ascii (regex))
+    {
+        return NULL;
+    }
+
+    literal = malloc (length);
+    if (!literal)
+        return NULL;
+
+    ptr_literal = literal;
+    for (ptr_regex = regex + 1; ptr_regex < regex + length - 1; ptr_regex++)
+    {
+        if (ptr_regex[0] == '\\')
+        {
+            /* escaped special char (other escapes are not literal) */
+            if (!ptr_regex[1] || (ptr_regex + 1 >= regex + length - 1)
+                || !strchr (IRC_IGNORE_REGEX_SPECIAL_CHARS, ptr_regex[1]))
+            {
+                free (literal);
+                return NULL;
+            }
+            ptr_regex++;
+        }
+        else if (strchr (IRC_IGNORE_REGEX_SPECIAL_CHARS "*", ptr_regex[0]))
+        {
+            free (literal);
+            return NULL;
+        }
+        ptr_literal[0] = ptr_regex[0];
+        ptr_literal++;
+    }
+    ptr_literal[0] = '\0';
+
+    weechat_string_tolower (literal);
+
+    return literal;
+}
+
+/*
+ * Adds an ignore in the list of ignores that are not compiled (checked one by
+ * one).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_ignore_compile_add_unindexed (struct t_irc_ignore *ignore)
+{
+    struct t_irc_ignore **new_unindexed;
+
+    new_unindexed = realloc (irc_ignore_unindexed,
+                             (irc_ignore_unindexed_count + 1) *
+                             sizeof (irc_ignore_unindexed[0]));
+    if (!new_unindexed)
+        return 0;
+
+    irc_ignore_unindexed = new_unindexed;
+    irc_ignore_unindexed[irc_ignore_unindexed_count] = ignore;
+    irc_ignore_unindexed_count++;
+
+    return 1;
+}
+
+/*
+ * Searches compiled ignores for a server (exact name, case insensitive),
+ * and creates them if not found.
+ *
+ * Returns pointer to compiled ignores for server, NULL if error.
+ */
+
+struct t_irc_ignore_server *
+irc_ignore_compile_get_server (const char *server)
+{
+    struct t_irc_ignore_server *ptr_server;
+
+    for (ptr_server = irc_ignore_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if (weechat_strcasecmp (ptr_server->server, server) == 0)
+            return ptr_server;
+    }
+
+    ptr_server = malloc (sizeof (*ptr_server));
+    if (!ptr_server)
+        return NULL;
+
+    ptr_server->server = strdup (server);
+    ptr_server->all = irc_ignore_matcher_new ();
+    ptr_server->any_channel = irc_ignore_matcher_new ();
+    ptr_server->channels = weechat_hashtable_new (32,
+                                                  WEECHAT_HASHTABLE_STRING,
+                                                  WEECHAT_HASHTABLE_POINTER,
+                                                  NULL, NULL);
+    if (ptr_server->channels)
+    {
+        weechat_hashtable_set_pointer (ptr_server->channels,
+                                       "callback_free_value",
+                                       &irc_ignore_compile_channel_free_cb);
+    }
+    ptr_server->next_server = irc_ignore_servers;
+    irc_ignore_servers = ptr_server;
+
+    if (!ptr_server->server || !ptr_server->all || !ptr_server->any_channel
+        || !ptr_server->channels)
+    {
+        return NULL;
+    }
+
+    return ptr_server;
+}
+
+/*
+ * Frees compiled ignores (they will be compiled again on next check of a
+ * message).
+ */
+
+void
+irc_ignore_compile_free ()
+{
+    struct t_irc_ignore_server *ptr_next_server;
+
+    while (irc_ignore_servers)
+    {
+        ptr_next_server = irc_ignore_servers->next_server;
+        if (irc_ignore_servers->server)
+            free (irc_ignore_servers->server);
+        irc_ignore_matcher_free (irc_ignore_servers->all);
+        irc_ignore_matcher_free (irc_ignore_servers->any_channel);
+        if (irc_ignore_servers->channels)
+            weechat_hashtable_free (irc_ignore_servers->channels);
+        free (irc_ignore_servers);
+        irc_ignore_servers = ptr_next_server;
+    }
+
+    if (irc_ignore_unindexed)
+    {
+        free (irc_ignore_unindexed);
+        irc_ignore_unindexed = NULL;
+    }
+    irc_ignore_unindexed_count = 0;
+
+    irc_ignore_compile_status = 0;
+}
+
+/*
+ * Compiles an ignore: it is added in compiled ignores of its server (and
+ * channel), or in the list of ignores checked one by one if it can not be
+ * compiled.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_ignore_compile_ignore (struct t_irc_ignore *ignore)
+{
+    struct t_irc_ignore_server *ptr_server;
+    struct t_irc_ignore_matcher *ptr_matcher;
+    const char *ptr_regex;
+    char *literal, *channel;
+    int flags, regex_slot, rc;
+
+    /*
+     * only regex with default flags are compiled (other flags like
+     * "(?-e)" can not be merged), and channel must be ASCII (for the
+     * hashtable of channels)
+     */
+    ptr_regex = weechat_string_regex_flags (ignore->mask,
+                                            REG_EXTENDED | REG_ICASE | REG_NOSUB,
+                                            &flags);
+    if (!ptr_regex
+        || ((flags != (REG_EXTENDED | REG_ICASE | REG_NOSUB))
+            && (flags != (REG_EXTENDED | REG_NOSUB)))
+        || ((strcmp (ignore->channel, "*") != 0)
+            && !irc_ignore_string_is_ascii (ignore->channel)))
+    {
+        return irc_ignore_compile_add_unindexed (ignore);
+    }
+
+    /* regex with back-references can not be merged with other regex */
+    if (strstr (ptr_regex, "\\1") || strstr (ptr_regex, "\\2")
+        || strstr (ptr_regex, "\\3") || strstr (ptr_regex, "\\4")
+        || strstr (ptr_regex, "\\5") || strstr (ptr_regex, "\\6")
+        || strstr (ptr_regex, "\\7") || strstr (ptr_regex, "\\8")
+        || strstr (ptr_regex, "\\9"))
+    {
+        return irc_ignore_compile_add_unindexed (ignore);
+    }
+
+    ptr_server = irc_ignore_compile_get_server (ignore->server);
+    if (!ptr_server)
+        return 0;
+
+    literal = (flags & REG_ICASE) ? irc_ignore_mask_literal (ptr_regex) : NULL;
+    regex_slot = ((flags & REG_ICASE) ? 0 : IRC_IGNORE_REGEX_CASE_SENSITIVE)
+        | ((strchr (ignore->mask, '!')) ? IRC_IGNORE_REGEX_WITH_NICK : 0);
+
+    rc = irc_ignore_matcher_add (ptr_server->all, ignore, literal,
+                                 ptr_regex, regex_slot);
+
+    if (strcmp (ignore->channel, "*") == 0)
+    {
+        ptr_matcher = ptr_server->any_channel;
+    }
+    else
+    {
+        channel = strdup (ignore->channel);
+        if (!channel)
+        {
+            ptr_matcher = NULL;
+        }
+        else
+        {
+            weechat_string_tolower (channel);
+            ptr_matcher = weechat_hashtable_get (ptr_server->channels, channel);
+            if (!ptr_matcher)
+            {
+                ptr_matcher = irc_ignore_matcher_new ();
+                if (ptr_matcher)
+                {
+                    weechat_hashtable_set (ptr_server->channels,
+                                           channel, ptr_matcher);
+                }
+            }
+            free (channel);
+        }
+    }
+    if (!ptr_matcher
+        || !irc_ignore_matcher_add (ptr_matcher, ignore, literal,
+                                    ptr_regex, regex_slot))
+    {
+        rc = 0;
+    }
+
+    if (literal)
+        free (literal);
+
+    return rc;
+}
+
+/*
+ * Compiles all ignores: they are grouped by server and channel, literal masks
+ * are in hashtables and other masks are merged in a few regex, so that the
+ * time to check a message does not depend on the number of ignores.
+ *
+ * If an error occurs, ignores will be checked one by one.
+ */
+
+void
+irc_ignore_compile ()
+{
+    struct t_irc_ignore *ptr_ignore;
+    struct t_irc_ignore_server *ptr_server;
+    int rc;
+
+    irc_ignore_compile_free ();
+
+    rc = 1;
+
+    for (ptr_ignore = irc_ignore_list; ptr_ignore;
+         ptr_ignore = ptr_ignore->next_ignore)
+    {
+        if (!irc_ignore_compile_ignore (ptr_ignore))
+        {
+            rc = 0;
+            break;
+        }
+    }
+
+    for (ptr_server = irc_ignore_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if (!irc_ignore_matcher_compile (ptr_server->all)
+            || !irc_ignore_matcher_compile (ptr_server->any_channel))
+        {
+            rc = 0;
+        }
+        weechat_hashtable_map (ptr_server->channels,
+                               &irc_ignore_compile_channel_map_cb, &rc);
+    }
+
+    irc_ignore_compile_status = (rc) ? 1 : -1;
+}
+
+/*
+ * Checks if a message (from an IRC server) is ignored by an ignore.
+ *
+ * Returns:
+ *   1: message is ignored by this ignore
+ *   0: message is not ignored by this ignore
+ */
+
+int
+irc_ignore_check_ignore (struct t_irc_ignore *ignore,
+                         struct t_irc_server *server, const char *channel,
+                         const char *nick, const char *host)
+{
+    int server_match, channel_match;
+    char *pos;
+
+    if (strcmp (ignore->server, "*") == 0)
+        server_match = 1;
+    else
+        server_match = (weechat_strcasecmp (ignore->server,
+                                            server->name) == 0);
+
+    channel_match = 0;
+    if (!channel || (strcmp (ignore->channel, "*") == 0))
+        channel_match = 1;
+    else
+    {
+        if (irc_channel_is_channel (server, channel))
+        {
+            channel_match = (weechat_strcasecmp (ignore->channel,
+                                                 channel) == 0);
+        }
+        else if (nick)
+        {
+            channel_match = (weechat_strcasecmp (ignore->channel,
+                                                 nick) == 0);
+        }
+    }
+
+    if (server_match && channel_match)
+    {
+        if (nick && (regexec (ignore->regex_mask, nick, 0, NULL, 0) == 0))
+            return 1;
+        if (host)
+        {
+            if (regexec (ignore->regex_mask, host, 0, NULL, 0) == 0)
+                return 1;
+            if (!strchr (ignore->mask, '!'))
+            {
+                pos = strchr (host, '!');
+                if (pos && (regexec (ignore->regex_mask, pos + 1,
+                                     0, NULL, 0) == 0))
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Checks if a message (from an IRC server) should be ignored or not.
  *
+ * Ignores are compiled (see function irc_ignore_compile) on first call after
+ * any change in ignores.
+ *
  * Returns:
  *   1: message must be ignored
  *   0: message must not be ignored
@@ -176,10 +844,13 @@ irc_ignore_check (struct t_irc_server *server, const char *channel,
                   const char *nick, const char *host)
 {
     struct t_irc_ignore *ptr_ignore;
-    int server_match, channel_match;
-    char *pos;
+    struct t_irc_ignore_server *ptr_server;
+    const char *user_host, *ptr_key;
+    char str_nick[128], str_host[512], str_key[256];
+    char *nick_lower, *host_lower, *user_host_lower, *key_lower;
+    int i, rc;
 
-    if (!server)
+    if (!server || !irc_ignore_list)
         return 0;
 
     /*
@@ -192,54 +863,106 @@ irc_ignore_check (struct t_irc_server *server, const char *channel,
         return 0;
     }
 
-    for (ptr_ignore = irc_ignore_list; ptr_ignore;
-         ptr_ignore = ptr_ignore->next_ignore)
+    if (irc_ignore_compile_status == 0)
+        irc_ignore_compile ();
+
+    /* compile error: check ignores one by one */
+    if (irc_ignore_compile_status < 0)
     {
-        if (strcmp (ptr_ignore->server, "*") == 0)
-            server_match = 1;
-        else
-            server_match = (weechat_strcasecmp (ptr_ignore->server,
-                                                server->name) == 0);
+        for (ptr_ignore = irc_ignore_list; ptr_ignore;
+             ptr_ignore = ptr_ignore->next_ignore)
+        {
+            if (irc_ignore_check_ignore (ptr_ignore, server, channel,
+                                         nick, host))
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    rc = 0;
 
-        channel_match = 0;
-        if (!channel || (strcmp (ptr_ignore->channel, "*") == 0))
-            channel_match = 1;
+    user_host = (host) ? strchr (host, '!') : NULL;
+    if (user_host)
+        user_host++;
+    nick_lower = irc_ignore_string_lower (nick, str_nick, sizeof (str_nick));
+    host_lower = irc_ignore_string_lower (host, str_host, sizeof (str_host));
+    user_host_lower = (host_lower && user_host) ?
+        host_lower + (user_host - host) : NULL;
+
+    /* key for the hashtable of channels (channel or nick for a private) */
+    ptr_key = NULL;
+    if (channel)
+    {
+        if (irc_channel_is_channel (server, channel))
+            ptr_key = channel;
+        else if (nick)
+            ptr_key = nick;
+    }
+    key_lower = irc_ignore_string_lower (ptr_key, str_key, sizeof (str_key));
+
+    for (ptr_server = irc_ignore_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if ((strcmp (ptr_server->server, "*") != 0)
+            && (weechat_strcasecmp (ptr_server->server, server->name) != 0))
+        {
+            continue;
+        }
+        if (!channel)
+        {
+            /* no channel: all ignores of server are checked */
+            if (irc_ignore_matcher_match (ptr_server->all,
+                                          nick, host, user_host,
+                                          nick_lower, host_lower,
+                                          user_host_lower))
+            {
+                rc = 1;
+                goto end;
+            }
+        }
         else
         {
-            if (irc_channel_is_channel (server, channel))
+            if (irc_ignore_matcher_match (ptr_server->any_channel,
+                                          nick, host, user_host,
+                                          nick_lower, host_lower,
+                                          user_host_lower))
             {
-                channel_match = (weechat_strcasecmp (ptr_ignore->channel,
-                                                     channel) == 0);
+                rc = 1;
+                goto end;
             }
-            else if (nick)
+            if (key_lower
+                && irc_ignore_matcher_match (
+                    weechat_hashtable_get (ptr_server->channels, key_lower),
+                    nick, host, user_host,
+                    nick_lower, host_lower, user_host_lower))
             {
-                channel_match = (weechat_strcasecmp (ptr_ignore->channel,
-                                                     nick) == 0);
+                rc = 1;
+                goto end;
             }
         }
+    }
 
-        if (server_match && channel_match)
+    for (i = 0; i < irc_ignore_unindexed_count; i++)
+    {
+        if (irc_ignore_check_ignore (irc_ignore_unindexed[i], server, channel,
+                                     nick, host))
         {
-            if (nick && (regexec (ptr_ignore->regex_mask, nick, 0, NULL, 0) == 0))
-                return 1;
-            if (host)
-            {
-                if (regexec (ptr_ignore->regex_mask, host, 0, NULL, 0) == 0)
-                    return 1;
-                if (!strchr (ptr_ignore->mask, '!'))
-                {
-                    pos = strchr (host, '!');
-                    if (pos && (regexec (ptr_ignore->regex_mask, pos + 1,
-                                         0, NULL, 0) == 0))
-                    {
-                        return 1;
-                    }
-                }
-            }
+            rc = 1;
+            goto end;
         }
     }
 
-    return 0;
+end:
+    if (nick_lower && (nick_lower != str_nick))
+        free (nick_lower);
+    if (host_lower && (host_lower != str_host))
+        free (host_lower);
+    if (key_lower && (key_lower != str_key))
+        free (key_lower);
+
+    return rc;
 }
 
 /*
@@ -289,6 +1012,8 @@ irc_ignore_free (struct t_irc_ignore *ignore)
 
     free (ignore);
 
+    irc_ignore_compile_free ();
+
     (void) weechat_hook_signal_send ("irc_ignore_removed",
                                      WEECHAT_HOOK_SIGNAL_STRING, NULL);
 }
@@ -22,6 +22,13 @@
 
 #include <regex.h>
 
+/* merged regex in a matcher: case sensitive or not, with nick or not */
+#define IRC_IGNORE_REGEX_CASE_SENSITIVE 1
+#define IRC_IGNORE_REGEX_WITH_NICK      2
+#define IRC_IGNORE_NUM_REGEX            4
+
+#define IRC_IGNORE_REGEX_SPECIAL_CHARS ".[]{}()?+|^$\\"
+
 struct t_irc_server;
 struct t_irc_channel;
 
@@ -36,6 +43,26 @@ struct t_irc_ignore
     struct t_irc_ignore *next_ignore;  /* link to next ignore               */
 };
 
+/* ignores compiled for a server and channel */
+
+struct t_irc_ignore_matcher
+{
+    struct t_hashtable *literals;      /* literal masks (in lower case)     */
+    char **regex_str[IRC_IGNORE_NUM_REGEX]; /* merged regex (when building) */
+    regex_t *regex[IRC_IGNORE_NUM_REGEX];   /* merged regex (compiled)      */
+};
+
+/* ignores compiled for a server */
+
+struct t_irc_ignore_server
+{
+    char *server;                      /* server name ("*" == any server)   */
+    struct t_irc_ignore_matcher *all;  /* all ignores (for any channel)     */
+    struct t_irc_ignore_matcher *any_channel; /* ignores with channel "*"   */
+    struct t_hashtable *channels;      /* ignores by channel (lower case)   */
+    struct t_irc_ignore_server *next_server; /* link to next server         */
+};
+
 extern struct t_irc_ignore *irc_ignore_list;
 
 extern int irc_ignore_valid (struct t_irc_ignore *ignore);
@@ -49,6 +76,8 @@ extern struct t_irc_ignore *irc_ignore_new (const char *mask,
 extern int irc_ignore_check (struct t_irc_server *server,
                              const char *channel, const char *nick,
                              const char *host);
+extern void irc_ignore_compile_free ();
+extern void irc_ignore_compile ();
 extern void irc_ignore_free (struct t_irc_ignore *ignore);
 extern void irc_ignore_free_all ();
 extern struct t_hdata *irc_ignore_hdata_ignore_cb (const void *pointer,
@@ -25,6 +25,7 @@
 
 #include "../weechat-plugin.h"
 #include "irc.h"
+#include "irc-batch.h"
 #include "irc-channel.h"
 #include "irc-color.h"
 #include "irc-config.h"
@@ -954,6 +955,9 @@ irc_info_init ()
     weechat_hook_hdata (
         "irc_channel_speaking", N_("irc channel_speaking"),
         &irc_channel_hdata_channel_speaking_cb, NULL, NULL);
+    weechat_hook_hdata (
+        "irc_batch", N_("irc batch"),
+        &irc_batch_hdata_batch_cb, NULL, NULL);
     weechat_hook_hdata (
         "irc_ignore", N_("irc ignore"),
         &irc_ignore_hdata_ignore_cb, NULL, NULL);
@@ -25,77 +25,66 @@
 
 #include "../weechat-plugin.h"
 #include "irc.h"
+#include "irc-message.h"
 #include "irc-server.h"
 #include "irc-channel.h"
 
 
 /*
- * Parses an IRC message and returns:
- *   - tags (string)
- *   - message without tags (string)
- *   - nick (string)
- *   - host (string)
- *   - command (string)
- *   - channel (string)
- *   - arguments (string)
- *   - text (string)
- *   - pos_command (integer: command index in message)
- *   - pos_arguments (integer: arguments index in message)
- *   - pos_channel (integer: channel index in message)
- *   - pos_text (integer: text index in message)
+ * Sets a field of a parsed message (from "start" to "end", excluded).
+ */
+
+void
+irc_message_span_set (struct t_irc_message_parsed *parsed,
+                      struct t_irc_message_span *span,
+                      const char *start, const char *end)
+{
+    span->pos = start - parsed->message;
+    span->length = (end) ?
+        end - start : parsed->length - span->pos;
+}
+
+/*
+ * Parses an IRC message in a single pass, without any allocation: each field
+ * is a span (position and length) in the message, which is not copied (so the
+ * message must not be modified or freed while the parsed message is used).
+ *
+ * A field not found in message has a position equal to -1.
  *
  * Example:
  *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :hello!
  *
- * Result:
- *               tags: "time=2015-06-27T16:40:35.000Z"
- *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :hello!"
- *               nick: "nick"
- *               host: "nick!user@host"
- *            command: "PRIVMSG"
- *            channel: "#weechat"
- *          arguments: "#weechat :hello!"
- *               text: "hello!"
- *        pos_command: 47
- *      pos_arguments: 55
- *        pos_channel: 55
- *           pos_text: 65
+ * Result (position, length):
+ *               tags: 1, 28   ("time=2015-06-27T16:40:35.000Z")
+ *   msg_without_tags: 31, 41  (":nick!user@host PRIVMSG #weechat :hello!")
+ *               nick: 32, 4   ("nick")
+ *               host: 32, 14  ("nick!user@host")
+ *            command: 47, 7   ("PRIVMSG")
+ *            channel: 55, 8   ("#weechat")
+ *          arguments: 55, 17  ("#weechat :hello!")
+ *               text: 65, 6   ("hello!")
  */
 
 void
-irc_message_parse (struct t_irc_server *server, const char *message,
-                   char **tags, char **message_without_tags, char **nick,
-                   char **host, char **command, char **channel,
-                   char **arguments, char **text,
-                   int *pos_command, int *pos_arguments, int *pos_channel,
-                   int *pos_text)
+irc_message_parse_spans (struct t_irc_server *server, const char *message,
+                         struct t_irc_message_parsed *parsed)
 {
     const char *ptr_message, *pos, *pos2, *pos3, *pos4, *ptr_channel_found;
 
-    if (tags)
-        *tags = NULL;
-    if (message_without_tags)
-        *message_without_tags = NULL;
-    if (nick)
-        *nick = NULL;
-    if (host)
-        *host = NULL;
-    if (command)
-        *command = NULL;
-    if (channel)
-        *channel = NULL;
-    if (arguments)
-        *arguments = NULL;
-    if (text)
-        *text = NULL;
-    if (pos_command)
-        *pos_command = -1;
-    if (pos_arguments)
-        *pos_arguments = -1;
-    if (pos_channel)
-        *pos_channel = -1;
-    if (pos_text)
-        *pos_text = -1;
+    if (!parsed)
+        return;
+
+    parsed->message = message;
+    parsed->length = (message) ? strlen (message) : 0;
+    parsed->tags.pos = -1;
+    parsed->tags.length = 0;
+    parsed->message_without_tags = parsed->tags;
+    parsed->nick = parsed->tags;
+    parsed->host = parsed->tags;
+    parsed->command = parsed->tags;
+    parsed->channel = parsed->tags;
+    parsed->arguments = parsed->tags;
+    parsed->text = parsed->tags;
     ptr_channel_found = NULL;
 
     if (!message)
@@ -119,11 +108,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         pos = strchr (ptr_message, ' ');
         if (pos)
         {
-            if (tags)
-            {
-                *tags = weechat_strndup (ptr_message + 1,
-                                         pos - (ptr_message + 1));
-            }
+            irc_message_span_set (parsed, &parsed->tags, ptr_message + 1, pos);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -132,8 +117,8 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
     }
 
-    if (message_without_tags)
-        *message_without_tags = strdup (ptr_message);
+    irc_message_span_set (parsed, &parsed->message_without_tags,
+                          ptr_message, NULL);
 
     /* now we have: ptr_message --> ":nick!user@host PRIVMSG #weechat :hello!" */
     if (ptr_message[0] == ':')
@@ -146,19 +131,12 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         if (!pos2 || (pos && pos2 > pos))
             pos2 = pos3;
         if (pos2 && (!pos || pos > pos2))
-        {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos2 - (ptr_message + 1));
-        }
+            irc_message_span_set (parsed, &parsed->nick, ptr_message + 1, pos2);
         else if (pos)
-        {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
-        }
+            irc_message_span_set (parsed, &parsed->nick, ptr_message + 1, pos);
         if (pos)
         {
-            if (host)
-                *host = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
+            irc_message_span_set (parsed, &parsed->host, ptr_message + 1, pos);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -167,8 +145,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
         else
         {
-            if (host)
-                *host = strdup (ptr_message + 1);
+            irc_message_span_set (parsed, &parsed->host, ptr_message + 1, NULL);
             ptr_message += strlen (ptr_message);
         }
     }
@@ -179,20 +156,14 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         pos = strchr (ptr_message, ' ');
         if (pos)
         {
-            if (command)
-                *command = weechat_strndup (ptr_message, pos - ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
+            irc_message_span_set (parsed, &parsed->command, ptr_message, pos);
             pos++;
             while (pos[0] == ' ')
             {
                 pos++;
             }
             /* now we have: pos --> "#weechat :hello!" */
-            if (arguments)
-                *arguments = strdup (pos);
-            if (pos_arguments)
-                *pos_arguments = pos - message;
+            irc_message_span_set (parsed, &parsed->arguments, pos, NULL);
             if ((pos[0] == ':')
                 && ((strncmp (ptr_message, "JOIN ", 5) == 0)
                     || (strncmp (ptr_message, "PART ", 5) == 0)))
@@ -201,10 +172,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
             }
             if (pos[0] == ':')
             {
-                if (text)
-                    *text = strdup (pos + 1);
-                if (pos_text)
-                    *pos_text = pos - message + 1;
+                irc_message_span_set (parsed, &parsed->text, pos + 1, NULL);
             }
             else
             {
@@ -212,15 +180,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                 {
                     ptr_channel_found = pos;
                     pos2 = strchr (pos, ' ');
-                    if (channel)
-                    {
-                        if (pos2)
-                            *channel = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *channel = strdup (pos);
-                    }
-                    if (pos_channel)
-                        *pos_channel = pos - message;
+                    irc_message_span_set (parsed, &parsed->channel, pos, pos2);
                     if (pos2)
                     {
                         while (pos2[0] == ' ')
@@ -229,22 +189,14 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                         }
                         if (pos2[0] == ':')
                             pos2++;
-                        if (text)
-                            *text = strdup (pos2);
-                        if (pos_text)
-                            *pos_text = pos2 - message;
+                        irc_message_span_set (parsed, &parsed->text, pos2, NULL);
                     }
                 }
                 else
                 {
                     pos2 = strchr (pos, ' ');
-                    if (nick && !*nick)
-                    {
-                        if (pos2)
-                            *nick = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *nick = strdup (pos);
-                    }
+                    if (parsed->nick.pos < 0)
+                        irc_message_span_set (parsed, &parsed->nick, pos, pos2);
                     if (pos2)
                     {
                         pos3 = pos2;
@@ -257,15 +209,8 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                         {
                             ptr_channel_found = pos2;
                             pos4 = strchr (pos2, ' ');
-                            if (channel)
-                            {
-                                if (pos4)
-                                    *channel = weechat_strndup (pos2, pos4 - pos2);
-                                else
-                                    *channel = strdup (pos2);
-                            }
-                            if (pos_channel)
-                                *pos_channel = pos2 - message;
+                            irc_message_span_set (parsed, &parsed->channel,
+                                                  pos2, pos4);
                             if (pos4)
                             {
                                 while (pos4[0] == ' ')
@@ -274,10 +219,8 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                                 }
                                 if (pos4[0] == ':')
                                     pos4++;
-                                if (text)
-                                    *text = strdup (pos4);
-                                if (pos_text)
-                                    *pos_text = pos4 - message;
+                                irc_message_span_set (parsed, &parsed->text,
+                                                      pos4, NULL);
                             }
                         }
                         else
@@ -286,17 +229,13 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                             {
                                 if (pos[0] == ':')
                                     pos++;
-                                if (text)
-                                    *text = strdup (pos);
-                                if (pos_text)
-                                    *pos_text = pos - message;
+                                irc_message_span_set (parsed, &parsed->text,
+                                                      pos, NULL);
                             }
                             else
                             {
-                                if (channel)
-                                    *channel = weechat_strndup (pos, pos3 - pos);
-                                if (pos_channel)
-                                    *pos_channel = pos - message;
+                                irc_message_span_set (parsed, &parsed->channel,
+                                                      pos, pos3);
                                 pos4 = strchr (pos3, ' ');
                                 if (pos4)
                                 {
@@ -306,10 +245,8 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                                     }
                                     if (pos4[0] == ':')
                                         pos4++;
-                                    if (text)
-                                        *text = strdup (pos4);
-                                    if (pos_text)
-                                        *pos_text = pos4 - message;
+                                    irc_message_span_set (parsed, &parsed->text,
+                                                          pos4, NULL);
                                 }
                             }
                         }
@@ -319,14 +256,233 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
         else
         {
-            if (command)
-                *command = strdup (ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
+            irc_message_span_set (parsed, &parsed->command, ptr_message, NULL);
         }
     }
 }
 
+/*
+ * Returns a copy of a field of a parsed message, NULL if the field was not
+ * found in message.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_message_span_dup (const struct t_irc_message_parsed *parsed,
+                      const struct t_irc_message_span *span)
+{
+    if (!parsed || !parsed->message || !span || (span->pos < 0))
+        return NULL;
+
+    return weechat_strndup (parsed->message + span->pos, span->length);
+}
+
+/*
+ * Copies a field of a parsed message in a buffer (if the field is too long
+ * for the buffer, a new string is allocated).
+ *
+ * Returns pointer to buffer or to a new string (which must then be freed
+ * after use), NULL if the field was not found in message.
+ */
+
+char *
+irc_message_span_get (const struct t_irc_message_parsed *parsed,
+                      const struct t_irc_message_span *span,
+                      char *buffer, int size)
+{
+    if (!parsed || !parsed->message || !span || (span->pos < 0))
+        return NULL;
+
+    if (span->length >= size)
+        return irc_message_span_dup (parsed, span);
+
+    memcpy (buffer, parsed->message + span->pos, span->length);
+    buffer[span->length] = '\0';
+
+    return buffer;
+}
+
+/*
+ * Parses an IRC message and returns:
+ *   - tags (string)
+ *   - message without tags (string)
+ *   - nick (string)
+ *   - host (string)
+ *   - command (string)
+ *   - channel (string)
+ *   - arguments (string)
+ *   - text (string)
+ *   - pos_command (integer: command index in message)
+ *   - pos_arguments (integer: arguments index in message)
+ *   - pos_channel (integer: channel index in message)
+ *   - pos_text (integer: text index in message)
+ *
+ * Example:
+ *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :hello!
+ *
+ * Result:
+ *               tags: "time=2015-06-27T16:40:35.000Z"
+ *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :hello!"
+ *               nick: "nick"
+ *               host: "nick!user@host"
+ *            command: "PRIVMSG"
+ *            channel: "#weechat"
+ *          arguments: "#weechat :hello!"
+ *               text: "hello!"
+ *        pos_command: 47
+ *      pos_arguments: 55
+ *        pos_channel: 55
+ *           pos_text: 65
+ *
+ * Note: strings returned must be freed after use (see function
+ * irc_message_parse_spans to parse a message without any allocation).
+ */
+
+void
+irc_message_parse (struct t_irc_server *server, const char *message,
+                   char **tags, char **message_without_tags, char **nick,
+                   char **host, char **command, char **channel,
+                   char **arguments, char **text,
+                   int *pos_command, int *pos_arguments, int *pos_channel,
+                   int *pos_text)
+{
+    struct t_irc_message_parsed parsed;
+
+    irc_message_parse_spans (server, message, &parsed);
+
+    if (tags)
+        *tags = irc_message_span_dup (&parsed, &parsed.tags);
+    if (message_without_tags)
+    {
+        *message_without_tags = irc_message_span_dup (
+            &parsed, &parsed.message_without_tags);
+    }
+    if (nick)
+        *nick = irc_message_span_dup (&parsed, &parsed.nick);
+    if (host)
+        *host = irc_message_span_dup (&parsed, &parsed.host);
+    if (command)
+        *command = irc_message_span_dup (&parsed, &parsed.command);
+    if (channel)
+        *channel = irc_message_span_dup (&parsed, &parsed.channel);
+    if (arguments)
+        *arguments = irc_message_span_dup (&parsed, &parsed.arguments);
+    if (text)
+        *text = irc_message_span_dup (&parsed, &parsed.text);
+    if (pos_command)
+        *pos_command = parsed.command.pos;
+    if (pos_arguments)
+        *pos_arguments = parsed.arguments.pos;
+    if (pos_channel)
+        *pos_channel = parsed.channel.pos;
+    if (pos_text)
+        *pos_text = parsed.text.pos;
+}
+
+/*
+ * Splits arguments of an IRC message (separated by spaces) and returns an
+ * array of arguments ("argv"), and optionally an array with the end of
+ * message for each argument ("argv_eol"); trailing spaces are kept in
+ * "argv_eol" only if "keep_trailing_spaces" is 1.
+ *
+ * The result is the same as two calls to function weechat_string_split (with
+ * keep_eol set to 0 then 1 or 2), but a single allocation is done for both
+ * arrays and all strings.
+ *
+ * Note: result must be freed after use with a single call to free() (array
+ * "argv_eol" must not be freed).
+ */
+
+char **
+irc_message_split_args (const char *message, int keep_trailing_spaces,
+                        int *argc, char ***argv_eol)
+{
+    const char *ptr_start, *ptr_end, *ptr;
+    char **argv, *ptr_args, *ptr_args_eol, *ptr_arg;
+    int i, num_args, length, length_eol;
+
+    if (argc)
+        *argc = 0;
+    if (argv_eol)
+        *argv_eol = NULL;
+
+    if (!message)
+        return NULL;
+
+    ptr_start = message;
+    while (ptr_start[0] == ' ')
+    {
+        ptr_start++;
+    }
+    length_eol = strlen (ptr_start);
+    ptr_end = ptr_start + length_eol;
+    while ((ptr_end > ptr_start) && (ptr_end[-1] == ' '))
+    {
+        ptr_end--;
+    }
+    length = ptr_end - ptr_start;
+    if (length == 0)
+        return NULL;
+    if (!keep_trailing_spaces)
+        length_eol = length;
+
+    /* count arguments */
+    num_args = 0;
+    ptr = ptr_start;
+    while (ptr < ptr_end)
+    {
+        num_args++;
+        while ((ptr < ptr_end) && (ptr[0] != ' '))
+        {
+            ptr++;
+        }
+        while ((ptr < ptr_end) && (ptr[0] == ' '))
+        {
+            ptr++;
+        }
+    }
+
+    /* arrays "argv" and "argv_eol", then strings */
+    argv = malloc ((2 * (num_args + 1) * sizeof (argv[0]))
+                   + length + 1 + length_eol + 1);
+    if (!argv)
+        return NULL;
+    ptr_args = (char *)(argv + (2 * (num_args + 1)));
+    ptr_args_eol = ptr_args + length + 1;
+    memcpy (ptr_args, ptr_start, length);
+    ptr_args[length] = '\0';
+    memcpy (ptr_args_eol, ptr_start, length_eol);
+    ptr_args_eol[length_eol] = '\0';
+
+    i = 0;
+    ptr_arg = ptr_args;
+    while (ptr_arg[0])
+    {
+        argv[i] = ptr_arg;
+        argv[num_args + 1 + i] = ptr_args_eol + (ptr_arg - ptr_args);
+        i++;
+        while (ptr_arg[0] && (ptr_arg[0] != ' '))
+        {
+            ptr_arg++;
+        }
+        while (ptr_arg[0] == ' ')
+        {
+            ptr_arg[0] = '\0';
+            ptr_arg++;
+        }
+    }
+    argv[num_args] = NULL;
+    argv[(2 * num_args) + 1] = NULL;
+
+    if (argc)
+        *argc = num_args;
+    if (argv_eol)
+        *argv_eol = argv + num_args + 1;
+
+    return argv;
+}
+
 /*
  * Parses an IRC message and returns hashtable with keys:
  *   - tags
@@ -959,6 +1115,27 @@ irc_message_split_005 (struct t_hashtable *hashtable,
                                      NULL, arguments, suffix, ' ', -1);
 }
 
+/*
+ * Returns the max length of host ":nick!user@host " added by server when a
+ * message is sent to other clients (this length is reserved when a message
+ * is split, so that the message received by other clients is not truncated).
+ */
+
+int
+irc_message_max_length_host (struct t_irc_server *server)
+{
+    int max_length_nick;
+
+    max_length_nick = (server && (server->nick_max_length > 0)) ?
+        server->nick_max_length : 16;
+
+    return 1 +            /* ":"  */
+        max_length_nick + /* nick */
+        1 +               /* "!"  */
+        63 +              /* host */
+        1;                /* " "  */
+}
+
 /*
  * Splits an IRC message about to be sent to IRC server.
  *
@@ -989,7 +1166,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
     struct t_hashtable *hashtable;
     char **argv, **argv_eol, *tags, *host, *command, *arguments, target[512];
     char *pos, monitor_action[3];
-    int split_ok, argc, index_args, max_length_nick, max_length_host;
+    int split_ok, argc, index_args, max_length_host;
 
     split_ok = 0;
     tags = NULL;
@@ -1046,13 +1223,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
         index_args = 1;
     }
 
-    max_length_nick = (server && (server->nick_max_length > 0)) ?
-        server->nick_max_length : 16;
-    max_length_host = 1 + /* ":"  */
-        max_length_nick + /* nick */
-        1 +               /* "!"  */
-        63 +              /* host */
-        1;                /* " "  */
+    max_length_host = irc_message_max_length_host (server);
 
     if ((weechat_strcasecmp (command, "ison") == 0)
         || (weechat_strcasecmp (command, "wallops") == 0))
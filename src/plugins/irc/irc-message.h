@@ -23,12 +23,47 @@
 struct t_irc_server;
 struct t_irc_channel;
 
+/* field of a parsed IRC message */
+
+struct t_irc_message_span
+{
+    int pos;                        /* position in message (-1 if not found) */
+    int length;                     /* length of field                       */
+};
+
+/* IRC message parsed (without copy of message) */
+
+struct t_irc_message_parsed
+{
+    const char *message;            /* message parsed (not a copy)           */
+    int length;                     /* length of message                     */
+    struct t_irc_message_span tags; /* tags (IRCv3)                          */
+    struct t_irc_message_span message_without_tags; /* message without tags  */
+    struct t_irc_message_span nick; /* nick                                  */
+    struct t_irc_message_span host; /* host (prefix, without ":")            */
+    struct t_irc_message_span command; /* command                            */
+    struct t_irc_message_span channel; /* channel                            */
+    struct t_irc_message_span arguments; /* arguments (after command)        */
+    struct t_irc_message_span text; /* text                                  */
+};
+
+extern void irc_message_parse_spans (struct t_irc_server *server,
+                                     const char *message,
+                                     struct t_irc_message_parsed *parsed);
+extern char *irc_message_span_dup (const struct t_irc_message_parsed *parsed,
+                                   const struct t_irc_message_span *span);
+extern char *irc_message_span_get (const struct t_irc_message_parsed *parsed,
+                                   const struct t_irc_message_span *span,
+                                   char *buffer, int size);
 extern void irc_message_parse (struct t_irc_server *server, const char *message,
                                char **tags, char **message_without_tags,
                                char **nick, char **host, char **command,
                                char **channel, char **arguments, char **text,
                                int *pos_command, int *pos_arguments,
                                int *pos_channel, int *pos_text);
+extern char **irc_message_split_args (const char *message,
+                                      int keep_trailing_spaces,
+                                      int *argc, char ***argv_eol);
 extern struct t_hashtable *irc_message_parse_to_hashtable (struct t_irc_server *server,
                                                            const char *message);
 extern char *irc_message_convert_charset (const char *message,
@@ -40,6 +75,7 @@ extern const char *irc_message_get_address_from_host (const char *host);
 extern char *irc_message_replace_vars (struct t_irc_server *server,
                                        const char *channel_name,
                                        const char *string);
+extern int irc_message_max_length_host (struct t_irc_server *server);
 extern struct t_hashtable *irc_message_split (struct t_irc_server *server,
                                               const char *message);
 
@@ -35,6 +35,178 @@
 #include "irc-channel.h"
 
 
+/*
+ * Hashes a nick in index of nicks (casemapping "rfc1459").
+ */
+
+unsigned long long
+irc_nick_index_hash_rfc1459_cb (struct t_hashtable *hashtable,
+                                const void *key)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_hashtable_hash_key_string_range ((const char *)key, 30);
+}
+
+/*
+ * Hashes a nick in index of nicks (casemapping "strict-rfc1459").
+ */
+
+unsigned long long
+irc_nick_index_hash_strict_rfc1459_cb (struct t_hashtable *hashtable,
+                                       const void *key)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_hashtable_hash_key_string_range ((const char *)key, 29);
+}
+
+/*
+ * Hashes a nick in index of nicks (casemapping "ascii").
+ */
+
+unsigned long long
+irc_nick_index_hash_ascii_cb (struct t_hashtable *hashtable, const void *key)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_hashtable_hash_key_string_range ((const char *)key, 26);
+}
+
+/*
+ * Compares two nicks in index of nicks (casemapping "rfc1459").
+ */
+
+int
+irc_nick_index_keycmp_rfc1459_cb (struct t_hashtable *hashtable,
+                                  const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_strcasecmp_range ((const char *)key1, (const char *)key2,
+                                     30);
+}
+
+/*
+ * Compares two nicks in index of nicks (casemapping "strict-rfc1459").
+ */
+
+int
+irc_nick_index_keycmp_strict_rfc1459_cb (struct t_hashtable *hashtable,
+                                         const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_strcasecmp_range ((const char *)key1, (const char *)key2,
+                                     29);
+}
+
+/*
+ * Compares two nicks in index of nicks (casemapping "ascii").
+ */
+
+int
+irc_nick_index_keycmp_ascii_cb (struct t_hashtable *hashtable,
+                                const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_strcasecmp ((const char *)key1, (const char *)key2);
+}
+
+/*
+ * Creates a new index of nicks: hashtable with pointer to nick name as key
+ * (hashed and compared like a string, case insensitive according to
+ * casemapping of server), and a pointer as value.
+ *
+ * Note: the names used as keys are not duplicated in hashtable, so the key
+ * must be removed before the name is freed.
+ *
+ * Returns pointer to new hashtable, NULL if error.
+ */
+
+struct t_hashtable *
+irc_nick_index_new (struct t_irc_server *server)
+{
+    unsigned long long (*hash_key_cb[IRC_SERVER_NUM_CASEMAPPING])(struct t_hashtable *hashtable,
+                                                                  const void *key) =
+        { &irc_nick_index_hash_rfc1459_cb,
+          &irc_nick_index_hash_strict_rfc1459_cb,
+          &irc_nick_index_hash_ascii_cb };
+    int (*keycmp_cb[IRC_SERVER_NUM_CASEMAPPING])(struct t_hashtable *hashtable,
+                                                 const void *key1,
+                                                 const void *key2) =
+        { &irc_nick_index_keycmp_rfc1459_cb,
+          &irc_nick_index_keycmp_strict_rfc1459_cb,
+          &irc_nick_index_keycmp_ascii_cb };
+    int casemapping;
+
+    casemapping = (server) ? server->casemapping : IRC_SERVER_CASEMAPPING_RFC1459;
+    if ((casemapping < 0) || (casemapping >= IRC_SERVER_NUM_CASEMAPPING))
+        casemapping = IRC_SERVER_CASEMAPPING_RFC1459;
+
+    return weechat_hashtable_new (32,
+                                  WEECHAT_HASHTABLE_POINTER,
+                                  WEECHAT_HASHTABLE_POINTER,
+                                  hash_key_cb[casemapping],
+                                  keycmp_cb[casemapping]);
+}
+
+/*
+ * Builds the index of nicks in a channel (hashtable with nick name as key,
+ * case insensitive according to casemapping of server, and pointer to nick as
+ * value).
+ *
+ * If the index already exists, it is built again (this must be done if the
+ * casemapping of server has changed).
+ */
+
+void
+irc_nick_index_build (struct t_irc_server *server,
+                      struct t_irc_channel *channel)
+{
+    struct t_irc_nick *ptr_nick;
+
+    if (!channel)
+        return;
+
+    if (channel->nicks_index)
+    {
+        weechat_hashtable_free (channel->nicks_index);
+        channel->nicks_index = NULL;
+    }
+
+    channel->nicks_index = irc_nick_index_new (server);
+    if (!channel->nicks_index)
+        return;
+
+    for (ptr_nick = channel->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        weechat_hashtable_set (channel->nicks_index, ptr_nick->name, ptr_nick);
+    }
+}
+
+/*
+ * Removes a nick from index of nicks in a channel.
+ */
+
+void
+irc_nick_index_remove (struct t_irc_channel *channel, struct t_irc_nick *nick)
+{
+    if (!channel->nicks_index || !nick->name)
+        return;
+
+    /* remove key only if it is for this nick */
+    if (weechat_hashtable_get (channel->nicks_index, nick->name) == nick)
+        weechat_hashtable_remove (channel->nicks_index, nick->name);
+}
+
 /*
  * Checks if a nick pointer is valid.
  *
@@ -387,6 +559,28 @@ irc_nick_nicklist_set (struct t_irc_channel *channel,
     }
 }
 
+/*
+ * Starts or ends a batch of changes in buffer nicklist (for example during
+ * reception of /names or /who on a channel): nicks are sorted and a single
+ * signal is sent at end of batch.
+ *
+ * Note: during batch, nicks added in nicklist must not already be in nicklist
+ * (this is guaranteed by function irc_nick_new).
+ */
+
+void
+irc_nick_nicklist_batch (struct t_irc_channel *channel, int batch)
+{
+    if (!channel || !channel->buffer)
+        return;
+
+    if (weechat_buffer_get_integer (channel->buffer, "nicklist_batch") != batch)
+    {
+        weechat_buffer_set (channel->buffer, "nicklist_batch",
+                            (batch) ? "1" : "0");
+    }
+}
+
 /*
  * Sets nick prefix colors in nicklist for all servers/channels.
  */
@@ -463,6 +657,9 @@ irc_nick_new (struct t_irc_server *server, struct t_irc_channel *channel,
     if (!channel->nicks)
         irc_channel_add_nicklist_groups (server, channel);
 
+    if (!channel->nicks_index)
+        irc_nick_index_build (server, channel);
+
     /* nick already exists on this channel? */
     ptr_nick = irc_nick_search (server, channel, nickname);
     if (ptr_nick)
@@ -537,6 +734,9 @@ irc_nick_new (struct t_irc_server *server, struct t_irc_channel *channel,
 
     channel->nicks_count++;
 
+    if (channel->nicks_index)
+        weechat_hashtable_set (channel->nicks_index, new_nick->name, new_nick);
+
     channel->nick_completion_reset = 1;
 
     /* add nick to buffer nicklist */
@@ -565,9 +765,12 @@ irc_nick_change (struct t_irc_server *server, struct t_irc_channel *channel,
         irc_channel_nick_speaking_rename (channel, nick->name, new_nick);
 
     /* change nickname */
+    irc_nick_index_remove (channel, nick);
     if (nick->name)
         free (nick->name);
     nick->name = strdup (new_nick);
+    if (channel->nicks_index && nick->name)
+        weechat_hashtable_set (channel->nicks_index, nick->name, nick);
     if (nick->color)
         free (nick->color);
     if (nick_is_me)
@@ -625,6 +828,7 @@ irc_nick_free (struct t_irc_server *server, struct t_irc_channel *channel,
     irc_nick_nicklist_remove (server, channel, nick);
 
     /* remove nick */
+    irc_nick_index_remove (channel, nick);
     if (channel->last_nick == nick)
         channel->last_nick = nick->prev_nick;
     if (nick->prev_nick)
@@ -677,8 +881,16 @@ irc_nick_free_all (struct t_irc_server *server, struct t_irc_channel *channel)
     }
 
     /* remove all groups in nicklist */
+    irc_nick_nicklist_batch (channel, 0);
     weechat_nicklist_remove_all (channel->buffer);
 
+    /* remove index of nicks (it is created again with next nick added) */
+    if (channel->nicks_index)
+    {
+        weechat_hashtable_free (channel->nicks_index);
+        channel->nicks_index = NULL;
+    }
+
     /* should be zero, but prevent any bug :D */
     channel->nicks_count = 0;
 }
@@ -698,6 +910,10 @@ irc_nick_search (struct t_irc_server *server, struct t_irc_channel *channel,
     if (!channel || !nickname)
         return NULL;
 
+    /* fast search in index of nicks */
+    if (channel->nicks_index)
+        return weechat_hashtable_get (channel->nicks_index, nickname);
+
     for (ptr_nick = channel->nicks; ptr_nick;
          ptr_nick = ptr_nick->next_nick)
     {
@@ -45,6 +45,9 @@ struct t_irc_nick
     struct t_irc_nick *next_nick;   /* link to next nick on channel          */
 };
 
+extern struct t_hashtable *irc_nick_index_new (struct t_irc_server *server);
+extern void irc_nick_index_build (struct t_irc_server *server,
+                                  struct t_irc_channel *channel);
 extern int irc_nick_valid (struct t_irc_channel *channel,
                            struct t_irc_nick *nick);
 extern int irc_nick_is_nick (const char *string);
@@ -57,6 +60,8 @@ extern int irc_nick_has_prefix_mode (struct t_irc_server *server,
                                      char prefix_mode);
 extern const char *irc_nick_get_prefix_color_name (struct t_irc_server *server,
                                                    char prefix);
+extern void irc_nick_nicklist_batch (struct t_irc_channel *channel,
+                                     int batch);
 extern void irc_nick_nicklist_set_prefix_color_all ();
 extern void irc_nick_nicklist_set_color_all ();
 extern struct t_irc_nick *irc_nick_new (struct t_irc_server *server,
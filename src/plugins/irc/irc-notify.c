@@ -103,6 +103,9 @@ irc_notify_search (struct t_irc_server *server, const char *nick)
     if (!server || !nick)
         return NULL;
 
+    if (server->notify_index)
+        return weechat_hashtable_get (server->notify_index, nick);
+
     for (ptr_notify = server->notify_list; ptr_notify;
          ptr_notify = ptr_notify->next_notify)
     {
@@ -114,6 +117,38 @@ irc_notify_search (struct t_irc_server *server, const char *nick)
     return NULL;
 }
 
+/*
+ * Builds the index of notify in a server (hashtable with nick as key, case
+ * insensitive according to casemapping of server, and pointer to notify as
+ * value).
+ *
+ * If the index already exists, it is built again (this must be done if the
+ * casemapping of server has changed).
+ */
+
+void
+irc_notify_index_build (struct t_irc_server *server)
+{
+    struct t_irc_notify *ptr_notify;
+
+    if (!server)
+        return;
+
+    if (server->notify_index)
+        weechat_hashtable_free (server->notify_index);
+
+    server->notify_index = irc_nick_index_new (server);
+    if (!server->notify_index)
+        return;
+
+    for (ptr_notify = server->notify_list; ptr_notify;
+         ptr_notify = ptr_notify->next_notify)
+    {
+        weechat_hashtable_set (server->notify_index,
+                               ptr_notify->nick, ptr_notify);
+    }
+}
+
 /*
  * Sets server option "notify" with notify list on server.
  */
@@ -216,6 +251,15 @@ irc_notify_new (struct t_irc_server *server, const char *nick, int check_away)
         new_notify->next_notify = NULL;
 
         server->notify_count++;
+
+        /* add notify in index */
+        if (!server->notify_index)
+            irc_notify_index_build (server);
+        else
+        {
+            weechat_hashtable_set (server->notify_index,
+                                   new_notify->nick, new_notify);
+        }
     }
 
     return new_notify;
@@ -238,80 +282,149 @@ irc_notify_check_now (struct t_irc_notify *notify)
     if (notify->server->monitor > 0)
     {
         /* send MONITOR for nick */
-        irc_server_sendf (notify->server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+        irc_server_sendf (notify->server,
+                          IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND, NULL,
                           "MONITOR + %s", notify->nick);
     }
     else
     {
         /* send ISON for nick (MONITOR not supported on server) */
         irc_redirect_new (notify->server, "ison", "notify", 1, NULL, 0, NULL);
-        irc_server_sendf (notify->server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+        irc_server_sendf (notify->server,
+                          IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND, NULL,
                           "ISON :%s", notify->nick);
     }
+    notify->server->notify_queries_sent++;
 
     if (notify->check_away)
     {
         /* send WHOIS for nick */
         irc_redirect_new (notify->server, "whois", "notify", 1, notify->nick, 0,
                           "301,401");
-        irc_server_sendf (notify->server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+        irc_server_sendf (notify->server,
+                          IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND, NULL,
                           "WHOIS :%s", notify->nick);
+        notify->server->notify_queries_sent++;
     }
 }
 
 /*
- * Builds a message with nicks (ISON or MONITOR).
+ * Sends nicks to server in one or more messages (ISON or MONITOR), each
+ * message having at most IRC_NOTIFY_MESSAGE_MAX_LENGTH chars minus the length
+ * reserved for host (see function irc_message_max_length_host), so that
+ * messages are not split again by function irc_message_split (each message
+ * sent must match exactly one redirect).
  *
- * Argument "message" must be "ISON :" or "MONITOR + " or "MONITOR - ".
+ * Argument "irc_message" must be "ISON :" or "MONITOR + " or "MONITOR - ".
  * Argument "separator" must be " " for ISON and "," for MONITOR.
- * Argument "num_nicks" is set with the number of nicks added in message.
+ * If "redirect" is 1, each message is redirected (for ISON).
  *
- * Note: result must be freed after use.
+ * Returns number of messages sent.
  */
 
-char *
-irc_notify_build_message_with_nicks (struct t_irc_server *server,
-                                     const char *irc_message,
-                                     const char *separator,
-                                     int *num_nicks)
+int
+irc_notify_send_nicks (struct t_irc_server *server, const char *irc_message,
+                       const char *separator, const char **nicks,
+                       int num_nicks, int redirect)
 {
-    char *message, *message2;
-    int length, total_length, length_separator;
-    struct t_irc_notify *ptr_notify;
+    char **message;
+    int i, length, length_message, length_separator, nicks_in_message;
+    int messages_sent, max_length;
 
-    *num_nicks = 0;
+    if (!server || !nicks || (num_nicks <= 0))
+        return 0;
 
-    length = strlen (irc_message) + 1;
-    total_length = length;
-    length_separator = strlen (separator);
+    max_length = IRC_NOTIFY_MESSAGE_MAX_LENGTH -
+        irc_message_max_length_host (server);
 
-    message = malloc (length);
+    message = weechat_string_dyn_alloc (max_length + 1);
     if (!message)
-        return NULL;
-    snprintf (message, length, "%s", irc_message);
+        return 0;
 
-    for (ptr_notify = server->notify_list; ptr_notify;
-         ptr_notify = ptr_notify->next_notify)
+    length_message = strlen (irc_message);
+    length_separator = strlen (separator);
+    length = 0;
+    nicks_in_message = 0;
+    messages_sent = 0;
+
+    for (i = 0; i <= num_nicks; i++)
     {
-        length = strlen (ptr_notify->nick);
-        total_length += length + length_separator;
-        message2 = realloc (message, total_length);
-        if (!message2)
+        /* send message if it's full (or if all nicks have been added) */
+        if ((nicks_in_message > 0)
+            && ((i == num_nicks)
+                || (length + length_separator + (int)strlen (nicks[i]) >
+                    max_length)))
         {
-            if (message)
-                free (message);
-            message = NULL;
+            if (redirect)
+            {
+                irc_redirect_new (server, "ison", "notify", 1,
+                                  NULL, 0, NULL);
+            }
+            irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND,
+                              NULL, "%s", *message);
+            server->notify_queries_sent++;
+            messages_sent++;
+            nicks_in_message = 0;
+        }
+        if (i == num_nicks)
             break;
+        if (nicks_in_message == 0)
+        {
+            weechat_string_dyn_copy (message, irc_message);
+            length = length_message;
+        }
+        else
+        {
+            weechat_string_dyn_concat (message, separator);
+            length += length_separator;
         }
-        message = message2;
-        if (*num_nicks > 0)
-            strcat (message, separator);
-        strcat (message, ptr_notify->nick);
+        weechat_string_dyn_concat (message, nicks[i]);
+        length += strlen (nicks[i]);
+        nicks_in_message++;
+    }
+
+    weechat_string_dyn_free (message, 1);
+
+    return messages_sent;
+}
+
+/*
+ * Sends all nicks of notify list to server in one or more messages (ISON or
+ * MONITOR), see function irc_notify_send_nicks.
+ *
+ * Returns number of messages sent.
+ */
+
+int
+irc_notify_send_all_nicks (struct t_irc_server *server,
+                           const char *irc_message, const char *separator,
+                           int redirect)
+{
+    struct t_irc_notify *ptr_notify;
+    const char **nicks;
+    int num_nicks, messages_sent;
+
+    if (!server || !server->notify_list)
+        return 0;
+
+    nicks = malloc (server->notify_count * sizeof (*nicks));
+    if (!nicks)
+        return 0;
 
-        (*num_nicks)++;
+    num_nicks = 0;
+    for (ptr_notify = server->notify_list;
+         ptr_notify && (num_nicks < server->notify_count);
+         ptr_notify = ptr_notify->next_notify)
+    {
+        nicks[num_nicks++] = ptr_notify->nick;
     }
 
-    return message;
+    messages_sent = irc_notify_send_nicks (server, irc_message, separator,
+                                           nicks, num_nicks, redirect);
+
+    free (nicks);
+
+    return messages_sent;
 }
 
 /*
@@ -322,42 +435,16 @@ irc_notify_build_message_with_nicks (struct t_irc_server *server,
 void
 irc_notify_send_monitor (struct t_irc_server *server)
 {
-    struct t_hashtable *hashtable;
-    char *message, hash_key[32];
-    const char *str_message;
-    int num_nicks, number;
-
-    message = irc_notify_build_message_with_nicks (server,
-                                                   "MONITOR + ",
-                                                   ",",
-                                                   &num_nicks);
-    if (message && (num_nicks > 0))
-    {
-        hashtable = irc_message_split (server, message);
-        if (hashtable)
-        {
-            number = 1;
-            while (1)
-            {
-                snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                str_message = weechat_hashtable_get (hashtable,
-                                                     hash_key);
-                if (!str_message)
-                    break;
-                irc_server_sendf (server,
-                                  IRC_SERVER_SEND_OUTQ_PRIO_LOW,
-                                  NULL, "%s", str_message);
-                number++;
-            }
-            weechat_hashtable_free (hashtable);
-        }
-    }
-    if (message)
-        free (message);
+    irc_notify_send_all_nicks (server, "MONITOR + ", ",", 0);
 }
 
 /*
- * Creates a notify list for server with option "irc.server.xxx.notify".
+ * Creates or updates the notify list for server with option
+ * "irc.server.xxx.notify".
+ *
+ * Only differences with current list are applied: notify not in option are
+ * removed, new notify are added, and the state of other notify (online, away)
+ * is kept. If MONITOR is used, only the nicks removed/added are sent to server.
  */
 
 void
@@ -365,49 +452,131 @@ irc_notify_new_for_server (struct t_irc_server *server)
 {
     const char *notify;
     char **items, *pos_params, **params;
-    int i, j, num_items, num_params, check_away;
-
-    irc_notify_free_all (server);
+    const char **nicks_removed, **nicks_added;
+    int i, j, num_items, num_params, *check_away;
+    int num_removed, num_added, send_monitor;
+    struct t_irc_notify *ptr_notify, *ptr_next_notify;
+    struct t_hashtable *notify_kept;
 
     notify = IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_NOTIFY);
-    if (!notify || !notify[0])
-        return;
+    items = (notify && notify[0]) ?
+        weechat_string_split (notify, ",", 0, 0, &num_items) : NULL;
+    if (!items)
+        num_items = 0;
+
+    check_away = NULL;
+    nicks_removed = NULL;
+    nicks_added = NULL;
+    num_removed = 0;
+    num_added = 0;
+    send_monitor = (server->is_connected && (server->monitor > 0)
+                    && !irc_signal_upgrade_received);
+
+    notify_kept = weechat_hashtable_new (32,
+                                         WEECHAT_HASHTABLE_POINTER,
+                                         WEECHAT_HASHTABLE_POINTER,
+                                         NULL, NULL);
+    if (!notify_kept)
+        goto end;
+    if (num_items > 0)
+    {
+        check_away = malloc (num_items * sizeof (*check_away));
+        nicks_added = malloc (num_items * sizeof (*nicks_added));
+        if (!check_away || !nicks_added)
+            goto end;
+    }
+    if (server->notify_count > 0)
+    {
+        nicks_removed = malloc (server->notify_count *
+                                sizeof (*nicks_removed));
+        if (!nicks_removed)
+            goto end;
+    }
 
-    items = weechat_string_split (notify, ",", 0, 0, &num_items);
-    if (items)
+    /* read nicks in option, update notify already in list */
+    for (i = 0; i < num_items; i++)
     {
-        for (i = 0; i < num_items; i++)
+        check_away[i] = 0;
+        pos_params = strchr (items[i], ' ');
+        if (pos_params)
         {
-            check_away = 0;
-            pos_params = strchr (items[i], ' ');
-            if (pos_params)
+            pos_params[0] = '\0';
+            pos_params++;
+            while (pos_params[0] == ' ')
             {
-                pos_params[0] = '\0';
                 pos_params++;
-                while (pos_params[0] == ' ')
-                {
-                    pos_params++;
-                }
-                params = weechat_string_split (pos_params, "/", 0, 0,
-                                               &num_params);
-                if (params)
+            }
+            params = weechat_string_split (pos_params, "/", 0, 0,
+                                           &num_params);
+            if (params)
+            {
+                for (j = 0; j < num_params; j++)
                 {
-                    for (j = 0; j < num_params; j++)
-                    {
-                        if (weechat_strcasecmp (params[j], "away") == 0)
-                            check_away = 1;
-                    }
-                    weechat_string_free_split (params);
+                    if (weechat_strcasecmp (params[j], "away") == 0)
+                        check_away[i] = 1;
                 }
+                weechat_string_free_split (params);
             }
-            irc_notify_new (server, items[i], check_away);
         }
-        weechat_string_free_split (items);
+        ptr_notify = irc_notify_search (server, items[i]);
+        if (ptr_notify)
+        {
+            ptr_notify->check_away = check_away[i];
+            weechat_hashtable_set (notify_kept, ptr_notify, NULL);
+        }
+    }
+
+    /* remove notify which are not in option any more */
+    ptr_notify = server->notify_list;
+    while (ptr_notify)
+    {
+        ptr_next_notify = ptr_notify->next_notify;
+        if (!weechat_hashtable_has_key (notify_kept, ptr_notify))
+        {
+            if (send_monitor)
+                nicks_removed[num_removed++] = strdup (ptr_notify->nick);
+            irc_notify_free (server, ptr_notify, 0);
+        }
+        ptr_notify = ptr_next_notify;
+    }
+
+    /* add new notify */
+    for (i = 0; i < num_items; i++)
+    {
+        if (!irc_notify_search (server, items[i]))
+        {
+            ptr_notify = irc_notify_new (server, items[i], check_away[i]);
+            if (ptr_notify)
+                nicks_added[num_added++] = ptr_notify->nick;
+        }
+    }
+
+    /* if we are using MONITOR, send it now with nicks removed/added */
+    if (send_monitor)
+    {
+        irc_notify_send_nicks (server, "MONITOR - ", ",",
+                               nicks_removed, num_removed, 0);
+        irc_notify_send_nicks (server, "MONITOR + ", ",",
+                               nicks_added, num_added, 0);
     }
 
-    /* if we are using MONITOR, send it now with new nicks monitored */
-    if (server->is_connected && (server->monitor > 0))
-        irc_notify_send_monitor (server);
+end:
+    if (items)
+        weechat_string_free_split (items);
+    if (check_away)
+        free (check_away);
+    if (nicks_removed)
+    {
+        for (i = 0; i < num_removed; i++)
+        {
+            free ((char *)nicks_removed[i]);
+        }
+        free (nicks_removed);
+    }
+    if (nicks_added)
+        free (nicks_added);
+    if (notify_kept)
+        weechat_hashtable_free (notify_kept);
 }
 
 /*
@@ -440,6 +609,10 @@ irc_notify_free (struct t_irc_server *server, struct t_irc_notify *notify,
     (void) weechat_hook_signal_send ("irc_notify_removing",
                                      WEECHAT_HOOK_SIGNAL_POINTER, notify);
 
+    /* remove notify from index */
+    if (server->notify_index && notify->nick)
+        weechat_hashtable_remove (server->notify_index, notify->nick);
+
     /* free data */
     if (notify->nick)
     {
@@ -448,8 +621,9 @@ irc_notify_free (struct t_irc_server *server, struct t_irc_notify *notify,
         {
             /* remove one monitored nick */
             irc_server_sendf (notify->server,
-                              IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+                              IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND, NULL,
                               "MONITOR - %s", notify->nick);
+            server->notify_queries_sent++;
         }
         free (notify->nick);
     }
@@ -486,8 +660,10 @@ irc_notify_free_all (struct t_irc_server *server)
     if ((server->monitor > 0) && (server->is_connected)
         && !irc_signal_upgrade_received)
     {
-        irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+        irc_server_sendf (server,
+                          IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND, NULL,
                           "MONITOR C");
+        server->notify_queries_sent++;
     }
 
     /* free notify list */
@@ -675,6 +851,8 @@ irc_notify_set_is_on_server (struct t_irc_notify *notify, const char *host,
     if (notify->is_on_server == is_on_server)
         return;
 
+    notify->server->notify_state_changes++;
+
     weechat_printf_date_tags (
         notify->server->buffer,
         0,
@@ -721,6 +899,8 @@ irc_notify_set_away_message (struct t_irc_notify *notify,
             && (strcmp (notify->away_message, away_message) == 0)))
         return;
 
+    notify->server->notify_state_changes++;
+
     if (!notify->away_message && away_message)
     {
         weechat_printf_date_tags (
@@ -782,7 +962,7 @@ irc_notify_hsignal_cb (const void *pointer, void *data, const char *signal,
     const char *error, *server, *pattern, *command, *output;
     char **messages, **nicks_sent, **nicks_recv, *irc_cmd, *arguments;
     char *ptr_args, *pos;
-    int i, j, num_messages, num_nicks_sent, num_nicks_recv, nick_was_sent;
+    int i, j, num_messages, num_nicks_sent, num_nicks_recv;
     int away_message_updated, no_such_nick;
     struct t_irc_server *ptr_server;
     struct t_irc_notify *ptr_notify;
@@ -826,19 +1006,26 @@ irc_notify_hsignal_cb (const void *pointer, void *data, const char *signal,
     /* read output of command */
     if (strcmp (pattern, "ison") == 0)
     {
-        /* redirection of command "ison" */
+        /*
+         * redirection of command "ison": only nicks sent in command are
+         * checked (with index of notify): nicks received are online, other
+         * nicks sent are offline
+         */
         messages = weechat_string_split (output, "\n", 0, 0, &num_messages);
         if (messages)
         {
             nicks_sent = weechat_string_split (ptr_args, " ", 0, 0,
                                                &num_nicks_sent);
             if (!nicks_sent)
+            {
+                weechat_string_free_split (messages);
                 return WEECHAT_RC_OK;
-            for (ptr_notify = ptr_server->notify_list;
-                 ptr_notify;
-                 ptr_notify = ptr_notify->next_notify)
+            }
+            for (i = 0; i < num_nicks_sent; i++)
             {
-                ptr_notify->ison_received = 0;
+                ptr_notify = irc_notify_search (ptr_server, nicks_sent[i]);
+                if (ptr_notify)
+                    ptr_notify->ison_received = 0;
             }
             for (i = 0; i < num_messages; i++)
             {
@@ -863,19 +1050,13 @@ irc_notify_hsignal_cb (const void *pointer, void *data, const char *signal,
                             {
                                 for (j = 0; j < num_nicks_recv; j++)
                                 {
-                                    for (ptr_notify = ptr_server->notify_list;
-                                         ptr_notify;
-                                         ptr_notify = ptr_notify->next_notify)
+                                    ptr_notify = irc_notify_search (
+                                        ptr_server, nicks_recv[j]);
+                                    if (ptr_notify)
                                     {
-                                        if (irc_server_strcasecmp (ptr_server,
-                                                                   ptr_notify->nick,
-                                                                   nicks_recv[j]) == 0)
-                                        {
-                                            irc_notify_set_is_on_server (ptr_notify,
-                                                                         NULL,
-                                                                         1);
-                                            ptr_notify->ison_received = 1;
-                                        }
+                                        irc_notify_set_is_on_server (ptr_notify,
+                                                                     NULL, 1);
+                                        ptr_notify->ison_received = 1;
                                     }
                                 }
                                 weechat_string_free_split (nicks_recv);
@@ -885,30 +1066,13 @@ irc_notify_hsignal_cb (const void *pointer, void *data, const char *signal,
                     free (arguments);
                 }
             }
-            for (ptr_notify = ptr_server->notify_list;
-                 ptr_notify;
-                 ptr_notify = ptr_notify->next_notify)
+            for (i = 0; i < num_nicks_sent; i++)
             {
-                if (!ptr_notify->ison_received)
-                {
-                    nick_was_sent = 0;
-                    for (j = 0; j < num_nicks_sent; j++)
-                    {
-                        if (irc_server_strcasecmp (ptr_server,
-                                                   nicks_sent[j],
-                                                   ptr_notify->nick) == 0)
-                        {
-                            nick_was_sent = 1;
-                            break;
-                        }
-                    }
-                    if (nick_was_sent)
-                    {
-                        irc_notify_set_is_on_server (ptr_notify, NULL, 0);
-                    }
-                }
-
+                ptr_notify = irc_notify_search (ptr_server, nicks_sent[i]);
+                if (ptr_notify && !ptr_notify->ison_received)
+                    irc_notify_set_is_on_server (ptr_notify, NULL, 0);
             }
+            weechat_string_free_split (nicks_sent);
             weechat_string_free_split (messages);
         }
     }
@@ -966,17 +1130,14 @@ irc_notify_hsignal_cb (const void *pointer, void *data, const char *signal,
 }
 
 /*
- * Timer called to send "ison" command to servers.
+ * Timer called to send "ison" command to servers (only for servers which do
+ * not support MONITOR).
  */
 
 int
 irc_notify_timer_ison_cb (const void *pointer, void *data, int remaining_calls)
 {
-    char *message, hash_key[32];
-    const char *str_message;
-    int num_nicks, number;
     struct t_irc_server *ptr_server;
-    struct t_hashtable *hashtable;
 
     /* make C compiler happy */
     (void) pointer;
@@ -990,35 +1151,7 @@ irc_notify_timer_ison_cb (const void *pointer, void *data, int remaining_calls)
             && ptr_server->notify_list
             && (ptr_server->monitor == 0))
         {
-            message = irc_notify_build_message_with_nicks (ptr_server,
-                                                           "ISON :",
-                                                           " ",
-                                                           &num_nicks);
-            if (message && (num_nicks > 0))
-            {
-                hashtable = irc_message_split (ptr_server, message);
-                if (hashtable)
-                {
-                    number = 1;
-                    while (1)
-                    {
-                        snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                        str_message = weechat_hashtable_get (hashtable,
-                                                             hash_key);
-                        if (!str_message)
-                            break;
-                        irc_redirect_new (ptr_server, "ison", "notify", 1,
-                                          NULL, 0, NULL);
-                        irc_server_sendf (ptr_server,
-                                          IRC_SERVER_SEND_OUTQ_PRIO_LOW,
-                                          NULL, "%s", str_message);
-                        number++;
-                    }
-                    weechat_hashtable_free (hashtable);
-                }
-            }
-            if (message)
-                free (message);
+            irc_notify_send_all_nicks (ptr_server, "ISON :", " ", 1);
         }
     }
 
@@ -1061,8 +1194,10 @@ irc_notify_timer_whois_cb (const void *pointer, void *data,
                     irc_redirect_new (ptr_server, "whois", "notify", 1,
                                       ptr_notify->nick, 0, "301,401");
                     irc_server_sendf (ptr_server,
-                                      IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+                                      IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND,
+                                      NULL,
                                       "WHOIS :%s", ptr_notify->nick);
+                    ptr_server->notify_queries_sent++;
                 }
 
                 ptr_notify = ptr_next_notify;
@@ -20,6 +20,12 @@
 #ifndef WEECHAT_IRC_NOTIFY_H
 #define WEECHAT_IRC_NOTIFY_H 1
 
+/*
+ * max length of ISON/MONITOR messages sent for notify (without CR-LF),
+ * including the length reserved for host (see irc_message_max_length_host)
+ */
+#define IRC_NOTIFY_MESSAGE_MAX_LENGTH 510
+
 struct t_irc_server;
 
 struct t_irc_notify
@@ -46,6 +52,7 @@ extern int irc_notify_valid (struct t_irc_server *server,
                              struct t_irc_notify *notify);
 extern struct t_irc_notify *irc_notify_search (struct t_irc_server *server,
                                                const char *nick);
+extern void irc_notify_index_build (struct t_irc_server *server);
 extern void irc_notify_set_server_option (struct t_irc_server *server);
 extern struct t_irc_notify *irc_notify_new (struct t_irc_server *server,
                                             const char *nick,
@@ -59,6 +66,15 @@ extern void irc_notify_set_is_on_server (struct t_irc_notify *notify,
                                          const char *host, int is_on_server);
 extern void irc_notify_free_all (struct t_irc_server *server);
 extern void irc_notify_display_list (struct t_irc_server *server);
+extern int irc_notify_send_nicks (struct t_irc_server *server,
+                                  const char *irc_message,
+                                  const char *separator,
+                                  const char **nicks, int num_nicks,
+                                  int redirect);
+extern int irc_notify_send_all_nicks (struct t_irc_server *server,
+                                      const char *irc_message,
+                                      const char *separator,
+                                      int redirect);
 extern void irc_notify_send_monitor (struct t_irc_server *server);
 extern int irc_notify_timer_ison_cb (const void *pointer, void *data,
                                      int remaining_calls);
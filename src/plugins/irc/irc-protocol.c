@@ -41,6 +41,7 @@
 #include "irc.h"
 #include "irc-protocol.h"
 #include "irc-bar-item.h"
+#include "irc-batch.h"
 #include "irc-buffer.h"
 #include "irc-channel.h"
 #include "irc-color.h"
@@ -329,6 +330,41 @@ IRC_PROTOCOL_CALLBACK(away)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Callback for the IRC message "BATCH": start or end of a batch of messages
+ * (with capability "batch").
+ *
+ * Lines displayed for messages of the batch are added in batch in buffers:
+ * hotlist and refresh of buffers are done only once, at the end of batch.
+ *
+ * Message looks like:
+ *   :server BATCH +yXNAbvnRHTRBv chathistory #channel
+ *   :server BATCH -yXNAbvnRHTRBv
+ */
+
+IRC_PROTOCOL_CALLBACK(batch)
+{
+    struct t_irc_batch *ptr_batch;
+
+    IRC_PROTOCOL_MIN_ARGS(3);
+
+    if (argv[2][0] == '+')
+    {
+        if (argc < 4)
+            return WEECHAT_RC_ERROR;
+        irc_batch_start (server, argv[2] + 1, argv[3],
+                         (argc > 4) ? argv_eol[4] : NULL);
+    }
+    else if (argv[2][0] == '-')
+    {
+        ptr_batch = irc_batch_search (server, argv[2] + 1);
+        if (ptr_batch)
+            irc_batch_end (server, ptr_batch);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Callback for the IRC message "CAP": client capability.
  *
@@ -1979,6 +2015,7 @@ IRC_PROTOCOL_CALLBACK(privmsg)
             }
 
             irc_channel_nick_speaking_add (
+                server,
                 ptr_channel,
                 nick,
                 weechat_string_has_highlight (pos_args,
@@ -2561,6 +2598,7 @@ IRC_PROTOCOL_CALLBACK(005)
     char *pos, *pos2, *pos_start, *error, *isupport2;
     int length_isupport, length, casemapping;
     long value;
+    struct t_irc_channel *ptr_channel;
 
     IRC_PROTOCOL_MIN_ARGS(4);
 
@@ -2606,8 +2644,20 @@ IRC_PROTOCOL_CALLBACK(005)
         if (pos2)
             pos2[0] = '\0';
         casemapping = irc_server_search_casemapping (pos);
-        if (casemapping >= 0)
+        if ((casemapping >= 0) && (casemapping != server->casemapping))
+        {
             server->casemapping = casemapping;
+            /* nicks must be hashed with the new casemapping */
+            for (ptr_channel = server->channels; ptr_channel;
+                 ptr_channel = ptr_channel->next_channel)
+            {
+                if (ptr_channel->nicks_index)
+                    irc_nick_index_build (server, ptr_channel);
+                irc_channel_nick_speaking_index_build (server, ptr_channel);
+            }
+            if (server->notify_index)
+                irc_notify_index_build (server);
+        }
         if (pos2)
             pos2[0] = ' ';
     }
@@ -3058,6 +3108,8 @@ IRC_PROTOCOL_CALLBACK(315)
     IRC_PROTOCOL_MIN_ARGS(5);
 
     ptr_channel = irc_channel_search (server, argv[3]);
+    if (ptr_channel)
+        irc_nick_nicklist_batch (ptr_channel, 0);
     if (ptr_channel && (ptr_channel->checking_whox > 0))
     {
         ptr_channel->checking_whox--;
@@ -4206,6 +4258,10 @@ IRC_PROTOCOL_CALLBACK(352)
     ptr_nick = (ptr_channel) ?
         irc_nick_search (server, ptr_channel, argv[7]) : NULL;
 
+    /* changes in nicklist are sent at end of /who (message 315) */
+    if (ptr_channel && (ptr_channel->checking_whox > 0))
+        irc_nick_nicklist_batch (ptr_channel, 1);
+
     /* update host in nick */
     if (ptr_nick)
     {
@@ -4297,6 +4353,10 @@ IRC_PROTOCOL_CALLBACK(353)
     ptr_channel = irc_channel_search (server, pos_channel);
     str_nicks = NULL;
 
+    /* nicks are sorted in nicklist at end of /names (message 366) */
+    if (ptr_channel && ptr_channel->nicks)
+        irc_nick_nicklist_batch (ptr_channel, 1);
+
     /*
      * for a channel without buffer, prepare a string that will be built
      * with nicks and colors (argc - args is the number of nicks)
@@ -4438,6 +4498,10 @@ IRC_PROTOCOL_CALLBACK(354)
     ptr_nick = (ptr_channel) ?
         irc_nick_search (server, ptr_channel, argv[7]) : NULL;
 
+    /* changes in nicklist are sent at end of /who (message 315) */
+    if (ptr_channel && (ptr_channel->checking_whox > 0))
+        irc_nick_nicklist_batch (ptr_channel, 1);
+
     /* update host in nick */
     if (ptr_nick)
     {
@@ -4549,6 +4613,8 @@ IRC_PROTOCOL_CALLBACK(366)
     IRC_PROTOCOL_MIN_ARGS(5);
 
     ptr_channel = irc_channel_search (server, argv[3]);
+    if (ptr_channel)
+        irc_nick_nicklist_batch (ptr_channel, 0);
     if (ptr_channel && ptr_channel->nicks)
     {
         /* display users on channel */
@@ -5677,224 +5743,349 @@ irc_protocol_get_message_tag_time (struct t_hashtable *tags)
     return time_value;
 }
 
+/*
+ * Messages received from IRC server, with their callbacks.
+ */
+
+struct t_irc_protocol_msg irc_protocol_messages[] =
+{ { "account", /* account (cap account-notify) */ 1, 0, &irc_protocol_cb_account },
+  { "authenticate", /* authenticate */ 1, 0, &irc_protocol_cb_authenticate },
+  { "away", /* away (cap away-notify) */ 1, 0, &irc_protocol_cb_away },
+  { "batch", /* batch of messages (cap batch) */ 1, 0, &irc_protocol_cb_batch },
+  { "cap", /* client capability */ 1, 0, &irc_protocol_cb_cap },
+  { "error", /* error received from IRC server */ 1, 0, &irc_protocol_cb_error },
+  { "invite", /* invite a nick on a channel */ 1, 0, &irc_protocol_cb_invite },
+  { "join", /* join a channel */ 1, 0, &irc_protocol_cb_join },
+  { "kick", /* forcibly remove a user from a channel */ 1, 1, &irc_protocol_cb_kick },
+  { "kill", /* close client-server connection */ 1, 1, &irc_protocol_cb_kill },
+  { "mode", /* change channel or user mode */ 1, 0, &irc_protocol_cb_mode },
+  { "nick", /* change current nickname */ 1, 0, &irc_protocol_cb_nick },
+  { "notice", /* send notice message to user */ 1, 1, &irc_protocol_cb_notice },
+  { "part", /* leave a channel */ 1, 1, &irc_protocol_cb_part },
+  { "ping", /* ping server */ 1, 0, &irc_protocol_cb_ping },
+  { "pong", /* answer to a ping message */ 1, 0, &irc_protocol_cb_pong },
+  { "privmsg", /* message received */ 1, 1, &irc_protocol_cb_privmsg },
+  { "quit", /* close all connections and quit */ 1, 1, &irc_protocol_cb_quit },
+  { "topic", /* get/set channel topic */ 0, 1, &irc_protocol_cb_topic },
+  { "wallops", /* send a message to all currently connected users who have "
+                  "set the 'w' user mode "
+                  "for themselves */ 1, 1, &irc_protocol_cb_wallops },
+  { "001", /* a server message */ 1, 0, &irc_protocol_cb_001 },
+  { "005", /* a server message */ 1, 0, &irc_protocol_cb_005 },
+  { "008", /* server notice mask */ 1, 0, &irc_protocol_cb_008 },
+  { "221", /* user mode string */ 1, 0, &irc_protocol_cb_221 },
+  { "223", /* whois (charset is) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "264", /* whois (is using encrypted connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "275", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "276", /* whois (has client certificate fingerprint) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "301", /* away message */ 1, 1, &irc_protocol_cb_301 },
+  { "303", /* ison */ 1, 0, &irc_protocol_cb_303 },
+  { "305", /* unaway */ 1, 0, &irc_protocol_cb_305 },
+  { "306", /* now away */ 1, 0, &irc_protocol_cb_306 },
+  { "307", /* whois (registered nick) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "310", /* whois (help mode) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "311", /* whois (user) */ 1, 0, &irc_protocol_cb_311 },
+  { "312", /* whois (server) */ 1, 0, &irc_protocol_cb_312 },
+  { "313", /* whois (operator) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "314", /* whowas */ 1, 0, &irc_protocol_cb_314 },
+  { "315", /* end of /who list */ 1, 0, &irc_protocol_cb_315 },
+  { "317", /* whois (idle) */ 1, 0, &irc_protocol_cb_317 },
+  { "318", /* whois (end) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "319", /* whois (channels) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "320", /* whois (identified user) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "321", /* /list start */ 1, 0, &irc_protocol_cb_321 },
+  { "322", /* channel (for /list) */ 1, 0, &irc_protocol_cb_322 },
+  { "323", /* end of /list */ 1, 0, &irc_protocol_cb_323 },
+  { "324", /* channel mode */ 1, 0, &irc_protocol_cb_324 },
+  { "326", /* whois (has oper privs) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "327", /* whois (host) */ 1, 0, &irc_protocol_cb_327 },
+  { "328", /* channel url */ 1, 0, &irc_protocol_cb_328 },
+  { "329", /* channel creation date */ 1, 0, &irc_protocol_cb_329 },
+  { "330", /* is logged in as */ 1, 0, &irc_protocol_cb_330_343 },
+  { "331", /* no topic for channel */ 1, 0, &irc_protocol_cb_331 },
+  { "332", /* topic of channel */ 0, 1, &irc_protocol_cb_332 },
+  { "333", /* infos about topic (nick and date changed) */ 1, 0, &irc_protocol_cb_333 },
+  { "335", /* is a bot on */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "338", /* whois (host) */ 1, 0, &irc_protocol_cb_338 },
+  { "341", /* inviting */ 1, 0, &irc_protocol_cb_341 },
+  { "343", /* is opered as */ 1, 0, &irc_protocol_cb_330_343 },
+  { "344", /* channel reop */ 1, 0, &irc_protocol_cb_344 },
+  { "345", /* end of channel reop list */ 1, 0, &irc_protocol_cb_345 },
+  { "346", /* invite list */ 1, 0, &irc_protocol_cb_346 },
+  { "347", /* end of invite list */ 1, 0, &irc_protocol_cb_347 },
+  { "348", /* channel exception list */ 1, 0, &irc_protocol_cb_348 },
+  { "349", /* end of channel exception list */ 1, 0, &irc_protocol_cb_349 },
+  { "351", /* server version */ 1, 0, &irc_protocol_cb_351 },
+  { "352", /* who */ 1, 0, &irc_protocol_cb_352 },
+  { "353", /* list of nicks on channel */ 1, 0, &irc_protocol_cb_353 },
+  { "354", /* whox */ 1, 0, &irc_protocol_cb_354 },
+  { "366", /* end of /names list */ 1, 0, &irc_protocol_cb_366 },
+  { "367", /* banlist */ 1, 0, &irc_protocol_cb_367 },
+  { "368", /* end of banlist */ 1, 0, &irc_protocol_cb_368 },
+  { "369", /* whowas (end) */ 1, 0, &irc_protocol_cb_whowas_nick_msg },
+  { "378", /* whois (connecting from) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "379", /* whois (using modes) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "401", /* no such nick/channel */ 1, 0, &irc_protocol_cb_generic_error },
+  { "402", /* no such server */ 1, 0, &irc_protocol_cb_generic_error },
+  { "403", /* no such channel */ 1, 0, &irc_protocol_cb_generic_error },
+  { "404", /* cannot send to channel */ 1, 0, &irc_protocol_cb_generic_error },
+  { "405", /* too many channels */ 1, 0, &irc_protocol_cb_generic_error },
+  { "406", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
+  { "407", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
+  { "409", /* no origin */ 1, 0, &irc_protocol_cb_generic_error },
+  { "410", /* no services */ 1, 0, &irc_protocol_cb_generic_error },
+  { "411", /* no recipient */ 1, 0, &irc_protocol_cb_generic_error },
+  { "412", /* no text to send */ 1, 0, &irc_protocol_cb_generic_error },
+  { "413", /* no toplevel */ 1, 0, &irc_protocol_cb_generic_error },
+  { "414", /* wilcard in toplevel domain */ 1, 0, &irc_protocol_cb_generic_error },
+  { "421", /* unknown command */ 1, 0, &irc_protocol_cb_generic_error },
+  { "422", /* MOTD is missing */ 1, 0, &irc_protocol_cb_generic_error },
+  { "423", /* no administrative info */ 1, 0, &irc_protocol_cb_generic_error },
+  { "424", /* file error */ 1, 0, &irc_protocol_cb_generic_error },
+  { "431", /* no nickname given */ 1, 0, &irc_protocol_cb_generic_error },
+  { "432", /* erroneous nickname */ 1, 0, &irc_protocol_cb_432 },
+  { "433", /* nickname already in use */ 1, 0, &irc_protocol_cb_433 },
+  { "436", /* nickname collision */ 1, 0, &irc_protocol_cb_generic_error },
+  { "437", /* nick/channel unavailable */ 1, 0, &irc_protocol_cb_437 },
+  { "438", /* not authorized to change nickname */ 1, 0, &irc_protocol_cb_438 },
+  { "441", /* user not in channel */ 1, 0, &irc_protocol_cb_generic_error },
+  { "442", /* not on channel */ 1, 0, &irc_protocol_cb_generic_error },
+  { "443", /* user already on channel */ 1, 0, &irc_protocol_cb_generic_error },
+  { "444", /* user not logged in */ 1, 0, &irc_protocol_cb_generic_error },
+  { "445", /* summon has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
+  { "446", /* users has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
+  { "451", /* you are not registered */ 1, 0, &irc_protocol_cb_generic_error },
+  { "461", /* not enough parameters */ 1, 0, &irc_protocol_cb_generic_error },
+  { "462", /* you may not register */ 1, 0, &irc_protocol_cb_generic_error },
+  { "463", /* your host isn't among the privileged */ 1, 0, &irc_protocol_cb_generic_error },
+  { "464", /* password incorrect */ 1, 0, &irc_protocol_cb_generic_error },
+  { "465", /* you are banned from this server */ 1, 0, &irc_protocol_cb_generic_error },
+  { "467", /* channel key already set */ 1, 0, &irc_protocol_cb_generic_error },
+  { "470", /* forwarding to another channel */ 1, 0, &irc_protocol_cb_470 },
+  { "471", /* channel is already full */ 1, 0, &irc_protocol_cb_generic_error },
+  { "472", /* unknown mode char to me */ 1, 0, &irc_protocol_cb_generic_error },
+  { "473", /* cannot join channel (invite only) */ 1, 0, &irc_protocol_cb_generic_error },
+  { "474", /* cannot join channel (banned from channel) */ 1, 0, &irc_protocol_cb_generic_error },
+  { "475", /* cannot join channel (bad channel key) */ 1, 0, &irc_protocol_cb_generic_error },
+  { "476", /* bad channel mask */ 1, 0, &irc_protocol_cb_generic_error },
+  { "477", /* channel doesn't support modes */ 1, 0, &irc_protocol_cb_generic_error },
+  { "481", /* you're not an IRC operator */ 1, 0, &irc_protocol_cb_generic_error },
+  { "482", /* you're not channel operator */ 1, 0, &irc_protocol_cb_generic_error },
+  { "483", /* you can't kill a server! */ 1, 0, &irc_protocol_cb_generic_error },
+  { "484", /* your connection is restricted! */ 1, 0, &irc_protocol_cb_generic_error },
+  { "485", /* user is immune from kick/deop */ 1, 0, &irc_protocol_cb_generic_error },
+  { "487", /* network split */ 1, 0, &irc_protocol_cb_generic_error },
+  { "491", /* no O-lines for your host */ 1, 0, &irc_protocol_cb_generic_error },
+  { "501", /* unknown mode flag */ 1, 0, &irc_protocol_cb_generic_error },
+  { "502", /* can't change mode for other users */ 1, 0, &irc_protocol_cb_generic_error },
+  { "671", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+  { "728", /* quietlist */ 1, 0, &irc_protocol_cb_728 },
+  { "729", /* end of quietlist */ 1, 0, &irc_protocol_cb_729 },
+  { "730", /* monitored nicks online */ 1, 0, &irc_protocol_cb_730 },
+  { "731", /* monitored nicks offline */ 1, 0, &irc_protocol_cb_731 },
+  { "732", /* list of monitored nicks */ 1, 0, &irc_protocol_cb_732 },
+  { "733", /* end of monitor list */ 1, 0, &irc_protocol_cb_733 },
+  { "734", /* monitor list is full */ 1, 0, &irc_protocol_cb_734 },
+  { "900", /* logged in as (SASL) */ 1, 0, &irc_protocol_cb_900 },
+  { "901", /* you are now logged in */ 1, 0, &irc_protocol_cb_901 },
+  { "902", /* SASL authentication failed (account locked/held) */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+  { "903", /* SASL authentication successful */ 1, 0, &irc_protocol_cb_sasl_end_ok },
+  { "904", /* SASL authentication failed */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+  { "905", /* SASL message too long */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+  { "906", /* SASL authentication aborted */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+  { "907", /* You have already completed SASL authentication */ 1, 0, &irc_protocol_cb_sasl_end_ok },
+  { "936", /* censored word */ 1, 0, &irc_protocol_cb_generic_error },
+  { "973", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
+  { "974", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
+  { "975", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
+  { NULL, 0, 0, NULL }
+};
+
+/*
+ * Index of messages for a fast search: numeric commands (3 digits) are
+ * directly indexed by their number, other commands are in a hashtable
+ * (case insensitive).
+ */
+
+struct t_irc_protocol_msg *irc_protocol_messages_numeric[1000];
+struct t_hashtable *irc_protocol_messages_names = NULL;
+
+
+/*
+ * Callback for the hash of a message name (case insensitive).
+ */
+
+unsigned long long
+irc_protocol_message_hash_key_cb (struct t_hashtable *hashtable,
+                                  const void *key)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_hashtable_hash_key_string_range ((const char *)key, 26);
+}
+
+/*
+ * Callback for the comparison of two message names (case insensitive).
+ */
+
+int
+irc_protocol_message_keycmp_cb (struct t_hashtable *hashtable,
+                                const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return weechat_strcasecmp_range ((const char *)key1,
+                                     (const char *)key2, 26);
+}
+
+/*
+ * Returns index of a numeric command with exactly 3 digits (0 to 999),
+ * -1 if the command is not a 3-digit numeric command.
+ */
+
+int
+irc_protocol_message_numeric_index (const char *command)
+{
+    if (!command
+        || !isdigit ((unsigned char)command[0])
+        || !isdigit ((unsigned char)command[1])
+        || !isdigit ((unsigned char)command[2])
+        || command[3])
+    {
+        return -1;
+    }
+
+    return ((command[0] - '0') * 100) + ((command[1] - '0') * 10)
+        + (command[2] - '0');
+}
+
+/*
+ * Searches a message received from IRC server in the index of messages.
+ *
+ * Returns pointer to message found, NULL if not found.
+ */
+
+struct t_irc_protocol_msg *
+irc_protocol_search_message (const char *command)
+{
+    int index;
+
+    if (!command)
+        return NULL;
+
+    index = irc_protocol_message_numeric_index (command);
+    if (index >= 0)
+        return irc_protocol_messages_numeric[index];
+
+    if (!irc_protocol_messages_names)
+        return NULL;
+
+    return weechat_hashtable_get (irc_protocol_messages_names, command);
+}
+
 /*
  * Executes action when an IRC message is received.
  *
- * Argument "irc_message" is the full message without optional tags.
+ * Argument "irc_message" is the message to execute (without tags), nick and
+ * host are read in this message.
+ *
+ * Argument "parsed" is the full message (with optional tags) parsed by
+ * function irc_message_parse_spans before modifier "irc_in2": tags, command
+ * and channel are read in this message (like messages redirected), they are
+ * copied in buffers on the stack (strings are allocated only for tags and
+ * very long fields).
  */
 
 void
 irc_protocol_recv_command (struct t_irc_server *server,
                            const char *irc_message,
-                           const char *msg_tags,
-                           const char *msg_command,
-                           const char *msg_channel)
+                           const struct t_irc_message_parsed *parsed)
 {
-    int i, cmd_found, return_code, argc, decode_color, keep_trailing_spaces;
-    int message_ignored;
-    char *dup_irc_message, *pos_space;
-    struct t_irc_channel *ptr_channel;
+    int return_code, argc, decode_color, keep_trailing_spaces;
+    int message_ignored, length_host;
+    char *dup_irc_message;
+    struct t_irc_channel *ptr_channel, *ptr_batch_channel;
+    struct t_irc_batch *ptr_batch;
+    struct t_irc_protocol_msg *ptr_msg;
     t_irc_recv_func *cmd_recv_func;
-    const char *cmd_name;
+    const char *cmd_name, *nick1, *address1;
     time_t date;
-    const char *nick1, *address1, *host1;
-    char *nick, *address, *address_color, *host, *host_no_color, *host_color;
+    char str_command[64], str_channel[256], str_host[512];
+    char nick[128], address[256];
+    char *msg_tags, *msg_command, *msg_channel, *ptr_nick, *ptr_address;
+    char *address_color, *host, *host_no_color, *host_color;
     char **argv, **argv_eol;
     struct t_hashtable *hash_tags;
-    struct t_irc_protocol_msg irc_protocol_messages[] =
-        { { "account", /* account (cap account-notify) */ 1, 0, &irc_protocol_cb_account },
-          { "authenticate", /* authenticate */ 1, 0, &irc_protocol_cb_authenticate },
-          { "away", /* away (cap away-notify) */ 1, 0, &irc_protocol_cb_away },
-          { "cap", /* client capability */ 1, 0, &irc_protocol_cb_cap },
-          { "error", /* error received from IRC server */ 1, 0, &irc_protocol_cb_error },
-          { "invite", /* invite a nick on a channel */ 1, 0, &irc_protocol_cb_invite },
-          { "join", /* join a channel */ 1, 0, &irc_protocol_cb_join },
-          { "kick", /* forcibly remove a user from a channel */ 1, 1, &irc_protocol_cb_kick },
-          { "kill", /* close client-server connection */ 1, 1, &irc_protocol_cb_kill },
-          { "mode", /* change channel or user mode */ 1, 0, &irc_protocol_cb_mode },
-          { "nick", /* change current nickname */ 1, 0, &irc_protocol_cb_nick },
-          { "notice", /* send notice message to user */ 1, 1, &irc_protocol_cb_notice },
-          { "part", /* leave a channel */ 1, 1, &irc_protocol_cb_part },
-          { "ping", /* ping server */ 1, 0, &irc_protocol_cb_ping },
-          { "pong", /* answer to a ping message */ 1, 0, &irc_protocol_cb_pong },
-          { "privmsg", /* message received */ 1, 1, &irc_protocol_cb_privmsg },
-          { "quit", /* close all connections and quit */ 1, 1, &irc_protocol_cb_quit },
-          { "topic", /* get/set channel topic */ 0, 1, &irc_protocol_cb_topic },
-          { "wallops", /* send a message to all currently connected users who have "
-                          "set the 'w' user mode "
-                          "for themselves */ 1, 1, &irc_protocol_cb_wallops },
-          { "001", /* a server message */ 1, 0, &irc_protocol_cb_001 },
-          { "005", /* a server message */ 1, 0, &irc_protocol_cb_005 },
-          { "008", /* server notice mask */ 1, 0, &irc_protocol_cb_008 },
-          { "221", /* user mode string */ 1, 0, &irc_protocol_cb_221 },
-          { "223", /* whois (charset is) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "264", /* whois (is using encrypted connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "275", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "276", /* whois (has client certificate fingerprint) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "301", /* away message */ 1, 1, &irc_protocol_cb_301 },
-          { "303", /* ison */ 1, 0, &irc_protocol_cb_303 },
-          { "305", /* unaway */ 1, 0, &irc_protocol_cb_305 },
-          { "306", /* now away */ 1, 0, &irc_protocol_cb_306 },
-          { "307", /* whois (registered nick) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "310", /* whois (help mode) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "311", /* whois (user) */ 1, 0, &irc_protocol_cb_311 },
-          { "312", /* whois (server) */ 1, 0, &irc_protocol_cb_312 },
-          { "313", /* whois (operator) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "314", /* whowas */ 1, 0, &irc_protocol_cb_314 },
-          { "315", /* end of /who list */ 1, 0, &irc_protocol_cb_315 },
-          { "317", /* whois (idle) */ 1, 0, &irc_protocol_cb_317 },
-          { "318", /* whois (end) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "319", /* whois (channels) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "320", /* whois (identified user) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "321", /* /list start */ 1, 0, &irc_protocol_cb_321 },
-          { "322", /* channel (for /list) */ 1, 0, &irc_protocol_cb_322 },
-          { "323", /* end of /list */ 1, 0, &irc_protocol_cb_323 },
-          { "324", /* channel mode */ 1, 0, &irc_protocol_cb_324 },
-          { "326", /* whois (has oper privs) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "327", /* whois (host) */ 1, 0, &irc_protocol_cb_327 },
-          { "328", /* channel url */ 1, 0, &irc_protocol_cb_328 },
-          { "329", /* channel creation date */ 1, 0, &irc_protocol_cb_329 },
-          { "330", /* is logged in as */ 1, 0, &irc_protocol_cb_330_343 },
-          { "331", /* no topic for channel */ 1, 0, &irc_protocol_cb_331 },
-          { "332", /* topic of channel */ 0, 1, &irc_protocol_cb_332 },
-          { "333", /* infos about topic (nick and date changed) */ 1, 0, &irc_protocol_cb_333 },
-          { "335", /* is a bot on */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "338", /* whois (host) */ 1, 0, &irc_protocol_cb_338 },
-          { "341", /* inviting */ 1, 0, &irc_protocol_cb_341 },
-          { "343", /* is opered as */ 1, 0, &irc_protocol_cb_330_343 },
-          { "344", /* channel reop */ 1, 0, &irc_protocol_cb_344 },
-          { "345", /* end of channel reop list */ 1, 0, &irc_protocol_cb_345 },
-          { "346", /* invite list */ 1, 0, &irc_protocol_cb_346 },
-          { "347", /* end of invite list */ 1, 0, &irc_protocol_cb_347 },
-          { "348", /* channel exception list */ 1, 0, &irc_protocol_cb_348 },
-          { "349", /* end of channel exception list */ 1, 0, &irc_protocol_cb_349 },
-          { "351", /* server version */ 1, 0, &irc_protocol_cb_351 },
-          { "352", /* who */ 1, 0, &irc_protocol_cb_352 },
-          { "353", /* list of nicks on channel */ 1, 0, &irc_protocol_cb_353 },
-          { "354", /* whox */ 1, 0, &irc_protocol_cb_354 },
-          { "366", /* end of /names list */ 1, 0, &irc_protocol_cb_366 },
-          { "367", /* banlist */ 1, 0, &irc_protocol_cb_367 },
-          { "368", /* end of banlist */ 1, 0, &irc_protocol_cb_368 },
-          { "369", /* whowas (end) */ 1, 0, &irc_protocol_cb_whowas_nick_msg },
-          { "378", /* whois (connecting from) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "379", /* whois (using modes) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "401", /* no such nick/channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "402", /* no such server */ 1, 0, &irc_protocol_cb_generic_error },
-          { "403", /* no such channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "404", /* cannot send to channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "405", /* too many channels */ 1, 0, &irc_protocol_cb_generic_error },
-          { "406", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
-          { "407", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
-          { "409", /* no origin */ 1, 0, &irc_protocol_cb_generic_error },
-          { "410", /* no services */ 1, 0, &irc_protocol_cb_generic_error },
-          { "411", /* no recipient */ 1, 0, &irc_protocol_cb_generic_error },
-          { "412", /* no text to send */ 1, 0, &irc_protocol_cb_generic_error },
-          { "413", /* no toplevel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "414", /* wilcard in toplevel domain */ 1, 0, &irc_protocol_cb_generic_error },
-          { "421", /* unknown command */ 1, 0, &irc_protocol_cb_generic_error },
-          { "422", /* MOTD is missing */ 1, 0, &irc_protocol_cb_generic_error },
-          { "423", /* no administrative info */ 1, 0, &irc_protocol_cb_generic_error },
-          { "424", /* file error */ 1, 0, &irc_protocol_cb_generic_error },
-          { "431", /* no nickname given */ 1, 0, &irc_protocol_cb_generic_error },
-          { "432", /* erroneous nickname */ 1, 0, &irc_protocol_cb_432 },
-          { "433", /* nickname already in use */ 1, 0, &irc_protocol_cb_433 },
-          { "436", /* nickname collision */ 1, 0, &irc_protocol_cb_generic_error },
-          { "437", /* nick/channel unavailable */ 1, 0, &irc_protocol_cb_437 },
-          { "438", /* not authorized to change nickname */ 1, 0, &irc_protocol_cb_438 },
-          { "441", /* user not in channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "442", /* not on channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "443", /* user already on channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "444", /* user not logged in */ 1, 0, &irc_protocol_cb_generic_error },
-          { "445", /* summon has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
-          { "446", /* users has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
-          { "451", /* you are not registered */ 1, 0, &irc_protocol_cb_generic_error },
-          { "461", /* not enough parameters */ 1, 0, &irc_protocol_cb_generic_error },
-          { "462", /* you may not register */ 1, 0, &irc_protocol_cb_generic_error },
-          { "463", /* your host isn't among the privileged */ 1, 0, &irc_protocol_cb_generic_error },
-          { "464", /* password incorrect */ 1, 0, &irc_protocol_cb_generic_error },
-          { "465", /* you are banned from this server */ 1, 0, &irc_protocol_cb_generic_error },
-          { "467", /* channel key already set */ 1, 0, &irc_protocol_cb_generic_error },
-          { "470", /* forwarding to another channel */ 1, 0, &irc_protocol_cb_470 },
-          { "471", /* channel is already full */ 1, 0, &irc_protocol_cb_generic_error },
-          { "472", /* unknown mode char to me */ 1, 0, &irc_protocol_cb_generic_error },
-          { "473", /* cannot join channel (invite only) */ 1, 0, &irc_protocol_cb_generic_error },
-          { "474", /* cannot join channel (banned from channel) */ 1, 0, &irc_protocol_cb_generic_error },
-          { "475", /* cannot join channel (bad channel key) */ 1, 0, &irc_protocol_cb_generic_error },
-          { "476", /* bad channel mask */ 1, 0, &irc_protocol_cb_generic_error },
-          { "477", /* channel doesn't support modes */ 1, 0, &irc_protocol_cb_generic_error },
-          { "481", /* you're not an IRC operator */ 1, 0, &irc_protocol_cb_generic_error },
-          { "482", /* you're not channel operator */ 1, 0, &irc_protocol_cb_generic_error },
-          { "483", /* you can't kill a server! */ 1, 0, &irc_protocol_cb_generic_error },
-          { "484", /* your connection is restricted! */ 1, 0, &irc_protocol_cb_generic_error },
-          { "485", /* user is immune from kick/deop */ 1, 0, &irc_protocol_cb_generic_error },
-          { "487", /* network split */ 1, 0, &irc_protocol_cb_generic_error },
-          { "491", /* no O-lines for your host */ 1, 0, &irc_protocol_cb_generic_error },
-          { "501", /* unknown mode flag */ 1, 0, &irc_protocol_cb_generic_error },
-          { "502", /* can't change mode for other users */ 1, 0, &irc_protocol_cb_generic_error },
-          { "671", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "728", /* quietlist */ 1, 0, &irc_protocol_cb_728 },
-          { "729", /* end of quietlist */ 1, 0, &irc_protocol_cb_729 },
-          { "730", /* monitored nicks online */ 1, 0, &irc_protocol_cb_730 },
-          { "731", /* monitored nicks offline */ 1, 0, &irc_protocol_cb_731 },
-          { "732", /* list of monitored nicks */ 1, 0, &irc_protocol_cb_732 },
-          { "733", /* end of monitor list */ 1, 0, &irc_protocol_cb_733 },
-          { "734", /* monitor list is full */ 1, 0, &irc_protocol_cb_734 },
-          { "900", /* logged in as (SASL) */ 1, 0, &irc_protocol_cb_900 },
-          { "901", /* you are now logged in */ 1, 0, &irc_protocol_cb_901 },
-          { "902", /* SASL authentication failed (account locked/held) */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "903", /* SASL authentication successful */ 1, 0, &irc_protocol_cb_sasl_end_ok },
-          { "904", /* SASL authentication failed */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "905", /* SASL message too long */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "906", /* SASL authentication aborted */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "907", /* You have already completed SASL authentication */ 1, 0, &irc_protocol_cb_sasl_end_ok },
-          { "936", /* censored word */ 1, 0, &irc_protocol_cb_generic_error },
-          { "973", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
-          { "974", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
-          { "975", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
-          { NULL, 0, 0, NULL }
-        };
 
-    if (!msg_command)
+    if (!irc_message || !parsed || !parsed->message
+        || (parsed->command.pos < 0))
+    {
         return;
+    }
 
     dup_irc_message = NULL;
     argv = NULL;
     argv_eol = NULL;
     hash_tags = NULL;
     date = 0;
+    host = NULL;
+    address_color = NULL;
+    host_no_color = NULL;
+    host_color = NULL;
+
+    msg_command = irc_message_span_get (parsed, &parsed->command,
+                                        str_command, sizeof (str_command));
+    msg_channel = irc_message_span_get (parsed, &parsed->channel,
+                                        str_channel, sizeof (str_channel));
+    if (!msg_command)
+        goto end;
 
     /* get tags as hashtable */
+    msg_tags = irc_message_span_dup (parsed, &parsed->tags);
     if (msg_tags)
     {
         hash_tags = irc_protocol_get_message_tags (msg_tags);
         if (hash_tags)
             date = irc_protocol_get_message_tag_time (hash_tags);
+        free (msg_tags);
     }
 
     /* get nick/host/address from IRC message */
-    nick1 = NULL;
-    address1 = NULL;
-    host1 = NULL;
-    if (irc_message && (irc_message[0] == ':'))
+    ptr_nick = NULL;
+    ptr_address = NULL;
+    if (irc_message[0] == ':')
     {
         nick1 = irc_message_get_nick_from_host (irc_message);
         address1 = irc_message_get_address_from_host (irc_message);
-        host1 = irc_message + 1;
+        if (nick1)
+        {
+            snprintf (nick, sizeof (nick), "%s", nick1);
+            ptr_nick = nick;
+        }
+        if (address1)
+        {
+            snprintf (address, sizeof (address), "%s", address1);
+            ptr_address = address;
+        }
+        length_host = strcspn (irc_message + 1, " ");
+        if (length_host < (int)sizeof (str_host))
+        {
+            memcpy (str_host, irc_message + 1, length_host);
+            str_host[length_host] = '\0';
+            host = str_host;
+        }
+        else
+        {
+            host = weechat_strndup (irc_message + 1, length_host);
+        }
     }
-    nick = (nick1) ? strdup (nick1) : NULL;
-    address = (address1) ? strdup (address1) : NULL;
-    address_color = (address) ?
+    address_color = (ptr_address) ?
         irc_color_decode (
-            address,
+            ptr_address,
             weechat_config_boolean (irc_config_network_colors_receive)) :
         NULL;
-    host = (host1) ? strdup (host1) : NULL;
-    if (host)
-    {
-        pos_space = strchr (host, ' ');
-        if (pos_space)
-            pos_space[0] = '\0';
-    }
     host_no_color = (host) ? irc_color_decode (host, 0) : NULL;
     host_color = (host) ?
         irc_color_decode (
@@ -5909,7 +6100,28 @@ irc_protocol_recv_command (struct t_irc_server *server,
     message_ignored = irc_ignore_check (
         server,
         (ptr_channel) ? ptr_channel->name : msg_channel,
-        nick, host_no_color);
+        ptr_nick, host_no_color);
+
+    /*
+     * if message is part of a batch, lines displayed in channel/private
+     * buffer are added in batch (until the end of batch)
+     */
+    ptr_batch = (hash_tags) ?
+        irc_batch_search (server,
+                          weechat_hashtable_get (hash_tags, "batch")) : NULL;
+    if (ptr_batch)
+    {
+        ptr_batch->messages_count++;
+        ptr_batch_channel = ptr_channel;
+        if (!ptr_batch_channel && ptr_nick && msg_channel
+            && !irc_channel_is_channel (server, msg_channel))
+        {
+            /* private message received: buffer is the one of sender */
+            ptr_batch_channel = irc_channel_search (server, ptr_nick);
+        }
+        if (ptr_batch_channel && ptr_batch_channel->buffer)
+            irc_batch_add_buffer (server, ptr_batch, ptr_batch_channel->buffer);
+    }
 
     /* send signal with received command, even if command is ignored */
     irc_server_send_signal (server, "irc_raw_in", msg_command,
@@ -5923,19 +6135,10 @@ irc_protocol_recv_command (struct t_irc_server *server,
     }
 
     /* look for IRC command */
-    cmd_found = -1;
-    for (i = 0; irc_protocol_messages[i].name; i++)
-    {
-        if (weechat_strcasecmp (irc_protocol_messages[i].name,
-                                msg_command) == 0)
-        {
-            cmd_found = i;
-            break;
-        }
-    }
+    ptr_msg = irc_protocol_search_message (msg_command);
 
     /* command not found */
-    if (cmd_found < 0)
+    if (!ptr_msg)
     {
         /* for numeric commands, we use default recv function */
         if (irc_protocol_is_numeric_command (msg_command))
@@ -5959,35 +6162,26 @@ irc_protocol_recv_command (struct t_irc_server *server,
     }
     else
     {
-        cmd_name = irc_protocol_messages[cmd_found].name;
-        decode_color = irc_protocol_messages[cmd_found].decode_color;
-        keep_trailing_spaces = irc_protocol_messages[cmd_found].keep_trailing_spaces;
-        cmd_recv_func = irc_protocol_messages[cmd_found].recv_function;
+        cmd_name = ptr_msg->name;
+        decode_color = ptr_msg->decode_color;
+        keep_trailing_spaces = ptr_msg->keep_trailing_spaces;
+        cmd_recv_func = ptr_msg->recv_function;
     }
 
     if (cmd_recv_func != NULL)
     {
-        if (irc_message)
+        if (decode_color)
         {
-            if (decode_color)
-            {
-                dup_irc_message = irc_color_decode (
-                    irc_message,
-                    weechat_config_boolean (irc_config_network_colors_receive));
-            }
-            else
-            {
-                dup_irc_message = strdup (irc_message);
-            }
+            dup_irc_message = irc_color_decode (
+                irc_message,
+                weechat_config_boolean (irc_config_network_colors_receive));
         }
-        else
-            dup_irc_message = NULL;
-        argv = weechat_string_split (dup_irc_message, " ", 0, 0, &argc);
-        argv_eol = weechat_string_split (dup_irc_message, " ",
-                                         1 + keep_trailing_spaces, 0, NULL);
+        argv = irc_message_split_args (
+            (dup_irc_message) ? dup_irc_message : irc_message,
+            keep_trailing_spaces, &argc, &argv_eol);
 
         return_code = (int) (cmd_recv_func) (server,
-                                             date, nick, address_color,
+                                             date, ptr_nick, address_color,
                                              host_color, cmd_name,
                                              message_ignored, argc, argv,
                                              argv_eol);
@@ -6017,13 +6211,9 @@ irc_protocol_recv_command (struct t_irc_server *server,
                             irc_message, NULL);
 
 end:
-    if (nick)
-        free (nick);
-    if (address)
-        free (address);
     if (address_color)
         free (address_color);
-    if (host)
+    if (host && (host != str_host))
         free (host);
     if (host_no_color)
         free (host_no_color);
@@ -6032,9 +6222,64 @@ end:
     if (dup_irc_message)
         free (dup_irc_message);
     if (argv)
-        weechat_string_free_split (argv);
-    if (argv_eol)
-        weechat_string_free_split (argv_eol);
+        free (argv);
     if (hash_tags)
         weechat_hashtable_free (hash_tags);
+    if (msg_command && (msg_command != str_command))
+        free (msg_command);
+    if (msg_channel && (msg_channel != str_channel))
+        free (msg_channel);
+}
+
+/*
+ * Builds the index of messages received from IRC server.
+ */
+
+void
+irc_protocol_init ()
+{
+    int i, index;
+
+    memset (irc_protocol_messages_numeric, 0,
+            sizeof (irc_protocol_messages_numeric));
+
+    irc_protocol_messages_names = weechat_hashtable_new (
+        64,
+        WEECHAT_HASHTABLE_STRING,
+        WEECHAT_HASHTABLE_POINTER,
+        &irc_protocol_message_hash_key_cb,
+        &irc_protocol_message_keycmp_cb);
+
+    for (i = 0; irc_protocol_messages[i].name; i++)
+    {
+        index = irc_protocol_message_numeric_index (
+            irc_protocol_messages[i].name);
+        if (index >= 0)
+        {
+            irc_protocol_messages_numeric[index] = &irc_protocol_messages[i];
+        }
+        else if (irc_protocol_messages_names)
+        {
+            weechat_hashtable_set (irc_protocol_messages_names,
+                                   irc_protocol_messages[i].name,
+                                   &irc_protocol_messages[i]);
+        }
+    }
+}
+
+/*
+ * Frees the index of messages received from IRC server.
+ */
+
+void
+irc_protocol_end ()
+{
+    memset (irc_protocol_messages_numeric, 0,
+            sizeof (irc_protocol_messages_numeric));
+
+    if (irc_protocol_messages_names)
+    {
+        weechat_hashtable_free (irc_protocol_messages_names);
+        irc_protocol_messages_names = NULL;
+    }
 }
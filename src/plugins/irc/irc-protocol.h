@@ -67,6 +67,7 @@
     }
 
 struct t_irc_server;
+struct t_irc_message_parsed;
 
 typedef int (t_irc_recv_func)(struct t_irc_server *server,
                               time_t date, const char *nick,
@@ -87,8 +88,8 @@ extern const char *irc_protocol_tags (const char *command, const char *tags,
                                       const char *nick, const char *address);
 extern void irc_protocol_recv_command (struct t_irc_server *server,
                                        const char *irc_message,
-                                       const char *msg_tags,
-                                       const char *msg_command,
-                                       const char *msg_channel);
+                                       const struct t_irc_message_parsed *parsed);
+extern void irc_protocol_init ();
+extern void irc_protocol_end ();
 
 #endif /* WEECHAT_IRC_PROTOCOL_H */
@@ -28,6 +28,7 @@
 
 #include "../weechat-plugin.h"
 #include "irc.h"
+#include "irc-message.h"
 #include "irc-redirect.h"
 #include "irc-server.h"
 
@@ -773,6 +774,10 @@ irc_redirect_stop (struct t_irc_redirect *redirect, const char *error)
  * Tries to redirect a received message (from IRC server) to a redirect in
  * server.
  *
+ * Argument "message" is the message added to output of redirect, "parsed" is
+ * the message parsed before modifier "irc_in2" (command and arguments are
+ * read in this message).
+ *
  * Returns:
  *   1: message has been redirected (irc plugin will discard message)
  *   0: no matching redirect was found
@@ -780,21 +785,30 @@ irc_redirect_stop (struct t_irc_redirect *redirect, const char *error)
 
 int
 irc_redirect_message (struct t_irc_server *server, const char *message,
-                      const char *command, const char *arguments)
+                      const struct t_irc_message_parsed *parsed)
 {
     struct t_irc_redirect *ptr_redirect, *ptr_next_redirect;
     int rc, match_stop, arguments_argc;
-    char **arguments_argv;
+    char *command, **arguments_argv;
 
-    if (!server || !server->redirects || !message || !command)
+    /* fields of message are copied only if there are redirects */
+    if (!server || !server->redirects || !message || !parsed
+        || !parsed->message || (parsed->command.pos < 0))
+    {
         return 0;
+    }
 
     rc = 0;
 
-    if (arguments && arguments[0])
+    command = irc_message_span_dup (parsed, &parsed->command);
+    if (!command)
+        return 0;
+
+    if (parsed->arguments.pos >= 0)
     {
-        arguments_argv = weechat_string_split (arguments, " ", 0, 0,
-                                               &arguments_argc);
+        arguments_argv = weechat_string_split (
+            parsed->message + parsed->arguments.pos, " ", 0, 0,
+            &arguments_argc);
     }
     else
     {
@@ -900,6 +914,7 @@ irc_redirect_message (struct t_irc_server *server, const char *message,
     }
 
 end:
+    free (command);
     if (arguments_argv)
         weechat_string_free_split (arguments_argv);
 
@@ -25,6 +25,7 @@
 #define IRC_REDIRECT_TIMEOUT_DEFAULT 60
 
 struct t_irc_server;
+struct t_irc_message_parsed;
 
 /* template for redirections (IRC plugin creates some templates at startup) */
 
@@ -107,8 +108,8 @@ extern void irc_redirect_init_command (struct t_irc_redirect *redirect,
 extern void irc_redirect_stop (struct t_irc_redirect *redirect,
                                const char *error);
 extern int irc_redirect_message (struct t_irc_server *server,
-                                 const char *message, const char *command,
-                                 const char *arguments);
+                                 const char *message,
+                                 const struct t_irc_message_parsed *parsed);
 extern void irc_redirect_free (struct t_irc_redirect *redirect);
 extern void irc_redirect_free_all (struct t_irc_server *server);
 extern struct t_hdata *irc_redirect_hdata_redirect_pattern_cb (const void *pointer,
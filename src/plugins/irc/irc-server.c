@@ -52,6 +52,7 @@
 #include "irc.h"
 #include "irc-server.h"
 #include "irc-bar-item.h"
+#include "irc-batch.h"
 #include "irc-buffer.h"
 #include "irc-channel.h"
 #include "irc-color.h"
@@ -70,8 +71,6 @@
 struct t_irc_server *irc_servers = NULL;
 struct t_irc_server *last_irc_server = NULL;
 
-struct t_irc_message *irc_recv_msgq = NULL;
-struct t_irc_message *irc_msgq_last_msg = NULL;
 
 char *irc_server_sasl_fail_string[IRC_SERVER_NUM_SASL_FAIL] =
 { "continue", "reconnect", "disconnect" };
@@ -111,6 +110,7 @@ char *irc_server_options[IRC_SERVER_NUM_OPTIONS][2] =
   { "connection_timeout",   "60"                      },
   { "anti_flood_prio_high", "2"                       },
   { "anti_flood_prio_low",  "2"                       },
+  { "anti_flood_burst",     "5"                       },
   { "away_check",           "0"                       },
   { "away_check_max_nicks", "25"                      },
   { "msg_kick",             ""                        },
@@ -122,6 +122,9 @@ char *irc_server_options[IRC_SERVER_NUM_OPTIONS][2] =
 char *irc_server_casemapping_string[IRC_SERVER_NUM_CASEMAPPING] =
 { "rfc1459", "strict-rfc1459", "ascii" };
 
+char *irc_server_outqueue_prio_string[IRC_SERVER_NUM_OUTQUEUES_PRIO] =
+{ "high", "low", "background" };
+
 char *irc_server_prefix_modes_default = "ov";
 char *irc_server_prefix_chars_default = "@+";
 char *irc_server_chanmodes_default    = "beI,k,l";
@@ -1123,7 +1126,12 @@ irc_server_alloc (const char *name)
     new_server->is_connected = 0;
     new_server->ssl_connected = 0;
     new_server->disconnected = 0;
-    new_server->unterminated_message = NULL;
+    new_server->recv_buffer = NULL;
+    new_server->recv_buffer_size = 0;
+    new_server->recv_buffer_length = 0;
+    new_server->recv_buffer_batch = NULL;
+    new_server->recv_buffer_batch_size = 0;
+    new_server->recv_buffer_flushing = 0;
     new_server->nicks_count = 0;
     new_server->nicks_array = NULL;
     new_server->nick_first_tried = 0;
@@ -1165,12 +1173,24 @@ irc_server_alloc (const char *name)
     {
         new_server->outqueue[i] = NULL;
         new_server->last_outqueue[i] = NULL;
-    }
+        new_server->outqueue_last_sent[i] = 0;
+    }
+    new_server->anti_flood_time.tv_sec = 0;
+    new_server->anti_flood_time.tv_usec = 0;
+    new_server->outqueue_sent = 0;
+    new_server->outqueue_merged = 0;
+    new_server->outqueue_wait_total = 0;
+    new_server->outqueue_wait_max = 0;
     new_server->redirects = NULL;
     new_server->last_redirect = NULL;
+    new_server->batches = NULL;
+    new_server->last_batch = NULL;
     new_server->notify_list = NULL;
     new_server->last_notify = NULL;
     new_server->notify_count = 0;
+    new_server->notify_index = NULL;
+    new_server->notify_queries_sent = 0;
+    new_server->notify_state_changes = 0;
     new_server->join_manual = weechat_hashtable_new (
         32,
         WEECHAT_HASHTABLE_STRING,
@@ -1497,6 +1517,125 @@ irc_server_apply_command_line_options (struct t_irc_server *server,
     }
 }
 
+/*
+ * Gets targets in a message that can be merged with another message (command
+ * with a list of targets separated by commas):
+ *   "JOIN #chan1,#chan2" (only without keys)
+ *   "MONITOR + nick1,nick2"
+ *   "MONITOR - nick1,nick2"
+ *
+ * Argument "length_prefix" is set with the length of string before targets
+ * (for example 5 for "JOIN "), "length_targets" is set with the length of
+ * targets.
+ *
+ * Returns pointer to targets in message, NULL if the message can not be
+ * merged.
+ */
+
+const char *
+irc_server_outqueue_merge_targets (const char *message, int *length_prefix,
+                                   int *length_targets)
+{
+    const char *ptr_targets;
+    int length;
+
+    if (weechat_strncasecmp (message, "JOIN ", 5) == 0)
+        ptr_targets = message + 5;
+    else if ((weechat_strncasecmp (message, "MONITOR + ", 10) == 0)
+             || (weechat_strncasecmp (message, "MONITOR - ", 10) == 0))
+        ptr_targets = message + 10;
+    else
+        return NULL;
+
+    /* targets must be the last argument ("JOIN 0" is not merged) */
+    length = strcspn (ptr_targets, " \r\n");
+    if ((length == 0) || (ptr_targets[length] == ' ')
+        || ((length == 1) && (ptr_targets[0] == '0')))
+    {
+        return NULL;
+    }
+
+    *length_prefix = ptr_targets - message;
+    *length_targets = length;
+
+    return ptr_targets;
+}
+
+/*
+ * Merges a message with the last message of a queue, if both messages have
+ * the same command with a list of targets (see function
+ * irc_server_outqueue_merge_targets), and if the merged message is not too
+ * long: for example "JOIN #chan1" + "JOIN #chan2" = "JOIN #chan1,#chan2".
+ *
+ * Returns:
+ *   1: message merged in last message of queue
+ *   0: message not merged (it must be added in queue)
+ */
+
+int
+irc_server_outqueue_merge (struct t_irc_server *server, int priority,
+                           const char *command, const char *message,
+                           const char *tags)
+{
+    struct t_irc_outqueue *ptr_last;
+    const char *ptr_targets, *ptr_last_targets;
+    char *new_message;
+    int length_prefix, length_targets, length_last_prefix;
+    int length_last_targets, length;
+
+    ptr_last = server->last_outqueue[priority];
+    if (!ptr_last || !command || !message
+        || !ptr_last->message_after_mod || ptr_last->message_before_mod
+        || ptr_last->modified || ptr_last->redirect || !ptr_last->command
+        || (weechat_strcasecmp (ptr_last->command, command) != 0))
+    {
+        return 0;
+    }
+
+    /* tags must be the same */
+    if ((tags && !ptr_last->tags) || (!tags && ptr_last->tags)
+        || (tags && (strcmp (tags, ptr_last->tags) != 0)))
+    {
+        return 0;
+    }
+
+    ptr_targets = irc_server_outqueue_merge_targets (message,
+                                                     &length_prefix,
+                                                     &length_targets);
+    ptr_last_targets = irc_server_outqueue_merge_targets (
+        ptr_last->message_after_mod,
+        &length_last_prefix,
+        &length_last_targets);
+    if (!ptr_targets || !ptr_last_targets
+        || (length_prefix != length_last_prefix)
+        || (weechat_strncasecmp (message, ptr_last->message_after_mod,
+                                 length_prefix) != 0))
+    {
+        return 0;
+    }
+
+    length = length_last_prefix + length_last_targets + 1 + length_targets;
+    if (length > IRC_SERVER_MSG_MAX_LENGTH)
+        return 0;
+
+    new_message = malloc (length + 2 + 1);
+    if (!new_message)
+        return 0;
+    memcpy (new_message, ptr_last->message_after_mod,
+            length_last_prefix + length_last_targets);
+    new_message[length_last_prefix + length_last_targets] = ',';
+    memcpy (new_message + length_last_prefix + length_last_targets + 1,
+            ptr_targets, length_targets);
+    memcpy (new_message + length, "\r\n", 3);
+
+    free (ptr_last->message_after_mod);
+    ptr_last->message_after_mod = new_message;
+
+    server->outqueue_merged++;
+
+    return 1;
+}
+
 /*
  * Adds a message in out queue.
  */
@@ -1509,6 +1648,13 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
 {
     struct t_irc_outqueue *new_outqueue;
 
+    /* merge message with last message of queue (if possible) */
+    if (!msg1 && !modified && !redirect
+        && irc_server_outqueue_merge (server, priority, command, msg2, tags))
+    {
+        return;
+    }
+
     new_outqueue = malloc (sizeof (*new_outqueue));
     if (new_outqueue)
     {
@@ -1518,6 +1664,7 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
         new_outqueue->modified = modified;
         new_outqueue->tags = (tags) ? strdup (tags) : NULL;
         new_outqueue->redirect = redirect;
+        gettimeofday (&(new_outqueue->date_queued), NULL);
 
         new_outqueue->prev_outqueue = server->last_outqueue[priority];
         new_outqueue->next_outqueue = NULL;
@@ -1586,6 +1733,67 @@ irc_server_outqueue_free_all (struct t_irc_server *server, int priority)
     }
 }
 
+/*
+ * Ensures that receive buffer of server has at least "length" bytes free
+ * (plus one byte for final '\0'); the buffer size is doubled when it is full.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+irc_server_recv_buffer_alloc (struct t_irc_server *server, int length)
+{
+    char *new_buffer;
+    int new_size;
+
+    if (server->recv_buffer
+        && (server->recv_buffer_length + length < server->recv_buffer_size))
+    {
+        return 1;
+    }
+
+    new_size = (server->recv_buffer_size > 0) ?
+        server->recv_buffer_size : IRC_SERVER_RECV_BUFFER_READ_SIZE;
+    while (server->recv_buffer_length + length >= new_size)
+    {
+        new_size *= 2;
+    }
+
+    new_buffer = realloc (server->recv_buffer, new_size);
+    if (!new_buffer)
+        return 0;
+    if (!server->recv_buffer)
+        new_buffer[0] = '\0';
+    server->recv_buffer = new_buffer;
+    server->recv_buffer_size = new_size;
+
+    return 1;
+}
+
+/*
+ * Frees receive buffers of server.
+ */
+
+void
+irc_server_recv_buffer_free (struct t_irc_server *server)
+{
+    if (server->recv_buffer)
+    {
+        free (server->recv_buffer);
+        server->recv_buffer = NULL;
+    }
+    server->recv_buffer_size = 0;
+    server->recv_buffer_length = 0;
+    if (server->recv_buffer_batch)
+    {
+        free (server->recv_buffer_batch);
+        server->recv_buffer_batch = NULL;
+    }
+    server->recv_buffer_batch_size = 0;
+}
+
 /*
  * Frees server data.
  */
@@ -1604,6 +1812,7 @@ irc_server_free_data (struct t_irc_server *server)
         irc_server_outqueue_free_all (server, i);
     }
     irc_redirect_free_all (server);
+    irc_batch_end_all (server);
     irc_notify_free_all (server);
     irc_channel_free_all (server);
 
@@ -1611,6 +1820,8 @@ irc_server_free_data (struct t_irc_server *server)
     weechat_hashtable_free (server->join_manual);
     weechat_hashtable_free (server->join_channel_key);
     weechat_hashtable_free (server->join_noswitch);
+    if (server->notify_index)
+        weechat_hashtable_free (server->notify_index);
 
     /* free server data */
     for (i = 0; i < IRC_SERVER_NUM_OPTIONS; i++)
@@ -1638,8 +1849,7 @@ irc_server_free_data (struct t_irc_server *server)
         weechat_unhook (server->hook_timer_connection);
     if (server->hook_timer_sasl)
         weechat_unhook (server->hook_timer_sasl);
-    if (server->unterminated_message)
-        free (server->unterminated_message);
+    irc_server_recv_buffer_free (server);
     if (server->nicks_array)
         weechat_string_free_split (server->nicks_array);
     if (server->nick)
@@ -2081,94 +2291,207 @@ irc_server_get_tags_to_send (const char *tags)
 }
 
 /*
- * Sends a message from out queue.
+ * Gets number of messages that can be sent now to server, without being
+ * queued (tokens in anti-flood bucket).
+ *
+ * The bucket has a size of "anti_flood_burst" messages and gets one more
+ * message every "anti_flood_prio_high" seconds; it is implemented with the
+ * theoretical time of next message if bucket is empty (anti_flood_time).
  */
 
-void
-irc_server_outqueue_send (struct t_irc_server *server)
+int
+irc_server_anti_flood_tokens (struct t_irc_server *server)
 {
-    time_t time_now;
-    char *pos, *tags_to_send;
-    int priority, anti_flood;
-
-    time_now = time (NULL);
+    struct timeval tv_now;
+    long long interval, diff;
+    int burst, tokens;
+
+    burst = IRC_SERVER_OPTION_INTEGER(server,
+                                      IRC_SERVER_OPTION_ANTI_FLOOD_BURST);
+    interval = IRC_SERVER_OPTION_INTEGER(
+        server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH) * 1000000LL;
+    if (interval <= 0)
+        return burst;
+
+    gettimeofday (&tv_now, NULL);
+    diff = weechat_util_timeval_diff (&tv_now, &(server->anti_flood_time));
+    if (diff <= 0)
+        return burst;
 
     /* detect if system clock has been changed (now lower than before) */
-    if (server->last_user_message > time_now)
-        server->last_user_message = time_now;
+    if (diff > burst * interval)
+    {
+        server->anti_flood_time = tv_now;
+        return burst;
+    }
 
-    for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+    tokens = burst - (int)((diff + interval - 1) / interval);
+
+    return (tokens > 0) ? tokens : 0;
+}
+
+/*
+ * Checks if a message with given priority can be sent now to server: a token
+ * must be available in anti-flood bucket and for low priorities, the delay
+ * "anti_flood_prio_low" must be elapsed since the last message sent with the
+ * same priority.
+ *
+ * Returns:
+ *   1: message can be sent now
+ *   0: message must be queued
+ */
+
+int
+irc_server_anti_flood_can_send (struct t_irc_server *server, int priority)
+{
+    time_t time_now;
+    int anti_flood;
+
+    if (irc_server_anti_flood_tokens (server) < 1)
+        return 0;
+
+    if (priority > 0)
     {
-        switch (priority)
+        anti_flood = IRC_SERVER_OPTION_INTEGER(
+            server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
+        time_now = time (NULL);
+
+        /* detect if system clock has been changed (now lower than before) */
+        if (server->outqueue_last_sent[priority] > time_now)
+            server->outqueue_last_sent[priority] = time_now;
+
+        if ((anti_flood > 0)
+            && (time_now - server->outqueue_last_sent[priority] < anti_flood))
         {
-            case 0:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(
-                    server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                break;
-            default:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(
-                    server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                break;
+            return 0;
         }
-        if (server->outqueue[priority]
-            && (time_now >= server->last_user_message + anti_flood))
+    }
+
+    return 1;
+}
+
+/*
+ * Removes a token from anti-flood bucket after a message has been sent with
+ * given priority.
+ */
+
+void
+irc_server_anti_flood_sent (struct t_irc_server *server, int priority)
+{
+    struct timeval tv_now;
+    long long interval;
+
+    gettimeofday (&tv_now, NULL);
+
+    interval = IRC_SERVER_OPTION_INTEGER(
+        server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH) * 1000000LL;
+    if (interval > 0)
+    {
+        if (weechat_util_timeval_diff (&tv_now, &(server->anti_flood_time)) < 0)
+            server->anti_flood_time = tv_now;
+        weechat_util_timeval_add (&(server->anti_flood_time), interval);
+    }
+
+    server->outqueue_last_sent[priority] = tv_now.tv_sec;
+    server->last_user_message = tv_now.tv_sec;
+}
+
+/*
+ * Sends messages from out queues (highest priority first), as long as
+ * anti-flood allows it.
+ */
+
+void
+irc_server_outqueue_send (struct t_irc_server *server)
+{
+    struct t_irc_outqueue *ptr_outqueue;
+    struct timeval tv_now;
+    char *pos, *tags_to_send;
+    int priority, wait_time;
+
+    for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+    {
+        while (server->is_connected && server->outqueue[priority]
+               && irc_server_anti_flood_can_send (server, priority))
         {
-            if (server->outqueue[priority]->message_before_mod)
+            ptr_outqueue = server->outqueue[priority];
+            if (ptr_outqueue->message_before_mod)
             {
-                pos = strchr (server->outqueue[priority]->message_before_mod,
-                              '\r');
+                pos = strchr (ptr_outqueue->message_before_mod, '\r');
                 if (pos)
                     pos[0] = '\0';
                 irc_raw_print (server, IRC_RAW_FLAG_SEND,
-                               server->outqueue[priority]->message_before_mod);
+                               ptr_outqueue->message_before_mod);
                 if (pos)
                     pos[0] = '\r';
             }
-            if (server->outqueue[priority]->message_after_mod)
+            if (ptr_outqueue->message_after_mod)
             {
-                pos = strchr (server->outqueue[priority]->message_after_mod,
-                              '\r');
+                pos = strchr (ptr_outqueue->message_after_mod, '\r');
                 if (pos)
                     pos[0] = '\0';
                 irc_raw_print (server, IRC_RAW_FLAG_SEND |
-                               ((server->outqueue[priority]->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
-                               server->outqueue[priority]->message_after_mod);
+                               ((ptr_outqueue->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
+                               ptr_outqueue->message_after_mod);
                 if (pos)
                     pos[0] = '\r';
 
                 /* send signal with command that will be sent to server */
                 irc_server_send_signal (
                     server, "irc_out",
-                    server->outqueue[priority]->command,
-                    server->outqueue[priority]->message_after_mod,
+                    ptr_outqueue->command,
+                    ptr_outqueue->message_after_mod,
                     NULL);
+
+                /* the queue may have been freed by a callback (disconnection) */
+                if (server->outqueue[priority] != ptr_outqueue)
+                    return;
+
                 tags_to_send = irc_server_get_tags_to_send (
-                    server->outqueue[priority]->tags);
+                    ptr_outqueue->tags);
                 irc_server_send_signal (
                     server, "irc_outtags",
-                    server->outqueue[priority]->command,
-                    server->outqueue[priority]->message_after_mod,
+                    ptr_outqueue->command,
+                    ptr_outqueue->message_after_mod,
                     (tags_to_send) ? tags_to_send : "");
                 if (tags_to_send)
                     free (tags_to_send);
 
+                /* the queue may have been freed by a callback (disconnection) */
+                if (server->outqueue[priority] != ptr_outqueue)
+                    return;
+
                 /* send command */
                 irc_server_send (
-                    server, server->outqueue[priority]->message_after_mod,
-                    strlen (server->outqueue[priority]->message_after_mod));
-                server->last_user_message = time_now;
+                    server, ptr_outqueue->message_after_mod,
+                    strlen (ptr_outqueue->message_after_mod));
+                irc_server_anti_flood_sent (server, priority);
+
+                /* the queue is freed if sending failed (disconnection) */
+                if (server->outqueue[priority] != ptr_outqueue)
+                    return;
+
+                /* update statistics on queues */
+                gettimeofday (&tv_now, NULL);
+                wait_time = (int)(weechat_util_timeval_diff (
+                                      &(ptr_outqueue->date_queued),
+                                      &tv_now) / 1000);
+                server->outqueue_sent++;
+                server->outqueue_wait_total += wait_time;
+                if (wait_time > server->outqueue_wait_max)
+                    server->outqueue_wait_max = wait_time;
 
                 /* start redirection if redirect is set */
-                if (server->outqueue[priority]->redirect)
+                if (ptr_outqueue->redirect)
                 {
                     irc_redirect_init_command (
-                        server->outqueue[priority]->redirect,
-                        server->outqueue[priority]->message_after_mod);
+                        ptr_outqueue->redirect,
+                        ptr_outqueue->message_after_mod);
                 }
             }
-            irc_server_outqueue_free (server, priority,
-                                      server->outqueue[priority]);
-            break;
+            /* the queue may have been freed by a callback (disconnection) */
+            if (server->outqueue[priority] == ptr_outqueue)
+                irc_server_outqueue_free (server, priority, ptr_outqueue);
         }
     }
 }
@@ -2181,6 +2504,7 @@ irc_server_outqueue_send (struct t_irc_server *server)
  * queue_msg is priority:
  *   1 = higher priority, for user messages
  *   2 = lower priority, for other messages (like auto reply to CTCP queries)
+ *   3 = background, for automatic checks (like away check and notify)
  *
  * Returns:
  *   1: OK
@@ -2197,9 +2521,8 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
     const char *ptr_msg, *ptr_chan_nick;
     char *new_msg, *pos, *tags_to_send, *msg_encoded;
     char str_modifier[128], modifier_data[256];
-    int rc, queue_msg, add_to_queue, first_message, anti_flood;
+    int rc, queue_msg, add_to_queue, first_message;
     int pos_channel, pos_text, pos_encode;
-    time_t time_now;
     struct t_irc_redirect *ptr_redirect;
 
     rc = 1;
@@ -2266,37 +2589,20 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
 
             snprintf (buffer, sizeof (buffer), "%s\r\n", ptr_msg);
 
-            /* anti-flood: look whether we should queue outgoing message or not */
-            time_now = time (NULL);
-
-            /* detect if system clock has been changed (now lower than before) */
-            if (server->last_user_message > time_now)
-                server->last_user_message = time_now;
-
             /* get queue from flags */
             queue_msg = 0;
             if (flags & IRC_SERVER_SEND_OUTQ_PRIO_HIGH)
                 queue_msg = 1;
             else if (flags & IRC_SERVER_SEND_OUTQ_PRIO_LOW)
                 queue_msg = 2;
+            else if (flags & IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND)
+                queue_msg = 3;
 
-            switch (queue_msg - 1)
-            {
-                case 0:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(
-                        server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                    break;
-                default:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(
-                        server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                    break;
-            }
-
+            /* anti-flood: look whether we should queue outgoing message or not */
             add_to_queue = 0;
             if ((queue_msg > 0)
                 && (server->outqueue[queue_msg - 1]
-                    || ((anti_flood > 0)
-                        && (time_now - server->last_user_message < anti_flood))))
+                    || !irc_server_anti_flood_can_send (server, queue_msg - 1)))
             {
                 add_to_queue = queue_msg;
             }
@@ -2346,7 +2652,7 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
                 else
                 {
                     if (queue_msg > 0)
-                        server->last_user_message = time_now;
+                        irc_server_anti_flood_sent (server, queue_msg - 1);
                 }
                 if (ptr_redirect)
                     irc_redirect_init_command (ptr_redirect, buffer);
@@ -2515,384 +2821,391 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
 }
 
 /*
- * Adds a message to received messages queue (at the end).
+ * Adds data to receive buffer of server (the buffer is grown if needed).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
  */
 
-void
-irc_server_msgq_add_msg (struct t_irc_server *server, const char *msg)
+int
+irc_server_msgq_add_data (struct t_irc_server *server, const char *data,
+                          int length)
 {
-    struct t_irc_message *message;
+    if (!irc_server_recv_buffer_alloc (server, length))
+        return 0;
+
+    memcpy (server->recv_buffer + server->recv_buffer_length, data, length);
+    server->recv_buffer_length += length;
+    server->recv_buffer[server->recv_buffer_length] = '\0';
+
+    return 1;
+}
+
+/*
+ * Adds a received buffer (string) to receive buffer of server; the lines are
+ * processed on next call to function irc_server_msgq_flush.
+ */
 
-    if (!server->unterminated_message && !msg[0])
+void
+irc_server_msgq_add_buffer (struct t_irc_server *server, const char *buffer)
+{
+    if (!server || !buffer || !buffer[0])
         return;
 
-    message = malloc (sizeof (*message));
-    if (!message)
+    if (!irc_server_msgq_add_data (server, buffer, strlen (buffer)))
     {
         weechat_printf (server->buffer,
                         _("%s%s: not enough memory for received message"),
                         weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        return;
     }
-    message->server = server;
-    if (server->unterminated_message)
-    {
-        message->data = malloc (strlen (server->unterminated_message) +
-                                strlen (msg) + 1);
-        if (!message->data)
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        }
-        else
-        {
-            strcpy (message->data, server->unterminated_message);
-            strcat (message->data, msg);
-        }
-        free (server->unterminated_message);
-        server->unterminated_message = NULL;
-    }
-    else
-        message->data = strdup (msg);
+}
 
-    message->next_message = NULL;
+/*
+ * Builds name of modifier for a received message: prefix + command (for
+ * example "irc_in_privmsg"), "unknown" is used if there is no command.
+ */
 
-    if (irc_msgq_last_msg)
+void
+irc_server_msgq_build_modifier (const struct t_irc_message_parsed *parsed,
+                                const char *prefix,
+                                char *modifier, int size)
+{
+    if (parsed->command.pos >= 0)
     {
-        irc_msgq_last_msg->next_message = message;
-        irc_msgq_last_msg = message;
+        snprintf (modifier, size, "%s%.*s",
+                  prefix,
+                  parsed->command.length,
+                  parsed->message + parsed->command.pos);
     }
     else
     {
-        irc_recv_msgq = message;
-        irc_msgq_last_msg = message;
+        snprintf (modifier, size, "%sunknown", prefix);
     }
 }
 
 /*
- * Adds an unterminated message to queue.
+ * Processes a message received from server: modifiers, charset decoding,
+ * redirection and callback of IRC command.
+ *
+ * Each line is parsed only once, before modifier "irc_in2" (the line received
+ * is not parsed again if modifier "irc_in" did not change it): like in
+ * previous versions, tags, command, channel and arguments are read in this
+ * message, and the final message (after charset decoding and modifier
+ * "irc_in2") is given to redirection and callback of IRC command.
  */
 
 void
-irc_server_msgq_add_unterminated (struct t_irc_server *server,
-                                  const char *string)
+irc_server_msgq_process_msg (struct t_irc_server *server, char *ptr_data)
 {
-    char *unterminated_message2;
+    struct t_irc_message_parsed parsed;
+    char *new_msg, *new_msg2, *ptr_msg, *ptr_msg2, *ptr_msg3, *pos;
+    char *msg_decoded, *msg_decoded_without_color;
+    char str_modifier[128], modifier_data[256];
+    int pos_decode;
+
+    while (ptr_data[0] == ' ')
+    {
+        ptr_data++;
+    }
 
-    if (!string[0])
+    if (!ptr_data[0])
         return;
 
-    if (server->unterminated_message)
+    irc_raw_print (server, IRC_RAW_FLAG_RECV, ptr_data);
+
+    irc_message_parse_spans (server, ptr_data, &parsed);
+    irc_server_msgq_build_modifier (&parsed, "irc_in_",
+                                    str_modifier, sizeof (str_modifier));
+    new_msg = weechat_hook_modifier_exec (str_modifier, server->name,
+                                          ptr_data);
+
+    /* no changes in new message */
+    if (new_msg && (strcmp (ptr_data, new_msg) == 0))
+    {
+        free (new_msg);
+        new_msg = NULL;
+    }
+
+    /* message not dropped? */
+    if (!new_msg || new_msg[0])
     {
-        unterminated_message2 =
-            realloc (server->unterminated_message,
-                     (strlen (server->unterminated_message) +
-                      strlen (string) + 1));
-        if (!unterminated_message2)
+        /* use new message (returned by plugin) */
+        ptr_msg = (new_msg) ? new_msg : ptr_data;
+
+        while (ptr_msg && ptr_msg[0])
         {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-            free (server->unterminated_message);
-            server->unterminated_message = NULL;
-            return;
+            pos = strchr (ptr_msg, '\n');
+            if (pos)
+                pos[0] = '\0';
+
+            if (new_msg)
+            {
+                irc_raw_print (server,
+                               IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
+                               ptr_msg);
+            }
+
+            /* line received is already parsed (for modifier "irc_in") */
+            if ((ptr_msg != ptr_data) || pos)
+                irc_message_parse_spans (server, ptr_msg, &parsed);
+
+            msg_decoded = NULL;
+            if (weechat_config_boolean (irc_config_network_channel_encode))
+            {
+                pos_decode = (parsed.channel.pos >= 0) ?
+                    parsed.channel.pos : parsed.text.pos;
+            }
+            else
+                pos_decode = parsed.text.pos;
+            if (pos_decode >= 0)
+            {
+                /* convert charset for message */
+                if ((parsed.channel.pos >= 0)
+                    && irc_channel_is_channel (server,
+                                               ptr_msg + parsed.channel.pos))
+                {
+                    snprintf (modifier_data, sizeof (modifier_data),
+                              "%s.%s.%.*s",
+                              weechat_plugin->name, server->name,
+                              parsed.channel.length,
+                              ptr_msg + parsed.channel.pos);
+                }
+                else
+                {
+                    if ((parsed.nick.pos >= 0)
+                        && ((parsed.host.pos < 0)
+                            || (parsed.nick.length != parsed.host.length)
+                            || (strncmp (ptr_msg + parsed.nick.pos,
+                                         ptr_msg + parsed.host.pos,
+                                         parsed.nick.length) != 0)))
+                    {
+                        snprintf (modifier_data, sizeof (modifier_data),
+                                  "%s.%s.%.*s",
+                                  weechat_plugin->name, server->name,
+                                  parsed.nick.length,
+                                  ptr_msg + parsed.nick.pos);
+                    }
+                    else
+                    {
+                        snprintf (modifier_data, sizeof (modifier_data),
+                                  "%s.%s",
+                                  weechat_plugin->name, server->name);
+                    }
+                }
+                msg_decoded = irc_message_convert_charset (
+                    ptr_msg, pos_decode, "charset_decode", modifier_data);
+            }
+
+            /* replace WeeChat internal color codes by "?" */
+            msg_decoded_without_color = weechat_string_remove_color (
+                (msg_decoded) ? msg_decoded : ptr_msg, "?");
+
+            /* call modifier after charset */
+            ptr_msg2 = (msg_decoded_without_color) ?
+                msg_decoded_without_color : ((msg_decoded) ? msg_decoded : ptr_msg);
+            irc_server_msgq_build_modifier (&parsed, "irc_in2_",
+                                            str_modifier, sizeof (str_modifier));
+            new_msg2 = weechat_hook_modifier_exec (str_modifier, server->name,
+                                                   ptr_msg2);
+            if (new_msg2 && (strcmp (ptr_msg2, new_msg2) == 0))
+            {
+                free (new_msg2);
+                new_msg2 = NULL;
+            }
+
+            /* message not dropped? */
+            if (!new_msg2 || new_msg2[0])
+            {
+                /* use new message (returned by plugin) */
+                if (new_msg2)
+                    ptr_msg2 = new_msg2;
+
+                /* redirect or execute command */
+                if (irc_redirect_message (server, ptr_msg2, &parsed))
+                {
+                    /* message redirected, we'll not display it! */
+                }
+                else
+                {
+                    /* message not redirected, display it */
+                    ptr_msg3 = ptr_msg2;
+                    if (ptr_msg3[0] == '@')
+                    {
+                        /* skip tags in message */
+                        ptr_msg3 = strchr (ptr_msg3, ' ');
+                        if (ptr_msg3)
+                        {
+                            while (ptr_msg3[0] == ' ')
+                            {
+                                ptr_msg3++;
+                            }
+                        }
+                        else
+                            ptr_msg3 = ptr_msg2;
+                    }
+                    irc_protocol_recv_command (server, ptr_msg3, &parsed);
+                }
+            }
+
+            if (new_msg2)
+                free (new_msg2);
+            if (msg_decoded)
+                free (msg_decoded);
+            if (msg_decoded_without_color)
+                free (msg_decoded_without_color);
+
+            if (pos)
+            {
+                pos[0] = '\n';
+                ptr_msg = pos + 1;
+            }
+            else
+                ptr_msg = NULL;
         }
-        server->unterminated_message = unterminated_message2;
-        strcat (server->unterminated_message, string);
     }
     else
     {
-        server->unterminated_message = strdup (string);
-        if (!server->unterminated_message)
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        }
+        irc_raw_print (server, IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
+                       _("(message dropped)"));
     }
+    if (new_msg)
+        free (new_msg);
 }
 
 /*
- * Splits received buffer, creating queued messages.
+ * Processes all complete lines in receive buffer of server (the unterminated
+ * message at the end of buffer is kept for next call).
+ *
+ * Lines are processed in batch: the complete lines are moved to a spare
+ * buffer (so that data received during processing is added to receive
+ * buffer without moving lines being processed), and they are split in place.
+ * Chars '\r' are ignored and empty lines are skipped.
  */
 
 void
-irc_server_msgq_add_buffer (struct t_irc_server *server, const char *buffer)
+irc_server_msgq_flush (struct t_irc_server *server)
 {
-    char *pos_cr, *pos_lf;
+    char *batch, *ptr_line, *ptr_end, *pos_lf, *pos_cr, *ptr_src;
+    char *pos_last_lf;
+    int batch_size, length_lines, length_remaining;
 
-    while (buffer[0])
-    {
-        pos_cr = strchr (buffer, '\r');
-        pos_lf = strchr (buffer, '\n');
+    if (!server || server->recv_buffer_flushing)
+        return;
+
+    server->recv_buffer_flushing = 1;
 
-        if (!pos_cr && !pos_lf)
+    while (server->recv_buffer && (server->recv_buffer_length > 0))
+    {
+        /* search end of last complete line */
+        pos_last_lf = NULL;
+        for (ptr_line = server->recv_buffer + server->recv_buffer_length - 1;
+             ptr_line >= server->recv_buffer; ptr_line--)
         {
-            /* no CR/LF found => add to unterminated and return */
-            irc_server_msgq_add_unterminated (server, buffer);
-            return;
+            if (ptr_line[0] == '\n')
+            {
+                pos_last_lf = ptr_line;
+                break;
+            }
         }
+        if (!pos_last_lf)
+            break;
+
+        length_lines = pos_last_lf - server->recv_buffer + 1;
+        length_remaining = server->recv_buffer_length - length_lines;
 
-        if (pos_cr && ((!pos_lf) || (pos_lf > pos_cr)))
+        /*
+         * swap receive buffer and spare buffer: complete lines are processed
+         * in the spare buffer, the unterminated message stays in the
+         * receive buffer
+         */
+        batch = server->recv_buffer;
+        batch_size = server->recv_buffer_size;
+        server->recv_buffer = server->recv_buffer_batch;
+        server->recv_buffer_size = server->recv_buffer_batch_size;
+        server->recv_buffer_batch = NULL;
+        server->recv_buffer_batch_size = 0;
+        server->recv_buffer_length = 0;
+        if (!irc_server_msgq_add_data (server, batch + length_lines,
+                                       length_remaining))
         {
-            /* found '\r' first => ignore this char */
-            pos_cr[0] = '\0';
-            irc_server_msgq_add_unterminated (server, buffer);
-            buffer = pos_cr + 1;
+            weechat_printf (server->buffer,
+                            _("%s%s: not enough memory for received message"),
+                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
         }
-        else
+        batch[length_lines] = '\0';
+
+        ptr_line = batch;
+        ptr_end = batch + length_lines;
+        while (ptr_line < ptr_end)
         {
-            /* found: '\n' first => terminate message */
+            pos_lf = memchr (ptr_line, '\n', ptr_end - ptr_line);
             pos_lf[0] = '\0';
-            irc_server_msgq_add_msg (server, buffer);
-            buffer = pos_lf + 1;
-        }
-    }
-}
-
-/*
- * Flushes message queue.
- */
-
-void
-irc_server_msgq_flush ()
-{
-    struct t_irc_message *next;
-    char *ptr_data, *new_msg, *new_msg2, *ptr_msg, *ptr_msg2, *ptr_msg3, *pos;
-    char *tags, *nick, *host, *command, *channel, *arguments;
-    char *msg_decoded, *msg_decoded_without_color;
-    char str_modifier[128], modifier_data[256];
-    int pos_channel, pos_text, pos_decode;
 
-    while (irc_recv_msgq)
-    {
-        if (irc_recv_msgq->data)
-        {
-            /* read message only if connection was not lost */
-            if (irc_recv_msgq->server->sock != -1)
+            /* remove chars '\r' (in place) */
+            pos_cr = strchr (ptr_line, '\r');
+            if (pos_cr)
             {
-                ptr_data = irc_recv_msgq->data;
-                while (ptr_data[0] == ' ')
-                {
-                    ptr_data++;
-                }
-
-                if (ptr_data[0])
+                for (ptr_src = pos_cr; ptr_src[0]; ptr_src++)
                 {
-                    irc_raw_print (irc_recv_msgq->server, IRC_RAW_FLAG_RECV,
-                                   ptr_data);
-
-                    irc_message_parse (irc_recv_msgq->server,
-                                       ptr_data, NULL, NULL, NULL, NULL,
-                                       &command, NULL, NULL, NULL, NULL, NULL,
-                                       NULL, NULL);
-                    snprintf (str_modifier, sizeof (str_modifier),
-                              "irc_in_%s",
-                              (command) ? command : "unknown");
-                    new_msg = weechat_hook_modifier_exec (
-                        str_modifier,
-                        irc_recv_msgq->server->name,
-                        ptr_data);
-                    if (command)
-                        free (command);
-
-                    /* no changes in new message */
-                    if (new_msg && (strcmp (ptr_data, new_msg) == 0))
+                    if (ptr_src[0] != '\r')
                     {
-                        free (new_msg);
-                        new_msg = NULL;
+                        pos_cr[0] = ptr_src[0];
+                        pos_cr++;
                     }
+                }
+                pos_cr[0] = '\0';
+            }
 
-                    /* message not dropped? */
-                    if (!new_msg || new_msg[0])
-                    {
-                        /* use new message (returned by plugin) */
-                        ptr_msg = (new_msg) ? new_msg : ptr_data;
-
-                        while (ptr_msg && ptr_msg[0])
-                        {
-                            pos = strchr (ptr_msg, '\n');
-                            if (pos)
-                                pos[0] = '\0';
-
-                            if (new_msg)
-                            {
-                                irc_raw_print (
-                                    irc_recv_msgq->server,
-                                    IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
-                                    ptr_msg);
-                            }
-
-                            irc_message_parse (irc_recv_msgq->server, ptr_msg,
-                                               &tags, NULL, &nick, &host,
-                                               &command, &channel, &arguments,
-                                               NULL, NULL, NULL,
-                                               &pos_channel, &pos_text);
-
-                            msg_decoded = NULL;
-                            if (weechat_config_boolean (irc_config_network_channel_encode))
-                                pos_decode = (pos_channel >= 0) ? pos_channel : pos_text;
-                            else
-                                pos_decode = pos_text;
-                            if (pos_decode >= 0)
-                            {
-                                /* convert charset for message */
-                                if (channel
-                                    && irc_channel_is_channel (irc_recv_msgq->server,
-                                                               channel))
-                                {
-                                    snprintf (modifier_data, sizeof (modifier_data),
-                                              "%s.%s.%s",
-                                              weechat_plugin->name,
-                                              irc_recv_msgq->server->name,
-                                              channel);
-                                }
-                                else
-                                {
-                                    if (nick && (!host || (strcmp (nick, host) != 0)))
-                                    {
-                                        snprintf (modifier_data,
-                                                  sizeof (modifier_data),
-                                                  "%s.%s.%s",
-                                                  weechat_plugin->name,
-                                                  irc_recv_msgq->server->name,
-                                                  nick);
-                                    }
-                                    else
-                                    {
-                                        snprintf (modifier_data,
-                                                  sizeof (modifier_data),
-                                                  "%s.%s",
-                                                  weechat_plugin->name,
-                                                  irc_recv_msgq->server->name);
-                                    }
-                                }
-                                msg_decoded = irc_message_convert_charset (
-                                    ptr_msg, pos_decode,
-                                    "charset_decode", modifier_data);
-                            }
-
-                            /* replace WeeChat internal color codes by "?" */
-                            msg_decoded_without_color =
-                                weechat_string_remove_color (
-                                    (msg_decoded) ? msg_decoded : ptr_msg,
-                                    "?");
-
-                            /* call modifier after charset */
-                            ptr_msg2 = (msg_decoded_without_color) ?
-                                msg_decoded_without_color : ((msg_decoded) ? msg_decoded : ptr_msg);
-                            snprintf (str_modifier, sizeof (str_modifier),
-                                      "irc_in2_%s",
-                                      (command) ? command : "unknown");
-                            new_msg2 = weechat_hook_modifier_exec (
-                                str_modifier,
-                                irc_recv_msgq->server->name,
-                                ptr_msg2);
-                            if (new_msg2 && (strcmp (ptr_msg2, new_msg2) == 0))
-                            {
-                                free (new_msg2);
-                                new_msg2 = NULL;
-                            }
+            /* read message only if connection was not lost */
+            if (server->sock == -1)
+                break;
+            irc_server_msgq_process_msg (server, ptr_line);
 
-                            /* message not dropped? */
-                            if (!new_msg2 || new_msg2[0])
-                            {
-                                /* use new message (returned by plugin) */
-                                if (new_msg2)
-                                    ptr_msg2 = new_msg2;
-
-                                /* parse and execute command */
-                                if (irc_redirect_message (irc_recv_msgq->server,
-                                                          ptr_msg2, command,
-                                                          arguments))
-                                {
-                                    /* message redirected, we'll not display it! */
-                                }
-                                else
-                                {
-                                    /* message not redirected, display it */
-                                    ptr_msg3 = ptr_msg2;
-                                    if (ptr_msg3[0] == '@')
-                                    {
-                                        /* skip tags in message */
-                                        ptr_msg3 = strchr (ptr_msg3, ' ');
-                                        if (ptr_msg3)
-                                        {
-                                            while (ptr_msg3[0] == ' ')
-                                            {
-                                                ptr_msg3++;
-                                            }
-                                        }
-                                        else
-                                            ptr_msg3 = ptr_msg2;
-                                    }
-                                    irc_protocol_recv_command (
-                                        irc_recv_msgq->server,
-                                        ptr_msg3,
-                                        tags,
-                                        command,
-                                        channel);
-                                }
-                            }
+            ptr_line = pos_lf + 1;
+        }
 
-                            if (new_msg2)
-                                free (new_msg2);
-                            if (nick)
-                                free (nick);
-                            if (host)
-                                free (host);
-                            if (command)
-                                free (command);
-                            if (channel)
-                                free (channel);
-                            if (arguments)
-                                free (arguments);
-                            if (msg_decoded)
-                                free (msg_decoded);
-                            if (msg_decoded_without_color)
-                                free (msg_decoded_without_color);
-
-                            if (pos)
-                            {
-                                pos[0] = '\n';
-                                ptr_msg = pos + 1;
-                            }
-                            else
-                                ptr_msg = NULL;
-                        }
-                    }
-                    else
-                    {
-                        irc_raw_print (irc_recv_msgq->server,
-                                       IRC_RAW_FLAG_RECV | IRC_RAW_FLAG_MODIFIED,
-                                       _("(message dropped)"));
-                    }
-                    if (new_msg)
-                        free (new_msg);
-                }
-            }
-            free (irc_recv_msgq->data);
+        /* keep buffer as spare buffer for next batch */
+        if (!server->recv_buffer_batch)
+        {
+            server->recv_buffer_batch = batch;
+            server->recv_buffer_batch_size = batch_size;
         }
+        else
+            free (batch);
 
-        next = irc_recv_msgq->next_message;
-        free (irc_recv_msgq);
-        irc_recv_msgq = next;
-        if (!irc_recv_msgq)
-            irc_msgq_last_msg = NULL;
+        /* connection lost: drop data received */
+        if (server->sock == -1)
+        {
+            server->recv_buffer_length = 0;
+            if (server->recv_buffer)
+                server->recv_buffer[0] = '\0';
+            break;
+        }
     }
+
+    server->recv_buffer_flushing = 0;
 }
 
 /*
  * Receives data from a server.
+ *
+ * Data is read directly in the receive buffer of server, until the socket
+ * has no more data or until IRC_SERVER_RECV_BUFFER_MAX_BATCH bytes have been
+ * read (the remaining data will be read on next call), then all complete
+ * lines are processed in a single batch.
+ *
+ * On error (or if the connection is closed by peer), the complete lines
+ * already received (for example the message "ERROR") are processed before
+ * disconnecting from server.
  */
 
 int
 irc_server_recv_cb (const void *pointer, void *data, int fd)
 {
     struct t_irc_server *server;
-    static char buffer[4096 + 2];
-    int num_read, msgq_flush, end_recv;
+    char *ptr_buffer;
+    int num_read, size, total_read, end_recv, recv_errno;
 
     /* make C compiler happy */
     (void) data;
@@ -2902,26 +3215,43 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
     if (!server)
         return WEECHAT_RC_ERROR;
 
-    msgq_flush = 0;
+    total_read = 0;
     end_recv = 0;
 
     while (!end_recv)
     {
         end_recv = 1;
 
+        if (!irc_server_recv_buffer_alloc (server,
+                                           IRC_SERVER_RECV_BUFFER_READ_SIZE))
+        {
+            weechat_printf (server->buffer,
+                            _("%s%s: not enough memory for received message"),
+                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
+            break;
+        }
+        ptr_buffer = server->recv_buffer + server->recv_buffer_length;
+        size = server->recv_buffer_size - server->recv_buffer_length - 1;
+
 #ifdef HAVE_GNUTLS
         if (server->ssl_connected)
-            num_read = gnutls_record_recv (server->gnutls_sess, buffer,
-                                           sizeof (buffer) - 2);
+            num_read = gnutls_record_recv (server->gnutls_sess, ptr_buffer,
+                                           size);
         else
 #endif /* HAVE_GNUTLS */
-            num_read = recv (server->sock, buffer, sizeof (buffer) - 2, 0);
+            num_read = recv (server->sock, ptr_buffer, size, 0);
 
         if (num_read > 0)
         {
-            buffer[num_read] = '\0';
-            irc_server_msgq_add_buffer (server, buffer);
-            msgq_flush = 1;  /* the flush will be done after the loop */
+            server->recv_buffer_length += num_read;
+            server->recv_buffer[server->recv_buffer_length] = '\0';
+            total_read += num_read;
+            /* socket may have more data if the read filled the buffer */
+            if ((num_read == size)
+                && (total_read < IRC_SERVER_RECV_BUFFER_MAX_BATCH))
+            {
+                end_recv = 0;
+            }
 #ifdef HAVE_GNUTLS
             if (server->ssl_connected
                 && (gnutls_record_check_pending (server->gnutls_sess) > 0))
@@ -2943,6 +3273,11 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
                     || ((num_read != GNUTLS_E_AGAIN)
                         && (num_read != GNUTLS_E_INTERRUPTED)))
                 {
+                    /* process complete lines received before the error */
+                    irc_server_msgq_flush (server);
+                    /* already disconnected by a message (like "ERROR") */
+                    if (server->sock == -1)
+                        break;
                     weechat_printf (
                         server->buffer,
                         _("%s%s: reading data on socket: error %d %s"),
@@ -2963,13 +3298,19 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
                 if ((num_read == 0)
                     || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
                 {
+                    recv_errno = errno;
+                    /* process complete lines received before the error */
+                    irc_server_msgq_flush (server);
+                    /* already disconnected by a message (like "ERROR") */
+                    if (server->sock == -1)
+                        break;
                     weechat_printf (
                         server->buffer,
                         _("%s%s: reading data on socket: error %d %s"),
                         weechat_prefix ("error"), IRC_PLUGIN_NAME,
-                        errno,
+                        recv_errno,
                         (num_read == 0) ? _("(connection closed by peer)") :
-                        strerror (errno));
+                        strerror (recv_errno));
                     weechat_printf (
                         server->buffer,
                         _("%s%s: disconnecting from server..."),
@@ -2980,8 +3321,8 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
         }
     }
 
-    if (msgq_flush)
-        irc_server_msgq_flush ();
+    if (total_read > 0)
+        irc_server_msgq_flush (server);
 
     return WEECHAT_RC_OK;
 }
@@ -3277,6 +3618,9 @@ irc_server_timer_cb (const void *pointer, void *data, int remaining_calls)
                 ptr_redirect = ptr_next_redirect;
             }
 
+            /* end batches if timeout occurs */
+            irc_batch_timeout (ptr_server);
+
             /* purge some data (every 10 minutes) */
             if (current_time > ptr_server->last_data_purge + (60 * 10))
             {
@@ -3358,20 +3702,28 @@ irc_server_close_connection (struct t_irc_server *server)
         server->sock = -1;
     }
 
-    /* free any pending message */
-    if (server->unterminated_message)
-    {
-        free (server->unterminated_message);
-        server->unterminated_message = NULL;
-    }
+    /*
+     * drop any pending message (buffers are kept for next connection, they
+     * may be used if lines are being processed)
+     */
+    server->recv_buffer_length = 0;
+    if (server->recv_buffer)
+        server->recv_buffer[0] = '\0';
     for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
     {
         irc_server_outqueue_free_all (server, i);
     }
 
+    /* anti-flood: bucket is full for next connection */
+    server->anti_flood_time.tv_sec = 0;
+    server->anti_flood_time.tv_usec = 0;
+
     /* remove all redirects */
     irc_redirect_free_all (server);
 
+    /* end all batches */
+    irc_batch_end_all (server);
+
     /* remove all manual joins */
     weechat_hashtable_remove_all (server->join_manual);
 
@@ -5437,7 +5789,16 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert, OTHER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert_key, OTHER, 0, NULL, NULL);
 #endif /* HAVE_GNUTLS */
-        WEECHAT_HDATA_VAR(struct t_irc_server, unterminated_message, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer, STRING, 0, NULL, NULL);
+        /* old name of "recv_buffer" (kept for compatibility) */
+        weechat_hdata_new_var (hdata, "unterminated_message",
+                               offsetof (struct t_irc_server, recv_buffer),
+                               WEECHAT_HDATA_STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_size, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_length, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_batch, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_batch_size, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, recv_buffer_flushing, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nicks_count, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nicks_array, STRING, 0, "nicks_count", NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nick_first_tried, INTEGER, 0, NULL, NULL);
@@ -5475,11 +5836,20 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, last_data_purge, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, outqueue, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_outqueue, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, anti_flood_time, OTHER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_sent, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_merged, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_wait_max, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, redirects, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_redirect, POINTER, 0, NULL, "irc_redirect");
+        WEECHAT_HDATA_VAR(struct t_irc_server, batches, POINTER, 0, NULL, "irc_batch");
+        WEECHAT_HDATA_VAR(struct t_irc_server, last_batch, POINTER, 0, NULL, "irc_batch");
         WEECHAT_HDATA_VAR(struct t_irc_server, notify_list, POINTER, 0, NULL, "irc_notify");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_notify, POINTER, 0, NULL, "irc_notify");
         WEECHAT_HDATA_VAR(struct t_irc_server, notify_count, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, notify_index, HASHTABLE, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, notify_queries_sent, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, notify_state_changes, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, join_manual, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, join_channel_key, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, join_noswitch, HASHTABLE, 0, NULL, NULL);
@@ -5508,6 +5878,9 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
                             struct t_irc_server *server)
 {
     struct t_infolist_item *ptr_item;
+    struct t_irc_outqueue *ptr_outqueue;
+    char option_name[64];
+    int i, count;
 
     if (!infolist || !server)
         return 0;
@@ -5662,7 +6035,8 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "disconnected", server->disconnected))
         return 0;
-    if (!weechat_infolist_new_var_string (ptr_item, "unterminated_message", server->unterminated_message))
+    /* unterminated message (name kept for compatibility with /upgrade) */
+    if (!weechat_infolist_new_var_string (ptr_item, "unterminated_message", server->recv_buffer))
         return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "nick", server->nick))
         return 0;
@@ -5726,6 +6100,38 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "last_data_purge", server->last_data_purge))
         return 0;
+    for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
+    {
+        count = 0;
+        for (ptr_outqueue = server->outqueue[i]; ptr_outqueue;
+             ptr_outqueue = ptr_outqueue->next_outqueue)
+        {
+            count++;
+        }
+        snprintf (option_name, sizeof (option_name),
+                  "outqueue_%s_count", irc_server_outqueue_prio_string[i]);
+        if (!weechat_infolist_new_var_integer (ptr_item, option_name, count))
+            return 0;
+    }
+    if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_tokens",
+                                           irc_server_anti_flood_tokens (server)))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_sent", server->outqueue_sent))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_merged", server->outqueue_merged))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_wait_avg",
+                                           (server->outqueue_sent > 0) ?
+                                           (int)(server->outqueue_wait_total / server->outqueue_sent) : 0))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_wait_max", server->outqueue_wait_max))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "notify_count", server->notify_count))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "notify_queries_sent", server->notify_queries_sent))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "notify_state_changes", server->notify_state_changes))
+        return 0;
 
     return 1;
 }
@@ -6044,7 +6450,12 @@ irc_server_print_log ()
 #ifdef HAVE_GNUTLS
         weechat_log_printf ("  gnutls_sess. . . . . : 0x%lx", ptr_server->gnutls_sess);
 #endif /* HAVE_GNUTLS */
-        weechat_log_printf ("  unterminated_message : '%s'",  ptr_server->unterminated_message);
+        weechat_log_printf ("  recv_buffer. . . . . : '%s'",  ptr_server->recv_buffer);
+        weechat_log_printf ("  recv_buffer_size . . : %d",    ptr_server->recv_buffer_size);
+        weechat_log_printf ("  recv_buffer_length . : %d",    ptr_server->recv_buffer_length);
+        weechat_log_printf ("  recv_buffer_batch. . : 0x%lx", ptr_server->recv_buffer_batch);
+        weechat_log_printf ("  recv_buffer_batch_size: %d",   ptr_server->recv_buffer_batch_size);
+        weechat_log_printf ("  recv_buffer_flushing : %d",    ptr_server->recv_buffer_flushing);
         weechat_log_printf ("  nicks_count. . . . . : %d",    ptr_server->nicks_count);
         weechat_log_printf ("  nicks_array. . . . . : 0x%lx", ptr_server->nicks_array);
         weechat_log_printf ("  nick_first_tried . . : %d",    ptr_server->nick_first_tried);
@@ -6088,12 +6499,25 @@ irc_server_print_log ()
         {
             weechat_log_printf ("  outqueue[%02d] . . . . : 0x%lx", i, ptr_server->outqueue[i]);
             weechat_log_printf ("  last_outqueue[%02d]. . : 0x%lx", i, ptr_server->last_outqueue[i]);
+            weechat_log_printf ("  outqueue_last_sent[%02d]: %ld", i, ptr_server->outqueue_last_sent[i]);
         }
+        weechat_log_printf ("  anti_flood_time. . . : tv_sec:%d, tv_usec:%d",
+                            ptr_server->anti_flood_time.tv_sec,
+                            ptr_server->anti_flood_time.tv_usec);
+        weechat_log_printf ("  outqueue_sent. . . . : %d",    ptr_server->outqueue_sent);
+        weechat_log_printf ("  outqueue_merged. . . : %d",    ptr_server->outqueue_merged);
+        weechat_log_printf ("  outqueue_wait_total. : %lld",  ptr_server->outqueue_wait_total);
+        weechat_log_printf ("  outqueue_wait_max. . : %d",    ptr_server->outqueue_wait_max);
         weechat_log_printf ("  redirects. . . . . . : 0x%lx", ptr_server->redirects);
         weechat_log_printf ("  last_redirect. . . . : 0x%lx", ptr_server->last_redirect);
+        weechat_log_printf ("  batches. . . . . . . : 0x%lx", ptr_server->batches);
+        weechat_log_printf ("  last_batch . . . . . : 0x%lx", ptr_server->last_batch);
         weechat_log_printf ("  notify_list. . . . . : 0x%lx", ptr_server->notify_list);
         weechat_log_printf ("  last_notify. . . . . : 0x%lx", ptr_server->last_notify);
         weechat_log_printf ("  notify_count . . . . : %d",    ptr_server->notify_count);
+        weechat_log_printf ("  notify_index . . . . : 0x%lx", ptr_server->notify_index);
+        weechat_log_printf ("  notify_queries_sent. : %d",    ptr_server->notify_queries_sent);
+        weechat_log_printf ("  notify_state_changes : %d",    ptr_server->notify_state_changes);
         weechat_log_printf ("  join_manual. . . . . : 0x%lx (hashtable: '%s')",
                             ptr_server->join_manual,
                             weechat_hashtable_get_string (ptr_server->join_manual, "keys_values"));
@@ -6112,6 +6536,8 @@ irc_server_print_log ()
 
         irc_redirect_print_log (ptr_server);
 
+        irc_batch_print_log (ptr_server);
+
         irc_notify_print_log (ptr_server);
 
         for (ptr_channel = ptr_server->channels; ptr_channel;
@@ -78,6 +78,7 @@ enum t_irc_server_option
     IRC_SERVER_OPTION_CONNECTION_TIMEOUT,   /* timeout for connection        */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH, /* anti-flood (high priority)    */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW,  /* anti-flood (low priority)     */
+    IRC_SERVER_OPTION_ANTI_FLOOD_BURST,     /* anti-flood (burst of msgs)    */
     IRC_SERVER_OPTION_AWAY_CHECK,           /* delay between away checks     */
     IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS, /* max nicks for away check      */
     IRC_SERVER_OPTION_MSG_KICK,             /* default kick message          */
@@ -113,13 +114,25 @@ enum t_irc_server_option
 #define IRC_SERVER_DEFAULT_PORT_SSL 6697
 #define IRC_SERVER_DEFAULT_NICKS    "weechat1,weechat2,weechat3,weechat4,weechat5"
 
-/* number of queues for sending messages */
-#define IRC_SERVER_NUM_OUTQUEUES_PRIO 2
+/* number of queues for sending messages (high, low, background) */
+#define IRC_SERVER_NUM_OUTQUEUES_PRIO 3
+
+/* max length of a message sent to server (without final "\r\n") */
+#define IRC_SERVER_MSG_MAX_LENGTH 510
+
+/*
+ * receive buffer: size of first allocation and of each read on socket, max
+ * bytes read on socket in one call to the receive callback (the remaining
+ * data is read on next call, so that GUI is refreshed between batches)
+ */
+#define IRC_SERVER_RECV_BUFFER_READ_SIZE 16384
+#define IRC_SERVER_RECV_BUFFER_MAX_BATCH (256 * 1024)
 
 /* flags for irc_server_sendf() */
-#define IRC_SERVER_SEND_OUTQ_PRIO_HIGH   1
-#define IRC_SERVER_SEND_OUTQ_PRIO_LOW    2
-#define IRC_SERVER_SEND_RETURN_HASHTABLE 4
+#define IRC_SERVER_SEND_OUTQ_PRIO_HIGH       1
+#define IRC_SERVER_SEND_OUTQ_PRIO_LOW        2
+#define IRC_SERVER_SEND_RETURN_HASHTABLE     4
+#define IRC_SERVER_SEND_OUTQ_PRIO_BACKGROUND 8
 
 /* casemapping (string comparisons for nicks/channels) */
 enum t_irc_server_casemapping
@@ -141,6 +154,7 @@ struct t_irc_outqueue
     int modified;                         /* msg was modified by modifier(s) */
     char *tags;                           /* tags (used by Relay plugin)     */
     struct t_irc_redirect *redirect;      /* command redirection             */
+    struct timeval date_queued;           /* date of message added in queue  */
     struct t_irc_outqueue *next_outqueue; /* link to next msg in queue       */
     struct t_irc_outqueue *prev_outqueue; /* link to prev msg in queue       */
 };
@@ -178,7 +192,13 @@ struct t_irc_server
     gnutls_x509_crt_t tls_cert;     /* certificate used if ssl_cert is set   */
     gnutls_x509_privkey_t tls_cert_key; /* key used if ssl_cert is set       */
 #endif /* HAVE_GNUTLS */
-    char *unterminated_message;     /* beginning of a message in input buf   */
+    char *recv_buffer;              /* data received (unterminated message   */
+                                    /* or lines not yet processed)           */
+    int recv_buffer_size;           /* size of receive buffer                */
+    int recv_buffer_length;         /* length of data in receive buffer      */
+    char *recv_buffer_batch;        /* spare buffer: lines processed in batch*/
+    int recv_buffer_batch_size;     /* size of spare buffer                  */
+    int recv_buffer_flushing;       /* 1 if lines are being processed        */
     int nicks_count;                /* number of nicknames                   */
     char **nicks_array;             /* nicknames (after split)               */
     int nick_first_tried;           /* first nick tried in list of nicks     */
@@ -218,14 +238,30 @@ struct t_irc_server
     time_t last_user_message;       /* time of last user message (anti flood)*/
     time_t last_away_check;         /* time of last away check on server     */
     time_t last_data_purge;         /* time of last purge (some hashtables)  */
-    struct t_irc_outqueue *outqueue[2];      /* queue for outgoing messages  */
-                                             /* with 2 priorities (high/low) */
-    struct t_irc_outqueue *last_outqueue[2]; /* last outgoing message        */
+    struct t_irc_outqueue *outqueue[IRC_SERVER_NUM_OUTQUEUES_PRIO];
+                                    /* queues for outgoing messages, with    */
+                                    /* 3 priorities (high/low/background)    */
+    struct t_irc_outqueue *last_outqueue[IRC_SERVER_NUM_OUTQUEUES_PRIO];
+                                    /* last outgoing message in queues       */
+    struct timeval anti_flood_time; /* anti-flood (token bucket): theoretical*/
+                                    /* time of next msg if bucket is empty   */
+    time_t outqueue_last_sent[IRC_SERVER_NUM_OUTQUEUES_PRIO];
+                                    /* time of last msg sent, by priority    */
+    int outqueue_sent;              /* number of msgs sent from queues       */
+    int outqueue_merged;            /* number of msgs merged in queues       */
+    long long outqueue_wait_total;  /* total wait time in queues (in ms)     */
+    int outqueue_wait_max;          /* max wait time in queues (in ms)       */
     struct t_irc_redirect *redirects;        /* command redirections         */
     struct t_irc_redirect *last_redirect;    /* last command redirection     */
+    struct t_irc_batch *batches;             /* open batches of messages     */
+    struct t_irc_batch *last_batch;          /* last open batch              */
     struct t_irc_notify *notify_list;        /* list of notify               */
     struct t_irc_notify *last_notify;        /* last notify                  */
     int notify_count;                        /* number of notify in list     */
+    struct t_hashtable *notify_index;        /* notify by nick (case insens.)*/
+    int notify_queries_sent;                 /* ISON/MONITOR/WHOIS sent for  */
+                                             /* notify                       */
+    int notify_state_changes;                /* changes of online/away state */
     struct t_hashtable *join_manual;         /* manual joins pending         */
     struct t_hashtable *join_channel_key;    /* keys pending for joins       */
     struct t_hashtable *join_noswitch;       /* joins w/o switch to buffer   */
@@ -237,15 +273,6 @@ struct t_irc_server
     struct t_irc_server *next_server;     /* link to next server             */
 };
 
-/* IRC messages */
-
-struct t_irc_message
-{
-    struct t_irc_server *server;        /* server pointer for received msg   */
-    char *data;                         /* message content                   */
-    struct t_irc_message *next_message; /* link to next message              */
-};
-
 /* digest algorithms for fingerprint */
 
 #ifdef HAVE_GNUTLS
@@ -264,7 +291,6 @@ extern struct t_irc_server *irc_servers;
 extern const int gnutls_cert_type_prio[];
 extern const int gnutls_prot_prio[];
 #endif /* HAVE_GNUTLS */
-extern struct t_irc_message *irc_recv_msgq, *irc_msgq_last_msg;
 extern char *irc_server_sasl_fail_string[];
 extern char *irc_server_options[][2];
 
@@ -327,7 +353,7 @@ extern struct t_hashtable *irc_server_sendf (struct t_irc_server *server,
                                              const char *format, ...);
 extern void irc_server_msgq_add_buffer (struct t_irc_server *server,
                                         const char *buffer);
-extern void irc_server_msgq_flush ();
+extern void irc_server_msgq_flush (struct t_irc_server *server);
 extern void irc_server_set_buffer_title (struct t_irc_server *server);
 extern struct t_gui_buffer *irc_server_create_buffer (struct t_irc_server *server);
 #ifdef HAVE_GNUTLS
@@ -368,7 +368,7 @@ irc_upgrade_read_cb (const void *pointer, void *data,
                     irc_upgrade_current_server->disconnected = weechat_infolist_integer (infolist, "disconnected");
                     str = weechat_infolist_string (infolist, "unterminated_message");
                     if (str)
-                        irc_upgrade_current_server->unterminated_message = strdup (str);
+                        irc_server_msgq_add_buffer (irc_upgrade_current_server, str);
                     str = weechat_infolist_string (infolist, "nick");
                     if (str)
                         irc_server_set_nick (irc_upgrade_current_server, str);
@@ -512,7 +512,8 @@ irc_upgrade_read_cb (const void *pointer, void *data,
                                 nick = weechat_infolist_string (infolist, option_name);
                                 if (!nick)
                                     break;
-                                irc_channel_nick_speaking_add (irc_upgrade_current_channel,
+                                irc_channel_nick_speaking_add (irc_upgrade_current_server,
+                                                               irc_upgrade_current_channel,
                                                                nick,
                                                                i);
                                 index++;
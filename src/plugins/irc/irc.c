@@ -177,6 +177,8 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     irc_info_init ();
 
+    irc_protocol_init ();
+
     irc_redirect_init ();
 
     irc_notify_init ();
@@ -302,6 +304,8 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     irc_redirect_end ();
 
+    irc_protocol_end ();
+
     irc_color_end ();
 
     return WEECHAT_RC_OK;
@@ -1299,6 +1299,37 @@ plugin_api_infolist_hook_cb (const void *pointer, void *data,
     return ptr_infolist;
 }
 
+/*
+ * Returns WeeChat infolist "hook_stats".
+ *
+ * Note: result must be freed after use with function weechat_infolist_free().
+ */
+
+struct t_infolist *
+plugin_api_infolist_hook_stats_cb (const void *pointer, void *data,
+                                   const char *infolist_name,
+                                   void *obj_pointer, const char *arguments)
+{
+    struct t_infolist *ptr_infolist;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) infolist_name;
+    (void) obj_pointer;
+
+    ptr_infolist = infolist_new (NULL);
+    if (!ptr_infolist)
+        return NULL;
+
+    if (!hook_stats_add_to_infolist (ptr_infolist, arguments))
+    {
+        infolist_free (ptr_infolist);
+        return NULL;
+    }
+    return ptr_infolist;
+}
+
 /*
  * Returns WeeChat infolist "hotlist".
  *
@@ -2017,6 +2048,13 @@ plugin_api_init ()
                       "get only some hooks (wildcard \"*\" is allowed), "
                       "both are optional)"),
                    &plugin_api_infolist_hook_cb, NULL, NULL);
+    hook_infolist (NULL, "hook_stats",
+                   N_("execution statistics of hooks by plugin/script "
+                      "(see /debug hooks profile)"),
+                   NULL,
+                   N_("plugin/script mask (wildcard \"*\" is allowed) "
+                      "(optional)"),
+                   &plugin_api_infolist_hook_stats_cb, NULL, NULL);
     hook_infolist (NULL, "hotlist",
                    N_("list of buffers in hotlist"),
                    NULL,
@@ -714,6 +714,7 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->hashtable_remove = &hashtable_remove;
         new_plugin->hashtable_remove_all = &hashtable_remove_all;
         new_plugin->hashtable_free = &hashtable_free;
+        new_plugin->hashtable_hash_key_string_range = &hashtable_hash_key_string_range;
 
         new_plugin->config_new = &config_file_new;
         new_plugin->config_new_section = &config_file_new_section;
@@ -59,7 +59,7 @@ struct timeval;
  * please change the date with current one; for a second change at same
  * date, increment the 01, otherwise please keep 01.
  */
-#define WEECHAT_PLUGIN_API_VERSION "20170401-01"
+#define WEECHAT_PLUGIN_API_VERSION "20170420-01"
 
 /* macros for defining plugin infos */
 #define WEECHAT_PLUGIN_NAME(__name)                                     \
@@ -461,6 +461,8 @@ struct t_weechat_plugin
     void (*hashtable_remove) (struct t_hashtable *hashtable, const void *key);
     void (*hashtable_remove_all) (struct t_hashtable *hashtable);
     void (*hashtable_free) (struct t_hashtable *hashtable);
+    unsigned long long (*hashtable_hash_key_string_range) (const char *string,
+                                                           int range);
 
     /* config files */
     struct t_config_file *(*config_new) (struct t_weechat_plugin *plugin,
@@ -1390,6 +1392,9 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     (weechat_plugin->hashtable_remove_all)(__hashtable)
 #define weechat_hashtable_free(__hashtable)                             \
     (weechat_plugin->hashtable_free)(__hashtable)
+#define weechat_hashtable_hash_key_string_range(__string, __range)      \
+    (weechat_plugin->hashtable_hash_key_string_range)(__string,         \
+                                                      __range)
 
 /* config files */
 #define weechat_config_new(__name, __callback_reload,                   \
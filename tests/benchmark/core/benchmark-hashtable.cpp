@@ -0,0 +1,273 @@
+/*
+ * benchmark-hashtable.cpp - benchmark of hashtable functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-string.h"
+#include "src/core/wee-util.h"
+#include "src/plugins/plugin.h"
+}
+
+#define BENCHMARK_HASHTABLE_ITEMS 100000
+#define BENCHMARK_HASHTABLE_NICKS 5000
+#define BENCHMARK_HASHTABLE_LOOPS 100
+
+TEST_GROUP(BenchmarkHashtable)
+{
+};
+
+/*
+ * Benchmark of adding and getting many keys in a hashtable created with a
+ * small size (32).
+ */
+
+TEST(BenchmarkHashtable, SetGet)
+{
+    struct t_hashtable *hashtable;
+    struct timeval tv_start, tv_end;
+    char **keys;
+    int i, found;
+
+    keys = (char **)malloc (BENCHMARK_HASHTABLE_ITEMS * sizeof (*keys));
+    CHECK(keys);
+    for (i = 0; i < BENCHMARK_HASHTABLE_ITEMS; i++)
+    {
+        keys[i] = (char *)malloc (32);
+        snprintf (keys[i], 32, "nick_%d", i);
+    }
+
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL,
+                               NULL);
+    CHECK(hashtable);
+
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_HASHTABLE_ITEMS; i++)
+    {
+        hashtable_set (hashtable, keys[i], keys[i]);
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\nhashtable_set: %d keys in %lld us (size: %d)",
+            BENCHMARK_HASHTABLE_ITEMS,
+            util_timeval_diff (&tv_start, &tv_end),
+            hashtable->size);
+
+    found = 0;
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_HASHTABLE_ITEMS; i++)
+    {
+        if (hashtable_get (hashtable, keys[i]))
+            found++;
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\nhashtable_get: %d keys in %lld us\n",
+            BENCHMARK_HASHTABLE_ITEMS,
+            util_timeval_diff (&tv_start, &tv_end));
+    LONGS_EQUAL(BENCHMARK_HASHTABLE_ITEMS, found);
+
+    hashtable_free (hashtable);
+    for (i = 0; i < BENCHMARK_HASHTABLE_ITEMS; i++)
+    {
+        free (keys[i]);
+    }
+    free (keys);
+}
+
+/*
+ * Callback hashing a key with djb2 (hash used before xxHash64).
+ */
+
+unsigned long long
+benchmark_hashtable_hash_key_djb2_cb (struct t_hashtable *hashtable,
+                                      const void *key)
+{
+    /* make C++ compiler happy */
+    (void) hashtable;
+
+    return hashtable_hash_key_djb2 ((const char *)key);
+}
+
+/*
+ * Callback hashing a key, case insensitive (IRC casemapping "rfc1459").
+ */
+
+unsigned long long
+benchmark_hashtable_hash_key_case_cb (struct t_hashtable *hashtable,
+                                      const void *key)
+{
+    /* make C++ compiler happy */
+    (void) hashtable;
+
+    return hashtable_hash_key_string_range ((const char *)key, 30);
+}
+
+/*
+ * Callback comparing two keys, case insensitive (IRC casemapping "rfc1459").
+ */
+
+int
+benchmark_hashtable_keycmp_case_cb (struct t_hashtable *hashtable,
+                                    const void *key1, const void *key2)
+{
+    /* make C++ compiler happy */
+    (void) hashtable;
+
+    return string_strcasecmp_range ((const char *)key1, (const char *)key2,
+                                    30);
+}
+
+/*
+ * Looks up all nicks in a hashtable and displays the time spent.
+ */
+
+void
+benchmark_hashtable_lookup (const char *name, struct t_hashtable *hashtable,
+                            char **nicks, int lower)
+{
+    struct timeval tv_start, tv_end;
+    char *nick_lower;
+    int i, j, found;
+
+    found = 0;
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_HASHTABLE_LOOPS; i++)
+    {
+        for (j = 0; j < BENCHMARK_HASHTABLE_NICKS; j++)
+        {
+            if (lower)
+            {
+                /* old way for case insensitive lookup: lower copy of key */
+                nick_lower = strdup (nicks[j]);
+                string_tolower (nick_lower);
+                if (hashtable_get_item (hashtable, nick_lower, NULL))
+                    found++;
+                free (nick_lower);
+            }
+            else
+            {
+                if (hashtable_get_item (hashtable, nicks[j], NULL))
+                    found++;
+            }
+        }
+    }
+    gettimeofday (&tv_end, NULL);
+    LONGS_EQUAL(BENCHMARK_HASHTABLE_NICKS * BENCHMARK_HASHTABLE_LOOPS,
+                found);
+
+    printf ("\n%s: %d lookups in %lld us",
+            name,
+            BENCHMARK_HASHTABLE_NICKS * BENCHMARK_HASHTABLE_LOOPS,
+            util_timeval_diff (&tv_start, &tv_end));
+}
+
+/*
+ * Benchmark of lookup with hash functions, with a realistic set of nicks
+ * (common prefixes and suffixes, mixed case).
+ */
+
+TEST(BenchmarkHashtable, HashNicks)
+{
+    const char *prefixes[] = { "Guest", "nick", "[afk]", "user_", "Bot" };
+    struct t_hashtable *hashtable;
+    char **nicks, *nick_lower;
+    int i;
+
+    nicks = (char **)malloc (BENCHMARK_HASHTABLE_NICKS * sizeof (*nicks));
+    CHECK(nicks);
+    for (i = 0; i < BENCHMARK_HASHTABLE_NICKS; i++)
+    {
+        nicks[i] = (char *)malloc (32);
+        CHECK(nicks[i]);
+        snprintf (nicks[i], 32, "%s%d%s", prefixes[i % 5], i / 5,
+                  (i % 3 == 0) ? "_away" : ((i % 3 == 1) ? "|Work" : ""));
+    }
+
+    /* djb2 */
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               &benchmark_hashtable_hash_key_djb2_cb,
+                               NULL);
+    CHECK(hashtable);
+    for (i = 0; i < BENCHMARK_HASHTABLE_NICKS; i++)
+    {
+        hashtable_set (hashtable, nicks[i], NULL);
+    }
+    benchmark_hashtable_lookup ("djb2", hashtable, nicks, 0);
+    hashtable_free (hashtable);
+
+    /* default hash for strings */
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL,
+                               NULL);
+    CHECK(hashtable);
+    for (i = 0; i < BENCHMARK_HASHTABLE_NICKS; i++)
+    {
+        hashtable_set (hashtable, nicks[i], NULL);
+    }
+    benchmark_hashtable_lookup ("string", hashtable, nicks, 0);
+
+    /* case insensitive: lower copy of key + default hash */
+    hashtable_remove_all (hashtable);
+    for (i = 0; i < BENCHMARK_HASHTABLE_NICKS; i++)
+    {
+        nick_lower = strdup (nicks[i]);
+        string_tolower (nick_lower);
+        hashtable_set (hashtable, nick_lower, NULL);
+        free (nick_lower);
+    }
+    benchmark_hashtable_lookup ("string (lower copy)", hashtable, nicks, 1);
+    hashtable_free (hashtable);
+
+    /* case insensitive: hash with range */
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               &benchmark_hashtable_hash_key_case_cb,
+                               &benchmark_hashtable_keycmp_case_cb);
+    CHECK(hashtable);
+    for (i = 0; i < BENCHMARK_HASHTABLE_NICKS; i++)
+    {
+        hashtable_set (hashtable, nicks[i], NULL);
+    }
+    benchmark_hashtable_lookup ("string_range (30) + strcasecmp_range",
+                                hashtable, nicks, 0);
+    printf ("\n");
+
+    hashtable_free (hashtable);
+
+    for (i = 0; i < BENCHMARK_HASHTABLE_NICKS; i++)
+    {
+        free (nicks[i]);
+    }
+    free (nicks);
+}
@@ -0,0 +1,190 @@
+/*
+ * benchmark-hook.cpp - benchmark of hook functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "src/core/wee-hook.h"
+#include "src/core/wee-util.h"
+#include "src/plugins/weechat-plugin.h"
+}
+
+#define BENCHMARK_HOOK_FD_IDLE_PIPES 500
+#define BENCHMARK_HOOK_FD_LOOPS      1000
+#define BENCHMARK_HOOK_MODIFIER_LOOPS 100000
+
+TEST_GROUP(BenchmarkHook)
+{
+};
+
+/*
+ * Callback for fd hooks: reads one byte and increments the counter.
+ */
+
+int
+benchmark_hook_fd_cb (const void *pointer, void *data, int fd)
+{
+    char buffer[1];
+    int *count;
+
+    /* make C++ compiler happy */
+    (void) data;
+
+    count = (int *)pointer;
+    if (read (fd, buffer, sizeof (buffer)) == 1)
+        (*count)++;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Benchmark of hook_fd_exec with each backend (poll and epoll): 1000 idle
+ * file descriptors and one active pipe.
+ */
+
+TEST(BenchmarkHook, FdBackends)
+{
+    int backends[2] = { HOOK_FD_BACKEND_POLL, HOOK_FD_BACKEND_EPOLL };
+    const char *backend_names[2] = { "poll", "epoll" };
+    int old_backend, i, j, count;
+    int idle_pipes[BENCHMARK_HOOK_FD_IDLE_PIPES][2], active_pipe[2];
+    struct t_hook *idle_hooks[BENCHMARK_HOOK_FD_IDLE_PIPES][2], *active_hook;
+    struct timeval tv_start, tv_end;
+
+    old_backend = hook_fd_backend;
+
+    for (i = 0; i < 2; i++)
+    {
+        hook_fd_set_backend (backends[i]);
+
+        for (j = 0; j < BENCHMARK_HOOK_FD_IDLE_PIPES; j++)
+        {
+            LONGS_EQUAL(0, pipe (idle_pipes[j]));
+            idle_hooks[j][0] = hook_fd (NULL, idle_pipes[j][0], 1, 0, 0,
+                                        &benchmark_hook_fd_cb, &count, NULL);
+            idle_hooks[j][1] = hook_fd (NULL, idle_pipes[j][1], 1, 0, 0,
+                                        &benchmark_hook_fd_cb, &count, NULL);
+        }
+
+        LONGS_EQUAL(0, pipe (active_pipe));
+        active_hook = hook_fd (NULL, active_pipe[0], 1, 0, 0,
+                               &benchmark_hook_fd_cb, &count, NULL);
+
+        count = 0;
+        gettimeofday (&tv_start, NULL);
+        for (j = 0; j < BENCHMARK_HOOK_FD_LOOPS; j++)
+        {
+            LONGS_EQUAL(1, write (active_pipe[1], "x", 1));
+            hook_fd_exec ();
+        }
+        gettimeofday (&tv_end, NULL);
+        LONGS_EQUAL(BENCHMARK_HOOK_FD_LOOPS, count);
+
+        printf ("\nhook_fd_exec (%s, %d idle fds): %d calls in %lld us",
+                backend_names[i],
+                BENCHMARK_HOOK_FD_IDLE_PIPES * 2,
+                BENCHMARK_HOOK_FD_LOOPS,
+                util_timeval_diff (&tv_start, &tv_end));
+
+        unhook (active_hook);
+        close (active_pipe[0]);
+        close (active_pipe[1]);
+        for (j = 0; j < BENCHMARK_HOOK_FD_IDLE_PIPES; j++)
+        {
+            unhook (idle_hooks[j][0]);
+            unhook (idle_hooks[j][1]);
+            close (idle_pipes[j][0]);
+            close (idle_pipes[j][1]);
+        }
+    }
+    printf ("\n");
+
+    hook_fd_set_backend (old_backend);
+}
+
+/*
+ * Callback for modifier hooks: returns no change.
+ */
+
+char *
+benchmark_hook_modifier_cb (const void *pointer, void *data,
+                            const char *modifier, const char *modifier_data,
+                            const char *string)
+{
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) modifier;
+    (void) modifier_data;
+    (void) string;
+
+    return NULL;
+}
+
+/*
+ * Benchmark of hook_modifier_exec with 0, 1 and 10 hooks on the modifier
+ * (the hooks return no change).
+ */
+
+TEST(BenchmarkHook, Modifier)
+{
+    int num_hooks[3] = { 0, 1, 10 };
+    struct t_hook *hooks[10];
+    struct timeval tv_start, tv_end;
+    char *result;
+    int i, j;
+
+    for (i = 0; i < 3; i++)
+    {
+        for (j = 0; j < num_hooks[i]; j++)
+        {
+            hooks[j] = hook_modifier (NULL, "test_modifier_bench",
+                                      &benchmark_hook_modifier_cb,
+                                      NULL, NULL);
+        }
+
+        gettimeofday (&tv_start, NULL);
+        for (j = 0; j < BENCHMARK_HOOK_MODIFIER_LOOPS; j++)
+        {
+            result = hook_modifier_exec (NULL, "test_modifier_bench",
+                                         "server", ":nick!user@host PRIVMSG "
+                                         "#channel :hello world");
+            free (result);
+        }
+        gettimeofday (&tv_end, NULL);
+
+        printf ("\nhook_modifier_exec (%d hooks): %d calls in %lld us",
+                num_hooks[i],
+                BENCHMARK_HOOK_MODIFIER_LOOPS,
+                util_timeval_diff (&tv_start, &tv_end));
+
+        for (j = 0; j < num_hooks[i]; j++)
+        {
+            unhook (hooks[j]);
+        }
+    }
+    printf ("\n");
+}
@@ -0,0 +1,159 @@
+/*
+ * benchmark-gui-filter.cpp - benchmark of filter functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include "src/core/wee-util.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-filter.h"
+#include "src/gui/gui-line.h"
+}
+
+#define BENCHMARK_GUI_FILTER_BUFFERS 200
+#define BENCHMARK_GUI_FILTER_LINES   4096
+#define BENCHMARK_GUI_FILTER_FILTERS 50
+
+TEST_GROUP(BenchmarkGuiFilter)
+{
+};
+
+/*
+ * Benchmark of filters: 50 filters added, toggled and removed on 200 buffers
+ * with 4096 lines.
+ */
+
+TEST(BenchmarkGuiFilter, AddToggleRemove)
+{
+    struct t_gui_buffer **buffers;
+    struct t_gui_filter *filters[BENCHMARK_GUI_FILTER_FILTERS];
+    struct t_gui_line *ptr_line;
+    struct timeval tv_start, tv_end;
+    char name[64], buffer_mask[64], tags[64], regex[64];
+    int i, j, hidden, hidden_full;
+
+    buffers = (struct t_gui_buffer **)malloc (BENCHMARK_GUI_FILTER_BUFFERS *
+                                              sizeof (*buffers));
+    CHECK(buffers);
+    for (i = 0; i < BENCHMARK_GUI_FILTER_BUFFERS; i++)
+    {
+        snprintf (name, sizeof (name), "test_filter_bench_%d", i);
+        buffers[i] = gui_buffer_new (NULL, name,
+                                     NULL, NULL, NULL, NULL, NULL, NULL);
+        CHECK(buffers[i]);
+        for (j = 0; j < BENCHMARK_GUI_FILTER_LINES; j++)
+        {
+            snprintf (tags, sizeof (tags), "irc_privmsg,tag_%d,nick_%d",
+                      j % 64, j % 100);
+            gui_chat_printf_date_tags (buffers[i], 0, tags,
+                                       "nick_%d\tmessage %d in buffer %d",
+                                       j % 100, j, i);
+        }
+    }
+
+    /*
+     * filters: on tags or regex, for all buffers or some buffers (mask
+     * "test_filter_bench_1*" matches 111 buffers of 200)
+     */
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_GUI_FILTER_FILTERS; i++)
+    {
+        snprintf (name, sizeof (name), "test_bench_%d", i);
+        snprintf (buffer_mask, sizeof (buffer_mask), "%s",
+                  (i % 2 == 0) ? "*" : "core.test_filter_bench_1*");
+        snprintf (tags, sizeof (tags), "tag_%d", i);
+        snprintf (regex, sizeof (regex), "message %d in", i * 7);
+        filters[i] = gui_filter_new (
+            1, name, buffer_mask,
+            (i % 3 == 0) ? "*" : tags,
+            (i % 3 == 0) ? regex : "*");
+        CHECK(filters[i]);
+        gui_filter_all_buffers ();
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\nfilter add: %d filters on %d buffers x %d lines in %lld us",
+            BENCHMARK_GUI_FILTER_FILTERS,
+            BENCHMARK_GUI_FILTER_BUFFERS,
+            BENCHMARK_GUI_FILTER_LINES,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    hidden = 0;
+    for (i = 0; i < BENCHMARK_GUI_FILTER_BUFFERS; i++)
+    {
+        hidden += buffers[i]->own_lines->lines_hidden;
+    }
+    CHECK(hidden > 0);
+
+    /* toggle each filter (disable then enable) */
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_GUI_FILTER_FILTERS; i++)
+    {
+        filters[i]->enabled = 0;
+        gui_filter_all_buffers ();
+        filters[i]->enabled = 1;
+        gui_filter_all_buffers ();
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\nfilter toggle: %d x 2 in %lld us",
+            BENCHMARK_GUI_FILTER_FILTERS,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    /* check all lines with all filters (without cache) */
+    hidden_full = 0;
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_GUI_FILTER_BUFFERS; i++)
+    {
+        for (ptr_line = buffers[i]->own_lines->first_line; ptr_line;
+             ptr_line = ptr_line->next_line)
+        {
+            if (!gui_filter_check_line (ptr_line->data))
+                hidden_full++;
+        }
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\nfilter check of all lines (no cache): %lld us\n",
+            util_timeval_diff (&tv_start, &tv_end));
+    LONGS_EQUAL(hidden, hidden_full);
+
+    /* remove filters */
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_GUI_FILTER_FILTERS; i++)
+    {
+        gui_filter_free (filters[i]);
+        gui_filter_all_buffers ();
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("filter remove: %d filters in %lld us\n",
+            BENCHMARK_GUI_FILTER_FILTERS,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    for (i = 0; i < BENCHMARK_GUI_FILTER_BUFFERS; i++)
+    {
+        LONGS_EQUAL(0, buffers[i]->own_lines->lines_hidden);
+        gui_buffer_close (buffers[i]);
+    }
+    free (buffers);
+}
@@ -0,0 +1,157 @@
+/*
+ * benchmark-gui-search-index.cpp - benchmark of search index functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <sys/time.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-util.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-input.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-search-index.h"
+}
+
+#define BENCHMARK_GUI_SEARCH_INDEX_LINES    50000
+#define BENCHMARK_GUI_SEARCH_INDEX_SEARCHES 100
+
+TEST_GROUP(BenchmarkGuiSearchIndex)
+{
+};
+
+/*
+ * Sets text searched in buffer.
+ */
+
+void
+benchmark_gui_search_index_set_search (struct t_gui_buffer *buffer,
+                                       const char *text)
+{
+    gui_buffer_set (buffer, "input", text);
+    buffer->text_search_exact = 0;
+    buffer->text_search_regex = 0;
+    buffer->text_search_where = GUI_TEXT_SEARCH_IN_PREFIX |
+        GUI_TEXT_SEARCH_IN_MESSAGE;
+    gui_input_search_compile_regex (buffer);
+}
+
+/*
+ * Searches text in buffer without search index (all lines are checked, from
+ * the end of buffer).
+ */
+
+struct t_gui_line *
+benchmark_gui_search_index_search_lines (struct t_gui_buffer *buffer)
+{
+    struct t_gui_line *ptr_line;
+
+    ptr_line = gui_line_get_last_displayed (buffer);
+    while (ptr_line && !gui_line_search_text (buffer, ptr_line))
+    {
+        ptr_line = gui_line_get_prev_displayed (ptr_line);
+    }
+
+    return ptr_line;
+}
+
+/*
+ * Benchmark of text search: 100 searches in a buffer with 50000 lines, with
+ * and without index.
+ */
+
+TEST(BenchmarkGuiSearchIndex, Search)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line, *ptr_line_index;
+    struct timeval tv_start, tv_end;
+    char text[64];
+    int i;
+
+    /* keep all lines in buffer */
+    config_file_option_set (config_history_max_buffer_lines_number, "0", 1);
+
+    buffer = gui_buffer_new (NULL, "benchmark_search_index",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    for (i = 0; i < BENCHMARK_GUI_SEARCH_INDEX_LINES; i++)
+    {
+        gui_chat_printf (buffer, "%snick_%d\tthis is the %smessage%s %d",
+                         gui_color_get_custom ("green"), i % 100,
+                         gui_color_get_custom ("bold"),
+                         gui_color_get_custom ("-bold"), i);
+    }
+
+    /* search of the same texts, from the end of buffer */
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_GUI_SEARCH_INDEX_SEARCHES; i++)
+    {
+        snprintf (text, sizeof (text), "message %d", i * 7);
+        benchmark_gui_search_index_set_search (buffer, text);
+        ptr_line = benchmark_gui_search_index_search_lines (buffer);
+        CHECK(ptr_line);
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\nsearch without index: %d searches in %d lines in %lld us",
+            BENCHMARK_GUI_SEARCH_INDEX_SEARCHES,
+            BENCHMARK_GUI_SEARCH_INDEX_LINES,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    gettimeofday (&tv_start, NULL);
+    gui_search_index_build (buffer);
+    gettimeofday (&tv_end, NULL);
+    printf ("\nsearch index build: %lld us",
+            util_timeval_diff (&tv_start, &tv_end));
+
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < BENCHMARK_GUI_SEARCH_INDEX_SEARCHES; i++)
+    {
+        snprintf (text, sizeof (text), "message %d", i * 7);
+        benchmark_gui_search_index_set_search (buffer, text);
+        LONGS_EQUAL(1, gui_search_index_search (buffer, NULL, 1,
+                                                &ptr_line_index));
+        CHECK(ptr_line_index);
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\nsearch with index: %d searches in %d lines in %lld us\n",
+            BENCHMARK_GUI_SEARCH_INDEX_SEARCHES,
+            BENCHMARK_GUI_SEARCH_INDEX_LINES,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    /* same results with and without index */
+    for (i = 0; i < BENCHMARK_GUI_SEARCH_INDEX_SEARCHES; i++)
+    {
+        snprintf (text, sizeof (text), "message %d", i * 7);
+        benchmark_gui_search_index_set_search (buffer, text);
+        gui_search_index_search (buffer, NULL, 1, &ptr_line_index);
+        ptr_line = benchmark_gui_search_index_search_lines (buffer);
+        POINTERS_EQUAL(ptr_line, ptr_line_index);
+    }
+
+    gui_buffer_close (buffer);
+
+    config_file_option_reset (config_history_max_buffer_lines_number, 1);
+}
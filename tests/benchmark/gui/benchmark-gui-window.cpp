@@ -0,0 +1,159 @@
+/*
+ * benchmark-gui-window.cpp - benchmark of window functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <sys/time.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-util.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-window.h"
+
+extern void gui_chat_calculate_line_diff (struct t_gui_window *window,
+                                          struct t_gui_line **line,
+                                          int *line_pos, int difference);
+}
+
+#define BENCHMARK_GUI_WINDOW_LINES 50000
+
+TEST_GROUP(BenchmarkGuiWindow)
+{
+};
+
+/*
+ * Benchmark of scroll (page up) from bottom to top of a buffer with 50000
+ * lines, with and without layout of lines.
+ */
+
+TEST(BenchmarkGuiWindow, PageUp)
+{
+    struct t_gui_buffer *buffer, *old_buffer;
+    struct t_gui_window *window;
+    struct t_gui_line *ptr_line, *ptr_line_cache;
+    struct timeval tv_start, tv_end;
+    int i, line_pos, line_pos_cache, pages, page_lines;
+    int old_width, old_height;
+
+    /* keep all lines in buffer */
+    config_file_option_set (config_history_max_buffer_lines_number, "0", 1);
+
+    window = gui_current_window;
+    old_buffer = window->buffer;
+    old_width = window->win_chat_width;
+    old_height = window->win_chat_height;
+
+    buffer = gui_buffer_new (NULL, "benchmark_window",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    gui_window_switch_to_buffer (window, buffer, 0);
+    window->win_chat_width = 80;
+    window->win_chat_height = 25;
+
+    for (i = 0; i < BENCHMARK_GUI_WINDOW_LINES; i++)
+    {
+        gui_chat_printf (buffer,
+                         "nick_%d\tthis is the %smessage%s %d, a message "
+                         "long enough to be displayed on %d lines if "
+                         "the window is not very large",
+                         i % 100,
+                         gui_color_get_custom ("bold"),
+                         gui_color_get_custom ("-bold"),
+                         i, 1 + (i % 3));
+    }
+
+    page_lines = window->win_chat_height - 1;
+
+    /* page up without layout of lines (computed for each page) */
+    ptr_line = NULL;
+    line_pos = 0;
+    pages = 0;
+    gettimeofday (&tv_start, NULL);
+    while (1)
+    {
+        gui_window_lines_layout_invalidate ();
+        gui_chat_calculate_line_diff (window, &ptr_line, &line_pos,
+                                      (-1) * page_lines);
+        pages++;
+        if (!ptr_line
+            || ((ptr_line == buffer->own_lines->first_line)
+                && (line_pos == 0)))
+        {
+            break;
+        }
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\npage up without layout: %d pages in %lld us",
+            pages, util_timeval_diff (&tv_start, &tv_end));
+
+    /* page up with layout of lines */
+    ptr_line_cache = NULL;
+    line_pos_cache = 0;
+    pages = 0;
+    gettimeofday (&tv_start, NULL);
+    while (1)
+    {
+        gui_chat_calculate_line_diff (window, &ptr_line_cache,
+                                      &line_pos_cache, (-1) * page_lines);
+        pages++;
+        if (!ptr_line_cache
+            || ((ptr_line_cache == buffer->own_lines->first_line)
+                && (line_pos_cache == 0)))
+        {
+            break;
+        }
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\npage up with layout (first time): %d pages in %lld us",
+            pages, util_timeval_diff (&tv_start, &tv_end));
+
+    /* page down, then page up again with layout of lines */
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < pages; i++)
+    {
+        gui_chat_calculate_line_diff (window, &ptr_line_cache,
+                                      &line_pos_cache, page_lines);
+    }
+    for (i = 0; i < pages; i++)
+    {
+        gui_chat_calculate_line_diff (window, &ptr_line_cache,
+                                      &line_pos_cache, (-1) * page_lines);
+    }
+    gettimeofday (&tv_end, NULL);
+    printf ("\npage down + up with layout: %d x 2 pages in %lld us\n",
+            pages, util_timeval_diff (&tv_start, &tv_end));
+
+    POINTERS_EQUAL(ptr_line, ptr_line_cache);
+    LONGS_EQUAL(line_pos, line_pos_cache);
+
+    window->win_chat_width = old_width;
+    window->win_chat_height = old_height;
+    gui_window_switch_to_buffer (window, old_buffer, 0);
+    gui_buffer_close (buffer);
+
+    config_file_option_reset (config_history_max_buffer_lines_number, 1);
+}
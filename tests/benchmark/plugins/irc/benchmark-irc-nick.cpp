@@ -0,0 +1,180 @@
+/*
+ * benchmark-irc-nick.cpp - benchmark of IRC nick functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include "src/core/wee-string.h"
+#include "src/core/wee-util.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/plugin.h"
+}
+
+#include "tests/unit/plugins/irc/test-irc-fake-server.h"
+
+#define BENCHMARK_IRC_NICK_NICKS         20000
+#define BENCHMARK_IRC_NICK_NAMES_PER_MSG 40
+#define BENCHMARK_IRC_NICK_SPEAKING_NICKS 1000
+#define BENCHMARK_IRC_NICK_SPEAKING_MSGS  50000
+
+TEST_GROUP(BenchmarkIrcNick)
+{
+};
+
+/*
+ * Benchmark of join of a synthetic channel with 20000 nicks on a fake IRC
+ * server (listening on localhost), then of a netsplit (all nicks quit).
+ */
+
+TEST(BenchmarkIrcNick, JoinQuit)
+{
+    struct t_test_irc_fake_server server;
+    struct t_gui_buffer *ptr_buffer;
+    struct timeval tv_start, tv_end;
+    time_t start;
+    char command[256], **msg, str_nick[64];
+    int i;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, benchmark skipped\n");
+        return;
+    }
+
+    /* fake IRC server on localhost (random port) */
+    CHECK(test_irc_fake_server_start (&server, "bench", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#bench\r\n");
+    test_irc_fake_server_wait_count (&server, "#bench", 1);
+
+    /* NAMES: 20000 nicks (+ own nick) */
+    msg = string_dyn_alloc (256 * 1024);
+    CHECK(msg);
+    for (i = 0; i < BENCHMARK_IRC_NICK_NICKS; i++)
+    {
+        if (i % BENCHMARK_IRC_NICK_NAMES_PER_MSG == 0)
+            string_dyn_concat (msg, ":server 353 alice = #bench :");
+        snprintf (str_nick, sizeof (str_nick), "%sNick_%05d%s",
+                  (i % 10 == 0) ? "@" : ((i % 10 == 1) ? "+" : ""),
+                  i,
+                  ((i % BENCHMARK_IRC_NICK_NAMES_PER_MSG == BENCHMARK_IRC_NICK_NAMES_PER_MSG - 1)
+                   || (i == BENCHMARK_IRC_NICK_NICKS - 1)) ? "\r\n" : " ");
+        string_dyn_concat (msg, str_nick);
+    }
+    string_dyn_concat (msg, ":server 353 alice = #bench :alice\r\n"
+                       ":server 366 alice #bench :End of /NAMES list.\r\n");
+    gettimeofday (&tv_start, NULL);
+    test_irc_fake_server_send (&server, *msg);
+    test_irc_fake_server_wait_count (&server, "#bench",
+                                     BENCHMARK_IRC_NICK_NICKS + 1);
+    ptr_buffer = gui_buffer_search_by_full_name ("irc.bench.#bench");
+    CHECK(ptr_buffer);
+    start = time (NULL);
+    while (ptr_buffer->nicklist_batch
+           && (time (NULL) - start < TEST_IRC_FAKE_SERVER_TIMEOUT))
+    {
+        test_irc_fake_server_run_hooks (&server);
+    }
+    gettimeofday (&tv_end, NULL);
+    LONGS_EQUAL(BENCHMARK_IRC_NICK_NICKS + 1,
+                test_irc_fake_server_nick_count (&server, "#bench"));
+    printf ("\nIRC join: %d nicks in %lld us",
+            BENCHMARK_IRC_NICK_NICKS,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    /* netsplit: all nicks quit */
+    string_dyn_copy (msg, NULL);
+    for (i = 0; i < BENCHMARK_IRC_NICK_NICKS; i++)
+    {
+        snprintf (command, sizeof (command),
+                  ":Nick_%05d!user@host QUIT :irc.example.com irc2.example.com\r\n",
+                  i);
+        string_dyn_concat (msg, command);
+    }
+    gettimeofday (&tv_start, NULL);
+    test_irc_fake_server_send (&server, *msg);
+    test_irc_fake_server_wait_count (&server, "#bench", 1);
+    gettimeofday (&tv_end, NULL);
+    LONGS_EQUAL(1, test_irc_fake_server_nick_count (&server, "#bench"));
+    printf ("\nIRC quit: %d nicks in %lld us\n",
+            BENCHMARK_IRC_NICK_NICKS,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    string_dyn_free (msg, 1);
+
+    test_irc_fake_server_stop (&server);
+}
+
+/*
+ * Benchmark of 50000 messages received from 1000 nicks in a channel (update
+ * of lists of nicks speaking).
+ */
+
+TEST(BenchmarkIrcNick, NickSpeaking)
+{
+    struct t_test_irc_fake_server server;
+    struct timeval tv_start, tv_end;
+    char line[256], **msg;
+    int i;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, benchmark skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "benchspeak", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#speak\r\n");
+    test_irc_fake_server_wait_count (&server, "#speak", 1);
+
+    msg = string_dyn_alloc (BENCHMARK_IRC_NICK_SPEAKING_MSGS * 64);
+    CHECK(msg);
+    for (i = 0; i < BENCHMARK_IRC_NICK_SPEAKING_MSGS; i++)
+    {
+        snprintf (line, sizeof (line),
+                  ":nick%d!user@host PRIVMSG #speak :message %d\r\n",
+                  (i * 7) % BENCHMARK_IRC_NICK_SPEAKING_NICKS, i);
+        string_dyn_concat (msg, line);
+    }
+    string_dyn_concat (msg, ":bob!user@host JOIN :#speak\r\n");
+    gettimeofday (&tv_start, NULL);
+    test_irc_fake_server_send (&server, *msg);
+    test_irc_fake_server_wait_count (&server, "#speak", 2);
+    gettimeofday (&tv_end, NULL);
+    LONGS_EQUAL(2, test_irc_fake_server_nick_count (&server, "#speak"));
+    printf ("\nIRC nicks speaking: %d messages from %d nicks in %lld us\n",
+            BENCHMARK_IRC_NICK_SPEAKING_MSGS,
+            BENCHMARK_IRC_NICK_SPEAKING_NICKS,
+            util_timeval_diff (&tv_start, &tv_end));
+
+    string_dyn_free (msg, 1);
+
+    test_irc_fake_server_stop (&server);
+}
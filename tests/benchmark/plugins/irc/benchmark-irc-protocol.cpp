@@ -0,0 +1,155 @@
+/*
+ * benchmark-irc-protocol.cpp - benchmark of IRC protocol functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <sys/time.h>
+#include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
+#include "src/core/wee-util.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/plugin.h"
+}
+
+#include "tests/unit/plugins/irc/test-irc-fake-server.h"
+
+#define BENCHMARK_IRC_PROTOCOL_LINES 100000
+#define BENCHMARK_IRC_PROTOCOL_IGNORES 1000
+
+TEST_GROUP(BenchmarkIrcProtocol)
+{
+};
+
+/*
+ * Benchmark of messages received from a fake IRC server (listening on
+ * localhost): number of lines per second handled by WeeChat in the whole
+ * receive path (read on socket, split of lines, modifiers and signals,
+ * parsing, ignore, callback of IRC command).
+ *
+ * Messages are sent by an ignored host (except PING), so that nothing is
+ * displayed in buffers; many other ignores (literal masks and masks with
+ * wildcards, on any channel or a specific channel) are added before.
+ */
+
+TEST(BenchmarkIrcProtocol, Recv)
+{
+    struct t_test_irc_fake_server server;
+    struct timeval tv_start, tv_end;
+    char line[256], **msg;
+    long long diff;
+    int i;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, benchmark skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "bench", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#bench\r\n");
+    test_irc_fake_server_wait_count (&server, "#bench", 1);
+    LONGS_EQUAL(1, test_irc_fake_server_nick_count (&server, "#bench"));
+
+    for (i = 0; i < BENCHMARK_IRC_PROTOCOL_IGNORES; i++)
+    {
+        switch (i % 4)
+        {
+            case 0:
+                snprintf (line, sizeof (line),
+                          "/mute /ignore add ignored%d", i);
+                break;
+            case 1:
+                snprintf (line, sizeof (line),
+                          "/mute /ignore add ignored%d!*@*", i);
+                break;
+            case 2:
+                snprintf (line, sizeof (line),
+                          "/mute /ignore add *@host%d.example.com bench", i);
+                break;
+            case 3:
+                snprintf (line, sizeof (line),
+                          "/mute /ignore add ignored%d bench #chan%d", i, i);
+                break;
+        }
+        input_data (gui_buffer_search_main (), line);
+    }
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add *@spam.example.com bench");
+
+    msg = string_dyn_alloc (BENCHMARK_IRC_PROTOCOL_LINES * 96);
+    CHECK(msg);
+    for (i = 0; i < BENCHMARK_IRC_PROTOCOL_LINES; i++)
+    {
+        switch (i % 4)
+        {
+            case 0:
+                snprintf (line, sizeof (line),
+                          ":nick%d!user@spam.example.com PRIVMSG #bench "
+                          ":hello, this is message %d\r\n",
+                          i % 100, i);
+                break;
+            case 1:
+                snprintf (line, sizeof (line),
+                          "@time=2017-04-20T12:00:00.000Z "
+                          ":nick%d!user@spam.example.com PRIVMSG #bench "
+                          ":\x02" "bold\x02 message %d\r\n",
+                          i % 100, i);
+                break;
+            case 2:
+                snprintf (line, sizeof (line),
+                          ":nick%d!user@spam.example.com NOTICE alice "
+                          ":notice %d\r\n",
+                          i % 100, i);
+                break;
+            case 3:
+                snprintf (line, sizeof (line), "PING :server%d\r\n", i);
+                break;
+        }
+        string_dyn_concat (msg, line);
+    }
+    /* last message: a nick joins the channel (end of benchmark) */
+    string_dyn_concat (msg, ":bob!user@host JOIN :#bench\r\n");
+
+    gettimeofday (&tv_start, NULL);
+    test_irc_fake_server_send (&server, *msg);
+    test_irc_fake_server_wait_count (&server, "#bench", 2);
+    gettimeofday (&tv_end, NULL);
+    LONGS_EQUAL(2, test_irc_fake_server_nick_count (&server, "#bench"));
+
+    diff = util_timeval_diff (&tv_start, &tv_end);
+    printf ("\nIRC recv: %d lines in %lld us (%lld lines/s), %d ignores\n",
+            BENCHMARK_IRC_PROTOCOL_LINES + 1,
+            diff,
+            (diff > 0) ?
+            ((long long)(BENCHMARK_IRC_PROTOCOL_LINES + 1) * 1000000LL) / diff : 0,
+            BENCHMARK_IRC_PROTOCOL_IGNORES + 1);
+
+    string_dyn_free (msg, 1);
+
+    input_data (gui_buffer_search_main (), "/mute /ignore del -all");
+    test_irc_fake_server_stop (&server);
+}
@@ -46,18 +46,38 @@ extern "C"
 
 #include "CppUTest/CommandLineTestRunner.h"
 
+#ifdef WEECHAT_TESTS_BENCHMARK
+/* import benchmarks from libs */
+IMPORT_TEST_GROUP(BenchmarkHashtable);
+IMPORT_TEST_GROUP(BenchmarkHook);
+IMPORT_TEST_GROUP(BenchmarkGuiFilter);
+IMPORT_TEST_GROUP(BenchmarkGuiSearchIndex);
+IMPORT_TEST_GROUP(BenchmarkGuiWindow);
+IMPORT_TEST_GROUP(BenchmarkIrcNick);
+IMPORT_TEST_GROUP(BenchmarkIrcProtocol);
+#else
 /* import tests from libs */
 IMPORT_TEST_GROUP(Plugins);
 IMPORT_TEST_GROUP(Arraylist);
 IMPORT_TEST_GROUP(Eval);
 IMPORT_TEST_GROUP(Hashtable);
 IMPORT_TEST_GROUP(Hdata);
+IMPORT_TEST_GROUP(Hook);
 IMPORT_TEST_GROUP(Infolist);
 IMPORT_TEST_GROUP(List);
 IMPORT_TEST_GROUP(String);
 IMPORT_TEST_GROUP(Url);
 IMPORT_TEST_GROUP(Utf8);
 IMPORT_TEST_GROUP(Util);
+IMPORT_TEST_GROUP(GuiFilter);
+IMPORT_TEST_GROUP(GuiLine);
+IMPORT_TEST_GROUP(GuiSearchIndex);
+IMPORT_TEST_GROUP(GuiWindow);
+IMPORT_TEST_GROUP(IrcIgnore);
+IMPORT_TEST_GROUP(IrcNick);
+IMPORT_TEST_GROUP(IrcProtocol);
+IMPORT_TEST_GROUP(IrcServer);
+#endif /* WEECHAT_TESTS_BENCHMARK */
 
 
 /*
@@ -96,9 +116,11 @@ test_print_cb (const void *pointer, void *data, struct t_gui_buffer *buffer,
 void
 test_gui_init ()
 {
+#ifndef WEECHAT_TESTS_BENCHMARK
     /*
      * Catch all messages to display them directly on stdout
-     * (Curses library is not used for tests).
+     * (Curses library is not used for tests); benchmarks display only
+     * their results.
      */
     hook_print (NULL,  /* plugin */
                 NULL,  /* buffer */
@@ -108,6 +130,7 @@ test_gui_init ()
                 &test_print_cb,
                 NULL,
                 NULL);
+#endif /* WEECHAT_TESTS_BENCHMARK */
 
     /*
      * Call the function "gui_main_init" from Curses sources (all Curses
@@ -23,14 +23,18 @@
 
 extern "C"
 {
+#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include "src/core/wee-hashtable.h"
+#include "src/core/wee-string.h"
 #include "src/plugins/plugin.h"
 }
 
 #define HASHTABLE_TEST_KEY      "test"
 #define HASHTABLE_TEST_KEY_HASH 5849825121ULL
 #define HASHTABLE_TEST_VALUE    "this is a value"
+#define HASHTABLE_TEST_GROWTH_ITEMS 1000
 
 TEST_GROUP(Hashtable)
 {
@@ -49,6 +53,73 @@ TEST(Hashtable, HashDbj2)
     CHECK(hash == HASHTABLE_TEST_KEY_HASH);
 }
 
+/*
+ * Tests functions:
+ *   hashtable_hash_key_string
+ *   hashtable_hash_key_string_range
+ */
+
+TEST(Hashtable, HashString)
+{
+    char str1[64], str2[64];
+    int i, length;
+
+    /* same string => same hash, for all lengths (words of 8/4 bytes + tail) */
+    for (length = 0; length < 40; length++)
+    {
+        for (i = 0; i < length; i++)
+        {
+            str1[i] = 'a' + (i % 26);
+        }
+        str1[length] = '\0';
+        strcpy (str2, str1);
+        CHECK(hashtable_hash_key_string (str1)
+              == hashtable_hash_key_string (str2));
+        if (length > 0)
+        {
+            /* one char changed => different hash */
+            str2[length - 1] = str1[length - 1] - ('a' - 'A');
+            CHECK(hashtable_hash_key_string (str1)
+                  != hashtable_hash_key_string (str2));
+            /* same hash if case is ignored */
+            CHECK(hashtable_hash_key_string_range (str1, 26)
+                  == hashtable_hash_key_string_range (str2, 26));
+        }
+    }
+
+    /* strings with a common prefix */
+    CHECK(hashtable_hash_key_string ("nick_12345")
+          != hashtable_hash_key_string ("nick_12346"));
+    CHECK(hashtable_hash_key_string ("#channel1")
+          != hashtable_hash_key_string ("#channel2"));
+
+    /* range 0 is case sensitive */
+    CHECK(hashtable_hash_key_string_range ("Nick", 0)
+          == hashtable_hash_key_string ("Nick"));
+    CHECK(hashtable_hash_key_string_range ("Nick", 0)
+          != hashtable_hash_key_string_range ("nick", 0));
+
+    /* range 26: only letters */
+    CHECK(hashtable_hash_key_string_range ("NICK_Long_NAME", 26)
+          == hashtable_hash_key_string_range ("nick_long_name", 26));
+    CHECK(hashtable_hash_key_string_range ("nick[]\\^", 26)
+          != hashtable_hash_key_string_range ("nick{}|~", 26));
+
+    /* range 29: letters and "[]\" */
+    CHECK(hashtable_hash_key_string_range ("Nick[]\\", 29)
+          == hashtable_hash_key_string_range ("nick{}|", 29));
+    CHECK(hashtable_hash_key_string_range ("nick^", 29)
+          != hashtable_hash_key_string_range ("nick~", 29));
+
+    /* range 30: letters and "[]\^" (in words of 8 and 4 bytes, and tail) */
+    CHECK(hashtable_hash_key_string_range ("[Nick]^\\Test[", 30)
+          == hashtable_hash_key_string_range ("{nick}~|test{", 30));
+
+    /* chars >= 128 and "@" (before "A") are never converted */
+    CHECK(hashtable_hash_key_string_range ("\xc3\x89t\xc3\xa9@12345", 30)
+          != hashtable_hash_key_string_range ("\xc3\xa9t\xc3\xa9`12345", 30));
+}
+
 /*
  * Test callback hashing a key.
  *
@@ -80,6 +151,20 @@ test_hashtable_keycmp_cb (struct t_hashtable *hashtable,
     return strcmp ((const char *)key1, (const char *)key2);
 }
 
+/*
+ * Test callback hashing a key with djb2 (hash used before xxHash64).
+ */
+
+unsigned long long
+test_hashtable_hash_key_djb2_cb (struct t_hashtable *hashtable,
+                                 const void *key)
+{
+    /* make C++ compiler happy */
+    (void) hashtable;
+
+    return hashtable_hash_key_djb2 ((const char *)key);
+}
+
 /*
  * Tests functions:
  *   hashtable_new
@@ -179,6 +264,7 @@ TEST(Hashtable, SetGetRemove)
     LONGS_EQUAL(strlen (str_key) + 1, item->key_size);
     STRCMP_EQUAL(str_value, (const char *)item->value);
     LONGS_EQUAL(strlen (str_value) + 1, item->value_size);
+    CHECK(item->hash == HASHTABLE_TEST_KEY_HASH + 1);
     POINTERS_EQUAL(NULL, item->prev_item);
     POINTERS_EQUAL(NULL, item->next_item);
 
@@ -275,7 +361,7 @@ TEST(Hashtable, SetGetRemove)
     hashtable_free (hashtable2);
 
     /*
-     * create a hashtable with size 8, and add 6 items,
+     * create a hashtable with size 8 (using djb2 hash), and add 6 items,
      * to check if many items with same hashed key work fine,
      * the expected htable inside hashtable is:
      *   +-----+
@@ -299,7 +385,7 @@ TEST(Hashtable, SetGetRemove)
     hashtable = hashtable_new (8,
                                WEECHAT_HASHTABLE_STRING,
                                WEECHAT_HASHTABLE_STRING,
-                               NULL,
+                               &test_hashtable_hash_key_djb2_cb,
                                NULL);
     LONGS_EQUAL(8, hashtable->size);
     LONGS_EQUAL(0, hashtable->items_count);
@@ -332,6 +418,206 @@ TEST(Hashtable, SetGetRemove)
     hashtable_free (hashtable);
 }
 
+/*
+ * Callback for map: adds keys in the hashtable while it is read.
+ */
+
+void
+test_hashtable_map_add_cb (void *data,
+                           struct t_hashtable *hashtable,
+                           const void *key, const void *value)
+{
+    char str_key[64];
+    int *count;
+
+    /* make C++ compiler happy */
+    (void) value;
+
+    count = (int *)data;
+    (*count)++;
+
+    snprintf (str_key, sizeof (str_key), "added_%s", (const char *)key);
+    hashtable_set (hashtable, str_key, NULL);
+}
+
+/*
+ * Tests functions:
+ *   hashtable_set_with_size (growth of hashtable)
+ *   hashtable_resize
+ *   hashtable_search_item
+ */
+
+TEST(Hashtable, Growth)
+{
+    struct t_hashtable *hashtable;
+    struct t_hashtable_item *ptr_item;
+    char str_key[64], str_value[64];
+    int i, count;
+
+    hashtable = hashtable_new (8,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL,
+                               NULL);
+    CHECK(hashtable);
+
+    /* no growth while load factor is not reached */
+    for (i = 0; i < 8; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        CHECK(hashtable_set (hashtable, str_key, NULL));
+    }
+    LONGS_EQUAL(8, hashtable->size);
+    LONGS_EQUAL(8, hashtable->items_count);
+
+    /* the htable is doubled with one more item */
+    CHECK(hashtable_set (hashtable, "key8", NULL));
+    LONGS_EQUAL(16, hashtable->size);
+    LONGS_EQUAL(9, hashtable->items_count);
+
+    /* add many items */
+    for (i = 0; i < HASHTABLE_TEST_GROWTH_ITEMS; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        snprintf (str_value, sizeof (str_value), "value%d", i);
+        CHECK(hashtable_set (hashtable, str_key, str_value));
+    }
+    LONGS_EQUAL(HASHTABLE_TEST_GROWTH_ITEMS, hashtable->items_count);
+    CHECK(hashtable->items_count <= hashtable->size * HASHTABLE_LOAD_FACTOR_MAX);
+    LONGS_EQUAL(1024, hashtable->size);
+
+    /* all items are still found, with the right value */
+    for (i = 0; i < HASHTABLE_TEST_GROWTH_ITEMS; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        snprintf (str_value, sizeof (str_value), "value%d", i);
+        STRCMP_EQUAL(str_value, (const char *)hashtable_get (hashtable,
+                                                             str_key));
+    }
+    POINTERS_EQUAL(NULL, hashtable_get (hashtable, "key_not_found"));
+
+    /* each linked list is sorted by hash, with the right index in htable */
+    count = 0;
+    for (i = 0; i < hashtable->size; i++)
+    {
+        for (ptr_item = hashtable->htable[i]; ptr_item;
+             ptr_item = ptr_item->next_item)
+        {
+            LONGS_EQUAL(i, ptr_item->hash % hashtable->size);
+            CHECK(ptr_item->hash == hashtable_hash_key_string (
+                      (const char *)ptr_item->key));
+            if (ptr_item->prev_item)
+                CHECK(ptr_item->prev_item->hash <= ptr_item->hash);
+            count++;
+        }
+    }
+    LONGS_EQUAL(HASHTABLE_TEST_GROWTH_ITEMS, count);
+
+    /* remove half of items */
+    for (i = 0; i < HASHTABLE_TEST_GROWTH_ITEMS; i += 2)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        hashtable_remove (hashtable, str_key);
+    }
+    LONGS_EQUAL(HASHTABLE_TEST_GROWTH_ITEMS / 2, hashtable->items_count);
+    for (i = 0; i < HASHTABLE_TEST_GROWTH_ITEMS; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        LONGS_EQUAL(i % 2, hashtable_has_key (hashtable, str_key));
+    }
+
+    hashtable_free (hashtable);
+
+    /* htable is not resized while hashtable_map is running */
+    hashtable = hashtable_new (4,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL,
+                               NULL);
+    CHECK(hashtable);
+    hashtable_set (hashtable, "a", NULL);
+    hashtable_set (hashtable, "b", NULL);
+    hashtable_set (hashtable, "c", NULL);
+    count = 0;
+    hashtable_map (hashtable, &test_hashtable_map_add_cb, &count);
+    CHECK(count >= 3);
+    LONGS_EQUAL(4, hashtable->size);
+    LONGS_EQUAL(0, hashtable->map_running);
+    CHECK(hashtable_has_key (hashtable, "added_a"));
+    CHECK(hashtable_has_key (hashtable, "added_b"));
+    CHECK(hashtable_has_key (hashtable, "added_c"));
+
+    /* next insertion resizes the htable */
+    hashtable_set (hashtable, "d", NULL);
+    CHECK(hashtable->size > 4);
+    CHECK(hashtable_has_key (hashtable, "added_a"));
+
+    hashtable_free (hashtable);
+}
+
+/*
+ * Test callback hashing a key, case insensitive (IRC casemapping "rfc1459").
+ */
+
+unsigned long long
+test_hashtable_hash_key_case_cb (struct t_hashtable *hashtable,
+                                 const void *key)
+{
+    /* make C++ compiler happy */
+    (void) hashtable;
+
+    return hashtable_hash_key_string_range ((const char *)key, 30);
+}
+
+/*
+ * Test callback comparing two keys, case insensitive (IRC casemapping
+ * "rfc1459").
+ */
+
+int
+test_hashtable_keycmp_case_cb (struct t_hashtable *hashtable,
+                               const void *key1, const void *key2)
+{
+    /* make C++ compiler happy */
+    (void) hashtable;
+
+    return string_strcasecmp_range ((const char *)key1, (const char *)key2,
+                                    30);
+}
+
+/*
+ * Tests functions:
+ *   hashtable_get_item (with callbacks for case insensitive keys)
+ */
+
+TEST(Hashtable, CaseInsensitive)
+{
+    struct t_hashtable *hashtable;
+
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               &test_hashtable_hash_key_case_cb,
+                               &test_hashtable_keycmp_case_cb);
+    CHECK(hashtable);
+    hashtable_set (hashtable, "Guest0_away", NULL);
+    hashtable_set (hashtable, "nick0|Work", NULL);
+    hashtable_set (hashtable, "[afk]1", NULL);
+    LONGS_EQUAL(3, hashtable->items_count);
+
+    /* same key with another case: item is replaced */
+    hashtable_set (hashtable, "NICK0\\WORK", NULL);
+    LONGS_EQUAL(3, hashtable->items_count);
+
+    POINTERS_EQUAL(NULL, hashtable_get_item (hashtable, "guest0", NULL));
+    CHECK(hashtable_get_item (hashtable, "GUEST0_AWAY", NULL));
+    CHECK(hashtable_get_item (hashtable, "nick0\\work", NULL));
+    CHECK(hashtable_get_item (hashtable, "{AFK}1", NULL));
+    POINTERS_EQUAL(NULL, hashtable_get_item (hashtable, "{afk}2", NULL));
+
+    hashtable_free (hashtable);
+}
+
 /*
  * Tests functions:
  *   hashtable_map
@@ -0,0 +1,1288 @@
+/*
+ * test-hook.cpp - test hook functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-network.h"
+#include "src/core/wee-proxy.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/plugins/weechat-plugin.h"
+
+    extern int hook_timer_get_time_to_next ();
+    extern int hook_timer_heap_add (struct t_hook *hook);
+    extern void hook_timer_heap_remove (struct t_hook *hook);
+}
+
+#define TEST_HOOK_FD_IDLE_PIPES 10
+#define TEST_HOOK_FD_LOOPS      10
+#define TEST_HOOK_CONNECT_TIMEOUT 5
+#define TEST_HOOK_PROCESS_TIMEOUT 5
+
+struct t_test_hook_connect
+{
+    int count;                         /* number of calls to callback       */
+    int status;                        /* status received                   */
+    int sock;                          /* socket received                   */
+    char ip_address[64];               /* IP address received               */
+};
+
+struct t_test_hook_process
+{
+    int count;                         /* number of calls to callback       */
+    int return_code;                   /* last return code received         */
+    char out[1024];                    /* stdout received                   */
+    char err[1024];                    /* stderr received                   */
+};
+
+TEST_GROUP(Hook)
+{
+};
+
+char test_hook_timer_calls[256];
+int test_hook_timer_remaining;
+struct t_hook *test_hook_timer_to_remove = NULL;
+
+/*
+ * Callback for timer hooks: adds the label (pointer) to the list of calls.
+ *
+ * A label beginning with "-" removes the hook test_hook_timer_to_remove.
+ */
+
+int
+test_hook_timer_cb (const void *pointer, void *data, int remaining_calls)
+{
+    const char *label;
+
+    /* make C++ compiler happy */
+    (void) data;
+
+    label = (const char *)pointer;
+
+    if (test_hook_timer_calls[0])
+    {
+        strncat (test_hook_timer_calls, ",",
+                 sizeof (test_hook_timer_calls) - strlen (test_hook_timer_calls) - 1);
+    }
+    strncat (test_hook_timer_calls, label,
+             sizeof (test_hook_timer_calls) - strlen (test_hook_timer_calls) - 1);
+
+    test_hook_timer_remaining = remaining_calls;
+
+    if ((label[0] == '-') && test_hook_timer_to_remove)
+    {
+        unhook (test_hook_timer_to_remove);
+        test_hook_timer_to_remove = NULL;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   hook_timer
+ *   hook_timer_exec
+ *   hook_timer_get_time_to_next
+ *   hook_timer_heap_add
+ *   hook_timer_heap_remove
+ *   hook_timer_heap_cmp
+ */
+
+TEST(Hook, Timer)
+{
+    struct t_hook *hook_a, *hook_b, *hook_c;
+
+    /* timers with 1 ms interval (a: 2 calls max) and a timer never due */
+    hook_a = hook_timer (NULL, 1, 0, 2, &test_hook_timer_cb, "a", NULL);
+    CHECK(hook_a);
+    hook_b = hook_timer (NULL, 1, 0, 0, &test_hook_timer_cb, "b", NULL);
+    CHECK(hook_b);
+    hook_c = hook_timer (NULL, 3600 * 1000, 0, 0, &test_hook_timer_cb, "c",
+                         NULL);
+    CHECK(hook_c);
+
+    /* timers due are executed once, in order of next execution */
+    usleep (10000);
+    LONGS_EQUAL(1, hook_timer_get_time_to_next ());
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("a,b", test_hook_timer_calls);
+
+    /* last call of timer "a" */
+    usleep (10000);
+    test_hook_timer_calls[0] = '\0';
+    test_hook_timer_remaining = -2;
+    hook_timer_exec ();
+    STRCMP_EQUAL("a,b", test_hook_timer_calls);
+
+    /* timer "a" has been removed after its last call */
+    usleep (10000);
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("b", test_hook_timer_calls);
+    LONGS_EQUAL(-1, test_hook_timer_remaining);
+
+    unhook (hook_b);
+    usleep (10000);
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("", test_hook_timer_calls);
+
+    /* timer removed by the callback of another timer is not executed */
+    hook_a = hook_timer (NULL, 1, 0, 0, &test_hook_timer_cb, "-a", NULL);
+    CHECK(hook_a);
+    hook_b = hook_timer (NULL, 1, 0, 0, &test_hook_timer_cb, "b", NULL);
+    CHECK(hook_b);
+    test_hook_timer_to_remove = hook_b;
+    usleep (10000);
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("-a", test_hook_timer_calls);
+    POINTERS_EQUAL(NULL, test_hook_timer_to_remove);
+    usleep (10000);
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("-a", test_hook_timer_calls);
+
+    unhook (hook_a);
+
+    /* timers with same next execution: highest priority first */
+    hook_a = hook_timer (NULL, 1, 0, 0, &test_hook_timer_cb, "a", NULL);
+    CHECK(hook_a);
+    hook_b = hook_timer (NULL, 1, 0, 0, &test_hook_timer_cb, "b", NULL);
+    CHECK(hook_b);
+    hook_timer_heap_remove (hook_b);
+    hook_b->priority = HOOK_PRIORITY_DEFAULT + 1;
+    HOOK_TIMER(hook_b, next_exec) = HOOK_TIMER(hook_a, next_exec);
+    CHECK(hook_timer_heap_add (hook_b));
+    usleep (10000);
+    test_hook_timer_calls[0] = '\0';
+    hook_timer_exec ();
+    STRCMP_EQUAL("b,a", test_hook_timer_calls);
+
+    unhook (hook_a);
+    unhook (hook_b);
+    unhook (hook_c);
+}
+
+/*
+ * Callback for fd hooks: reads one byte and increments the counter.
+ */
+
+int
+test_hook_fd_cb (const void *pointer, void *data, int fd)
+{
+    char buffer[1];
+    int *count;
+
+    /* make C++ compiler happy */
+    (void) data;
+
+    count = (int *)pointer;
+    if (read (fd, buffer, sizeof (buffer)) == 1)
+        (*count)++;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   hook_fd
+ *   hook_fd_set_backend
+ *   hook_fd_exec
+ *
+ * Each backend (poll and epoll) is tested with some idle file descriptors
+ * and one active pipe.
+ */
+
+TEST(Hook, FdBackends)
+{
+    int backends[2] = { HOOK_FD_BACKEND_POLL, HOOK_FD_BACKEND_EPOLL };
+    int old_backend, i, j, count, idle_pipes[TEST_HOOK_FD_IDLE_PIPES][2];
+    int active_pipe[2];
+    struct t_hook *idle_hooks[TEST_HOOK_FD_IDLE_PIPES][2], *active_hook;
+
+    old_backend = hook_fd_backend;
+
+    for (i = 0; i < 2; i++)
+    {
+        hook_fd_set_backend (backends[i]);
+
+        /* idle file descriptors */
+        for (j = 0; j < TEST_HOOK_FD_IDLE_PIPES; j++)
+        {
+            LONGS_EQUAL(0, pipe (idle_pipes[j]));
+            idle_hooks[j][0] = hook_fd (NULL, idle_pipes[j][0], 1, 0, 0,
+                                        &test_hook_fd_cb, &count, NULL);
+            CHECK(idle_hooks[j][0]);
+            idle_hooks[j][1] = hook_fd (NULL, idle_pipes[j][1], 1, 0, 0,
+                                        &test_hook_fd_cb, &count, NULL);
+            CHECK(idle_hooks[j][1]);
+        }
+
+        /* a fd can be hooked only once */
+        POINTERS_EQUAL(NULL, hook_fd (NULL, idle_pipes[0][0], 1, 0, 0,
+                                      &test_hook_fd_cb, &count, NULL));
+
+        /* active pipe */
+        LONGS_EQUAL(0, pipe (active_pipe));
+        active_hook = hook_fd (NULL, active_pipe[0], 1, 0, 0,
+                               &test_hook_fd_cb, &count, NULL);
+        CHECK(active_hook);
+
+        count = 0;
+        for (j = 0; j < TEST_HOOK_FD_LOOPS; j++)
+        {
+            LONGS_EQUAL(1, write (active_pipe[1], "x", 1));
+            hook_fd_exec ();
+        }
+        LONGS_EQUAL(TEST_HOOK_FD_LOOPS, count);
+
+        unhook (active_hook);
+        close (active_pipe[0]);
+        close (active_pipe[1]);
+        for (j = 0; j < TEST_HOOK_FD_IDLE_PIPES; j++)
+        {
+            unhook (idle_hooks[j][0]);
+            unhook (idle_hooks[j][1]);
+            close (idle_pipes[j][0]);
+            close (idle_pipes[j][1]);
+        }
+    }
+
+    hook_fd_set_backend (old_backend);
+}
+
+/*
+ * Tests functions:
+ *   hook_fd (on a regular file, which can not be watched with epoll)
+ *   hook_fd_exec
+ */
+
+TEST(Hook, FdRegularFile)
+{
+    int backends[2] = { HOOK_FD_BACKEND_POLL, HOOK_FD_BACKEND_EPOLL };
+    int old_backend, i, j, count, fd;
+    char filename[] = "/tmp/weechat_test_hook_fd_XXXXXX";
+    struct t_hook *hook;
+
+    old_backend = hook_fd_backend;
+
+    fd = mkstemp (filename);
+    CHECK(fd >= 0);
+    unlink (filename);
+
+    for (i = 0; i < 2; i++)
+    {
+        hook_fd_set_backend (backends[i]);
+
+        LONGS_EQUAL(TEST_HOOK_FD_LOOPS, write (fd, "xxxxxxxxxx", 10));
+        LONGS_EQUAL(0, lseek (fd, 0, SEEK_SET));
+
+        hook = hook_fd (NULL, fd, 1, 0, 0, &test_hook_fd_cb, &count, NULL);
+        CHECK(hook);
+        LONGS_EQUAL(0, HOOK_FD(hook, error));
+
+        /* a regular file is always ready for read */
+        count = 0;
+        for (j = 0; j < TEST_HOOK_FD_LOOPS; j++)
+        {
+            hook_fd_exec ();
+        }
+        LONGS_EQUAL(TEST_HOOK_FD_LOOPS, count);
+
+        unhook (hook);
+        LONGS_EQUAL(0, ftruncate (fd, 0));
+        LONGS_EQUAL(0, lseek (fd, 0, SEEK_SET));
+    }
+
+    close (fd);
+
+    hook_fd_set_backend (old_backend);
+}
+
+/*
+ * Callback for fd hooks watching exceptions: reads out-of-band data (if any)
+ * and increments the counter.
+ */
+
+int
+test_hook_fd_exception_cb (const void *pointer, void *data, int fd)
+{
+    char buffer[1];
+
+    /* make C++ compiler happy */
+    (void) data;
+
+    (void) recv (fd, buffer, sizeof (buffer), MSG_OOB | MSG_DONTWAIT);
+    (*((int *)pointer))++;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   hook_fd (flag exception)
+ *   hook_fd_set_flags
+ *   hook_fd_exec
+ *
+ * A TCP connection on loopback is used, because out-of-band data (which
+ * triggers the exception flag) is not supported on pipes.
+ */
+
+TEST(Hook, FdFlags)
+{
+    int backends[2] = { HOOK_FD_BACKEND_POLL, HOOK_FD_BACKEND_EPOLL };
+    int old_backend, i, count, sock_listen, sock_client, sock_server;
+    struct sockaddr_in addr;
+    socklen_t length;
+    struct t_hook *hook;
+
+    old_backend = hook_fd_backend;
+
+    for (i = 0; i < 2; i++)
+    {
+        hook_fd_set_backend (backends[i]);
+
+        sock_listen = socket (AF_INET, SOCK_STREAM, 0);
+        CHECK(sock_listen >= 0);
+        memset (&addr, 0, sizeof (addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        LONGS_EQUAL(0, bind (sock_listen, (struct sockaddr *)&addr,
+                             sizeof (addr)));
+        LONGS_EQUAL(0, listen (sock_listen, 1));
+        length = sizeof (addr);
+        LONGS_EQUAL(0, getsockname (sock_listen, (struct sockaddr *)&addr,
+                                    &length));
+        sock_client = socket (AF_INET, SOCK_STREAM, 0);
+        CHECK(sock_client >= 0);
+        LONGS_EQUAL(0, connect (sock_client, (struct sockaddr *)&addr,
+                                sizeof (addr)));
+        sock_server = accept (sock_listen, NULL, NULL);
+        CHECK(sock_server >= 0);
+
+        /* hook watching only exceptions is called on out-of-band data */
+        count = 0;
+        hook = hook_fd (NULL, sock_server, 0, 0, 1,
+                        &test_hook_fd_exception_cb, &count, NULL);
+        CHECK(hook);
+        LONGS_EQUAL(HOOK_FD_FLAG_EXCEPTION, HOOK_FD(hook, flags));
+        LONGS_EQUAL(1, send (sock_client, "x", 1, MSG_OOB));
+        hook_fd_exec ();
+        LONGS_EQUAL(1, count);
+
+        /* change of flags: the socket is writable */
+        hook_fd_set_flags (hook, HOOK_FD_FLAG_WRITE);
+        LONGS_EQUAL(HOOK_FD_FLAG_WRITE, HOOK_FD(hook, flags));
+        hook_fd_exec ();
+        LONGS_EQUAL(2, count);
+
+        unhook (hook);
+        close (sock_server);
+        close (sock_client);
+        close (sock_listen);
+    }
+
+    hook_fd_set_backend (old_backend);
+}
+
+/*
+ * Callback for signal hooks: increments the counter.
+ */
+
+int
+test_hook_signal_cb (const void *pointer, void *data,
+                     const char *signal, const char *type_data,
+                     void *signal_data)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    (*((int *)pointer))++;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   hook_profile_set
+ *   hook_profile_reset
+ *   hook_profile_get_owners
+ *   hook_callback_start
+ *   hook_callback_end
+ */
+
+TEST(Hook, Profile)
+{
+    struct t_hook *hook;
+    struct t_hashtable *owners;
+    struct t_hook_stats *ptr_stats;
+    unsigned long long calls_before;
+    int count;
+
+    count = 0;
+    hook = hook_signal (NULL, "test_hook_profile",
+                        &test_hook_signal_cb, &count, NULL);
+    CHECK(hook);
+
+    /* profiling disabled: no statistics */
+    hook_profile_set (0);
+    hook_signal_send ("test_hook_profile", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    LONGS_EQUAL(1, count);
+    CHECK(hook->stats.calls == 0);
+
+    /* profiling enabled: calls are counted */
+    hook_profile_set (1);
+    hook_signal_send ("test_hook_profile", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    hook_signal_send ("test_hook_profile", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    hook_signal_send ("test_hook_profile", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    LONGS_EQUAL(4, count);
+    CHECK(hook->stats.calls == 3);
+    CHECK(hook->stats.time_total >= hook->stats.time_max);
+
+    /* statistics of removed hook are kept in statistics of owner */
+    owners = hook_profile_get_owners ();
+    CHECK(owners);
+    ptr_stats = (struct t_hook_stats *)hashtable_get (owners, "core");
+    CHECK(ptr_stats);
+    calls_before = ptr_stats->calls;
+    CHECK(calls_before >= 3);
+    hashtable_free (owners);
+
+    unhook (hook);
+
+    owners = hook_profile_get_owners ();
+    CHECK(owners);
+    ptr_stats = (struct t_hook_stats *)hashtable_get (owners, "core");
+    CHECK(ptr_stats);
+    CHECK(ptr_stats->calls >= calls_before);
+    hashtable_free (owners);
+
+    /* reset statistics */
+    hook_profile_reset ();
+    owners = hook_profile_get_owners ();
+    CHECK(owners);
+    POINTERS_EQUAL(NULL, hashtable_get (owners, "core"));
+    hashtable_free (owners);
+
+    hook_profile_set (0);
+}
+
+char test_hook_signal_calls[256];
+struct t_hook *test_hook_signal_new_hook = NULL;
+
+/*
+ * Callback for signal hooks: adds the label (pointer) to the list of calls.
+ *
+ * A label beginning with "!" eats the signal, a label beginning with "+"
+ * hooks the same signal again (with label "new").
+ */
+
+int
+test_hook_signal_order_cb (const void *pointer, void *data,
+                           const char *signal, const char *type_data,
+                           void *signal_data)
+{
+    const char *label;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) type_data;
+    (void) signal_data;
+
+    label = (const char *)pointer;
+
+    if (test_hook_signal_calls[0])
+    {
+        strncat (test_hook_signal_calls, ",",
+                 sizeof (test_hook_signal_calls) - strlen (test_hook_signal_calls) - 1);
+    }
+    strncat (test_hook_signal_calls, label,
+             sizeof (test_hook_signal_calls) - strlen (test_hook_signal_calls) - 1);
+
+    if (label[0] == '+')
+    {
+        test_hook_signal_new_hook = hook_signal (NULL, signal,
+                                                 &test_hook_signal_order_cb,
+                                                 "new", NULL);
+    }
+
+    return (label[0] == '!') ? WEECHAT_RC_OK_EAT : WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for hsignal hooks: same as test_hook_signal_order_cb.
+ */
+
+int
+test_hook_hsignal_order_cb (const void *pointer, void *data,
+                            const char *signal, struct t_hashtable *hashtable)
+{
+    /* make C++ compiler happy */
+    (void) hashtable;
+
+    return test_hook_signal_order_cb (pointer, data, signal, NULL, NULL);
+}
+
+/*
+ * Tests functions:
+ *   hook_signal
+ *   hook_signal_send
+ *   hook_index_add
+ *   hook_index_remove
+ *   hook_index_get
+ */
+
+TEST(Hook, Signal)
+{
+    struct t_hook *hooks[6];
+    int i;
+
+    /* hooks with exact name and masks, sorted by priority then creation */
+    hooks[0] = hook_signal (NULL, "test_hook_sig_*",
+                            &test_hook_signal_order_cb, "mask1", NULL);
+    hooks[1] = hook_signal (NULL, "test_hook_sig_a",
+                            &test_hook_signal_order_cb, "exact1", NULL);
+    hooks[2] = hook_signal (NULL, "2000|test_hook_sig_a",
+                            &test_hook_signal_order_cb, "exact2000", NULL);
+    hooks[3] = hook_signal (NULL, "500|*_sig_a",
+                            &test_hook_signal_order_cb, "mask500", NULL);
+    hooks[4] = hook_signal (NULL, "TEST_HOOK_SIG_A",
+                            &test_hook_signal_order_cb, "exact2", NULL);
+    hooks[5] = hook_signal (NULL, "test_hook_sig_b",
+                            &test_hook_signal_order_cb, "other", NULL);
+    for (i = 0; i < 6; i++)
+    {
+        CHECK(hooks[i]);
+    }
+
+    test_hook_signal_calls[0] = '\0';
+    LONGS_EQUAL(WEECHAT_RC_OK,
+                hook_signal_send ("test_hook_sig_a",
+                                  WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    STRCMP_EQUAL("exact2000,mask1,exact1,exact2,mask500",
+                 test_hook_signal_calls);
+
+    /* names are case insensitive */
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("Test_Hook_Sig_A", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("exact2000,mask1,exact1,exact2,mask500",
+                 test_hook_signal_calls);
+
+    /* only masks match */
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_hook_sig_c", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("mask1", test_hook_signal_calls);
+
+    /* no hook */
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_hook_unknown", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("", test_hook_signal_calls);
+
+    /* removed hooks are not called any more */
+    unhook (hooks[1]);
+    unhook (hooks[3]);
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_hook_sig_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("exact2000,mask1,exact2", test_hook_signal_calls);
+
+    /* a hook eating the signal stops the other hooks */
+    hooks[1] = hook_signal (NULL, "1500|test_hook_sig_a",
+                            &test_hook_signal_order_cb, "!eat", NULL);
+    CHECK(hooks[1]);
+    test_hook_signal_calls[0] = '\0';
+    LONGS_EQUAL(WEECHAT_RC_OK_EAT,
+                hook_signal_send ("test_hook_sig_a",
+                                  WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    STRCMP_EQUAL("exact2000,!eat", test_hook_signal_calls);
+    unhook (hooks[1]);
+
+    /* a hook added by a callback is not called for the signal being sent */
+    hooks[1] = hook_signal (NULL, "3000|test_hook_sig_a",
+                            &test_hook_signal_order_cb, "+add", NULL);
+    CHECK(hooks[1]);
+    test_hook_signal_new_hook = NULL;
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_hook_sig_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("+add,exact2000,mask1,exact2", test_hook_signal_calls);
+    CHECK(test_hook_signal_new_hook);
+    unhook (hooks[1]);
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_hook_sig_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("exact2000,mask1,exact2,new", test_hook_signal_calls);
+    unhook (test_hook_signal_new_hook);
+    test_hook_signal_new_hook = NULL;
+
+    unhook (hooks[0]);
+    unhook (hooks[2]);
+    unhook (hooks[4]);
+    unhook (hooks[5]);
+
+    test_hook_signal_calls[0] = '\0';
+    hook_signal_send ("test_hook_sig_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("", test_hook_signal_calls);
+}
+
+/*
+ * Tests functions:
+ *   hook_hsignal
+ *   hook_hsignal_send
+ *   hook_index_get
+ */
+
+TEST(Hook, Hsignal)
+{
+    struct t_hook *hooks[4];
+    struct t_hashtable *hashtable;
+    int i;
+
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL, NULL);
+    CHECK(hashtable);
+
+    hooks[0] = hook_hsignal (NULL, "test_hook_hsig_*",
+                             &test_hook_hsignal_order_cb, "mask", NULL);
+    hooks[1] = hook_hsignal (NULL, "test_hook_hsig_a",
+                             &test_hook_hsignal_order_cb, "exact", NULL);
+    hooks[2] = hook_hsignal (NULL, "2000|test_hook_hsig_a",
+                             &test_hook_hsignal_order_cb, "!eat", NULL);
+    hooks[3] = hook_signal (NULL, "test_hook_hsig_a",
+                            &test_hook_signal_order_cb, "signal", NULL);
+    for (i = 0; i < 4; i++)
+    {
+        CHECK(hooks[i]);
+    }
+
+    /* signal eaten by first hook */
+    test_hook_signal_calls[0] = '\0';
+    LONGS_EQUAL(WEECHAT_RC_OK_EAT,
+                hook_hsignal_send ("test_hook_hsig_a", hashtable));
+    STRCMP_EQUAL("!eat", test_hook_signal_calls);
+    unhook (hooks[2]);
+
+    /* signal hooks are not called for a hsignal */
+    test_hook_signal_calls[0] = '\0';
+    LONGS_EQUAL(WEECHAT_RC_OK,
+                hook_hsignal_send ("TEST_HOOK_HSIG_A", hashtable));
+    STRCMP_EQUAL("mask,exact", test_hook_signal_calls);
+
+    /* only mask matches */
+    test_hook_signal_calls[0] = '\0';
+    hook_hsignal_send ("test_hook_hsig_b", hashtable);
+    STRCMP_EQUAL("mask", test_hook_signal_calls);
+
+    unhook (hooks[0]);
+    unhook (hooks[1]);
+    unhook (hooks[3]);
+
+    hashtable_free (hashtable);
+}
+
+struct t_test_hook_print
+{
+    int count;                         /* number of calls                   */
+    char message[256];                 /* last message received             */
+};
+
+/*
+ * Callback for print hooks: increments the counter and saves the message.
+ */
+
+int
+test_hook_print_cb (const void *pointer, void *data,
+                    struct t_gui_buffer *buffer,
+                    time_t date, int tags_count, const char **tags,
+                    int displayed, int highlight,
+                    const char *prefix, const char *message)
+{
+    struct t_test_hook_print *ptr_data;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) buffer;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+    (void) prefix;
+
+    ptr_data = (struct t_test_hook_print *)pointer;
+    ptr_data->count++;
+    snprintf (ptr_data->message, sizeof (ptr_data->message), "%s", message);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   hook_print
+ *   hook_print_exec
+ */
+
+TEST(Hook, Print)
+{
+    struct t_gui_buffer *buffer, *buffer2;
+    struct t_hook *hooks[7];
+    struct t_test_hook_print data[7];
+    int i;
+
+    buffer = gui_buffer_new (NULL, "test_hook_print",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    buffer2 = gui_buffer_new (NULL, "test_hook_print2",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer2);
+
+    memset (data, 0, sizeof (data));
+
+    /* hook on buffer */
+    hooks[0] = hook_print (NULL, buffer, NULL, NULL, 1,
+                           &test_hook_print_cb, &data[0], NULL);
+    /* hook on a tag (all buffers) */
+    hooks[1] = hook_print (NULL, NULL, "tag_a", NULL, 1,
+                           &test_hook_print_cb, &data[1], NULL);
+    /* hook on two sets of tags (all buffers) */
+    hooks[2] = hook_print (NULL, NULL, "tag_b+tag_c,TAG_D", NULL, 1,
+                           &test_hook_print_cb, &data[2], NULL);
+    /* hook on a negated tag and a tag with wildcard (all buffers) */
+    hooks[3] = hook_print (NULL, NULL, "!tag_a,tag_e*", NULL, 1,
+                           &test_hook_print_cb, &data[3], NULL);
+    /* hook on a message (all buffers) */
+    hooks[4] = hook_print (NULL, NULL, NULL, "hello", 1,
+                           &test_hook_print_cb, &data[4], NULL);
+    /* hook on a buffer + tag */
+    hooks[5] = hook_print (NULL, buffer2, "tag_a", NULL, 0,
+                           &test_hook_print_cb, &data[5], NULL);
+    /* hook on all messages */
+    hooks[6] = hook_print (NULL, NULL, NULL, NULL, 0,
+                           &test_hook_print_cb, &data[6], NULL);
+    for (i = 0; i < 7; i++)
+    {
+        CHECK(hooks[i]);
+    }
+
+    gui_chat_printf_date_tags (buffer, 0, "tag_a,tag_x", "test 1");
+    gui_chat_printf_date_tags (buffer2, 0, "tag_b,tag_c", "test 2");
+    gui_chat_printf_date_tags (buffer2, 0, "tag_b,tag_d,tag_a", "test 3");
+    gui_chat_printf_date_tags (buffer2, 0, "tag_e1", "%shello",
+                               gui_color_get_custom ("red"));
+    gui_chat_printf_date_tags (buffer2, 0, NULL, "test 5");
+
+    LONGS_EQUAL(1, data[0].count);
+    LONGS_EQUAL(2, data[1].count);
+    LONGS_EQUAL(2, data[2].count);
+    LONGS_EQUAL(2, data[3].count);
+    LONGS_EQUAL(1, data[4].count);
+    LONGS_EQUAL(1, data[5].count);
+    LONGS_EQUAL(5, data[6].count);
+
+    /* colors are removed from message only if asked by the hook */
+    gui_chat_printf_date_tags (buffer2, 0, "tag_a", "%stest 6",
+                               gui_color_get_custom ("red"));
+    LONGS_EQUAL(3, data[1].count);
+    STRCMP_EQUAL("test 6", data[1].message);
+    CHECK(strcmp ("test 6", data[6].message) != 0);
+
+    /* removed hooks are not called any more */
+    for (i = 0; i < 7; i++)
+    {
+        unhook (hooks[i]);
+    }
+    gui_chat_printf_date_tags (buffer, 0, "tag_a", "test 7");
+    LONGS_EQUAL(3, data[1].count);
+    LONGS_EQUAL(6, data[6].count);
+
+    gui_buffer_close (buffer);
+    gui_buffer_close (buffer2);
+}
+
+/*
+ * Callback for modifier hooks: appends the string given in pointer (NULL to
+ * return no change, empty string to drop the message).
+ */
+
+char *
+test_hook_modifier_cb (const void *pointer, void *data,
+                       const char *modifier, const char *modifier_data,
+                       const char *string)
+{
+    const char *suffix;
+    char *result;
+    int length;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) modifier;
+    (void) modifier_data;
+
+    suffix = (const char *)pointer;
+    if (!suffix)
+        return NULL;
+    if (!suffix[0])
+        return strdup ("");
+
+    length = strlen (string) + strlen (suffix) + 1;
+    result = (char *)malloc (length);
+    if (result)
+        snprintf (result, length, "%s%s", string, suffix);
+
+    return result;
+}
+
+/*
+ * Tests functions:
+ *   hook_modifier
+ *   hook_modifier_exists
+ *   hook_modifier_exec
+ */
+
+TEST(Hook, Modifier)
+{
+    struct t_hook *hooks[4];
+    char *result;
+
+    /* no hook */
+    LONGS_EQUAL(0, hook_modifier_exists ("test_modifier"));
+    POINTERS_EQUAL(NULL, hook_modifier_exec (NULL, NULL, NULL, "abc"));
+    POINTERS_EQUAL(NULL, hook_modifier_exec (NULL, "", NULL, "abc"));
+    result = hook_modifier_exec (NULL, "test_modifier", NULL, "abc");
+    STRCMP_EQUAL("abc", result);
+    free (result);
+
+    /* chain of hooks (sorted by priority), name is case insensitive */
+    hooks[0] = hook_modifier (NULL, "test_modifier",
+                              &test_hook_modifier_cb, "_1", NULL);
+    hooks[1] = hook_modifier (NULL, "2000|TEST_MODIFIER",
+                              &test_hook_modifier_cb, NULL, NULL);
+    hooks[2] = hook_modifier (NULL, "3000|test_modifier",
+                              &test_hook_modifier_cb, "_3", NULL);
+    /* no wildcard in modifier names */
+    hooks[3] = hook_modifier (NULL, "test_*",
+                              &test_hook_modifier_cb, "_4", NULL);
+    LONGS_EQUAL(1, hook_modifier_exists ("test_modifier"));
+    LONGS_EQUAL(1, hook_modifier_exists ("Test_Modifier"));
+    LONGS_EQUAL(0, hook_modifier_exists ("test_modifier2"));
+    result = hook_modifier_exec (NULL, "test_modifier", NULL, "abc");
+    STRCMP_EQUAL("abc_3_1", result);
+    free (result);
+
+    /* message dropped */
+    unhook (hooks[1]);
+    hooks[1] = hook_modifier (NULL, "2000|test_modifier",
+                              &test_hook_modifier_cb, "", NULL);
+    result = hook_modifier_exec (NULL, "test_modifier", NULL, "abc");
+    STRCMP_EQUAL("", result);
+    free (result);
+
+    unhook (hooks[0]);
+    unhook (hooks[1]);
+    unhook (hooks[2]);
+    unhook (hooks[3]);
+    LONGS_EQUAL(0, hook_modifier_exists ("test_modifier"));
+}
+
+/*
+ * Callback for connect hooks: saves the status, socket and IP address.
+ */
+
+int
+test_hook_connect_cb (const void *pointer, void *data, int status,
+                      int gnutls_rc, int sock, const char *error,
+                      const char *ip_address)
+{
+    struct t_test_hook_connect *result;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) gnutls_rc;
+    (void) error;
+
+    result = (struct t_test_hook_connect *)pointer;
+    result->count++;
+    result->status = status;
+    result->sock = sock;
+    snprintf (result->ip_address, sizeof (result->ip_address), "%s",
+              (ip_address) ? ip_address : "");
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Runs fd hooks until the connect callback is called (or timeout).
+ */
+
+void
+test_hook_connect_wait (struct t_test_hook_connect *result)
+{
+    time_t start;
+
+    start = time (NULL);
+    while ((result->count == 0)
+           && (time (NULL) - start < TEST_HOOK_CONNECT_TIMEOUT))
+    {
+        hook_fd_exec ();
+    }
+}
+
+/*
+ * Tests functions:
+ *   hook_connect
+ *   network_connect_start
+ *   network_connect_request_cancel
+ */
+
+TEST(Hook, Connect)
+{
+    struct t_test_hook_connect result;
+    struct sockaddr_in addr;
+    socklen_t length;
+    struct t_hook *ptr_hook;
+    int sock_listen, sock_accept, port;
+
+    /* listening socket on localhost (random port) */
+    sock_listen = socket (AF_INET, SOCK_STREAM, 0);
+    CHECK(sock_listen >= 0);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    LONGS_EQUAL(0, bind (sock_listen, (struct sockaddr *)&addr, sizeof (addr)));
+    LONGS_EQUAL(0, listen (sock_listen, 5));
+    length = sizeof (addr);
+    LONGS_EQUAL(0, getsockname (sock_listen, (struct sockaddr *)&addr, &length));
+    port = ntohs (addr.sin_port);
+
+    /* connection OK */
+    memset (&result, 0, sizeof (result));
+    ptr_hook = hook_connect (NULL, NULL, "127.0.0.1", port, 0, 0,
+                             NULL, NULL, 0, NULL, NULL,
+                             &test_hook_connect_cb, &result, NULL);
+    CHECK(ptr_hook);
+    test_hook_connect_wait (&result);
+    LONGS_EQUAL(1, result.count);
+    LONGS_EQUAL(WEECHAT_HOOK_CONNECT_OK, result.status);
+    CHECK(result.sock >= 0);
+    STRCMP_EQUAL("127.0.0.1", result.ip_address);
+    sock_accept = accept (sock_listen, NULL, NULL);
+    CHECK(sock_accept >= 0);
+    close (sock_accept);
+    close (result.sock);
+
+    /* connection refused (nothing is listening on the port) */
+    close (sock_listen);
+    memset (&result, 0, sizeof (result));
+    ptr_hook = hook_connect (NULL, NULL, "127.0.0.1", port, 0, 0,
+                             NULL, NULL, 0, NULL, NULL,
+                             &test_hook_connect_cb, &result, NULL);
+    CHECK(ptr_hook);
+    test_hook_connect_wait (&result);
+    LONGS_EQUAL(1, result.count);
+    LONGS_EQUAL(WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED, result.status);
+    LONGS_EQUAL(-1, result.sock);
+
+    /* proxy not found */
+    memset (&result, 0, sizeof (result));
+    ptr_hook = hook_connect (NULL, "test_no_such_proxy", "127.0.0.1", port,
+                             0, 0, NULL, NULL, 0, NULL, NULL,
+                             &test_hook_connect_cb, &result, NULL);
+    LONGS_EQUAL(1, result.count);
+    LONGS_EQUAL(WEECHAT_HOOK_CONNECT_PROXY_ERROR, result.status);
+
+    /* hook removed while address is resolved: callback is never called */
+    memset (&result, 0, sizeof (result));
+    ptr_hook = hook_connect (NULL, NULL, "localhost", port, 0, 0,
+                             NULL, NULL, 0, NULL, NULL,
+                             &test_hook_connect_cb, &result, NULL);
+    CHECK(ptr_hook);
+    unhook (ptr_hook);
+    hook_fd_exec ();
+    LONGS_EQUAL(0, result.count);
+}
+
+/*
+ * Returns a listening socket on localhost (random port), and the port in
+ * "port".
+ */
+
+int
+test_hook_connect_listen (int *port)
+{
+    struct sockaddr_in addr;
+    socklen_t length;
+    int sock;
+
+    sock = socket (AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+        return -1;
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    length = sizeof (addr);
+    if ((bind (sock, (struct sockaddr *)&addr, sizeof (addr)) != 0)
+        || (listen (sock, 16) != 0)
+        || (getsockname (sock, (struct sockaddr *)&addr, &length) != 0))
+    {
+        close (sock);
+        return -1;
+    }
+    *port = ntohs (addr.sin_port);
+    return sock;
+}
+
+/*
+ * Tests functions:
+ *   hook_connect (with a proxy which never answers)
+ *   network_connect_request_cancel
+ *
+ * All connection threads are blocked in the dialog with the proxy; when the
+ * hooks are removed, the threads must be released (otherwise no connection
+ * is possible any more).
+ */
+
+TEST(Hook, ConnectProxyCancel)
+{
+    struct t_test_hook_connect result, results[NETWORK_CONNECT_THREADS + 1];
+    struct t_hook *hooks[NETWORK_CONNECT_THREADS + 1];
+    struct t_proxy *proxy;
+    char str_port[16];
+    int i, sock_proxy, port_proxy, sock_listen, sock_accept, port, count;
+    time_t start;
+
+    /* proxy which accepts connections (backlog) and never answers */
+    sock_proxy = test_hook_connect_listen (&port_proxy);
+    CHECK(sock_proxy >= 0);
+    snprintf (str_port, sizeof (str_port), "%d", port_proxy);
+    proxy = proxy_new ("test_stuck_proxy", "http", "off", "127.0.0.1",
+                       str_port, "", "");
+    CHECK(proxy);
+
+    sock_listen = test_hook_connect_listen (&port);
+    CHECK(sock_listen >= 0);
+
+    /* more connections than threads: all threads are waiting for proxy */
+    memset (results, 0, sizeof (results));
+    for (i = 0; i < NETWORK_CONNECT_THREADS + 1; i++)
+    {
+        hooks[i] = hook_connect (NULL, "test_stuck_proxy", "127.0.0.1", port,
+                                 0, 0, NULL, NULL, 0, NULL, NULL,
+                                 &test_hook_connect_cb, &results[i], NULL);
+        CHECK(hooks[i]);
+    }
+    start = time (NULL);
+    while (time (NULL) - start < TEST_HOOK_CONNECT_TIMEOUT)
+    {
+        count = 0;
+        for (i = 0; i < NETWORK_CONNECT_THREADS + 1; i++)
+        {
+            if (HOOK_CONNECT(hooks[i], request)
+                && (HOOK_CONNECT(hooks[i], request)->step
+                    == NETWORK_CONNECT_STEP_PROXY))
+            {
+                count++;
+            }
+        }
+        if (count == NETWORK_CONNECT_THREADS + 1)
+            break;
+        hook_fd_exec ();
+    }
+    LONGS_EQUAL(NETWORK_CONNECT_THREADS + 1, count);
+    usleep (200 * 1000);
+
+    /* remove hooks: threads must stop the dialog with proxy */
+    for (i = 0; i < NETWORK_CONNECT_THREADS + 1; i++)
+    {
+        unhook (hooks[i]);
+        LONGS_EQUAL(0, results[i].count);
+    }
+
+    /* a new connection is possible */
+    memset (&result, 0, sizeof (result));
+    CHECK(hook_connect (NULL, NULL, "127.0.0.1", port, 0, 0,
+                        NULL, NULL, 0, NULL, NULL,
+                        &test_hook_connect_cb, &result, NULL));
+    test_hook_connect_wait (&result);
+    LONGS_EQUAL(1, result.count);
+    LONGS_EQUAL(WEECHAT_HOOK_CONNECT_OK, result.status);
+    sock_accept = accept (sock_listen, NULL, NULL);
+    CHECK(sock_accept >= 0);
+    close (sock_accept);
+    close (result.sock);
+
+    close (sock_listen);
+    close (sock_proxy);
+    proxy_free (proxy);
+}
+
+/*
+ * Callback for process hooks: saves the return code and output.
+ */
+
+int
+test_hook_process_cb (const void *pointer, void *data, const char *command,
+                      int return_code, const char *out, const char *err)
+{
+    struct t_test_hook_process *result;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) command;
+
+    result = (struct t_test_hook_process *)pointer;
+    result->count++;
+    result->return_code = return_code;
+    if (out)
+    {
+        strncat (result->out, out,
+                 sizeof (result->out) - strlen (result->out) - 1);
+    }
+    if (err)
+    {
+        strncat (result->err, err,
+                 sizeof (result->err) - strlen (result->err) - 1);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Runs fd and timer hooks until the process has ended (or timeout).
+ */
+
+void
+test_hook_process_wait (struct t_test_hook_process *result)
+{
+    time_t start;
+
+    start = time (NULL);
+    while ((result->return_code == WEECHAT_HOOK_PROCESS_RUNNING)
+           && (time (NULL) - start < TEST_HOOK_PROCESS_TIMEOUT))
+    {
+        hook_fd_exec ();
+        hook_timer_exec ();
+        usleep (1000);
+    }
+}
+
+/*
+ * Tests functions:
+ *   hook_process
+ *   hook_process_hashtable
+ *   hook_process_spawn
+ *   hook_process_run_url
+ */
+
+TEST(Hook, Process)
+{
+    struct t_test_hook_process result;
+    struct t_hashtable *options;
+    struct t_hook *ptr_hook;
+
+    /* command spawned, arguments split like the shell does */
+    memset (&result, 0, sizeof (result));
+    result.return_code = WEECHAT_HOOK_PROCESS_RUNNING;
+    ptr_hook = hook_process (NULL, "echo 'hello  world'", 0,
+                             &test_hook_process_cb, &result, NULL);
+    CHECK(ptr_hook);
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(0, result.return_code);
+    STRCMP_EQUAL("hello  world\n", result.out);
+    STRCMP_EQUAL("", result.err);
+
+    /* command spawned, arguments in options, exit code */
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+    hashtable_set (options, "arg1", "-c");
+    hashtable_set (options, "arg2", "echo error >&2; exit 3");
+    memset (&result, 0, sizeof (result));
+    result.return_code = WEECHAT_HOOK_PROCESS_RUNNING;
+    ptr_hook = hook_process_hashtable (NULL, "sh", options, 0,
+                                       &test_hook_process_cb, &result, NULL);
+    CHECK(ptr_hook);
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(3, result.return_code);
+    STRCMP_EQUAL("", result.out);
+    STRCMP_EQUAL("error\n", result.err);
+    hashtable_free (options);
+
+    /* command not found */
+    memset (&result, 0, sizeof (result));
+    result.return_code = WEECHAT_HOOK_PROCESS_RUNNING;
+    ptr_hook = hook_process (NULL, "/test/no/such/command", 0,
+                             &test_hook_process_cb, &result, NULL);
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(1, result.count);
+    LONGS_EQUAL(EXIT_FAILURE, result.return_code);
+    STRCMP_EQUAL("Error with command '/test/no/such/command'\n", result.err);
+
+    /* URL transfer in a thread: invalid URL */
+    memset (&result, 0, sizeof (result));
+    result.return_code = WEECHAT_HOOK_PROCESS_RUNNING;
+    ptr_hook = hook_process (NULL, "url:test://invalid", 0,
+                             &test_hook_process_cb, &result, NULL);
+    CHECK(ptr_hook);
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(1, result.count);
+    LONGS_EQUAL(2, result.return_code);
+    CHECK(strstr (result.err, "curl error"));
+
+    /* URL transfer in a thread: local file */
+    memset (&result, 0, sizeof (result));
+    result.return_code = WEECHAT_HOOK_PROCESS_RUNNING;
+    ptr_hook = hook_process (NULL, "url:file:///dev/null", 0,
+                             &test_hook_process_cb, &result, NULL);
+    CHECK(ptr_hook);
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(0, result.return_code);
+    STRCMP_EQUAL("", result.out);
+
+    /* hook removed while running: callback is never called */
+    memset (&result, 0, sizeof (result));
+    result.return_code = WEECHAT_HOOK_PROCESS_RUNNING;
+    ptr_hook = hook_process (NULL, "sleep 10", 0,
+                             &test_hook_process_cb, &result, NULL);
+    CHECK(ptr_hook);
+    unhook (ptr_hook);
+    LONGS_EQUAL(0, result.count);
+}
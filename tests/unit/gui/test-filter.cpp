@@ -0,0 +1,285 @@
+/*
+ * test-filter.cpp - test filter functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-filter.h"
+#include "src/gui/gui-line.h"
+}
+
+#define FILTER_TEST_MATCH(__line, __id)                                 \
+    (((__line)->data->filters_match)                                    \
+     && ((__id) / 8 < (__line)->data->filters_match_size)               \
+     && ((__line)->data->filters_match[(__id) / 8] & (1 << ((__id) % 8))))
+
+TEST_GROUP(GuiFilter)
+{
+};
+
+/*
+ * Tests cache of filters matching lines.
+ *
+ * Tests functions:
+ *   gui_filter_new_id
+ *   gui_filter_line_set_match
+ *   gui_filter_match_line
+ *   gui_filter_check_line
+ *   gui_filter_check_line_cached
+ *   gui_filter_buffer
+ *   gui_filter_all_buffers
+ */
+
+TEST(GuiFilter, Cache)
+{
+    struct t_gui_buffer *buffer1, *buffer2;
+    struct t_gui_filter *filter1, *filter2, *filter3;
+    struct t_gui_line *ptr_line1, *ptr_line2;
+
+    buffer1 = gui_buffer_new (NULL, "test_filter_1",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer1);
+    buffer2 = gui_buffer_new (NULL, "test_filter_2",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer2);
+
+    gui_chat_printf_date_tags (buffer1, 0, "irc_join", "join");
+    gui_chat_printf_date_tags (buffer1, 0, "irc_privmsg", "hello");
+    gui_chat_printf_date_tags (buffer2, 0, "irc_join", "join");
+    ptr_line1 = buffer1->own_lines->first_line;
+    ptr_line2 = buffer2->own_lines->first_line;
+    POINTERS_EQUAL(NULL, ptr_line1->data->filters_match);
+
+    /* new filter: lines of matching buffers are checked */
+    filter1 = gui_filter_new (1, "test_filter_1", "core.test_filter_1",
+                              "irc_join", "*");
+    CHECK(filter1);
+    LONGS_EQUAL(0, filter1->id);
+    LONGS_EQUAL(0, filter1->lines_checked);
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(1, filter1->lines_checked);
+    CHECK(FILTER_TEST_MATCH(ptr_line1, filter1->id));
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+    CHECK(!FILTER_TEST_MATCH(ptr_line1->next_line, filter1->id));
+    LONGS_EQUAL(1, ptr_line1->next_line->data->displayed);
+    CHECK(!FILTER_TEST_MATCH(ptr_line2, filter1->id));
+    LONGS_EQUAL(1, ptr_line2->data->displayed);
+    LONGS_EQUAL(1, buffer1->own_lines->lines_hidden);
+
+    /* second filter, on all buffers, with a regex */
+    filter2 = gui_filter_new (1, "test_filter_2", "*", "*", "hel+o");
+    CHECK(filter2);
+    LONGS_EQUAL(1, filter2->id);
+    gui_filter_all_buffers ();
+    CHECK(FILTER_TEST_MATCH(ptr_line1->next_line, filter2->id));
+    LONGS_EQUAL(0, ptr_line1->next_line->data->displayed);
+    LONGS_EQUAL(2, buffer1->own_lines->lines_hidden);
+
+    /* disable filter: the match is kept in line */
+    filter1->enabled = 0;
+    gui_filter_all_buffers ();
+    CHECK(FILTER_TEST_MATCH(ptr_line1, filter1->id));
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    LONGS_EQUAL(1, buffer1->own_lines->lines_hidden);
+    filter1->enabled = 1;
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+
+    /* filters disabled globally or in buffer */
+    gui_filter_global_disable ();
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    gui_filter_global_enable ();
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+    gui_buffer_set (buffer1, "filter", "0");
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    gui_buffer_set (buffer1, "filter", "1");
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+
+    /* new line is checked with all filters */
+    gui_chat_printf_date_tags (buffer1, 0, "irc_join", "hello");
+    CHECK(FILTER_TEST_MATCH(buffer1->own_lines->last_line, filter1->id));
+    CHECK(FILTER_TEST_MATCH(buffer1->own_lines->last_line, filter2->id));
+    LONGS_EQUAL(0, buffer1->own_lines->last_line->data->displayed);
+
+    /* line with tag "no_filter" is never filtered */
+    gui_chat_printf_date_tags (buffer1, 0, "irc_join,no_filter", "hello");
+    POINTERS_EQUAL(NULL, buffer1->own_lines->last_line->data->filters_match);
+    LONGS_EQUAL(1, buffer1->own_lines->last_line->data->displayed);
+
+    /* remove first filter: line displayed, id reused by next filter */
+    gui_filter_free (filter1);
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    filter3 = gui_filter_new (1, "test_filter_3", "core.test_filter_2",
+                              "irc_privmsg", "*");
+    CHECK(filter3);
+    LONGS_EQUAL(0, filter3->id);
+    gui_filter_all_buffers ();
+    CHECK(!FILTER_TEST_MATCH(ptr_line1, filter3->id));
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    CHECK(!FILTER_TEST_MATCH(ptr_line2, filter3->id));
+    LONGS_EQUAL(1, ptr_line2->data->displayed);
+
+    /* bitset of line is freed when no filter matches line */
+    gui_filter_free (filter2);
+    gui_filter_all_buffers ();
+    gui_filter_check_line (ptr_line1->next_line->data);
+    POINTERS_EQUAL(NULL, ptr_line1->next_line->data->filters_match);
+    LONGS_EQUAL(0, ptr_line1->next_line->data->filters_match_size);
+
+    gui_filter_free (filter3);
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(0, buffer1->own_lines->lines_hidden);
+    LONGS_EQUAL(0, buffer2->own_lines->lines_hidden);
+
+    gui_buffer_close (buffer1);
+    gui_buffer_close (buffer2);
+}
+
+/*
+ * Tests filters on merged buffers (lines of all merged buffers are filtered,
+ * according to the filters enabled in each buffer).
+ *
+ * Tests functions:
+ *   gui_filter_buffer
+ *   gui_filter_all_buffers
+ */
+
+TEST(GuiFilter, Merged)
+{
+    struct t_gui_buffer *buffer1, *buffer2;
+    struct t_gui_filter *filter;
+    struct t_gui_line *ptr_line1, *ptr_line2;
+
+    buffer1 = gui_buffer_new (NULL, "test_filter_merged_1",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer1);
+    buffer2 = gui_buffer_new (NULL, "test_filter_merged_2",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer2);
+
+    gui_chat_printf_date_tags (buffer1, 0, "irc_join", "join 1");
+    gui_chat_printf_date_tags (buffer2, 0, "irc_join", "join 2");
+    ptr_line1 = buffer1->own_lines->first_line;
+    ptr_line2 = buffer2->own_lines->first_line;
+
+    gui_buffer_merge (buffer1, buffer2);
+    CHECK(buffer1->mixed_lines);
+    POINTERS_EQUAL(buffer1->mixed_lines, buffer1->lines);
+    POINTERS_EQUAL(buffer1->mixed_lines, buffer2->lines);
+
+    filter = gui_filter_new (1, "test_filter_merged", "*", "irc_join", "*");
+    CHECK(filter);
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+    LONGS_EQUAL(0, ptr_line2->data->displayed);
+
+    /* disable filters in first buffer (lines of this buffer displayed) */
+    gui_buffer_set (buffer1, "filter", "0");
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    LONGS_EQUAL(0, ptr_line2->data->displayed);
+    gui_buffer_set (buffer1, "filter", "1");
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+    LONGS_EQUAL(0, ptr_line2->data->displayed);
+
+    /* same with second buffer */
+    gui_buffer_set (buffer2, "filter", "0");
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+    LONGS_EQUAL(1, ptr_line2->data->displayed);
+    gui_buffer_set (buffer2, "filter", "1");
+    LONGS_EQUAL(0, ptr_line2->data->displayed);
+
+    /* disable/enable filter */
+    filter->enabled = 0;
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    LONGS_EQUAL(1, ptr_line2->data->displayed);
+    filter->enabled = 1;
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(0, ptr_line1->data->displayed);
+    LONGS_EQUAL(0, ptr_line2->data->displayed);
+
+    gui_filter_free (filter);
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(1, ptr_line1->data->displayed);
+    LONGS_EQUAL(1, ptr_line2->data->displayed);
+
+    gui_buffer_close (buffer1);
+    gui_buffer_close (buffer2);
+}
+
+/*
+ * Tests filters after rename of a buffer (lines are checked again with
+ * filters matching the new name of buffer).
+ *
+ * Tests functions:
+ *   gui_filter_buffer_invalidate
+ *   gui_filter_all_buffers
+ */
+
+TEST(GuiFilter, Rename)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_filter *filter;
+    struct t_gui_line *ptr_line;
+
+    buffer = gui_buffer_new (NULL, "test_filter_rename_1",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    gui_chat_printf_date_tags (buffer, 0, "irc_join", "join");
+    ptr_line = buffer->own_lines->first_line;
+
+    filter = gui_filter_new (1, "test_filter_rename",
+                             "core.test_filter_rename_2", "irc_join", "*");
+    CHECK(filter);
+    gui_filter_all_buffers ();
+    CHECK(!FILTER_TEST_MATCH(ptr_line, filter->id));
+    LONGS_EQUAL(1, ptr_line->data->displayed);
+
+    /* rename buffer: filter now matches buffer */
+    gui_buffer_set (buffer, "name", "test_filter_rename_2");
+    CHECK(FILTER_TEST_MATCH(ptr_line, filter->id));
+    filter->enabled = 0;
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(1, ptr_line->data->displayed);
+    filter->enabled = 1;
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(0, ptr_line->data->displayed);
+    LONGS_EQUAL(1, buffer->own_lines->lines_hidden);
+
+    /* rename buffer again: filter does not match buffer any more */
+    gui_buffer_set (buffer, "name", "test_filter_rename_3");
+    CHECK(!FILTER_TEST_MATCH(ptr_line, filter->id));
+    gui_filter_all_buffers ();
+    LONGS_EQUAL(1, ptr_line->data->displayed);
+    LONGS_EQUAL(0, buffer->own_lines->lines_hidden);
+
+    gui_filter_free (filter);
+    gui_filter_all_buffers ();
+
+    gui_buffer_close (buffer);
+}
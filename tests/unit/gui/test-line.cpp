@@ -0,0 +1,292 @@
+/*
+ * test-line.cpp - test line functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-hdata.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-line.h"
+#include "src/plugins/weechat-plugin.h"
+}
+
+#define TEST_LINE_COUNT 1000
+
+TEST_GROUP(GuiLine)
+{
+};
+
+/*
+ * Tests storage of lines in chunks.
+ *
+ * Tests functions:
+ *   gui_line_chunk_new
+ *   gui_line_chunk_alloc
+ *   gui_line_chunk_release
+ *   gui_line_chunk_contains
+ *   gui_line_free_string
+ */
+
+TEST(GuiLine, Chunks)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+    struct t_gui_line_chunk *ptr_chunk;
+    struct t_hdata *hdata;
+    struct t_hashtable *hashtable;
+    int i, lines_in_chunks;
+
+    buffer = gui_buffer_new (NULL, "test_line_chunks",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, buffer->own_lines->chunks);
+    LONGS_EQUAL(0, buffer->own_lines->chunks_count);
+
+    for (i = 0; i < TEST_LINE_COUNT; i++)
+    {
+        gui_chat_printf_date_tags (buffer, 0, "tag_a,tag_b",
+                                   "prefix\tmessage %d", i);
+    }
+    LONGS_EQUAL(TEST_LINE_COUNT, buffer->own_lines->lines_count);
+
+    /* many lines per chunk, chunks are full except the last one */
+    CHECK(buffer->own_lines->chunks_count > 1);
+    CHECK(buffer->own_lines->chunks_count < TEST_LINE_COUNT / 10);
+    lines_in_chunks = 0;
+    for (ptr_chunk = buffer->own_lines->chunks; ptr_chunk;
+         ptr_chunk = ptr_chunk->next_chunk)
+    {
+        CHECK(ptr_chunk->size <= GUI_LINE_CHUNK_MAX_SIZE);
+        CHECK(ptr_chunk->used <= ptr_chunk->size);
+        lines_in_chunks += ptr_chunk->lines_count;
+    }
+    LONGS_EQUAL(TEST_LINE_COUNT, lines_in_chunks);
+
+    /* line, data, tags, time and message are in the chunk */
+    ptr_line = buffer->own_lines->last_line;
+    ptr_chunk = ptr_line->data->chunk;
+    POINTERS_EQUAL(buffer->own_lines->last_chunk, ptr_chunk);
+    CHECK(gui_line_chunk_contains (ptr_chunk, ptr_line));
+    CHECK(gui_line_chunk_contains (ptr_chunk, ptr_line->data));
+    CHECK(gui_line_chunk_contains (ptr_chunk, ptr_line->data->tags_array));
+    CHECK(gui_line_chunk_contains (ptr_chunk, ptr_line->data->message));
+    LONGS_EQUAL(2, ptr_line->data->tags_count);
+    STRCMP_EQUAL("tag_a", ptr_line->data->tags_array[0]);
+    STRCMP_EQUAL("tag_b", ptr_line->data->tags_array[1]);
+    POINTERS_EQUAL(NULL, ptr_line->data->tags_array[2]);
+    STRCMP_EQUAL("prefix", ptr_line->data->prefix);
+    STRCMP_EQUAL("message 999", ptr_line->data->message);
+
+    /* tags are shared between lines */
+    POINTERS_EQUAL(ptr_line->data->tags_array[0],
+                   ptr_line->prev_line->data->tags_array[0]);
+
+    /* update of line with hdata: strings are allocated outside chunk */
+    hdata = hook_hdata_get (NULL, "line_data");
+    CHECK(hdata);
+    hashtable = hashtable_new (8,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL, NULL);
+    CHECK(hashtable);
+    hashtable_set (hashtable, "message", "updated message");
+    hashtable_set (hashtable, "tags_array", "tag_c,tag_d,tag_e");
+    LONGS_EQUAL(2, hdata_update (hdata, ptr_line->data, hashtable));
+    hashtable_free (hashtable);
+    STRCMP_EQUAL("updated message", ptr_line->data->message);
+    CHECK(!gui_line_chunk_contains (ptr_chunk, ptr_line->data->message));
+    LONGS_EQUAL(3, ptr_line->data->tags_count);
+    STRCMP_EQUAL("tag_e", ptr_line->data->tags_array[2]);
+    CHECK(!gui_line_chunk_contains (ptr_chunk, ptr_line->data->tags_array));
+
+    /* chunks are freed when old lines are removed */
+    config_file_option_set (config_history_max_buffer_lines_number, "10", 1);
+    gui_chat_printf_date_tags (buffer, 0, "tag_a", "prefix\tlast message");
+    config_file_option_reset (config_history_max_buffer_lines_number, 1);
+    LONGS_EQUAL(10, buffer->own_lines->lines_count);
+    CHECK(buffer->own_lines->chunks_count <= 2);
+    lines_in_chunks = 0;
+    for (ptr_chunk = buffer->own_lines->chunks; ptr_chunk;
+         ptr_chunk = ptr_chunk->next_chunk)
+    {
+        lines_in_chunks += ptr_chunk->lines_count;
+    }
+    LONGS_EQUAL(10, lines_in_chunks);
+
+    /* all chunks are freed when buffer is cleared */
+    gui_buffer_clear (buffer);
+    LONGS_EQUAL(0, buffer->own_lines->lines_count);
+    POINTERS_EQUAL(NULL, buffer->own_lines->chunks);
+    POINTERS_EQUAL(NULL, buffer->own_lines->last_chunk);
+    LONGS_EQUAL(0, buffer->own_lines->chunks_count);
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests ids of tags in lines.
+ *
+ * Tests functions:
+ *   gui_line_tag_get_id
+ *   gui_line_tag_release_id
+ */
+
+TEST(GuiLine, TagsId)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+    char tag[64];
+    int i, id, id_bob, generation;
+
+    buffer = gui_buffer_new (NULL, "test_line_tags_id",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    gui_chat_printf_date_tags (buffer, 0, "irc_privmsg,nick_test_bob",
+                               "bob\tmessage 1");
+    gui_chat_printf_date_tags (buffer, 0, "irc_privmsg,nick_test_bob,log1",
+                               "bob\tmessage 2");
+
+    /* same tag in two lines: same id */
+    ptr_line = buffer->own_lines->last_line;
+    CHECK(ptr_line->data->tags_id);
+    LONGS_EQUAL(ptr_line->data->tags_id[1],
+                ptr_line->prev_line->data->tags_id[1]);
+    CHECK(ptr_line->data->tags_id[0] != ptr_line->data->tags_id[1]);
+    id_bob = ptr_line->data->tags_id[1];
+    CHECK(gui_line_tags[id_bob]);
+    STRCMP_EQUAL("nick_test_bob", gui_line_tags[id_bob]->name);
+    LONGS_EQUAL(2, gui_line_tags[id_bob]->refcount);
+
+    /* tag is freed when it's not used any more */
+    gui_buffer_clear (buffer);
+    POINTERS_EQUAL(NULL, gui_line_tags[id_bob]);
+
+    /* ids are recycled when enough ids have been released */
+    generation = gui_line_tags_generation;
+    for (i = 0; i < GUI_LINE_TAGS_RECYCLE_MIN + 1; i++)
+    {
+        snprintf (tag, sizeof (tag), "test_tag_%d", i);
+        gui_chat_printf_date_tags (buffer, 0, tag, "message");
+    }
+    gui_buffer_clear (buffer);
+    gui_chat_printf_date_tags (buffer, 0, "test_tag_new", "message");
+    id = buffer->own_lines->last_line->data->tags_id[0];
+    CHECK(id < gui_line_tags_ids_count);
+    CHECK(gui_line_tags_generation > generation);
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests match of tags compiled with tags of lines.
+ *
+ * Tests functions:
+ *   gui_line_tags_match_new
+ *   gui_line_tags_match_free
+ *   gui_line_match_tags
+ */
+
+TEST(GuiLine, MatchTags)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+    struct t_gui_line_tags_match *tags_match;
+    char **tags_groups, ***tags_array;
+    int i, j, tags_count;
+    const char *tags[][2] = {
+        /* tags (filter/hook), result of match with line */
+        { "irc_privmsg", "1" },
+        { "IRC_PRIVMSG", "1" },
+        { "irc_notice", "0" },
+        { "nick_*", "1" },
+        { "*_test_*", "1" },
+        { "irc_privmsg+nick_alice", "1" },
+        { "irc_privmsg+nick_bob", "0" },
+        { "irc_privmsg+!log1", "0" },
+        { "irc_privmsg+!log3", "1" },
+        { "!irc_privmsg", "0" },
+        { "irc_notice,nick_bob,log1", "1" },
+        { "irc_notice,nick_bob", "0" },
+        { NULL, NULL },
+    };
+
+    buffer = gui_buffer_new (NULL, "test_line_match_tags",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    gui_chat_printf_date_tags (buffer, 0,
+                               "irc_privmsg,nick_alice,irc_test_tag,log1",
+                               "alice\tmessage");
+    ptr_line = buffer->own_lines->last_line;
+
+    for (i = 0; tags[i][0]; i++)
+    {
+        tags_groups = string_split (tags[i][0], ",", 0, 0, &tags_count);
+        CHECK(tags_groups);
+        tags_array = (char ***)malloc (tags_count * sizeof (*tags_array));
+        CHECK(tags_array);
+        for (j = 0; j < tags_count; j++)
+        {
+            tags_array[j] = string_split (tags_groups[j], "+", 0, 0, NULL);
+        }
+        tags_match = gui_line_tags_match_new (tags_count, tags_array);
+        CHECK(tags_match);
+        /* twice: second time the result is read from cache */
+        LONGS_EQUAL(atoi (tags[i][1]),
+                    gui_line_match_tags (ptr_line->data, tags_match));
+        LONGS_EQUAL(atoi (tags[i][1]),
+                    gui_line_match_tags (ptr_line->data, tags_match));
+        gui_line_tags_match_free (tags_match);
+        for (j = 0; j < tags_count; j++)
+        {
+            string_free_split (tags_array[j]);
+        }
+        free (tags_array);
+        string_free_split (tags_groups);
+    }
+
+    /* line without tags never matches */
+    gui_chat_printf_date_tags (buffer, 0, NULL, "message");
+    tags_groups = string_split ("!irc_privmsg", ",", 0, 0, &tags_count);
+    tags_array = (char ***)malloc (sizeof (*tags_array));
+    tags_array[0] = string_split (tags_groups[0], "+", 0, 0, NULL);
+    tags_match = gui_line_tags_match_new (1, tags_array);
+    LONGS_EQUAL(0, gui_line_match_tags (buffer->own_lines->last_line->data,
+                                        tags_match));
+    gui_line_tags_match_free (tags_match);
+    string_free_split (tags_array[0]);
+    free (tags_array);
+    string_free_split (tags_groups);
+
+    POINTERS_EQUAL(NULL, gui_line_tags_match_new (0, NULL));
+
+    gui_buffer_close (buffer);
+}
@@ -0,0 +1,442 @@
+/*
+ * test-search-index.cpp - test search index functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-hdata.h"
+#include "src/core/wee-hook.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-input.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-search-index.h"
+#include "src/plugins/plugin.h"
+}
+
+#define SEARCH_INDEX_TEST_LINES 1000
+
+#define WEE_CHECK_BUCKETS(__result, __regex, __text)                    \
+    gui_buffer_set (buffer, "input", __text);                           \
+    buffer->text_search_regex = __regex;                                \
+    LONGS_EQUAL(__result,                                               \
+                gui_search_index_get_buckets (buffer, &buckets));       \
+    if (buckets)                                                        \
+        free (buckets);
+
+TEST_GROUP(GuiSearchIndex)
+{
+};
+
+/*
+ * Sets text searched in buffer.
+ */
+
+void
+test_search_index_set_search (struct t_gui_buffer *buffer, const char *text,
+                              int exact, int regex, int where)
+{
+    gui_buffer_set (buffer, "input", text);
+    buffer->text_search_exact = exact;
+    buffer->text_search_regex = regex;
+    buffer->text_search_where = where;
+    gui_input_search_compile_regex (buffer);
+}
+
+/*
+ * Searches text in buffer without search index (all lines are checked).
+ */
+
+struct t_gui_line *
+test_search_index_search_lines (struct t_gui_buffer *buffer,
+                                struct t_gui_line *start_line,
+                                int backward)
+{
+    struct t_gui_line *ptr_line;
+
+    if (backward)
+    {
+        ptr_line = (start_line) ?
+            gui_line_get_prev_displayed (start_line) :
+            gui_line_get_last_displayed (buffer);
+    }
+    else
+    {
+        ptr_line = (start_line) ?
+            gui_line_get_next_displayed (start_line) :
+            gui_line_get_first_displayed (buffer);
+    }
+    while (ptr_line && !gui_line_search_text (buffer, ptr_line))
+    {
+        ptr_line = (backward) ?
+            gui_line_get_prev_displayed (ptr_line) :
+            gui_line_get_next_displayed (ptr_line);
+    }
+
+    return ptr_line;
+}
+
+/*
+ * Checks that all lines found with search index (backward and forward) are
+ * the same as lines found without index.
+ *
+ * Returns number of lines found.
+ */
+
+int
+test_search_index_check_all (struct t_gui_buffer *buffer)
+{
+    struct t_gui_line *ptr_line, *ptr_line_index;
+    int backward, count;
+
+    count = 0;
+    for (backward = 0; backward <= 1; backward++)
+    {
+        ptr_line = NULL;
+        while (1)
+        {
+            LONGS_EQUAL(1, gui_search_index_search (buffer, ptr_line,
+                                                    backward,
+                                                    &ptr_line_index));
+            ptr_line = test_search_index_search_lines (buffer, ptr_line,
+                                                       backward);
+            POINTERS_EQUAL(ptr_line, ptr_line_index);
+            if (!ptr_line)
+                break;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Tests functions:
+ *   gui_search_index_get_buckets
+ */
+
+TEST(GuiSearchIndex, GetBuckets)
+{
+    struct t_gui_buffer *buffer;
+    int *buckets;
+
+    buffer = gui_buffer_new (NULL, "test_search_index",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    /* text too short */
+    WEE_CHECK_BUCKETS(0, 0, "");
+    WEE_CHECK_BUCKETS(0, 0, "ab");
+
+    /* simple string: all trigrams */
+    WEE_CHECK_BUCKETS(1, 0, "abc");
+    WEE_CHECK_BUCKETS(1, 0, "ABC");
+    WEE_CHECK_BUCKETS(3, 0, "hello");
+    WEE_CHECK_BUCKETS(4, 0, "a.*b|c");
+
+    /* regex: alternative or group */
+    WEE_CHECK_BUCKETS(0, 1, "hello|world");
+    WEE_CHECK_BUCKETS(0, 1, "(hello)");
+    WEE_CHECK_BUCKETS(0, 1, "(?i)hello");
+
+    /* regex: no literal string with at least 3 chars */
+    WEE_CHECK_BUCKETS(0, 1, "^a.c$");
+    WEE_CHECK_BUCKETS(0, 1, "ab*cd");
+    WEE_CHECK_BUCKETS(0, 1, "ab[cd]ef");
+    WEE_CHECK_BUCKETS(0, 1, "\\wab\\d");
+    WEE_CHECK_BUCKETS(0, 1, "abc{2}");
+
+    /* regex: literal strings */
+    WEE_CHECK_BUCKETS(1, 1, "^abc$");
+    WEE_CHECK_BUCKETS(1, 1, "abcd?");
+    WEE_CHECK_BUCKETS(2, 1, "abcd+");
+    WEE_CHECK_BUCKETS(2, 1, "abc.*def");
+    WEE_CHECK_BUCKETS(3, 1, "a\\.b\\*c");
+    WEE_CHECK_BUCKETS(3, 1, "[a-z]+hello[0-9]");
+
+    /* regex: classes inside bracket expressions */
+    WEE_CHECK_BUCKETS(1, 1, "[[:digit:]]abc");
+    WEE_CHECK_BUCKETS(2, 1, "[[=a=]]bcde");
+    WEE_CHECK_BUCKETS(1, 1, "[[.-.]]abc");
+    WEE_CHECK_BUCKETS(1, 1, "[^a[:space:]]abc");
+    WEE_CHECK_BUCKETS(1, 1, "[[:alpha:]_]abc");
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_search_index_enabled
+ *   gui_search_index_build
+ *   gui_search_index_add_line
+ *   gui_search_index_get_line
+ *   gui_search_index_search
+ *   gui_search_index_free
+ */
+
+TEST(GuiSearchIndex, Search)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+    struct t_gui_search_index_line *ptr_index_line;
+    struct t_hashtable *hashtable;
+
+    buffer = gui_buffer_new (NULL, "test_search_index",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    LONGS_EQUAL(1, gui_search_index_enabled (buffer));
+
+    gui_chat_printf (buffer, "alice\tHello world");
+    gui_chat_printf (buffer, "bob\thello %sWorld", gui_color_get_custom ("red"));
+    gui_chat_printf (buffer, "carol\tgoodbye");
+    gui_chat_printf (buffer, "hello\ttest");
+    gui_chat_printf (buffer, "dave\tsay HELLO to everyone");
+
+    /* index is built on first search */
+    POINTERS_EQUAL(NULL, buffer->search_index);
+    POINTERS_EQUAL(NULL, gui_search_index_get_line (buffer->own_lines->first_line->data));
+    test_search_index_set_search (buffer, "hello world", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(1, gui_search_index_search (buffer, NULL, 1, &ptr_line));
+    CHECK(buffer->search_index);
+    POINTERS_EQUAL(buffer->own_lines->first_line->next_line, ptr_line);
+    LONGS_EQUAL(5, buffer->search_index->lines_count);
+
+    /* text without colors is stored in index */
+    ptr_index_line = gui_search_index_get_line (ptr_line->data);
+    CHECK(ptr_index_line);
+    POINTERS_EQUAL(ptr_line, ptr_index_line->line);
+    STRCMP_EQUAL("bob", ptr_index_line->prefix);
+    STRCMP_EQUAL("hello World", ptr_index_line->message);
+
+    /* simple string (case insensitive and sensitive) */
+    LONGS_EQUAL(4, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "hello", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(8, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "hello", 1, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(4, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "hello", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(6, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "hello", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX);
+    LONGS_EQUAL(2, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "not found", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(0, test_search_index_check_all (buffer));
+
+    /* regex */
+    test_search_index_set_search (buffer, "hel+o.*world", 0, 1,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(4, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "^good(bye)?$", 0, 1,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(0, gui_search_index_search (buffer, NULL, 1, &ptr_line));
+
+    /* regex with classes inside bracket expressions */
+    test_search_index_set_search (buffer, "[[:alpha:]]ello world", 0, 1,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(4, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "[[=h=]]ello", 0, 1,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(8, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "[[.g.]]oodbye", 0, 1,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(2, test_search_index_check_all (buffer));
+
+    /* new line is added in index */
+    gui_chat_printf (buffer, "erin\thello world again");
+    LONGS_EQUAL(6, buffer->search_index->lines_count);
+    test_search_index_set_search (buffer, "hello world", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(1, gui_search_index_search (buffer, NULL, 1, &ptr_line));
+    POINTERS_EQUAL(buffer->own_lines->last_line, ptr_line);
+    LONGS_EQUAL(6, test_search_index_check_all (buffer));
+
+    /* hidden line is skipped */
+    buffer->own_lines->last_line->data->displayed = 0;
+    LONGS_EQUAL(4, test_search_index_check_all (buffer));
+    buffer->own_lines->last_line->data->displayed = 1;
+
+    /* removed lines */
+    gui_line_free (buffer, buffer->own_lines->first_line);
+    LONGS_EQUAL(1, buffer->search_index->lines_start);
+    LONGS_EQUAL(4, test_search_index_check_all (buffer));
+    gui_line_free (buffer, buffer->own_lines->last_line);
+    LONGS_EQUAL(2, test_search_index_check_all (buffer));
+
+    /* index is freed when a message is updated */
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL, NULL);
+    CHECK(hashtable);
+    hashtable_set (hashtable, "message", "hello world updated");
+    LONGS_EQUAL(1, hdata_update (hook_hdata_get (NULL, "line_data"),
+                                 buffer->own_lines->first_line->data,
+                                 hashtable));
+    hashtable_free (hashtable);
+    POINTERS_EQUAL(NULL, buffer->search_index);
+    LONGS_EQUAL(2, test_search_index_check_all (buffer));
+
+    /* index is freed when buffer is cleared */
+    CHECK(buffer->search_index);
+    gui_buffer_clear (buffer);
+    POINTERS_EQUAL(NULL, buffer->search_index);
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_search_index_remove_line
+ *   gui_search_index_compact
+ *   gui_search_index_free_all
+ */
+
+TEST(GuiSearchIndex, Compact)
+{
+    struct t_gui_buffer *buffer;
+    int i;
+
+    buffer = gui_buffer_new (NULL, "test_search_index",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    for (i = 0; i < 3000; i++)
+    {
+        gui_chat_printf (buffer, "nick_%d\tmessage %d", i % 10, i);
+    }
+    test_search_index_set_search (buffer, "message 1", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(2 * 1111, test_search_index_check_all (buffer));
+
+    /* remove 2000 first lines: index is compacted after 1500 lines */
+    for (i = 0; i < 2000; i++)
+    {
+        gui_line_free (buffer, buffer->own_lines->first_line);
+    }
+    CHECK(buffer->search_index);
+    LONGS_EQUAL(1500, buffer->search_index->first_id);
+    LONGS_EQUAL(500, buffer->search_index->lines_start);
+    LONGS_EQUAL(1500, buffer->search_index->lines_count);
+    LONGS_EQUAL(0, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "message 2", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(2 * 1000, test_search_index_check_all (buffer));
+
+    /* new lines after compaction */
+    for (i = 0; i < 10; i++)
+    {
+        gui_chat_printf (buffer, "nick\tmessage %d", 3000 + i);
+    }
+    LONGS_EQUAL(1510, buffer->search_index->lines_count);
+    LONGS_EQUAL(2 * 1000, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "message 300", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX |
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(2 * 10, test_search_index_check_all (buffer));
+
+    /* disable option: all indexes are freed, search is done without index */
+    config_file_option_set (config_look_buffer_search_index, "off", 1);
+    POINTERS_EQUAL(NULL, buffer->search_index);
+    LONGS_EQUAL(0, gui_search_index_enabled (buffer));
+    config_file_option_reset (config_look_buffer_search_index, 1);
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests search with index in a buffer with many lines (with colors), with
+ * same results as search without index.
+ *
+ * Tests functions:
+ *   gui_search_index_build
+ *   gui_search_index_search
+ */
+
+TEST(GuiSearchIndex, SearchManyLines)
+{
+    struct t_gui_buffer *buffer;
+    char text[64];
+    int i;
+
+    buffer = gui_buffer_new (NULL, "test_search_index",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    for (i = 0; i < SEARCH_INDEX_TEST_LINES; i++)
+    {
+        gui_chat_printf (buffer, "%snick_%d\tthis is the %smessage%s %d",
+                         gui_color_get_custom ("green"), i % 100,
+                         gui_color_get_custom ("bold"),
+                         gui_color_get_custom ("-bold"), i);
+    }
+
+    /* "message N": lines N, N0-N9 and N00-N99 (111 lines) */
+    for (i = 1; i <= 9; i++)
+    {
+        snprintf (text, sizeof (text), "message %d", i);
+        test_search_index_set_search (buffer, text, 0, 0,
+                                      GUI_TEXT_SEARCH_IN_PREFIX |
+                                      GUI_TEXT_SEARCH_IN_MESSAGE);
+        LONGS_EQUAL(2 * 111, test_search_index_check_all (buffer));
+    }
+
+    /* "nick_4": nicks 4 and 40-49, 10 lines for each nick */
+    test_search_index_set_search (buffer, "nick_4", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_PREFIX);
+    LONGS_EQUAL(2 * 110, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "nick_4", 0, 0,
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(0, test_search_index_check_all (buffer));
+
+    /* regex */
+    test_search_index_set_search (buffer, "the message 99[0-9]$", 0, 1,
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(2 * 10, test_search_index_check_all (buffer));
+    test_search_index_set_search (buffer, "[[:space:]]message 99", 0, 1,
+                                  GUI_TEXT_SEARCH_IN_MESSAGE);
+    LONGS_EQUAL(2 * 11, test_search_index_check_all (buffer));
+
+    gui_buffer_close (buffer);
+}
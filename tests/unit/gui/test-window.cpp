@@ -0,0 +1,256 @@
+/*
+ * test-window.cpp - test window functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-window.h"
+
+extern int gui_chat_get_real_width (struct t_gui_window *window);
+extern int gui_chat_display_line (struct t_gui_window *window,
+                                  struct t_gui_line *line,
+                                  int count, int simulate);
+extern void gui_chat_calculate_line_diff (struct t_gui_window *window,
+                                          struct t_gui_line **line,
+                                          int *line_pos, int difference);
+}
+
+#define WINDOW_TEST_LINES     300
+#define WINDOW_TEST_MAX_PAGES 128
+
+TEST_GROUP(GuiWindow)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_window_lines_layout_check
+ *   gui_window_lines_layout_get
+ *   gui_window_lines_layout_set
+ *   gui_window_lines_layout_remove
+ *   gui_window_lines_layout_invalidate
+ */
+
+TEST(GuiWindow, LinesLayout)
+{
+    struct t_gui_buffer *buffer, *old_buffer;
+    struct t_gui_window *window;
+    struct t_gui_line *ptr_line;
+    struct t_gui_line_data *ptr_data;
+    char message[1024];
+    int i, width, num_lines, num_lines_long, old_width, old_height;
+
+    window = gui_current_window;
+    old_buffer = window->buffer;
+    old_width = window->win_chat_width;
+    old_height = window->win_chat_height;
+
+    buffer = gui_buffer_new (NULL, "test_window",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    gui_window_switch_to_buffer (window, buffer, 0);
+    window->win_chat_width = 80;
+    window->win_chat_height = 25;
+
+    for (i = 0; i < (int)sizeof (message) - 1; i++)
+    {
+        message[i] = (i % 8 == 7) ? ' ' : 'a' + (i % 26);
+    }
+    message[sizeof (message) - 1] = '\0';
+
+    gui_chat_printf (buffer, "nick\tshort message");
+    gui_chat_printf (buffer, "nick\t%s", message);
+
+    width = gui_chat_get_real_width (window);
+    CHECK(width > 10);
+
+    /* layout is computed on first simulation */
+    ptr_line = buffer->own_lines->first_line;
+    LONGS_EQUAL(-1, gui_window_lines_layout_get (window, ptr_line->data,
+                                                 width));
+    num_lines = gui_chat_display_line (window, ptr_line, 0, 1);
+    LONGS_EQUAL(1, num_lines);
+    LONGS_EQUAL(num_lines, gui_window_lines_layout_get (window,
+                                                        ptr_line->data,
+                                                        width));
+    LONGS_EQUAL(num_lines, gui_chat_display_line (window, ptr_line, 0, 1));
+
+    num_lines_long = gui_chat_display_line (window, ptr_line->next_line,
+                                            0, 1);
+    CHECK(num_lines_long > 1);
+    LONGS_EQUAL(num_lines_long,
+                gui_window_lines_layout_get (window,
+                                             ptr_line->next_line->data,
+                                             width));
+
+    /* layout is cleared when width changes */
+    LONGS_EQUAL(-1, gui_window_lines_layout_get (window, ptr_line->data,
+                                                 width - 10));
+    LONGS_EQUAL(-1, gui_window_lines_layout_get (window,
+                                                 ptr_line->next_line->data,
+                                                 width));
+    window->win_chat_width -= 10;
+    CHECK(gui_chat_display_line (window, ptr_line->next_line, 0, 1)
+          > num_lines_long);
+    window->win_chat_width += 10;
+    LONGS_EQUAL(num_lines_long,
+                gui_chat_display_line (window, ptr_line->next_line, 0, 1));
+
+    /* layout is cleared when a refresh is asked (options changed) */
+    gui_window_lines_layout_invalidate ();
+    LONGS_EQUAL(-1, gui_window_lines_layout_get (window,
+                                                 ptr_line->next_line->data,
+                                                 width));
+    LONGS_EQUAL(num_lines_long,
+                gui_chat_display_line (window, ptr_line->next_line, 0, 1));
+
+    /* layout is cleared when max length of prefix changes */
+    gui_chat_display_line (window, ptr_line, 0, 1);
+    gui_chat_printf (buffer, "a_very_long_nick\tmessage");
+    LONGS_EQUAL(-1, gui_window_lines_layout_get (window, ptr_line->data,
+                                                 width));
+
+    /* removed line is removed from layout */
+    gui_chat_display_line (window, ptr_line, 0, 1);
+    ptr_data = ptr_line->data;
+    LONGS_EQUAL(1, gui_window_lines_layout_get (window, ptr_data, width));
+    gui_line_free (buffer, ptr_line);
+    LONGS_EQUAL(-1, gui_window_lines_layout_get (window, ptr_data, width));
+
+    /* layout is the same as computed without cache */
+    gui_chat_printf (buffer, "nick2\t%s", message + 100);
+    gui_chat_printf (buffer, "nick3\t%s", message + 500);
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        num_lines = gui_chat_display_line (window, ptr_line, 0, 1);
+        gui_window_lines_layout_remove (window, ptr_line->data);
+        LONGS_EQUAL(num_lines, gui_chat_display_line (window, ptr_line,
+                                                      0, 1));
+    }
+
+    window->win_chat_width = old_width;
+    window->win_chat_height = old_height;
+    gui_window_switch_to_buffer (window, old_buffer, 0);
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests scroll (page up and page down) in a buffer, with same positions as
+ * computed without layout of lines.
+ *
+ * Tests functions:
+ *   gui_window_lines_layout_get
+ *   gui_window_lines_layout_set
+ *   gui_window_lines_layout_invalidate
+ */
+
+TEST(GuiWindow, LinesLayoutScroll)
+{
+    struct t_gui_buffer *buffer, *old_buffer;
+    struct t_gui_window *window;
+    struct t_gui_line *ptr_line, *lines[WINDOW_TEST_MAX_PAGES];
+    int i, line_pos, lines_pos[WINDOW_TEST_MAX_PAGES], pages, page_lines;
+    int old_width, old_height;
+
+    window = gui_current_window;
+    old_buffer = window->buffer;
+    old_width = window->win_chat_width;
+    old_height = window->win_chat_height;
+
+    buffer = gui_buffer_new (NULL, "test_window",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    gui_window_switch_to_buffer (window, buffer, 0);
+    window->win_chat_width = 80;
+    window->win_chat_height = 25;
+
+    for (i = 0; i < WINDOW_TEST_LINES; i++)
+    {
+        gui_chat_printf (buffer,
+                         "nick_%d\tthis is the %smessage%s %d, a message "
+                         "long enough to be displayed on %d lines if "
+                         "the window is not very large",
+                         i % 100,
+                         gui_color_get_custom ("bold"),
+                         gui_color_get_custom ("-bold"),
+                         i, 1 + (i % 3));
+    }
+
+    page_lines = window->win_chat_height - 1;
+
+    /* page up, then page down, without layout of lines (computed each time) */
+    ptr_line = NULL;
+    line_pos = 0;
+    pages = 0;
+    while (pages < WINDOW_TEST_MAX_PAGES / 2)
+    {
+        gui_window_lines_layout_invalidate ();
+        gui_chat_calculate_line_diff (window, &ptr_line, &line_pos,
+                                      (-1) * page_lines);
+        lines[pages] = ptr_line;
+        lines_pos[pages] = line_pos;
+        pages++;
+        if (!ptr_line
+            || ((ptr_line == buffer->own_lines->first_line)
+                && (line_pos == 0)))
+        {
+            break;
+        }
+    }
+    CHECK(pages > 1);
+    CHECK(pages < WINDOW_TEST_MAX_PAGES / 2);
+    POINTERS_EQUAL(buffer->own_lines->first_line, ptr_line);
+    for (i = 0; i < pages; i++)
+    {
+        gui_window_lines_layout_invalidate ();
+        gui_chat_calculate_line_diff (window, &ptr_line, &line_pos,
+                                      page_lines);
+        lines[pages + i] = ptr_line;
+        lines_pos[pages + i] = line_pos;
+    }
+
+    /* page up then page down with layout of lines: same positions */
+    ptr_line = NULL;
+    line_pos = 0;
+    for (i = 0; i < 2 * pages; i++)
+    {
+        gui_chat_calculate_line_diff (window, &ptr_line, &line_pos,
+                                      (i < pages) ?
+                                      (-1) * page_lines : page_lines);
+        POINTERS_EQUAL(lines[i], ptr_line);
+        LONGS_EQUAL(lines_pos[i], line_pos);
+    }
+
+    window->win_chat_width = old_width;
+    window->win_chat_height = old_height;
+    gui_window_switch_to_buffer (window, old_buffer, 0);
+    gui_buffer_close (buffer);
+}
@@ -0,0 +1,252 @@
+/*
+ * test-irc-fake-server.cpp - fake IRC server used by IRC tests
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern "C"
+{
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "src/core/wee-hdata.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+}
+
+#include "tests/unit/plugins/irc/test-irc-fake-server.h"
+
+
+/*
+ * Starts a fake IRC server on localhost (random port), adds an IRC server
+ * with this address in WeeChat and connects to it.
+ *
+ * Returns:
+ *   1: OK (WeeChat is connected to the fake server)
+ *   0: error
+ */
+
+int
+test_irc_fake_server_start (struct t_test_irc_fake_server *server,
+                            const char *name, const char *nick)
+{
+    struct sockaddr_in addr;
+    socklen_t length;
+    char command[256];
+    time_t start;
+
+    server->name = strdup (name);
+    server->sock = -1;
+    server->received = NULL;
+    server->sock_listen = socket (AF_INET, SOCK_STREAM, 0);
+    if (!server->name || (server->sock_listen < 0))
+        return 0;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    length = sizeof (addr);
+    if ((bind (server->sock_listen, (struct sockaddr *)&addr,
+               sizeof (addr)) != 0)
+        || (listen (server->sock_listen, 1) != 0)
+        || (getsockname (server->sock_listen, (struct sockaddr *)&addr,
+                         &length) != 0))
+    {
+        return 0;
+    }
+    fcntl (server->sock_listen, F_SETFL, O_NONBLOCK);
+
+    snprintf (command, sizeof (command),
+              "/server add %s 127.0.0.1/%d -nossl -autoconnect=off "
+              "-autoreconnect=off -nicks=%s",
+              name, ntohs (addr.sin_port), nick);
+    input_data (gui_buffer_search_main (), command);
+    snprintf (command, sizeof (command), "/connect %s", name);
+    input_data (gui_buffer_search_main (), command);
+
+    start = time (NULL);
+    while ((server->sock < 0)
+           && (time (NULL) - start < TEST_IRC_FAKE_SERVER_TIMEOUT))
+    {
+        test_irc_fake_server_run_hooks (server);
+        server->sock = accept (server->sock_listen, NULL, NULL);
+    }
+    if (server->sock < 0)
+        return 0;
+    fcntl (server->sock, F_SETFL, O_NONBLOCK);
+
+    return 1;
+}
+
+/*
+ * Disconnects and deletes the IRC server in WeeChat, then stops the fake
+ * IRC server.
+ */
+
+void
+test_irc_fake_server_stop (struct t_test_irc_fake_server *server)
+{
+    char command[256];
+
+    if (server->name)
+    {
+        snprintf (command, sizeof (command), "/disconnect %s", server->name);
+        input_data (gui_buffer_search_main (), command);
+        snprintf (command, sizeof (command), "/server del %s", server->name);
+        input_data (gui_buffer_search_main (), command);
+        free (server->name);
+        server->name = NULL;
+    }
+    if (server->sock >= 0)
+    {
+        close (server->sock);
+        server->sock = -1;
+    }
+    if (server->sock_listen >= 0)
+    {
+        close (server->sock_listen);
+        server->sock_listen = -1;
+    }
+}
+
+/*
+ * Runs fd and timer hooks once (like the main loop of WeeChat), and reads
+ * all data sent by WeeChat to the fake IRC server (data is added in
+ * server->received if not NULL, otherwise it is ignored).
+ */
+
+void
+test_irc_fake_server_run_hooks (struct t_test_irc_fake_server *server)
+{
+    char buffer[4096];
+    int num_read;
+
+    hook_fd_exec ();
+    hook_timer_exec ();
+    if (server->sock >= 0)
+    {
+        while ((num_read = recv (server->sock, buffer,
+                                 sizeof (buffer) - 1, 0)) > 0)
+        {
+            if (server->received)
+            {
+                buffer[num_read] = '\0';
+                string_dyn_concat (server->received, buffer);
+            }
+        }
+    }
+}
+
+/*
+ * Sends data from the fake IRC server to WeeChat (hooks are executed while
+ * the socket buffer is full).
+ */
+
+void
+test_irc_fake_server_send (struct t_test_irc_fake_server *server,
+                           const char *data)
+{
+    int length, num_sent;
+
+    length = strlen (data);
+    while (length > 0)
+    {
+        num_sent = send (server->sock, data, length, 0);
+        if (num_sent > 0)
+        {
+            data += num_sent;
+            length -= num_sent;
+        }
+        else if ((num_sent < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)
+                 && (errno != EINTR))
+        {
+            return;
+        }
+        else
+        {
+            test_irc_fake_server_run_hooks (server);
+        }
+    }
+}
+
+/*
+ * Gets number of nicks in a channel of the IRC server (via hdata).
+ *
+ * Returns number of nicks, -1 if the channel is not found.
+ */
+
+int
+test_irc_fake_server_nick_count (struct t_test_irc_fake_server *server,
+                                 const char *channel)
+{
+    struct t_hdata *hdata_server, *hdata_channel;
+    void *ptr_server, *ptr_channel;
+    char str_condition[256];
+
+    hdata_server = hook_hdata_get (NULL, "irc_server");
+    hdata_channel = hook_hdata_get (NULL, "irc_channel");
+    if (!hdata_server || !hdata_channel)
+        return -1;
+
+    snprintf (str_condition, sizeof (str_condition),
+              "${irc_server.name} == %s", server->name);
+    ptr_server = hdata_search (hdata_server,
+                               hdata_get_list (hdata_server, "irc_servers"),
+                               str_condition, 1);
+    if (!ptr_server)
+        return -1;
+
+    snprintf (str_condition, sizeof (str_condition),
+              "${irc_channel.name} == %s", channel);
+    ptr_channel = hdata_search (hdata_channel,
+                                hdata_pointer (hdata_server, ptr_server,
+                                               "channels"),
+                                str_condition, 1);
+    if (!ptr_channel)
+        return -1;
+
+    return hdata_integer (hdata_channel, ptr_channel, "nicks_count");
+}
+
+/*
+ * Runs hooks until the channel has the expected number of nicks (or timeout).
+ */
+
+void
+test_irc_fake_server_wait_count (struct t_test_irc_fake_server *server,
+                                 const char *channel, int count)
+{
+    time_t start;
+
+    start = time (NULL);
+    while ((test_irc_fake_server_nick_count (server, channel) != count)
+           && (time (NULL) - start < TEST_IRC_FAKE_SERVER_TIMEOUT))
+    {
+        test_irc_fake_server_run_hooks (server);
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_TEST_IRC_FAKE_SERVER_H
+#define WEECHAT_TEST_IRC_FAKE_SERVER_H 1
+
+#define TEST_IRC_FAKE_SERVER_TIMEOUT 120
+
+/* fake IRC server (listening on localhost), used by IRC tests */
+
+struct t_test_irc_fake_server
+{
+    char *name;                     /* name of IRC server in WeeChat         */
+    int sock_listen;                /* socket listening on localhost         */
+    int sock;                       /* socket connected to WeeChat (or -1)   */
+    char **received;                /* data received from WeeChat (dynamic   */
+                                    /* string, if not NULL)                  */
+};
+
+extern int test_irc_fake_server_start (struct t_test_irc_fake_server *server,
+                                       const char *name, const char *nick);
+extern void test_irc_fake_server_stop (struct t_test_irc_fake_server *server);
+extern void test_irc_fake_server_run_hooks (struct t_test_irc_fake_server *server);
+extern void test_irc_fake_server_send (struct t_test_irc_fake_server *server,
+                                       const char *data);
+extern int test_irc_fake_server_nick_count (struct t_test_irc_fake_server *server,
+                                            const char *channel);
+extern void test_irc_fake_server_wait_count (struct t_test_irc_fake_server *server,
+                                             const char *channel, int count);
+
+#endif /* WEECHAT_TEST_IRC_FAKE_SERVER_H */
@@ -0,0 +1,270 @@
+/*
+ * test-irc-ignore.cpp - test IRC ignore functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "src/core/wee-hook.h"
+#include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/plugin.h"
+}
+
+#include "tests/unit/plugins/irc/test-irc-fake-server.h"
+
+/* message sent to WeeChat, and expected result of ignores */
+
+struct t_test_irc_ignore_case
+{
+    const char *host;                  /* sender: "nick!user@host"          */
+    const char *target;                /* channel or own nick (private)     */
+    int ignored;                       /* 1 if message must be ignored      */
+};
+
+TEST_GROUP(IrcIgnore)
+{
+};
+
+/*
+ * Callback for messages displayed: adds message at the end of a dynamic
+ * string (one message by line).
+ */
+
+int
+test_irc_ignore_print_cb (const void *pointer, void *data,
+                          struct t_gui_buffer *buffer,
+                          time_t date, int tags_count,
+                          const char **tags, int displayed,
+                          int highlight, const char *prefix,
+                          const char *message)
+{
+    char **messages;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) buffer;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+    (void) prefix;
+
+    messages = (char **)pointer;
+    string_dyn_concat (messages, (message) ? message : "");
+    string_dyn_concat (messages, "\n");
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Sends a message for each case (message is "<name>_<index>"), waits until
+ * all messages are received and checks that each message is displayed or
+ * ignored.
+ */
+
+void
+test_irc_ignore_check_cases (struct t_test_irc_fake_server *server,
+                             char **messages, const char *name,
+                             struct t_test_irc_ignore_case *cases,
+                             int *sync_count)
+{
+    char **msg, line[512], text[128];
+    int i;
+
+    string_dyn_copy (messages, "\n");
+
+    msg = string_dyn_alloc (1024);
+    CHECK(msg);
+    for (i = 0; cases[i].host; i++)
+    {
+        snprintf (line, sizeof (line), ":%s PRIVMSG %s :%s_%02d\r\n",
+                  cases[i].host, cases[i].target, name, i);
+        string_dyn_concat (msg, line);
+    }
+    (*sync_count)++;
+    snprintf (line, sizeof (line), ":sync%d!user@host JOIN :#sync\r\n",
+              *sync_count);
+    string_dyn_concat (msg, line);
+    test_irc_fake_server_send (server, *msg);
+    test_irc_fake_server_wait_count (server, "#sync", *sync_count + 1);
+    LONGS_EQUAL(*sync_count + 1,
+                test_irc_fake_server_nick_count (server, "#sync"));
+    string_dyn_free (msg, 1);
+
+    for (i = 0; cases[i].host; i++)
+    {
+        snprintf (text, sizeof (text), "\n%s_%02d\n", name, i);
+        if (cases[i].ignored)
+            POINTERS_EQUAL(NULL, strstr (*messages, text));
+        else
+            CHECK(strstr (*messages, text));
+    }
+}
+
+/*
+ * Tests ignores of messages received, with same results as the check of
+ * ignores one by one (each ignore is a regex, matching nick, host or
+ * "user@host" if the mask has no "!", on any server/channel or a specific
+ * server/channel, case insensitive for server and channel).
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_ignore_new
+ *   irc_ignore_free
+ *   irc_ignore_compile
+ *   irc_ignore_check
+ */
+
+TEST(IrcIgnore, Check)
+{
+    struct t_test_irc_fake_server server;
+    struct t_hook *ptr_hook;
+    char **messages;
+    int sync_count;
+    struct t_test_irc_ignore_case cases_ignores[] = {
+        /* literal nick */
+        { "NICK1!user@host", "#chan", 1 },
+        { "nick1x!user@host", "#chan", 0 },
+        { "xnick1!user@host", "#chan", 0 },
+        /* regex on nick */
+        { "Guest42!user@host", "#Other", 1 },
+        { "guestX!user@host", "#chan", 0 },
+        /* mask on "user@host" */
+        { "anyone1!user@spam.example.com", "#chan", 1 },
+        { "anyone2!user@SPAM.example.com", "#chan", 1 },
+        { "anyone3!user@spam.example.com.evil", "#chan", 0 },
+        /* mask with nick */
+        { "BAD!any@where", "#chan", 1 },
+        { "notbad!bad@where", "#chan", 0 },
+        /* literal "user@host" */
+        { "someone!User2@host2.EXAMPLE.com", "#chan", 1 },
+        { "someone!user2@host2.example.com.evil", "#chan", 0 },
+        /* ignore on a channel */
+        { "chanonly!user@host", "#chan", 1 },
+        { "CHANONLY!user@host", "#CHAN", 1 },
+        { "chanonly!user@host", "#Other", 0 },
+        /* mask "*" on a channel with special chars, own nick never ignored */
+        { "whoever!user@host", "#c++", 1 },
+        { "whoever!user@host", "#chan", 0 },
+        { "alice!user@host", "#c++", 0 },
+        /* server and channel with another case, "." in channel */
+        { "spoof!user@host", "#a.b", 1 },
+        { "spoof!user@host", "#aXb", 0 },
+        /* regex with alternatives (case insensitive) */
+        { "CaseNick!user@host", "#chan", 1 },
+        { "CASENAME!user@host", "#chan", 1 },
+        { "casenick2!user@host", "#chan", 0 },
+        /* ignore on another server */
+        { "other!user@host", "#chan", 0 },
+        /* ignore on a private buffer */
+        { "privnick!user@host", "alice", 1 },
+        { "privnick!user@host", "#chan", 0 },
+        /* regex on a channel with brackets */
+        { "xyz!user@host", "#[x]", 1 },
+        { "xyz!user@host", "#chan", 0 },
+        { NULL, NULL, 0 },
+    };
+    struct t_test_irc_ignore_case cases_changed[] = {
+        { "NICK1!user@host", "#chan", 0 },
+        { "nick2!user@host", "#chan", 1 },
+        { "Guest42!user@host", "#Other", 1 },
+        { "chanonly!user@host", "#chan", 1 },
+        { NULL, NULL, 0 },
+    };
+    struct t_test_irc_ignore_case cases_none[] = {
+        { "nick2!user@host", "#chan", 0 },
+        { "Guest42!user@host", "#Other", 0 },
+        { "anyone1!user@spam.example.com", "#chan", 0 },
+        { "whoever!user@host", "#c++", 0 },
+        { "privnick!user@host", "alice", 0 },
+        { NULL, NULL, 0 },
+    };
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    messages = string_dyn_alloc (256);
+    CHECK(messages);
+    ptr_hook = hook_print (NULL, NULL, NULL, NULL, 1,
+                           &test_irc_ignore_print_cb, messages, NULL);
+    CHECK(ptr_hook);
+
+    CHECK(test_irc_fake_server_start (&server, "ignore", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#chan\r\n"
+                               ":alice!user@host JOIN :#Other\r\n"
+                               ":alice!user@host JOIN :#c++\r\n"
+                               ":alice!user@host JOIN :#a.b\r\n"
+                               ":alice!user@host JOIN :#aXb\r\n"
+                               ":alice!user@host JOIN :#[x]\r\n"
+                               ":alice!user@host JOIN :#sync\r\n");
+    test_irc_fake_server_wait_count (&server, "#sync", 1);
+    sync_count = 0;
+
+    input_data (gui_buffer_search_main (), "/mute /ignore add nick1");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add re:^guest[0-9]+$");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add *@spam.example.com");
+    input_data (gui_buffer_search_main (), "/mute /ignore add bad!*@*");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add user2@host2.example.com");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add chanonly ignore #chan");
+    input_data (gui_buffer_search_main (), "/mute /ignore add * ignore #c++");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add spoof IGNORE #A.B");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add re:^case(nick|name)$");
+    input_data (gui_buffer_search_main (), "/mute /ignore add other othersrv");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add privnick ignore privnick");
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add re:^x.z$ ignore #[x]");
+
+    test_irc_ignore_check_cases (&server, messages, "ignores", cases_ignores,
+                                 &sync_count);
+
+    /* remove an ignore and add another one (ignores are compiled again) */
+    input_data (gui_buffer_search_main (), "/mute /ignore del 1");
+    input_data (gui_buffer_search_main (), "/mute /ignore add nick2");
+    test_irc_ignore_check_cases (&server, messages, "changed", cases_changed,
+                                 &sync_count);
+
+    /* remove all ignores */
+    input_data (gui_buffer_search_main (), "/mute /ignore del -all");
+    test_irc_ignore_check_cases (&server, messages, "none", cases_none,
+                                 &sync_count);
+
+    test_irc_fake_server_stop (&server);
+
+    unhook (ptr_hook);
+    string_dyn_free (messages, 1);
+}
@@ -0,0 +1,336 @@
+/*
+ * test-irc-nick.cpp - test IRC nick functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "src/core/wee-hdata.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-nicklist.h"
+#include "src/plugins/plugin.h"
+}
+
+#include "tests/unit/plugins/irc/test-irc-fake-server.h"
+
+#define TEST_IRC_NICK_NICKS         200
+#define TEST_IRC_NICK_NAMES_PER_MSG 40
+#define TEST_IRC_NICK_SPEAKING_NICKS 50
+#define TEST_IRC_NICK_SPEAKING_MSGS  500
+
+TEST_GROUP(IrcNick)
+{
+};
+
+/*
+ * Checks that nicks in each group of a nicklist are sorted.
+ *
+ * Returns number of nicks in nicklist, -1 if nicks are not sorted.
+ */
+
+int
+test_irc_nick_nicklist_sorted (struct t_gui_nick_group *group)
+{
+    struct t_gui_nick_group *ptr_group;
+    struct t_gui_nick *ptr_nick;
+    int count, count_group;
+
+    count = 0;
+    for (ptr_nick = group->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        if (ptr_nick->next_nick
+            && (string_strcasecmp (ptr_nick->name,
+                                   ptr_nick->next_nick->name) > 0))
+        {
+            return -1;
+        }
+        if (ptr_nick->next_nick && (ptr_nick->next_nick->prev_nick != ptr_nick))
+            return -1;
+        if (!ptr_nick->next_nick && (group->last_nick != ptr_nick))
+            return -1;
+        count++;
+    }
+
+    for (ptr_group = group->children; ptr_group;
+         ptr_group = ptr_group->next_group)
+    {
+        count_group = test_irc_nick_nicklist_sorted (ptr_group);
+        if (count_group < 0)
+            return -1;
+        count += count_group;
+    }
+
+    return count;
+}
+
+/*
+ * Joins a synthetic channel with 200 nicks on a fake IRC server (listening
+ * on localhost), then simulates a netsplit (all nicks quit).
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_nick_new
+ *   irc_nick_nicklist_batch
+ *   irc_nick_change
+ *   irc_nick_free
+ *   irc_nick_search
+ */
+
+TEST(IrcNick, JoinQuit)
+{
+    struct t_test_irc_fake_server server;
+    struct t_gui_buffer *ptr_buffer;
+    time_t start;
+    char command[256], **msg, str_nick[64];
+    int i;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    /* fake IRC server on localhost (random port) */
+    CHECK(test_irc_fake_server_start (&server, "joinquit", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#bench\r\n");
+    test_irc_fake_server_wait_count (&server, "#bench", 1);
+    LONGS_EQUAL(1, test_irc_fake_server_nick_count (&server, "#bench"));
+
+    /* NAMES: 200 nicks (+ own nick) */
+    msg = string_dyn_alloc (256 * 1024);
+    CHECK(msg);
+    for (i = 0; i < TEST_IRC_NICK_NICKS; i++)
+    {
+        if (i % TEST_IRC_NICK_NAMES_PER_MSG == 0)
+            string_dyn_concat (msg, ":server 353 alice = #bench :");
+        snprintf (str_nick, sizeof (str_nick), "%sNick_%05d%s",
+                  (i % 10 == 0) ? "@" : ((i % 10 == 1) ? "+" : ""),
+                  i,
+                  ((i % TEST_IRC_NICK_NAMES_PER_MSG == TEST_IRC_NICK_NAMES_PER_MSG - 1)
+                   || (i == TEST_IRC_NICK_NICKS - 1)) ? "\r\n" : " ");
+        string_dyn_concat (msg, str_nick);
+    }
+    string_dyn_concat (msg, ":server 353 alice = #bench :alice\r\n"
+                       ":server 366 alice #bench :End of /NAMES list.\r\n");
+    test_irc_fake_server_send (&server, *msg);
+    test_irc_fake_server_wait_count (&server, "#bench",
+                                     TEST_IRC_NICK_NICKS + 1);
+    ptr_buffer = gui_buffer_search_by_full_name ("irc.joinquit.#bench");
+    CHECK(ptr_buffer);
+    start = time (NULL);
+    while (ptr_buffer->nicklist_batch
+           && (time (NULL) - start < TEST_IRC_FAKE_SERVER_TIMEOUT))
+    {
+        test_irc_fake_server_run_hooks (&server);
+    }
+    LONGS_EQUAL(TEST_IRC_NICK_NICKS + 1,
+                test_irc_fake_server_nick_count (&server, "#bench"));
+
+    /* nicklist must be sorted after end of /names */
+    LONGS_EQUAL(0, ptr_buffer->nicklist_batch);
+    LONGS_EQUAL(TEST_IRC_NICK_NICKS + 1,
+                test_irc_nick_nicklist_sorted (ptr_buffer->nicklist_root));
+    LONGS_EQUAL(TEST_IRC_NICK_NICKS + 1,
+                ptr_buffer->nicklist_nicks_count);
+
+    /* nick changes, then part/quit with another case */
+    test_irc_fake_server_send (&server,
+                               ":Nick_00000!user@host NICK :Renamed_0\r\n"
+                               ":nick_00001!user@host NICK :renamed_1\r\n"
+                               ":RENAMED_0!user@host PART #bench\r\n"
+                               ":RENAMED_1!user@host QUIT :bye\r\n"
+                               ":unknown!user@host QUIT :bye\r\n");
+    test_irc_fake_server_wait_count (&server, "#bench",
+                                     TEST_IRC_NICK_NICKS - 1);
+    LONGS_EQUAL(TEST_IRC_NICK_NICKS - 1,
+                test_irc_fake_server_nick_count (&server, "#bench"));
+
+    /* netsplit: all nicks quit */
+    string_dyn_copy (msg, NULL);
+    for (i = 2; i < TEST_IRC_NICK_NICKS; i++)
+    {
+        snprintf (command, sizeof (command),
+                  ":Nick_%05d!user@host QUIT :irc.example.com irc2.example.com\r\n",
+                  i);
+        string_dyn_concat (msg, command);
+    }
+    test_irc_fake_server_send (&server, *msg);
+    test_irc_fake_server_wait_count (&server, "#bench", 1);
+    LONGS_EQUAL(1, test_irc_fake_server_nick_count (&server, "#bench"));
+
+    string_dyn_free (msg, 1);
+
+    test_irc_fake_server_stop (&server);
+}
+
+/*
+ * Returns the list of nicks speaking (for smart filter) in a channel, most
+ * recent first, separated by commas.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+test_irc_nick_speaking_time_list (struct t_test_irc_fake_server *server,
+                                  const char *channel)
+{
+    struct t_hdata *hdata_server, *hdata_channel, *hdata_speaking;
+    void *ptr_server, *ptr_channel, *ptr_speaking;
+    char str_condition[256], **list, *result;
+
+    hdata_server = hook_hdata_get (NULL, "irc_server");
+    hdata_channel = hook_hdata_get (NULL, "irc_channel");
+    hdata_speaking = hook_hdata_get (NULL, "irc_channel_speaking");
+    if (!hdata_server || !hdata_channel || !hdata_speaking)
+        return NULL;
+
+    snprintf (str_condition, sizeof (str_condition),
+              "${irc_server.name} == %s", server->name);
+    ptr_server = hdata_search (hdata_server,
+                               hdata_get_list (hdata_server, "irc_servers"),
+                               str_condition, 1);
+    if (!ptr_server)
+        return NULL;
+    snprintf (str_condition, sizeof (str_condition),
+              "${irc_channel.name} == %s", channel);
+    ptr_channel = hdata_search (hdata_channel,
+                                hdata_pointer (hdata_server, ptr_server,
+                                               "channels"),
+                                str_condition, 1);
+    if (!ptr_channel)
+        return NULL;
+
+    list = string_dyn_alloc (256);
+    if (!list)
+        return NULL;
+    for (ptr_speaking = hdata_pointer (hdata_channel, ptr_channel,
+                                       "nicks_speaking_time");
+         ptr_speaking;
+         ptr_speaking = hdata_move (hdata_speaking, ptr_speaking, 1))
+    {
+        if ((*list)[0])
+            string_dyn_concat (list, ",");
+        string_dyn_concat (list, hdata_string (hdata_speaking, ptr_speaking,
+                                               "nick"));
+    }
+    result = *list;
+    string_dyn_free (list, 0);
+
+    return result;
+}
+
+/*
+ * Tests lists of nicks speaking in a channel (smart filter and completion),
+ * with a few nicks, then with many messages from many nicks.
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_channel_nick_speaking_add
+ *   irc_channel_nick_speaking_rename
+ *   irc_channel_nick_speaking_rename_if_present
+ *   irc_channel_nick_speaking_time_search
+ *   irc_channel_nick_speaking_time_add
+ *   irc_channel_nick_speaking_time_rename
+ *   irc_channel_nick_speaking_time_remove_old
+ */
+
+TEST(IrcNick, NickSpeaking)
+{
+    struct t_test_irc_fake_server server;
+    char line[256], **msg, *list, *pos;
+    int i, count;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "speak", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#speak\r\n");
+    test_irc_fake_server_wait_count (&server, "#speak", 1);
+
+    /* most recent nick first, a nick is only once in list */
+    test_irc_fake_server_send (&server,
+                               ":bob!user@host PRIVMSG #speak :hi\r\n"
+                               ":carol!user@host PRIVMSG #speak :hi\r\n"
+                               ":dave!user@host PRIVMSG #speak :hi\r\n"
+                               ":BOB!user@host PRIVMSG #speak :hi again\r\n"
+                               ":eve!user@host JOIN :#speak\r\n");
+    test_irc_fake_server_wait_count (&server, "#speak", 2);
+    list = test_irc_nick_speaking_time_list (&server, "#speak");
+    STRCMP_EQUAL("BOB,dave,carol", list);
+    free (list);
+
+    /* rename of nicks */
+    test_irc_fake_server_send (&server,
+                               ":bob!user@host JOIN :#speak\r\n"
+                               ":dave!user@host JOIN :#speak\r\n"
+                               ":dave!user@host NICK :David\r\n"
+                               ":bob!user@host NICK :dave\r\n"
+                               ":frank!user@host JOIN :#speak\r\n");
+    test_irc_fake_server_wait_count (&server, "#speak", 5);
+    list = test_irc_nick_speaking_time_list (&server, "#speak");
+    STRCMP_EQUAL("dave,David,carol", list);
+    free (list);
+
+    /* many messages from many nicks: each nick is once in list */
+    msg = string_dyn_alloc (TEST_IRC_NICK_SPEAKING_MSGS * 64);
+    CHECK(msg);
+    for (i = 0; i < TEST_IRC_NICK_SPEAKING_MSGS; i++)
+    {
+        snprintf (line, sizeof (line),
+                  ":nick%d!user@host PRIVMSG #speak :message %d\r\n",
+                  (i * 7) % TEST_IRC_NICK_SPEAKING_NICKS, i);
+        string_dyn_concat (msg, line);
+    }
+    string_dyn_concat (msg, ":grace!user@host JOIN :#speak\r\n");
+    test_irc_fake_server_send (&server, *msg);
+    test_irc_fake_server_wait_count (&server, "#speak", 6);
+    LONGS_EQUAL(6, test_irc_fake_server_nick_count (&server, "#speak"));
+    list = test_irc_nick_speaking_time_list (&server, "#speak");
+    CHECK(list);
+    snprintf (line, sizeof (line), "nick%d,",
+              ((TEST_IRC_NICK_SPEAKING_MSGS - 1) * 7)
+              % TEST_IRC_NICK_SPEAKING_NICKS);
+    LONGS_EQUAL(0, strncmp (list, line, strlen (line)));
+    count = 1;
+    for (pos = strchr (list, ','); pos; pos = strchr (pos + 1, ','))
+    {
+        count++;
+    }
+    LONGS_EQUAL(TEST_IRC_NICK_SPEAKING_NICKS + 3, count);
+    CHECK(strstr (list, ",dave,David,carol"));
+    free (list);
+
+    string_dyn_free (msg, 1);
+
+    test_irc_fake_server_stop (&server);
+}
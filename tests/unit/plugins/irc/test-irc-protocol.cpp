@@ -0,0 +1,256 @@
+/*
+ * test-irc-protocol.cpp - test IRC protocol functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "src/core/wee-hook.h"
+#include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/plugin.h"
+}
+
+#include "tests/unit/plugins/irc/test-irc-fake-server.h"
+
+TEST_GROUP(IrcProtocol)
+{
+};
+
+/*
+ * Callback for messages displayed: adds full name of buffer and message at the
+ * end of a dynamic string (one message by line).
+ */
+
+int
+test_irc_protocol_print_cb (const void *pointer, void *data,
+                            struct t_gui_buffer *buffer,
+                            time_t date, int tags_count,
+                            const char **tags, int displayed,
+                            int highlight, const char *prefix,
+                            const char *message)
+{
+    char **messages;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+    (void) prefix;
+
+    messages = (char **)pointer;
+    string_dyn_concat (messages, (buffer) ? buffer->full_name : "");
+    string_dyn_concat (messages, ": ");
+    string_dyn_concat (messages, (message) ? message : "");
+    string_dyn_concat (messages, "\n");
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests search of callbacks for messages received: names of commands are
+ * case insensitive, numeric commands must have exactly 3 digits (other
+ * numeric commands are displayed with the default callback).
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_protocol_message_numeric_index
+ *   irc_protocol_search_message
+ *   irc_protocol_recv_command
+ */
+
+TEST(IrcProtocol, SearchMessage)
+{
+    struct t_test_irc_fake_server server;
+    struct t_hook *ptr_hook;
+    char **messages;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    messages = string_dyn_alloc (256);
+    CHECK(messages);
+    ptr_hook = hook_print (NULL, NULL, NULL, NULL, 1,
+                           &test_irc_protocol_print_cb, messages, NULL);
+    CHECK(ptr_hook);
+
+    CHECK(test_irc_fake_server_start (&server, "search", "alice"));
+
+    /* commands with any case, numeric commands */
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host join :#search\r\n"
+                               ":bob!user@host JoIn :#search\r\n"
+                               ":server 353 alice = #search :carol dave\r\n"
+                               ":server 366 alice #search :End of /NAMES list.\r\n");
+    test_irc_fake_server_wait_count (&server, "#search", 4);
+    LONGS_EQUAL(4, test_irc_fake_server_nick_count (&server, "#search"));
+
+    /* unknown commands, numeric commands without exactly 3 digits */
+    test_irc_fake_server_send (&server,
+                               ":server FOO alice :unknown\r\n"
+                               ":erin!user@host joinx :#search\r\n"
+                               ":server 0353 alice = #search :frank\r\n"
+                               ":server 35 alice = #search :grace\r\n"
+                               ":henry!user@host JOIN :#search\r\n");
+    test_irc_fake_server_wait_count (&server, "#search", 5);
+    LONGS_EQUAL(5, test_irc_fake_server_nick_count (&server, "#search"));
+
+    CHECK(strstr (*messages, "command \"FOO\" not found"));
+    CHECK(strstr (*messages, "command \"joinx\" not found"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "command \"join\" not found"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "command \"JoIn\" not found"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "command \"0353\" not found"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "command \"35\" not found"));
+    CHECK(strstr (*messages, "= #search :frank"));
+    CHECK(strstr (*messages, "= #search :grace"));
+
+    test_irc_fake_server_stop (&server);
+
+    unhook (ptr_hook);
+    string_dyn_free (messages, 1);
+}
+
+/*
+ * Callback for modifiers "irc_in_privmsg" and "irc_in2_privmsg".
+ */
+
+char *
+test_irc_protocol_modifier_cb (const void *pointer, void *data,
+                               const char *modifier,
+                               const char *modifier_data,
+                               const char *string)
+{
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) modifier_data;
+
+    if (string_strcasecmp (modifier, "irc_in_privmsg") == 0)
+    {
+        /* one message split in two messages */
+        if (strstr (string, ":split"))
+        {
+            return strdup (":bob!user@host PRIVMSG #mod1 :first\n"
+                           ":bob!user@host PRIVMSG #mod1 :second");
+        }
+        return NULL;
+    }
+
+    /* message dropped */
+    if (strstr (string, ":drop me"))
+        return strdup ("");
+
+    /* message sent to another channel, with another text */
+    return string_replace (string, "#mod1 :hello", "#mod2 :rewritten");
+}
+
+/*
+ * Tests modifiers "irc_in_xxx" and "irc_in2_xxx" on messages received: the
+ * final message is executed, but the command, channel and tags are the ones
+ * of message before modifier "irc_in2_xxx" (for example the channel used to
+ * check ignores).
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_server_msgq_process_msg
+ *   irc_redirect_message
+ *   irc_protocol_recv_command
+ */
+
+TEST(IrcProtocol, Modifiers)
+{
+    struct t_test_irc_fake_server server;
+    struct t_hook *ptr_hook_print, *ptr_hook_in, *ptr_hook_in2;
+    char **messages;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    messages = string_dyn_alloc (256);
+    CHECK(messages);
+    ptr_hook_print = hook_print (NULL, NULL, NULL, NULL, 1,
+                                 &test_irc_protocol_print_cb, messages, NULL);
+    CHECK(ptr_hook_print);
+    ptr_hook_in = hook_modifier (NULL, "irc_in_privmsg",
+                                 &test_irc_protocol_modifier_cb, NULL, NULL);
+    CHECK(ptr_hook_in);
+    ptr_hook_in2 = hook_modifier (NULL, "irc_in2_privmsg",
+                                  &test_irc_protocol_modifier_cb, NULL, NULL);
+    CHECK(ptr_hook_in2);
+
+    CHECK(test_irc_fake_server_start (&server, "modifier", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#mod1\r\n"
+                               ":alice!user@host JOIN :#mod2\r\n");
+    test_irc_fake_server_wait_count (&server, "#mod2", 1);
+
+    /* messages changed, dropped and split by modifiers */
+    string_dyn_copy (messages, NULL);
+    test_irc_fake_server_send (&server,
+                               ":bob!user@host PRIVMSG #mod1 :hello\r\n"
+                               ":bob!user@host PRIVMSG #mod1 :drop me\r\n"
+                               ":bob!user@host PRIVMSG #mod1 :split\r\n"
+                               ":bob!user@host PRIVMSG #mod1 :other\r\n"
+                               ":carol!user@host JOIN :#mod1\r\n");
+    test_irc_fake_server_wait_count (&server, "#mod1", 2);
+    CHECK(strstr (*messages, "irc.modifier.#mod2: rewritten\n"));
+    CHECK(strstr (*messages, "irc.modifier.#mod1: first\n"));
+    CHECK(strstr (*messages, "irc.modifier.#mod1: second\n"));
+    CHECK(strstr (*messages, "irc.modifier.#mod1: other\n"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "hello"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "drop me"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "split"));
+
+    /* ignore is checked with the channel of message before "irc_in2" */
+    input_data (gui_buffer_search_main (),
+                "/mute /ignore add bob modifier #mod1");
+    string_dyn_copy (messages, NULL);
+    test_irc_fake_server_send (&server,
+                               ":bob!user@host PRIVMSG #mod1 :hello\r\n"
+                               ":bob!user@host PRIVMSG #mod2 :not ignored\r\n"
+                               ":bob!user@host PRIVMSG #mod1 :plainmsg\r\n"
+                               ":dave!user@host JOIN :#mod1\r\n");
+    test_irc_fake_server_wait_count (&server, "#mod1", 3);
+    POINTERS_EQUAL(NULL, strstr (*messages, "rewritten"));
+    POINTERS_EQUAL(NULL, strstr (*messages, "plainmsg"));
+    CHECK(strstr (*messages, "irc.modifier.#mod2: not ignored\n"));
+    input_data (gui_buffer_search_main (), "/mute /ignore del -all");
+
+    test_irc_fake_server_stop (&server);
+
+    unhook (ptr_hook_in2);
+    unhook (ptr_hook_in);
+    unhook (ptr_hook_print);
+    string_dyn_free (messages, 1);
+}
@@ -0,0 +1,909 @@
+/*
+ * test-irc-server.cpp - test IRC server functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include "src/core/wee-hdata.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-infolist.h"
+#include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-hotlist.h"
+#include "src/gui/gui-line.h"
+#include "src/plugins/plugin.h"
+}
+
+#include "tests/unit/plugins/irc/test-irc-fake-server.h"
+
+/* size of read on socket (IRC_SERVER_RECV_BUFFER_READ_SIZE in IRC plugin) */
+#define TEST_IRC_SERVER_RECV_READ_SIZE 16384
+
+/*
+ * max length of ISON/MONITOR messages sent for notify: 510 minus length
+ * reserved for host with default max length of nick (16)
+ */
+#define TEST_IRC_SERVER_NOTIFY_MAX_LENGTH (510 - 82)
+
+#define TEST_IRC_SERVER_NOTIFY_NICKS 100
+
+TEST_GROUP(IrcServer)
+{
+};
+
+/*
+ * Returns value of an integer variable in infolist "irc_server" for a server.
+ */
+
+int
+test_irc_server_infolist_integer (const char *server_name, const char *var)
+{
+    struct t_infolist *infolist;
+    int value;
+
+    value = -1;
+    infolist = hook_infolist_get (NULL, "irc_server", NULL, server_name);
+    if (infolist)
+    {
+        if (infolist_next (infolist))
+            value = infolist_integer (infolist, var);
+        infolist_free (infolist);
+    }
+
+    return value;
+}
+
+/*
+ * Tests anti-flood and merge of messages in out queues.
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_server_anti_flood_tokens
+ *   irc_server_anti_flood_can_send
+ *   irc_server_anti_flood_sent
+ *   irc_server_outqueue_merge
+ */
+
+TEST(IrcServer, OutqueueAntiFlood)
+{
+    struct t_test_irc_fake_server server;
+    char command[64];
+    int i, merged;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "queue", "alice"));
+
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.queue.anti_flood_burst 2");
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.queue.anti_flood_prio_high 60");
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#queue\r\n");
+    test_irc_fake_server_wait_count (&server, "#queue", 1);
+
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("queue",
+                                                     "anti_flood_tokens"));
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("queue",
+                                                     "outqueue_high_count"));
+
+    /* first 2 messages are sent immediately, then JOIN are merged */
+    for (i = 0; i < 10; i++)
+    {
+        snprintf (command, sizeof (command), "/join -server queue -noswitch #chan%d", i);
+        input_data (gui_buffer_search_main (), command);
+    }
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("queue",
+                                                     "anti_flood_tokens"));
+    LONGS_EQUAL(1, test_irc_server_infolist_integer ("queue",
+                                                     "outqueue_high_count"));
+    merged = test_irc_server_infolist_integer ("queue", "outqueue_merged");
+    LONGS_EQUAL(7, merged);
+
+    /* JOIN with a key is never merged */
+    input_data (gui_buffer_search_main (), "/join -server queue -noswitch #key secret");
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("queue",
+                                                     "outqueue_high_count"));
+    LONGS_EQUAL(merged,
+                test_irc_server_infolist_integer ("queue", "outqueue_merged"));
+
+    /* no message sent from queue until a token is available */
+    test_irc_fake_server_run_hooks (&server);
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("queue",
+                                                     "outqueue_high_count"));
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("queue",
+                                                     "outqueue_sent"));
+
+    /* without anti-flood, all messages are sent */
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.queue.anti_flood_prio_high 0");
+    test_irc_fake_server_run_hooks (&server);
+    for (i = 0; i < TEST_IRC_FAKE_SERVER_TIMEOUT * 10; i++)
+    {
+        if (test_irc_server_infolist_integer ("queue",
+                                              "outqueue_high_count") == 0)
+            break;
+        test_irc_fake_server_run_hooks (&server);
+        usleep (100000);
+    }
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("queue",
+                                                     "outqueue_high_count"));
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("queue",
+                                                     "outqueue_sent"));
+
+    test_irc_fake_server_stop (&server);
+}
+
+/*
+ * Callback for signal "irc_out_xxx": disconnects the server when the message
+ * "disconnect_now" is sent.
+ */
+
+int
+test_irc_server_disconnect_cb (const void *pointer, void *data,
+                               const char *signal, const char *type_data,
+                               void *signal_data)
+{
+    int *disconnected;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) signal;
+    (void) type_data;
+
+    disconnected = (int *)pointer;
+    if (!*disconnected && signal_data
+        && strstr ((const char *)signal_data, "disconnect_now"))
+    {
+        *disconnected = 1;
+        input_data (gui_buffer_search_main (), "/disconnect queuedisc");
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests disconnection of server by a callback while messages are sent from
+ * out queue (the queue is freed and must not be used any more).
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_server_outqueue_send
+ */
+
+TEST(IrcServer, OutqueueDisconnect)
+{
+    struct t_test_irc_fake_server server;
+    struct t_hook *ptr_hook;
+    int i, disconnected;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "queuedisc", "alice"));
+
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.queuedisc.anti_flood_burst 2");
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.queuedisc.anti_flood_prio_high 60");
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#queue\r\n");
+    test_irc_fake_server_wait_count (&server, "#queue", 1);
+
+    disconnected = 0;
+    ptr_hook = hook_signal (NULL, "queuedisc,irc_out_*",
+                            &test_irc_server_disconnect_cb, &disconnected,
+                            NULL);
+    CHECK(ptr_hook);
+
+    /* first 2 messages are sent immediately, then 4 are queued */
+    input_data (gui_buffer_search_main (),
+                "/quote -server queuedisc PRIVMSG #queue :msg1");
+    input_data (gui_buffer_search_main (),
+                "/quote -server queuedisc PRIVMSG #queue :msg2");
+    input_data (gui_buffer_search_main (),
+                "/quote -server queuedisc PRIVMSG #queue :disconnect_now");
+    for (i = 0; i < 3; i++)
+    {
+        input_data (gui_buffer_search_main (),
+                    "/quote -server queuedisc PRIVMSG #queue :after");
+    }
+    LONGS_EQUAL(0, disconnected);
+    LONGS_EQUAL(4, test_irc_server_infolist_integer ("queuedisc",
+                                                     "outqueue_high_count"));
+
+    /* without anti-flood, first message in queue disconnects the server */
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.queuedisc.anti_flood_prio_high 0");
+    for (i = 0; i < TEST_IRC_FAKE_SERVER_TIMEOUT * 10; i++)
+    {
+        if (disconnected)
+            break;
+        test_irc_fake_server_run_hooks (&server);
+        usleep (100000);
+    }
+    LONGS_EQUAL(1, disconnected);
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("queuedisc",
+                                                     "is_connected"));
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("queuedisc",
+                                                     "outqueue_high_count"));
+
+    unhook (ptr_hook);
+
+    test_irc_fake_server_stop (&server);
+}
+
+/*
+ * Tests receive of messages split in many reads on socket, with or without
+ * '\r' before '\n'.
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_server_recv_cb
+ *   irc_server_msgq_add_buffer
+ *   irc_server_msgq_flush
+ */
+
+TEST(IrcServer, RecvBuffer)
+{
+    struct t_test_irc_fake_server server;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "recv", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#recv\r\n");
+    test_irc_fake_server_wait_count (&server, "#recv", 1);
+
+    /* message split in two reads */
+    test_irc_fake_server_send (&server, ":bob!user@host JO");
+    test_irc_fake_server_run_hooks (&server);
+    LONGS_EQUAL(1, test_irc_fake_server_nick_count (&server, "#recv"));
+    test_irc_fake_server_send (&server, "IN :#recv\r");
+    test_irc_fake_server_run_hooks (&server);
+    LONGS_EQUAL(1, test_irc_fake_server_nick_count (&server, "#recv"));
+    test_irc_fake_server_send (&server, "\n");
+    test_irc_fake_server_wait_count (&server, "#recv", 2);
+    LONGS_EQUAL(2, test_irc_fake_server_nick_count (&server, "#recv"));
+
+    /* messages without '\r', empty lines */
+    test_irc_fake_server_send (&server,
+                               "\n\r\n"
+                               ":carol!user@host JOIN :#recv\n"
+                               ":dave!user@host JOIN :#recv\n");
+    test_irc_fake_server_wait_count (&server, "#recv", 4);
+    LONGS_EQUAL(4, test_irc_fake_server_nick_count (&server, "#recv"));
+
+    /* message received with command "/server fakerecv" */
+    input_data (gui_buffer_search_by_name ("irc", "server.recv"),
+                "/server fakerecv :eve!user@host JOIN :#recv");
+    LONGS_EQUAL(5, test_irc_fake_server_nick_count (&server, "#recv"));
+
+    test_irc_fake_server_stop (&server);
+}
+
+/*
+ * Returns pointer to an IRC server (via hdata), NULL if not found.
+ */
+
+void *
+test_irc_server_search (const char *server_name)
+{
+    struct t_hdata *hdata_server;
+    char str_condition[256];
+
+    hdata_server = hook_hdata_get (NULL, "irc_server");
+    if (!hdata_server)
+        return NULL;
+
+    snprintf (str_condition, sizeof (str_condition),
+              "${irc_server.name} == %s", server_name);
+    return hdata_search (hdata_server,
+                         hdata_get_list (hdata_server, "irc_servers"),
+                         str_condition, 1);
+}
+
+/*
+ * Callback for messages displayed: adds message at the end of a dynamic
+ * string (one message by line).
+ */
+
+int
+test_irc_server_print_cb (const void *pointer, void *data,
+                          struct t_gui_buffer *buffer,
+                          time_t date, int tags_count,
+                          const char **tags, int displayed,
+                          int highlight, const char *prefix,
+                          const char *message)
+{
+    char **messages;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) buffer;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+    (void) prefix;
+
+    messages = (char **)pointer;
+    string_dyn_concat (messages, (message) ? message : "");
+    string_dyn_concat (messages, "\n");
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests messages received just before the connection is closed by server:
+ * the read fills the receive buffer, so the socket is read again and the
+ * connection closed is detected in the same call, then the complete lines
+ * already received must be processed before disconnecting.
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_server_recv_cb
+ *   irc_server_msgq_flush
+ */
+
+TEST(IrcServer, RecvBeforeDisconnect)
+{
+    struct t_test_irc_fake_server server;
+    struct t_hdata *hdata_server;
+    struct t_hook *ptr_hook;
+    void *ptr_server;
+    const char *lines;
+    char **messages, **data;
+    int i, size, read_size;
+    time_t start;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    messages = string_dyn_alloc (256);
+    CHECK(messages);
+    ptr_hook = hook_print (NULL, NULL, NULL, NULL, 1,
+                           &test_irc_server_print_cb, messages, NULL);
+    CHECK(ptr_hook);
+
+    CHECK(test_irc_fake_server_start (&server, "recverror", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#recv\r\n");
+    test_irc_fake_server_wait_count (&server, "#recv", 1);
+
+    hdata_server = hook_hdata_get (NULL, "irc_server");
+    CHECK(hdata_server);
+    ptr_server = test_irc_server_search ("recverror");
+    CHECK(ptr_server);
+    LONGS_EQUAL(0, hdata_integer (hdata_server, ptr_server,
+                                  "recv_buffer_length"));
+    /* old name of variable "recv_buffer" */
+    POINTERS_EQUAL(hdata_string (hdata_server, ptr_server, "recv_buffer"),
+                   hdata_string (hdata_server, ptr_server,
+                                 "unterminated_message"));
+
+    /* size of next read on socket (see irc_server_recv_buffer_alloc) */
+    size = hdata_integer (hdata_server, ptr_server, "recv_buffer_size");
+    if (size <= 0)
+        size = TEST_IRC_SERVER_RECV_READ_SIZE;
+    while (TEST_IRC_SERVER_RECV_READ_SIZE >= size)
+    {
+        size *= 2;
+    }
+    read_size = size - 1;
+
+    /* complete lines (padded with empty lines) filling the read, then close */
+    lines = ":bob!user@host PRIVMSG #recv :last message\r\n"
+        "ERROR :Closing Link: 127.0.0.1 (Bye)\r\n";
+    data = string_dyn_alloc (read_size + 1);
+    CHECK(data);
+    for (i = strlen (lines); i < read_size; i++)
+    {
+        string_dyn_concat (data, "\n");
+    }
+    string_dyn_concat (data, lines);
+    LONGS_EQUAL(read_size, strlen (*data));
+    test_irc_fake_server_send (&server, *data);
+    string_dyn_free (data, 1);
+    close (server.sock);
+    server.sock = -1;
+
+    start = time (NULL);
+    while ((hdata_integer (hdata_server, ptr_server, "sock") != -1)
+           && (time (NULL) - start < TEST_IRC_FAKE_SERVER_TIMEOUT))
+    {
+        test_irc_fake_server_run_hooks (&server);
+    }
+    LONGS_EQUAL(-1, hdata_integer (hdata_server, ptr_server, "sock"));
+
+    CHECK(strstr (*messages, "\nlast message\n"));
+    CHECK(strstr (*messages, "\nClosing Link: 127.0.0.1 (Bye)\n"));
+    /* disconnected by message "ERROR", not a second time on socket error */
+    POINTERS_EQUAL(NULL, strstr (*messages, "connection closed by peer"));
+
+    test_irc_fake_server_stop (&server);
+
+    unhook (ptr_hook);
+    string_dyn_free (messages, 1);
+}
+
+/*
+ * Returns number of open batches on a server.
+ */
+
+int
+test_irc_server_batch_count (const char *server_name)
+{
+    struct t_hdata *hdata_server, *hdata_batch;
+    void *ptr_server, *ptr_batch;
+    char str_condition[256];
+    int count;
+
+    hdata_server = hook_hdata_get (NULL, "irc_server");
+    hdata_batch = hook_hdata_get (NULL, "irc_batch");
+    if (!hdata_server || !hdata_batch)
+        return -1;
+
+    snprintf (str_condition, sizeof (str_condition),
+              "${irc_server.name} == %s", server_name);
+    ptr_server = hdata_search (hdata_server,
+                               hdata_get_list (hdata_server, "irc_servers"),
+                               str_condition, 1);
+    if (!ptr_server)
+        return -1;
+
+    count = 0;
+    for (ptr_batch = hdata_pointer (hdata_server, ptr_server, "batches");
+         ptr_batch; ptr_batch = hdata_move (hdata_batch, ptr_batch, 1))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ * Tests messages received in a batch (capability "batch"): lines are added in
+ * batch in buffer (hotlist and refresh at end of batch).
+ */
+
+TEST(IrcServer, Batch)
+{
+    struct t_test_irc_fake_server server;
+    struct t_gui_buffer *ptr_server_buffer, *ptr_buffer;
+    int lines_count;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "batch", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#batch\r\n");
+    test_irc_fake_server_wait_count (&server, "#batch", 1);
+
+    ptr_server_buffer = gui_buffer_search_by_name ("irc", "server.batch");
+    ptr_buffer = gui_buffer_search_by_name ("irc", "batch.#batch");
+    CHECK(ptr_server_buffer);
+    CHECK(ptr_buffer);
+    input_data (gui_buffer_search_main (), "/buffer core.weechat");
+    LONGS_EQUAL(0, ptr_buffer->num_displayed);
+    gui_hotlist_remove_buffer (ptr_buffer, 1);
+    lines_count = ptr_buffer->own_lines->lines_count;
+
+    /* start of two batches */
+    input_data (ptr_server_buffer,
+                "/server fakerecv :server BATCH +ref1 chathistory #batch");
+    input_data (ptr_server_buffer,
+                "/server fakerecv :server BATCH +ref2 chathistory #batch");
+    LONGS_EQUAL(2, test_irc_server_batch_count ("batch"));
+    LONGS_EQUAL(0, ptr_buffer->lines_batch);
+
+    /* messages in batches: lines added, no hotlist */
+    input_data (ptr_server_buffer,
+                "/server fakerecv @batch=ref1 :bob!user@host PRIVMSG #batch "
+                ":message 1");
+    LONGS_EQUAL(1, ptr_buffer->lines_batch);
+    input_data (ptr_server_buffer,
+                "/server fakerecv @batch=ref1 :bob!user@host PRIVMSG #batch "
+                ":message 2");
+    input_data (ptr_server_buffer,
+                "/server fakerecv @batch=ref2 :bob!user@host PRIVMSG #batch "
+                ":alice: message 3");
+    LONGS_EQUAL(lines_count + 3, ptr_buffer->own_lines->lines_count);
+    LONGS_EQUAL(1, ptr_buffer->own_lines->last_line->data->highlight);
+    POINTERS_EQUAL(NULL, ptr_buffer->hotlist);
+
+    /* end of first batch: buffer still used in second batch */
+    input_data (ptr_server_buffer, "/server fakerecv :server BATCH -ref1");
+    LONGS_EQUAL(1, test_irc_server_batch_count ("batch"));
+    LONGS_EQUAL(1, ptr_buffer->lines_batch);
+    POINTERS_EQUAL(NULL, ptr_buffer->hotlist);
+
+    /* end of second batch: hotlist updated once with all messages */
+    input_data (ptr_server_buffer, "/server fakerecv :server BATCH -ref2");
+    LONGS_EQUAL(0, test_irc_server_batch_count ("batch"));
+    LONGS_EQUAL(0, ptr_buffer->lines_batch);
+    POINTERS_EQUAL(NULL, ptr_buffer->lines_batch_hotlist);
+    CHECK(ptr_buffer->hotlist);
+    LONGS_EQUAL(GUI_HOTLIST_HIGHLIGHT, ptr_buffer->hotlist->priority);
+    LONGS_EQUAL(2, ptr_buffer->hotlist->count[GUI_HOTLIST_MESSAGE]);
+    LONGS_EQUAL(1, ptr_buffer->hotlist->count[GUI_HOTLIST_HIGHLIGHT]);
+    gui_hotlist_remove_buffer (ptr_buffer, 1);
+
+    /* message with unknown batch: lines are not added in batch */
+    input_data (ptr_server_buffer,
+                "/server fakerecv @batch=ref3 :bob!user@host PRIVMSG #batch "
+                ":message 4");
+    LONGS_EQUAL(0, ptr_buffer->lines_batch);
+    LONGS_EQUAL(lines_count + 4, ptr_buffer->own_lines->lines_count);
+
+    /* batch ended on disconnection */
+    input_data (ptr_server_buffer,
+                "/server fakerecv :server BATCH +ref4 chathistory #batch");
+    input_data (ptr_server_buffer,
+                "/server fakerecv @batch=ref4 :bob!user@host PRIVMSG #batch "
+                ":message 5");
+    LONGS_EQUAL(1, ptr_buffer->lines_batch);
+    input_data (ptr_server_buffer, "/disconnect");
+    LONGS_EQUAL(0, test_irc_server_batch_count ("batch"));
+    LONGS_EQUAL(0, ptr_buffer->lines_batch);
+
+    test_irc_fake_server_stop (&server);
+}
+
+/*
+ * Runs hooks until all messages in low priority and background queues of
+ * server have been sent to the fake IRC server (or timeout).
+ */
+
+void
+test_irc_server_wait_outqueue (struct t_test_irc_fake_server *server)
+{
+    time_t start;
+
+    start = time (NULL);
+    while (((test_irc_server_infolist_integer (server->name,
+                                               "outqueue_low_count") > 0)
+            || (test_irc_server_infolist_integer (server->name,
+                                                  "outqueue_background_count") > 0))
+           && (time (NULL) - start < TEST_IRC_FAKE_SERVER_TIMEOUT))
+    {
+        test_irc_fake_server_run_hooks (server);
+    }
+    test_irc_fake_server_run_hooks (server);
+}
+
+/*
+ * Counts lines starting with "command" in data received by the fake IRC
+ * server. If "replies" is not NULL, a reply 303 (to ISON) with all nicks sent
+ * is added for each line.
+ *
+ * Returns number of lines, -1 if a line is longer than the max length of
+ * notify messages.
+ */
+
+int
+test_irc_server_notify_lines (const char *data, const char *command,
+                              char **replies)
+{
+    char **lines;
+    int i, num_lines, count;
+
+    lines = string_split (data, "\r\n", 0, 0, &num_lines);
+    if (!lines)
+        return 0;
+
+    count = 0;
+    for (i = 0; i < num_lines; i++)
+    {
+        if (strncmp (lines[i], command, strlen (command)) != 0)
+            continue;
+        if ((int)strlen (lines[i]) > TEST_IRC_SERVER_NOTIFY_MAX_LENGTH)
+        {
+            count = -1;
+            break;
+        }
+        count++;
+        if (replies)
+        {
+            string_dyn_concat (replies, ":server 303 alice :");
+            string_dyn_concat (replies, lines[i] + strlen (command));
+            string_dyn_concat (replies, "\r\n");
+        }
+    }
+
+    string_free_split (lines);
+
+    return count;
+}
+
+/*
+ * Builds a notify list with many nicks (nicks separated by commas).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+test_irc_server_notify_nicks ()
+{
+    char **nicks, str_nick[64], *result;
+    int i;
+
+    nicks = string_dyn_alloc (TEST_IRC_SERVER_NOTIFY_NICKS * 20);
+    if (!nicks)
+        return NULL;
+    for (i = 0; i < TEST_IRC_SERVER_NOTIFY_NICKS; i++)
+    {
+        snprintf (str_nick, sizeof (str_nick), "%snotify_nick_%03d",
+                  (i > 0) ? "," : "", i);
+        string_dyn_concat (nicks, str_nick);
+    }
+    result = *nicks;
+    string_dyn_free (nicks, 0);
+
+    return result;
+}
+
+/*
+ * Tests notify with MONITOR: only nicks added/removed are sent to server when
+ * option "notify" is changed, and state of nicks kept is not changed; many
+ * nicks are sent in many messages (not split again before being sent).
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_notify_new_for_server
+ *   irc_notify_send_nicks
+ *   irc_notify_search
+ */
+
+TEST(IrcServer, Notify)
+{
+    struct t_test_irc_fake_server server;
+    struct t_gui_buffer *ptr_server_buffer;
+    char command[4096], *nicks;
+    int queries_sent, lines;
+
+    if (!plugin_search ("irc"))
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    CHECK(test_irc_fake_server_start (&server, "notify", "alice"));
+
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":server 005 alice MONITOR=100 "
+                               ":are supported\r\n"
+                               ":alice!user@host JOIN :#notify\r\n");
+    test_irc_fake_server_wait_count (&server, "#notify", 1);
+
+    ptr_server_buffer = gui_buffer_search_by_name ("irc", "server.notify");
+    CHECK(ptr_server_buffer);
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("notify", "notify_count"));
+    queries_sent = test_irc_server_infolist_integer ("notify",
+                                                     "notify_queries_sent");
+
+    /* new nicks: one message "MONITOR +" */
+    input_data (ptr_server_buffer,
+                "/set irc.server.notify.notify \"bob,carol\"");
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("notify", "notify_count"));
+    LONGS_EQUAL(queries_sent + 1,
+                test_irc_server_infolist_integer ("notify",
+                                                  "notify_queries_sent"));
+
+    /* nicks online/offline */
+    input_data (ptr_server_buffer,
+                "/server fakerecv :server 730 alice :bob!user@host,CAROL");
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("notify",
+                                                     "notify_state_changes"));
+    input_data (ptr_server_buffer,
+                "/server fakerecv :server 731 alice :bob");
+    LONGS_EQUAL(3, test_irc_server_infolist_integer ("notify",
+                                                     "notify_state_changes"));
+
+    /* one nick removed, one added: "MONITOR -" and "MONITOR +" */
+    input_data (ptr_server_buffer,
+                "/set irc.server.notify.notify \"carol,dave\"");
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("notify", "notify_count"));
+    LONGS_EQUAL(queries_sent + 3,
+                test_irc_server_infolist_integer ("notify",
+                                                  "notify_queries_sent"));
+
+    /* same nicks (other order/case): nothing sent, state of carol is kept */
+    input_data (ptr_server_buffer,
+                "/set irc.server.notify.notify \"Dave,carol\"");
+    LONGS_EQUAL(2, test_irc_server_infolist_integer ("notify", "notify_count"));
+    LONGS_EQUAL(queries_sent + 3,
+                test_irc_server_infolist_integer ("notify",
+                                                  "notify_queries_sent"));
+    input_data (ptr_server_buffer,
+                "/server fakerecv :server 730 alice :carol");
+    LONGS_EQUAL(3, test_irc_server_infolist_integer ("notify",
+                                                     "notify_state_changes"));
+
+    /*
+     * many nicks: messages "MONITOR -" and "MONITOR +" are sent in chunks,
+     * each message sent is not split again
+     */
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.notify.anti_flood_prio_low 0");
+    test_irc_server_wait_outqueue (&server);
+    server.received = string_dyn_alloc (4096);
+    CHECK(server.received);
+    queries_sent = test_irc_server_infolist_integer ("notify",
+                                                     "notify_queries_sent");
+    nicks = test_irc_server_notify_nicks ();
+    CHECK(nicks);
+    snprintf (command, sizeof (command),
+              "/set irc.server.notify.notify \"%s\"", nicks);
+    free (nicks);
+    input_data (ptr_server_buffer, command);
+    LONGS_EQUAL(TEST_IRC_SERVER_NOTIFY_NICKS,
+                test_irc_server_infolist_integer ("notify", "notify_count"));
+    test_irc_server_wait_outqueue (&server);
+    LONGS_EQUAL(1, test_irc_server_notify_lines (*server.received,
+                                                 "MONITOR - ", NULL));
+    lines = test_irc_server_notify_lines (*server.received, "MONITOR + ",
+                                          NULL);
+    CHECK(lines > 1);
+    LONGS_EQUAL(queries_sent + 1 + lines,
+                test_irc_server_infolist_integer ("notify",
+                                                  "notify_queries_sent"));
+    string_dyn_free (server.received, 1);
+    server.received = NULL;
+
+    input_data (ptr_server_buffer, "/set irc.server.notify.notify \"\"");
+    LONGS_EQUAL(0, test_irc_server_infolist_integer ("notify", "notify_count"));
+
+    test_irc_fake_server_stop (&server);
+}
+
+/*
+ * Tests notify with ISON: nicks are sent in many messages (not split again
+ * before being sent to server), and each message is redirected, so that the
+ * state of all nicks is updated with the replies.
+ *
+ * Tests functions (in IRC plugin):
+ *   irc_notify_timer_ison_cb
+ *   irc_notify_send_all_nicks
+ *   irc_notify_send_nicks
+ *   irc_notify_hsignal_cb
+ */
+
+TEST(IrcServer, NotifyIson)
+{
+    struct t_test_irc_fake_server server;
+    struct t_weechat_plugin *ptr_plugin;
+    struct t_hdata *hdata_server;
+    int (*ison_cb)(const void *pointer, void *data, int remaining_calls);
+    char command[4096], *nicks, **replies;
+    int queries_sent, state_changes, lines;
+    time_t start;
+
+    ptr_plugin = plugin_search ("irc");
+    if (!ptr_plugin)
+    {
+        printf ("\nIRC plugin not loaded, test skipped\n");
+        return;
+    }
+
+    /* timer callback sending ISON (called directly, instead of waiting) */
+    ison_cb = (int (*)(const void *, void *, int))dlsym (
+        ptr_plugin->handle, "irc_notify_timer_ison_cb");
+    CHECK(ison_cb);
+
+    CHECK(test_irc_fake_server_start (&server, "notifyison", "alice"));
+
+    input_data (gui_buffer_search_main (),
+                "/mute /set irc.server.notifyison.anti_flood_prio_low 0");
+
+    /* no MONITOR in message 005: ISON is used */
+    test_irc_fake_server_send (&server,
+                               ":server 001 alice :Welcome\r\n"
+                               ":alice!user@host JOIN :#notifyison\r\n");
+    test_irc_fake_server_wait_count (&server, "#notifyison", 1);
+
+    nicks = test_irc_server_notify_nicks ();
+    CHECK(nicks);
+    snprintf (command, sizeof (command),
+              "/mute /set irc.server.notifyison.notify \"%s\"", nicks);
+    free (nicks);
+    input_data (gui_buffer_search_main (), command);
+    LONGS_EQUAL(TEST_IRC_SERVER_NOTIFY_NICKS,
+                test_irc_server_infolist_integer ("notifyison",
+                                                  "notify_count"));
+    queries_sent = test_irc_server_infolist_integer ("notifyison",
+                                                     "notify_queries_sent");
+    state_changes = test_irc_server_infolist_integer ("notifyison",
+                                                      "notify_state_changes");
+
+    /* one redirect for each message ISON sent */
+    server.received = string_dyn_alloc (4096);
+    CHECK(server.received);
+    ison_cb (NULL, NULL, 0);
+    test_irc_server_wait_outqueue (&server);
+    replies = string_dyn_alloc (4096);
+    CHECK(replies);
+    lines = test_irc_server_notify_lines (*server.received, "ISON :",
+                                          replies);
+    CHECK(lines > 1);
+    LONGS_EQUAL(queries_sent + lines,
+                test_irc_server_infolist_integer ("notifyison",
+                                                  "notify_queries_sent"));
+
+    /* all nicks online: state of all nicks is updated */
+    test_irc_fake_server_send (&server, *replies);
+    start = time (NULL);
+    while ((test_irc_server_infolist_integer ("notifyison",
+                                              "notify_state_changes")
+            < state_changes + TEST_IRC_SERVER_NOTIFY_NICKS)
+           && (time (NULL) - start < TEST_IRC_FAKE_SERVER_TIMEOUT))
+    {
+        test_irc_fake_server_run_hooks (&server);
+    }
+    LONGS_EQUAL(state_changes + TEST_IRC_SERVER_NOTIFY_NICKS,
+                test_irc_server_infolist_integer ("notifyison",
+                                                  "notify_state_changes"));
+    hdata_server = hook_hdata_get (NULL, "irc_server");
+    CHECK(hdata_server);
+    POINTERS_EQUAL(NULL,
+                   hdata_pointer (hdata_server,
+                                  test_irc_server_search ("notifyison"),
+                                  "redirects"));
+
+    string_dyn_free (replies, 1);
+    string_dyn_free (server.received, 1);
+    server.received = NULL;
+
+    test_irc_fake_server_stop (&server);
+}